@@ -17,6 +17,12 @@ bool BetaChannel = false;
 quint64 AlphaVersion = 0;
 bool OnlyAlphaKey = false;
 
+// Delta packages hold only the files changed since DeltaVersion, the rest
+// are taken by the client from its installation of exactly that version.
+const quint32 DeltaPackageTag = 0x7FFFFFFE;
+int DeltaVersion = 0;
+QString DeltaPath;
+
 const char *PublicKey = "\
 -----BEGIN RSA PUBLIC KEY-----\n\
 MIGJAoGBAMA4ViQrjkPZ9xj0lrer3r23JvxOnrtE8nI69XLGSr+sRERz9YnUptnU\n\
@@ -162,6 +168,10 @@ int main(int argc, char *argv[])
 			version = QString(argv[i + 1]).toInt();
 		} else if (string("-beta") == argv[i]) {
 			BetaChannel = true;
+		} else if (string("-delta") == argv[i] && i + 1 < argc) {
+			DeltaPath = QFileInfo(workDir + QString(argv[i + 1])).canonicalFilePath();
+		} else if (string("-deltaversion") == argv[i] && i + 1 < argc) {
+			DeltaVersion = QString(argv[i + 1]).toInt();
 		} else if (string("-alphakey") == argv[i]) {
 			OnlyAlphaKey = true;
 		} else if (string("-alpha") == argv[i] && i + 1 < argc) {
@@ -190,8 +200,18 @@ int main(int argc, char *argv[])
 #else
 		cout << "Usage: Packer -path {file} -version {version} OR Packer -path {dir} -version {version}\n";
 #endif
+		cout << "Add -delta {previous version dir} -deltaversion {previous version} to pack only the changed files.\n";
 		return -1;
 	}
+	if (!DeltaPath.isEmpty() || DeltaVersion) {
+		if (DeltaPath.isEmpty() || !QFileInfo(DeltaPath).isDir() || DeltaVersion <= 1016 || DeltaVersion >= version) {
+			cout << "Bad delta params, should be: -delta {previous version dir} -deltaversion {previous version}\n";
+			return -1;
+		} else if (AlphaVersion) {
+			cout << "Delta packages are not supported for alpha versions.\n";
+			return -1;
+		}
+	}
 
 	bool hasDirs = true;
 	while (hasDirs) {
@@ -235,6 +255,10 @@ int main(int argc, char *argv[])
 		if (AlphaVersion) {
 			stream << quint32(0x7FFFFFFF);
 			stream << quint64(AlphaVersion);
+		} else if (DeltaVersion) {
+			stream << DeltaPackageTag;
+			stream << quint32(version);
+			stream << quint32(DeltaVersion);
 		} else {
 			stream << quint32(version);
 		}
@@ -253,7 +277,26 @@ int main(int argc, char *argv[])
 				return -1;
 			}
 			QByteArray inner = f.readAll();
-			stream << name << quint32(inner.size()) << inner;
+			if (DeltaVersion) {
+				bool same = false;
+				QFile previous(DeltaPath + '/' + name);
+				if (previous.open(QIODevice::ReadOnly)) {
+					same = (previous.readAll() == inner)
+						&& (QFileInfo(previous).isExecutable() == info.isExecutable());
+					previous.close();
+				}
+				stream << name << same;
+				if (same) {
+					uchar sha1Buffer[20];
+					hashSha1(inner.constData(), inner.size(), sha1Buffer);
+					stream << QByteArray((const char*)sha1Buffer, 20);
+					cout << "unchanged\n";
+				} else {
+					stream << quint32(inner.size()) << inner;
+				}
+			} else {
+				stream << name << quint32(inner.size()) << inner;
+			}
 #if defined Q_OS_MAC || defined Q_OS_LINUX
 			stream << (QFileInfo(fullName).isExecutable() ? true : false);
 #endif
@@ -476,6 +519,8 @@ int main(int argc, char *argv[])
 #endif
 	if (AlphaVersion) {
 		outName += "_" + AlphaSignature;
+	} else if (DeltaVersion) {
+		outName += QString("_delta%1").arg(DeltaVersion);
 	}
 	QFile out(outName);
 	if (!out.open(QIODevice::WriteOnly)) {
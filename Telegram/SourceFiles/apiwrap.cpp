@@ -78,6 +78,9 @@ constexpr auto kForwardMessagesOnAdd = 100;
 constexpr auto kProxyPromotionInterval = TimeId(60 * 60);
 constexpr auto kProxyPromotionMinDelay = TimeId(10);
 constexpr auto kSmallDelayMs = 5;
+constexpr auto kPeersRequestDelay = crl::time(50);
+constexpr auto kPeersRequestLimit = 100;
+constexpr auto kReadRequestDelay = crl::time(500);
 constexpr auto kUnreadMentionsPreloadIfLess = 5;
 constexpr auto kUnreadMentionsFirstRequestLimit = 10;
 constexpr auto kUnreadMentionsNextRequestLimit = 100;
@@ -91,6 +94,7 @@ constexpr auto kNotifySettingSaveTimeout = crl::time(1000);
 constexpr auto kDialogsFirstLoad = 20;
 constexpr auto kDialogsPerPage = 500;
 constexpr auto kBlockedFirstSlice = 16;
+constexpr auto kHistorySliceCacheTag = uint64(0x0100000000000000ULL);
 
 using PhotoFileLocationId = Data::PhotoFileLocationId;
 using DocumentFileLocationId = Data::DocumentFileLocationId;
@@ -160,6 +164,47 @@ MTPVector<MTPDocumentAttribute> ComposeSendingDocumentAttributes(
 	return MTP_vector<MTPDocumentAttribute>(attributes);
 }
 
+template <typename Type>
+QByteArray SerializeMtp(const Type &data) {
+	auto buffer = mtpBuffer();
+	data.write(buffer);
+	return QByteArray(
+		reinterpret_cast<const char*>(buffer.constData()),
+		buffer.size() * sizeof(mtpPrime));
+}
+
+template <typename Type>
+std::optional<Type> DeserializeMtp(const QByteArray &serialized) {
+	if (serialized.isEmpty() || serialized.size() % sizeof(mtpPrime)) {
+		return std::nullopt;
+	}
+	auto from = reinterpret_cast<const mtpPrime*>(serialized.constData());
+	const auto till = from + serialized.size() / sizeof(mtpPrime);
+	auto result = Type();
+	try {
+		result.read(from, till);
+	} catch (Exception &) {
+		return std::nullopt;
+	}
+	return (from == till) ? std::make_optional(result) : std::nullopt;
+}
+
+Storage::Cache::Key HistorySliceCacheKey(not_null<History*> history) {
+	return Storage::Cache::Key{
+		kHistorySliceCacheTag,
+		uint64(history->peer->id)
+	};
+}
+
+const QVector<MTPMessage> *HistorySliceMessages(
+		const MTPmessages_Messages &slice) {
+	return slice.match([](const MTPDmessages_messagesNotModified &) {
+		return static_cast<const QVector<MTPMessage>*>(nullptr);
+	}, [](const auto &data) {
+		return &data.vmessages.v;
+	});
+}
+
 } // namespace
 
 ApiWrap::SendOptions::SendOptions(not_null<History*> history)
@@ -228,11 +273,18 @@ bool ApiWrap::BlockedUsersSlice::operator!=(const BlockedUsersSlice &other) cons
 ApiWrap::ApiWrap(not_null<AuthSession*> session)
 : _session(session)
 , _messageDataResolveDelayed([=] { resolveMessageDatas(); })
+, _peersToRequest(kPeersRequestDelay, kPeersRequestLimit, [=](
+		std::vector<not_null<PeerData*>> &&peers) {
+	sendPeerRequests(std::move(peers));
+})
 , _webPagesTimer([=] { resolveWebPages(); })
 , _draftsSaveTimer([=] { saveDraftsToCloud(); })
 , _featuredSetsReadTimer([=] { readFeaturedSets(); })
 , _dialogsLoadState(std::make_unique<DialogsLoadState>())
-, _fileLoader(std::make_unique<TaskQueue>(kFileLoaderQueueStopTimeout))
+, _readRequestsTimer([=] { flushReadRequests(); })
+, _fileLoader(std::make_unique<TaskQueue>(
+	kFileLoaderQueueStopTimeout,
+	QThread::idealThreadCount()))
 //, _feedReadTimer([=] { readFeeds(); }) // #feed
 , _proxyPromotionTimer([=] { refreshProxyPromotion(); })
 , _updateNotifySettingsTimer([=] { sendNotifySettingsUpdates(); }) {
@@ -810,6 +862,13 @@ void ApiWrap::requestMoreDialogs(Data::Folder *folder) {
 				data.vmessages.v,
 				data.vdialogs.v,
 				count);
+			if (!folder) {
+				if (firstLoad) {
+					_dialogsSnapshotList = SerializeMtp(result);
+					saveDialogsSnapshot();
+				}
+				confirmDialogsFromSnapshot(data.vdialogs.v);
+			}
 		});
 
 		if (!folder) {
@@ -822,7 +881,7 @@ void ApiWrap::requestMoreDialogs(Data::Folder *folder) {
 		_session->data().chatsListChanged(folder);
 	}).fail([=](const RPCError &error) {
 		dialogsLoadState(folder)->requestId = 0;
-	}).send();
+	}).readInBackground().send();
 
 	if (!state->pinnedReceived) {
 		requestPinnedDialogs(folder);
@@ -943,6 +1002,11 @@ void ApiWrap::requestPinnedDialogs(Data::Folder *folder) {
 				folder,
 				data.vmessages.v,
 				data.vdialogs.v);
+			if (!folder) {
+				_dialogsSnapshotPinned = SerializeMtp(result);
+				saveDialogsSnapshot();
+				confirmDialogsFromSnapshot(data.vdialogs.v);
+			}
 			_session->data().chatsListChanged(folder);
 			_session->data().notifyPinnedDialogsOrderUpdated();
 		});
@@ -951,6 +1015,117 @@ void ApiWrap::requestPinnedDialogs(Data::Folder *folder) {
 	}).send();
 }
 
+void ApiWrap::applyDialogsSnapshot() {
+	if (_session->supportMode()
+		|| !_dialogsLoadState
+		|| _dialogsLoadState->listReceived
+		|| _dialogsLoadState->offsetDate
+		|| _dialogsLoadState->pinnedReceived) {
+		return;
+	}
+	auto serialized = Local::readDialogsSnapshot();
+	if (serialized.isEmpty()) {
+		return;
+	}
+	auto version = qint32();
+	auto pinned = QByteArray();
+	auto list = QByteArray();
+	QDataStream stream(&serialized, QIODevice::ReadOnly);
+	stream.setVersion(QDataStream::Qt_5_1);
+	stream >> version >> pinned >> list;
+	if (stream.status() != QDataStream::Ok || version != AppVersion) {
+		return;
+	}
+	const auto remember = [&](const QVector<MTPDialog> &dialogs) {
+		for (const auto &dialog : dialogs) {
+			dialog.match([&](const MTPDdialog &data) {
+				const auto peerId = peerFromMTP(data.vpeer);
+				if (const auto peer = _session->data().peerLoaded(peerId)) {
+					_dialogsFromSnapshot.emplace(
+						_session->data().history(peer),
+						data.vtop_message.v);
+				}
+			}, [](const MTPDdialogFolder &) {
+			});
+		}
+	};
+	if (const auto dialogs = DeserializeMtp<MTPmessages_Dialogs>(list)) {
+		dialogs->match([](const MTPDmessages_dialogsNotModified &) {
+		}, [&](const auto &data) {
+			_session->data().processUsers(data.vusers);
+			_session->data().processChats(data.vchats);
+			_session->data().applyDialogs(
+				nullptr,
+				data.vmessages.v,
+				data.vdialogs.v);
+			remember(data.vdialogs.v);
+		});
+	}
+	if (const auto dialogs = DeserializeMtp<MTPmessages_PeerDialogs>(pinned)) {
+		dialogs->match([&](const MTPDmessages_peerDialogs &data) {
+			_session->data().processUsers(data.vusers);
+			_session->data().processChats(data.vchats);
+			_session->data().clearPinnedChats(nullptr);
+			_session->data().applyDialogs(
+				nullptr,
+				data.vmessages.v,
+				data.vdialogs.v);
+			remember(data.vdialogs.v);
+			_session->data().notifyPinnedDialogsOrderUpdated();
+		});
+	}
+	_session->data().chatsListChanged(nullptr);
+}
+
+void ApiWrap::saveDialogsSnapshot() {
+	if (_dialogsSnapshotPinned.isEmpty() || _dialogsSnapshotList.isEmpty()) {
+		return;
+	}
+	auto serialized = QByteArray();
+	{
+		QDataStream stream(&serialized, QIODevice::WriteOnly);
+		stream.setVersion(QDataStream::Qt_5_1);
+		stream
+			<< qint32(AppVersion)
+			<< base::take(_dialogsSnapshotPinned)
+			<< base::take(_dialogsSnapshotList);
+	}
+	Local::writeDialogsSnapshot(serialized);
+}
+
+void ApiWrap::confirmDialogsFromSnapshot(const QVector<MTPDialog> &dialogs) {
+	if (_dialogsFromSnapshot.empty()) {
+		return;
+	}
+	for (const auto &dialog : dialogs) {
+		dialog.match([&](const MTPDdialog &data) {
+			const auto peerId = peerFromMTP(data.vpeer);
+			if (const auto peer = _session->data().peerLoaded(peerId)) {
+				_dialogsFromSnapshot.remove(_session->data().history(peer));
+			}
+		}, [](const MTPDdialogFolder &) {
+		});
+	}
+	if (_dialogsLoadState) {
+		return;
+	}
+
+	// The full list is received, the chats left from the snapshot were
+	// removed from the list while the app was closed.
+	const auto left = base::take(_dialogsFromSnapshot);
+	for (const auto &[history, topMessageId] : left) {
+		const auto last = history->lastMessage();
+		if (history->folder()
+			|| history->isPinnedDialog()
+			|| (last && last->id != topMessageId)) {
+			continue;
+		}
+		if (const auto main = App::main()) {
+			main->removeDialog(history);
+		}
+	}
+}
+
 void ApiWrap::requestMoreBlockedByDateDialogs() {
 	if (!_dialogsLoadState) {
 		return;
@@ -1127,6 +1302,81 @@ void ApiWrap::requestFakeChatListMessage(
 	}).send();
 }
 
+void ApiWrap::cacheHistorySlice(
+		not_null<History*> history,
+		const MTPmessages_Messages &slice) {
+	const auto messages = HistorySliceMessages(slice);
+	if (!messages || messages->isEmpty()) {
+		return;
+	}
+	auto serialized = slice.match([](
+			const MTPDmessages_channelMessages &data) {
+		// The channel pts will be outdated by the time the slice is read.
+		return SerializeMtp(MTP_messages_messagesSlice(
+			MTP_flags(0),
+			data.vcount,
+			data.vmessages,
+			data.vchats,
+			data.vusers));
+	}, [&](const auto &) {
+		return SerializeMtp(slice);
+	});
+	_session->data().cacheMessages().put(
+		HistorySliceCacheKey(history),
+		std::move(serialized));
+}
+
+void ApiWrap::clearCachedHistorySlice(not_null<History*> history) {
+	_session->data().cacheMessages().remove(HistorySliceCacheKey(history));
+}
+
+void ApiWrap::requestCachedHistorySlice(
+		not_null<History*> history,
+		Fn<void(std::optional<MTPmessages_Messages>)> done) {
+	_session->data().cacheMessages().get(
+		HistorySliceCacheKey(history),
+		[=](QByteArray &&value) {
+			auto result = DeserializeMtp<MTPmessages_Messages>(value);
+			crl::on_main([=, result = std::move(result)] {
+				done(result);
+			});
+		});
+}
+
+void ApiWrap::reconcileCachedHistorySlice(
+		not_null<History*> history,
+		const std::vector<MsgId> &cached,
+		const MTPmessages_Messages &received) {
+	const auto messages = HistorySliceMessages(received);
+	if (!messages) {
+		return;
+	}
+	auto minId = messages->isEmpty()
+		? MsgId(0)
+		: std::numeric_limits<MsgId>::max();
+	auto ids = base::flat_set<MsgId>();
+	ids.reserve(messages->size());
+	for (const auto &message : *messages) {
+		const auto id = IdFromMessage(message);
+		ids.emplace(id);
+		accumulate_min(minId, id);
+
+		// The cached copies of the messages could be edited since then.
+		_session->data().updateEditedMessage(message);
+	}
+
+	// The received slice ends with the last message, so everything
+	// cached inside its range that was not received is deleted.
+	const auto channel = history->channelId();
+	for (const auto id : cached) {
+		if (id >= minId && !ids.contains(id)) {
+			if (const auto item = _session->data().message(channel, id)) {
+				item->destroy();
+			}
+		}
+	}
+}
+
 void ApiWrap::requestWallPaper(
 		const QString &slug,
 		Fn<void(const Data::WallPaper &)> done,
@@ -1279,38 +1529,85 @@ void ApiWrap::requestPeer(not_null<PeerData*> peer) {
 	if (_fullPeerRequests.contains(peer) || _peerRequests.contains(peer)) {
 		return;
 	}
+	_peersToRequest.add(peer);
+}
 
-	const auto requestId = [&] {
-		const auto failHandler = [=](const RPCError &error) {
-			_peerRequests.remove(peer);
-		};
-		const auto chatHandler = [=](const MTPmessages_Chats &result) {
-			_peerRequests.remove(peer);
-			const auto &chats = result.match([](const auto &data) {
-				return data.vchats;
-			});
-			_session->data().applyMaximumChatVersions(chats);
-			_session->data().processChats(chats);
-		};
-		if (const auto user = peer->asUser()) {
-			return request(MTPusers_GetUsers(
-				MTP_vector<MTPInputUser>(1, user->inputUser)
-			)).done([=](const MTPVector<MTPUser> &result) {
-				_peerRequests.remove(user);
-				_session->data().processUsers(result);
-			}).fail(failHandler).send();
+void ApiWrap::sendPeerRequests(std::vector<not_null<PeerData*>> &&peers) {
+	auto chats = QVector<MTPint>();
+	auto channels = QVector<MTPInputChannel>();
+	auto users = QVector<MTPInputUser>();
+	auto chatPeers = std::vector<not_null<PeerData*>>();
+	auto channelPeers = std::vector<not_null<PeerData*>>();
+	auto userPeers = std::vector<not_null<PeerData*>>();
+	for (const auto peer : peers) {
+		if (_fullPeerRequests.contains(peer)
+			|| _peerRequests.contains(peer)) {
+			continue;
+		} else if (const auto user = peer->asUser()) {
+			users.push_back(user->inputUser);
+			userPeers.push_back(peer);
 		} else if (const auto chat = peer->asChat()) {
-			return request(MTPmessages_GetChats(
-				MTP_vector<MTPint>(1, chat->inputChat)
-			)).done(chatHandler).fail(failHandler).send();
+			chats.push_back(chat->inputChat);
+			chatPeers.push_back(peer);
 		} else if (const auto channel = peer->asChannel()) {
-			return request(MTPchannels_GetChannels(
-				MTP_vector<MTPInputChannel>(1, channel->inputChannel)
-			)).done(chatHandler).fail(failHandler).send();
+			channels.push_back(channel->inputChannel);
+			channelPeers.push_back(peer);
 		}
-		Unexpected("Peer type in requestPeer.");
-	}();
-	_peerRequests.insert(peer, requestId);
+	}
+	const auto finish = [=](
+			const std::vector<not_null<PeerData*>> &list,
+			mtpRequestId requestId) {
+		for (const auto peer : list) {
+			const auto i = _peerRequests.find(peer);
+			if (i != _peerRequests.end() && i.value() == requestId) {
+				_peerRequests.erase(i);
+			}
+		}
+	};
+	const auto sent = [&](
+			const std::vector<not_null<PeerData*>> &list,
+			mtpRequestId requestId) {
+		for (const auto peer : list) {
+			_peerRequests.insert(peer, requestId);
+		}
+	};
+	const auto handleChats = [=](const MTPmessages_Chats &result) {
+		const auto &chats = result.match([](const auto &data) {
+			return data.vchats;
+		});
+		_session->data().applyMaximumChatVersions(chats);
+		_session->data().processChats(chats);
+	};
+	if (!chats.isEmpty()) {
+		sent(chatPeers, request(MTPmessages_GetChats(
+			MTP_vector<MTPint>(chats)
+		)).done([=](const MTPmessages_Chats &result, mtpRequestId requestId) {
+			finish(chatPeers, requestId);
+			handleChats(result);
+		}).fail([=](const RPCError &error, mtpRequestId requestId) {
+			finish(chatPeers, requestId);
+		}).send());
+	}
+	if (!channels.isEmpty()) {
+		sent(channelPeers, request(MTPchannels_GetChannels(
+			MTP_vector<MTPInputChannel>(channels)
+		)).done([=](const MTPmessages_Chats &result, mtpRequestId requestId) {
+			finish(channelPeers, requestId);
+			handleChats(result);
+		}).fail([=](const RPCError &error, mtpRequestId requestId) {
+			finish(channelPeers, requestId);
+		}).send());
+	}
+	if (!users.isEmpty()) {
+		sent(userPeers, request(MTPusers_GetUsers(
+			MTP_vector<MTPInputUser>(users)
+		)).done([=](const MTPVector<MTPUser> &result, mtpRequestId requestId) {
+			finish(userPeers, requestId);
+			_session->data().processUsers(result);
+		}).fail([=](const RPCError &error, mtpRequestId requestId) {
+			finish(userPeers, requestId);
+		}).send());
+	}
 }
 
 void ApiWrap::migrateChat(
@@ -1463,48 +1760,12 @@ void ApiWrap::markMediaRead(not_null<HistoryItem*> item) {
 }
 
 void ApiWrap::requestPeers(const QList<PeerData*> &peers) {
-	QVector<MTPint> chats;
-	QVector<MTPInputChannel> channels;
-	QVector<MTPInputUser> users;
-	chats.reserve(peers.size());
-	channels.reserve(peers.size());
-	users.reserve(peers.size());
 	for (const auto peer : peers) {
-		if (!peer
-			|| _fullPeerRequests.contains(peer)
-			|| _peerRequests.contains(peer)) {
-			continue;
-		}
-		if (const auto user = peer->asUser()) {
-			users.push_back(user->inputUser);
-		} else if (const auto chat = peer->asChat()) {
-			chats.push_back(chat->inputChat);
-		} else if (const auto channel = peer->asChannel()) {
-			channels.push_back(channel->inputChannel);
+		if (peer) {
+			requestPeer(peer);
 		}
 	}
-	const auto handleChats = [=](const MTPmessages_Chats &result) {
-		_session->data().processChats(result.match([](const auto &data) {
-			return data.vchats;
-		}));
-	};
-	if (!chats.isEmpty()) {
-		request(MTPmessages_GetChats(
-			MTP_vector<MTPint>(chats)
-		)).done(handleChats).send();
-	}
-	if (!channels.isEmpty()) {
-		request(MTPchannels_GetChannels(
-			MTP_vector<MTPInputChannel>(channels)
-		)).done(handleChats).send();
-	}
-	if (!users.isEmpty()) {
-		request(MTPusers_GetUsers(
-			MTP_vector<MTPInputUser>(users)
-		)).done([=](const MTPVector<MTPUser> &result) {
-			_session->data().processUsers(result);
-		}).send();
-	}
+	_peersToRequest.send();
 }
 
 void ApiWrap::requestLastParticipants(not_null<ChannelData*> channel) {
@@ -2643,16 +2904,17 @@ void ApiWrap::saveDraftsToCloud() {
 }
 
 bool ApiWrap::isQuitPrevent() {
-	if (_draftsSaveRequestIds.empty()) {
+	flushReadRequests();
+	if (_draftsSaveRequestIds.empty() && _readRequests.empty()) {
 		return false;
 	}
-	LOG(("ApiWrap prevents quit, saving drafts..."));
+	LOG(("ApiWrap prevents quit, saving drafts and read states..."));
 	saveDraftsToCloud();
 	return true;
 }
 
 void ApiWrap::checkQuitPreventFinished() {
-	if (_draftsSaveRequestIds.empty()) {
+	if (_draftsSaveRequestIds.empty() && _readRequests.empty()) {
 		if (App::quitting()) {
 			LOG(("ApiWrap doesn't prevent quit any more."));
 		}
@@ -2883,7 +3145,7 @@ void ApiWrap::channelRangeDifferenceSend(
 		channelRangeDifferenceDone(channel, range, result);
 	}).fail([=](const RPCError &error) {
 		_rangeDifferenceRequests.remove(channel);
-	}).send();
+	}).readInBackground().send();
 	_rangeDifferenceRequests.emplace(channel, requestId);
 }
 
@@ -6023,15 +6285,16 @@ void ApiWrap::readServerHistoryForce(not_null<History*> history) {
 		}
 	}
 
-	if (_readRequests.contains(peer)) {
-		const auto i = _readRequestsPending.find(peer);
-		if (i == _readRequestsPending.cend()) {
-			_readRequestsPending.emplace(peer, upTo);
-		} else if (i->second < upTo) {
-			i->second = upTo;
-		}
-	} else {
-		sendReadRequest(peer, upTo);
+	// Inbox read state moves forward many times while scrolling,
+	// only the last value is sent after a short delay.
+	const auto i = _readRequestsPending.find(peer);
+	if (i == _readRequestsPending.cend()) {
+		_readRequestsPending.emplace(peer, upTo);
+	} else if (i->second < upTo) {
+		i->second = upTo;
+	}
+	if (!_readRequests.contains(peer) && !_readRequestsTimer.isActive()) {
+		_readRequestsTimer.callOnce(kReadRequestDelay);
 	}
 }
 // // #feed
@@ -6088,6 +6351,20 @@ void ApiWrap::readServerHistoryForce(not_null<History*> history) {
 //	}
 //}
 
+void ApiWrap::flushReadRequests() {
+	_readRequestsTimer.cancel();
+	auto &pending = _readRequestsPending;
+	for (auto i = pending.begin(); i != pending.end();) {
+		if (_readRequests.contains(i->first)) {
+			++i;
+		} else {
+			const auto [peer, upTo] = *i;
+			i = pending.erase(i);
+			sendReadRequest(peer, upTo);
+		}
+	}
+}
+
 void ApiWrap::sendReadRequest(not_null<PeerData*> peer, MsgId upTo) {
 	const auto requestId = [&] {
 		const auto finished = [=] {
@@ -6100,6 +6377,7 @@ void ApiWrap::sendReadRequest(not_null<PeerData*> peer, MsgId upTo) {
 					requestDialogEntry(history);
 				}
 			}
+			checkQuitPreventFinished();
 		};
 		if (const auto channel = peer->asChannel()) {
 			return request(MTPchannels_ReadHistory(
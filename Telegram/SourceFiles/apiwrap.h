@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include <rpl/event_stream.h>
 #include "base/timer.h"
+#include "base/delayed_batch.h"
 #include "base/flat_map.h"
 #include "base/flat_set.h"
 #include "mtproto/sender.h"
@@ -127,6 +128,9 @@ public:
 	rpl::producer<bool> dialogsLoadMayBlockByDate() const;
 	rpl::producer<bool> dialogsLoadBlockedByDate() const;
 
+	// Shows the saved first page of the chats list until it is received.
+	void applyDialogsSnapshot();
+
 	void requestDialogEntry(not_null<Data::Folder*> folder);
 	void requestDialogEntry(
 		not_null<History*> history,
@@ -140,6 +144,20 @@ public:
 	//void changeDialogUnreadMark(not_null<Data::Feed*> feed, bool unread); // #feed
 	void requestFakeChatListMessage(not_null<History*> history);
 
+	// The last slice of a chat received from the server is kept on disk
+	// to be shown while the chat is opened again, until it is reloaded.
+	void cacheHistorySlice(
+		not_null<History*> history,
+		const MTPmessages_Messages &slice);
+	void clearCachedHistorySlice(not_null<History*> history);
+	void requestCachedHistorySlice(
+		not_null<History*> history,
+		Fn<void(std::optional<MTPmessages_Messages>)> done);
+	void reconcileCachedHistorySlice(
+		not_null<History*> history,
+		const std::vector<MsgId> &cached,
+		const MTPmessages_Messages &received);
+
 	void requestWallPaper(
 		const QString &slug,
 		Fn<void(const Data::WallPaper &)> done,
@@ -360,6 +378,7 @@ public:
 	void shareContact(not_null<UserData*> user, const SendOptions &options);
 	void readServerHistory(not_null<History*> history);
 	void readServerHistoryForce(not_null<History*> history);
+	void flushReadRequests();
 	//void readFeed( // #feed
 	//	not_null<Data::Feed*> feed,
 	//	Data::MessagePosition position);
@@ -502,6 +521,8 @@ private:
 	void requestMoreDialogs(Data::Folder *folder);
 	DialogsLoadState *dialogsLoadState(Data::Folder *folder);
 	void dialogsLoadFinish(Data::Folder *folder);
+	void saveDialogsSnapshot();
+	void confirmDialogsFromSnapshot(const QVector<MTPDialog> &dialogs);
 
 	void checkQuitPreventFinished();
 
@@ -677,6 +698,7 @@ private:
 	void migrateFail(not_null<PeerData*> peer, const RPCError &error);
 
 	void sendDialogRequests();
+	void sendPeerRequests(std::vector<not_null<PeerData*>> &&peers);
 
 	not_null<AuthSession*> _session;
 
@@ -687,6 +709,7 @@ private:
 	using PeerRequests = QMap<PeerData*, mtpRequestId>;
 	PeerRequests _fullPeerRequests;
 	PeerRequests _peerRequests;
+	base::DelayedBatch<not_null<PeerData*>> _peersToRequest;
 
 	PeerRequests _participantsRequests;
 	PeerRequests _botsRequests;
@@ -785,6 +808,9 @@ private:
 	TimeId _dialogsLoadTill = 0;
 	rpl::variable<bool> _dialogsLoadMayBlockByDate = false;
 	rpl::variable<bool> _dialogsLoadBlockedByDate = false;
+	QByteArray _dialogsSnapshotPinned;
+	QByteArray _dialogsSnapshotList;
+	base::flat_map<not_null<History*>, MsgId> _dialogsFromSnapshot;
 
 	base::flat_map<
 		not_null<Data::Folder*>,
@@ -803,6 +829,7 @@ private:
 	};
 	base::flat_map<not_null<PeerData*>, ReadRequest> _readRequests;
 	base::flat_map<not_null<PeerData*>, MsgId> _readRequestsPending;
+	base::Timer _readRequestsTimer;
 
 	std::unique_ptr<TaskQueue> _fileLoader;
 	base::flat_map<uint64, std::shared_ptr<SendingAlbum>> _sendingAlbums;
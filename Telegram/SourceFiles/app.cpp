@@ -415,7 +415,7 @@ namespace App {
 		App::quit();
 	}
 
-	QImage readImage(QByteArray data, QByteArray *format, bool opaque, bool *animated) {
+	QImage readImage(QByteArray data, QByteArray *format, bool opaque, bool *animated, QSize shrinkBox) {
         QByteArray tmpFormat;
 		QImage result;
 		QBuffer buffer(&data);
@@ -430,6 +430,20 @@ namespace App {
 			if (animated) *animated = reader.supportsAnimation() && reader.imageCount() > 1;
 			QByteArray fmt = reader.format();
 			if (!fmt.isEmpty()) *format = fmt;
+#ifndef OS_MAC_OLD
+			if (!shrinkBox.isEmpty()) {
+				// Let the decoder skip the pixels we don't need, for JPEG
+				// libjpeg scales in the DCT domain. The size is given in
+				// the coordinates of the image before the auto transform.
+				const auto size = reader.size();
+				if (reader.transformation() & QImageIOHandler::TransformationRotate90) {
+					shrinkBox.transpose();
+				}
+				if (size.width() > shrinkBox.width() || size.height() > shrinkBox.height()) {
+					reader.setScaledSize(size.scaled(shrinkBox, Qt::KeepAspectRatio));
+				}
+			}
+#endif // OS_MAC_OLD
 			if (!reader.read(&result)) {
 				return QImage();
 			}
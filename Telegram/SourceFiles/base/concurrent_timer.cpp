@@ -7,172 +7,34 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "base/concurrent_timer.h"
 
-#include <QtCore/QThread>
-#include <QtCore/QCoreApplication>
-
-using namespace base::details;
-
 namespace base {
-namespace details {
 namespace {
 
-constexpr auto kCallDelayedEvent = QEvent::Type(QEvent::User + 1);
-constexpr auto kCancelTimerEvent = QEvent::Type(QEvent::User + 2);
-static_assert(kCancelTimerEvent < QEvent::MaxUser);
+// Cancelled deadlines stay in the heap until they're popped, unless
+// there are too many of them.
+constexpr auto kCompactDeadlinesMin = 64;
 
 ConcurrentTimerEnvironment *Environment/* = nullptr*/;
 QMutex EnvironmentMutex;
 
-class CallDelayedEvent : public QEvent {
-public:
-	CallDelayedEvent(
-		crl::time timeout,
-		Qt::TimerType type,
-		FnMut<void()> method);
-
-	crl::time timeout() const;
-	Qt::TimerType type() const;
-	FnMut<void()> takeMethod();
-
-private:
-	crl::time _timeout = 0;
-	Qt::TimerType _type = Qt::PreciseTimer;
-	FnMut<void()> _method;
-
-};
-
-class CancelTimerEvent : public QEvent {
-public:
-	CancelTimerEvent();
-
-};
-
-CallDelayedEvent::CallDelayedEvent(
-	crl::time timeout,
-	Qt::TimerType type,
-	FnMut<void()> method)
-: QEvent(kCallDelayedEvent)
-, _timeout(timeout)
-, _type(type)
-, _method(std::move(method)) {
-	Expects(_timeout >= 0 && _timeout < std::numeric_limits<int>::max());
-}
-
-crl::time CallDelayedEvent::timeout() const {
-	return _timeout;
-}
-
-Qt::TimerType CallDelayedEvent::type() const {
-	return _type;
-}
-
-FnMut<void()> CallDelayedEvent::takeMethod() {
-	return base::take(_method);
-}
-
-CancelTimerEvent::CancelTimerEvent() : QEvent(kCancelTimerEvent) {
-}
-
 } // namespace
 
-class TimerObject : public QObject {
-public:
-	TimerObject(
-		not_null<QThread*> thread,
-		not_null<QObject*> adjuster,
-		Fn<void()> adjust);
-
-protected:
-	bool event(QEvent *e) override;
-
-private:
-	void callDelayed(not_null<CallDelayedEvent*> e);
-	void callNow();
-	void cancel();
-	void adjust();
-
-	FnMut<void()> _next;
-	Fn<void()> _adjust;
-	int _timerId = 0;
-
-};
-
-TimerObject::TimerObject(
-		not_null<QThread*> thread,
-		not_null<QObject*> adjuster,
-		Fn<void()> adjust)
-: _adjust(std::move(adjust)) {
-	moveToThread(thread);
-	connect(
-		adjuster,
-		&QObject::destroyed,
-		this,
-		&TimerObject::adjust,
-		Qt::DirectConnection);
-}
-
-bool TimerObject::event(QEvent *e) {
-	const auto type = e->type();
-	switch (type) {
-	case kCallDelayedEvent:
-		callDelayed(static_cast<CallDelayedEvent*>(e));
-		return true;
-	case kCancelTimerEvent:
-		cancel();
-		return true;
-	case QEvent::Timer:
-		callNow();
-		return true;
-	}
-	return QObject::event(e);
-}
-
-void TimerObject::callDelayed(not_null<CallDelayedEvent*> e) {
-	cancel();
-
-	const auto timeout = e->timeout();
-	const auto type = e->type();
-	_next = e->takeMethod();
-	if (timeout > 0) {
-		_timerId = startTimer(timeout, type);
-	} else {
-		base::take(_next)();
-	}
-}
-
-void TimerObject::cancel() {
-	if (const auto id = base::take(_timerId)) {
-		killTimer(id);
-	}
-	_next = nullptr;
-}
-
-void TimerObject::callNow() {
-	auto next = base::take(_next);
-	cancel();
-	next();
-}
-
-void TimerObject::adjust() {
-	if (_adjust) {
-		_adjust();
-	}
-}
+namespace details {
 
 TimerObjectWrap::TimerObjectWrap(Fn<void()> adjust) {
 	QMutexLocker lock(&EnvironmentMutex);
 
 	if (Environment) {
-		_value = Environment->createTimer(std::move(adjust));
+		_id = Environment->createTimer(std::move(adjust));
 	}
 }
 
 TimerObjectWrap::~TimerObjectWrap() {
-	if (_value) {
+	if (_id) {
 		QMutexLocker lock(&EnvironmentMutex);
 
 		if (Environment) {
-			_value.release()->deleteLater();
+			Environment->destroyTimer(_id);
 		}
 	}
 }
@@ -181,48 +43,153 @@ void TimerObjectWrap::call(
 		crl::time timeout,
 		Qt::TimerType type,
 		FnMut<void()> method) {
-	sendEvent(std::make_unique<CallDelayedEvent>(
-		timeout,
-		type,
-		std::move(method)));
-}
+	if (!_id) {
+		return;
+	} else if (timeout <= 0) {
+		cancel();
+		method();
+		return;
+	}
+	QMutexLocker lock(&EnvironmentMutex);
 
-void TimerObjectWrap::cancel() {
-	sendEvent(std::make_unique<CancelTimerEvent>());
+	if (Environment) {
+		Environment->call(_id, timeout, std::move(method));
+	}
 }
 
-void TimerObjectWrap::sendEvent(std::unique_ptr<QEvent> event) {
-	if (!_value) {
+void TimerObjectWrap::cancel() {
+	if (!_id) {
 		return;
 	}
-	QCoreApplication::postEvent(
-		_value.get(),
-		event.release(),
-		Qt::HighEventPriority);
+	QMutexLocker lock(&EnvironmentMutex);
+
+	if (Environment) {
+		Environment->cancel(_id);
+	}
 }
 
 } // namespace details
 
 ConcurrentTimerEnvironment::ConcurrentTimerEnvironment() {
-	_thread.start();
-	_adjuster.moveToThread(&_thread);
-
 	acquire();
+	_thread = std::thread([=] { run(); });
 }
 
 ConcurrentTimerEnvironment::~ConcurrentTimerEnvironment() {
-	_thread.quit();
 	release();
-	_thread.wait();
-	QObject::disconnect(&_adjuster, &QObject::destroyed, nullptr, nullptr);
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_finishing = true;
+	}
+	_variable.notify_one();
+	_thread.join();
 }
 
-std::unique_ptr<TimerObject> ConcurrentTimerEnvironment::createTimer(
-		Fn<void()> adjust) {
-	return std::make_unique<TimerObject>(
-		&_thread,
-		&_adjuster,
-		std::move(adjust));
+uint64 ConcurrentTimerEnvironment::createTimer(Fn<void()> adjust) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	const auto id = ++_autoincrement;
+	_timers.emplace(id, Timer{ std::move(adjust) });
+	return id;
+}
+
+void ConcurrentTimerEnvironment::destroyTimer(uint64 id) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_timers.remove(id);
+}
+
+void ConcurrentTimerEnvironment::call(
+		uint64 id,
+		crl::time timeout,
+		FnMut<void()> method) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	const auto i = _timers.find(id);
+	if (i == end(_timers)) {
+		return;
+	}
+	auto &timer = i->second;
+	timer.method = std::move(method);
+	const auto when = crl::now() + timeout;
+	const auto nearest = _deadlines.empty()
+		|| (when < _deadlines.front().when);
+	_deadlines.push_back({ when, id, ++timer.generation });
+	std::push_heap(begin(_deadlines), end(_deadlines), Later);
+	if (_deadlines.size() > 2 * _timers.size() + kCompactDeadlinesMin) {
+		compactDeadlines();
+	}
+	lock.unlock();
+
+	if (nearest) {
+		_variable.notify_one();
+	}
+}
+
+void ConcurrentTimerEnvironment::cancel(uint64 id) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	const auto i = _timers.find(id);
+	if (i != end(_timers)) {
+		++i->second.generation;
+		i->second.method = nullptr;
+	}
+}
+
+bool ConcurrentTimerEnvironment::Later(
+		const Deadline &a,
+		const Deadline &b) {
+	return (a.when > b.when);
+}
+
+void ConcurrentTimerEnvironment::compactDeadlines() {
+	_deadlines.erase(ranges::remove_if(_deadlines, [&](
+			const Deadline &deadline) {
+		const auto i = _timers.find(deadline.id);
+		return (i == end(_timers))
+			|| (i->second.generation != deadline.generation);
+	}), end(_deadlines));
+	std::make_heap(begin(_deadlines), end(_deadlines), Later);
+}
+
+void ConcurrentTimerEnvironment::run() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (!_finishing) {
+		if (base::take(_adjusting)) {
+			auto adjust = std::vector<Fn<void()>>();
+			adjust.reserve(_timers.size());
+			for (const auto &[id, timer] : _timers) {
+				if (timer.adjust) {
+					adjust.push_back(timer.adjust);
+				}
+			}
+			lock.unlock();
+			for (const auto &callback : adjust) {
+				callback();
+			}
+			lock.lock();
+			continue;
+		} else if (_deadlines.empty()) {
+			_variable.wait(lock);
+			continue;
+		}
+		const auto now = crl::now();
+		const auto when = _deadlines.front().when;
+		if (when > now) {
+			_variable.wait_for(lock, std::chrono::milliseconds(when - now));
+			continue;
+		}
+		std::pop_heap(begin(_deadlines), end(_deadlines), Later);
+		const auto deadline = _deadlines.back();
+		_deadlines.pop_back();
+
+		const auto i = _timers.find(deadline.id);
+		if (i == end(_timers)
+			|| i->second.generation != deadline.generation
+			|| !i->second.method) {
+			continue;
+		}
+		auto method = base::take(i->second.method);
+		lock.unlock();
+		method();
+		lock.lock();
+	}
 }
 
 void ConcurrentTimerEnvironment::Adjust() {
@@ -233,13 +200,11 @@ void ConcurrentTimerEnvironment::Adjust() {
 }
 
 void ConcurrentTimerEnvironment::adjustTimers() {
-	QObject emitter;
-	QObject::connect(
-		&emitter,
-		&QObject::destroyed,
-		&_adjuster,
-		&QObject::destroyed,
-		Qt::QueuedConnection);
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_adjusting = true;
+	}
+	_variable.notify_one();
 }
 
 void ConcurrentTimerEnvironment::acquire() {
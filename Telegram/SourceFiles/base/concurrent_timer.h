@@ -8,15 +8,18 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "base/binary_guard.h"
+#include "base/flat_map.h"
 #include <crl/crl_time.h>
 #include <crl/crl_object_on_queue.h>
 #include <QtCore/QThread>
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 namespace base {
 namespace details {
 
-class TimerObject;
-
 class TimerObjectWrap {
 public:
 	explicit TimerObjectWrap(Fn<void()> adjust);
@@ -29,30 +32,61 @@ public:
 	void cancel();
 
 private:
-	void sendEvent(std::unique_ptr<QEvent> event);
-
-	std::unique_ptr<TimerObject> _value;
+	uint64 _id = 0;
 
 };
 
 } // namespace details
 
+// All the timers share one thread with a heap of deadlines. The timer
+// methods are called right from that thread and post the callbacks to
+// the timer queues themselves, so no event loop is involved.
 class ConcurrentTimerEnvironment {
 public:
 	ConcurrentTimerEnvironment();
+	ConcurrentTimerEnvironment(
+		const ConcurrentTimerEnvironment &other) = delete;
+	ConcurrentTimerEnvironment &operator=(
+		const ConcurrentTimerEnvironment &other) = delete;
 	~ConcurrentTimerEnvironment();
 
-	std::unique_ptr<details::TimerObject> createTimer(Fn<void()> adjust);
+	[[nodiscard]] uint64 createTimer(Fn<void()> adjust);
+	void destroyTimer(uint64 id);
+	void call(uint64 id, crl::time timeout, FnMut<void()> method);
+	void cancel(uint64 id);
 
 	static void Adjust();
 
 private:
+	struct Timer {
+		Fn<void()> adjust;
+		FnMut<void()> method;
+		uint64 generation = 0;
+	};
+	struct Deadline {
+		crl::time when = 0;
+		uint64 id = 0;
+		uint64 generation = 0;
+	};
+
+	static bool Later(const Deadline &a, const Deadline &b);
+
 	void acquire();
 	void release();
 	void adjustTimers();
-
-	QThread _thread;
-	QObject _adjuster;
+	void compactDeadlines();
+
+	// Timer thread.
+	void run();
+
+	std::mutex _mutex;
+	std::condition_variable _variable;
+	base::flat_map<uint64, Timer> _timers;
+	std::vector<Deadline> _deadlines; // Heap with the nearest one on top.
+	uint64 _autoincrement = 0;
+	bool _adjusting = false;
+	bool _finishing = false;
+	std::thread _thread;
 
 };
 
@@ -0,0 +1,87 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/flat_set.h"
+#include "base/timer.h"
+
+namespace base {
+
+// Collects keys for one request method and passes them to the sender
+// in batches of at most "limit" keys, not later than "delay" after the
+// first of them was added.
+template <typename Key>
+class DelayedBatch final {
+public:
+	using Sender = Fn<void(std::vector<Key> &&keys)>;
+
+	DelayedBatch(crl::time delay, int limit, Sender sender);
+
+	// Returns false if the key is already waiting.
+	bool add(const Key &key);
+	void remove(const Key &key);
+	[[nodiscard]] bool contains(const Key &key) const;
+
+	void send();
+
+private:
+	const crl::time _delay = 0;
+	const int _limit = 0;
+	Sender _sender;
+	base::flat_set<Key> _keys;
+	Timer _timer;
+
+};
+
+template <typename Key>
+DelayedBatch<Key>::DelayedBatch(crl::time delay, int limit, Sender sender)
+: _delay(delay)
+, _limit(limit)
+, _sender(std::move(sender))
+, _timer([=] { send(); }) {
+	Expects(_limit > 0);
+}
+
+template <typename Key>
+bool DelayedBatch<Key>::add(const Key &key) {
+	if (!_keys.emplace(key).second) {
+		return false;
+	} else if (int(_keys.size()) >= _limit) {
+		send();
+	} else if (!_timer.isActive()) {
+		_timer.callOnce(_delay);
+	}
+	return true;
+}
+
+template <typename Key>
+void DelayedBatch<Key>::remove(const Key &key) {
+	_keys.remove(key);
+	if (_keys.empty()) {
+		_timer.cancel();
+	}
+}
+
+template <typename Key>
+bool DelayedBatch<Key>::contains(const Key &key) const {
+	return _keys.contains(key);
+}
+
+template <typename Key>
+void DelayedBatch<Key>::send() {
+	_timer.cancel();
+	auto keys = base::take(_keys);
+	for (auto from = keys.begin(); from != keys.end();) {
+		const auto left = int(keys.end() - from);
+		const auto till = from + std::min(left, _limit);
+		_sender(std::vector<Key>(from, till));
+		from = till;
+	}
+}
+
+} // namespace base
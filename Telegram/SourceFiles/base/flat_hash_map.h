@@ -0,0 +1,378 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/flat_map.h"
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace base {
+
+template <
+	typename Key,
+	typename Type,
+	typename Hash = std::hash<Key>>
+class flat_hash_map;
+
+template <typename Map, typename Pair>
+class flat_hash_map_iterator {
+public:
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = std::remove_const_t<Pair>;
+	using difference_type = std::ptrdiff_t;
+	using pointer = Pair*;
+	using reference = Pair&;
+
+	flat_hash_map_iterator() = default;
+	template <
+		typename OtherMap,
+		typename OtherPair,
+		typename = std::enable_if_t<
+			std::is_convertible_v<OtherMap*, Map*>>>
+	flat_hash_map_iterator(
+		const flat_hash_map_iterator<OtherMap, OtherPair> &other)
+	: _map(other._map)
+	, _index(other._index) {
+	}
+
+	reference operator*() const {
+		return _map->slot(_index);
+	}
+	pointer operator->() const {
+		return std::addressof(**this);
+	}
+	flat_hash_map_iterator &operator++() {
+		_index = _map->next(_index + 1);
+		return *this;
+	}
+	flat_hash_map_iterator operator++(int) {
+		auto result = *this;
+		++*this;
+		return result;
+	}
+
+	template <typename OtherMap, typename OtherPair>
+	bool operator==(
+			const flat_hash_map_iterator<OtherMap, OtherPair> &other) const {
+		return (_index == other._index);
+	}
+	template <typename OtherMap, typename OtherPair>
+	bool operator!=(
+			const flat_hash_map_iterator<OtherMap, OtherPair> &other) const {
+		return !(*this == other);
+	}
+
+private:
+	template <typename OtherMap, typename OtherPair>
+	friend class flat_hash_map_iterator;
+
+	template <typename OtherKey, typename OtherType, typename OtherHash>
+	friend class flat_hash_map;
+
+	flat_hash_map_iterator(Map *map, std::size_t index)
+	: _map(map)
+	, _index(index) {
+	}
+
+	Map *_map = nullptr;
+	std::size_t _index = 0;
+
+};
+
+// Open addressing with linear probing, all the entries are kept in one
+// array without an allocation for each of them. A control byte for each
+// slot keeps seven bits of the hash, so most of the slots in a probe
+// sequence are skipped without comparing the keys.
+//
+// Unlike std::unordered_map any insertion may move the entries, so only
+// the iterators and references obtained after the last insertion are
+// valid. Erasing doesn't move other entries.
+template <typename Key, typename Type, typename Hash>
+class flat_hash_map {
+public:
+	using key_type = Key;
+	using mapped_type = Type;
+	using value_type = flat_multi_map_pair_type<Key, Type>;
+	using size_type = std::size_t;
+	using iterator = flat_hash_map_iterator<flat_hash_map, value_type>;
+	using const_iterator = flat_hash_map_iterator<
+		const flat_hash_map,
+		const value_type>;
+
+	flat_hash_map() = default;
+	flat_hash_map(std::initializer_list<std::pair<Key, Type>> list) {
+		reserve(list.size());
+		for (const auto &[key, value] : list) {
+			emplace(key, value);
+		}
+	}
+	flat_hash_map(const flat_hash_map &other) {
+		*this = other;
+	}
+	flat_hash_map(flat_hash_map &&other) noexcept {
+		*this = std::move(other);
+	}
+	flat_hash_map &operator=(const flat_hash_map &other) {
+		if (this != &other) {
+			clear();
+			reserve(other.size());
+			for (const auto &[key, value] : other) {
+				emplace(key, value);
+			}
+		}
+		return *this;
+	}
+	flat_hash_map &operator=(flat_hash_map &&other) noexcept {
+		if (this != &other) {
+			destroy();
+			_control = std::move(other._control);
+			_slots = std::move(other._slots);
+			_capacity = std::exchange(other._capacity, 0);
+			_shift = std::exchange(other._shift, 0);
+			_size = std::exchange(other._size, 0);
+			_used = std::exchange(other._used, 0);
+		}
+		return *this;
+	}
+	~flat_hash_map() {
+		destroy();
+	}
+
+	size_type size() const {
+		return _size;
+	}
+	bool empty() const {
+		return !_size;
+	}
+
+	iterator begin() {
+		return iterator(this, next(0));
+	}
+	iterator end() {
+		return iterator(this, _capacity);
+	}
+	const_iterator begin() const {
+		return const_iterator(this, next(0));
+	}
+	const_iterator end() const {
+		return const_iterator(this, _capacity);
+	}
+	const_iterator cbegin() const {
+		return begin();
+	}
+	const_iterator cend() const {
+		return end();
+	}
+
+	iterator find(const Key &key) {
+		return iterator(this, lookup(key));
+	}
+	const_iterator find(const Key &key) const {
+		return const_iterator(this, lookup(key));
+	}
+	bool contains(const Key &key) const {
+		return (lookup(key) != _capacity);
+	}
+
+	template <typename... Args>
+	std::pair<iterator, bool> emplace(Key key, Args&&... args) {
+		if (const auto index = lookup(key); index != _capacity) {
+			return { iterator(this, index), false };
+		}
+		if (_used + 1 > MaxUsed(_capacity)) {
+			grow();
+		}
+		const auto mixed = Mix(key);
+		const auto index = free(mixed);
+		new (&_slots[index]) value_type(
+			std::move(key),
+			Type(std::forward<Args>(args)...));
+		if (_control[index] == kEmpty) {
+			++_used;
+		}
+		_control[index] = Tag(mixed);
+		++_size;
+		return { iterator(this, index), true };
+	}
+	Type &operator[](const Key &key) {
+		return emplace(key).first->second;
+	}
+
+	iterator erase(const_iterator where) {
+		remove(where._index);
+		return iterator(this, next(where._index + 1));
+	}
+	iterator erase(iterator where) {
+		return erase(const_iterator(where));
+	}
+	size_type erase(const Key &key) {
+		const auto index = lookup(key);
+		if (index == _capacity) {
+			return 0;
+		}
+		remove(index);
+		return 1;
+	}
+
+	void clear() {
+		destroy();
+		if (_capacity) {
+			std::memset(_control.get(), kEmpty, _capacity);
+		}
+		_size = _used = 0;
+	}
+	void reserve(size_type count) {
+		if (count > MaxUsed(_capacity)) {
+			rehash(CapacityFor(count));
+		}
+	}
+
+private:
+	template <typename OtherMap, typename OtherPair>
+	friend class flat_hash_map_iterator;
+
+	using slot_type = std::aligned_storage_t<
+		sizeof(value_type),
+		alignof(value_type)>;
+
+	static constexpr auto kEmpty = std::uint8_t(0x00);
+	static constexpr auto kDeleted = std::uint8_t(0x01);
+	static constexpr auto kFull = std::uint8_t(0x80);
+	static constexpr auto kMinCapacity = size_type(8);
+
+	static std::uint64_t Mix(const Key &key) {
+		return std::uint64_t(Hash()(key)) * 0x9E3779B97F4A7C15ULL;
+	}
+	static std::uint8_t Tag(std::uint64_t mixed) {
+		return kFull | std::uint8_t((mixed >> 16) & 0x7F);
+	}
+	static size_type MaxUsed(size_type capacity) {
+		return capacity - capacity / 4;
+	}
+	static size_type CapacityFor(size_type count) {
+		auto result = kMinCapacity;
+		while (MaxUsed(result) < count) {
+			result *= 2;
+		}
+		return result;
+	}
+
+	value_type &slot(size_type index) {
+		return *std::launder(reinterpret_cast<value_type*>(&_slots[index]));
+	}
+	const value_type &slot(size_type index) const {
+		return *std::launder(
+			reinterpret_cast<const value_type*>(&_slots[index]));
+	}
+	size_type start(std::uint64_t mixed) const {
+		return size_type(mixed >> (64 - _shift));
+	}
+	size_type next(size_type index) const {
+		while (index < _capacity && !(_control[index] & kFull)) {
+			++index;
+		}
+		return (index < _capacity) ? index : _capacity;
+	}
+
+	size_type lookup(const Key &key) const {
+		if (!_size) {
+			return _capacity;
+		}
+		const auto mixed = Mix(key);
+		const auto tag = Tag(mixed);
+		const auto mask = _capacity - 1;
+		for (auto index = start(mixed);; index = (index + 1) & mask) {
+			const auto control = _control[index];
+			if (control == kEmpty) {
+				return _capacity;
+			} else if (control == tag && slot(index).first == key) {
+				return index;
+			}
+		}
+	}
+	size_type free(std::uint64_t mixed) const {
+		const auto mask = _capacity - 1;
+		auto index = start(mixed);
+		while (_control[index] & kFull) {
+			index = (index + 1) & mask;
+		}
+		return index;
+	}
+
+	void remove(size_type index) {
+		slot(index).~value_type();
+		--_size;
+
+		// Nothing is probed through the slot if the next one is empty.
+		const auto following = (index + 1) & (_capacity - 1);
+		if (_control[following] == kEmpty) {
+			_control[index] = kEmpty;
+			--_used;
+		} else {
+			_control[index] = kDeleted;
+		}
+	}
+	void grow() {
+		// Drop the deleted slots without growing if they take enough.
+		rehash((_size + 1 > MaxUsed(_capacity) / 2)
+			? CapacityFor(_size + 1)
+			: _capacity);
+	}
+	void rehash(size_type capacity) {
+		auto control = std::make_unique<std::uint8_t[]>(capacity);
+		auto slots = std::make_unique<slot_type[]>(capacity);
+		std::memset(control.get(), kEmpty, capacity);
+		std::swap(_control, control);
+		std::swap(_slots, slots);
+		const auto was = std::exchange(_capacity, capacity);
+		_shift = 0;
+		while ((size_type(1) << _shift) < capacity) {
+			++_shift;
+		}
+		_used = _size;
+		for (auto index = size_type(); index != was; ++index) {
+			if (!(control[index] & kFull)) {
+				continue;
+			}
+			auto &entry = *std::launder(
+				reinterpret_cast<value_type*>(&slots[index]));
+			const auto mixed = Mix(entry.first);
+			const auto now = free(mixed);
+			new (&_slots[now]) value_type(std::move(entry));
+			_control[now] = Tag(mixed);
+			entry.~value_type();
+		}
+	}
+	void destroy() {
+		if (!std::is_trivially_destructible_v<value_type>) {
+			for (auto index = size_type(); index != _capacity; ++index) {
+				if (_control[index] & kFull) {
+					slot(index).~value_type();
+				}
+			}
+		}
+	}
+
+	std::unique_ptr<std::uint8_t[]> _control;
+	std::unique_ptr<slot_type[]> _slots;
+	size_type _capacity = 0;
+	size_type _shift = 0;
+	size_type _size = 0;
+
+	// Full and deleted slots count.
+	size_type _used = 0;
+
+};
+
+} // namespace base
@@ -0,0 +1,157 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "base/flat_hash_map.h"
+#include <memory>
+#include <string>
+
+using namespace std;
+
+TEST_CASE("flat_hash_maps should find added items", "[flat_hash_map]") {
+	base::flat_hash_map<int, string> v;
+	REQUIRE(v.empty());
+	REQUIRE(v.find(0) == v.end());
+	REQUIRE(v.begin() == v.end());
+
+	v.emplace(0, "a");
+	v.emplace(5, "b");
+	v.emplace(4, "d");
+	v.emplace(2, "e");
+	REQUIRE(v.size() == 4);
+	REQUIRE(v.find(5) != v.end());
+	REQUIRE(v.find(5)->second == "b");
+	REQUIRE(v.find(3) == v.end());
+
+	SECTION("adding existing key keeps the value") {
+		const auto [i, ok] = v.emplace(4, "c");
+		REQUIRE(!ok);
+		REQUIRE(i->second == "d");
+		REQUIRE(v.size() == 4);
+	}
+
+	SECTION("subscript operator adds default value") {
+		REQUIRE(v[1].empty());
+		REQUIRE(v.size() == 5);
+		v[1] = "f";
+		REQUIRE(v.find(1)->second == "f");
+	}
+
+	SECTION("erasing by key") {
+		REQUIRE(v.erase(4) == 1);
+		REQUIRE(v.erase(4) == 0);
+		REQUIRE(v.size() == 3);
+		REQUIRE(v.find(4) == v.end());
+		REQUIRE(v.find(2) != v.end());
+	}
+
+	SECTION("iteration visits all items once") {
+		auto sum = 0;
+		auto count = 0;
+		for (const auto &[key, value] : v) {
+			sum += key;
+			++count;
+		}
+		REQUIRE(count == 4);
+		REQUIRE(sum == 11);
+	}
+}
+
+TEST_CASE("flat_hash_maps should keep many items", "[flat_hash_map]") {
+	base::flat_hash_map<uint64_t, int> v;
+	const auto kCount = 10000;
+	for (auto i = 0; i != kCount; ++i) {
+		v.emplace(uint64_t(i) << 32, i);
+	}
+	REQUIRE(v.size() == kCount);
+	for (auto i = 0; i != kCount; ++i) {
+		const auto j = v.find(uint64_t(i) << 32);
+		REQUIRE(j != v.end());
+		REQUIRE(j->second == i);
+	}
+
+	SECTION("erasing while iterating") {
+		for (auto i = v.begin(); i != v.end();) {
+			if (i->second % 2) {
+				i = v.erase(i);
+			} else {
+				++i;
+			}
+		}
+		REQUIRE(v.size() == kCount / 2);
+		for (auto i = 0; i != kCount; ++i) {
+			const auto found = (v.find(uint64_t(i) << 32) != v.end());
+			REQUIRE(found == !(i % 2));
+		}
+	}
+
+	SECTION("adding after erasing reuses the slots") {
+		for (auto round = 0; round != 10; ++round) {
+			for (auto i = 0; i != kCount; ++i) {
+				v.erase(uint64_t(i) << 32);
+				v.emplace(uint64_t(i + kCount) << 32, i);
+			}
+			for (auto i = 0; i != kCount; ++i) {
+				v.erase(uint64_t(i + kCount) << 32);
+				v.emplace(uint64_t(i) << 32, i);
+			}
+		}
+		REQUIRE(v.size() == kCount);
+		REQUIRE(v.find(uint64_t(kCount) << 32) == v.end());
+		REQUIRE(v.find(uint64_t(kCount - 1) << 32)->second == kCount - 1);
+	}
+
+	SECTION("clear") {
+		v.clear();
+		REQUIRE(v.empty());
+		REQUIRE(v.begin() == v.end());
+		REQUIRE(v.find(0) == v.end());
+		v.emplace(0, 1);
+		REQUIRE(v.find(0)->second == 1);
+	}
+}
+
+TEST_CASE("simple flat_hash_maps tests", "[flat_hash_map]") {
+	SECTION("copy constructor") {
+		base::flat_hash_map<int, string> v;
+		v.emplace(0, "a");
+		v.emplace(2, "b");
+		auto u = v;
+		REQUIRE(u.size() == 2);
+		REQUIRE(u.find(0)->second == "a");
+		REQUIRE(u.find(2)->second == "b");
+	}
+	SECTION("move constructor") {
+		base::flat_hash_map<int, unique_ptr<int>> v;
+		v.emplace(0, make_unique<int>(1));
+		const auto pointer = v.find(0)->second.get();
+		auto u = std::move(v);
+		REQUIRE(v.empty());
+		REQUIRE(u.size() == 1);
+		REQUIRE(u.find(0)->second.get() == pointer);
+	}
+	SECTION("values are kept while growing") {
+		base::flat_hash_map<int, unique_ptr<int>> v;
+		v.emplace(0, make_unique<int>(1));
+		const auto pointer = v.find(0)->second.get();
+		for (auto i = 1; i != 100; ++i) {
+			v.emplace(i, make_unique<int>(i + 1));
+		}
+		REQUIRE(v.find(0)->second.get() == pointer);
+		REQUIRE(*v.find(99)->second == 100);
+	}
+	SECTION("const iterators") {
+		base::flat_hash_map<int, string> v;
+		v.emplace(1, "a");
+		const auto &c = v;
+		base::flat_hash_map<int, string>::const_iterator i = v.find(1);
+		REQUIRE(i == c.find(1));
+		REQUIRE(c.find(2) == v.end());
+		REQUIRE(i->second == "a");
+	}
+}
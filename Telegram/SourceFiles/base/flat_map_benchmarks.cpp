@@ -0,0 +1,157 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "base/flat_map.h"
+#include "base/flat_hash_map.h"
+
+#include <map>
+#include <unordered_map>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+namespace {
+
+// Every measurement is repeated and the median is reported,
+// the keys are generated with a fixed seed, so runs are comparable.
+constexpr auto kRepeats = 5;
+constexpr auto kSeed = 20190101U;
+
+// Random inserts and erases in flat_map move half of the elements,
+// they are skipped above this size to keep the run time reasonable.
+constexpr auto kFlatRandomLimit = 100'000;
+
+using Key = unsigned long long; // Like PeerId or DocumentId.
+using Value = void*;
+
+using Clock = std::chrono::steady_clock;
+using Nanoseconds = std::chrono::nanoseconds;
+
+const auto Sizes = std::vector<int>{ 10, 100, 1'000, 10'000, 100'000, 1'000'000 };
+
+struct Keys {
+	std::vector<Key> insert;
+	std::vector<Key> find;
+	std::vector<Key> erase;
+};
+
+Keys GenerateKeys(int count, bool sorted) {
+	auto engine = std::mt19937_64(kSeed + count);
+	auto result = Keys();
+	result.insert.reserve(count);
+	for (auto i = 0; i != count; ++i) {
+		result.insert.push_back(engine());
+	}
+	std::sort(begin(result.insert), end(result.insert));
+	result.insert.erase(
+		std::unique(begin(result.insert), end(result.insert)),
+		end(result.insert));
+	result.find = result.insert;
+	std::shuffle(begin(result.find), end(result.find), engine);
+	result.erase = result.insert;
+	if (!sorted) {
+		std::shuffle(begin(result.insert), end(result.insert), engine);
+		std::shuffle(begin(result.erase), end(result.erase), engine);
+	}
+	return result;
+}
+
+double Median(std::vector<double> values) {
+	std::sort(begin(values), end(values));
+	return values[values.size() / 2];
+}
+
+struct Result {
+	double insert = 0.;
+	double find = 0.;
+	double erase = 0.;
+};
+
+template <typename Map>
+Result Measure(const Keys &keys) {
+	const auto count = double(keys.insert.size());
+	const auto elapsed = [&](Clock::time_point start) {
+		return std::chrono::duration_cast<Nanoseconds>(
+			Clock::now() - start).count() / count;
+	};
+	auto insert = std::vector<double>();
+	auto find = std::vector<double>();
+	auto erase = std::vector<double>();
+	for (auto i = 0; i != kRepeats; ++i) {
+		auto map = Map();
+
+		auto start = Clock::now();
+		for (const auto key : keys.insert) {
+			map[key] = nullptr;
+		}
+		insert.push_back(elapsed(start));
+
+		auto found = 0;
+		start = Clock::now();
+		for (const auto key : keys.find) {
+			found += (map.find(key) != map.end()) ? 1 : 0;
+		}
+		find.push_back(elapsed(start));
+		REQUIRE(found == int(keys.find.size()));
+
+		start = Clock::now();
+		for (const auto key : keys.erase) {
+			map.erase(key);
+		}
+		erase.push_back(elapsed(start));
+		REQUIRE(map.empty());
+	}
+	return { Median(insert), Median(find), Median(erase) };
+}
+
+void Report(const std::string &title, int count, const Result &result) {
+	std::cout
+		<< std::setw(24) << std::left << title
+		<< std::setw(9) << std::right << count
+		<< std::fixed << std::setprecision(1)
+		<< std::setw(10) << result.insert << " ns insert"
+		<< std::setw(10) << result.find << " ns find"
+		<< std::setw(10) << result.erase << " ns erase"
+		<< std::endl;
+}
+
+void Benchmark(bool sorted) {
+	std::cout
+		<< (sorted ? "Sorted" : "Random")
+		<< " insert and erase order, per operation, median of "
+		<< kRepeats << ":" << std::endl;
+	for (const auto size : Sizes) {
+		const auto keys = GenerateKeys(size, sorted);
+		Report("std::map", size, Measure<std::map<Key, Value>>(keys));
+		Report(
+			"std::unordered_map",
+			size,
+			Measure<std::unordered_map<Key, Value>>(keys));
+		if (sorted || size <= kFlatRandomLimit) {
+			Report(
+				"base::flat_map",
+				size,
+				Measure<base::flat_map<Key, Value>>(keys));
+		}
+		Report(
+			"base::flat_hash_map",
+			size,
+			Measure<base::flat_hash_map<Key, Value>>(keys));
+	}
+}
+
+} // namespace
+
+TEST_CASE("maps benchmark", "[benchmark]") {
+	Benchmark(true);
+	Benchmark(false);
+}
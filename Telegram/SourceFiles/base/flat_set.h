@@ -396,8 +396,20 @@ public:
 		typename Iterator,
 		typename = typename std::iterator_traits<Iterator>::iterator_category>
 	void merge(Iterator first, Iterator last) {
+		// Only the added items are sorted, they're merged in linear time.
+		const auto was = impl().size();
 		impl().insert(impl().end(), first, last);
-		std::sort(std::begin(impl()), std::end(impl()), compare());
+		const auto from = std::begin(impl());
+		const auto middle = from + was;
+		const auto till = std::end(impl());
+		if (!std::is_sorted(middle, till, compare())) {
+			std::sort(middle, till, compare());
+		}
+		if (from != middle
+			&& middle != till
+			&& compare()(*middle, *(middle - 1))) {
+			std::inplace_merge(from, middle, till, compare());
+		}
 	}
 
 	void merge(const flat_multi_set<Type, Compare> &other) {
@@ -54,6 +54,23 @@ TEST_CASE("flat_sets should keep items sorted", "[flat_set]") {
 		REQUIRE(v.find(3) != v.end());
 		checkSorted();
 	}
+
+	SECTION("merging items keeps them sorted and unique") {
+		const auto more = { 7, 1, 4, 6, 1 };
+		v.merge(more.begin(), more.end());
+		REQUIRE(v.size() == 7);
+		REQUIRE(v.contains(1));
+		REQUIRE(v.contains(6));
+		REQUIRE(v.contains(7));
+		checkSorted();
+	}
+
+	SECTION("merging items after the last one appends them") {
+		v.merge({ 6, 8, 10 });
+		REQUIRE(v.size() == 7);
+		REQUIRE(v.back() == 10);
+		checkSorted();
+	}
 }
 
 TEST_CASE("flat_sets with custom comparators", "[flat_set]") {
@@ -0,0 +1,139 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "base/memory_usage.h"
+
+#include <QtCore/QMutex>
+#include <QtCore/QStringList>
+
+#include <array>
+#include <atomic>
+
+namespace base {
+namespace memory {
+namespace {
+
+struct Counter {
+	std::atomic<int64> bytes = 0;
+	std::atomic<int64> peak = 0;
+};
+
+// Each subsystem either supports a trim or explains why it doesn't.
+struct Description {
+	const char *name = nullptr;
+	const char *trim = nullptr;
+	const char *noTrimReason = nullptr;
+};
+
+const auto kDescriptions = std::array<Description, kTagsCount>{ {
+	{ "Images", "unload decoded images, they are decoded again on paint" },
+	{ "Documents", "unload file contents and sticker images" },
+	{ "Lottie frames", nullptr, "freed with their animations" },
+	{ "Lottie caches", "drop caches of hidden animations and covers" },
+	{
+		"Streaming slices",
+		nullptr,
+		"unused slices go to the disk cache while playing",
+	},
+	{ "Emoji sprites", "drop sprites, they are read from the disk cache" },
+	{ "History elements", "unload heavy parts of message views" },
+	{ "Text blocks", nullptr, "freed with their texts" },
+} };
+
+std::array<Counter, kTagsCount> Counters;
+
+struct Trims {
+	QMutex mutex;
+	std::array<Fn<void()>, kTagsCount> callbacks;
+};
+
+Trims &GetTrims() {
+	static Trims result;
+	return result;
+}
+
+int Index(Tag tag) {
+	return static_cast<int>(tag);
+}
+
+QString FormatMegabytes(int64 bytes) {
+	return QString::number(bytes / (1024. * 1024.), 'f', 1) + " MB";
+}
+
+} // namespace
+
+void Allocated(Tag tag, int64 bytes) {
+	auto &counter = Counters[Index(tag)];
+	const auto now = counter.bytes.fetch_add(
+		bytes,
+		std::memory_order_relaxed) + bytes;
+	auto peak = counter.peak.load(std::memory_order_relaxed);
+	while (now > peak && !counter.peak.compare_exchange_weak(
+		peak,
+		now,
+		std::memory_order_relaxed)) {
+	}
+}
+
+void Freed(Tag tag, int64 bytes) {
+	Counters[Index(tag)].bytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void SetTrim(Tag tag, Fn<void()> callback) {
+	auto &trims = GetTrims();
+	QMutexLocker lock(&trims.mutex);
+	trims.callbacks[Index(tag)] = std::move(callback);
+}
+
+void TrimAll() {
+	auto callbacks = std::array<Fn<void()>, kTagsCount>();
+	{
+		auto &trims = GetTrims();
+		QMutexLocker lock(&trims.mutex);
+		callbacks = trims.callbacks;
+	}
+	for (const auto &callback : callbacks) {
+		if (callback) {
+			callback();
+		}
+	}
+}
+
+QString Report() {
+	auto available = std::array<bool, kTagsCount>();
+	{
+		auto &trims = GetTrims();
+		QMutexLocker lock(&trims.mutex);
+		for (auto i = 0; i != kTagsCount; ++i) {
+			available[i] = (trims.callbacks[i] != nullptr);
+		}
+	}
+	auto result = QStringList();
+	auto total = int64();
+	for (auto i = 0; i != kTagsCount; ++i) {
+		const auto &counter = Counters[i];
+		const auto &description = kDescriptions[i];
+		const auto bytes = counter.bytes.load(std::memory_order_relaxed);
+		const auto peak = counter.peak.load(std::memory_order_relaxed);
+		const auto trim = !description.trim
+			? QString("none, ") + description.noTrimReason
+			: available[i]
+			? QString(description.trim)
+			: QString(description.trim) + " (not available now)";
+		result.push_back(QString("%1: %2, peak %3\nTrim: %4"
+		).arg(description.name
+		).arg(FormatMegabytes(bytes)
+		).arg(FormatMegabytes(peak)
+		).arg(trim));
+		total += bytes;
+	}
+	result.push_back("Total: " + FormatMegabytes(total));
+	return result.join("\n\n");
+}
+
+} // namespace memory
+} // namespace base
@@ -0,0 +1,46 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/basic_types.h"
+
+namespace base {
+namespace memory {
+
+// Large memory consumers count what they hold, so the report shows
+// which of them takes the memory. Counters are atomic, recording doesn't
+// take any locks. Only the pixel and byte buffers or the objects that
+// the subsystem keeps are counted, not the heap overhead around them.
+enum class Tag {
+	Images,
+	Documents,
+	LottieFrames,
+	LottieCaches,
+	StreamingSlices,
+	EmojiSprites,
+	HistoryElements,
+	TextBlocks,
+};
+constexpr auto kTagsCount = 8;
+
+// Any thread.
+void Allocated(Tag tag, int64 bytes);
+void Freed(Tag tag, int64 bytes);
+
+// Any thread, an empty callback removes the trim.
+// The callback is always invoked from the main thread.
+void SetTrim(Tag tag, Fn<void()> callback);
+
+// Main thread.
+void TrimAll();
+
+// Each subsystem with its current and peak usage and the trim it supports.
+[[nodiscard]] QString Report();
+
+} // namespace memory
+} // namespace base
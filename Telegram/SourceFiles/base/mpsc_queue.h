@@ -0,0 +1,73 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+namespace base {
+
+// Multiple producers push without locks, a single consumer takes
+// everything pushed so far at once, in the order of pushing.
+template <typename Type>
+class mpsc_queue {
+public:
+	mpsc_queue() = default;
+	mpsc_queue(const mpsc_queue &other) = delete;
+	mpsc_queue &operator=(const mpsc_queue &other) = delete;
+	~mpsc_queue() {
+		destroy(_head.exchange(nullptr, std::memory_order_acquire));
+	}
+
+	// Any thread.
+	void push(Type &&value) {
+		const auto added = new node{ std::move(value) };
+		auto head = _head.load(std::memory_order_relaxed);
+		do {
+			added->next = head;
+		} while (!_head.compare_exchange_weak(
+			head,
+			added,
+			std::memory_order_release,
+			std::memory_order_relaxed));
+	}
+	[[nodiscard]] bool empty() const {
+		return !_head.load(std::memory_order_acquire);
+	}
+
+	// Consumer thread.
+	[[nodiscard]] std::vector<Type> take() {
+		auto result = std::vector<Type>();
+		auto head = _head.exchange(nullptr, std::memory_order_acquire);
+		for (auto i = head; i != nullptr; i = i->next) {
+			result.push_back(std::move(i->value));
+		}
+		destroy(head);
+		std::reverse(begin(result), end(result));
+		return result;
+	}
+
+private:
+	struct node {
+		Type value;
+		node *next = nullptr;
+	};
+
+	static void destroy(node *head) {
+		while (head) {
+			delete std::exchange(head, head->next);
+		}
+	}
+
+	std::atomic<node*> _head = nullptr;
+
+};
+
+} // namespace base
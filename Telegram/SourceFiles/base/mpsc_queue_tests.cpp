@@ -0,0 +1,77 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "base/mpsc_queue.h"
+#include <memory>
+#include <thread>
+
+TEST_CASE("mpsc_queue keeps pushing order", "[mpsc_queue]") {
+	base::mpsc_queue<int> queue;
+	REQUIRE(queue.empty());
+	REQUIRE(queue.take().empty());
+
+	queue.push(1);
+	queue.push(2);
+	queue.push(3);
+	REQUIRE(!queue.empty());
+	REQUIRE(queue.take() == std::vector<int>{ 1, 2, 3 });
+	REQUIRE(queue.empty());
+
+	queue.push(4);
+	REQUIRE(queue.take() == std::vector<int>{ 4 });
+}
+
+TEST_CASE("mpsc_queue moves values", "[mpsc_queue]") {
+	base::mpsc_queue<std::unique_ptr<int>> queue;
+	queue.push(std::make_unique<int>(5));
+	queue.push(std::make_unique<int>(6));
+
+	const auto values = queue.take();
+	REQUIRE(values.size() == 2);
+	REQUIRE(*values[0] == 5);
+	REQUIRE(*values[1] == 6);
+
+	// Not taken values are destroyed with the queue.
+	queue.push(std::make_unique<int>(7));
+}
+
+TEST_CASE("mpsc_queue with many producers", "[mpsc_queue]") {
+	constexpr auto kProducers = 4;
+	constexpr auto kValues = 10000;
+
+	base::mpsc_queue<int> queue;
+	auto producers = std::vector<std::thread>();
+	for (auto i = 0; i != kProducers; ++i) {
+		producers.emplace_back([&queue, i] {
+			for (auto j = 0; j != kValues; ++j) {
+				queue.push(i * kValues + j);
+			}
+		});
+	}
+
+	auto last = std::vector<int>(kProducers, -1);
+	auto received = 0;
+	const auto check = [&] {
+		for (const auto value : queue.take()) {
+			const auto producer = value / kValues;
+			REQUIRE(value % kValues == last[producer] + 1);
+			last[producer] = value % kValues;
+			++received;
+		}
+	};
+	while (received < kProducers * kValues) {
+		check();
+	}
+	for (auto &producer : producers) {
+		producer.join();
+	}
+	check();
+	REQUIRE(received == kProducers * kValues);
+	REQUIRE(queue.empty());
+}
@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <deque>
 #include <rpl/producer.h>
 #include "base/type_traits.h"
+#include "base/flat_map.h"
 
 namespace base {
 namespace internal {
@@ -33,6 +34,34 @@ struct SubscriptionHandlerHelper<void> {
 template <typename EventType>
 using SubscriptionHandler = typename SubscriptionHandlerHelper<EventType>::type;
 
+// Event types that provide (through ADL):
+//   Key observable_event_key(const EventType &event);
+//   void merge_observable_event(EventType &to, const EventType &from);
+// are coalesced while waiting for the async notification, so every
+// subscriber gets one event per key per tick instead of one per notify().
+template <typename EventType, typename = void>
+struct MergeableEventHelper {
+	static constexpr auto value = false;
+	struct Pending {
+		void clear() {
+		}
+	};
+};
+
+template <typename EventType>
+struct MergeableEventHelper<
+	EventType,
+	std::void_t<
+		decltype(observable_event_key(std::declval<const EventType&>())),
+		decltype(merge_observable_event(
+			std::declval<EventType&>(),
+			std::declval<const EventType&>()))>> {
+	static constexpr auto value = true;
+	using Key = std::decay_t<
+		decltype(observable_event_key(std::declval<const EventType&>()))>;
+	using Pending = base::flat_map<Key, int>;
+};
+
 class BaseObservableData {
 };
 
@@ -263,6 +292,15 @@ public:
 			if (_events.empty()) {
 				RegisterPendingObservable(&this->_callHandlers);
 			}
+			if constexpr (Mergeable::value) {
+				const auto key = observable_event_key(event);
+				const auto i = _pending.find(key);
+				if (i != end(_pending)) {
+					merge_observable_event(_events[i->second], event);
+					return;
+				}
+				_pending.emplace(key, int(_events.size()));
+			}
 			_events.push_back(std::move(event));
 		}
 	}
@@ -275,6 +313,7 @@ private:
 	void callHandlers() {
 		_handling = true;
 		auto events = base::take(_events);
+		_pending.clear();
 		for (auto &event : events) {
 			this->notifyEnumerate([this, &event]() {
 				this->_current->handler(event);
@@ -287,7 +326,10 @@ private:
 		UnregisterActiveObservable(&this->_callHandlers);
 	}
 
+	using Mergeable = MergeableEventHelper<EventType>;
+
 	std::deque<EventType> _events;
+	typename Mergeable::Pending _pending;
 	bool _handling = false;
 
 };
@@ -302,7 +344,6 @@ public:
 			sync = false;
 		}
 		if (sync) {
-			++_eventsCount;
 			callHandlers();
 		} else {
 			if (!this->_callHandlers) {
@@ -310,10 +351,10 @@ public:
 					callHandlers();
 				};
 			}
-			if (!_eventsCount) {
+			if (!_notified) {
 				RegisterPendingObservable(&this->_callHandlers);
 			}
-			++_eventsCount;
+			_notified = true;
 		}
 	}
 
@@ -323,21 +364,21 @@ public:
 
 private:
 	void callHandlers() {
+		// Void events carry nothing to tell them apart,
+		// so all the pending ones are delivered as a single call.
 		_handling = true;
-		auto eventsCount = base::take(_eventsCount);
-		for (int i = 0; i != eventsCount; ++i) {
-			this->notifyEnumerate([this]() {
-				this->_current->handler();
-			});
-			if (this->destroyMeIfEmpty()) {
-				return;
-			}
+		_notified = false;
+		this->notifyEnumerate([this]() {
+			this->_current->handler();
+		});
+		if (this->destroyMeIfEmpty()) {
+			return;
 		}
 		_handling = false;
 		UnregisterActiveObservable(&this->_callHandlers);
 	}
 
-	int _eventsCount = 0;
+	bool _notified = false;
 	bool _handling = false;
 
 };
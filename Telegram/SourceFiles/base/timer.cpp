@@ -12,6 +12,12 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace base {
 namespace {
 
+// The wheel turns in 32 ms ticks, a full turn takes about 8 seconds.
+constexpr auto kWheelTick = crl::time(32);
+constexpr auto kWheelSlots = 256;
+constexpr auto kWheelDueSlot = kWheelSlots;
+constexpr auto kWheelMinTimeout = crl::time(1000);
+
 QObject *TimersAdjuster() {
 	static QObject adjuster;
 	return &adjuster;
@@ -19,6 +25,218 @@ QObject *TimersAdjuster() {
 
 } // namespace
 
+namespace details {
+
+// Each timer is linked into the slot its deadline falls in, so starting
+// and cancelling it is O(1). The only Qt timer of the wheel wakes it up
+// at the nearest non-empty slot, and the slot fires the timers that are
+// due by then. Timers for later turns of the wheel stay in the slot.
+class TimerWheel final : public QObject {
+public:
+	TimerWheel();
+	~TimerWheel();
+
+	static TimerWheel &Current();
+	static bool Accepts(crl::time timeout, Qt::TimerType type);
+
+	void add(not_null<Timer*> timer);
+	void remove(not_null<Timer*> timer);
+
+protected:
+	void timerEvent(QTimerEvent *e) override;
+
+private:
+	void link(not_null<Timer*> timer, int slot);
+	void unlink(not_null<Timer*> timer);
+	[[nodiscard]] crl::time insert(not_null<Timer*> timer);
+	void advance(crl::time now);
+	void rebuild(crl::time now);
+	void collectDue(int slot);
+	void fireDue();
+	void schedule(crl::time now);
+	void wakeAt(crl::time when, crl::time now);
+
+	std::array<Timer*, kWheelSlots + 1> _heads = { { nullptr } };
+	int _count = 0;
+	int _position = 0;
+	crl::time _positionTime = 0;
+	crl::time _wakeTime = 0;
+	int _timerId = 0;
+
+};
+
+TimerWheel::TimerWheel() {
+	connect(
+		TimersAdjuster(),
+		&QObject::destroyed,
+		this,
+		[this] { schedule(crl::now()); },
+		Qt::QueuedConnection);
+}
+
+TimerWheel::~TimerWheel() {
+	for (auto &head : _heads) {
+		while (head) {
+			unlink(head);
+		}
+	}
+	_count = 0;
+}
+
+TimerWheel &TimerWheel::Current() {
+	thread_local TimerWheel result;
+	return result;
+}
+
+bool TimerWheel::Accepts(crl::time timeout, Qt::TimerType type) {
+	return (type != Qt::PreciseTimer) && (timeout >= kWheelMinTimeout);
+}
+
+void TimerWheel::add(not_null<Timer*> timer) {
+	Expects(!timer->_wheel);
+
+	const auto now = crl::now();
+	if (!_count++) {
+		_positionTime = now;
+	}
+	const auto when = insert(timer);
+	if (!_timerId || when < _wakeTime) {
+		wakeAt(when, now);
+	}
+}
+
+void TimerWheel::remove(not_null<Timer*> timer) {
+	Expects(timer->_wheel == this);
+
+	unlink(timer);
+	if (!--_count && _timerId) {
+		killTimer(base::take(_timerId));
+	}
+}
+
+crl::time TimerWheel::insert(not_null<Timer*> timer) {
+	const auto ticks = std::max(
+		(timer->_next - _positionTime + kWheelTick - 1) / kWheelTick,
+		crl::time(1));
+	link(timer, int((_position + ticks) % kWheelSlots));
+	return _positionTime + ticks * kWheelTick;
+}
+
+void TimerWheel::link(not_null<Timer*> timer, int slot) {
+	auto &head = _heads[slot];
+	timer->_wheel = this;
+	timer->_wheelSlot = slot;
+	timer->_wheelPrev = nullptr;
+	timer->_wheelNext = head;
+	if (head) {
+		head->_wheelPrev = timer;
+	}
+	head = timer;
+}
+
+void TimerWheel::unlink(not_null<Timer*> timer) {
+	if (timer->_wheelPrev) {
+		timer->_wheelPrev->_wheelNext = timer->_wheelNext;
+	} else {
+		_heads[timer->_wheelSlot] = timer->_wheelNext;
+	}
+	if (timer->_wheelNext) {
+		timer->_wheelNext->_wheelPrev = timer->_wheelPrev;
+	}
+	timer->_wheelPrev = timer->_wheelNext = nullptr;
+	timer->_wheel = nullptr;
+}
+
+void TimerWheel::timerEvent(QTimerEvent *e) {
+	killTimer(base::take(_timerId));
+	advance(crl::now());
+	fireDue();
+	schedule(crl::now());
+}
+
+void TimerWheel::advance(crl::time now) {
+	const auto ticks = (now - _positionTime) / kWheelTick;
+	if (ticks > kWheelSlots) {
+		// We slept through more than a turn, like after a system sleep.
+		rebuild(now);
+		return;
+	}
+	for (auto i = 0; i != ticks; ++i) {
+		_positionTime += kWheelTick;
+		_position = (_position + 1) % kWheelSlots;
+		collectDue(_position);
+	}
+}
+
+void TimerWheel::rebuild(crl::time now) {
+	auto timers = std::vector<not_null<Timer*>>();
+	timers.reserve(_count);
+	for (auto slot = 0; slot != kWheelSlots; ++slot) {
+		while (const auto timer = _heads[slot]) {
+			unlink(timer);
+			timers.push_back(timer);
+		}
+	}
+	_positionTime = now;
+	for (const auto timer : timers) {
+		if (timer->_next <= now) {
+			link(timer, kWheelDueSlot);
+		} else {
+			[[maybe_unused]] const auto when = insert(timer);
+		}
+	}
+}
+
+void TimerWheel::collectDue(int slot) {
+	for (auto timer = _heads[slot]; timer != nullptr;) {
+		const auto next = timer->_wheelNext;
+		if (timer->_next <= _positionTime) {
+			unlink(timer);
+			link(timer, kWheelDueSlot);
+		}
+		timer = next;
+	}
+}
+
+void TimerWheel::fireDue() {
+	// Callbacks can start and cancel any timers, including the due ones.
+	while (const auto timer = _heads[kWheelDueSlot]) {
+		remove(timer);
+		timer->wheelTimeout();
+	}
+}
+
+void TimerWheel::schedule(crl::time now) {
+	if (!_count) {
+		if (_timerId) {
+			killTimer(base::take(_timerId));
+		}
+		return;
+	} else if (_heads[kWheelDueSlot]) {
+		wakeAt(now, now);
+		return;
+	}
+	for (auto i = 1; i <= kWheelSlots; ++i) {
+		if (_heads[(_position + i) % kWheelSlots]) {
+			wakeAt(_positionTime + i * kWheelTick, now);
+			return;
+		}
+	}
+	Unexpected("Empty slots in a non-empty TimerWheel.");
+}
+
+void TimerWheel::wakeAt(crl::time when, crl::time now) {
+	if (_timerId) {
+		killTimer(base::take(_timerId));
+	}
+	_wakeTime = when;
+	_timerId = startTimer(
+		int(std::max(when - now, crl::time(0))),
+		Qt::PreciseTimer);
+}
+
+} // namespace details
+
 Timer::Timer(
 	not_null<QThread*> thread,
 	Fn<void()> callback)
@@ -40,6 +258,10 @@ Timer::Timer(Fn<void()> callback)
 		Qt::QueuedConnection);
 }
 
+Timer::~Timer() {
+	cancel();
+}
+
 void Timer::start(crl::time timeout, Qt::TimerType type, Repeat repeat) {
 	cancel();
 
@@ -47,6 +269,11 @@ void Timer::start(crl::time timeout, Qt::TimerType type, Repeat repeat) {
 	setRepeat(repeat);
 	_adjusted = false;
 	setTimeout(timeout);
+	if (details::TimerWheel::Accepts(_timeout, _type)) {
+		_next = crl::now() + _timeout;
+		details::TimerWheel::Current().add(this);
+		return;
+	}
 	_timerId = startTimer(_timeout, _type);
 	if (_timerId) {
 		_next = crl::now() + _timeout;
@@ -56,7 +283,9 @@ void Timer::start(crl::time timeout, Qt::TimerType type, Repeat repeat) {
 }
 
 void Timer::cancel() {
-	if (isActive()) {
+	if (_wheel) {
+		_wheel->remove(this);
+	} else if (_timerId) {
 		killTimer(base::take(_timerId));
 	}
 }
@@ -79,6 +308,10 @@ void Timer::Adjust() {
 }
 
 void Timer::adjust() {
+	if (_wheel) {
+		// The wheel keeps the deadlines and adjusts itself.
+		return;
+	}
 	auto remaining = remainingTime();
 	if (remaining >= 0) {
 		cancel();
@@ -113,6 +346,17 @@ void Timer::timerEvent(QTimerEvent *e) {
 	}
 }
 
+void Timer::wheelTimeout() {
+	if (repeat() == Repeat::Interval) {
+		_next = crl::now() + _timeout;
+		details::TimerWheel::Current().add(this);
+	}
+
+	if (_callback) {
+		_callback();
+	}
+}
+
 int DelayedCallTimer::call(
 		crl::time timeout,
 		FnMut<void()> callback,
@@ -14,13 +14,19 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <crl/crl_time.h>
 
 namespace base {
+namespace details {
+class TimerWheel;
+} // namespace details
 
+// Coarse timers of at least a second (the default for such timeouts)
+// don't register a Qt timer each, they share a timer wheel of the thread.
 class Timer final : private QObject {
 public:
 	explicit Timer(
 		not_null<QThread*> thread,
 		Fn<void()> callback = nullptr);
 	explicit Timer(Fn<void()> callback = nullptr);
+	~Timer();
 
 	static Qt::TimerType DefaultType(crl::time timeout) {
 		constexpr auto kThreshold = crl::time(1000);
@@ -48,7 +54,7 @@ public:
 	}
 
 	bool isActive() const {
-		return (_timerId != 0);
+		return (_timerId != 0) || (_wheel != nullptr);
 	}
 
 	void cancel();
@@ -60,12 +66,15 @@ protected:
 	void timerEvent(QTimerEvent *e) override;
 
 private:
+	friend class details::TimerWheel;
+
 	enum class Repeat : unsigned {
 		Interval   = 0,
 		SingleShot = 1,
 	};
 	void start(crl::time timeout, Qt::TimerType type, Repeat repeat);
 	void adjust();
+	void wheelTimeout();
 
 	void setTimeout(crl::time timeout);
 	int timeout() const;
@@ -82,6 +91,11 @@ private:
 	int _timeout = 0;
 	int _timerId = 0;
 
+	details::TimerWheel *_wheel = nullptr;
+	Timer *_wheelPrev = nullptr;
+	Timer *_wheelNext = nullptr;
+	int _wheelSlot = 0;
+
 	Qt::TimerType _type : 2;
 	bool _adjusted : 1;
 	unsigned _repeat : 1;
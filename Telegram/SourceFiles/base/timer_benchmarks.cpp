@@ -0,0 +1,172 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "base/basic_types.h"
+#include "base/timer.h"
+
+#include <crl/crl.h>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QEvent>
+
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <string>
+
+namespace {
+
+constexpr auto kTimersCount = 100'000;
+constexpr auto kRestartsCount = 1'000'000;
+constexpr auto kDispatchesCount = 10'000;
+
+using Clock = std::chrono::steady_clock;
+using Nanoseconds = std::chrono::nanoseconds;
+
+// A minimal version of Core::MainQueueProcessor.
+constexpr auto kProcessorEvent = QEvent::Type(QEvent::User + 1);
+
+class ProcessorEvent : public QEvent {
+public:
+	ProcessorEvent(void (*callable)(void*), void *argument)
+	: QEvent(kProcessorEvent)
+	, _callable(callable)
+	, _argument(argument) {
+	}
+
+	void process() {
+		_callable(_argument);
+	}
+
+private:
+	void (*_callable)(void*) = nullptr;
+	void *_argument = nullptr;
+
+};
+
+class Processor : public QObject {
+protected:
+	bool event(QEvent *event) override {
+		if (event->type() == kProcessorEvent) {
+			static_cast<ProcessorEvent*>(event)->process();
+			return true;
+		}
+		return QObject::event(event);
+	}
+
+};
+
+QCoreApplication &Application() {
+	static auto argc = 1;
+	static char name[] = "benchmarks_base";
+	static char *argv[] = { name, nullptr };
+	static QCoreApplication result(argc, argv);
+	return result;
+}
+
+void InitMainQueue() {
+	Application();
+
+	static const auto processor = std::make_unique<Processor>();
+	crl::init_main_queue([](void (*callable)(void*), void *argument) {
+		QCoreApplication::postEvent(
+			processor.get(),
+			new ProcessorEvent(callable, argument));
+	});
+}
+
+double NanosecondsPer(Clock::duration duration, int count) {
+	return std::chrono::duration_cast<Nanoseconds>(duration).count()
+		/ double(count);
+}
+
+void Report(const std::string &title, double value, const char *unit) {
+	std::cout
+		<< std::setw(36) << std::left << title
+		<< std::setw(12) << std::right << std::fixed << std::setprecision(1)
+		<< value << ' ' << unit
+		<< std::endl;
+}
+
+} // namespace
+
+TEST_CASE("base::Timer churn benchmark", "[benchmark]") {
+	Application();
+
+	SECTION("create, start and destroy") {
+		const auto start = Clock::now();
+		for (auto i = 0; i != kTimersCount; ++i) {
+			auto timer = base::Timer([] {});
+			timer.callOnce(1000);
+		}
+		Report(
+			"timer create, start, destroy",
+			NanosecondsPer(Clock::now() - start, kTimersCount),
+			"ns");
+	}
+
+	SECTION("restart the same timer") {
+		auto timer = base::Timer([] {});
+		const auto start = Clock::now();
+		for (auto i = 0; i != kRestartsCount; ++i) {
+			timer.callOnce(1000 + (i % 2));
+		}
+		Report(
+			"timer restart",
+			NanosecondsPer(Clock::now() - start, kRestartsCount),
+			"ns");
+		timer.cancel();
+		REQUIRE(!timer.isActive());
+	}
+
+	SECTION("zero timeout fire") {
+		auto fired = 0;
+		auto timer = base::Timer([&] { ++fired; });
+		const auto start = Clock::now();
+		for (auto i = 0; i != kDispatchesCount; ++i) {
+			timer.callOnce(0);
+			while (fired == i) {
+				QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+			}
+		}
+		Report(
+			"timer zero timeout fire",
+			NanosecondsPer(Clock::now() - start, kDispatchesCount),
+			"ns");
+		REQUIRE(fired == kDispatchesCount);
+	}
+}
+
+TEST_CASE("crl::on_main dispatch benchmark", "[benchmark]") {
+	InitMainQueue();
+
+	auto latencies = std::vector<double>();
+	latencies.reserve(kDispatchesCount);
+	for (auto i = 0; i != kDispatchesCount; ++i) {
+		auto done = false;
+		crl::async([&] {
+			const auto posted = Clock::now();
+			crl::on_main([&, posted] {
+				latencies.push_back(NanosecondsPer(Clock::now() - posted, 1));
+				done = true;
+			});
+		});
+		while (!done) {
+			QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+		}
+	}
+	std::sort(begin(latencies), end(latencies));
+	const auto percentile = [&](int value) {
+		return latencies[(latencies.size() - 1) * value / 100] / 1000.;
+	};
+	Report("crl::on_main latency, median", percentile(50), "us");
+	Report("crl::on_main latency, 99%", percentile(99), "us");
+	REQUIRE(int(latencies.size()) == kDispatchesCount);
+}
@@ -0,0 +1,387 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "base/trace.h"
+
+#include <QtCore/QMutex>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace base {
+namespace trace {
+namespace {
+
+constexpr auto kBufferSize = uint64(8192);
+
+// Buffers of the finished threads are kept until there are too many.
+constexpr auto kFinishedLimit = 16;
+
+// The latest events of the threads, recorded even if tracing is not started.
+constexpr auto kFlightSize = uint64(256);
+constexpr auto kFlightThreads = 64;
+
+enum class Type : char {
+	Complete = 'X',
+	Counter = 'C',
+	FlowBegin = 's',
+	FlowEnd = 'f',
+};
+
+// Each field is atomic, because the slot may be overwritten while it is
+// being dumped. Such slots are found by the written counter and dropped.
+struct Slot {
+	std::atomic<Type> type = Type::Complete;
+	std::atomic<const char*> name = nullptr;
+	std::atomic<const char*> category = nullptr;
+	std::atomic<int64> time = 0;
+	std::atomic<int64> value = 0;
+};
+
+struct Event {
+	Type type = Type::Complete;
+	const char *name = nullptr;
+	const char *category = nullptr;
+	int64 time = 0;
+	int64 value = 0;
+};
+
+struct Buffer {
+	std::unique_ptr<Slot[]> slots = std::make_unique<Slot[]>(kBufferSize);
+	std::atomic<uint64> written = 0;
+	std::atomic<const char*> name = nullptr;
+	std::atomic<bool> finished = false;
+	int thread = 0;
+};
+
+// Flight buffers are never freed, so they can be read from a crash handler
+// without any locks. A buffer of a finished thread is taken by a new one.
+struct FlightBuffer {
+	std::array<Slot, kFlightSize> slots;
+	std::atomic<uint64> written = 0;
+	std::atomic<const char*> name = nullptr;
+	std::atomic<int> thread = 0;
+	std::atomic<bool> used = false;
+};
+
+struct Registry {
+	QMutex mutex;
+	std::vector<std::shared_ptr<Buffer>> buffers;
+	int threads = 0;
+};
+
+struct ThreadBuffer {
+	~ThreadBuffer() {
+		if (buffer) {
+			buffer->finished = true;
+		}
+		if (flight) {
+			flight->used = false;
+		}
+	}
+
+	std::shared_ptr<Buffer> buffer;
+	FlightBuffer *flight = nullptr;
+	bool flightFailed = false;
+	const char *name = nullptr;
+};
+
+std::array<std::atomic<FlightBuffer*>, kFlightThreads> Flights;
+std::atomic<int> FlightThreads = 0;
+std::atomic<bool> Collecting = false;
+std::atomic<int64> StartedAt = 0;
+thread_local ThreadBuffer Local;
+thread_local std::atomic<const char*> Current = nullptr;
+std::atomic<const std::atomic<const char*>*> Watched = nullptr;
+
+Registry &GetRegistry() {
+	static Registry result;
+	return result;
+}
+
+int64 Now() {
+	using namespace std::chrono;
+	static const auto origin = steady_clock::now();
+
+	// Microseconds, as expected by the trace event format.
+	return duration_cast<microseconds>(steady_clock::now() - origin).count();
+}
+
+not_null<Buffer*> CreateBuffer() {
+	auto &registry = GetRegistry();
+	auto result = std::make_shared<Buffer>();
+	result->name = Local.name;
+
+	QMutexLocker lock(&registry.mutex);
+	auto &buffers = registry.buffers;
+	auto finished = ranges::count_if(buffers, [](const auto &buffer) {
+		return buffer->finished.load();
+	});
+	auto i = begin(buffers);
+	while (i != end(buffers) && finished >= kFinishedLimit) {
+		if ((*i)->finished) {
+			i = buffers.erase(i);
+			--finished;
+		} else {
+			++i;
+		}
+	}
+	result->thread = ++registry.threads;
+	buffers.push_back(result);
+	Local.buffer = std::move(result);
+	return Local.buffer.get();
+}
+
+FlightBuffer *AcquireFlightBuffer() {
+	for (auto &entry : Flights) {
+		auto buffer = entry.load(std::memory_order_acquire);
+		if (!buffer) {
+			auto created = std::make_unique<FlightBuffer>();
+			created->used = true;
+			if (entry.compare_exchange_strong(buffer, created.get())) {
+				buffer = created.release();
+			} else if (buffer->used.exchange(true)) {
+				continue;
+			}
+		} else if (buffer->used.exchange(true)) {
+			continue;
+		}
+		buffer->written = 0;
+		buffer->name = Local.name;
+		buffer->thread = ++FlightThreads;
+		return buffer;
+	}
+	return nullptr;
+}
+
+FlightBuffer *LocalFlightBuffer() {
+	if (!Local.flight && !Local.flightFailed) {
+		Local.flight = AcquireFlightBuffer();
+		Local.flightFailed = !Local.flight;
+	}
+	return Local.flight;
+}
+
+template <typename Ring>
+void Write(
+		Ring &buffer,
+		uint64 size,
+		Type type,
+		const char *name,
+		const char *category,
+		int64 time,
+		int64 value) {
+	const auto index = buffer.written.load(std::memory_order_relaxed);
+	auto &slot = buffer.slots[index % size];
+	slot.type.store(type, std::memory_order_relaxed);
+	slot.name.store(name, std::memory_order_relaxed);
+	slot.category.store(category, std::memory_order_relaxed);
+	slot.time.store(time, std::memory_order_relaxed);
+	slot.value.store(value, std::memory_order_relaxed);
+	buffer.written.store(index + 1, std::memory_order_release);
+}
+
+void Push(
+		Type type,
+		const char *name,
+		const char *category,
+		int64 time,
+		int64 value) {
+	if (const auto flight = LocalFlightBuffer()) {
+		Write(*flight, kFlightSize, type, name, category, time, value);
+	}
+	if (!Collecting.load(std::memory_order_relaxed)) {
+		return;
+	}
+	const auto buffer = Local.buffer
+		? not_null<Buffer*>(Local.buffer.get())
+		: CreateBuffer();
+	Write(*buffer, kBufferSize, type, name, category, time, value);
+}
+
+std::vector<Event> Collect(const Buffer &buffer, int64 since) {
+	const auto till = buffer.written.load(std::memory_order_acquire);
+	const auto from = (till > kBufferSize) ? (till - kBufferSize) : 0;
+	auto result = std::vector<Event>();
+	result.reserve(till - from);
+	for (auto index = from; index != till; ++index) {
+		const auto &slot = buffer.slots[index % kBufferSize];
+		result.push_back({
+			slot.type.load(std::memory_order_relaxed),
+			slot.name.load(std::memory_order_relaxed),
+			slot.category.load(std::memory_order_relaxed),
+			slot.time.load(std::memory_order_relaxed),
+			slot.value.load(std::memory_order_relaxed),
+		});
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+
+	// The slot of the event being written now could be overwritten too.
+	const auto now = buffer.written.load(std::memory_order_relaxed);
+	const auto valid = (now >= kBufferSize) ? (now - kBufferSize + 1) : 0;
+	if (valid > from) {
+		result.erase(
+			begin(result),
+			begin(result) + std::min(valid - from, uint64(result.size())));
+	}
+	result.erase(ranges::remove_if(result, [&](const Event &event) {
+		return (event.time < since);
+	}), end(result));
+	return result;
+}
+
+void Serialize(QByteArray &result, const Event &event, int thread) {
+	result.append("{\"name\":\"").append(event.name);
+	result.append("\",\"cat\":\"").append(event.category);
+	result.append("\",\"ph\":\"").append(char(event.type));
+	result.append("\",\"pid\":1,\"tid\":").append(QByteArray::number(thread));
+	result.append(",\"ts\":").append(QByteArray::number(event.time));
+	switch (event.type) {
+	case Type::Complete:
+		result.append(",\"dur\":").append(QByteArray::number(event.value));
+		break;
+	case Type::Counter:
+		result.append(",\"args\":{\"value\":");
+		result.append(QByteArray::number(event.value)).append('}');
+		break;
+	case Type::FlowBegin:
+	case Type::FlowEnd:
+		result.append(",\"id\":").append(QByteArray::number(event.value));
+		if (event.type == Type::FlowEnd) {
+			result.append(",\"bp\":\"e\"");
+		}
+		break;
+	}
+	result.append('}');
+}
+
+} // namespace
+
+void Start() {
+	StartedAt = Now();
+	Collecting = true;
+}
+
+void Stop() {
+	Collecting = false;
+}
+
+bool Enabled() {
+	return Collecting.load(std::memory_order_relaxed);
+}
+
+QByteArray Dump() {
+	auto &registry = GetRegistry();
+	auto buffers = std::vector<std::shared_ptr<Buffer>>();
+	{
+		QMutexLocker lock(&registry.mutex);
+		buffers = registry.buffers;
+	}
+	const auto since = StartedAt.load();
+	auto result = QByteArray("{\"traceEvents\":[\n");
+	auto first = true;
+	const auto separate = [&] {
+		if (!first) {
+			result.append(",\n");
+		}
+		first = false;
+	};
+	for (const auto &buffer : buffers) {
+		const auto thread = QByteArray::number(buffer->thread);
+		const auto name = buffer->name.load();
+		separate();
+		result.append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,");
+		result.append("\"tid\":").append(thread).append(",\"args\":{");
+		result.append("\"name\":\"");
+		if (name) {
+			result.append(name).append(' ');
+		}
+		result.append(thread).append("\"}}");
+
+		for (const auto &event : Collect(*buffer, since)) {
+			separate();
+			Serialize(result, event, buffer->thread);
+		}
+	}
+	result.append("\n],\"displayTimeUnit\":\"ms\"}\n");
+	return result;
+}
+
+void DumpFlight(void (*callback)(const FlightEvent &event)) {
+	const auto now = Now();
+	for (const auto &entry : Flights) {
+		const auto buffer = entry.load(std::memory_order_acquire);
+		if (!buffer || !buffer->used) {
+			continue;
+		}
+		const auto till = buffer->written.load(std::memory_order_acquire);
+		const auto from = (till > kFlightSize) ? (till - kFlightSize) : 0;
+		for (auto index = from; index != till; ++index) {
+			const auto &slot = buffer->slots[index % kFlightSize];
+			auto event = FlightEvent();
+			event.thread = buffer->thread;
+			event.threadName = buffer->name;
+			event.type = char(slot.type.load(std::memory_order_relaxed));
+			event.name = slot.name.load(std::memory_order_relaxed);
+			event.category = slot.category.load(std::memory_order_relaxed);
+			event.ago = now - slot.time.load(std::memory_order_relaxed);
+			event.value = slot.value.load(std::memory_order_relaxed);
+			if (event.name && event.category) {
+				callback(event);
+			}
+		}
+	}
+}
+
+void SetThreadName(const char *name) {
+	Local.name = name;
+	if (const auto buffer = Local.buffer.get()) {
+		buffer->name = name;
+	}
+	if (const auto flight = Local.flight) {
+		flight->name = name;
+	}
+}
+
+void Counter(const char *name, int64 value, const char *category) {
+	Push(Type::Counter, name, category, Now(), value);
+}
+
+void FlowBegin(const char *name, uint64 id, const char *category) {
+	Push(Type::FlowBegin, name, category, Now(), int64(id));
+}
+
+void FlowEnd(const char *name, uint64 id, const char *category) {
+	Push(Type::FlowEnd, name, category, Now(), int64(id));
+}
+
+void WatchCurrentThread() {
+	Watched = &Current;
+}
+
+const char *WatchedSpan() {
+	const auto watched = Watched.load(std::memory_order_acquire);
+	return watched ? watched->load(std::memory_order_relaxed) : nullptr;
+}
+
+Span::Span(const char *name, const char *category)
+: _name(name)
+, _category(category)
+, _previous(Current.exchange(name, std::memory_order_relaxed))
+, _started(Now()) {
+}
+
+Span::~Span() {
+	Current.store(_previous, std::memory_order_relaxed);
+	Push(Type::Complete, _name, _category, _started, Now() - _started);
+}
+
+} // namespace trace
+} // namespace base
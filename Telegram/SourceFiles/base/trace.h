@@ -0,0 +1,72 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/basic_types.h"
+
+namespace base {
+namespace trace {
+
+// Events are kept in a ring buffer of each thread, so recording doesn't
+// take any locks and only the latest events of each thread are dumped.
+// When tracing is not started only the small flight buffers are written.
+//
+// All the names and categories should be static literals.
+void Start();
+void Stop();
+[[nodiscard]] bool Enabled();
+
+// Dumps in the Chrome trace event format, see chrome://tracing.
+[[nodiscard]] QByteArray Dump();
+
+// The latest events of each thread are recorded even if tracing is not
+// started, so that the crash report shows what happened before a crash.
+struct FlightEvent {
+	int thread = 0;
+	const char *threadName = nullptr;
+	char type = 0;
+	const char *name = nullptr;
+	const char *category = nullptr;
+	int64 ago = 0;
+	int64 value = 0;
+};
+
+// Doesn't allocate and doesn't take locks, may be called on a crash.
+void DumpFlight(void (*callback)(const FlightEvent &event));
+
+// From the thread being named.
+void SetThreadName(const char *name);
+
+void Counter(const char *name, int64 value, const char *category = "counter");
+
+// Connects events of different threads, ids should match only in pairs.
+void FlowBegin(const char *name, uint64 id, const char *category = "flow");
+void FlowEnd(const char *name, uint64 id, const char *category = "flow");
+
+// The innermost open span is tracked even if tracing is not started,
+// so it can be read from any thread for the thread that is watched.
+void WatchCurrentThread();
+[[nodiscard]] const char *WatchedSpan();
+
+class Span final {
+public:
+	explicit Span(const char *name, const char *category = "span");
+	Span(const Span &other) = delete;
+	Span &operator=(const Span &other) = delete;
+	~Span();
+
+private:
+	const char *_name = nullptr;
+	const char *_category = nullptr;
+	const char *_previous = nullptr;
+	int64 _started = -1;
+
+};
+
+} // namespace trace
+} // namespace base
@@ -128,7 +128,7 @@ public:
 		const Database::TaggedSummary &data);
 
 	void update(const Database::TaggedSummary &data);
-	void toggleProgress(bool shown);
+	void toggleProgress(bool shown, int percent = -1);
 
 	rpl::producer<> clearRequests() const;
 
@@ -179,19 +179,26 @@ void LocalStorageBox::Row::update(const Database::TaggedSummary &data) {
 	_clear->setVisible(data.count != 0);
 }
 
-void LocalStorageBox::Row::toggleProgress(bool shown) {
+void LocalStorageBox::Row::toggleProgress(bool shown, int percent) {
+	const auto text = (percent >= 0)
+		? lng_local_storage_clearing_progress(
+			lt_percent,
+			QString::number(percent))
+		: lang(lng_local_storage_clearing);
 	if (!shown) {
 		_progress = nullptr;
 		_description->show();
 		_clearing.destroy();
-	} else if (!_progress) {
+	} else if (_progress) {
+		_clearing->setText(text);
+	} else {
 		_progress = std::make_unique<Ui::InfiniteRadialAnimation>(
 			[=] { radialAnimationCallback(); },
 			st::proxyCheckingAnimation);
 		_progress->start();
 		_clearing = object_ptr<Ui::FlatLabel>(
 			this,
-			lang(lng_local_storage_clearing),
+			text,
 			Ui::FlatLabel::InitType::Simple,
 			st::localStorageRowSize);
 		_clearing->show();
@@ -324,8 +331,13 @@ void LocalStorageBox::update(
 	_stats = std::move(stats);
 	_statsBig = std::move(statsBig);
 	if (const auto i = _rows.find(0); i != end(_rows)) {
+		const auto total = _stats.clearingTotalSize
+			+ _statsBig.clearingTotalSize;
+		const auto removed = _stats.clearingRemovedSize
+			+ _statsBig.clearingRemovedSize;
 		i->second->entity()->toggleProgress(
-			_stats.clearing || _statsBig.clearing);
+			_stats.clearing || _statsBig.clearing,
+			(total > 0) ? int(std::min(removed, total) * 100 / total) : -1);
 	}
 	for (const auto &entry : _rows) {
 		if (entry.first == kFakeMediaCacheTag) {
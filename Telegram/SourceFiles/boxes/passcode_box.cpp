@@ -385,9 +385,8 @@ void PasscodeBox::handleSrpIdInvalid() {
 }
 
 void PasscodeBox::save(bool force) {
-	if (_setRequest) return;
+	if (_setRequest || _checkingPasscode) return;
 
-	QString old = _oldPasscode->text(), pwd = _newPasscode->text(), conf = _reenterPasscode->text();
 	const auto has = currentlyHave();
 	if (!_cloudPwd && (_turningOff || has)) {
 		if (!passcodeCanTry()) {
@@ -398,15 +397,29 @@ void PasscodeBox::save(bool force) {
 			return;
 		}
 
-		if (Local::checkPasscode(old.toUtf8())) {
-			cSetPasscodeBadTries(0);
-			if (_turningOff) pwd = conf = QString();
-		} else {
-			cSetPasscodeBadTries(cPasscodeBadTries() + 1);
-			cSetPasscodeLastTry(crl::now());
-			badOldPasscode();
-			return;
-		}
+		_checkingPasscode = true;
+		const auto old = _oldPasscode->text().toUtf8();
+		Local::checkPasscode(old, crl::guard(this, [=](bool correct) {
+			_checkingPasscode = false;
+			if (correct) {
+				cSetPasscodeBadTries(0);
+				saveChecked(force);
+			} else {
+				cSetPasscodeBadTries(cPasscodeBadTries() + 1);
+				cSetPasscodeLastTry(crl::now());
+				badOldPasscode();
+			}
+		}));
+		return;
+	}
+	saveChecked(force);
+}
+
+void PasscodeBox::saveChecked(bool force) {
+	QString old = _oldPasscode->text(), pwd = _newPasscode->text(), conf = _reenterPasscode->text();
+	const auto has = currentlyHave();
+	if (!_cloudPwd && _turningOff) {
+		pwd = conf = QString();
 	}
 	if (!_turningOff && pwd.isEmpty()) {
 		_newPasscode->setFocus();
@@ -454,11 +467,13 @@ void PasscodeBox::save(bool force) {
 	} else {
 		const auto weak = make_weak(this);
 		cSetPasscodeBadTries(0);
-		Local::setPasscode(pwd.toUtf8());
-		Auth().localPasscodeChanged();
-		if (weak) {
-			closeBox();
-		}
+		_checkingPasscode = true;
+		Local::setPasscode(pwd.toUtf8(), [=] {
+			Auth().localPasscodeChanged();
+			if (weak) {
+				closeBox();
+			}
+		});
 	}
 }
 
@@ -51,6 +51,7 @@ private:
 	void newChanged();
 	void emailChanged();
 	void save(bool force = false);
+	void saveChecked(bool force);
 	void badOldPasscode();
 	void recoverByEmail();
 	void recoverExpired();
@@ -111,6 +112,7 @@ private:
 	bool _turningOff = false;
 	bool _cloudPwd = false;
 	mtpRequestId _setRequest = 0;
+	bool _checkingPasscode = false;
 
 	Core::CloudPasswordCheckRequest _curRequest;
 	crl::time _lastSrpIdInvalidTime = 0;
@@ -667,11 +667,18 @@ void PeerListContent::addToSearchIndex(not_null<PeerListRow*> row) {
 	for (auto ch : row->nameFirstLetters()) {
 		_searchIndex[ch].push_back(row);
 	}
+	clearLocalSearchResults();
+}
+
+void PeerListContent::clearLocalSearchResults() {
+	_localSearchQuery = QString();
+	_localSearchResults.clear();
 }
 
 void PeerListContent::removeFromSearchIndex(not_null<PeerListRow*> row) {
 	const auto &nameFirstLetters = row->nameFirstLetters();
 	if (!nameFirstLetters.empty()) {
+		clearLocalSearchResults();
 		for (auto ch : row->nameFirstLetters()) {
 			auto it = _searchIndex.find(ch);
 			if (it != _searchIndex.cend()) {
@@ -774,6 +781,7 @@ void PeerListContent::clearAllContent() {
 	_rowsByPeer.clear();
 	_filterResults.clear();
 	_searchIndex.clear();
+	clearLocalSearchResults();
 	_rows.clear();
 	_searchRows.clear();
 	_searchQuery
@@ -1308,7 +1316,13 @@ void PeerListContent::searchQueryChanged(QString query) {
 	if (_normalizedSearchQuery != normalizedQuery) {
 		setSearchQuery(query, normalizedQuery);
 		if (_controller->searchInLocal() && !searchWordsList.isEmpty()) {
-			auto minimalList = (const std::vector<not_null<PeerListRow*>>*)nullptr;
+			// When the query is only extended, like while typing,
+			// the new results are a subset of the previous ones.
+			const auto refined = !_localSearchQuery.isEmpty()
+				&& normalizedQuery.startsWith(_localSearchQuery);
+			auto minimalList = refined
+				? &_localSearchResults
+				: (const std::vector<not_null<PeerListRow*>>*)nullptr;
 			for_const (auto &searchWord, searchWordsList) {
 				auto searchWordStart = searchWord[0].toLower();
 				auto it = _searchIndex.find(searchWordStart);
@@ -1348,6 +1362,10 @@ void PeerListContent::searchQueryChanged(QString query) {
 					}
 				}
 			}
+			_localSearchQuery = normalizedQuery;
+			_localSearchResults = _filterResults;
+		} else {
+			clearLocalSearchResults();
 		}
 		if (_controller->hasComplexSearch()) {
 			_controller->search(_searchQuery);
@@ -569,6 +569,7 @@ private:
 	void addToSearchIndex(not_null<PeerListRow*> row);
 	bool addingToSearchIndex() const;
 	void removeFromSearchIndex(not_null<PeerListRow*> row);
+	void clearLocalSearchResults();
 	void setSearchQuery(const QString &query, const QString &normalizedQuery);
 	bool showingSearch() const {
 		return !_searchQuery.isEmpty();
@@ -615,6 +616,8 @@ private:
 	QString _normalizedSearchQuery;
 	QString _mentionHighlight;
 	std::vector<not_null<PeerListRow*>> _filterResults;
+	QString _localSearchQuery;
+	std::vector<not_null<PeerListRow*>> _localSearchResults;
 
 	int _aboveHeight = 0;
 	int _belowHeight = 0;
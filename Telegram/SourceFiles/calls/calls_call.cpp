@@ -20,6 +20,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "calls/calls_panel.h"
 #include "data/data_user.h"
 #include "data/data_session.h"
+#include "core/main_queue_processor.h"
+
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
 
 #ifdef slots
 #undef slots
@@ -40,6 +44,61 @@ namespace {
 constexpr auto kMinLayer = 65;
 constexpr auto kHangupTimeoutMs = 5000;
 constexpr auto kSha256Size = 32;
+constexpr auto kStatsInterval = crl::time(1000);
+
+// Slow machines get a deeper jitter buffer, so that the audio doesn't
+// stutter each time the main thread or the whole system is busy.
+constexpr auto kBusyMainThreadLag = crl::time(50);
+constexpr auto kConstrainedJitterScale = 1.5;
+constexpr auto kMinIdealThreadCount = 2;
+const auto kJitterDelayKeys = {
+	"jitter_min_delay_20",
+	"jitter_min_delay_40",
+	"jitter_min_delay_60",
+	"jitter_max_delay_20",
+	"jitter_max_delay_40",
+	"jitter_max_delay_60",
+};
+
+std::string ServerConfigData;
+bool ServerConfigConstrained = false;
+bool LastCallLagged = false;
+
+void ApplyServerConfig(bool constrained) {
+	ServerConfigConstrained = constrained;
+	const auto config = tgvoip::ServerConfig::GetSharedInstance();
+	if (!constrained) {
+		config->Update(ServerConfigData);
+		return;
+	}
+	auto error = QJsonParseError{ 0, QJsonParseError::NoError };
+	const auto document = QJsonDocument::fromJson(
+		QByteArray::fromStdString(ServerConfigData),
+		&error);
+	if (error.error != QJsonParseError::NoError || !document.isObject()) {
+		config->Update(ServerConfigData);
+		return;
+	}
+	auto object = document.object();
+	for (const auto key : kJitterDelayKeys) {
+		const auto value = object.value(key);
+		if (value.isDouble()) {
+			object.insert(
+				key,
+				std::ceil(value.toDouble() * kConstrainedJitterScale));
+		}
+	}
+	const auto updated = QJsonDocument(object).toJson(
+		QJsonDocument::Compact);
+	config->Update(updated.toStdString());
+}
+
+[[nodiscard]] bool LowCpuHeadroom() {
+	return LastCallLagged
+		|| (QThread::idealThreadCount() <= kMinIdealThreadCount)
+		|| (Core::MainQueueProcessor::Stats().lastWait
+			>= kBusyMainThreadLag);
+}
 
 void AppendEndpoint(
 		std::vector<tgvoip::Endpoint> &list,
@@ -131,6 +190,7 @@ Call::Call(
 , _user(user)
 , _type(type) {
 	_discardByTimeoutTimer.setCallback([this] { hangup(); });
+	_statsTimer.setCallback([this] { sampleStats(); });
 
 	if (_type == Type::Outgoing) {
 		setState(State::Requesting);
@@ -560,6 +620,13 @@ void Call::createAndStartController(const MTPDphoneCall &call) {
 		return;
 	}
 
+	const auto constrained = LowCpuHeadroom();
+	if (constrained != ServerConfigConstrained) {
+		DEBUG_LOG(("Call Info: Low CPU headroom: %1."
+			).arg(Logs::b(constrained)));
+		ApplyServerConfig(constrained);
+	}
+
 	tgvoip::VoIPController::Config config;
 	config.dataSaving = tgvoip::DATA_SAVING_NEVER;
 	config.enableAEC = !Platform::IsMac10_7OrGreater();
@@ -763,6 +830,7 @@ void Call::setState(State state) {
 		switch (_state) {
 		case State::Established:
 			_startTime = crl::now();
+			startStats();
 			break;
 		case State::ExchangingKeys:
 			_delegate->playSound(Delegate::Sound::Connecting);
@@ -893,7 +961,47 @@ void Call::handleControllerError(int error) {
 	finish(FinishType::Failed);
 }
 
+void Call::startStats() {
+	_statsExpectedAt = crl::now() + kStatsInterval;
+	_statsTimer.callEach(kStatsInterval, Qt::PreciseTimer);
+}
+
+void Call::sampleStats() {
+	const auto now = crl::now();
+	const auto lag = std::max(now - _statsExpectedAt, crl::time(0));
+	_statsExpectedAt = now + kStatsInterval;
+	_statsLagSum += lag;
+	++_statsCount;
+	if (!_controller) {
+		return;
+	}
+	auto traffic = tgvoip::VoIPController::TrafficStats();
+	_controller->GetStats(&traffic);
+
+	auto stats = Stats();
+	stats.rtt = crl::time(std::round(_controller->GetAverageRTT() * 1000.));
+	stats.bytesSent = int64(traffic.bytesSentWifi + traffic.bytesSentMobile);
+	stats.bytesReceived = int64(traffic.bytesRecvdWifi
+		+ traffic.bytesRecvdMobile);
+	stats.signalBarCount = _signalBarCount;
+	stats.mainThreadLag = lag;
+	_stats.fire(std::move(stats));
+}
+
+void Call::finishStats() {
+	if (!_statsTimer.isActive()) {
+		return;
+	}
+	_statsTimer.cancel();
+	if (_statsCount > 0) {
+		LastCallLagged = (_statsLagSum / _statsCount >= kBusyMainThreadLag);
+		DEBUG_LOG(("Call Info: Average main thread lag: %1 ms."
+			).arg(_statsLagSum / _statsCount));
+	}
+}
+
 void Call::destroyController() {
+	finishStats();
 	if (_controller) {
 		DEBUG_LOG(("Call Info: Destroying call controller.."));
 		_controller.reset();
@@ -907,7 +1015,8 @@ Call::~Call() {
 }
 
 void UpdateConfig(const std::string& data) {
-	tgvoip::ServerConfig::GetSharedInstance()->Update(data);
+	ServerConfigData = data;
+	ApplyServerConfig(ServerConfigConstrained);
 }
 
 } // namespace Calls
@@ -102,6 +102,20 @@ public:
 		return _signalBarCountChanged;
 	}
 
+	// Sampled each second while the call is established.
+	struct Stats {
+		crl::time rtt = 0;
+		int64 bytesSent = 0;
+		int64 bytesReceived = 0;
+		int signalBarCount = 0;
+
+		// How late the main thread was for the sample.
+		crl::time mainThreadLag = 0;
+	};
+	rpl::producer<Stats> statsValue() const {
+		return _stats.events();
+	}
+
 	void setMute(bool mute);
 	bool isMute() const {
 		return _mute;
@@ -180,6 +194,9 @@ private:
 	void setFailedQueued(int error);
 	void setSignalBarCount(int count);
 	void destroyController();
+	void startStats();
+	void sampleStats();
+	void finishStats();
 
 	not_null<Delegate*> _delegate;
 	not_null<UserData*> _user;
@@ -190,6 +207,11 @@ private:
 	base::Observable<State> _stateChanged;
 	int _signalBarCount = kSignalBarStarting;
 	base::Observable<int> _signalBarCountChanged;
+	rpl::event_stream<Stats> _stats;
+	base::Timer _statsTimer;
+	crl::time _statsExpectedAt = 0;
+	crl::time _statsLagSum = 0;
+	int _statsCount = 0;
 	crl::time _startTime = 0;
 	base::DelayedCallTimer _finishByTimeoutTimer;
 	base::Timer _discardByTimeoutTimer;
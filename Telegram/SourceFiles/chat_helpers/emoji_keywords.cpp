@@ -22,6 +22,7 @@ namespace {
 constexpr auto kRefreshEach = 60 * 60 * crl::time(1000); // 1 hour.
 constexpr auto kKeepNotUsedLangPacksCount = 4;
 constexpr auto kKeepNotUsedInputLanguagesCount = 4;
+constexpr auto kIndexFormat = qint32(1);
 
 using namespace Ui::Emoji;
 
@@ -38,6 +39,55 @@ struct LangPackData {
 	std::map<QString, std::vector<LangPackEmoji>> emoji;
 };
 
+// Immutable compiled form of LangPackData, built on a background thread.
+// Sorted keys are stored in one string, so a prefix lookup is a binary
+// search followed by a scan of the matching range.
+struct LangPackIndex {
+	int version = 0;
+	int maxKeyLength = 0;
+	QString keys;
+	std::vector<int> keyEnds;
+	std::vector<int> emojiEnds;
+	std::vector<LangPackEmoji> emoji;
+
+	[[nodiscard]] int count() const;
+	[[nodiscard]] QStringRef key(int index) const;
+	[[nodiscard]] gsl::span<const LangPackEmoji> list(int index) const;
+	[[nodiscard]] int lowerBound(const QString &key) const;
+};
+
+int LangPackIndex::count() const {
+	return int(keyEnds.size());
+}
+
+QStringRef LangPackIndex::key(int index) const {
+	Expects(index >= 0 && index < count());
+
+	const auto from = index ? keyEnds[index - 1] : 0;
+	return keys.midRef(from, keyEnds[index] - from);
+}
+
+gsl::span<const LangPackEmoji> LangPackIndex::list(int index) const {
+	Expects(index >= 0 && index < count());
+
+	const auto from = index ? emojiEnds[index - 1] : 0;
+	return gsl::make_span(emoji).subspan(from, emojiEnds[index] - from);
+}
+
+int LangPackIndex::lowerBound(const QString &key) const {
+	auto from = 0;
+	auto till = count();
+	while (from < till) {
+		const auto middle = (from + till) / 2;
+		if (this->key(middle).compare(key) < 0) {
+			from = middle + 1;
+		} else {
+			till = middle;
+		}
+	}
+	return from;
+}
+
 [[nodiscard]] bool MustAddPostfix(const QString &text) {
 	if (text.size() != 1) {
 		return false;
@@ -69,6 +119,13 @@ struct LangPackData {
 	return false;
 }
 
+[[nodiscard]] LangPackEmoji ParseEmoji(const QString &text) {
+	const auto emoji = MustAddPostfix(text)
+		? (text + QChar(Ui::Emoji::kPostfix))
+		: text;
+	return LangPackEmoji{ Find(emoji), text };
+}
+
 void CreateCacheFilePath() {
 	QDir().mkpath(internal::CacheFileFolder() + qstr("/keywords"));
 }
@@ -114,10 +171,7 @@ void CreateCacheFilePath() {
 			if (stream.status() != QDataStream::Ok) {
 				return {};
 			}
-			const auto emoji = MustAddPostfix(text)
-				? (text + QChar(Ui::Emoji::kPostfix))
-				: text;
-			const auto entry = LangPackEmoji{ Find(emoji), text };
+			const auto entry = ParseEmoji(text);
 			if (!entry.emoji) {
 				return {};
 			}
@@ -153,6 +207,156 @@ void WriteLocalCache(const QString &id, const LangPackData &data) {
 	}
 }
 
+[[nodiscard]] QString IndexFilePath(const QString &id) {
+	const auto path = CacheFilePath(id);
+	return path.isEmpty() ? QString() : (path + qstr(".index"));
+}
+
+[[nodiscard]] LangPackIndex CompileIndex(const LangPackData &data) {
+	auto result = LangPackIndex();
+	result.version = data.version;
+	result.maxKeyLength = data.maxKeyLength;
+
+	auto keysLength = 0;
+	auto emojiCount = 0;
+	for (const auto &[key, list] : data.emoji) {
+		keysLength += key.size();
+		emojiCount += int(list.size());
+	}
+	result.keys.reserve(keysLength);
+	result.keyEnds.reserve(data.emoji.size());
+	result.emojiEnds.reserve(data.emoji.size());
+	result.emoji.reserve(emojiCount);
+	for (const auto &[key, list] : data.emoji) {
+		result.keys.append(key);
+		result.keyEnds.push_back(result.keys.size());
+		result.emoji.insert(end(result.emoji), begin(list), end(list));
+		result.emojiEnds.push_back(int(result.emoji.size()));
+	}
+	return result;
+}
+
+[[nodiscard]] LangPackData DecompileIndex(const LangPackIndex &index) {
+	auto result = LangPackData();
+	result.version = index.version;
+	result.maxKeyLength = index.maxKeyLength;
+	for (auto i = 0; i != index.count(); ++i) {
+		const auto list = index.list(i);
+		result.emoji.emplace(
+			index.key(i).toString(),
+			std::vector<LangPackEmoji>(list.begin(), list.end()));
+	}
+	return result;
+}
+
+[[nodiscard]] std::optional<LangPackIndex> ReadLocalIndex(
+		const QString &id) {
+	auto file = QFile(IndexFilePath(id));
+	if (!file.open(QIODevice::ReadOnly)) {
+		return std::nullopt;
+	}
+	auto result = LangPackIndex();
+	auto stream = QDataStream(&file);
+	stream.setVersion(QDataStream::Qt_5_1);
+	auto format = qint32();
+	auto version = qint32();
+	auto maxKeyLength = qint32();
+	auto count = qint32();
+	auto texts = QString();
+	stream
+		>> format
+		>> version
+		>> maxKeyLength
+		>> result.keys
+		>> texts
+		>> count;
+	if (format != kIndexFormat
+		|| version < 0
+		|| count < 0
+		|| stream.status() != QDataStream::Ok) {
+		return std::nullopt;
+	}
+	result.version = version;
+	result.maxKeyLength = maxKeyLength;
+	result.keyEnds.reserve(count);
+	result.emojiEnds.reserve(count);
+	auto textEnd = 0;
+	for (auto i = 0; i != count; ++i) {
+		auto keyEnd = qint32();
+		auto emojiCount = qint32();
+		stream >> keyEnd >> emojiCount;
+		const auto keyFrom = result.keyEnds.empty()
+			? 0
+			: result.keyEnds.back();
+		if (stream.status() != QDataStream::Ok
+			|| keyEnd <= keyFrom
+			|| keyEnd > result.keys.size()
+			|| emojiCount <= 0) {
+			return std::nullopt;
+		}
+		for (auto j = 0; j != emojiCount; ++j) {
+			auto length = qint32();
+			stream >> length;
+			if (stream.status() != QDataStream::Ok
+				|| length <= 0
+				|| textEnd + length > texts.size()) {
+				return std::nullopt;
+			}
+			const auto entry = ParseEmoji(texts.mid(textEnd, length));
+			if (!entry.emoji) {
+				return std::nullopt;
+			}
+			result.emoji.push_back(entry);
+			textEnd += length;
+		}
+		result.keyEnds.push_back(keyEnd);
+		result.emojiEnds.push_back(int(result.emoji.size()));
+	}
+	return result;
+}
+
+void WriteLocalIndex(const QString &id, const LangPackIndex &index) {
+	if (!index.version && !index.count()) {
+		return;
+	}
+	CreateCacheFilePath();
+	auto file = QFile(IndexFilePath(id));
+	if (!file.open(QIODevice::WriteOnly)) {
+		return;
+	}
+	auto texts = QString();
+	for (const auto &emoji : index.emoji) {
+		texts.append(emoji.text);
+	}
+	auto stream = QDataStream(&file);
+	stream.setVersion(QDataStream::Qt_5_1);
+	stream
+		<< kIndexFormat
+		<< qint32(index.version)
+		<< qint32(index.maxKeyLength)
+		<< index.keys
+		<< texts
+		<< qint32(index.count());
+	for (auto i = 0; i != index.count(); ++i) {
+		const auto list = index.list(i);
+		stream
+			<< qint32(index.keyEnds[i])
+			<< qint32(list.size());
+		for (const auto &emoji : list) {
+			stream << qint32(emoji.text.size());
+		}
+	}
+}
+
+[[nodiscard]] LangPackIndex ReadLocalIndexOrCache(const QString &id) {
+	if (auto result = ReadLocalIndex(id)) {
+		return std::move(*result);
+	}
+	auto result = CompileIndex(ReadLocalCache(id));
+	WriteLocalIndex(id, result);
+	return result;
+}
+
 [[nodiscard]] QString NormalizeQuery(const QString &query) {
 	return query.toLower();
 }
@@ -164,7 +368,7 @@ void WriteLocalCache(const QString &id, const LangPackData &data) {
 void AppendFoundEmoji(
 		std::vector<Result> &result,
 		const QString &label,
-		const std::vector<LangPackEmoji> &list) {
+		gsl::span<const LangPackEmoji> list) {
 	auto &&add = ranges::view::all(
 		list
 	) | ranges::view::filter([&](const LangPackEmoji &entry) {
@@ -225,11 +429,7 @@ void ApplyDifference(
 			auto &&emoji = ranges::view::all(
 				keyword.vemoticons.v
 			) | ranges::view::transform([](const MTPstring &string) {
-				const auto text = qs(string);
-				const auto emoji = MustAddPostfix(text)
-					? (text + QChar(Ui::Emoji::kPostfix))
-					: text;
-				return LangPackEmoji{ Find(emoji), text };
+				return ParseEmoji(qs(string));
 			}) | ranges::view::filter([&](const LangPackEmoji &entry) {
 				if (!entry.emoji) {
 					LOG(("API Warning: emoji %1 is not supported, word: %2."
@@ -302,12 +502,12 @@ private:
 
 	void readLocalCache();
 	void applyDifference(const MTPEmojiKeywordsDifference &result);
-	void applyData(LangPackData &&data);
+	void applyData(LangPackIndex &&data);
 
 	not_null<Delegate*> _delegate;
 	QString _id;
 	State _state = State::ReadingCache;
-	LangPackData _data;
+	LangPackIndex _data;
 	crl::time _lastRefreshTime = 0;
 	mtpRequestId _requestId = 0;
 	base::binary_guard _guard;
@@ -333,14 +533,14 @@ EmojiKeywords::LangPack::~LangPack() {
 void EmojiKeywords::LangPack::readLocalCache() {
 	const auto id = _id;
 	auto callback = crl::guard(_guard.make_guard(), [=](
-			LangPackData &&result) {
+			LangPackIndex &&result) {
 		applyData(std::move(result));
 		refresh();
 	});
 	crl::async([id, callback = std::move(callback)]() mutable {
 		crl::on_main([
 			callback = std::move(callback),
-			result = ReadLocalCache(id)
+			result = ReadLocalIndexOrCache(id)
 		]() mutable {
 			callback(std::move(result));
 		});
@@ -404,14 +604,17 @@ void EmojiKeywords::LangPack::applyDifference(
 		const auto id = _id;
 		auto copy = _data;
 		auto callback = crl::guard(_guard.make_guard(), [=](
-				LangPackData &&result) {
+				LangPackIndex &&result) {
 			applyData(std::move(result));
 		});
 		crl::async([=, callback = std::move(callback)]() mutable {
-			ApplyDifference(copy, keywords, version);
-			WriteLocalCache(id, copy);
+			auto data = DecompileIndex(copy);
+			ApplyDifference(data, keywords, version);
+			WriteLocalCache(id, data);
+			auto index = CompileIndex(data);
+			WriteLocalIndex(id, index);
 			crl::on_main([
-				result = std::move(copy),
+				result = std::move(index),
 				callback = std::move(callback)
 			]() mutable {
 				callback(std::move(result));
@@ -420,7 +623,7 @@ void EmojiKeywords::LangPack::applyDifference(
 	});
 }
 
-void EmojiKeywords::LangPack::applyData(LangPackData &&data) {
+void EmojiKeywords::LangPack::applyData(LangPackIndex &&data) {
 	_data = std::move(data);
 	_state = State::Refreshed;
 	_delegate->langPackRefreshed();
@@ -440,23 +643,18 @@ std::vector<Result> EmojiKeywords::LangPack::query(
 		const QString &normalized,
 		bool exact) const {
 	if (normalized.size() > _data.maxKeyLength
-		|| _data.emoji.empty()
+		|| !_data.count()
 		|| (exact && SkipExactKeyword(_id, normalized))) {
 		return {};
 	}
 
-	const auto from = _data.emoji.lower_bound(normalized);
-	auto &&chosen = ranges::make_iterator_range(
-		from,
-		end(_data.emoji)
-	) | ranges::view::take_while([&](const auto &pair) {
-		const auto &key = pair.first;
-		return exact ? (key == normalized) : key.startsWith(normalized);
-	});
-
 	auto result = std::vector<Result>();
-	for (const auto &[key, list] : chosen) {
-		AppendFoundEmoji(result, key, list);
+	for (auto i = _data.lowerBound(normalized); i != _data.count(); ++i) {
+		const auto key = _data.key(i);
+		if (exact ? (key != normalized) : !key.startsWith(normalized)) {
+			break;
+		}
+		AppendFoundEmoji(result, key.toString(), _data.list(i));
 	}
 	return result;
 }
@@ -15,6 +15,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/effects/animations.h"
 #include "ui/effects/radial_animation.h"
 #include "ui/emoji_config.h"
+#include "storage/storage_shared_cache.h"
 #include "lang/lang_keys.h"
 #include "base/zlib_help.h"
 #include "layout.h"
@@ -27,6 +28,8 @@ namespace Ui {
 namespace Emoji {
 namespace {
 
+constexpr auto kSharedSetTag = uint64(0x0200000000000000ULL);
+
 struct Available {
 	int size = 0;
 
@@ -79,8 +82,11 @@ public:
 	void destroy();
 
 private:
+	void startDownload();
 	void setImplementation(std::unique_ptr<MTP::DedicatedLoader> loader);
 	void unpack(const QString &path);
+	void unpackShared(QByteArray &&bytes);
+	void unpacked(bool success);
 	void finalize(const QString &path);
 	void fail();
 
@@ -149,6 +155,12 @@ int GetDownloadSize(int id) {
 	return ranges::find(sets, id, &Set::id)->size;
 }
 
+Storage::Cache::Key SharedSetKey(int id) {
+	const auto sets = Sets();
+	const auto i = ranges::find(sets, id, &Set::id);
+	return { kSharedSetTag | uint64(uint32(id)), uint64(uint32(i->postId)) };
+}
+
 MTP::DedicatedLoader::Location GetDownloadLocation(int id) {
 	constexpr auto kUsername = "tdhbcfiles";
 	const auto sets = Sets();
@@ -212,8 +224,7 @@ bool GoodSetPartName(const QString &name) {
 			&& name.endsWith(qstr(".webp")));
 }
 
-bool UnpackSet(const QString &path, const QString &folder) {
-	const auto bytes = ReadFinalFile(path);
+bool UnpackSet(const QByteArray &bytes, const QString &folder) {
 	if (bytes.isEmpty()) {
 		return false;
 	}
@@ -245,6 +256,24 @@ Loader::Loader(QObject *parent, int id)
 , _size(GetDownloadSize(_id))
 , _state(Loading{ 0, _size })
 , _mtproto(Core::App().mtp()) {
+	if (!Storage::SharedCacheEnabled()) {
+		startDownload();
+		return;
+	}
+	const auto weak = make_weak(this);
+	crl::async([=] {
+		auto bytes = Storage::ReadShared(SharedSetKey(id));
+		crl::on_main(weak, [=, bytes = std::move(bytes)]() mutable {
+			if (bytes.isEmpty()) {
+				startDownload();
+			} else {
+				unpackShared(std::move(bytes));
+			}
+		});
+	});
+}
+
+void Loader::startDownload() {
 	const auto ready = [=](std::unique_ptr<MTP::DedicatedLoader> loader) {
 		if (loader) {
 			setImplementation(std::move(loader));
@@ -252,8 +281,8 @@ Loader::Loader(QObject *parent, int id)
 			fail();
 		}
 	};
-	const auto location = GetDownloadLocation(id);
-	const auto folder = internal::SetDataPath(id);
+	const auto location = GetDownloadLocation(_id);
+	const auto folder = internal::SetDataPath(_id);
 	MTP::StartDedicatedLoader(&_mtproto, location, folder, ready);
 }
 
@@ -291,25 +320,52 @@ void Loader::setImplementation(
 
 void Loader::unpack(const QString &path) {
 	const auto folder = internal::SetDataPath(_id);
+	const auto key = SharedSetKey(_id);
 	const auto weak = make_weak(this);
 	crl::async([=] {
-		if (UnpackSet(path, folder)) {
+		const auto bytes = ReadFinalFile(path);
+		const auto success = UnpackSet(bytes, folder);
+		if (success) {
 			QFile(path).remove();
-			SwitchToSet(_id, crl::guard(weak, [=](bool success) {
-				if (success) {
-					destroy();
-				} else {
-					fail();
-				}
-			}));
-		} else {
-			crl::on_main(weak, [=] {
-				fail();
-			});
+			Storage::WriteShared(key, bytes);
 		}
+		crl::on_main(weak, [=] {
+			unpacked(success);
+		});
+	});
+}
+
+void Loader::unpackShared(QByteArray &&bytes) {
+	const auto folder = internal::SetDataPath(_id);
+	const auto weak = make_weak(this);
+	crl::async([=, bytes = std::move(bytes)] {
+		QDir(folder).removeRecursively();
+		const auto success = QDir().mkpath(folder)
+			&& UnpackSet(bytes, folder);
+		crl::on_main(weak, [=] {
+			if (success) {
+				unpacked(true);
+			} else {
+				startDownload();
+			}
+		});
 	});
 }
 
+void Loader::unpacked(bool success) {
+	if (!success) {
+		fail();
+		return;
+	}
+	SwitchToSet(_id, crl::guard(this, [=](bool success) {
+		if (success) {
+			destroy();
+		} else {
+			fail();
+		}
+	}));
+}
+
 void Loader::finalize(const QString &path) {
 }
 
@@ -128,7 +128,7 @@ bool FieldAutocomplete::clearFilteredBotCommands() {
 namespace {
 template <typename T, typename U>
 inline int indexOfInFirstN(const T &v, const U &elem, int last) {
-	for (auto b = v.cbegin(), i = b, e = b + qMax(v.size(), last); i != e; ++i) {
+	for (auto b = v.cbegin(), i = b, e = b + qMin(v.size(), last); i != e; ++i) {
 		if (*i == elem) {
 			return (i - b);
 		}
@@ -138,7 +138,7 @@ inline int indexOfInFirstN(const T &v, const U &elem, int last) {
 }
 
 void FieldAutocomplete::updateFiltered(bool resetScroll) {
-	int32 now = unixtime(), recentInlineBots = 0;
+	auto recentInlineBots = 0;
 	internal::MentionRows mrows;
 	internal::HashtagRows hrows;
 	internal::BotCommandRows brows;
@@ -146,87 +146,32 @@ void FieldAutocomplete::updateFiltered(bool resetScroll) {
 	if (_emoji) {
 		srows = Stickers::GetListByEmoji(_emoji, _stickersSeed);
 	} else if (_type == Type::Mentions) {
-		int maxListSize = _addInlineBots ? cRecentInlineBots().size() : 0;
-		if (_chat) {
-			maxListSize += (_chat->participants.empty() ? _chat->lastAuthors.size() : _chat->participants.size());
-		} else if (_channel && _channel->isMegagroup()) {
-			if (_channel->mgInfo->lastParticipants.empty() || _channel->lastParticipantsCountOutdated()) {
-			} else {
-				maxListSize += _channel->mgInfo->lastParticipants.size();
-			}
-		}
-		if (maxListSize) {
-			mrows.reserve(maxListSize);
+		const auto sourceSize = mentionsSourceSize();
+		const auto extendsCached = (_mentionsCache.peer == peer())
+			&& (_mentionsCache.addInlineBots == _addInlineBots)
+			&& (_mentionsCache.sourceSize == sourceSize)
+			&& (_filter.size() > _mentionsCache.filter.size())
+			&& _filter.startsWith(_mentionsCache.filter);
+		if (extendsCached) {
+			filterMentionsCache();
+		} else {
+			fillMentionsCache();
+			_mentionsCache.sourceSize = sourceSize;
 		}
 
-		auto filterNotPassedByUsername = [this](UserData *user) -> bool {
-			if (user->username.startsWith(_filter, Qt::CaseInsensitive)) {
-				bool exactUsername = (user->username.size() == _filter.size());
-				return exactUsername;
-			}
-			return true;
-		};
-		auto filterNotPassedByName = [&](UserData *user) -> bool {
-			for (const auto &nameWord : user->nameWords()) {
-				if (nameWord.startsWith(_filter, Qt::CaseInsensitive)) {
-					auto exactUsername = (user->username.compare(_filter, Qt::CaseInsensitive) == 0);
-					return exactUsername;
-				}
-			}
-			return filterNotPassedByUsername(user);
+		// Users with exactly the typed username are not suggested.
+		const auto exactUsername = [&](not_null<UserData*> user) {
+			return !_filter.isEmpty()
+				&& !user->username.compare(_filter, Qt::CaseInsensitive);
 		};
-
-		bool listAllSuggestions = _filter.isEmpty();
-		if (_addInlineBots) {
-			for_const (auto user, cRecentInlineBots()) {
-				if (user->isInaccessible()) continue;
-				if (!listAllSuggestions && filterNotPassedByUsername(user)) continue;
-				mrows.push_back(user);
-				++recentInlineBots;
-			}
-		}
-		if (_chat) {
-			auto ordered = QMultiMap<TimeId, not_null<UserData*>>();
-			const auto byOnline = [&](not_null<UserData*> user) {
-				return Data::SortByOnlineValue(user, now);
-			};
-			mrows.reserve(mrows.size() + (_chat->participants.empty() ? _chat->lastAuthors.size() : _chat->participants.size()));
-			if (_chat->noParticipantInfo()) {
-				Auth().api().requestFullPeer(_chat);
-			} else if (!_chat->participants.empty()) {
-				for (const auto user : _chat->participants) {
-					if (user->isInaccessible()) continue;
-					if (!listAllSuggestions && filterNotPassedByName(user)) continue;
-					if (indexOfInFirstN(mrows, user, recentInlineBots) >= 0) continue;
-					ordered.insertMulti(byOnline(user), user);
-				}
-			}
-			for (const auto user : _chat->lastAuthors) {
-				if (user->isInaccessible()) continue;
-				if (!listAllSuggestions && filterNotPassedByName(user)) continue;
-				if (indexOfInFirstN(mrows, user, recentInlineBots) >= 0) continue;
+		const auto &users = _mentionsCache.users;
+		mrows.reserve(users.size());
+		for (auto i = 0, count = users.size(); i != count; ++i) {
+			const auto user = users[i];
+			if (!exactUsername(user)) {
 				mrows.push_back(user);
-				if (!ordered.isEmpty()) {
-					ordered.remove(byOnline(user), user);
-				}
-			}
-			if (!ordered.isEmpty()) {
-				for (auto i = ordered.cend(), b = ordered.cbegin(); i != b;) {
-					--i;
-					mrows.push_back(i.value());
-				}
-			}
-		} else if (_channel && _channel->isMegagroup()) {
-			QMultiMap<int32, UserData*> ordered;
-			if (_channel->mgInfo->lastParticipants.empty() || _channel->lastParticipantsCountOutdated()) {
-				Auth().api().requestLastParticipants(_channel);
-			} else {
-				mrows.reserve(mrows.size() + _channel->mgInfo->lastParticipants.size());
-				for (const auto user : _channel->mgInfo->lastParticipants) {
-					if (user->isInaccessible()) continue;
-					if (!listAllSuggestions && filterNotPassedByName(user)) continue;
-					if (indexOfInFirstN(mrows, user, recentInlineBots) >= 0) continue;
-					mrows.push_back(user);
+				if (i < _mentionsCache.recentInlineBots) {
+					++recentInlineBots;
 				}
 			}
 		}
@@ -330,6 +275,134 @@ void FieldAutocomplete::updateFiltered(bool resetScroll) {
 	_inner->setRecentInlineBotsInRows(recentInlineBots);
 }
 
+PeerData *FieldAutocomplete::peer() const {
+	if (_chat) {
+		return _chat;
+	} else if (_channel) {
+		return _channel;
+	}
+	return _user;
+}
+
+int FieldAutocomplete::mentionsSourceSize() const {
+	auto result = _addInlineBots ? cRecentInlineBots().size() : 0;
+	if (_chat) {
+		result += _chat->participants.size() + _chat->lastAuthors.size();
+	} else if (_channel && _channel->isMegagroup()) {
+		result += _channel->mgInfo->lastParticipants.size();
+	}
+	return result;
+}
+
+bool FieldAutocomplete::mentionFilterPassedByUsername(
+		not_null<UserData*> user) const {
+	return _filter.isEmpty()
+		|| user->username.startsWith(_filter, Qt::CaseInsensitive);
+}
+
+bool FieldAutocomplete::mentionFilterPassedByName(
+		not_null<UserData*> user) const {
+	if (mentionFilterPassedByUsername(user)) {
+		return true;
+	}
+	for (const auto &nameWord : user->nameWords()) {
+		if (nameWord.startsWith(_filter, Qt::CaseInsensitive)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void FieldAutocomplete::filterMentionsCache() {
+	auto &cache = _mentionsCache;
+	auto users = internal::MentionRows();
+	auto recentInlineBots = 0;
+	users.reserve(cache.users.size());
+	for (auto i = 0, count = cache.users.size(); i != count; ++i) {
+		const auto user = cache.users[i];
+		const auto bot = (i < cache.recentInlineBots);
+		if (bot
+			? mentionFilterPassedByUsername(user)
+			: mentionFilterPassedByName(user)) {
+			users.push_back(user);
+			if (bot) {
+				++recentInlineBots;
+			}
+		}
+	}
+	cache.users = std::move(users);
+	cache.recentInlineBots = recentInlineBots;
+	cache.filter = _filter;
+}
+
+void FieldAutocomplete::fillMentionsCache() {
+	const auto now = unixtime();
+	auto &cache = _mentionsCache;
+	cache.peer = peer();
+	cache.filter = _filter;
+	cache.addInlineBots = _addInlineBots;
+	cache.users.clear();
+	cache.recentInlineBots = 0;
+
+	auto &users = cache.users;
+	if (_addInlineBots) {
+		for_const (auto user, cRecentInlineBots()) {
+			if (user->isInaccessible()) continue;
+			if (!mentionFilterPassedByUsername(user)) continue;
+			users.push_back(user);
+			++cache.recentInlineBots;
+		}
+	}
+	const auto recentInlineBots = cache.recentInlineBots;
+	const auto isRecentInlineBot = [&](not_null<UserData*> user) {
+		return (indexOfInFirstN(users, user, recentInlineBots) >= 0);
+	};
+	if (_chat) {
+		auto ordered = QMultiMap<TimeId, not_null<UserData*>>();
+		const auto byOnline = [&](not_null<UserData*> user) {
+			return Data::SortByOnlineValue(user, now);
+		};
+		users.reserve(users.size() + (_chat->participants.empty() ? _chat->lastAuthors.size() : _chat->participants.size()));
+		if (_chat->noParticipantInfo()) {
+			Auth().api().requestFullPeer(_chat);
+		} else if (!_chat->participants.empty()) {
+			for (const auto user : _chat->participants) {
+				if (user->isInaccessible()) continue;
+				if (!mentionFilterPassedByName(user)) continue;
+				if (isRecentInlineBot(user)) continue;
+				ordered.insertMulti(byOnline(user), user);
+			}
+		}
+		for (const auto user : _chat->lastAuthors) {
+			if (user->isInaccessible()) continue;
+			if (!mentionFilterPassedByName(user)) continue;
+			if (isRecentInlineBot(user)) continue;
+			users.push_back(user);
+			if (!ordered.isEmpty()) {
+				ordered.remove(byOnline(user), user);
+			}
+		}
+		if (!ordered.isEmpty()) {
+			for (auto i = ordered.cend(), b = ordered.cbegin(); i != b;) {
+				--i;
+				users.push_back(i.value());
+			}
+		}
+	} else if (_channel && _channel->isMegagroup()) {
+		if (_channel->mgInfo->lastParticipants.empty() || _channel->lastParticipantsCountOutdated()) {
+			Auth().api().requestLastParticipants(_channel);
+		} else {
+			users.reserve(users.size() + _channel->mgInfo->lastParticipants.size());
+			for (const auto user : _channel->mgInfo->lastParticipants) {
+				if (user->isInaccessible()) continue;
+				if (!mentionFilterPassedByName(user)) continue;
+				if (isRecentInlineBot(user)) continue;
+				users.push_back(user);
+			}
+		}
+	}
+}
+
 void FieldAutocomplete::rowsUpdated(const internal::MentionRows &mrows, const internal::HashtagRows &hrows, const internal::BotCommandRows &brows, const internal::StickerRows &srows, bool resetScroll) {
 	if (mrows.isEmpty() && hrows.isEmpty() && brows.isEmpty() && srows.empty()) {
 		if (!isHidden()) {
@@ -94,6 +94,13 @@ private:
 	void updateFiltered(bool resetScroll = false);
 	void recount(bool resetScroll = false);
 
+	PeerData *peer() const;
+	int mentionsSourceSize() const;
+	bool mentionFilterPassedByUsername(not_null<UserData*> user) const;
+	bool mentionFilterPassedByName(not_null<UserData*> user) const;
+	void fillMentionsCache();
+	void filterMentionsCache();
+
 	QPixmap _cache;
 	internal::MentionRows _mrows;
 	internal::HashtagRows _hrows;
@@ -118,6 +125,18 @@ private:
 	};
 	Type _type = Type::Mentions;
 	QString _filter;
+
+	// Users matching the filter by a prefix, a longer filter only
+	// needs to check these instead of all the chat participants.
+	struct MentionsCache {
+		PeerData *peer = nullptr;
+		QString filter;
+		bool addInlineBots = false;
+		int sourceSize = 0;
+		internal::MentionRows users;
+		int recentInlineBots = 0;
+	};
+	MentionsCache _mentionsCache;
 	QRect _boundings;
 	bool _addInlineBots;
 
@@ -36,6 +36,7 @@ namespace {
 constexpr auto kInlineItemsMaxPerRow = 5;
 constexpr auto kSearchRequestDelay = 400;
 constexpr auto kRecentDisplayLimit = 20;
+constexpr auto kPreloadScreensCount = 1;
 
 bool SetInMyList(MTPDstickerSet::Flags flags) {
 	return (flags & MTPDstickerSet::Flag::f_installed_date)
@@ -753,9 +754,47 @@ void StickersListWidget::visibleTopBottomUpdated(
 	if (_section == Section::Featured) {
 		readVisibleSets();
 	}
+	preloadAround(visibleTop, visibleBottom);
 	validateSelectedIcon(ValidateIconAnimations::Full);
 }
 
+void StickersListWidget::preloadAround(int visibleTop, int visibleBottom) {
+	const auto skip = (visibleBottom - visibleTop) * kPreloadScreensCount;
+	const auto from = visibleTop - skip;
+	const auto till = visibleBottom + skip;
+	if (till <= from) {
+		return;
+	}
+	const auto &sets = shownSets();
+	enumerateSections([&](const SectionInfo &info) {
+		if (info.rowsBottom <= from) {
+			return true;
+		} else if (info.rowsTop >= till) {
+			return false;
+		}
+		const auto &pack = sets[info.section].pack;
+		const auto rowHeight = _singleSize.height();
+		const auto fromRow = floorclamp(
+			from - info.rowsTop,
+			rowHeight,
+			0,
+			info.rowsCount);
+		const auto tillRow = ceilclamp(
+			till - info.rowsTop,
+			rowHeight,
+			0,
+			info.rowsCount);
+		const auto count = std::min(tillRow * _columnCount, int(pack.size()));
+		for (auto i = fromRow * _columnCount; i < count; ++i) {
+			const auto document = pack[i];
+			if (document && document->sticker()) {
+				document->checkStickerSmall();
+			}
+		}
+		return true;
+	});
+}
+
 void StickersListWidget::readVisibleSets() {
 	auto itemsVisibleTop = getVisibleTop();
 	auto itemsVisibleBottom = getVisibleBottom();
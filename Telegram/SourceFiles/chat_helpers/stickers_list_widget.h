@@ -198,6 +198,7 @@ private:
 	const std::vector<Set> &shownSets() const;
 	int featuredRowHeight() const;
 	void readVisibleSets();
+	void preloadAround(int visibleTop, int visibleBottom);
 
 	void paintFeaturedStickers(Painter &p, QRect clip);
 	void paintStickers(Painter &p, QRect clip);
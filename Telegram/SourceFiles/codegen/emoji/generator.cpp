@@ -14,6 +14,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <QtGui/QImage>
 #include <QtGui/QPainter>
 #include <QtCore/QDir>
+#include <array>
 
 #ifdef SUPPORT_IMAGE_GENERATION
 Q_IMPORT_PLUGIN(QWebpPlugin)
@@ -340,6 +341,9 @@ std::vector<One> Items;\n\
 		return false;
 	}
 	source_->popNamespace().newline().pushNamespace("internal");
+	if (!writeFindStarts()) {
+		return false;
+	}
 	source_->stream() << "\
 \n\
 int FullCount() {\n\
@@ -406,6 +410,15 @@ EmojiPtr ByIndex(int index);\n\
 \n\
 EmojiPtr Find(const QChar *ch, const QChar *end, int *outLength = nullptr);\n\
 \n\
+// Two-level bitmap of the code units that can start an emoji.\n\
+extern const uchar FindStartPages[256];\n\
+extern const uint32 FindStartBits[];\n\
+\n\
+inline bool IsFindStart(ushort code) {\n\
+	const auto page = FindStartPages[code >> 8];\n\
+	return page && (FindStartBits[(page - 1) * 8 + ((code & 0xFF) >> 5)] & (1U << (code & 0x1F)));\n\
+}\n\
+\n\
 inline bool IsReplaceEdge(const QChar *ch) {\n\
 	return true;\n\
 \n\
@@ -651,6 +664,41 @@ int FindIndex(const QChar *start, const QChar *end, int *outLength) {\n\
 	return true;
 }
 
+bool Generator::writeFindStarts() {
+	auto pages = std::map<int, std::array<uint32, 8>>();
+	for (const auto &item : data_.map) {
+		const auto code = item.first[0].unicode();
+		pages[code >> 8][(code & 0xFF) >> 5] |= (1U << (code & 0x1F));
+	}
+	if (pages.size() >= 256) {
+		logDataError() << "Too many emoji start pages.";
+		return false;
+	}
+
+	source_->stream() << "\
+\n\
+const uchar FindStartPages[256] = {";
+	startBinary();
+	for (auto page = 0; page != 256; ++page) {
+		const auto i = pages.find(page);
+		writeIntBinary(
+			source_.get(),
+			(i != end(pages)) ? int(std::distance(begin(pages), i) + 1) : 0);
+	}
+	source_->stream() << " };\n\
+\n\
+const uint32 FindStartBits[] = {";
+	startBinary();
+	for (const auto &page : pages) {
+		for (const auto part : page.second) {
+			writeUintBinary(source_.get(), part);
+		}
+	}
+	source_->stream() << " };\n";
+
+	return true;
+}
+
 bool Generator::writeFindFromDictionary(
 		const std::map<QString, int, std::greater<QString>> &dictionary,
 		bool skipPostfixes,
@@ -48,6 +48,7 @@ private:
 	bool writeGetSections();
 	bool writeFindReplace();
 	bool writeFind();
+	bool writeFindStarts();
 	bool writeFindFromDictionary(
 		const std::map<QString, int, std::greater<QString>> &dictionary,
 		bool skipPostfixes = false,
@@ -143,19 +143,22 @@ QString lang(LangKey key);\n\
 		auto genericParams = QStringList();
 		auto params = QStringList();
 		auto applyTags = QStringList();
+		auto replacements = QStringList();
 		auto plural = QString();
 		auto nonPluralTagFound = false;
 		for (auto &tagData : entry.tags) {
 			auto &tag = tagData.tag;
 			auto isPluralTag = isPlural && (tag == kPluralTags[0]);
 			genericParams.push_back("lngtag_" + tag + (isPluralTag ? " type" : "") + ", " + (isPluralTag ? "float64 " : "const ResultString &") + tag + "__val");
-			params.push_back("lngtag_" + tag + ", " + (isPluralTag ? "float64 " : "const QString &") + tag + "__val");
+			params.push_back("lngtag_" + tag + (isPluralTag ? " type" : "") + ", " + (isPluralTag ? "float64 " : "const QString &") + tag + "__val");
 			if (isPluralTag) {
 				plural = "\tauto plural = Lang::Plural(" + key + ", " + tag + "__val, type);\n";
 				applyTags.push_back("\tresult = Lang::ReplaceTag<ResultString>::Call(std::move(result), lt_" + tag + ", Lang::StartReplacements<ResultString>::Call(std::move(plural.replacement)));\n");
+				replacements.push_back("{ lt_" + tag + ", plural.replacement }");
 			} else {
 				nonPluralTagFound = true;
 				applyTags.push_back("\tresult = Lang::ReplaceTag<ResultString>::Call(std::move(result), lt_" + tag + ", " + tag + "__val);\n");
+				replacements.push_back("{ lt_" + tag + ", " + tag + "__val }");
 			}
 		}
 		if (!entry.tags.empty() && (!isPlural || key == ComputePluralKey(entry.keyBase, 0))) {
@@ -168,6 +171,11 @@ inline ResultString " << (isPlural ? entry.keyBase : key) << "__generic(" << gen
 " << applyTags.join(QString()) << "\
 	return result;\n\
 }\n\
+template <>\n\
+inline QString " << (isPlural ? entry.keyBase : key) << "__generic<QString>(" << params.join(QString(", ")) << ") {\n\
+" << plural << "\
+	return Lang::ReplaceTags(" << initialString << ", { " << replacements.join(QString(", ")) << " });\n\
+}\n\
 constexpr auto " << (isPlural ? entry.keyBase : key) << " = &" << (isPlural ? entry.keyBase : key) << "__generic<QString>;\n\
 \n";
 		}
@@ -18,6 +18,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/sandbox.h"
 #include "core/local_url_handlers.h"
 #include "core/launcher.h"
+#include "core/startup_trace.h"
+#include "core/init_scheduler.h"
 #include "chat_helpers/emoji_keywords.h"
 #include "storage/localstorage.h"
 #include "platform/platform_specific.h"
@@ -47,8 +49,11 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/history_location_manager.h"
 #include "ui/widgets/tooltip.h"
 #include "ui/image/image.h"
+#include "core/media_active_cache.h"
 #include "ui/text_options.h"
 #include "ui/emoji_config.h"
+#include "lottie/lottie_frame_cache.h"
+#include "base/memory_usage.h"
 #include "ui/effects/animations.h"
 #include "storage/serialize_common.h"
 #include "window/window_controller.h"
@@ -63,6 +68,10 @@ namespace Core {
 namespace {
 
 constexpr auto kQuitPreventTimeoutMs = 1500;
+constexpr auto kMemoryPressureCheckTimeout = 10 * crl::time(1000);
+
+// When the system is low on memory we keep only this part of the media.
+constexpr auto kMemoryPressureMediaDivider = 4;
 
 } // namespace
 
@@ -76,12 +85,14 @@ struct Application::Private {
 	MTP::Instance::Config mtpConfig;
 	MTP::AuthKeysList mtpKeysToDestroy;
 	base::Timer quitTimer;
+	base::Timer memoryPressureTimer;
 };
 
 Application::Application(not_null<Launcher*> launcher)
 : QObject()
 , _launcher(launcher)
 , _private(std::make_unique<Private>())
+, _initScheduler(std::make_unique<InitScheduler>())
 , _databases(std::make_unique<Storage::Databases>())
 , _animationsManager(std::make_unique<Ui::Animations::Manager>())
 , _langpack(std::make_unique<Lang::Instance>())
@@ -131,6 +142,8 @@ Application::~Application() {
 }
 
 void Application::run() {
+	const auto trace = StartupTrace::Scope("Application::run");
+
 	Fonts::Start();
 
 	ThirdParty::start();
@@ -152,10 +165,16 @@ void Application::run() {
 	_translator = std::make_unique<Lang::Translator>();
 	QCoreApplication::instance()->installTranslator(_translator.get());
 
-	style::startManager();
-	Ui::InitTextOptions();
-	Ui::Emoji::Init();
-	Media::Player::start(_audio.get());
+	{
+		const auto trace = StartupTrace::Scope("Application::initUi");
+		style::startManager();
+		Ui::InitTextOptions();
+		Ui::Emoji::Init();
+		Media::Player::start(_audio.get());
+		base::memory::SetTrim(
+			base::memory::Tag::LottieCaches,
+			Lottie::FrameCache::ClearUnused);
+	}
 
 	DEBUG_LOG(("Application Info: inited..."));
 
@@ -166,15 +185,27 @@ void Application::run() {
 
 	DEBUG_LOG(("Application Info: starting app..."));
 
-	// Create mime database, so it won't be slow later.
-	QMimeDatabase().mimeTypeForName(qsl("text/plain"));
+	using Priority = InitScheduler::Priority;
+	_initScheduler->add({
+		"mime",
+		Priority::Low,
+		{},
+		true,
+		[] {
+			// Create mime database, so it won't be slow later.
+			QMimeDatabase().mimeTypeForName(qsl("text/plain"));
+		}
+	});
 
-	_window = std::make_unique<MainWindow>();
-	_window->init();
+	{
+		const auto trace = StartupTrace::Scope("Application::createWindow");
+		_window = std::make_unique<MainWindow>();
+		_window->init();
 
-	auto currentGeometry = _window->geometry();
-	_mediaView = std::make_unique<Media::View::OverlayWidget>();
-	_window->setGeometry(currentGeometry);
+		auto currentGeometry = _window->geometry();
+		_mediaView = std::make_unique<Media::View::OverlayWidget>();
+		_window->setGeometry(currentGeometry);
+	}
 
 	QCoreApplication::instance()->installEventFilter(this);
 	connect(
@@ -185,7 +216,12 @@ void Application::run() {
 
 	DEBUG_LOG(("Application Info: window created..."));
 
-	startShortcuts();
+	_initScheduler->add({ "shortcuts", Priority::High, {}, false, [=] {
+		startShortcuts();
+		for (const auto &error : Shortcuts::Errors()) {
+			LOG(("Shortcuts Error: %1").arg(error));
+		}
+	} });
 	App::initMedia();
 
 	Local::ReadMapState state = Local::readMap(QByteArray());
@@ -198,6 +234,7 @@ void Application::run() {
 		DEBUG_LOG(("Application Info: local map read..."));
 		startMtp();
 		DEBUG_LOG(("Application Info: MTP started..."));
+		const auto trace = StartupTrace::Scope("Application::setupWindow");
 		if (AuthSession::Exists()) {
 			_window->setupMain();
 		} else {
@@ -205,7 +242,11 @@ void Application::run() {
 		}
 	}
 	DEBUG_LOG(("Application Info: showing."));
-	_window->firstShow();
+	{
+		const auto trace = StartupTrace::Scope("Application::firstShow");
+		_window->firstShow();
+	}
+	_initScheduler->start();
 
 	if (!locked() && cStartToSettings()) {
 		_window->showSettings();
@@ -213,8 +254,23 @@ void Application::run() {
 
 	_window->updateIsActive(Global::OnlineFocusTimeout());
 
-	for (const auto &error : Shortcuts::Errors()) {
-		LOG(("Shortcuts Error: %1").arg(error));
+	_initScheduler->add({ "memory", Priority::Low, {}, false, [=] {
+		_private->memoryPressureTimer.setCallback([=] {
+			checkMemoryPressure();
+		});
+		_private->memoryPressureTimer.callEach(
+			kMemoryPressureCheckTimeout);
+	} });
+
+	if (StartupTrace::Enabled()) {
+		// Let the deferred initialization finish before the trace is written.
+		_initScheduler->add({
+			"trace",
+			Priority::Low,
+			{ "mime", "shortcuts", "memory" },
+			false,
+			[] { StartupTrace::Finish(); }
+		});
 	}
 }
 
@@ -631,6 +687,7 @@ void Application::resetAuthorizationKeys() {
 }
 
 void Application::startLocalStorage() {
+	const auto trace = StartupTrace::Scope("Application::startLocalStorage");
 	_dcOptions = std::make_unique<MTP::DcOptions>();
 	_dcOptions->constructFromBuiltIn();
 	Local::start();
@@ -690,6 +747,18 @@ void Application::checkLocalTime() {
 	}
 }
 
+void Application::checkMemoryPressure() {
+	if (!Platform::SystemMemoryIsLow()) {
+		return;
+	}
+	const auto usage = MediaMemoryUsage();
+	ReduceMediaMemory(usage / kMemoryPressureMediaDivider);
+	LOG(("Memory Info: system memory is low, media cache reduced "
+		"from %1 to %2 bytes."
+		).arg(usage
+		).arg(MediaMemoryUsage()));
+}
+
 void Application::stateChanged(Qt::ApplicationState state) {
 	if (state == Qt::ApplicationActive) {
 		handleAppActivated();
@@ -766,7 +835,10 @@ void Application::writeInstallBetaVersionsSetting() {
 void Application::authSessionCreate(const MTPUser &user) {
 	Expects(_mtproto != nullptr);
 
-	_authSession = std::make_unique<AuthSession>(user);
+	{
+		const auto trace = StartupTrace::Scope("Application::createAuthSession");
+		_authSession = std::make_unique<AuthSession>(user);
+	}
 	_mtproto->setUpdatesHandler(::rpcDone([](
 			const mtpPrime *from,
 			const mtpPrime *end) {
@@ -66,6 +66,7 @@ class CloudManager;
 namespace Core {
 
 class Launcher;
+class InitScheduler;
 struct LocalUrlHandler;
 
 class Application final : public QObject, private base::Subscriber {
@@ -176,6 +177,11 @@ public:
 		return *_emojiKeywords;
 	}
 
+	// Initialization that can wait till the first window is shown.
+	InitScheduler &initScheduler() {
+		return *_initScheduler;
+	}
+
 	// Internal links.
 	void setInternalLinkDomain(const QString &domain) const;
 	QString createInternalLink(const QString &query) const;
@@ -247,6 +253,7 @@ private:
 	void startShortcuts();
 
 	void stateChanged(Qt::ApplicationState state);
+	void checkMemoryPressure();
 
 	friend void App::quit();
 	static void QuitAttempt();
@@ -264,6 +271,7 @@ private:
 	// Some fields are just moved from the declaration.
 	struct Private;
 	const std::unique_ptr<Private> _private;
+	const std::unique_ptr<InitScheduler> _initScheduler;
 
 	QWidget _globalShortcutParent;
 
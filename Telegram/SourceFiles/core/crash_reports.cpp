@@ -10,6 +10,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "platform/platform_specific.h"
 #include "platform/platform_info.h"
 #include "core/launcher.h"
+#include "base/trace.h"
 
 #include <signal.h>
 #include <new>
@@ -140,6 +141,21 @@ QMutex ReportingMutex;
 const char *BreakpadDumpPath = nullptr;
 const wchar_t *BreakpadDumpPathW = nullptr;
 
+void DumpFlightEvent(const base::trace::FlightEvent &event) {
+	dump() << event.thread << " ";
+	if (event.threadName) {
+		dump() << event.threadName << " ";
+	}
+	const char type[] = { event.type, ' ', 0 };
+	dump() << "-" << uint64(event.ago) << "us " << type;
+	dump() << event.category << " " << event.name << " ";
+	if (event.value < 0) {
+		dump() << "-" << uint64(-event.value) << "\n";
+	} else {
+		dump() << uint64(event.value) << "\n";
+	}
+}
+
 #if defined Q_OS_MAC || defined Q_OS_LINUX32 || defined Q_OS_LINUX64
 struct sigaction SIG_def[32];
 
@@ -280,8 +296,13 @@ void SignalHandler(int signum) {
 	dump() << "\nBacktrace omitted.\n";
 #endif // else for Q_OS_MAC || Q_OS_LINUX32 || Q_OS_LINUX64
 
+	dump() << "\nRecent events:\n";
+	base::trace::DumpFlight(DumpFlightEvent);
+
 	dump() << "\n";
 
+	Logs::flushOnCrash();
+
 	ReportingThreadId = nullptr;
 }
 
@@ -0,0 +1,106 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/init_scheduler.h"
+
+#include "base/trace.h"
+
+namespace Core {
+namespace {
+
+// Zero timeout timers fire when the event queue is empty.
+constexpr auto kIdleTimeout = crl::time(0);
+
+bool Contains(const std::vector<const char*> &list, const char *name) {
+	return ranges::find_if(list, [&](const char *already) {
+		return !qstrcmp(already, name);
+	}) != end(list);
+}
+
+} // namespace
+
+InitScheduler::InitScheduler() : _timer([=] { runNext(); }) {
+}
+
+void InitScheduler::add(Task &&task) {
+	Expects(task.name != nullptr);
+	Expects(task.method != nullptr);
+
+	_tasks.push_back(std::move(task));
+	schedule();
+}
+
+void InitScheduler::start() {
+	_started = true;
+	schedule();
+}
+
+bool InitScheduler::finished(const char *name) const {
+	return Contains(_finished, name);
+}
+
+bool InitScheduler::ready(const Task &task) const {
+	return ranges::all_of(task.dependencies, [&](const char *name) {
+		return finished(name);
+	});
+}
+
+void InitScheduler::schedule() {
+	if (_started && !_tasks.empty() && !_timer.isActive()) {
+		_timer.callOnce(kIdleTimeout);
+	}
+}
+
+void InitScheduler::runNext() {
+	auto next = end(_tasks);
+	for (auto i = begin(_tasks); i != end(_tasks); ++i) {
+		if ((next == end(_tasks) || i->priority < next->priority)
+			&& ready(*i)) {
+			next = i;
+		}
+	}
+	if (next == end(_tasks)) {
+		if (!_running.empty()) {
+			return;
+		}
+		next = begin(_tasks);
+		LOG(("Init Error: dependencies of '%1' are never finished."
+			).arg(next->name));
+	}
+	auto task = std::move(*next);
+	_tasks.erase(next);
+
+	const auto name = task.name;
+	if (task.worker) {
+		_running.push_back(name);
+		const auto weak = base::make_weak(this);
+		crl::async([=, method = std::move(task.method)]() mutable {
+			{
+				const auto span = base::trace::Span(name, "init");
+				method();
+			}
+			crl::on_main(weak, [=] {
+				_running.erase(ranges::remove(_running, name), end(_running));
+				markFinished(name);
+			});
+		});
+	} else {
+		{
+			const auto span = base::trace::Span(name, "init");
+			task.method();
+		}
+		markFinished(name);
+	}
+	schedule();
+}
+
+void InitScheduler::markFinished(const char *name) {
+	_finished.push_back(name);
+	schedule();
+}
+
+} // namespace Core
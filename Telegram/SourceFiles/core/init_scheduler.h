@@ -0,0 +1,59 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/timer.h"
+#include "base/weak_ptr.h"
+
+namespace Core {
+
+// Initialization that is not required for the first paint. Tasks run one
+// by one when the event queue is empty, the ready task of the highest
+// priority goes first. Worker tasks run in the background and only the
+// tasks that depend on them wait for them.
+class InitScheduler final : public base::has_weak_ptr {
+public:
+	enum class Priority {
+		High,
+		Normal,
+		Low,
+	};
+
+	struct Task {
+		// Static literal, it is used as a trace span name.
+		const char *name = nullptr;
+		Priority priority = Priority::Normal;
+		std::vector<const char*> dependencies;
+		bool worker = false;
+		FnMut<void()> method;
+	};
+
+	InitScheduler();
+
+	void add(Task &&task);
+
+	// Nothing runs till the first window is shown.
+	void start();
+
+	[[nodiscard]] bool finished(const char *name) const;
+
+private:
+	[[nodiscard]] bool ready(const Task &task) const;
+	void schedule();
+	void runNext();
+	void markFinished(const char *name);
+
+	std::vector<Task> _tasks;
+	std::vector<const char*> _finished;
+	std::vector<const char*> _running;
+	base::Timer _timer;
+	bool _started = false;
+
+};
+
+} // namespace Core
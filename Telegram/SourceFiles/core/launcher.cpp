@@ -14,6 +14,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/main_queue_processor.h"
 #include "core/update_checker.h"
 #include "core/sandbox.h"
+#include "core/startup_trace.h"
 #include "base/concurrent_timer.h"
 
 namespace Core {
@@ -265,14 +266,20 @@ int Launcher::exec() {
 		return psCleanup();
 	}
 
-	// both are finished in Sandbox::closeApplication
-	Logs::start(this); // must be started before Platform is started
-	Platform::start(); // must be started before Sandbox is created
+	{
+		const auto trace = StartupTrace::Scope("Launcher::start");
+
+		// both are finished in Sandbox::closeApplication
+		Logs::start(this); // must be started before Platform is started
+		Platform::start(); // must be started before Sandbox is created
+	}
 
 	auto result = executeApplication();
 
 	DEBUG_LOG(("Telegram finished, result: %1").arg(result));
 
+	StartupTrace::Finish();
+
 	if (!UpdaterDisabled() && cRestartingUpdate()) {
 		DEBUG_LOG(("Sandbox Info: executing updater to install update."));
 		if (!launchUpdater(UpdaterLaunch::PerformUpdate)) {
@@ -387,8 +394,10 @@ void Launcher::processArguments() {
 		{ "-startintray"    , KeyFormat::NoValues },
 		{ "-sendpath"       , KeyFormat::AllLeftValues },
 		{ "-workdir"        , KeyFormat::OneValue },
+		{ "-sharedcache"    , KeyFormat::OneValue },
 		{ "--"              , KeyFormat::OneValue },
 		{ "-scale"          , KeyFormat::OneValue },
+		{ "-tracestartup"   , KeyFormat::NoValues },
 	};
 	auto parseResult = QMap<QByteArray, QStringList>();
 	auto parsingKey = QByteArray();
@@ -416,6 +425,9 @@ void Launcher::processArguments() {
 	if (parseResult.contains("-externalupdater")) {
 		SetUpdaterDisabledAtStartup();
 	}
+	if (parseResult.contains("-tracestartup")) {
+		StartupTrace::Enable();
+	}
 	gTestMode = parseResult.contains("-testmode");
 	Logs::SetDebugEnabled(parseResult.contains("-debug"));
 	gManyInstance = parseResult.contains("-many");
@@ -437,6 +449,7 @@ void Launcher::processArguments() {
 			gWorkingDir = QString();
 		}
 	}
+	gSharedCacheDir = parseResult.value("-sharedcache", {}).join(QString());
 	gStartUrl = parseResult.value("--", {}).join(QString());
 
 	const auto scaleKey = parseResult.value("-scale", {});
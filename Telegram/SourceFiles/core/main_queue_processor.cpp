@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/main_queue_processor.h"
 
 #include "core/sandbox.h"
+#include "base/trace.h"
 
 namespace Core {
 namespace {
@@ -18,26 +19,91 @@ MainQueueProcessor *ProcessorInstance/* = nullptr*/;
 constexpr auto kProcessorEvent = QEvent::Type(QEvent::User + 1);
 static_assert(kProcessorEvent < QEvent::MaxUser);
 
-class ProcessorEvent : public QEvent {
-public:
-	ProcessorEvent(void (*callable)(void*), void *argument);
+// The rest of a long queue is left for the next event loop iteration,
+// so that input and painting are not blocked by a burst of callbacks.
+constexpr auto kProcessSliceTime = crl::time(8);
 
-	void process();
+struct QueuedCall {
+	void (*callable)(void*) = nullptr;
+	void *argument = nullptr;
+	crl::time posted = 0;
+	QueuedCall *next = nullptr;
+};
 
-private:
-	void (*_callable)(void*) = nullptr;
-	void *_argument = nullptr;
+// Pushed from any thread without locks, taken all at once by the main
+// thread. Only the push that finds the list empty posts a QEvent.
+std::atomic<QueuedCall*> Posted/* = nullptr*/;
+std::atomic<int> Depth/* = 0*/;
+std::atomic<crl::time> LastWait/* = 0*/;
+std::atomic<crl::time> MaxWait/* = 0*/;
 
-};
+// Taken calls in the posting order, accessed only from the main thread.
+QueuedCall *PendingFirst/* = nullptr*/;
+QueuedCall *PendingLast/* = nullptr*/;
+
+void Wake() {
+	QMutexLocker lock(&ProcessorMutex);
+
+	if (ProcessorInstance) {
+		QApplication::postEvent(ProcessorInstance, new QEvent(kProcessorEvent));
+	}
+}
+
+void Post(void (*callable)(void*), void *argument) {
+	const auto call = new QueuedCall{ callable, argument, crl::now() };
+	base::trace::FlowBegin("post", uint64(call), "main_queue");
+	++Depth;
+
+	auto head = Posted.load(std::memory_order_relaxed);
+	do {
+		call->next = head;
+	} while (!Posted.compare_exchange_weak(
+		head,
+		call,
+		std::memory_order_release,
+		std::memory_order_relaxed));
+	if (!head) {
+		Wake();
+	}
+}
 
-ProcessorEvent::ProcessorEvent(void (*callable)(void*), void *argument)
-: QEvent(kProcessorEvent)
-, _callable(callable)
-, _argument(argument) {
+void TakePosted() {
+	auto taken = Posted.exchange(nullptr, std::memory_order_acquire);
+	if (!taken) {
+		return;
+	}
+	const auto last = taken;
+	auto reversed = (QueuedCall*)nullptr;
+	while (taken) {
+		const auto next = taken->next;
+		taken->next = reversed;
+		reversed = taken;
+		taken = next;
+	}
+	if (PendingLast) {
+		PendingLast->next = reversed;
+	} else {
+		PendingFirst = reversed;
+	}
+	PendingLast = last;
 }
 
-void ProcessorEvent::process() {
-	_callable(_argument);
+[[nodiscard]] QueuedCall *TakePending() {
+	const auto result = PendingFirst;
+	if (result) {
+		PendingFirst = std::exchange(result->next, nullptr);
+		if (!PendingFirst) {
+			PendingLast = nullptr;
+		}
+	}
+	return result;
+}
+
+void RecordWait(crl::time wait) {
+	LastWait = wait;
+	auto max = MaxWait.load(std::memory_order_relaxed);
+	while (wait > max && !MaxWait.compare_exchange_weak(max, wait)) {
+	}
 }
 
 void ProcessObservables() {
@@ -49,16 +115,10 @@ void ProcessObservables() {
 MainQueueProcessor::MainQueueProcessor() {
 	acquire();
 
-	crl::init_main_queue([](void (*callable)(void*), void *argument) {
-		QMutexLocker lock(&ProcessorMutex);
-
-		if (ProcessorInstance) {
-			const auto event = new ProcessorEvent(callable, argument);
-			QApplication::postEvent(ProcessorInstance, event);
-		}
-	});
+	crl::init_main_queue(Post);
 	crl::wrap_main_queue([](void (*callable)(void*), void *argument) {
 		Sandbox::Instance().customEnterFromEventLoop([&] {
+			const auto span = base::trace::Span("wrapped", "main_queue");
 			callable(argument);
 		});
 	});
@@ -66,9 +126,48 @@ MainQueueProcessor::MainQueueProcessor() {
 	base::InitObservables(ProcessObservables);
 }
 
+MainQueueStats MainQueueProcessor::Stats() {
+	auto result = MainQueueStats();
+	result.depth = Depth.load(std::memory_order_relaxed);
+	result.lastWait = LastWait.load(std::memory_order_relaxed);
+	result.maxWait = MaxWait.load(std::memory_order_relaxed);
+	return result;
+}
+
+void MainQueueProcessor::process() {
+	const auto span = base::trace::Span("slice", "main_queue");
+
+	TakePosted();
+	auto now = crl::now();
+	const auto till = now + kProcessSliceTime;
+	while (const auto call = TakePending()) {
+		RecordWait(now - call->posted);
+		base::trace::FlowEnd("post", uint64(call), "main_queue");
+		{
+			const auto span = base::trace::Span("process", "main_queue");
+			call->callable(call->argument);
+		}
+		delete call;
+		--Depth;
+
+		now = crl::now();
+		if (now >= till) {
+			break;
+		} else if (!PendingFirst) {
+			TakePosted();
+		}
+	}
+	base::trace::Counter("depth", Depth.load(), "main_queue");
+	base::trace::Counter("wait", LastWait.load(), "main_queue");
+
+	if (PendingFirst) {
+		QApplication::postEvent(this, new QEvent(kProcessorEvent));
+	}
+}
+
 bool MainQueueProcessor::event(QEvent *event) {
 	if (event->type() == kProcessorEvent) {
-		static_cast<ProcessorEvent*>(event)->process();
+		process();
 		return true;
 	}
 	return QObject::event(event);
@@ -77,8 +176,13 @@ bool MainQueueProcessor::event(QEvent *event) {
 void MainQueueProcessor::acquire() {
 	Expects(ProcessorInstance == nullptr);
 
-	QMutexLocker lock(&ProcessorMutex);
-	ProcessorInstance = this;
+	{
+		QMutexLocker lock(&ProcessorMutex);
+		ProcessorInstance = this;
+	}
+	if (Posted.load() || PendingFirst) {
+		QApplication::postEvent(this, new QEvent(kProcessorEvent));
+	}
 }
 
 void MainQueueProcessor::release() {
@@ -9,15 +9,27 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace Core {
 
+struct MainQueueStats {
+	int depth = 0;
+	crl::time lastWait = 0;
+	crl::time maxWait = 0;
+};
+
+// crl::on_main() callbacks are collected in a single queue and processed
+// in time slices, one QEvent per slice instead of one per callback.
 class MainQueueProcessor : public QObject {
 public:
 	MainQueueProcessor();
 	~MainQueueProcessor();
 
+	// Callbacks waiting to be processed and the time they waited in ms.
+	[[nodiscard]] static MainQueueStats Stats();
+
 protected:
 	bool event(QEvent *event) override;
 
 private:
+	void process();
 	void acquire();
 	void release();
 
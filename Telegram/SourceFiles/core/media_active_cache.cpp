@@ -0,0 +1,82 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/media_active_cache.h"
+
+namespace Core {
+namespace details {
+namespace {
+
+// After 128 MB of unpacked media in all the caches together we unload
+// the least recently used entries, whatever cache they are in.
+constexpr auto kMemoryForAllCaches = int64(128 * 1024 * 1024);
+
+struct Registry {
+	std::vector<not_null<MediaMemoryConsumer*>> consumers;
+	int64 clock = 0;
+};
+
+Registry &GetRegistry() {
+	static auto result = Registry();
+	return result;
+}
+
+} // namespace
+
+void RegisterMediaMemoryConsumer(not_null<MediaMemoryConsumer*> consumer) {
+	GetRegistry().consumers.push_back(consumer);
+}
+
+void UnregisterMediaMemoryConsumer(
+		not_null<MediaMemoryConsumer*> consumer) {
+	auto &consumers = GetRegistry().consumers;
+	consumers.erase(
+		ranges::remove(consumers, consumer),
+		end(consumers));
+}
+
+int64 NextMediaUsedAt() {
+	return ++GetRegistry().clock;
+}
+
+void CheckMediaMemory() {
+	ReduceMediaMemory(kMemoryForAllCaches);
+}
+
+} // namespace details
+
+int64 MediaMemoryUsage() {
+	auto result = int64(0);
+	for (const auto consumer : details::GetRegistry().consumers) {
+		result += consumer->usage();
+	}
+	return result;
+}
+
+void ReduceMediaMemory(int64 limit) {
+	const auto &consumers = details::GetRegistry().consumers;
+	auto usage = MediaMemoryUsage();
+	while (usage > limit) {
+		auto lowest = static_cast<details::MediaMemoryConsumer*>(nullptr);
+		auto lowestUsedAt = int64(0);
+		for (const auto consumer : consumers) {
+			const auto usedAt = consumer->lowestUsedAt();
+			if (usedAt && (!lowest || usedAt < lowestUsedAt)) {
+				lowest = consumer;
+				lowestUsedAt = usedAt;
+			}
+		}
+		if (!lowest) {
+			break;
+		}
+		const auto was = lowest->usage();
+		lowest->unloadLowest();
+		usage += lowest->usage() - was;
+	}
+}
+
+} // namespace Core
@@ -7,15 +7,49 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #pragma once
 
-#include "base/last_used_cache.h"
+#include "base/memory_usage.h"
+
+#include <list>
+#include <unordered_map>
 
 namespace Core {
+namespace details {
+
+// All media caches share one usage clock, so when the total memory
+// limit is exceeded the least recently used entry of any cache goes.
+class MediaMemoryConsumer {
+public:
+	[[nodiscard]] virtual int64 usage() const = 0;
+
+	// Zero if there is nothing to unload.
+	[[nodiscard]] virtual int64 lowestUsedAt() const = 0;
+	virtual void unloadLowest() = 0;
+
+protected:
+	~MediaMemoryConsumer() = default;
+
+};
+
+void RegisterMediaMemoryConsumer(not_null<MediaMemoryConsumer*> consumer);
+void UnregisterMediaMemoryConsumer(not_null<MediaMemoryConsumer*> consumer);
+[[nodiscard]] int64 NextMediaUsedAt();
+void CheckMediaMemory();
+
+} // namespace details
+
+// Unpacked media in all the caches, in bytes.
+[[nodiscard]] int64 MediaMemoryUsage();
+
+// Unloads the least recently used media of all the caches until no more
+// than the given amount of memory is used.
+void ReduceMediaMemory(int64 limit);
 
 template <typename Type>
-class MediaActiveCache {
+class MediaActiveCache final : private details::MediaMemoryConsumer {
 public:
 	template <typename Unload>
-	MediaActiveCache(int64 limit, Unload &&unload);
+	MediaActiveCache(base::memory::Tag tag, int64 limit, Unload &&unload);
+	~MediaActiveCache();
 
 	void up(Type *entry);
 	void remove(Type *entry);
@@ -25,10 +59,22 @@ public:
 	void decrement(int64 amount);
 
 private:
-	template <typename Unload>
-	void check(Unload &&unload);
-
-	base::last_used_cache<Type*> _cache;
+	struct Entry {
+		Type *value = nullptr;
+		int64 usedAt = 0;
+	};
+
+	int64 usage() const override;
+	int64 lowestUsedAt() const override;
+	void unloadLowest() override;
+
+	void check();
+	void unloadAll();
+
+	const base::memory::Tag _tag;
+	std::list<Entry> _queue;
+	std::unordered_map<Type*, typename std::list<Entry>::iterator> _map;
+	Fn<void(Type*)> _unload;
 	SingleQueuedInvokation _delayed;
 	int64 _usage = 0;
 	int64 _limit = 0;
@@ -37,46 +83,97 @@ private:
 
 template <typename Type>
 template <typename Unload>
-MediaActiveCache<Type>::MediaActiveCache(int64 limit, Unload &&unload)
-: _delayed([=] { check(unload); })
+MediaActiveCache<Type>::MediaActiveCache(
+	base::memory::Tag tag,
+	int64 limit,
+	Unload &&unload)
+: _tag(tag)
+, _unload(std::forward<Unload>(unload))
+, _delayed([=] { check(); })
 , _limit(limit) {
+	details::RegisterMediaMemoryConsumer(this);
+	base::memory::SetTrim(_tag, [=] { unloadAll(); });
+}
+
+template <typename Type>
+MediaActiveCache<Type>::~MediaActiveCache() {
+	base::memory::SetTrim(_tag, nullptr);
+	details::UnregisterMediaMemoryConsumer(this);
 }
 
 template <typename Type>
 void MediaActiveCache<Type>::up(Type *entry) {
-	_cache.up(entry);
+	const auto usedAt = details::NextMediaUsedAt();
+	if (!_queue.empty() && _queue.back().value == entry) {
+		_queue.back().usedAt = usedAt;
+	} else if (const auto i = _map.find(entry); i != end(_map)) {
+		i->second->usedAt = usedAt;
+		_queue.splice(end(_queue), _queue, i->second);
+	} else {
+		_map.emplace(entry, _queue.insert(end(_queue), { entry, usedAt }));
+	}
 	_delayed.call();
 }
 
 template <typename Type>
 void MediaActiveCache<Type>::remove(Type *entry) {
-	_cache.remove(entry);
+	const auto i = _map.find(entry);
+	if (i != end(_map)) {
+		_queue.erase(i->second);
+		_map.erase(i);
+	}
 }
 
 template <typename Type>
 void MediaActiveCache<Type>::clear() {
-	_cache.clear();
+	_queue.clear();
+	_map.clear();
 }
 
 template <typename Type>
 void MediaActiveCache<Type>::increment(int64 amount) {
 	_usage += amount;
+	base::memory::Allocated(_tag, amount);
 }
 
 template <typename Type>
 void MediaActiveCache<Type>::decrement(int64 amount) {
 	_usage -= amount;
+	base::memory::Freed(_tag, amount);
 }
 
 template <typename Type>
-template <typename Unload>
-void MediaActiveCache<Type>::check(Unload &&unload) {
-	while (_usage > _limit) {
-		if (const auto entry = _cache.take_lowest()) {
-			unload(entry);
-		} else {
-			break;
-		}
+int64 MediaActiveCache<Type>::usage() const {
+	return _usage;
+}
+
+template <typename Type>
+int64 MediaActiveCache<Type>::lowestUsedAt() const {
+	return _queue.empty() ? 0 : _queue.front().usedAt;
+}
+
+template <typename Type>
+void MediaActiveCache<Type>::unloadLowest() {
+	Expects(!_queue.empty());
+
+	const auto entry = _queue.front().value;
+	_queue.pop_front();
+	_map.erase(entry);
+	_unload(entry);
+}
+
+template <typename Type>
+void MediaActiveCache<Type>::check() {
+	while (_usage > _limit && !_queue.empty()) {
+		unloadLowest();
+	}
+	details::CheckMediaMemory();
+}
+
+template <typename Type>
+void MediaActiveCache<Type>::unloadAll() {
+	while (!_queue.empty()) {
+		unloadLowest();
 	}
 }
 
@@ -18,6 +18,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/launcher.h"
 #include "core/local_url_handlers.h"
 #include "core/update_checker.h"
+#include "core/stall_watchdog.h"
 #include "base/timer.h"
 #include "base/concurrent_timer.h"
 #include "base/qthelp_url.h"
@@ -78,6 +79,7 @@ Sandbox::Sandbox(
 	char **argv)
 : QApplication(argc, argv)
 , _mainThreadId(QThread::currentThreadId())
+, _stallWatchdog(std::make_unique<StallWatchdog>())
 , _launcher(launcher) {
 }
 
@@ -473,8 +475,9 @@ void Sandbox::postponeCall(FnMut<void()> &&callable) {
 		});
 }
 
-void Sandbox::incrementEventNestingLevel() {
+void Sandbox::incrementEventNestingLevel(const char *what, int type) {
 	++_eventNestingLevel;
+	_stallWatchdog->enter(what, type);
 }
 
 void Sandbox::decrementEventNestingLevel() {
@@ -485,6 +488,7 @@ void Sandbox::decrementEventNestingLevel() {
 	const auto processTillLevel = _eventNestingLevel - 1;
 	processPostponedCalls(processTillLevel);
 	_eventNestingLevel = processTillLevel;
+	_stallWatchdog->leave();
 }
 
 void Sandbox::registerEnterFromEventLoop() {
@@ -499,8 +503,10 @@ bool Sandbox::notify(QObject *receiver, QEvent *e) {
 		return QApplication::notify(receiver, e);
 	}
 
-	const auto wrap = createEventNestingLevel();
 	const auto type = e->type();
+	const auto wrap = createEventNestingLevel(
+		receiver ? receiver->metaObject()->className() : nullptr,
+		int(type));
 	if (type == QEvent::UpdateRequest) {
 		_widgetUpdateRequests.fire({});
 		// Profiling.
@@ -12,13 +12,14 @@ namespace Core {
 class Launcher;
 class UpdateChecker;
 class Application;
+class StallWatchdog;
 
 class Sandbox final
 	: public QApplication
 	, private QAbstractNativeEventFilter {
 private:
-	auto createEventNestingLevel() {
-		incrementEventNestingLevel();
+	auto createEventNestingLevel(const char *what, int type) {
+		incrementEventNestingLevel(what, type);
 		return gsl::finally([=] { decrementEventNestingLevel(); });
 	}
 
@@ -39,7 +40,7 @@ public:
 	template <typename Callable>
 	auto customEnterFromEventLoop(Callable &&callable) {
 		registerEnterFromEventLoop();
-		const auto wrap = createEventNestingLevel();
+		const auto wrap = createEventNestingLevel("custom", 0);
 		return callable();
 	}
 
@@ -74,7 +75,7 @@ private:
 	void closeApplication(); // will be done in aboutToQuit()
 	void checkForQuit(); // will be done in exec()
 	void registerEnterFromEventLoop();
-	void incrementEventNestingLevel();
+	void incrementEventNestingLevel(const char *what, int type);
 	void decrementEventNestingLevel();
 	bool nativeEventFilter(
 		const QByteArray &eventType,
@@ -98,6 +99,7 @@ private:
 	void removeClients();
 
 	const Qt::HANDLE _mainThreadId = nullptr;
+	const std::unique_ptr<StallWatchdog> _stallWatchdog;
 	int _eventNestingLevel = 0;
 	int _loopNestingLevel = 0;
 	std::vector<int> _previousLoopNestingLevels;
@@ -119,6 +119,11 @@ private:
 	base::flat_set<QShortcut*> _mediaShortcuts;
 	base::flat_set<QShortcut*> _supportShortcuts;
 
+	// Shortcuts are created after the first window is shown,
+	// so they could be toggled before they are created.
+	bool _mediaEnabled = false;
+	bool _supportEnabled = false;
+
 };
 
 QString DefaultFilePath() {
@@ -197,12 +202,14 @@ std::optional<Command> Manager::lookup(int shortcutId) const {
 }
 
 void Manager::toggleMedia(bool toggled) {
+	_mediaEnabled = toggled;
 	for (const auto shortcut : _mediaShortcuts) {
 		shortcut->setEnabled(toggled);
 	}
 }
 
 void Manager::toggleSupport(bool toggled) {
+	_supportEnabled = toggled;
 	for (const auto shortcut : _supportShortcuts) {
 		shortcut->setEnabled(toggled);
 	}
@@ -385,7 +392,8 @@ void Manager::set(const QString &keys, Command command) {
 	const auto isMediaShortcut = MediaCommands.contains(command);
 	const auto isSupportShortcut = SupportCommands.contains(command);
 	if (isMediaShortcut || isSupportShortcut) {
-		shortcut->setEnabled(false);
+		shortcut->setEnabled((isMediaShortcut && _mediaEnabled)
+			|| (isSupportShortcut && _supportEnabled));
 	}
 	const auto id = shortcut->id();
 	if (!id) {
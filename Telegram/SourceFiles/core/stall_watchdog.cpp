@@ -0,0 +1,179 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/stall_watchdog.h"
+
+#include "core/crash_reports.h"
+#include "base/trace.h"
+
+namespace Core {
+namespace {
+
+constexpr auto kStallThreshold = crl::time(50);
+constexpr auto kSampleInterval = crl::time(20);
+constexpr auto kWorstCount = 5;
+
+// Stalls that didn't finish yet are logged from the watchdog thread,
+// so the log shows what the main thread was doing if it never returns.
+constexpr auto kFreezeAnnounce = crl::time(1000);
+
+QString Describe(
+		crl::time duration,
+		const char *what,
+		int type,
+		const char *span) {
+	return qsl("%1 ms in %2 (event %3), span: %4"
+	).arg(duration
+	).arg(what ? what : "unknown"
+	).arg(type
+	).arg(span ? span : "none");
+}
+
+} // namespace
+
+StallWatchdog::StallWatchdog() {
+	base::trace::WatchCurrentThread();
+	_thread = std::thread([=] { run(); });
+}
+
+StallWatchdog::~StallWatchdog() {
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_finishing = true;
+	}
+	_variable.notify_one();
+	_thread.join();
+
+	if (!_worst.empty()) {
+		auto list = QStringList();
+		for (const auto &stall : _worst) {
+			list.push_back(Describe(
+				stall.duration,
+				stall.what,
+				stall.type,
+				stall.span));
+		}
+		LOG(("Stall Watchdog: worst stalls: %1").arg(list.join("; ")));
+	}
+}
+
+void StallWatchdog::enter(const char *what, int type) {
+	activity(crl::now());
+	_entries.push_back({ what, type });
+	publish(_entries.back());
+	++_depth;
+}
+
+void StallWatchdog::leave() {
+	Expects(!_entries.empty());
+
+	activity(crl::now());
+	_entries.pop_back();
+	publish(_entries.empty() ? Entry() : _entries.back());
+	--_depth;
+}
+
+void StallWatchdog::activity(crl::time now) {
+	const auto generation = _generation.load(std::memory_order_relaxed);
+	if (_depth.load(std::memory_order_relaxed) > 0) {
+		const auto duration = now - _activity.load(std::memory_order_relaxed);
+		if (duration > kStallThreshold) {
+			const auto sampled = (_sampledGeneration.load() == generation);
+			report({
+				duration,
+				_what.load(std::memory_order_relaxed),
+				_type.load(std::memory_order_relaxed),
+				sampled ? _sampledSpan.load() : nullptr
+			});
+		}
+	}
+	_activity.store(now, std::memory_order_relaxed);
+	_generation.store(generation + 1, std::memory_order_release);
+}
+
+void StallWatchdog::publish(const Entry &entry) {
+	_what.store(entry.what, std::memory_order_relaxed);
+	_type.store(entry.type, std::memory_order_relaxed);
+}
+
+void StallWatchdog::report(Stall stall) {
+	DEBUG_LOG(("Stall Watchdog: %1").arg(Describe(
+		stall.duration,
+		stall.what,
+		stall.type,
+		stall.span)));
+	if (stall.duration >= kFreezeAnnounce) {
+		CrashReports::ClearAnnotation("Stall");
+	}
+
+	const auto i = ranges::find_if(_worst, [&](const Stall &already) {
+		return (already.duration < stall.duration);
+	});
+	if (i == end(_worst) && int(_worst.size()) >= kWorstCount) {
+		return;
+	}
+	_worst.insert(i, stall);
+	if (int(_worst.size()) > kWorstCount) {
+		_worst.pop_back();
+	}
+	refreshAnnotation();
+}
+
+void StallWatchdog::refreshAnnotation() {
+	auto list = QStringList();
+	for (const auto &stall : _worst) {
+		list.push_back(Describe(
+			stall.duration,
+			stall.what,
+			stall.type,
+			stall.span));
+	}
+	CrashReports::SetAnnotation("Stalls", list.join("; "));
+}
+
+void StallWatchdog::run() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (!_finishing) {
+		_variable.wait_for(lock, std::chrono::milliseconds(kSampleInterval));
+		if (!_finishing) {
+			sample(crl::now());
+		}
+	}
+}
+
+void StallWatchdog::sample(crl::time now) {
+	if (_depth.load(std::memory_order_relaxed) <= 0) {
+		return;
+	}
+	const auto generation = _generation.load(std::memory_order_acquire);
+	const auto duration = now - _activity.load(std::memory_order_relaxed);
+	if (duration <= kStallThreshold) {
+		return;
+	}
+	if (_sampledGeneration.load() != generation) {
+		_sampledSpan = base::trace::WatchedSpan();
+		_sampledGeneration = generation;
+	}
+	if (_announcedGeneration != generation) {
+		_announcedGeneration = generation;
+		_announcedDuration = kFreezeAnnounce;
+	}
+	if (duration < _announcedDuration) {
+		return;
+	}
+	_announcedDuration *= 2;
+
+	const auto description = Describe(
+		duration,
+		_what.load(std::memory_order_relaxed),
+		_type.load(std::memory_order_relaxed),
+		_sampledSpan.load());
+	LOG(("Stall Watchdog: main thread is busy, %1").arg(description));
+	CrashReports::SetAnnotation("Stall", description);
+}
+
+} // namespace Core
@@ -0,0 +1,75 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace Core {
+
+// The main thread reports entering and leaving each event it processes.
+// A watchdog thread samples the innermost trace span while the main
+// thread is stuck, the main thread logs the stall when it gets back and
+// keeps the worst ones in the crash report annotations.
+class StallWatchdog final {
+public:
+	StallWatchdog();
+	StallWatchdog(const StallWatchdog &other) = delete;
+	StallWatchdog &operator=(const StallWatchdog &other) = delete;
+	~StallWatchdog();
+
+	// Main thread.
+	// The description should be a static string.
+	void enter(const char *what, int type);
+	void leave();
+
+private:
+	struct Entry {
+		const char *what = nullptr;
+		int type = 0;
+	};
+	struct Stall {
+		crl::time duration = 0;
+		const char *what = nullptr;
+		int type = 0;
+		const char *span = nullptr;
+	};
+
+	void activity(crl::time now);
+	void publish(const Entry &entry);
+	void report(Stall stall);
+	void refreshAnnotation();
+
+	// Watchdog thread.
+	void run();
+	void sample(crl::time now);
+
+	std::vector<Entry> _entries;
+	std::vector<Stall> _worst;
+
+	std::atomic<int> _depth = 0;
+	std::atomic<crl::time> _activity = 0;
+	std::atomic<uint64> _generation = 0;
+	std::atomic<const char*> _what = nullptr;
+	std::atomic<int> _type = 0;
+
+	std::atomic<uint64> _sampledGeneration = 0;
+	std::atomic<const char*> _sampledSpan = nullptr;
+	uint64 _announcedGeneration = 0;
+	crl::time _announcedDuration = 0;
+
+	std::mutex _mutex;
+	std::condition_variable _variable;
+	bool _finishing = false;
+	std::thread _thread;
+
+};
+
+} // namespace Core
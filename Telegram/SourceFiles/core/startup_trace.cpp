@@ -0,0 +1,48 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/startup_trace.h"
+
+#include <atomic>
+
+namespace Core {
+namespace StartupTrace {
+namespace {
+
+std::atomic<bool> Requested = false;
+
+} // namespace
+
+void Enable() {
+	Requested = true;
+	base::trace::Start();
+}
+
+bool Enabled() {
+	return Requested.load(std::memory_order_relaxed)
+		&& base::trace::Enabled();
+}
+
+void Finish() {
+	if (!Requested.exchange(false)) {
+		return;
+	}
+	const auto dump = base::trace::Dump();
+	base::trace::Stop();
+
+	const auto path = cWorkingDir() + qsl("startup_trace.json");
+	auto file = QFile(path);
+	if (!file.open(QIODevice::WriteOnly)) {
+		LOG(("Startup Trace Error: could not open '%1'.").arg(path));
+		return;
+	}
+	file.write(dump);
+	LOG(("Startup Trace: written to '%1'.").arg(path));
+}
+
+} // namespace StartupTrace
+} // namespace Core
@@ -0,0 +1,37 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/trace.h"
+
+namespace Core {
+namespace StartupTrace {
+
+// Enabled by the -tracestartup command line argument, the timeline is
+// written to 'startup_trace.json' in the working folder in the Chrome
+// trace event format, so it can be opened in chrome://tracing.
+void Enable();
+[[nodiscard]] bool Enabled();
+
+// Writes collected events and stops the tracing.
+void Finish();
+
+class Scope final {
+public:
+	// Both strings should be static literals.
+	explicit Scope(const char *name, const char *category = "startup")
+	: _span(name, category) {
+	}
+
+private:
+	base::trace::Span _span;
+
+};
+
+} // namespace StartupTrace
+} // namespace Core
@@ -37,6 +37,7 @@ namespace {
 
 constexpr auto kUpdaterTimeout = 10 * crl::time(1000);
 constexpr auto kMaxResponseSize = 1024 * 1024;
+constexpr auto kDeltaPackageTag = quint32(0x7FFFFFFE);
 
 #ifdef TDESKTOP_DISABLE_AUTOUPDATE
 bool UpdaterIsDisabled = true;
@@ -71,17 +72,21 @@ public:
 	rpl::producer<std::shared_ptr<Loader>> ready() const;
 	rpl::producer<> failed() const;
 
+	// Whether the loader from ready() loads a delta package.
+	bool delta() const;
+
 	rpl::lifetime &lifetime();
 
 	virtual ~Checker() = default;
 
 protected:
 	bool testing() const;
-	void done(std::shared_ptr<Loader> result);
+	void done(std::shared_ptr<Loader> result, bool delta = false);
 	void fail();
 
 private:
 	bool _testing = false;
+	bool _delta = false;
 	rpl::event_stream<std::shared_ptr<Loader>> _ready;
 	rpl::event_stream<> _failed;
 
@@ -92,13 +97,14 @@ private:
 struct Implementation {
 	std::unique_ptr<Checker> checker;
 	std::shared_ptr<Loader> loader;
+	bool delta = false;
 	bool failed = false;
 
 };
 
 class HttpChecker : public Checker {
 public:
-	HttpChecker(bool testing);
+	HttpChecker(bool testing, bool allowDelta);
 
 	void start() override;
 
@@ -112,11 +118,14 @@ private:
 	std::optional<QString> parseOldResponse(
 		const QByteArray &response) const;
 	std::optional<QString> parseResponse(const QByteArray &response) const;
+	std::optional<QString> parseDeltaResponse(
+		const QByteArray &response) const;
 	QString validateLatestUrl(
 		uint64 availableVersion,
 		bool isAvailableAlpha,
 		QString url) const;
 
+	bool _allowDelta = false;
 	std::unique_ptr<QNetworkAccessManager> _manager;
 	QNetworkReply *_reply = nullptr;
 
@@ -237,6 +246,35 @@ QString ExtractFilename(const QString &url) {
 	return QString();
 }
 
+// Delta packages don't contain the files that didn't change since the
+// installed version, those are taken from the installation instead.
+bool ReadInstalledFile(
+		const QString &relativeName,
+		const QByteArray &sha1,
+		QByteArray &result) {
+	const auto path = cExeDir() + relativeName;
+	QFile f(path);
+	if (!f.open(QIODevice::ReadOnly)) {
+		LOG(("Update Error: cant read installed file '%1'").arg(path));
+		return false;
+	}
+	result = f.readAll();
+	f.close();
+
+	uchar sha1Buffer[20];
+	const auto goodSha1 = (sha1.size() == sizeof(sha1Buffer))
+		&& !memcmp(
+			sha1.constData(),
+			hashSha1(result.constData(), result.size(), sha1Buffer),
+			sizeof(sha1Buffer));
+	if (!goodSha1) {
+		LOG(("Update Error: installed file '%1' doesn't match delta base"
+			).arg(path));
+		return false;
+	}
+	return true;
+}
+
 bool UnpackUpdate(const QString &filepath) {
 	QFile input(filepath);
 	QByteArray packed;
@@ -369,6 +407,19 @@ bool UnpackUpdate(const QString &filepath) {
 			return false;
 		}
 
+		quint32 deltaVersion = 0;
+		if (version == kDeltaPackageTag) {
+			stream >> version >> deltaVersion;
+			if (stream.status() != QDataStream::Ok) {
+				LOG(("Update Error: cant read delta version from downloaded stream, status: %1").arg(stream.status()));
+				return false;
+			}
+			if (cAlphaVersion() || int32(deltaVersion) != AppVersion) {
+				LOG(("Update Error: downloaded delta from version %1 doesn't fit mine %2").arg(deltaVersion).arg(AppVersion));
+				return false;
+			}
+		}
+
 		quint64 alphaVersion = 0;
 		if (version == 0x7FFFFFFF) { // alpha version
 			stream >> alphaVersion;
@@ -399,9 +450,19 @@ bool UnpackUpdate(const QString &filepath) {
 			QString relativeName;
 			quint32 fileSize;
 			QByteArray fileInnerData;
+			bool unchanged = false;
+			QByteArray unchangedSha1;
 			bool executable = false;
 
-			stream >> relativeName >> fileSize >> fileInnerData;
+			stream >> relativeName;
+			if (deltaVersion) {
+				stream >> unchanged;
+			}
+			if (unchanged) {
+				stream >> unchangedSha1;
+			} else {
+				stream >> fileSize >> fileInnerData;
+			}
 #if defined Q_OS_MAC || defined Q_OS_LINUX
 			stream >> executable;
 #endif // Q_OS_MAC || Q_OS_LINUX
@@ -409,6 +470,12 @@ bool UnpackUpdate(const QString &filepath) {
 				LOG(("Update Error: cant read file from downloaded stream, status: %1").arg(stream.status()));
 				return false;
 			}
+			if (unchanged) {
+				if (!ReadInstalledFile(relativeName, unchangedSha1, fileInnerData)) {
+					return false;
+				}
+				fileSize = fileInnerData.size();
+			}
 			if (fileSize != quint32(fileInnerData.size())) {
 				LOG(("Update Error: bad file size %1 not matching data size %2").arg(fileSize).arg(fileInnerData.size()));
 				return false;
@@ -600,7 +667,12 @@ bool Checker::testing() const {
 	return _testing;
 }
 
-void Checker::done(std::shared_ptr<Loader> result) {
+bool Checker::delta() const {
+	return _delta;
+}
+
+void Checker::done(std::shared_ptr<Loader> result, bool delta) {
+	_delta = delta;
 	_ready.fire(std::move(result));
 }
 
@@ -612,7 +684,9 @@ rpl::lifetime &Checker::lifetime() {
 	return _lifetime;
 }
 
-HttpChecker::HttpChecker(bool testing) : Checker(testing) {
+HttpChecker::HttpChecker(bool testing, bool allowDelta)
+: Checker(testing)
+, _allowDelta(allowDelta) {
 }
 
 void HttpChecker::start() {
@@ -645,14 +719,21 @@ void HttpChecker::gotResponse() {
 }
 
 bool HttpChecker::handleResponse(const QByteArray &response) {
-	const auto handle = [&](const QString &url) {
-		done(url.isEmpty() ? nullptr : std::make_shared<HttpLoader>(url));
+	const auto handle = [&](const QString &url, bool delta) {
+		done(
+			url.isEmpty() ? nullptr : std::make_shared<HttpLoader>(url),
+			delta);
 		return true;
 	};
 	if (const auto url = parseOldResponse(response)) {
-		return handle(*url);
+		return handle(*url, false);
 	} else if (const auto url = parseResponse(response)) {
-		return handle(*url);
+		if (!url->isEmpty() && _allowDelta) {
+			if (const auto delta = parseDeltaResponse(response)) {
+				return handle(*delta, true);
+			}
+		}
+		return handle(*url, false);
 	}
 	return false;
 }
@@ -731,6 +812,50 @@ std::optional<QString> HttpChecker::parseResponse(
 		Local::readAutoupdatePrefix() + bestLink);
 }
 
+std::optional<QString> HttpChecker::parseDeltaResponse(
+		const QByteArray &response) const {
+	auto bestAvailableVersion = 0ULL;
+	auto bestIsAvailableAlpha = false;
+	auto bestDeltaFrom = 0ULL;
+	auto bestDeltaLink = QString();
+	const auto accumulate = [&](
+			uint64 version,
+			bool isAlpha,
+			const QJsonObject &map) {
+		bestAvailableVersion = version;
+		bestIsAvailableAlpha = isAlpha;
+		const auto from = map.constFind("delta_from");
+		const auto link = map.constFind("delta_link");
+		const auto valid = (from != map.constEnd())
+			&& (link != map.constEnd())
+			&& (*link).isString();
+		bestDeltaFrom = valid
+			? ((*from).isString()
+				? (*from).toString().toULongLong()
+				: uint64(std::round((*from).toDouble())))
+			: 0ULL;
+		bestDeltaLink = valid ? (*link).toString() : QString();
+		return true;
+	};
+	const auto result = ParseCommonMap(response, testing(), accumulate);
+	if (!result
+		|| bestIsAvailableAlpha
+		|| cAlphaVersion()
+		|| bestDeltaLink.isEmpty()
+		|| bestDeltaFrom != uint64(AppVersion)) {
+		return std::nullopt;
+	}
+	const auto url = validateLatestUrl(
+		bestAvailableVersion,
+		false,
+		Local::readAutoupdatePrefix() + bestDeltaLink);
+	if (url.isEmpty()) {
+		return std::nullopt;
+	}
+	LOG(("Update Info: Found delta from version %1.").arg(bestDeltaFrom));
+	return url;
+}
+
 QString HttpChecker::validateLatestUrl(
 		uint64 availableVersion,
 		bool isAvailableAlpha,
@@ -1078,6 +1203,8 @@ private:
 	Implementation _httpImplementation;
 	Implementation _mtpImplementation;
 	std::shared_ptr<Loader> _activeLoader;
+	bool _loadingDelta = false;
+	bool _deltaFailed = false;
 	bool _usingMtprotoLoader = (cAlphaVersion() != 0);
 	QPointer<MTP::Instance> _mtproto;
 
@@ -1132,6 +1259,7 @@ void Updater::check() {
 
 void Updater::handleReady() {
 	stop();
+	_deltaFailed = false;
 	_action = Action::Ready;
 	if (!App::quitting()) {
 		cSetLastUpdateCheck(unixtime());
@@ -1140,6 +1268,15 @@ void Updater::handleReady() {
 }
 
 void Updater::handleFailed() {
+	if (_loadingDelta) {
+		// Fall back to the full package right away.
+		LOG(("Update Info: Delta package failed, loading the full one."));
+		_deltaFailed = true;
+		stop();
+		cSetLastUpdateCheck(0);
+		start(false);
+		return;
+	}
 	scheduleNext();
 }
 
@@ -1189,6 +1326,7 @@ void Updater::stop() {
 	_httpImplementation = Implementation();
 	_mtpImplementation = Implementation();
 	_activeLoader = nullptr;
+	_loadingDelta = false;
 	_action = Action::Waiting;
 }
 
@@ -1224,7 +1362,7 @@ void Updater::start(bool forceWait) {
 	if (sendRequest) {
 		startImplementation(
 			&_httpImplementation,
-			std::make_unique<HttpChecker>(_testing));
+			std::make_unique<HttpChecker>(_testing, !_deltaFailed));
 		startImplementation(
 			&_mtpImplementation,
 			std::make_unique<MtpChecker>(_mtproto, _testing));
@@ -1271,6 +1409,7 @@ void Updater::startImplementation(
 void Updater::checkerDone(
 		not_null<Implementation*> which,
 		std::shared_ptr<Loader> loader) {
+	which->delta = which->checker->delta();
 	which->checker = nullptr;
 	which->loader = std::move(loader);
 
@@ -1321,6 +1460,7 @@ bool Updater::tryLoaders() {
 
 	const auto tryOne = [&](Implementation &which) {
 		_activeLoader = std::move(which.loader);
+		_loadingDelta = which.delta;
 		if (const auto loader = _activeLoader.get()) {
 			_action = Action::Loading;
 
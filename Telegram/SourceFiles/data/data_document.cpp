@@ -42,6 +42,7 @@ using FilePathResolve = DocumentData::FilePathResolve;
 
 Core::MediaActiveCache<DocumentData> &ActiveCache() {
 	static auto Instance = Core::MediaActiveCache<DocumentData>(
+		base::memory::Tag::Documents,
 		kMemoryForCache,
 		[](DocumentData *document) { document->unload(); });
 	return Instance;
@@ -473,7 +474,7 @@ void DocumentData::setattributes(
 				_additional = std::make_unique<StickerData>();
 			}
 			if (sticker()) {
-				sticker()->alt = qs(data.valt);
+				sticker()->alt = Data::InternedString(qs(data.valt));
 				if (sticker()->set.type() != mtpc_inputStickerSetID
 					|| data.vstickerset.type() == mtpc_inputStickerSetID) {
 					sticker()->set = data.vstickerset;
@@ -894,6 +895,9 @@ void DocumentData::save(
 		if (fromCloud == LoadFromCloudOrLocal) {
 			_loader->permitLoadFromCloud();
 		}
+		if (!autoLoading) {
+			_loader->stopAutoLoading();
+		}
 	} else {
 		status = FileReady;
 		auto reader = owner().documentStreamedReader(this, origin, true);
@@ -1353,7 +1357,7 @@ bool DocumentData::hasMimeType(QLatin1String mime) const {
 }
 
 void DocumentData::setMimeString(const QString &mime) {
-	_mimeString = mime;
+	_mimeString = Data::InternedString(mime);
 }
 
 MediaKey DocumentData::mediaKey() const {
@@ -18,6 +18,47 @@ namespace {
 
 constexpr auto kGoodThumbQuality = 87;
 constexpr auto kWallPaperSize = 960;
+constexpr auto kMaxGenerating = 2;
+
+struct GenerateTask {
+	base::binary_guard guard;
+	FnMut<bool(base::binary_guard&&)> start;
+};
+
+// Thumbnails are generated on demand while painting, so the latest
+// requests are for the items that are visible right now.
+std::vector<GenerateTask> GenerateQueue;
+int Generating = 0;
+
+void ProcessGenerateQueue() {
+	while (Generating < kMaxGenerating && !GenerateQueue.empty()) {
+		auto task = std::move(GenerateQueue.back());
+		GenerateQueue.pop_back();
+		if (task.guard && task.start(std::move(task.guard))) {
+			++Generating;
+		}
+	}
+}
+
+void EnqueueGenerate(
+		base::binary_guard &&guard,
+		FnMut<bool(base::binary_guard&&)> start) {
+	const auto cancelled = [](const GenerateTask &task) {
+		return !task.guard;
+	};
+	GenerateQueue.erase(
+		ranges::remove_if(GenerateQueue, cancelled),
+		end(GenerateQueue));
+	GenerateQueue.push_back({ std::move(guard), std::move(start) });
+	ProcessGenerateQueue();
+}
+
+void GenerateFinished() {
+	Expects(Generating > 0);
+
+	--Generating;
+	ProcessGenerateQueue();
+}
 
 QImage Prepare(
 		const QString &path,
@@ -63,6 +104,12 @@ void GoodThumbSource::generate(base::binary_guard &&guard) {
 	if (!guard) {
 		return;
 	}
+	EnqueueGenerate(std::move(guard), [=](base::binary_guard &&guard) {
+		return startGenerating(std::move(guard));
+	});
+}
+
+bool GoodThumbSource::startGenerating(base::binary_guard &&guard) {
 	const auto data = _document->data();
 	const auto isWallPaper = _document->isWallPaper();
 	auto location = _document->location().isEmpty()
@@ -70,7 +117,7 @@ void GoodThumbSource::generate(base::binary_guard &&guard) {
 		: std::make_unique<FileLocation>(_document->location());
 	if (data.isEmpty() && !location) {
 		_empty = true;
-		return;
+		return false;
 	}
 	crl::async([
 		=,
@@ -98,7 +145,9 @@ void GoodThumbSource::generate(base::binary_guard &&guard) {
 			std::move(result),
 			bytesSize,
 			std::move(bytes));
+		crl::on_main([] { GenerateFinished(); });
 	});
+	return true;
 }
 
 // NB: This method is called from crl::async(), 'this' is unreliable.
@@ -202,6 +251,14 @@ int GoodThumbSource::loadOffset() {
 	return 0;
 }
 
+int GoodThumbSource::progressiveScans() {
+	return 0;
+}
+
+QByteArray GoodThumbSource::progressiveBytes() {
+	return QByteArray();
+}
+
 const StorageImageLocation &GoodThumbSource::location() {
 	return StorageImageLocation::Invalid();
 }
@@ -32,6 +32,8 @@ public:
 	void cancel() override;
 	float64 progress() override;
 	int loadOffset() override;
+	int progressiveScans() override;
+	QByteArray progressiveBytes() override;
 
 	const StorageImageLocation &location() override;
 	void refreshFileReference(const QByteArray &data) override;
@@ -51,6 +53,7 @@ public:
 
 private:
 	void generate(base::binary_guard &&guard);
+	[[nodiscard]] bool startGenerating(base::binary_guard &&guard);
 
 	// NB: This method is called from crl::async(), 'this' is unreliable.
 	void ready(
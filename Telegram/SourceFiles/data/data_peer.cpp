@@ -22,6 +22,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mainwindow.h"
 #include "window/window_controller.h"
 #include "ui/image/image.h"
+#include "ui/image/image_atlas.h"
 #include "ui/empty_userpic.h"
 #include "ui/text_options.h"
 #include "history/history.h"
@@ -217,9 +218,54 @@ ImagePtr PeerData::currentUserpic() const {
 
 void PeerData::paintUserpic(Painter &p, int x, int y, int size) const {
 	if (auto userpic = currentUserpic()) {
-		p.drawPixmap(x, y, userpic->pixCircled(userpicOrigin(), size, size));
+		const auto fromAtlas = Images::UserpicsAtlas().paint(
+			p,
+			x,
+			y,
+			size,
+			inMemoryKey(_userpicLocation),
+			[&] {
+				const auto pixels = size * cIntRetinaFactor();
+				return Images::prepare(
+					userpic->original(),
+					pixels,
+					pixels,
+					Images::Option::Smooth | Images::Option::Circled,
+					-1,
+					-1);
+			});
+		if (!fromAtlas) {
+			p.drawPixmap(
+				x,
+				y,
+				userpic->pixCircled(userpicOrigin(), size, size));
+		}
 	} else {
-		_userpicEmpty->paint(p, x, y, x + size + x, size);
+		// The letters color is not a part of the empty userpic key.
+		auto key = _userpicEmpty->uniqueKey();
+		key.second ^= anim::getPremultiplied(st::historyPeerUserpicFg->c);
+		const auto fromAtlas = Images::UserpicsAtlas().paint(
+			p,
+			x,
+			y,
+			size,
+			key,
+			[&] {
+				const auto pixels = size * cIntRetinaFactor();
+				auto result = QImage(
+					QSize(pixels, pixels),
+					QImage::Format_ARGB32_Premultiplied);
+				result.setDevicePixelRatio(cRetinaFactor());
+				result.fill(Qt::transparent);
+				{
+					Painter q(&result);
+					_userpicEmpty->paint(q, 0, 0, size, size);
+				}
+				return result;
+			});
+		if (!fromAtlas) {
+			_userpicEmpty->paint(p, x, y, x + size + x, size);
+		}
 	}
 }
 
@@ -43,6 +43,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_web_page.h"
 #include "data/data_game.h"
 #include "data/data_poll.h"
+#include "base/memory_usage.h"
 #include "styles/style_boxes.h" // st::backgroundSize
 
 namespace Data {
@@ -182,6 +183,9 @@ Session::Session(not_null<AuthSession*> session)
 , _bigFileCache(Core::App().databases().get(
 	Local::cacheBigFilePath(),
 	Local::cacheBigFileSettings()))
+, _messagesCache(Core::App().databases().get(
+	Local::cacheMessagesPath(),
+	Local::cacheMessagesSettings()))
 , _chatsList(PinnedDialogsCountMaxValue())
 , _contactsList(Dialogs::SortMode::Name)
 , _contactsNoChatsList(Dialogs::SortMode::Name)
@@ -193,11 +197,18 @@ Session::Session(not_null<AuthSession*> session)
 , _unmuteByFinishedTimer([=] { unmuteByFinished(); }) {
 	_cache->open(Local::cacheKey());
 	_bigFileCache->open(Local::cacheBigFileKey());
+	_messagesCache->open(Local::cacheKey());
 
 	setupContactViewsViewer();
 	setupChannelLeavingViewer();
 	setupPeerNameViewer();
 	setupUserIsContactViewer();
+
+	base::memory::SetTrim(base::memory::Tag::HistoryElements, [=] {
+		for (const auto view : base::take(_heavyViewParts)) {
+			view->unloadHeavyPart();
+		}
+	});
 }
 
 void Session::clear() {
@@ -670,7 +681,21 @@ not_null<PeerData*> Session::processChat(const MTPChat &data) {
 	return result;
 }
 
+void Session::reservePeers(int count) {
+	// Dialogs and contacts come with thousands of peers at once,
+	// so make the peers map grow in one step instead of many rehashes.
+	_peers.reserve(_peers.size() + count);
+}
+
+void Session::readStickerSetsDocuments() const {
+	if (const auto reader = base::take(_stickerSetsDocumentsReader)) {
+		reader();
+	}
+}
+
 UserData *Session::processUsers(const MTPVector<MTPUser> &data) {
+	reservePeers(data.v.size());
+
 	auto result = (UserData*)nullptr;
 	for (const auto &user : data.v) {
 		result = processUser(user);
@@ -679,6 +704,8 @@ UserData *Session::processUsers(const MTPVector<MTPUser> &data) {
 }
 
 PeerData *Session::processChats(const MTPVector<MTPChat> &data) {
+	reservePeers(data.v.size());
+
 	auto result = (PeerData*)nullptr;
 	for (const auto &chat : data.v) {
 		result = processChat(chat);
@@ -844,6 +871,10 @@ Storage::Cache::Database &Session::cacheBigFile() {
 	return *_bigFileCache;
 }
 
+Storage::Cache::Database &Session::cacheMessages() {
+	return *_messagesCache;
+}
+
 void Session::startExport(PeerData *peer) {
 	startExport(peer ? peer->input : MTP_inputPeerEmpty());
 }
@@ -1024,6 +1055,8 @@ void Session::setupUserIsContactViewer() {
 }
 
 Session::~Session() {
+	base::memory::SetTrim(base::memory::Tag::HistoryElements, nullptr);
+
 	// Optimization: clear notifications before destroying items.
 	_session->notifications().clearAllFast();
 
@@ -1223,6 +1256,10 @@ void Session::requestItemViewRefresh(not_null<HistoryItem*> item) {
 	if (const auto view = item->mainView()) {
 		view->setPendingResize();
 	}
+	if (_itemViewRefreshSuspended) {
+		_itemViewRefreshPending.emplace(item);
+		return;
+	}
 	_itemViewRefreshRequest.fire_copy(item);
 }
 
@@ -1230,6 +1267,21 @@ rpl::producer<not_null<HistoryItem*>> Session::itemViewRefreshRequest() const {
 	return _itemViewRefreshRequest.events();
 }
 
+void Session::suspendItemViewRefresh() {
+	++_itemViewRefreshSuspended;
+}
+
+void Session::resumeItemViewRefresh() {
+	Expects(_itemViewRefreshSuspended > 0);
+
+	if (--_itemViewRefreshSuspended) {
+		return;
+	}
+	for (const auto item : base::take(_itemViewRefreshPending)) {
+		_itemViewRefreshRequest.fire_copy(item);
+	}
+}
+
 void Session::requestItemTextRefresh(not_null<HistoryItem*> item) {
 	if (const auto i = _views.find(item); i != _views.end()) {
 		for (const auto view : i->second) {
@@ -1352,6 +1404,18 @@ void Session::unloadHeavyViewParts(
 	}
 }
 
+void Session::updateHeavyViewPartsVisibility(
+		not_null<HistoryView::ElementDelegate*> delegate,
+		int from,
+		int till) {
+	for (const auto view : _heavyViewParts) {
+		if (view->delegate() == delegate) {
+			view->setHeavyPartVisible(
+				delegate->elementIntersectsRange(view, from, till));
+		}
+	}
+}
+
 void Session::removeMegagroupParticipant(
 		not_null<ChannelData*> channel,
 		not_null<UserData*> user) {
@@ -1754,6 +1818,7 @@ void Session::destroyMessage(not_null<HistoryItem*> item) {
 	}
 	_itemRemoved.fire_copy(item);
 	groups().unregisterMessage(item);
+	_itemViewRefreshPending.remove(item);
 	removeDependencyMessage(item);
 	session().notifications().clearFromItem(item);
 
@@ -2573,6 +2638,7 @@ not_null<WebPageData*> Session::processWebpage(const MTPDwebPagePending &data) {
 		QString(),
 		QString(),
 		TextWithEntities(),
+		0,
 		nullptr,
 		nullptr,
 		WebPageCollage(),
@@ -2627,6 +2693,7 @@ not_null<WebPageData*> Session::webpage(
 		siteName,
 		title,
 		description,
+		0,
 		photo,
 		document,
 		std::move(collage),
@@ -2651,7 +2718,6 @@ void Session::webpageApplyFields(
 	if (siteName == qstr("Twitter") || siteName == qstr("Instagram")) {
 		parseFlags |= TextParseHashtags | TextParseMentions;
 	}
-	TextUtilities::ParseEntities(description, parseFlags);
 	const auto pendingTill = TimeId(0);
 	webpageApplyFields(
 		page,
@@ -2661,6 +2727,7 @@ void Session::webpageApplyFields(
 		siteName,
 		data.has_title() ? qs(data.vtitle) : QString(),
 		description,
+		parseFlags,
 		data.has_photo() ? processPhoto(data.vphoto).get() : nullptr,
 		(data.has_document()
 			? processDocument(data.vdocument).get()
@@ -2679,6 +2746,7 @@ void Session::webpageApplyFields(
 		const QString &siteName,
 		const QString &title,
 		const TextWithEntities &description,
+		int32 descriptionParseFlags,
 		PhotoData *photo,
 		DocumentData *document,
 		WebPageCollage &&collage,
@@ -2693,6 +2761,7 @@ void Session::webpageApplyFields(
 		siteName,
 		title,
 		description,
+		descriptionParseFlags,
 		photo,
 		document,
 		std::move(collage),
@@ -3663,6 +3732,8 @@ void Session::clearLocalStorage() {
 
 	_cache->close();
 	_cache->clear();
+	_messagesCache->close();
+	_messagesCache->clear();
 }
 
 } // namespace Data
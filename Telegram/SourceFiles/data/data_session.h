@@ -16,6 +16,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_notify_settings.h"
 #include "history/history_location_manager.h"
 #include "base/timer.h"
+#include "base/flat_hash_map.h"
 #include "ui/effects/animations.h"
 
 class Image;
@@ -98,6 +99,7 @@ public:
 
 	[[nodiscard]] Storage::Cache::Database &cache();
 	[[nodiscard]] Storage::Cache::Database &cacheBigFile();
+	[[nodiscard]] Storage::Cache::Database &cacheMessages();
 
 	[[nodiscard]] not_null<PeerData*> peer(PeerId id);
 	[[nodiscard]] not_null<PeerData*> peer(UserId id) = delete;
@@ -187,6 +189,12 @@ public:
 	[[nodiscard]] rpl::producer<not_null<ViewElement*>> viewResizeRequest() const;
 	void requestItemViewRefresh(not_null<HistoryItem*> item);
 	[[nodiscard]] rpl::producer<not_null<HistoryItem*>> itemViewRefreshRequest() const;
+
+	// While a slice of items is created the view refresh requests are
+	// collected and then sent once for each item when it's finished.
+	void suspendItemViewRefresh();
+	void resumeItemViewRefresh();
+
 	void requestItemTextRefresh(not_null<HistoryItem*> item);
 	void requestAnimationPlayInline(not_null<HistoryItem*> item);
 	[[nodiscard]] rpl::producer<not_null<HistoryItem*>> animationPlayInlineRequest() const;
@@ -210,6 +218,10 @@ public:
 		not_null<HistoryView::ElementDelegate*> delegate,
 		int from,
 		int till);
+	void updateHeavyViewPartsVisibility(
+		not_null<HistoryView::ElementDelegate*> delegate,
+		int from,
+		int till);
 
 	using MegagroupParticipant = std::tuple<
 		not_null<ChannelData*>,
@@ -274,11 +286,25 @@ public:
 		return _featuredStickerSetsUnreadCount.value();
 	}
 	const Stickers::Sets &stickerSets() const {
+		readStickerSetsDocuments();
 		return _stickerSets;
 	}
 	Stickers::Sets &stickerSetsRef() {
+		readStickerSetsDocuments();
+		return _stickerSets;
+	}
+
+	// Sets with their documents possibly not read from the local storage
+	// yet, for the code that uses only ids, hashes, counts and flags.
+	const Stickers::Sets &stickerSetsInfo() const {
 		return _stickerSets;
 	}
+	Stickers::Sets &stickerSetsInfoRef() {
+		return _stickerSets;
+	}
+	void setStickerSetsDocumentsReader(Fn<void()> reader) {
+		_stickerSetsDocumentsReader = std::move(reader);
+	}
 	const Stickers::Order &stickerSetsOrder() const {
 		return _stickerSetsOrder;
 	}
@@ -671,7 +697,9 @@ public:
 	void clearLocalStorage();
 
 private:
-	using Messages = std::unordered_map<MsgId, std::unique_ptr<HistoryItem>>;
+	using Messages = base::flat_hash_map<
+		MsgId,
+		std::unique_ptr<HistoryItem>>;
 
 	void suggestStartExport();
 
@@ -682,6 +710,9 @@ private:
 
 	void checkSelfDestructItems();
 
+	void reservePeers(int count);
+	void readStickerSetsDocuments() const;
+
 	int computeUnreadBadge(const Dialogs::UnreadState &state) const;
 	bool computeUnreadBadgeMuted(const Dialogs::UnreadState &state) const;
 
@@ -750,6 +781,7 @@ private:
 		const QString &siteName,
 		const QString &title,
 		const TextWithEntities &description,
+		int32 descriptionParseFlags,
 		PhotoData *photo,
 		DocumentData *document,
 		WebPageCollage &&collage,
@@ -807,6 +839,7 @@ private:
 
 	Storage::DatabasePointer _cache;
 	Storage::DatabasePointer _bigFileCache;
+	Storage::DatabasePointer _messagesCache;
 
 	std::unique_ptr<Export::Controller> _export;
 	std::unique_ptr<Export::View::PanelController> _exportPanel;
@@ -826,6 +859,8 @@ private:
 	rpl::event_stream<not_null<const HistoryItem*>> _itemResizeRequest;
 	rpl::event_stream<not_null<ViewElement*>> _viewResizeRequest;
 	rpl::event_stream<not_null<HistoryItem*>> _itemViewRefreshRequest;
+	int _itemViewRefreshSuspended = 0;
+	base::flat_set<not_null<HistoryItem*>> _itemViewRefreshPending;
 	rpl::event_stream<not_null<HistoryItem*>> _itemTextRefreshRequest;
 	rpl::event_stream<not_null<HistoryItem*>> _animationPlayInlineRequest;
 	rpl::event_stream<not_null<const HistoryItem*>> _itemRemoved;
@@ -848,6 +883,7 @@ private:
 	crl::time _lastSavedGifsUpdate = 0;
 	rpl::variable<int> _featuredStickerSetsUnreadCount = 0;
 	Stickers::Sets _stickerSets;
+	mutable Fn<void()> _stickerSetsDocumentsReader;
 	Stickers::Order _stickerSetsOrder;
 	Stickers::Order _featuredStickerSetsOrder;
 	Stickers::Order _archivedStickerSetsOrder;
@@ -873,19 +909,19 @@ private:
 	base::flat_map<not_null<History*>, crl::time> _sendActions;
 	Ui::Animations::Basic _sendActionsAnimation;
 
-	std::unordered_map<
+	base::flat_hash_map<
 		PhotoId,
 		std::unique_ptr<PhotoData>> _photos;
 	std::unordered_map<
 		not_null<const PhotoData*>,
 		base::flat_set<not_null<HistoryItem*>>> _photoItems;
-	std::unordered_map<
+	base::flat_hash_map<
 		DocumentId,
 		std::unique_ptr<DocumentData>> _documents;
 	std::unordered_map<
 		not_null<const DocumentData*>,
 		base::flat_set<not_null<HistoryItem*>>> _documentItems;
-	std::unordered_map<
+	base::flat_hash_map<
 		WebPageId,
 		std::unique_ptr<WebPageData>> _webpages;
 	std::unordered_map<
@@ -948,8 +984,8 @@ private:
 	std::unordered_set<not_null<const PeerData*>> _mutedPeers;
 	base::Timer _unmuteByFinishedTimer;
 
-	std::unordered_map<PeerId, std::unique_ptr<PeerData>> _peers;
-	std::unordered_map<PeerId, std::unique_ptr<History>> _histories;
+	base::flat_hash_map<PeerId, std::unique_ptr<PeerData>> _peers;
+	base::flat_hash_map<PeerId, std::unique_ptr<History>> _histories;
 
 	MessageIdsList _mimeForwardIds;
 
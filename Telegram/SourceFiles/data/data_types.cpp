@@ -32,6 +32,9 @@ constexpr auto kUrlCacheMask = 0x000000FFFFFFFFFFULL;
 constexpr auto kGeoPointCacheTag = 0x0000040000000000ULL;
 constexpr auto kGeoPointCacheMask = 0x000000FFFFFFFFFFULL;
 
+constexpr auto kInternedStringMaxLength = 64;
+constexpr auto kInternedStringsLimit = 16384;
+
 } // namespace
 
 struct ReplyPreview::Data {
@@ -109,6 +112,20 @@ Storage::Cache::Key GeoPointCacheKey(const GeoPointLocation &location) {
 	};
 }
 
+QString InternedString(const QString &value) {
+	if (value.isEmpty() || value.size() > kInternedStringMaxLength) {
+		return value;
+	}
+	static auto Strings = QSet<QString>();
+	const auto i = Strings.constFind(value);
+	if (i != Strings.cend()) {
+		return *i;
+	} else if (Strings.size() < kInternedStringsLimit) {
+		Strings.insert(value);
+	}
+	return value;
+}
+
 ReplyPreview::ReplyPreview() = default;
 
 ReplyPreview::ReplyPreview(ReplyPreview &&other) = default;
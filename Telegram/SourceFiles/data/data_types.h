@@ -48,6 +48,10 @@ Storage::Cache::Key WebDocumentCacheKey(const WebFileLocation &location);
 Storage::Cache::Key UrlCacheKey(const QString &location);
 Storage::Cache::Key GeoPointCacheKey(const GeoPointLocation &location);
 
+// Main thread. Returns a shared copy of an equal string added before,
+// so repeated short strings like mime types don't take memory per object.
+QString InternedString(const QString &value);
+
 constexpr auto kImageCacheTag = uint8(0x01);
 constexpr auto kStickerCacheTag = uint8(0x02);
 constexpr auto kVoiceMessageCacheTag = uint8(0x03);
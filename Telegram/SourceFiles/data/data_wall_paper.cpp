@@ -565,6 +565,10 @@ QImage PreparePatternImage(
 QImage PrepareBlurredBackground(QImage image) {
 	constexpr auto kSize = 900;
 	constexpr auto kRadius = 24;
+
+	// A blur this strong leaves no details that a smaller intermediate
+	// could lose, so we blur the image downscaled with a smaller radius.
+	constexpr auto kIntermediateScale = 4;
 	if (image.width() > kSize || image.height() > kSize) {
 		image = image.scaled(
 			kSize,
@@ -572,7 +576,20 @@ QImage PrepareBlurredBackground(QImage image) {
 			Qt::KeepAspectRatio,
 			Qt::SmoothTransformation);
 	}
-	return Images::BlurLargeImage(image, kRadius);
+	const auto size = image.size();
+	const auto small = QSize(
+		size.width() / kIntermediateScale,
+		size.height() / kIntermediateScale);
+	if (small.width() <= kRadius || small.height() <= kRadius) {
+		return Images::BlurLargeImage(std::move(image), kRadius);
+	}
+	return Images::BlurLargeImage(
+		image.scaled(
+			small,
+			Qt::IgnoreAspectRatio,
+			Qt::SmoothTransformation),
+		kRadius / kIntermediateScale
+	).scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
 }
 
 namespace details {
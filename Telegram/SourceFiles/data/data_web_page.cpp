@@ -156,6 +156,7 @@ bool WebPageData::applyChanges(
 		const QString &newSiteName,
 		const QString &newTitle,
 		const TextWithEntities &newDescription,
+		int32 newDescriptionParseFlags,
 		PhotoData *newPhoto,
 		DocumentData *newDocument,
 		WebPageCollage &&newCollage,
@@ -198,7 +199,7 @@ bool WebPageData::applyChanges(
 		&& displayUrl == resultDisplayUrl
 		&& siteName == resultSiteName
 		&& title == resultTitle
-		&& description.text == newDescription.text
+		&& _description.text == newDescription.text
 		&& photo == newPhoto
 		&& document == newDocument
 		&& collage.items == newCollage.items
@@ -215,7 +216,8 @@ bool WebPageData::applyChanges(
 	displayUrl = resultDisplayUrl;
 	siteName = resultSiteName;
 	title = resultTitle;
-	description = newDescription;
+	_description = newDescription;
+	_descriptionParseFlags = newDescriptionParseFlags;
 	photo = newPhoto;
 	document = newDocument;
 	collage = std::move(newCollage);
@@ -233,6 +235,13 @@ bool WebPageData::applyChanges(
 	return true;
 }
 
+const TextWithEntities &WebPageData::description() const {
+	if (const auto flags = base::take(_descriptionParseFlags)) {
+		TextUtilities::ParseEntities(_description, flags);
+	}
+	return _description;
+}
+
 void WebPageData::replaceDocumentGoodThumbnail() {
 	if (!document || !photo || !document->goodThumbnail()) {
 		return;
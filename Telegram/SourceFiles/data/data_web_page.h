@@ -42,6 +42,7 @@ struct WebPageData {
 		const QString &newSiteName,
 		const QString &newTitle,
 		const TextWithEntities &newDescription,
+		int32 newDescriptionParseFlags,
 		PhotoData *newPhoto,
 		DocumentData *newDocument,
 		WebPageCollage &&newCollage,
@@ -49,13 +50,19 @@ struct WebPageData {
 		const QString &newAuthor,
 		int newPendingTill);
 
+	// The entities of the description are parsed on the first request,
+	// usually when a view of the web page is created.
+	[[nodiscard]] const TextWithEntities &description() const;
+	[[nodiscard]] const QString &descriptionText() const {
+		return _description.text;
+	}
+
 	WebPageId id = 0;
 	WebPageType type = WebPageType::Article;
 	QString url;
 	QString displayUrl;
 	QString siteName;
 	QString title;
-	TextWithEntities description;
 	int duration = 0;
 	QString author;
 	PhotoData *photo = nullptr;
@@ -67,4 +74,7 @@ struct WebPageData {
 private:
 	void replaceDocumentGoodThumbnail();
 
+	mutable TextWithEntities _description;
+	mutable int32 _descriptionParseFlags = 0;
+
 };
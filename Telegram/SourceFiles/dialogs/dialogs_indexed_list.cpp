@@ -13,6 +13,26 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace Dialogs {
 
+bool RowMatchesWords(
+		not_null<const Row*> row,
+		const QStringList &words) {
+	const auto &nameWords = row->entry()->chatListNameWords();
+	const auto found = [&](const QString &word) {
+		for (const auto &name : nameWords) {
+			if (name.startsWith(word)) {
+				return true;
+			}
+		}
+		return false;
+	};
+	for (const auto &word : words) {
+		if (!found(word)) {
+			return false;
+		}
+	}
+	return true;
+}
+
 IndexedList::IndexedList(SortMode sortMode)
 : _sortMode(sortMode)
 , _list(sortMode)
@@ -226,24 +246,7 @@ std::vector<not_null<Row*>> IndexedList::filtered(
 	}
 	result.reserve(minimal->size());
 	for (const auto row : *minimal) {
-		const auto &nameWords = row->entry()->chatListNameWords();
-		const auto found = [&](const QString &word) {
-			for (const auto &name : nameWords) {
-				if (name.startsWith(word)) {
-					return true;
-				}
-			}
-			return false;
-		};
-		const auto allFound = [&] {
-			for (const auto &word : words) {
-				if (!found(word)) {
-					return false;
-				}
-			}
-			return true;
-		}();
-		if (allFound) {
+		if (RowMatchesWords(row, words)) {
 			result.push_back(row);
 		}
 	}
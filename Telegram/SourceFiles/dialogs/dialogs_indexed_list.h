@@ -14,6 +14,11 @@ class History;
 
 namespace Dialogs {
 
+// Each of the words should be a prefix of some of the row name words.
+[[nodiscard]] bool RowMatchesWords(
+	not_null<const Row*> row,
+	const QStringList &words);
+
 class IndexedList {
 public:
 	IndexedList(SortMode sortMode);
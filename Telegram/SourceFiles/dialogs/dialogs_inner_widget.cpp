@@ -14,6 +14,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 //#include "history/feed/history_feed_section.h" // #feed
 #include "history/history.h"
 #include "history/history_item.h"
+#include "history/view/history_view_element.h"
 #include "core/shortcuts.h"
 #include "ui/widgets/buttons.h"
 #include "ui/widgets/popup_menu.h"
@@ -47,6 +48,8 @@ namespace {
 
 constexpr auto kHashtagResultsLimit = 5;
 constexpr auto kStartReorderThreshold = 30;
+constexpr auto kRowsRepaintDelay = crl::time(16);
+constexpr auto kLocalSearchLimit = 20;
 
 int FixedOnTopDialogsCount(not_null<Dialogs::IndexedList*> list) {
 	auto result = 0;
@@ -72,6 +75,23 @@ int PinnedDialogsCount(not_null<Dialogs::IndexedList*> list) {
 	return result;
 }
 
+// Rows found by the new words are among the rows found by the previous
+// words if each of the previous words is a prefix of some new word.
+bool SearchNarrowed(const QStringList &was, const QStringList &now) {
+	if (was.isEmpty()) {
+		return false;
+	}
+	for (const auto &word : was) {
+		const auto extended = ranges::find_if(now, [&](const QString &n) {
+			return n.startsWith(word);
+		});
+		if (extended == now.end()) {
+			return false;
+		}
+	}
+	return true;
+}
+
 } // namespace
 
 struct InnerWidget::CollapsedRow {
@@ -106,7 +126,8 @@ InnerWidget::InnerWidget(
 })
 , _addContactLnk(this, lang(lng_add_contact_button))
 , _cancelSearchInChat(this, st::dialogsCancelSearchInPeer)
-, _cancelSearchFromUser(this, st::dialogsCancelSearchInPeer) {
+, _cancelSearchFromUser(this, st::dialogsCancelSearchInPeer)
+, _rowsRepaintTimer([=] { repaintScheduledRows(); }) {
 
 #ifndef OS_MAC_OLD // Qt 5.3.2 build is working with glitches otherwise.
 	setAttribute(Qt::WA_OpaquePaintEvent, true);
@@ -192,6 +213,7 @@ InnerWidget::InnerWidget(
 	subscribe(Window::Theme::Background(), [=](const Window::Theme::BackgroundUpdate &data) {
 		if (data.paletteChanged()) {
 			Layout::clearUnreadBadgesCache();
+			Layout::clearRowsCache();
 		}
 	});
 
@@ -1477,17 +1499,21 @@ void InnerWidget::repaintDialogRow(
 			if (base::in_range(position, 0, _pinnedRows.size())) {
 				top += qRound(_pinnedRows[position].yadd.current());
 			}
-			update(0, top + position * st::dialogsRowHeight, width(), st::dialogsRowHeight);
+			scheduleRowRepaint(QRect(
+				0,
+				top + position * st::dialogsRowHeight,
+				width(),
+				st::dialogsRowHeight));
 		}
 	} else if (_state == WidgetState::Filtered) {
 		if (list == Mode::All) {
 			for (auto i = 0, l = int(_filterResults.size()); i != l; ++i) {
 				if (_filterResults[i]->key() == row->key()) {
-					update(
+					scheduleRowRepaint(QRect(
 						0,
 						filteredOffset() + i * st::dialogsRowHeight,
 						width(),
-						st::dialogsRowHeight);
+						st::dialogsRowHeight));
 					break;
 				}
 			}
@@ -1495,6 +1521,28 @@ void InnerWidget::repaintDialogRow(
 	}
 }
 
+void InnerWidget::scheduleRowRepaint(QRect rect) {
+	if (rect.y() >= _visibleBottom
+		|| rect.y() + rect.height() <= _visibleTop) {
+		return;
+	}
+	_rowsRepaint = _rowsRepaint.united(rect);
+	if (_rowsRepaintTimer.isActive()) {
+		return;
+	}
+	const auto passed = crl::now() - _rowsRepaintedAt;
+	if (passed >= kRowsRepaintDelay) {
+		repaintScheduledRows();
+	} else {
+		_rowsRepaintTimer.callOnce(kRowsRepaintDelay - passed);
+	}
+}
+
+void InnerWidget::repaintScheduledRows() {
+	_rowsRepaintedAt = crl::now();
+	update(base::take(_rowsRepaint));
+}
+
 void InnerWidget::repaintDialogRow(RowDescriptor row) {
 	updateDialogRow(row);
 }
@@ -1534,11 +1582,11 @@ void InnerWidget::updateDialogRow(
 	}
 
 	const auto updateRow = [&](int rowTop) {
-		rtlupdate(
+		scheduleRowRepaint(myrtlrect(
 			updateRect.x(),
 			rowTop + updateRect.y(),
 			updateRect.width(),
-			updateRect.height());
+			updateRect.height()));
 	};
 	if (_state == WidgetState::Default) {
 		if (sections & UpdateRowSection::Default) {
@@ -1768,14 +1816,35 @@ void InnerWidget::applyFilterUpdate(QString newFilter, bool force) {
 		: TextUtilities::PrepareSearchWords(newFilter);
 	newFilter = words.isEmpty() ? QString() : words.join(' ');
 	if (newFilter != _filter || force) {
+		// While typing a query only the previous results are checked.
+		// Filtering stays on the main thread: name words of the entries
+		// are changed here by peerNameChanged() and rows may be replaced
+		// or removed between the keystrokes, so a worker would need
+		// a full snapshot, costing as much as the filtering itself.
+		const auto narrowed = !force
+			&& !mentionsSearch
+			&& (_state == WidgetState::Filtered)
+			&& SearchNarrowed(
+				_filter.split(' ', QString::SkipEmptyParts),
+				words);
 		_filter = newFilter;
 		if (_filter.isEmpty() && !_searchFromUser) {
 			clearFilter();
 		} else {
 			_state = WidgetState::Filtered;
 			_waitingForSearch = true;
+			const auto previous = narrowed
+				? base::take(_filterResults)
+				: std::vector<not_null<Row*>>();
+			const auto global = [&](not_null<Row*> row) {
+				const auto history = row->history();
+				const auto i = history
+					? _filterResultsGlobal.find(history->peer)
+					: end(_filterResultsGlobal);
+				return (i != end(_filterResultsGlobal))
+					&& (i->second.get() == row);
+			};
 			_filterResults.clear();
-			_filterResultsGlobal.clear();
 			const auto append = [&](not_null<IndexedList*> list) {
 				const auto results = list->filtered(words);
 				_filterResults.insert(
@@ -1784,13 +1853,22 @@ void InnerWidget::applyFilterUpdate(QString newFilter, bool force) {
 					end(results));
 			};
 			if (!_searchInChat && !words.isEmpty()) {
-				append(session().data().chatsList()->indexed());
-				const auto id = Data::Folder::kId;
-				if (const auto folder = session().data().folderLoaded(id)) {
-					append(folder->chatsList()->indexed());
+				if (narrowed) {
+					for (const auto row : previous) {
+						if (!global(row) && RowMatchesWords(row, words)) {
+							_filterResults.push_back(row);
+						}
+					}
+				} else {
+					append(session().data().chatsList()->indexed());
+					const auto id = Data::Folder::kId;
+					if (const auto folder = session().data().folderLoaded(id)) {
+						append(folder->chatsList()->indexed());
+					}
+					append(session().data().contactsNoChatsList());
 				}
-				append(session().data().contactsNoChatsList());
 			}
+			_filterResultsGlobal.clear();
 			refresh(true);
 		}
 		clearMouseSelection(true);
@@ -1942,6 +2020,60 @@ bool InnerWidget::hasHistoryInResults(not_null<History*> history) const {
 	return false;
 }
 
+void InnerWidget::searchLocal(const QString &query) {
+	const auto peer = _searchInChat.peer();
+	if (!peer || _searchFromUser || !_waitingForSearch) {
+		return;
+	}
+	const auto history = peer->owner().historyLoaded(peer);
+	const auto words = TextUtilities::PrepareSearchWords(query);
+	if (!history || words.isEmpty()) {
+		return;
+	}
+	const auto matches = [&](not_null<HistoryItem*> item) {
+		if (!IsServerMsgId(item->id)) {
+			return false;
+		}
+		const auto text = TextUtilities::RemoveAccents(
+			item->originalText().text).toLower();
+		for (const auto &word : words) {
+			if (!text.contains(word)) {
+				return false;
+			}
+		}
+		return true;
+	};
+
+	// Only the messages already loaded are checked, newest first.
+	// The server results replace these ones in searchReceived().
+	auto found = std::vector<not_null<HistoryItem*>>();
+	for (auto b = history->blocks.rbegin(); b != history->blocks.rend(); ++b) {
+		const auto &messages = (*b)->messages;
+		for (auto m = messages.rbegin(); m != messages.rend(); ++m) {
+			const auto item = (*m)->data();
+			if (matches(item)) {
+				found.push_back(item);
+				if (found.size() == size_t(kLocalSearchLimit)) {
+					break;
+				}
+			}
+		}
+		if (found.size() == size_t(kLocalSearchLimit)) {
+			break;
+		}
+	}
+	if (found.empty() && _searchResults.empty()) {
+		return;
+	}
+	clearSearchResults(false);
+	for (const auto item : found) {
+		_searchResults.push_back(
+			std::make_unique<FakeRow>(_searchInChat, item));
+	}
+	_searchedCount = int(found.size());
+	refresh();
+}
+
 bool InnerWidget::searchReceived(
 		const QVector<MTPMessage> &messages,
 		SearchRequestType type,
@@ -12,6 +12,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/effects/animations.h"
 #include "ui/rp_widget.h"
 #include "base/flags.h"
+#include "base/timer.h"
 
 class AuthSession;
 
@@ -60,6 +61,7 @@ class InnerWidget
 public:
 	InnerWidget(QWidget *parent, not_null<Window::Controller*> controller);
 
+	void searchLocal(const QString &query);
 	bool searchReceived(
 		const QVector<MTPMessage> &result,
 		SearchRequestType type,
@@ -229,6 +231,11 @@ private:
 		RowDescriptor row,
 		QRect updateRect = QRect(),
 		UpdateRowSections sections = UpdateRowSection::All);
+
+	// Rows updates during one frame are painted together and rows outside
+	// of the visible area are not repainted at all.
+	void scheduleRowRepaint(QRect rect);
+	void repaintScheduledRows();
 	void fillSupportSearchMenu(not_null<Ui::PopupMenu*> menu);
 
 	int dialogsOffset() const;
@@ -324,6 +331,9 @@ private:
 
 	int _visibleTop = 0;
 	int _visibleBottom = 0;
+	QRect _rowsRepaint;
+	crl::time _rowsRepaintedAt = 0;
+	base::Timer _rowsRepaintTimer;
 	QString _filter, _hashtagFilter;
 
 	std::vector<std::unique_ptr<HashtagResult>> _hashtagResults;
@@ -43,25 +43,26 @@ void PaintRowTopRight(Painter &p, const QString &text, QRect &rectForName, bool
 	p.drawText(rectForName.left() + rectForName.width() + st::dialogsDateSkip, rectForName.top() + st::msgNameFont->height - st::msgDateFont->descent, text);
 }
 
-void PaintRowDate(Painter &p, QDateTime date, QRect &rectForName, bool active, bool selected) {
+QString RowDateText(QDateTime date) {
 	const auto now = QDateTime::currentDateTime();
 	const auto &lastTime = date;
 	const auto nowDate = now.date();
 	const auto lastDate = lastTime.date();
 
-	const auto dt = [&] {
-		const auto wasSameDay = (lastDate == nowDate);
-		const auto wasRecently = qAbs(lastTime.secsTo(now)) < kRecentlyInSeconds;
-		if (wasSameDay || wasRecently) {
-			return lastTime.toString(cTimeFormat());
-		} else if (lastDate.year() == nowDate.year()
-			&& lastDate.weekNumber() == nowDate.weekNumber()) {
-			return langDayOfWeek(lastDate);
-		} else {
-			return lastDate.toString(qsl("d.MM.yy"));
-		}
-	}();
-	PaintRowTopRight(p, dt, rectForName, active, selected);
+	const auto wasSameDay = (lastDate == nowDate);
+	const auto wasRecently = qAbs(lastTime.secsTo(now)) < kRecentlyInSeconds;
+	if (wasSameDay || wasRecently) {
+		return lastTime.toString(cTimeFormat());
+	} else if (lastDate.year() == nowDate.year()
+		&& lastDate.weekNumber() == nowDate.weekNumber()) {
+		return langDayOfWeek(lastDate);
+	} else {
+		return lastDate.toString(qsl("d.MM.yy"));
+	}
+}
+
+void PaintRowDate(Painter &p, QDateTime date, QRect &rectForName, bool active, bool selected) {
+	PaintRowTopRight(p, RowDateText(date), rectForName, active, selected);
 }
 
 void PaintNarrowCounter(
@@ -473,6 +474,82 @@ QImage colorizeCircleHalf(UnreadBadgeSizeData *data, int size, int half, int xof
 	return result;
 }
 
+// Everything that affects the look of a cached row.
+struct RowCacheKey {
+	const Entry *entry = nullptr;
+	const HistoryItem *item = nullptr;
+	MsgId itemId = 0;
+	bool itemUnread = false;
+	const PeerData *from = nullptr;
+	int nameVersion = 0;
+	bool verified = false;
+	InMemoryKey userpicKey;
+	bool userpicLoaded = false;
+	const style::icon *chatTypeIcon = nullptr;
+	QString date;
+	int unreadCount = 0;
+	bool unreadMark = false;
+	bool unreadMuted = false;
+	bool mentionBadge = false;
+	bool pinned = false;
+	int width = 0;
+	base::flags<Flag> flags;
+
+	inline bool operator==(const RowCacheKey &other) const {
+		return (entry == other.entry)
+			&& (item == other.item)
+			&& (itemId == other.itemId)
+			&& (itemUnread == other.itemUnread)
+			&& (from == other.from)
+			&& (nameVersion == other.nameVersion)
+			&& (verified == other.verified)
+			&& (userpicKey == other.userpicKey)
+			&& (userpicLoaded == other.userpicLoaded)
+			&& (chatTypeIcon == other.chatTypeIcon)
+			&& (date == other.date)
+			&& (unreadCount == other.unreadCount)
+			&& (unreadMark == other.unreadMark)
+			&& (unreadMuted == other.unreadMuted)
+			&& (mentionBadge == other.mentionBadge)
+			&& (pinned == other.pinned)
+			&& (width == other.width)
+			&& (flags.value() == other.flags.value());
+	}
+
+};
+
+struct RowCache {
+	RowCacheKey key;
+	QImage image;
+	int64 usedAt = 0;
+};
+
+class RowsCacheData : public Data::AbstractStructure {
+public:
+	base::flat_map<not_null<const Row*>, RowCache> rows;
+	int64 counter = 0;
+
+};
+Data::GlobalStructurePointer<RowsCacheData> rowsCache;
+
+// Enough for a few screens of rows when scrolling back and forth.
+constexpr auto kRowsCacheLimit = 64;
+
+RowCache &LookupRowCache(not_null<const Row*> row) {
+	rowsCache.createIfNull();
+	auto &rows = rowsCache->rows;
+	if (!rows.contains(row) && rows.size() >= kRowsCacheLimit) {
+		const auto oldest = ranges::min_element(
+			rows,
+			std::less<>(),
+			[](const auto &pair) { return pair.second.usedAt; });
+		rows.erase(oldest);
+	}
+	auto &result = rows[row];
+	result.usedAt = ++rowsCache->counter;
+	return result;
+}
+
 } // namepsace
 
 const style::icon *ChatTypeIcon(
@@ -585,7 +662,7 @@ void paintUnreadCount(
 }
 
 void RowPainter::paint(
-		Painter &p,
+		Painter &painter,
 		not_null<const Row*> row,
 		int fullWidth,
 		bool active,
@@ -651,81 +728,133 @@ void RowPainter::paint(
 	const auto flags = (active ? Flag::Active : Flag(0))
 		| (selected ? Flag::Selected : Flag(0))
 		| (peer && peer->isSelf() ? Flag::SavedMessages : Flag(0));
-	const auto paintItemCallback = [&](int nameleft, int namewidth) {
-		const auto texttop = st::dialogsPadding.y()
-			+ st::msgNameFont->height
-			+ st::dialogsSkip;
-		const auto availableWidth = PaintWideCounter(
-			p,
-			texttop,
-			namewidth,
-			fullWidth,
-			displayUnreadCounter,
-			displayUnreadMark,
-			displayMentionBadge,
-			displayPinnedIcon,
-			unreadCount,
-			active,
-			selected,
-			unreadMuted,
-			mentionMuted);
-		const auto &color = active
-			? st::dialogsTextFgServiceActive
-			: (selected
-				? st::dialogsTextFgServiceOver
-				: st::dialogsTextFgService);
-		const auto itemRect = QRect(
-			nameleft,
-			texttop,
-			availableWidth,
-			st::dialogsTextFont->height);
-		const auto actionWasPainted = history ? history->paintSendAction(
-			p,
-			itemRect.x(),
-			itemRect.y(),
-			itemRect.width(),
-			fullWidth,
-			color,
-			ms) : false;
-		if (const auto folder = row->folder()) {
-			PaintListEntryText(p, itemRect, active, selected, row);
-		} else if (!actionWasPainted) {
-			item->drawInDialog(
+	const auto paintContent = [&](Painter &p) {
+		const auto paintItemCallback = [&](int nameleft, int namewidth) {
+			const auto texttop = st::dialogsPadding.y()
+				+ st::msgNameFont->height
+				+ st::dialogsSkip;
+			const auto availableWidth = PaintWideCounter(
 				p,
-				itemRect,
+				texttop,
+				namewidth,
+				fullWidth,
+				displayUnreadCounter,
+				displayUnreadMark,
+				displayMentionBadge,
+				displayPinnedIcon,
+				unreadCount,
 				active,
 				selected,
-				HistoryItem::DrawInDialog::Normal,
-				entry->textCachedFor,
-				entry->lastItemTextCache);
-		}
-	};
-	const auto paintCounterCallback = [&] {
-		PaintNarrowCounter(
+				unreadMuted,
+				mentionMuted);
+			const auto &color = active
+				? st::dialogsTextFgServiceActive
+				: (selected
+					? st::dialogsTextFgServiceOver
+					: st::dialogsTextFgService);
+			const auto itemRect = QRect(
+				nameleft,
+				texttop,
+				availableWidth,
+				st::dialogsTextFont->height);
+			const auto actionWasPainted = history ? history->paintSendAction(
+				p,
+				itemRect.x(),
+				itemRect.y(),
+				itemRect.width(),
+				fullWidth,
+				color,
+				ms) : false;
+			if (const auto folder = row->folder()) {
+				PaintListEntryText(p, itemRect, active, selected, row);
+			} else if (!actionWasPainted) {
+				item->drawInDialog(
+					p,
+					itemRect,
+					active,
+					selected,
+					HistoryItem::DrawInDialog::Normal,
+					entry->textCachedFor,
+					entry->lastItemTextCache);
+			}
+		};
+		const auto paintCounterCallback = [&] {
+			PaintNarrowCounter(
+				p,
+				displayUnreadCounter,
+				displayUnreadMark,
+				displayMentionBadge,
+				unreadCount,
+				active,
+				unreadMuted,
+				mentionMuted);
+		};
+		paintRow(
 			p,
-			displayUnreadCounter,
-			displayUnreadMark,
-			displayMentionBadge,
-			unreadCount,
-			active,
-			unreadMuted,
-			mentionMuted);
+			row,
+			entry,
+			row->key(),
+			from,
+			nullptr,
+			item,
+			cloudDraft,
+			displayDate,
+			fullWidth,
+			flags,
+			ms,
+			paintItemCallback,
+			paintCounterCallback);
 	};
-	paintRow(
-		p,
-		row,
-		entry,
-		row->key(),
-		from,
-		nullptr,
-		item,
-		cloudDraft,
-		displayDate,
-		fullWidth,
-		flags,
-		ms,
-		paintItemCallback,
-		paintCounterCallback);
+
+	// Rows with animations or with texts not prepared yet are painted
+	// directly, all the others are blitted from a cached image.
+	const auto cacheable = history
+		&& from
+		&& item
+		&& !item->isEmpty()
+		&& (history->textCachedFor == item)
+		&& !cloudDraft
+		&& !row->folder()
+		&& !row->hasRipple()
+		&& !history->hasSendAction()
+		&& !history->useProxyPromotion()
+		&& !Auth().supportMode();
+	if (!cacheable) {
+		paintContent(painter);
+		return;
+	}
+	auto key = RowCacheKey();
+	key.entry = entry;
+	key.item = item;
+	key.itemId = item->id;
+	key.itemUnread = item->unread();
+	key.from = from;
+	key.nameVersion = from->nameVersion;
+	key.verified = from->isVerified();
+	key.userpicKey = from->userpicUniqueKey();
+	key.userpicLoaded = bool(from->currentUserpic());
+	key.chatTypeIcon = ChatTypeIcon(from, active, selected);
+	key.date = RowDateText(displayDate);
+	key.unreadCount = unreadCount;
+	key.unreadMark = unreadMark;
+	key.unreadMuted = unreadMuted;
+	key.mentionBadge = displayMentionBadge;
+	key.pinned = entry->isPinnedDialog() && !entry->fixedOnTopIndex();
+	key.width = fullWidth;
+	key.flags = flags;
+
+	auto &cache = LookupRowCache(row);
+	if (cache.image.isNull() || !(cache.key == key)) {
+		const auto ratio = cIntRetinaFactor();
+		cache.key = std::move(key);
+		cache.image = QImage(
+			QSize(fullWidth, st::dialogsRowHeight) * ratio,
+			QImage::Format_ARGB32_Premultiplied);
+		cache.image.setDevicePixelRatio(ratio);
+		auto q = Painter(&cache.image);
+		paintContent(q);
+	}
+	painter.drawImage(0, 0, cache.image);
 }
 
 void RowPainter::paint(
@@ -909,6 +1038,12 @@ void PaintCollapsedRow(
 	}
 }
 
+void clearRowsCache() {
+	if (rowsCache) {
+		rowsCache->rows.clear();
+	}
+}
+
 void clearUnreadBadgesCache() {
 	if (unreadBadgeStyle) {
 		for (auto &data : unreadBadgeStyle->sizes) {
@@ -90,6 +90,7 @@ void paintUnreadCount(
 	int allowDigits = 0);
 
 void clearUnreadBadgesCache();
+void clearRowsCache();
 
 } // namespace Layout
 } // namespace Dialogs
@@ -56,6 +56,7 @@ void MainList::unreadStateChanged(
 		const UnreadState &wasState,
 		const UnreadState &nowState) {
 	_unreadState += nowState - wasState;
+	validateUnreadState();
 }
 
 void MainList::unreadEntryChanged(
@@ -66,6 +67,23 @@ void MainList::unreadEntryChanged(
 	} else {
 		_unreadState -= state;
 	}
+	validateUnreadState();
+}
+
+void MainList::validateUnreadState() const {
+#ifdef _DEBUG
+	// Check the incremental counters against a full recount.
+	auto counted = UnreadState();
+	for (const auto row : _all) {
+		counted += row->entry()->chatListUnreadState();
+	}
+	Assert(counted.messages == _unreadState.messages);
+	Assert(counted.messagesMuted == _unreadState.messagesMuted);
+	Assert(counted.chats == _unreadState.chats);
+	Assert(counted.chatsMuted == _unreadState.chatsMuted);
+	Assert(counted.marks == _unreadState.marks);
+	Assert(counted.marksMuted == _unreadState.marksMuted);
+#endif // _DEBUG
 }
 
 UnreadState MainList::unreadState() const {
@@ -27,6 +27,7 @@ public:
 	void unreadEntryChanged(
 		const Dialogs::UnreadState &state,
 		bool added);
+	// Updated by the deltas of the entries, without walking the list.
 	UnreadState unreadState() const;
 
 	not_null<IndexedList*> indexed(Mode list = Mode::All);
@@ -35,6 +36,8 @@ public:
 	not_null<const PinnedList*> pinned() const;
 
 private:
+	void validateUnreadState() const;
+
 	IndexedList _all;
 	IndexedList _important;
 	PinnedList _pinned;
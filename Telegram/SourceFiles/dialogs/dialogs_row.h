@@ -29,6 +29,9 @@ public:
 
 	void addRipple(QPoint origin, QSize size, Fn<void()> updateCallback);
 	void stopLastRipple();
+	bool hasRipple() const {
+		return (_ripple != nullptr);
+	}
 
 	void paintRipple(Painter &p, int x, int y, int outerWidth, const QColor *colorOverride = nullptr) const;
 
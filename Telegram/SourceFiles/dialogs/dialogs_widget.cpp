@@ -830,6 +830,7 @@ bool Widget::searchForPeersRequired(const QString &query) const {
 
 void Widget::onNeedSearchMessages() {
 	if (!onSearchMessages(true)) {
+		_inner->searchLocal(_filter->getLastText().trimmed());
 		_searchTimer.start(AutoSearchTimeout);
 	}
 }
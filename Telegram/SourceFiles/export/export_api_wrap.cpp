@@ -11,9 +11,11 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "export/data/export_data_types.h"
 #include "export/output/export_output_result.h"
 #include "export/output/export_output_file.h"
+#include "export/output/export_output_journal.h"
 #include "mtproto/rpc_sender.h"
 #include "base/value_ordering.h"
 #include "base/bytes.h"
+#include "base/flat_map.h"
 #include <set>
 #include <deque>
 
@@ -23,12 +25,13 @@ namespace {
 constexpr auto kUserpicsSliceLimit = 100;
 constexpr auto kFileChunkSize = 128 * 1024;
 constexpr auto kFileRequestsCount = 2;
-constexpr auto kFileNextRequestDelay = crl::time(20);
+constexpr auto kFileLoadsCount = 8;
+constexpr auto kFileRequestsPerDcCount = 8;
+constexpr auto kFileDelayedRequest = crl::time(2000);
 constexpr auto kChatsSliceLimit = 100;
 constexpr auto kMessagesSliceLimit = 100;
 constexpr auto kTopPeerSliceLimit = 100;
 constexpr auto kFileMaxSize = 1500 * 1024 * 1024;
-constexpr auto kLocationCacheSize = 100'000;
 
 struct LocationKey {
 	uint64 type;
@@ -88,6 +91,13 @@ LocationKey ComputeLocationKey(const Data::FileLocation &value) {
 	return result;
 }
 
+QByteArray ComputeJournalKey(const Data::FileLocation &value) {
+	const auto key = ComputeLocationKey(value);
+	return QByteArray::number(key.type, 16)
+		+ ':'
+		+ QByteArray::number(key.id, 16);
+}
+
 Settings::Type SettingsFromDialogsType(Data::DialogInfo::Type type) {
 	using DialogType = Data::DialogInfo::Type;
 	switch (type) {
@@ -111,22 +121,6 @@ Settings::Type SettingsFromDialogsType(Data::DialogInfo::Type type) {
 
 } // namespace
 
-class ApiWrap::LoadedFileCache {
-public:
-	using Location = Data::FileLocation;
-
-	LoadedFileCache(int limit);
-
-	void save(const Location &location, const QString &relativePath);
-	std::optional<QString> find(const Location &location) const;
-
-private:
-	int _limit = 0;
-	std::map<LocationKey, QString> _map;
-	std::deque<LocationKey> _list;
-
-};
-
 struct ApiWrap::StartProcess {
 	FnMut<void(StartInfo)> done;
 
@@ -170,12 +164,16 @@ struct ApiWrap::OtherDataProcess {
 struct ApiWrap::FileProcess {
 	FileProcess(const QString &path, Output::Stats *stats);
 
+	uint64 id = 0;
 	Output::File file;
 	QString relativePath;
 
 	Fn<bool(FileProgress)> progress;
 	FnMut<void(const QString &relativePath)> done;
 
+	// Loads of the same location requested while this one is in flight.
+	std::vector<FnMut<void(const QString &relativePath)>> duplicates;
+
 	Data::FileLocation location;
 	int offset = 0;
 	int size = 0;
@@ -188,10 +186,26 @@ struct ApiWrap::FileProcess {
 };
 
 struct ApiWrap::FileProgress {
+	QString path;
 	int ready = 0;
 	int total = 0;
 };
 
+struct ApiWrap::FileQueue {
+	// When MTP receives FLOOD_WAIT it resends the request after a delay,
+	// so slow responses make us send less requests to that DC for a while.
+	struct Dc {
+		int requests = 0;
+		int limit = kFileRequestsPerDcCount;
+		crl::time slowUntil = 0;
+	};
+
+	// Ordered by id, so earlier files get their parts first.
+	std::map<uint64, std::unique_ptr<FileProcess>> processes;
+	base::flat_map<int32, Dc> dcs;
+	uint64 autoincrementId = 0;
+};
+
 struct ApiWrap::ChatsProcess {
 	Fn<bool(int count)> progress;
 	FnMut<void(Data::DialogsInfo&&)> done;
@@ -224,13 +238,22 @@ struct ApiWrap::ChatProcess {
 
 	FnMut<void(MTPmessages_Messages&&)> requestDone;
 
+	// Position of the next slice request, it goes ahead of the slice
+	// being loaded, so the next slice is fetched while the files load.
 	int localSplitIndex = 0;
 	int32 largestIdPlusOne = 1;
+	bool requesting = false;
+	bool lastSliceRequested = false;
+	bool stopped = false;
 
 	Data::ParseMediaContext context;
 	std::optional<Data::MessagesSlice> slice;
-	bool lastSlice = false;
+	std::optional<Data::MessagesSlice> nextSlice;
 	int fileIndex = 0;
+
+	// Indices of the messages with files in flight, the slice is passed
+	// to the writers only when all of them are loaded.
+	std::multiset<int> loading;
 };
 
 
@@ -310,38 +333,6 @@ mtpRequestId ApiWrap::RequestBuilder<Request>::send() {
 		: _builder.send();
 }
 
-ApiWrap::LoadedFileCache::LoadedFileCache(int limit) : _limit(limit) {
-	Expects(limit >= 0);
-}
-
-void ApiWrap::LoadedFileCache::save(
-		const Location &location,
-		const QString &relativePath) {
-	if (!location) {
-		return;
-	}
-	const auto key = ComputeLocationKey(location);
-	_map[key] = relativePath;
-	_list.push_back(key);
-	if (_list.size() > _limit) {
-		const auto key = _list.front();
-		_list.pop_front();
-		_map.erase(key);
-	}
-}
-
-std::optional<QString> ApiWrap::LoadedFileCache::find(
-		const Location &location) const {
-	if (!location) {
-		return std::nullopt;
-	}
-	const auto key = ComputeLocationKey(location);
-	if (const auto i = _map.find(key); i != end(_map)) {
-		return i->second;
-	}
-	return std::nullopt;
-}
-
 ApiWrap::FileProcess::FileProcess(const QString &path, Output::Stats *stats)
 : file(path, stats) {
 }
@@ -383,24 +374,12 @@ auto ApiWrap::fileRequest(const Data::FileLocation &location, int offset) {
 			location.data,
 			MTP_int(offset),
 			MTP_int(kFileChunkSize))
-	)).fail([=](RPCError &&result) {
-		if (result.type() == qstr("TAKEOUT_FILE_EMPTY")
-			&& _otherDataProcess != nullptr) {
-			filePartDone(0, MTP_upload_file(MTP_storage_filePartial(),
-				MTP_int(0),
-				MTP_bytes(QByteArray())));
-		} else if (result.type() == qstr("LOCATION_INVALID")
-			|| result.type() == qstr("VERSION_INVALID")) {
-			filePartUnavailable();
-		} else {
-			error(std::move(result));
-		}
-	}).toDC(MTP::ShiftDcId(location.dcId, MTP::kExportMediaDcShift)));
+	)).toDC(MTP::ShiftDcId(location.dcId, MTP::kExportMediaDcShift)));
 }
 
 ApiWrap::ApiWrap(Fn<void(FnMut<void()>)> runner)
 : _mtp(std::move(runner))
-, _fileCache(std::make_unique<LoadedFileCache>(kLocationCacheSize)) {
+, _fileQueue(std::make_unique<FileQueue>()) {
 }
 
 rpl::producer<RPCError> ApiWrap::errors() const {
@@ -420,6 +399,9 @@ void ApiWrap::startExport(
 
 	_settings = std::make_unique<Settings>(settings);
 	_stats = stats;
+	_journal = std::make_unique<Output::Journal>(
+		_settings->path,
+		_settings->format);
 	_startProcess = std::make_unique<StartProcess>();
 	_startProcess->done = std::move(done);
 
@@ -809,7 +791,6 @@ void ApiWrap::finishUserpicsSlice() {
 }
 
 bool ApiWrap::loadUserpicProgress(FileProgress progress) {
-	Expects(_fileProcess != nullptr);
 	Expects(_userpicsProcess != nullptr);
 	Expects(_userpicsProcess->slice.has_value());
 	Expects((_userpicsProcess->fileIndex >= 0)
@@ -817,7 +798,7 @@ bool ApiWrap::loadUserpicProgress(FileProgress progress) {
 			< _userpicsProcess->slice->list.size()));
 
 	return _userpicsProcess->fileProgress(DownloadProgress{
-		_fileProcess->relativePath,
+		progress.path,
 		_userpicsProcess->fileIndex,
 		progress.ready,
 		progress.total });
@@ -1016,6 +997,10 @@ void ApiWrap::messagesCountLoaded(int localSplitIndex, int count) {
 }
 
 void ApiWrap::finishExport(FnMut<void()> done) {
+	Expects(_journal != nullptr);
+
+	_journal->finish();
+
 	const auto guard = gsl::finally([&] { _takeoutId = std::nullopt; });
 
 	mainRequest(MTPaccount_FinishTakeoutSession(
@@ -1266,13 +1251,16 @@ void ApiWrap::appendChatsSlice(
 
 void ApiWrap::requestMessagesSlice() {
 	Expects(_chatProcess != nullptr);
+	Expects(!_chatProcess->requesting);
+	Expects(!_chatProcess->lastSliceRequested);
 
 	const auto count = _chatProcess->info.messagesCountPerSplit[
 		_chatProcess->localSplitIndex];
 	if (!count) {
-		loadMessagesFiles({});
+		messagesSliceReceived({}, true);
 		return;
 	}
+	_chatProcess->requesting = true;
 	requestChatMessages(
 		_chatProcess->info.splits[_chatProcess->localSplitIndex],
 		_chatProcess->largestIdPlusOne,
@@ -1281,18 +1269,21 @@ void ApiWrap::requestMessagesSlice() {
 		[=](const MTPmessages_Messages &result) {
 		Expects(_chatProcess != nullptr);
 
+		_chatProcess->requesting = false;
+		if (_chatProcess->stopped) {
+			return;
+		}
 		result.match([&](const MTPDmessages_messagesNotModified &data) {
 			error("Unexpected messagesNotModified received.");
 		}, [&](const auto &data) {
-			if constexpr (MTPDmessages_messages::Is<decltype(data)>()) {
-				_chatProcess->lastSlice = true;
-			}
-			loadMessagesFiles(Data::ParseMessagesSlice(
-				_chatProcess->context,
-				data.vmessages,
-				data.vusers,
-				data.vchats,
-				_chatProcess->info.relativePath));
+			messagesSliceReceived(
+				Data::ParseMessagesSlice(
+					_chatProcess->context,
+					data.vmessages,
+					data.vusers,
+					data.vchats,
+					_chatProcess->info.relativePath),
+				MTPDmessages_messages::Is<decltype(data)>());
 		});
 	});
 }
@@ -1361,16 +1352,42 @@ void ApiWrap::requestChatMessages(
 	}
 }
 
+void ApiWrap::messagesSliceReceived(
+		Data::MessagesSlice &&slice,
+		bool lastInSplit) {
+	Expects(_chatProcess != nullptr);
+	Expects(!_chatProcess->nextSlice.has_value());
+
+	if (!slice.list.empty()) {
+		_chatProcess->largestIdPlusOne = slice.list.back().id + 1;
+	}
+	if (lastInSplit || slice.list.empty()) {
+		if (++_chatProcess->localSplitIndex
+			< _chatProcess->info.splits.size()) {
+			_chatProcess->largestIdPlusOne = 1;
+		} else {
+			_chatProcess->lastSliceRequested = true;
+		}
+	}
+
+	// Only one slice is kept ahead, it waits till the current is written.
+	if (_chatProcess->slice.has_value()) {
+		_chatProcess->nextSlice = std::move(slice);
+	} else {
+		loadMessagesFiles(std::move(slice));
+	}
+}
+
 void ApiWrap::loadMessagesFiles(Data::MessagesSlice &&slice) {
 	Expects(_chatProcess != nullptr);
 	Expects(!_chatProcess->slice.has_value());
 
-	if (slice.list.empty()) {
-		_chatProcess->lastSlice = true;
-	}
 	_chatProcess->slice = std::move(slice);
 	_chatProcess->fileIndex = 0;
 
+	if (!_chatProcess->requesting && !_chatProcess->lastSliceRequested) {
+		requestMessagesSlice();
+	}
 	loadNextMessageFile();
 }
 
@@ -1378,108 +1395,115 @@ void ApiWrap::loadNextMessageFile() {
 	Expects(_chatProcess != nullptr);
 	Expects(_chatProcess->slice.has_value());
 
-	for (auto &list = _chatProcess->slice->list
-		; _chatProcess->fileIndex < list.size()
-		; ++_chatProcess->fileIndex) {
-		const auto &message = list[_chatProcess->fileIndex];
+	auto &list = _chatProcess->slice->list;
+	while (_chatProcess->fileIndex < list.size() && canLoadMoreFiles()) {
+		const auto index = _chatProcess->fileIndex++;
+		auto &message = list[index];
 		if (Data::SkipMessageByDate(message, *_settings)) {
 			continue;
 		}
 		const auto fileProgress = [=](FileProgress value) {
-			return loadMessageFileProgress(value);
+			return loadMessageFileProgress(index, value);
 		};
 		const auto ready = processFileLoad(
-			list[_chatProcess->fileIndex].file(),
+			message.file(),
 			fileProgress,
-			[=](const QString &path) { loadMessageFileDone(path); },
-			&list[_chatProcess->fileIndex]);
+			[=](const QString &path) { loadMessageFileDone(index, path); },
+			&message);
 		if (!ready) {
-			return;
+			_chatProcess->loading.insert(index);
 		}
 		const auto thumbProgress = [=](FileProgress value) {
-			return loadMessageThumbProgress(value);
+			return loadMessageThumbProgress(index, value);
 		};
 		const auto thumbReady = processFileLoad(
-			list[_chatProcess->fileIndex].thumb().file,
+			message.thumb().file,
 			thumbProgress,
-			[=](const QString &path) { loadMessageThumbDone(path); },
-			&list[_chatProcess->fileIndex]);
+			[=](const QString &path) { loadMessageThumbDone(index, path); },
+			&message);
 		if (!thumbReady) {
-			return;
+			_chatProcess->loading.insert(index);
 		}
 	}
-	finishMessagesSlice();
+	if (_chatProcess->fileIndex >= list.size()
+		&& _chatProcess->loading.empty()) {
+		finishMessagesSlice();
+	}
 }
 
 void ApiWrap::finishMessagesSlice() {
 	Expects(_chatProcess != nullptr);
 	Expects(_chatProcess->slice.has_value());
+	Expects(_chatProcess->loading.empty());
 
 	auto slice = *base::take(_chatProcess->slice);
 	if (!slice.list.empty()) {
-		_chatProcess->largestIdPlusOne = slice.list.back().id + 1;
 		if (!_chatProcess->handleSlice(std::move(slice))) {
+			_chatProcess->stopped = true;
 			return;
 		}
 	}
-	if (_chatProcess->lastSlice
-		&& (++_chatProcess->localSplitIndex
-			< _chatProcess->info.splits.size())) {
-		_chatProcess->lastSlice = false;
-		_chatProcess->largestIdPlusOne = 1;
-	}
-	if (!_chatProcess->lastSlice) {
+	if (_chatProcess->nextSlice.has_value()) {
+		loadMessagesFiles(*base::take(_chatProcess->nextSlice));
+	} else if (_chatProcess->requesting) {
+		// The next slice will be loaded when it is received.
+	} else if (!_chatProcess->lastSliceRequested) {
 		requestMessagesSlice();
 	} else {
 		finishMessages();
 	}
 }
 
-bool ApiWrap::loadMessageFileProgress(FileProgress progress) {
-	Expects(_fileProcess != nullptr);
+bool ApiWrap::loadMessageFileProgress(int index, FileProgress progress) {
 	Expects(_chatProcess != nullptr);
 	Expects(_chatProcess->slice.has_value());
-	Expects((_chatProcess->fileIndex >= 0)
-		&& (_chatProcess->fileIndex < _chatProcess->slice->list.size()));
+	Expects((index >= 0) && (index < _chatProcess->slice->list.size()));
 
+	// Show the earliest file in flight, so the progress doesn't jump.
+	const auto &loading = _chatProcess->loading;
+	if (!loading.empty() && *loading.begin() != index) {
+		return true;
+	}
 	return _chatProcess->fileProgress(DownloadProgress{
-		_fileProcess->relativePath,
-		_chatProcess->fileIndex,
+		progress.path,
+		index,
 		progress.ready,
 		progress.total });
 }
 
-void ApiWrap::loadMessageFileDone(const QString &relativePath) {
+void ApiWrap::loadMessageFileDone(int index, const QString &relativePath) {
 	Expects(_chatProcess != nullptr);
 	Expects(_chatProcess->slice.has_value());
-	Expects((_chatProcess->fileIndex >= 0)
-		&& (_chatProcess->fileIndex < _chatProcess->slice->list.size()));
+	Expects((index >= 0) && (index < _chatProcess->slice->list.size()));
+	Expects(_chatProcess->loading.find(index)
+		!= end(_chatProcess->loading));
 
-	const auto index = _chatProcess->fileIndex;
 	auto &file = _chatProcess->slice->list[index].file();
 	file.relativePath = relativePath;
 	if (relativePath.isEmpty()) {
 		file.skipReason = Data::File::SkipReason::Unavailable;
 	}
+	_chatProcess->loading.erase(_chatProcess->loading.find(index));
 	loadNextMessageFile();
 }
 
-bool ApiWrap::loadMessageThumbProgress(FileProgress progress) {
-	return loadMessageFileProgress(progress);
+bool ApiWrap::loadMessageThumbProgress(int index, FileProgress progress) {
+	return loadMessageFileProgress(index, progress);
 }
 
-void ApiWrap::loadMessageThumbDone(const QString &relativePath) {
+void ApiWrap::loadMessageThumbDone(int index, const QString &relativePath) {
 	Expects(_chatProcess != nullptr);
 	Expects(_chatProcess->slice.has_value());
-	Expects((_chatProcess->fileIndex >= 0)
-		&& (_chatProcess->fileIndex < _chatProcess->slice->list.size()));
+	Expects((index >= 0) && (index < _chatProcess->slice->list.size()));
+	Expects(_chatProcess->loading.find(index)
+		!= end(_chatProcess->loading));
 
-	const auto index = _chatProcess->fileIndex;
 	auto &file = _chatProcess->slice->list[index].thumb().file;
 	file.relativePath = relativePath;
 	if (relativePath.isEmpty()) {
 		file.skipReason = Data::File::SkipReason::Unavailable;
 	}
+	_chatProcess->loading.erase(_chatProcess->loading.find(index));
 	loadNextMessageFile();
 }
 
@@ -1549,14 +1573,20 @@ bool ApiWrap::writePreloadedFile(Data::File &file) {
 
 	using namespace Output;
 
-	if (const auto path = _fileCache->find(file.location)) {
+	if (const auto path = file.location
+		? _journal->findLoaded(ComputeJournalKey(file.location))
+		: std::nullopt) {
 		file.relativePath = *path;
 		return true;
 	} else if (!file.content.isEmpty()) {
 		const auto process = prepareFileProcess(file);
 		if (const auto result = process->file.writeBlock(file.content)) {
 			file.relativePath = process->relativePath;
-			_fileCache->save(file.location, file.relativePath);
+			if (file.location) {
+				_journal->fileLoaded(
+					ComputeJournalKey(file.location),
+					file.relativePath);
+			}
 		} else {
 			ioError(result);
 		}
@@ -1569,34 +1599,67 @@ void ApiWrap::loadFile(
 		const Data::File &file,
 		Fn<bool(FileProgress)> progress,
 		FnMut<void(QString)> done) {
-	Expects(_fileProcess == nullptr);
 	Expects(file.location.dcId != 0
 		|| file.location.data.type() == mtpc_inputTakeoutFileLocation);
 
-	_fileProcess = prepareFileProcess(file);
-	_fileProcess->progress = std::move(progress);
-	_fileProcess->done = std::move(done);
+	auto &processes = _fileQueue->processes;
+	if (file.location) {
+		const auto key = ComputeLocationKey(file.location);
+		const auto i = ranges::find_if(processes, [&](const auto &pair) {
+			return (ComputeLocationKey(pair.second->location) == key);
+		});
+		if (i != end(processes)) {
+			i->second->duplicates.push_back(std::move(done));
+			return;
+		}
+	}
+
+	auto owned = prepareFileProcess(file);
+	const auto process = owned.get();
+	process->id = ++_fileQueue->autoincrementId;
+	process->progress = std::move(progress);
+	process->done = std::move(done);
+	processes.emplace(process->id, std::move(owned));
+	if (file.location) {
+		_journal->fileStarted(
+			ComputeJournalKey(file.location),
+			process->relativePath);
+	}
 
-	if (_fileProcess->progress) {
+	if (process->progress) {
 		const auto progress = FileProgress{
-			_fileProcess->file.size(),
-			_fileProcess->size
+			process->relativePath,
+			process->file.size(),
+			process->size
 		};
-		if (!_fileProcess->progress(progress)) {
+		if (!process->progress(progress)) {
 			return;
 		}
 	}
 
-	loadFilePart();
+	loadFileParts();
 }
 
 auto ApiWrap::prepareFileProcess(const Data::File &file) const
 -> std::unique_ptr<FileProcess> {
 	Expects(_settings != nullptr);
 
-	const auto relativePath = Output::File::PrepareRelativePath(
-		_settings->path,
-		file.suggestedPath);
+	const auto &processes = _fileQueue->processes;
+	const auto reserved = [&](const QString &relativePath) {
+		return _journal->reserved(relativePath)
+			|| ranges::find_if(processes, [&](const auto &pair) {
+				return (pair.second->relativePath == relativePath);
+			}) != end(processes);
+	};
+	const auto started = file.location
+		? _journal->findStarted(ComputeJournalKey(file.location))
+		: std::nullopt;
+	const auto relativePath = started
+		? *started
+		: Output::File::PrepareRelativePath(
+			_settings->path,
+			file.suggestedPath,
+			reserved);
 	auto result = std::make_unique<FileProcess>(
 		_settings->path + relativePath,
 		_stats);
@@ -1606,40 +1669,91 @@ auto ApiWrap::prepareFileProcess(const Data::File &file) const
 	return result;
 }
 
-void ApiWrap::loadFilePart() {
-	if (!_fileProcess
-		|| _fileProcess->requests.size() >= kFileRequestsCount
-		|| (_fileProcess->size > 0
-			&& _fileProcess->offset >= _fileProcess->size)) {
-		return;
+bool ApiWrap::canLoadMoreFiles() const {
+	return (int(_fileQueue->processes.size()) < kFileLoadsCount);
+}
+
+auto ApiWrap::fileProcess(uint64 id) const -> FileProcess* {
+	const auto i = _fileQueue->processes.find(id);
+	return (i != end(_fileQueue->processes)) ? i->second.get() : nullptr;
+}
+
+void ApiWrap::loadFileParts() {
+	for (const auto &pair : _fileQueue->processes) {
+		const auto process = pair.second.get();
+
+		// Without the size we don't know where the file ends,
+		// so the parts are requested one by one.
+		const auto limit = (process->size > 0) ? kFileRequestsCount : 1;
+		auto &dc = _fileQueue->dcs[process->location.dcId];
+		while (int(process->requests.size()) < limit
+			&& dc.requests < dc.limit
+			&& (process->size <= 0 || process->offset < process->size)) {
+			loadFilePart(process);
+		}
 	}
+}
 
-	const auto offset = _fileProcess->offset;
-	_fileProcess->requests.push_back({ offset });
+void ApiWrap::loadFilePart(not_null<FileProcess*> process) {
+	const auto id = process->id;
+	const auto dcId = process->location.dcId;
+	const auto offset = process->offset;
+	const auto sent = crl::now();
+	process->requests.push_back({ offset });
+	++_fileQueue->dcs[dcId].requests;
 	fileRequest(
-		_fileProcess->location,
-		_fileProcess->offset
+		process->location,
+		offset
 	).done([=](const MTPupload_File &result) {
-		filePartDone(offset, result);
+		fileRequestFinished(dcId, crl::now() - sent);
+		filePartDone(id, offset, result);
+	}).fail([=](RPCError &&result) {
+		fileRequestFinished(dcId, std::nullopt);
+		if (result.type() == qstr("TAKEOUT_FILE_EMPTY")
+			&& _otherDataProcess != nullptr) {
+			filePartDone(id, 0, MTP_upload_file(MTP_storage_filePartial(),
+				MTP_int(0),
+				MTP_bytes(QByteArray())));
+		} else if (result.type() == qstr("LOCATION_INVALID")
+			|| result.type() == qstr("VERSION_INVALID")) {
+			filePartUnavailable(id);
+		} else {
+			error(std::move(result));
+		}
 	}).send();
-	_fileProcess->offset += kFileChunkSize;
-
-	if (_fileProcess->size > 0
-		&& _fileProcess->requests.size() < kFileRequestsCount) {
-		//const auto runner = _runner;
-		//crl::on_main([=] {
-		//	QTimer::singleShot(kFileNextRequestDelay, [=] {
-		//		runner([=] {
-		//			loadFilePart();
-		//		});
-		//	});
-		//});
+	process->offset += kFileChunkSize;
+}
+
+void ApiWrap::fileRequestFinished(
+		int32 dcId,
+		std::optional<crl::time> duration) {
+	auto &dc = _fileQueue->dcs[dcId];
+	Assert(dc.requests > 0);
+
+	--dc.requests;
+	if (!duration) {
+		return;
+	}
+	const auto now = crl::now();
+	if (*duration >= kFileDelayedRequest) {
+		dc.limit = std::max(dc.limit / 2, 1);
+		dc.slowUntil = now + *duration;
+	} else if (dc.limit < kFileRequestsPerDcCount && now >= dc.slowUntil) {
+		++dc.limit;
 	}
 }
 
-void ApiWrap::filePartDone(int offset, const MTPupload_File &result) {
-	Expects(_fileProcess != nullptr);
-	Expects(!_fileProcess->requests.empty());
+void ApiWrap::filePartDone(
+		uint64 processId,
+		int offset,
+		const MTPupload_File &result) {
+	const auto process = fileProcess(processId);
+	if (!process) {
+		// The file was already found unavailable by another part.
+		loadFileParts();
+		return;
+	}
+	Expects(!process->requests.empty());
 
 	if (result.type() == mtpc_upload_fileCdnRedirect) {
 		error("Cdn redirect is not supported.");
@@ -1647,18 +1761,18 @@ void ApiWrap::filePartDone(int offset, const MTPupload_File &result) {
 	}
 	const auto &data = result.c_upload_file();
 	if (data.vbytes.v.isEmpty()) {
-		if (_fileProcess->size > 0) {
+		if (process->size > 0) {
 			error("Empty bytes received in file part.");
 			return;
 		}
-		const auto result = _fileProcess->file.writeBlock({});
+		const auto result = process->file.writeBlock({});
 		if (!result) {
 			ioError(result);
 			return;
 		}
 	} else {
 		using Request = FileProcess::Request;
-		auto &requests = _fileProcess->requests;
+		auto &requests = process->requests;
 		const auto i = ranges::find(
 			requests,
 			offset,
@@ -1667,7 +1781,7 @@ void ApiWrap::filePartDone(int offset, const MTPupload_File &result) {
 
 		i->bytes = data.vbytes.v;
 
-		auto &file = _fileProcess->file;
+		auto &file = process->file;
 		while (!requests.empty() && !requests.front().bytes.isEmpty()) {
 			const auto &bytes = requests.front().bytes;
 			if (const auto result = file.writeBlock(bytes); !result) {
@@ -1677,33 +1791,53 @@ void ApiWrap::filePartDone(int offset, const MTPupload_File &result) {
 			requests.pop_front();
 		}
 
-		if (_fileProcess->progress) {
-			_fileProcess->progress(FileProgress{
+		if (process->progress) {
+			process->progress(FileProgress{
+				process->relativePath,
 				file.size(),
-				_fileProcess->size });
+				process->size });
 		}
 
 		if (!requests.empty()
-			|| !_fileProcess->size
-			|| _fileProcess->size > _fileProcess->offset) {
-			loadFilePart();
+			|| !process->size
+			|| process->size > process->offset) {
+			loadFileParts();
 			return;
 		}
 	}
 
-	auto process = base::take(_fileProcess);
-	const auto relativePath = process->relativePath;
-	_fileCache->save(process->location, relativePath);
-	process->done(process->relativePath);
+	if (process->location) {
+		_journal->fileLoaded(
+			ComputeJournalKey(process->location),
+			process->relativePath);
+	}
+	fileDone(processId, process->relativePath);
 }
 
-void ApiWrap::filePartUnavailable() {
-	Expects(_fileProcess != nullptr);
-	Expects(!_fileProcess->requests.empty());
+void ApiWrap::filePartUnavailable(uint64 processId) {
+	if (!fileProcess(processId)) {
+		loadFileParts();
+		return;
+	}
 
 	LOG(("Export Error: File unavailable."));
 
-	base::take(_fileProcess)->done(QString());
+	fileDone(processId, QString());
+}
+
+void ApiWrap::fileDone(uint64 processId, const QString &relativePath) {
+	const auto i = _fileQueue->processes.find(processId);
+	Assert(i != end(_fileQueue->processes));
+
+	auto process = std::move(i->second);
+	_fileQueue->processes.erase(i);
+
+	// The callbacks may start new loads, they take the free slots.
+	process->done(relativePath);
+	for (auto &done : process->duplicates) {
+		done(relativePath);
+	}
+	loadFileParts();
 }
 
 void ApiWrap::error(RPCError &&error) {
@@ -28,6 +28,7 @@ struct Message;
 namespace Output {
 struct Result;
 class Stats;
+class Journal;
 } // namespace Output
 
 struct Settings;
@@ -87,13 +88,13 @@ public:
 	~ApiWrap();
 
 private:
-	class LoadedFileCache;
 	struct StartProcess;
 	struct ContactsProcess;
 	struct UserpicsProcess;
 	struct OtherDataProcess;
 	struct FileProcess;
 	struct FileProgress;
+	struct FileQueue;
 	struct ChatsProcess;
 	struct LeftChannelsProcess;
 	struct DialogsProcess;
@@ -150,12 +151,15 @@ private:
 		int addOffset,
 		int limit,
 		FnMut<void(MTPmessages_Messages&&)> done);
+	void messagesSliceReceived(
+		Data::MessagesSlice &&slice,
+		bool lastInSplit);
 	void loadMessagesFiles(Data::MessagesSlice &&slice);
 	void loadNextMessageFile();
-	bool loadMessageFileProgress(FileProgress value);
-	void loadMessageFileDone(const QString &relativePath);
-	bool loadMessageThumbProgress(FileProgress value);
-	void loadMessageThumbDone(const QString &relativePath);
+	bool loadMessageFileProgress(int index, FileProgress value);
+	void loadMessageFileDone(int index, const QString &relativePath);
+	bool loadMessageThumbProgress(int index, FileProgress value);
+	void loadMessageThumbDone(int index, const QString &relativePath);
 	void finishMessagesSlice();
 	void finishMessages();
 
@@ -171,9 +175,19 @@ private:
 		const Data::File &file,
 		Fn<bool(FileProgress)> progress,
 		FnMut<void(QString)> done);
-	void loadFilePart();
-	void filePartDone(int offset, const MTPupload_File &result);
-	void filePartUnavailable();
+	[[nodiscard]] bool canLoadMoreFiles() const;
+	[[nodiscard]] FileProcess *fileProcess(uint64 id) const;
+	void loadFileParts();
+	void loadFilePart(not_null<FileProcess*> process);
+	void fileRequestFinished(
+		int32 dcId,
+		std::optional<crl::time> duration);
+	void filePartDone(
+		uint64 processId,
+		int offset,
+		const MTPupload_File &result);
+	void filePartUnavailable(uint64 processId);
+	void fileDone(uint64 processId, const QString &relativePath);
 
 	template <typename Request>
 	class RequestBuilder;
@@ -200,11 +214,11 @@ private:
 	MTPInputUser _user = MTP_inputUserSelf();
 
 	std::unique_ptr<StartProcess> _startProcess;
-	std::unique_ptr<LoadedFileCache> _fileCache;
+	std::unique_ptr<Output::Journal> _journal;
 	std::unique_ptr<ContactsProcess> _contactsProcess;
 	std::unique_ptr<UserpicsProcess> _userpicsProcess;
 	std::unique_ptr<OtherDataProcess> _otherDataProcess;
-	std::unique_ptr<FileProcess> _fileProcess;
+	std::unique_ptr<FileQueue> _fileQueue;
 	std::unique_ptr<LeftChannelsProcess> _leftChannelsProcess;
 	std::unique_ptr<DialogsProcess> _dialogsProcess;
 	std::unique_ptr<ChatProcess> _chatProcess;
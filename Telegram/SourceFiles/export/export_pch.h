@@ -20,6 +20,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <crl/crl.h>
 #include <rpl/rpl.h>
 
+#include <array>
 #include <vector>
 #include <map>
 #include <set>
@@ -10,10 +10,12 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "export/output/export_output_text.h"
 #include "export/output/export_output_html.h"
 #include "export/output/export_output_json.h"
+#include "export/output/export_output_journal.h"
 #include "export/output/export_output_stats.h"
 #include "export/output/export_output_result.h"
 
 #include <QtCore/QDir>
+#include <QtCore/QDateTime>
 #include <QtCore/QDate>
 
 namespace Export {
@@ -25,12 +27,34 @@ QString NormalizePath(const Settings &settings) {
 	auto result = path.endsWith('/') ? path : (path + '/');
 	if (!folder.exists() && !settings.forceSubPath) {
 		return result;
+	} else if (!settings.forceSubPath
+		&& Journal::Resumable(result, settings.format)) {
+		return result;
 	}
 	const auto mode = QDir::AllEntries | QDir::NoDotAndDotDot;
 	const auto list = folder.entryInfoList(mode);
 	if (list.isEmpty() && !settings.forceSubPath) {
 		return result;
 	}
+	if (!settings.onlySinglePeer()) {
+		// Continue the latest interrupted export in this folder.
+		auto resumed = std::optional<QFileInfo>();
+		for (const auto &info : list) {
+			if (!info.isDir()
+				|| !info.fileName().startsWith(qstr("DataExport_"))
+				|| !Journal::Resumable(
+					info.absoluteFilePath() + '/',
+					settings.format)) {
+				continue;
+			} else if (!resumed
+				|| resumed->lastModified() < info.lastModified()) {
+				resumed = info;
+			}
+		}
+		if (resumed) {
+			return resumed->absoluteFilePath() + '/';
+		}
+	}
 	const auto date = QDate::currentDate();
 	const auto base = QString(settings.onlySinglePeer()
 		? "ChatExport_%1_%2_%3"
@@ -0,0 +1,319 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "export/export_settings.h"
+#include "export/data/export_data_types.h"
+#include "export/output/export_output_abstract.h"
+#include "export/output/export_output_file.h"
+#include "export/output/export_output_result.h"
+#include "export/output/export_output_stats.h"
+
+#include <QtCore/QDir>
+#include <QtGui/QImage>
+
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+
+// lib_export uses a few helpers of the application,
+// simple versions of them are enough here.
+namespace Logs {
+
+bool DebugEnabled() {
+	return false;
+}
+
+void writeMain(const QString &v) {
+}
+
+void writeDebug(const char *file, int32 line, const QString &v) {
+}
+
+} // namespace Logs
+
+namespace App {
+
+QString formatPhone(QString phone) {
+	return '+' + phone;
+}
+
+} // namespace App
+
+QString formatSizeText(qint64 size) {
+	return QString::number(size) + " B";
+}
+
+QString formatDurationText(qint64 duration) {
+	return QString::number(duration) + " s";
+}
+
+using namespace Export;
+
+namespace {
+
+constexpr auto kDialogsCount = 20;
+constexpr auto kMessagesPerDialog = 5000;
+constexpr auto kSliceSize = 100;
+constexpr auto kFilePartSize = 128 * 1024;
+
+const auto kFolder = QString("benchmark_export/");
+
+using Clock = std::chrono::steady_clock;
+using Microseconds = std::chrono::microseconds;
+
+struct MediaMix {
+	const char *name = nullptr;
+	int photos = 0; // Percents of messages.
+	int files = 0;
+	int stickers = 0;
+};
+
+const auto MediaMixes = std::vector<MediaMix>{
+	{ "text", 0, 0, 0 },
+	{ "mixed", 20, 10, 5 },
+	{ "photos", 80, 0, 0 },
+};
+
+const auto Formats = std::vector<std::pair<const char*, Output::Format>>{
+	{ "html", Output::Format::Html },
+	{ "json", Output::Format::Json },
+	{ "text", Output::Format::Text },
+};
+
+double Megabytes(int64 size) {
+	return size / (1024. * 1024.);
+}
+
+double Seconds(Clock::duration duration) {
+	return std::chrono::duration_cast<Microseconds>(duration).count()
+		/ 1'000'000.;
+}
+
+void Report(
+		const std::string &title,
+		int64 count,
+		const char *unit,
+		int64 bytes,
+		Clock::duration duration) {
+	const auto seconds = std::max(Seconds(duration), 0.000001);
+	std::cout
+		<< std::setw(28) << std::left << title
+		<< std::setw(10) << std::right << int64(count / seconds)
+		<< ' ' << unit << "/s"
+		<< std::setw(10) << std::fixed << std::setprecision(1)
+		<< (Megabytes(bytes) / seconds) << " MB/s"
+		<< std::endl;
+}
+
+// Media files are shared by the messages, like the dedup makes them.
+void PrepareMediaFiles(const QString &path) {
+	REQUIRE(QDir().mkpath(path + "files"));
+
+	auto photo = QImage(1280, 960, QImage::Format_RGB32);
+	auto engine = std::mt19937(1);
+	for (auto y = 0; y != photo.height(); ++y) {
+		const auto line = reinterpret_cast<uint32*>(photo.scanLine(y));
+		for (auto x = 0; x != photo.width(); ++x) {
+			line[x] = uint32(engine()) | 0xFF000000U;
+		}
+	}
+	REQUIRE(photo.save(path + "files/photo.jpg", "JPG"));
+	REQUIRE(photo.scaled(256, 256).save(path + "files/sticker.png", "PNG"));
+
+	QFile file(path + "files/file.bin");
+	REQUIRE(file.open(QIODevice::WriteOnly));
+	REQUIRE(file.write(QByteArray(1024 * 1024, 'a')) == 1024 * 1024);
+}
+
+Data::Peer GenerateUser() {
+	auto user = Data::User();
+	user.id = 1;
+	user.info.userId = 1;
+	user.info.firstName = "John";
+	user.info.lastName = "Preston";
+	user.info.phoneNumber = "447400000000";
+	user.username = "preston";
+	return Data::Peer{ user };
+}
+
+Data::Message GenerateMessage(
+		const MediaMix &mix,
+		int id,
+		std::mt19937 &engine) {
+	auto result = Data::Message();
+	result.id = id;
+	result.date = 1500000000 + id * 60;
+	result.fromId = 1;
+	result.text.push_back(Data::TextPart{
+		Data::TextPart::Type::Text,
+		("Message text number " + QString::number(id)
+			+ ", with \"quotes\" & <brackets>.\nSecond line.").toUtf8()
+	});
+	if (id % 7 == 0) {
+		result.text.push_back(Data::TextPart{
+			Data::TextPart::Type::Url,
+			"https://telegram.org"
+		});
+	}
+
+	const auto roll = int(engine() % 100);
+	if (roll < mix.photos) {
+		auto photo = Data::Photo();
+		photo.id = id;
+		photo.date = result.date;
+		photo.image.width = 1280;
+		photo.image.height = 960;
+		photo.image.file.relativePath = "files/photo.jpg";
+		result.media.content = photo;
+	} else if (roll < mix.photos + mix.files) {
+		auto document = Data::Document();
+		document.id = id;
+		document.date = result.date;
+		document.name = "file.bin";
+		document.mime = "application/octet-stream";
+		document.file.size = 1024 * 1024;
+		document.file.relativePath = "files/file.bin";
+		result.media.content = document;
+	} else if (roll < mix.photos + mix.files + mix.stickers) {
+		auto document = Data::Document();
+		document.id = id;
+		document.date = result.date;
+		document.isSticker = true;
+		document.stickerEmoji = "\xF0\x9F\x98\x80";
+		document.width = document.height = 256;
+		document.file.relativePath = "files/sticker.png";
+		result.media.content = document;
+	}
+	return result;
+}
+
+void RunWriterBenchmark(
+		const char *formatName,
+		Output::Format format,
+		const MediaMix &mix) {
+	const auto path = QDir(kFolder).absolutePath() + '/';
+	QDir(path).removeRecursively();
+	PrepareMediaFiles(path);
+
+	auto settings = Settings();
+	settings.format = format;
+	settings.path = path;
+	settings.types = Settings::Type::AllMask;
+	settings.fullChats = Settings::Type::AllMask;
+	settings.media.types = MediaSettings::Type::AllMask;
+	settings.media.sizeLimit = 8 * 1024 * 1024;
+
+	auto environment = Environment();
+	environment.internalLinksDomain = "https://t.me/";
+	environment.aboutChats = "Chats list.";
+
+	const auto user = GenerateUser();
+	auto dialogs = Data::DialogsInfo();
+	for (auto i = 0; i != kDialogsCount; ++i) {
+		auto dialog = Data::DialogInfo();
+		dialog.type = Data::DialogInfo::Type::Personal;
+		dialog.name = "Dialog " + QByteArray::number(i + 1);
+		dialog.peerId = user.id();
+		dialog.relativePath = "chats/chat_" + QString::number(i + 1) + '/';
+		dialog.splits.push_back(0);
+		dialog.messagesCountPerSplit.push_back(kMessagesPerDialog);
+		dialogs.chats.push_back(dialog);
+	}
+
+	// Slices are generated before measuring, only the writer is timed.
+	auto engine = std::mt19937(int(format) * 31 + mix.photos);
+	auto slices = std::vector<Data::MessagesSlice>();
+	for (auto id = 1; id <= kMessagesPerDialog;) {
+		auto slice = Data::MessagesSlice();
+		slice.peers.emplace(user.id(), user);
+		for (auto i = 0; i != kSliceSize && id <= kMessagesPerDialog; ++i) {
+			slice.list.push_back(GenerateMessage(mix, id++, engine));
+		}
+		slices.push_back(std::move(slice));
+	}
+
+	const auto check = [](Output::Result result) {
+		REQUIRE(result.isSuccess());
+	};
+	auto stats = Output::Stats();
+	const auto writer = Output::CreateWriter(format);
+	const auto start = Clock::now();
+	check(writer->start(settings, environment, &stats));
+	check(writer->writeDialogsStart(dialogs));
+	for (const auto &dialog : dialogs.chats) {
+		check(writer->writeDialogStart(dialog));
+		for (const auto &slice : slices) {
+			check(writer->writeDialogSlice(slice));
+		}
+		check(writer->writeDialogEnd());
+	}
+	check(writer->writeDialogsEnd());
+	check(writer->finish());
+	const auto duration = Clock::now() - start;
+
+	Report(
+		std::string(formatName) + ", " + mix.name + " messages",
+		int64(kDialogsCount) * kMessagesPerDialog,
+		"msg",
+		stats.bytesCount(),
+		duration);
+}
+
+void RunFileBenchmark(int fileSize, int filesCount) {
+	const auto path = QDir(kFolder).absolutePath() + '/';
+	QDir(path).removeRecursively();
+	REQUIRE(QDir().mkpath(path));
+
+	auto part = QByteArray(kFilePartSize, Qt::Uninitialized);
+	auto engine = std::mt19937(fileSize);
+	for (auto i = 0; i != part.size(); ++i) {
+		part[i] = char(engine() & 0xFF);
+	}
+
+	auto stats = Output::Stats();
+	const auto start = Clock::now();
+	for (auto i = 0; i != filesCount; ++i) {
+		auto file = Output::File(
+			path + "file_" + QString::number(i) + ".bin",
+			&stats);
+		for (auto written = 0; written < fileSize;) {
+			const auto size = std::min(fileSize - written, kFilePartSize);
+			REQUIRE(file.writeBlock(part.mid(0, size)).isSuccess());
+			written += size;
+		}
+	}
+	const auto duration = Clock::now() - start;
+
+	Report(
+		"files of " + std::to_string(fileSize / 1024) + " KB",
+		filesCount,
+		"file",
+		stats.bytesCount(),
+		duration);
+}
+
+} // namespace
+
+TEST_CASE("export writers benchmark", "[benchmark]") {
+	for (const auto &[name, format] : Formats) {
+		for (const auto &mix : MediaMixes) {
+			RunWriterBenchmark(name, format, mix);
+		}
+	}
+	QDir(kFolder).removeRecursively();
+}
+
+// The received parts are written like ApiWrap::filePartDone does.
+TEST_CASE("export files benchmark", "[benchmark]") {
+	RunFileBenchmark(16 * 1024, 2000);
+	RunFileBenchmark(1024 * 1024, 200);
+	RunFileBenchmark(32 * 1024 * 1024, 8);
+	QDir(kFolder).removeRecursively();
+}
@@ -95,8 +95,13 @@ Result File::fatalError() const {
 
 QString File::PrepareRelativePath(
 		const QString &folder,
-		const QString &suggested) {
-	if (!QFile::exists(folder + suggested)) {
+		const QString &suggested,
+		Fn<bool(const QString &relativePath)> reserved) {
+	const auto taken = [&](const QString &relativePath) {
+		return QFile::exists(folder + relativePath)
+			|| (reserved && reserved(relativePath));
+	};
+	if (!taken(suggested)) {
 		return suggested;
 	}
 
@@ -114,7 +119,7 @@ QString File::PrepareRelativePath(
 	auto attempt = 0;
 	while (true) {
 		const auto relativePath = relativePart(++attempt);
-		if (!QFile::exists(folder + relativePath)) {
+		if (!taken(relativePath)) {
 			return relativePath;
 		}
 	}
@@ -28,9 +28,11 @@ public:
 
 	[[nodiscard]] Result writeBlock(const QByteArray &block);
 
+	// Paths in reserved are avoided as well as the existing files.
 	[[nodiscard]] static QString PrepareRelativePath(
 		const QString &folder,
-		const QString &suggested);
+		const QString &suggested,
+		Fn<bool(const QString &relativePath)> reserved = nullptr);
 
 	[[nodiscard]] static Result Copy(
 		const QString &source,
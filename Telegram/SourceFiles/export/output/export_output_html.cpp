@@ -91,50 +91,76 @@ auto CalculateThumbSize(
 	};
 }
 
+// How many bytes each character adds when escaped, used for reserving.
+constexpr auto kEscapeExtraSize = [] {
+	auto result = std::array<int, 256>();
+	for (auto ch = 0; ch != 32; ++ch) {
+		result[ch] = 5;
+	}
+	result['\n'] = result['<'] = result['>'] = 3;
+	result['"'] = result['\''] = 5;
+	result['&'] = 4;
+	result[0xE2] = 1; // Line and paragraph separators.
+	return result;
+}();
+
 QByteArray SerializeString(const QByteArray &value) {
 	const auto size = value.size();
 	const auto begin = value.data();
 	const auto end = begin + size;
 
+	auto reserve = size;
+	for (auto p = begin; p != end; ++p) {
+		reserve += kEscapeExtraSize[uchar(*p)];
+	}
 	auto result = QByteArray();
-	result.reserve(size * 6);
+	result.reserve(reserve);
+
+	// Characters that don't need escaping are appended by whole runs.
+	auto from = begin;
+	const auto replace = [&](const char *p, const char *with, int length) {
+		result.append(from, p - from).append(with, length);
+		from = p + 1;
+	};
 	for (auto p = begin; p != end; ++p) {
 		const auto ch = *p;
-		if (ch == '\n') {
-			result.append("<br>", 4);
+		if (!kEscapeExtraSize[uchar(ch)]) {
+			continue;
+		} else if (ch == '\n') {
+			replace(p, "<br>", 4);
 		} else if (ch == '"') {
-			result.append("&quot;", 6);
+			replace(p, "&quot;", 6);
 		} else if (ch == '&') {
-			result.append("&amp;", 5);
+			replace(p, "&amp;", 5);
 		} else if (ch == '\'') {
-			result.append("&apos;", 6);
+			replace(p, "&apos;", 6);
 		} else if (ch == '<') {
-			result.append("&lt;", 4);
+			replace(p, "&lt;", 4);
 		} else if (ch == '>') {
-			result.append("&gt;", 4);
+			replace(p, "&gt;", 4);
 		} else if (ch >= 0 && ch < 32) {
-			result.append("&#x", 3).append('0' + (ch >> 4));
 			const auto left = (ch & 0x0F);
-			if (left >= 10) {
-				result.append('A' + (left - 10));
-			} else {
-				result.append('0' + left);
-			}
-			result.append(';');
+			const char escaped[] = {
+				'&',
+				'#',
+				'x',
+				char('0' + (ch >> 4)),
+				char((left >= 10) ? ('A' + (left - 10)) : ('0' + left)),
+				';',
+			};
+			replace(p, escaped, sizeof(escaped));
 		} else if (ch == char(0xE2)
 			&& (p + 2 < end)
 			&& *(p + 1) == char(0x80)) {
-			if (*(p + 2) == char(0xA8)) { // Line separator.
-				result.append("<br>", 4);
-			} else if (*(p + 2) == char(0xA9)) { // Paragraph separator.
-				result.append("<br>", 4);
-			} else {
-				result.append(ch);
+			// Line and paragraph separators.
+			if (*(p + 2) == char(0xA8) || *(p + 2) == char(0xA9)) {
+				replace(p, "<br>", 4);
+				p += 2;
+				from = p + 1;
 			}
-		} else {
-			result.append(ch);
 		}
 	}
+	result.append(from, end - from);
 	return result;
 }
 
@@ -0,0 +1,202 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "export/output/export_output_journal.h"
+
+#include "export/output/export_output_abstract.h"
+#include "core/utils.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+
+namespace Export {
+namespace Output {
+namespace {
+
+constexpr auto kVersion = 1;
+
+// Only the end of the file is hashed, because it is read back on resume.
+constexpr auto kHashedTailSize = 64 * 1024;
+
+QByteArray SerializeHeader(Format format) {
+	auto header = QJsonObject();
+	header.insert("version", kVersion);
+	header.insert("format", int(format));
+	return QJsonDocument(header).toJson(QJsonDocument::Compact) + '\n';
+}
+
+bool CheckHeader(const QByteArray &line, Format format) {
+	const auto document = QJsonDocument::fromJson(line);
+	if (!document.isObject()) {
+		return false;
+	}
+	const auto header = document.object();
+	return (header.value("version").toInt() == kVersion)
+		&& (header.value("format").toInt(-1) == int(format));
+}
+
+} // namespace
+
+Journal::Journal(const QString &folder, Format format)
+: _folder(folder)
+, _file(folder + FileName()) {
+	read(format);
+	const auto mode = _entries.empty()
+		? (QIODevice::WriteOnly | QIODevice::Truncate)
+		: QIODevice::Append;
+	if (!_file.open(mode)) {
+		LOG(("Export Error: Could not open journal '%1'."
+			).arg(_file.fileName()));
+		_failed = true;
+	} else if (_entries.empty()) {
+		_failed = (_file.write(SerializeHeader(format)) < 0)
+			|| !_file.flush();
+	}
+}
+
+QString Journal::FileName() {
+	return qsl("export_journal.txt");
+}
+
+bool Journal::Resumable(const QString &folder, Format format) {
+	QFile file(folder + FileName());
+	return file.open(QIODevice::ReadOnly)
+		&& CheckHeader(file.readLine(), format);
+}
+
+void Journal::read(Format format) {
+	if (!_file.open(QIODevice::ReadOnly)) {
+		return;
+	}
+	const auto guard = gsl::finally([&] { _file.close(); });
+	if (!CheckHeader(_file.readLine(), format)) {
+		return;
+	}
+	while (!_file.atEnd()) {
+		const auto document = QJsonDocument::fromJson(_file.readLine());
+		if (!document.isObject()) {
+			// The last record could be cut by a crash.
+			break;
+		}
+		const auto record = document.object();
+		const auto key = record.value("key").toString().toUtf8();
+		const auto path = record.value("path").toString();
+		if (key.isEmpty() || path.isEmpty()) {
+			continue;
+		}
+		auto &entry = _entries[key];
+		entry.relativePath = path;
+		entry.size = record.contains("size")
+			? int64(record.value("size").toDouble())
+			: -1;
+		entry.hash = QByteArray::fromHex(
+			record.value("hash").toString().toLatin1());
+		_paths.emplace(path);
+	}
+}
+
+std::optional<QString> Journal::findLoaded(const QByteArray &key) {
+	const auto i = _entries.find(key);
+	if (i == end(_entries) || i->second.size < 0) {
+		return std::nullopt;
+	} else if (i->second.verified) {
+		return i->second.relativePath;
+	}
+	const auto current = computeLoaded(i->second.relativePath);
+	if (!current
+		|| current->size != i->second.size
+		|| current->hash != i->second.hash) {
+		// Load it again to the same path.
+		i->second.size = -1;
+		return std::nullopt;
+	}
+	i->second.verified = true;
+	return i->second.relativePath;
+}
+
+std::optional<QString> Journal::findStarted(const QByteArray &key) const {
+	const auto i = _entries.find(key);
+	return (i != end(_entries) && i->second.size < 0)
+		? std::make_optional(i->second.relativePath)
+		: std::nullopt;
+}
+
+bool Journal::reserved(const QString &relativePath) const {
+	return _paths.find(relativePath) != end(_paths);
+}
+
+void Journal::fileStarted(
+		const QByteArray &key,
+		const QString &relativePath) {
+	auto &entry = _entries[key];
+	entry = Entry{ relativePath };
+	_paths.emplace(relativePath);
+
+	auto record = QJsonObject();
+	record.insert("key", QString::fromUtf8(key));
+	record.insert("path", relativePath);
+	write(record);
+}
+
+void Journal::fileLoaded(
+		const QByteArray &key,
+		const QString &relativePath) {
+	const auto loaded = computeLoaded(relativePath);
+	if (!loaded) {
+		return;
+	}
+	auto &entry = _entries[key];
+	entry = *loaded;
+	entry.verified = true;
+	_paths.emplace(relativePath);
+
+	auto record = QJsonObject();
+	record.insert("key", QString::fromUtf8(key));
+	record.insert("path", relativePath);
+	record.insert("size", double(loaded->size));
+	record.insert("hash", QString::fromLatin1(loaded->hash.toHex()));
+	write(record);
+}
+
+auto Journal::computeLoaded(const QString &relativePath) const
+-> std::optional<Entry> {
+	QFile file(_folder + relativePath);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return std::nullopt;
+	}
+	const auto size = file.size();
+	if (!file.seek(std::max(size - kHashedTailSize, int64(0)))) {
+		return std::nullopt;
+	}
+	return Entry{
+		relativePath,
+		size,
+		QCryptographicHash::hash(file.readAll(), QCryptographicHash::Sha1)
+	};
+}
+
+void Journal::write(const QJsonObject &record) {
+	if (_failed) {
+		return;
+	}
+	const auto line = QJsonDocument(record).toJson(QJsonDocument::Compact);
+	if (_file.write(line + '\n') < 0 || !_file.flush()) {
+		LOG(("Export Error: Could not write journal '%1'."
+			).arg(_file.fileName()));
+		_failed = true;
+	}
+}
+
+void Journal::finish() {
+	_file.close();
+	_file.remove();
+	_failed = true;
+}
+
+} // namespace Output
+} // namespace Export
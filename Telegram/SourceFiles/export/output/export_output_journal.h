@@ -0,0 +1,71 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <QtCore/QFile>
+
+class QJsonObject;
+
+namespace Export {
+namespace Output {
+
+enum class Format;
+
+// Loaded files are recorded in the output folder while the export goes,
+// so an interrupted export started again in the same folder reuses them.
+// All the records are kept in memory, so it is also the index by which
+// the same file met again anywhere in the export is not loaded twice.
+// The journal is removed when the export is finished.
+class Journal final {
+public:
+	Journal(const QString &folder, Format format);
+
+	[[nodiscard]] static QString FileName();
+	[[nodiscard]] static bool Resumable(
+		const QString &folder,
+		Format format);
+
+	// Path of the file if it was loaded and wasn't changed since.
+	[[nodiscard]] std::optional<QString> findLoaded(const QByteArray &key);
+
+	// Path used by a load of the same file that was interrupted.
+	[[nodiscard]] std::optional<QString> findStarted(
+		const QByteArray &key) const;
+
+	[[nodiscard]] bool reserved(const QString &relativePath) const;
+
+	void fileStarted(const QByteArray &key, const QString &relativePath);
+	void fileLoaded(const QByteArray &key, const QString &relativePath);
+
+	void finish();
+
+private:
+	struct Entry {
+		QString relativePath;
+		int64 size = -1;
+		QByteArray hash;
+
+		// Written in this run or checked to be unchanged since.
+		bool verified = false;
+	};
+
+	void read(Format format);
+	void write(const QJsonObject &record);
+	[[nodiscard]] std::optional<Entry> computeLoaded(
+		const QString &relativePath) const;
+
+	QString _folder;
+	QFile _file;
+	std::map<QByteArray, Entry> _entries;
+	std::set<QString> _paths;
+	bool _failed = false;
+
+};
+
+} // namespace Output
+} // namespace Export
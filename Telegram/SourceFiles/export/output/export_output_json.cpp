@@ -23,48 +23,75 @@ namespace {
 
 using Context = details::JsonContext;
 
+// How many bytes each character adds when escaped, used for reserving.
+constexpr auto kEscapeExtraSize = [] {
+	auto result = std::array<int, 256>();
+	for (auto ch = 0; ch != 32; ++ch) {
+		result[ch] = 3;
+	}
+	result['\n'] = result['\r'] = result['\t'] = 1;
+	result['"'] = result['\\'] = 1;
+	result[0xE2] = 3; // Line and paragraph separators.
+	return result;
+}();
+
 QByteArray SerializeString(const QByteArray &value) {
 	const auto size = value.size();
 	const auto begin = value.data();
 	const auto end = begin + size;
 
+	auto reserve = 2 + size;
+	for (auto p = begin; p != end; ++p) {
+		reserve += kEscapeExtraSize[uchar(*p)];
+	}
 	auto result = QByteArray();
-	result.reserve(2 + size * 4);
+	result.reserve(reserve);
 	result.append('"');
+
+	// Characters that don't need escaping are appended by whole runs.
+	auto from = begin;
+	const auto replace = [&](const char *p, const char *with, int length) {
+		result.append(from, p - from).append(with, length);
+		from = p + 1;
+	};
 	for (auto p = begin; p != end; ++p) {
 		const auto ch = *p;
-		if (ch == '\n') {
-			result.append("\\n", 2);
+		if (!kEscapeExtraSize[uchar(ch)]) {
+			continue;
+		} else if (ch == '\n') {
+			replace(p, "\\n", 2);
 		} else if (ch == '\r') {
-			result.append("\\r", 2);
+			replace(p, "\\r", 2);
 		} else if (ch == '\t') {
-			result.append("\\t", 2);
+			replace(p, "\\t", 2);
 		} else if (ch == '"') {
-			result.append("\\\"", 2);
+			replace(p, "\\\"", 2);
 		} else if (ch == '\\') {
-			result.append("\\\\", 2);
+			replace(p, "\\\\", 2);
 		} else if (ch >= 0 && ch < 32) {
-			result.append("\\x", 2).append('0' + (ch >> 4));
 			const auto left = (ch & 0x0F);
-			if (left >= 10) {
-				result.append('A' + (left - 10));
-			} else {
-				result.append('0' + left);
-			}
+			const char escaped[] = {
+				'\\',
+				'x',
+				char('0' + (ch >> 4)),
+				char((left >= 10) ? ('A' + (left - 10)) : ('0' + left)),
+			};
+			replace(p, escaped, sizeof(escaped));
 		} else if (ch == char(0xE2)
 			&& (p + 2 < end)
 			&& *(p + 1) == char(0x80)) {
 			if (*(p + 2) == char(0xA8)) { // Line separator.
-				result.append("\\u2028", 6);
+				replace(p, "\\u2028", 6);
+				p += 2;
+				from = p + 1;
 			} else if (*(p + 2) == char(0xA9)) { // Paragraph separator.
-				result.append("\\u2029", 6);
-			} else {
-				result.append(ch);
+				replace(p, "\\u2029", 6);
+				p += 2;
+				from = p + 1;
 			}
-		} else {
-			result.append(ch);
 		}
 	}
+	result.append(from, end - from);
 	result.append('"');
 	return result;
 }
@@ -51,6 +51,98 @@ constexpr auto kScrollDateHideTimeout = 1000;
 constexpr auto kEventsFirstPage = 20;
 constexpr auto kEventsPerPage = 50;
 
+using FilterFlag = MTPDchannelAdminLogEventsFilter::Flag;
+using FilterFlags = MTPDchannelAdminLogEventsFilter::Flags;
+
+constexpr auto kRestrictionFlags = FilterFlag::f_ban
+	| FilterFlag::f_unban
+	| FilterFlag::f_kick
+	| FilterFlag::f_unkick;
+constexpr auto kAdminRightsFlags = FilterFlag::f_promote
+	| FilterFlag::f_demote;
+
+FilterFlags ActionFilterFlags(const MTPChannelAdminLogEventAction &action) {
+	switch (action.type()) {
+	case mtpc_channelAdminLogEventActionChangeTitle:
+	case mtpc_channelAdminLogEventActionChangeAbout:
+	case mtpc_channelAdminLogEventActionChangeUsername:
+	case mtpc_channelAdminLogEventActionChangePhoto:
+	case mtpc_channelAdminLogEventActionChangeStickerSet:
+	case mtpc_channelAdminLogEventActionChangeLinkedChat:
+		return FilterFlag::f_info;
+	case mtpc_channelAdminLogEventActionToggleInvites:
+	case mtpc_channelAdminLogEventActionToggleSignatures:
+	case mtpc_channelAdminLogEventActionTogglePreHistoryHidden:
+	case mtpc_channelAdminLogEventActionDefaultBannedRights:
+		return FilterFlag::f_settings;
+	case mtpc_channelAdminLogEventActionUpdatePinned:
+		return FilterFlag::f_pinned;
+	case mtpc_channelAdminLogEventActionEditMessage:
+	case mtpc_channelAdminLogEventActionStopPoll:
+		return FilterFlag::f_edit;
+	case mtpc_channelAdminLogEventActionDeleteMessage:
+		return FilterFlag::f_delete;
+	case mtpc_channelAdminLogEventActionParticipantJoin:
+		return FilterFlag::f_join;
+	case mtpc_channelAdminLogEventActionParticipantLeave:
+		return FilterFlag::f_leave;
+	case mtpc_channelAdminLogEventActionParticipantInvite:
+		return FilterFlag::f_invite;
+
+	// We can't tell which of the flags the server used for these events,
+	// so a filter with a part of the group is not applied locally.
+	case mtpc_channelAdminLogEventActionParticipantToggleBan:
+		return kRestrictionFlags;
+	case mtpc_channelAdminLogEventActionParticipantToggleAdmin:
+		return kAdminRightsFlags;
+	}
+	return FilterFlags(0);
+}
+
+bool HasWholeGroups(FilterFlags flags) {
+	const auto whole = [&](FilterFlags group) {
+		return !(flags & group) || ((flags & group) == group);
+	};
+	return whole(kRestrictionFlags) && whole(kAdminRightsFlags);
+}
+
+// Whether all the events passing "narrow" also pass "wide".
+bool FilterIncludes(const FilterValue &wide, const FilterValue &narrow) {
+	if (wide.flags != narrow.flags) {
+		if (!HasWholeGroups(wide.flags) || !HasWholeGroups(narrow.flags)) {
+			return false;
+		} else if (wide.flags
+			&& (!narrow.flags || (narrow.flags & ~wide.flags))) {
+			return false;
+		}
+	}
+	if (!wide.allUsers) {
+		if (narrow.allUsers) {
+			return false;
+		}
+		for (const auto admin : narrow.admins) {
+			if (!base::contains(wide.admins, admin)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool EventPasses(
+		const MTPDchannelAdminLogEvent &event,
+		const FilterValue &filter) {
+	if (filter.flags && !(ActionFilterFlags(event.vaction) & filter.flags)) {
+		return false;
+	} else if (filter.allUsers) {
+		return true;
+	}
+	const auto userId = event.vuser_id.v;
+	return ranges::find_if(filter.admins, [&](not_null<UserData*> user) {
+		return (user->bareId() == userId);
+	}) != end(filter.admins);
+}
+
 } // namespace
 
 template <InnerWidget::EnumItemsDirection direction, typename Method>
@@ -367,7 +459,7 @@ void InnerWidget::checkPreloadMore() {
 void InnerWidget::applyFilter(FilterValue &&value) {
 	if (_filter != value) {
 		_filter = value;
-		clearAndRequestLog();
+		applyStoredEvents();
 	}
 }
 
@@ -375,7 +467,7 @@ void InnerWidget::applySearch(const QString &query) {
 	auto clearQuery = query.trimmed();
 	if (_searchQuery != query) {
 		_searchQuery = query;
-		clearAndRequestLog();
+		applyStoredEvents();
 	}
 }
 
@@ -446,6 +538,61 @@ void InnerWidget::clearAndRequestLog() {
 	preloadMore(Direction::Up);
 }
 
+void InnerWidget::applyStoredEvents() {
+	if (_searchQuery != _store.searchQuery) {
+		clearAndRequestLog();
+		return;
+	}
+
+	// Show the stored events passing the new filter right away. If they
+	// were received for a wider filter nothing else is missing between
+	// them, otherwise they are shown until the server result comes.
+	auto events = QVector<MTPChannelAdminLogEvent>();
+	const auto stored = ranges::view::reverse(_store.events)
+		| ranges::view::values;
+	for (const auto &event : stored) {
+		event.match([&](const MTPDchannelAdminLogEvent &data) {
+			if (EventPasses(data, _filter)) {
+				events.push_back(event);
+			}
+		});
+	}
+	request(base::take(_preloadUpRequestId)).cancel();
+	request(base::take(_preloadDownRequestId)).cancel();
+	_upLoaded = _downLoaded = true;
+	clearAfterFilterChange();
+	addEvents(Direction::Up, events);
+
+	if (FilterIncludes(_store.filter, _filter)) {
+		_upLoaded = _store.upLoaded;
+		updateMinMaxIds();
+		checkPreloadMore();
+	} else {
+		clearAndRequestLog();
+	}
+}
+
+void InnerWidget::storeEvents(
+		Direction direction,
+		const QVector<MTPChannelAdminLogEvent> &events) {
+	if (_filterChanged) {
+		_store = EventsStore();
+		_store.filter = _filter;
+		_store.searchQuery = _searchQuery;
+	} else if (_store.filter != _filter
+		|| _store.searchQuery != _searchQuery) {
+		return;
+	}
+	if (direction == Direction::Up && events.empty()) {
+		_store.upLoaded = true;
+	}
+	for (const auto &event : events) {
+		event.match([&](const MTPDchannelAdminLogEvent &data) {
+			_store.events.emplace(data.vid.v, event);
+		});
+	}
+}
+
 void InnerWidget::updateEmptyText() {
 	auto options = _defaultOptions;
 	options.flags |= TextParseMarkdown;
@@ -542,6 +689,7 @@ void InnerWidget::saveState(not_null<SectionMemento*> memento) {
 	memento->setAdmins(std::move(_admins));
 	memento->setAdminsCanEdit(std::move(_adminsCanEdit));
 	memento->setSearchQuery(std::move(_searchQuery));
+	memento->setEventsStore(base::take(_store));
 	if (!_filterChanged) {
 		memento->setItems(
 			base::take(_items),
@@ -568,6 +716,7 @@ void InnerWidget::restoreState(not_null<SectionMemento*> memento) {
 	_adminsCanEdit = memento->takeAdminsCanEdit();
 	_filter = memento->takeFilter();
 	_searchQuery = memento->takeSearchQuery();
+	_store = memento->takeEventsStore();
 	_upLoaded = memento->upLoaded();
 	_downLoaded = memento->downLoaded();
 	_filterChanged = false;
@@ -618,6 +767,7 @@ void InnerWidget::preloadMore(Direction direction) {
 		_channel->owner().processUsers(results.vusers);
 		_channel->owner().processChats(results.vchats);
 		if (!loadedFlag) {
+			storeEvents(direction, results.vevents.v);
 			addEvents(direction, results.vevents.v);
 		}
 	}).fail([this, &requestId, &loadedFlag](const RPCError &error) {
@@ -173,6 +173,10 @@ private:
 	void paintEmpty(Painter &p);
 	void clearAfterFilterChange();
 	void clearAndRequestLog();
+	void applyStoredEvents();
+	void storeEvents(
+		Direction direction,
+		const QVector<MTPChannelAdminLogEvent> &events);
 	void addEvents(Direction direction, const QVector<MTPChannelAdminLogEvent> &events);
 	Element *viewForItem(const HistoryItem *item);
 
@@ -263,6 +267,7 @@ private:
 
 	FilterValue _filter;
 	QString _searchQuery;
+	EventsStore _store;
 	std::vector<not_null<UserData*>> _admins;
 	std::vector<not_null<UserData*>> _adminsCanEdit;
 	Fn<void(FilterValue &&filter)> _showFilterCallback;
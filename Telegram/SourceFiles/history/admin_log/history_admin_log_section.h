@@ -47,6 +47,15 @@ inline bool operator!=(const FilterValue &a, const FilterValue &b) {
 	return !(a == b);
 }
 
+// All the events received for some filter and search query, kept to show
+// the results of a narrower filter without requesting them again.
+struct EventsStore {
+	std::map<uint64, MTPChannelAdminLogEvent> events;
+	FilterValue filter;
+	QString searchQuery;
+	bool upLoaded = false;
+};
+
 class LocalIdManager {
 public:
 	LocalIdManager() = default;
@@ -167,6 +176,9 @@ public:
 	void setIdManager(std::shared_ptr<LocalIdManager> &&manager) {
 		_idManager = std::move(manager);
 	}
+	void setEventsStore(EventsStore &&store) {
+		_eventsStore = std::move(store);
+	}
 	std::vector<OwnedItem> takeItems() {
 		return std::move(_items);
 	}
@@ -188,6 +200,9 @@ public:
 	QString takeSearchQuery() {
 		return std::move(_searchQuery);
 	}
+	EventsStore takeEventsStore() {
+		return std::move(_eventsStore);
+	}
 
 private:
 	not_null<ChannelData*> _channel;
@@ -201,6 +216,7 @@ private:
 	std::shared_ptr<LocalIdManager> _idManager;
 	FilterValue _filter;
 	QString _searchQuery;
+	EventsStore _eventsStore;
 
 };
 
@@ -105,6 +105,12 @@ HistoryItem *History::currentNotification() {
 		: _notifications.front().get();
 }
 
+HistoryItem *History::nextNotification() {
+	return (_notifications.size() > 1)
+		? _notifications[1].get()
+		: nullptr;
+}
+
 bool History::hasNotification() const {
 	return !empty(_notifications);
 }
@@ -129,6 +135,30 @@ void History::setHasPendingResizedItems() {
 	_flags |= Flag::f_has_pending_resized_items;
 }
 
+bool History::hasDeferredResizedItems() const {
+	return _flags & Flag::f_has_deferred_resized_items;
+}
+
+void History::setHasDeferredResizedItems() {
+	_flags |= Flag::f_has_deferred_resized_items;
+}
+
+bool History::resizeDeferredItems(int limit) {
+	if (!hasDeferredResizedItems() || hasPendingResizedItems()) {
+		return false;
+	}
+	_flags &= ~(Flag::f_has_deferred_resized_items);
+
+	const auto was = limit;
+	auto y = 0;
+	for (const auto &block : blocks) {
+		block->setY(y);
+		y += block->resizeDeferredGetHeight(_width, limit);
+	}
+	_height = y;
+	return (limit != was);
+}
+
 void History::itemRemoved(not_null<HistoryItem*> item) {
 	item->removeMainView();
 	if (lastMessage() == item) {
@@ -351,15 +381,25 @@ bool History::updateSendActionNeedsAnimating(
 		return false;
 	}
 
+	// Repeated actions only prolong the existing ones, the text and
+	// the animation are rebuilt only if the set of actions changed.
 	const auto now = crl::now();
+	auto changed = false;
 	const auto emplaceAction = [&](
 			Type type,
 			crl::time duration,
 			int progress = 0) {
+		const auto i = _sendActions.find(user);
+		if (i == end(_sendActions) || i->second.type != type) {
+			changed = true;
+		}
 		_sendActions.emplace_or_assign(user, type, now + duration, progress);
 	};
 	action.match([&](const MTPDsendMessageTypingAction &) {
-		_typing.emplace_or_assign(user, now + kStatusShowClientsideTyping);
+		const auto until = now + kStatusShowClientsideTyping;
+		if (_typing.emplace_or_assign(user, until).second) {
+			changed = true;
+		}
 	}, [&](const MTPDsendMessageRecordVideoAction &) {
 		emplaceAction(Type::RecordVideo, kStatusShowClientsideRecordVideo);
 	}, [&](const MTPDsendMessageRecordAudioAction &) {
@@ -405,7 +445,7 @@ bool History::updateSendActionNeedsAnimating(
 	}, [&](const MTPDsendMessageCancelAction &) {
 		Unexpected("CancelAction here.");
 	});
-	return updateSendActionNeedsAnimating(now, true);
+	return updateSendActionNeedsAnimating(now, changed);
 }
 
 bool History::mySendActionUpdated(SendAction::Type type, bool doing) {
@@ -431,6 +471,10 @@ bool History::mySendActionUpdated(SendAction::Type type, bool doing) {
 	return true;
 }
 
+bool History::hasSendAction() const {
+	return bool(_sendActionAnimation);
+}
+
 bool History::paintSendAction(
 		Painter &p,
 		int x,
@@ -459,20 +503,33 @@ bool History::paintSendAction(
 
 bool History::updateSendActionNeedsAnimating(crl::time now, bool force) {
 	auto changed = force;
-	for (auto i = begin(_typing); i != end(_typing);) {
-		if (now >= i->second) {
-			i = _typing.erase(i);
-			changed = true;
-		} else {
-			++i;
+
+	// This is called each animation frame, so the actions are checked
+	// only when the earliest of them expires.
+	if (force || (_sendActionsExpireAt && now >= _sendActionsExpireAt)) {
+		_sendActionsExpireAt = 0;
+		const auto checkExpire = [&](crl::time until) {
+			if (!_sendActionsExpireAt || until < _sendActionsExpireAt) {
+				_sendActionsExpireAt = until;
+			}
+		};
+		for (auto i = begin(_typing); i != end(_typing);) {
+			if (now >= i->second) {
+				i = _typing.erase(i);
+				changed = true;
+			} else {
+				checkExpire(i->second);
+				++i;
+			}
 		}
-	}
-	for (auto i = begin(_sendActions); i != end(_sendActions);) {
-		if (now >= i->second.until) {
-			i = _sendActions.erase(i);
-			changed = true;
-		} else {
-			++i;
+		for (auto i = begin(_sendActions); i != end(_sendActions);) {
+			if (now >= i->second.until) {
+				i = _sendActions.erase(i);
+				changed = true;
+			} else {
+				checkExpire(i->second.until);
+				++i;
+			}
 		}
 	}
 	if (changed) {
@@ -596,6 +653,12 @@ std::vector<not_null<HistoryItem*>> History::createItems(
 		const QVector<MTPMessage> &data) {
 	auto result = std::vector<not_null<HistoryItem*>>();
 	result.reserve(data.size());
+
+	// Albums refresh the views of all their items for each added item.
+	owner().suspendItemViewRefresh();
+	const auto guard = gsl::finally([&] {
+		owner().resumeItemViewRefresh();
+	});
 	for (auto i = data.cend(), e = data.cbegin(); i != e;) {
 		const auto detachExistingItem = true;
 		if (const auto item = createItem(*--i, detachExistingItem)) {
@@ -1877,54 +1940,27 @@ void History::countScrollTopItem(int top) {
 		return;
 	}
 
-	auto itemIndex = 0;
-	auto blockIndex = 0;
-	auto itemTop = 0;
-	if (scrollTopItem) {
-		itemIndex = scrollTopItem->indexInBlock();
-		blockIndex = scrollTopItem->block()->indexInHistory();
-		itemTop = blocks[blockIndex]->y() + scrollTopItem->y();
-	}
-	if (itemTop > top) {
-		// go backward through history while we don't find an item that starts above
-		do {
-			const auto &block = blocks[blockIndex];
-			for (--itemIndex; itemIndex >= 0; --itemIndex) {
-				const auto view = block->messages[itemIndex].get();
-				itemTop = block->y() + view->y();
-				if (itemTop <= top) {
-					scrollTopItem = view;
-					return;
-				}
-			}
-			if (--blockIndex >= 0) {
-				itemIndex = blocks[blockIndex]->messages.size();
-			} else {
-				break;
-			}
-		} while (true);
-
+	// Blocks keep their tops in the history and elements keep their tops
+	// in the block, so both levels are sorted prefix sums of the heights.
+	// Find the last item that starts above with two binary searches.
+	const auto block = ranges::upper_bound(
+		blocks,
+		top,
+		std::less<>(),
+		[](const auto &block) { return block->y(); });
+	if (block == begin(blocks)) {
 		scrollTopItem = blocks.front()->messages.front().get();
-	} else {
-		// go forward through history while we don't find the last item that starts above
-		for (auto blocksCount = int(blocks.size()); blockIndex < blocksCount; ++blockIndex) {
-			const auto &block = blocks[blockIndex];
-			for (auto itemsCount = int(block->messages.size()); itemIndex < itemsCount; ++itemIndex) {
-				itemTop = block->y() + block->messages[itemIndex]->y();
-				if (itemTop > top) {
-					Assert(itemIndex > 0 || blockIndex > 0);
-					if (itemIndex > 0) {
-						scrollTopItem = block->messages[itemIndex - 1].get();
-					} else {
-						scrollTopItem = blocks[blockIndex - 1]->messages.back().get();
-					}
-					return;
-				}
-			}
-			itemIndex = 0;
-		}
-		scrollTopItem = blocks.back()->messages.back().get();
+		return;
 	}
+	const auto &messages = (*(block - 1))->messages;
+	const auto view = ranges::upper_bound(
+		messages,
+		top - (*(block - 1))->y(),
+		std::less<>(),
+		[](const auto &view) { return view->y(); });
+	scrollTopItem = (view == begin(messages))
+		? messages.front().get()
+		: (view - 1)->get();
 }
 
 void History::getNextScrollTopItem(HistoryBlock *block, int32 i) {
@@ -2705,10 +2741,15 @@ HistoryItem *History::lastSentMessage() const {
 	return nullptr;
 }
 
-void History::resizeToWidth(int newWidth) {
+void History::resizeToWidth(
+		int newWidth,
+		int immediateTop,
+		int immediateBottom) {
 	const auto resizeAllItems = (_width != newWidth);
 
-	if (!resizeAllItems && !hasPendingResizedItems()) {
+	if (!resizeAllItems
+		&& !hasPendingResizedItems()
+		&& !hasDeferredResizedItems()) {
 		return;
 	}
 	_flags &= ~(Flag::f_has_pending_resized_items);
@@ -2717,7 +2758,11 @@ void History::resizeToWidth(int newWidth) {
 	int y = 0;
 	for (const auto &block : blocks) {
 		block->setY(y);
-		y += block->resizeGetHeight(newWidth, resizeAllItems);
+		y += block->resizeGetHeight(
+			newWidth,
+			resizeAllItems,
+			immediateTop - y,
+			immediateBottom - y);
 	}
 	_height = y;
 }
@@ -3024,6 +3069,7 @@ void History::clear(ClearType type) {
 	} else {
 		_notifications.clear();
 		owner().notifyHistoryCleared(this);
+		session().api().clearCachedHistorySlice(this);
 		if (unreadCountKnown()) {
 			setUnreadCount(0);
 		}
@@ -3125,15 +3171,45 @@ HistoryBlock::HistoryBlock(not_null<History*> history)
 : _history(history) {
 }
 
-int HistoryBlock::resizeGetHeight(int newWidth, bool resizeAllItems) {
+int HistoryBlock::resizeGetHeight(
+		int newWidth,
+		bool resizeAllItems,
+		int immediateTop,
+		int immediateBottom) {
 	auto y = 0;
 	for (const auto &message : messages) {
 		message->setY(y);
-		if (resizeAllItems || message->pendingResize()) {
+		const auto height = message->height();
+		const auto immediate = (y < immediateBottom)
+			&& (y + height > immediateTop);
+		if (message->pendingResize()
+			|| ((resizeAllItems || message->resizeDeferred())
+				&& (immediate || !height))) {
 			y += message->resizeGetHeight(newWidth);
+		} else if (resizeAllItems) {
+			message->setResizeDeferred();
+			y += height;
 		} else {
-			y += message->height();
+			y += height;
+		}
+	}
+	_height = y;
+	return _height;
+}
+
+int HistoryBlock::resizeDeferredGetHeight(int newWidth, int &limit) {
+	auto y = 0;
+	for (const auto &message : messages) {
+		message->setY(y);
+		if (message->resizeDeferred()) {
+			if (limit > 0) {
+				--limit;
+				y += message->resizeGetHeight(newWidth);
+				continue;
+			}
+			_history->setHasDeferredResizedItems();
 		}
+		y += message->height();
 	}
 	_height = y;
 	return _height;
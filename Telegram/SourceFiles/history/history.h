@@ -208,13 +208,19 @@ public:
 	MsgId msgIdForRead() const;
 	HistoryItem *lastSentMessage() const;
 
-	void resizeToWidth(int newWidth);
+	// Only elements intersecting [immediateTop, immediateBottom) are
+	// resized right away, others are deferred if they were laid out before.
+	void resizeToWidth(
+		int newWidth,
+		int immediateTop = 0,
+		int immediateBottom = std::numeric_limits<int>::max());
 	int height() const;
 
 	void itemRemoved(not_null<HistoryItem*> item);
 	void itemVanished(not_null<HistoryItem*> item);
 
 	HistoryItem *currentNotification();
+	HistoryItem *nextNotification();
 	bool hasNotification() const;
 	void skipNotification();
 	void popNotification(HistoryItem *item);
@@ -222,7 +228,13 @@ public:
 	bool hasPendingResizedItems() const;
 	void setHasPendingResizedItems();
 
+	// Returns true if some of the deferred elements were resized.
+	bool hasDeferredResizedItems() const;
+	void setHasDeferredResizedItems();
+	bool resizeDeferredItems(int limit);
+
 	bool mySendActionUpdated(SendAction::Type type, bool doing);
+	bool hasSendAction() const;
 	bool paintSendAction(
 		Painter &p,
 		int x,
@@ -367,6 +379,7 @@ private:
 
 	enum class Flag {
 		f_has_pending_resized_items = (1 << 0),
+		f_has_deferred_resized_items = (1 << 1),
 	};
 	using Flags = base::flags<Flag>;
 	friend inline constexpr auto is_flag_type(Flag) {
@@ -515,6 +528,7 @@ private:
 
 	base::flat_map<not_null<UserData*>, crl::time> _typing;
 	base::flat_map<not_null<UserData*>, SendAction> _sendActions;
+	crl::time _sendActionsExpireAt = 0;
 	QString _sendActionString;
 	Text _sendActionText;
 	Ui::SendActionAnimation _sendActionAnimation;
@@ -540,7 +554,12 @@ public:
 	void remove(not_null<Element*> view);
 	void refreshView(not_null<Element*> view);
 
-	int resizeGetHeight(int newWidth, bool resizeAllItems);
+	int resizeGetHeight(
+		int newWidth,
+		bool resizeAllItems,
+		int immediateTop,
+		int immediateBottom);
+	int resizeDeferredGetHeight(int newWidth, int &limit);
 	int y() const {
 		return _y;
 	}
@@ -54,6 +54,9 @@ namespace {
 constexpr auto kScrollDateHideTimeout = 1000;
 constexpr auto kUnloadHeavyPartsPages = 3;
 
+// Texts of larger selections are joined off the main thread.
+constexpr auto kCopyAsyncMinItems = 100;
+
 // Helper binary search for an item in a list that is not completely
 // above the given top of the visible area or below the given bottom of the visible area
 // is applied once for blocks list in a history and once for items list in the found block.
@@ -74,6 +77,35 @@ int BinarySearchBlocksOrItems(const T &list, int edge) {
 	return start;
 }
 
+// Can be called from any thread.
+TextForMimeData JoinSelectedTexts(HistoryInner::SelectedTexts &&texts) {
+	if (texts.empty()) {
+		return TextForMimeData();
+	} else if (texts.size() == 1) {
+		return std::move(texts.front().second);
+	}
+	ranges::sort(texts, ranges::less(), [](const auto &pair) {
+		return pair.first;
+	});
+
+	const auto sep = qstr("\n\n");
+	auto fullSize = (int(texts.size()) - 1) * sep.size();
+	auto entitiesCount = 0;
+	for (const auto &[position, text] : texts) {
+		fullSize += text.expanded.size();
+		entitiesCount += text.rich.entities.size();
+	}
+	auto result = TextForMimeData();
+	result.reserve(fullSize, entitiesCount);
+	for (auto i = texts.begin(), e = texts.end(); i != e;) {
+		result.append(std::move(i->second));
+		if (++i != e) {
+			result.append(sep);
+		}
+	}
+	return result;
+}
+
 } // namespace
 
 // flick scroll taken from http://qt-project.org/doc/qt-4.8/demos-embedded-anomaly-src-flickcharm-cpp.html
@@ -222,12 +254,21 @@ void HistoryInner::repaintItem(const HistoryItem *item) {
 }
 
 void HistoryInner::repaintItem(const Element *view) {
-	if (_widget->skipItemRepaint()) {
+	const auto top = itemTop(view);
+	if (top < 0) {
 		return;
 	}
-	const auto top = itemTop(view);
-	if (top >= 0) {
-		update(0, top, width(), view->height());
+	const auto rect = QRect(0, top, width(), view->height());
+	if (_widget->skipItemRepaint()) {
+		_skippedRepaint = _skippedRepaint.united(rect);
+	} else {
+		update(rect);
+	}
+}
+
+void HistoryInner::repaintSkippedItems() {
+	if (!_skippedRepaint.isEmpty()) {
+		update(base::take(_skippedRepaint));
 	}
 }
 
@@ -1797,7 +1838,16 @@ void HistoryInner::showContextMenu(QContextMenuEvent *e, bool showFromTouch) {
 }
 
 void HistoryInner::copySelectedText() {
-	SetClipboardText(getSelectedText());
+	auto texts = collectSelectedTexts();
+	if (texts.size() < kCopyAsyncMinItems) {
+		SetClipboardText(JoinSelectedTexts(std::move(texts)));
+		return;
+	}
+	crl::async([texts = std::move(texts)]() mutable {
+		crl::on_main([text = JoinSelectedTexts(std::move(texts))] {
+			SetClipboardText(text);
+		});
+	});
 }
 
 void HistoryInner::savePhotoToFile(not_null<PhotoData*> photo) {
@@ -1884,27 +1934,33 @@ void HistoryInner::resizeEvent(QResizeEvent *e) {
 }
 
 TextForMimeData HistoryInner::getSelectedText() const {
+	return JoinSelectedTexts(collectSelectedTexts());
+}
+
+HistoryInner::SelectedTexts HistoryInner::collectSelectedTexts() const {
 	auto selected = _selected;
 
 	if (_mouseAction == MouseAction::Selecting && _dragSelFrom && _dragSelTo) {
 		applyDragSelection(&selected);
 	}
 
+	auto texts = SelectedTexts();
 	if (selected.empty()) {
-		return TextForMimeData();
+		return texts;
 	}
 	if (selected.cbegin()->second != FullSelection) {
 		const auto [item, selection] = *selected.cbegin();
 		if (const auto view = item->mainView()) {
-			return view->selectedText(selection);
+			texts.emplace_back(
+				item->position(),
+				view->selectedText(selection));
 		}
-		return TextForMimeData();
+		return texts;
 	}
 
 	const auto timeFormat = qsl(", [dd.MM.yy hh:mm]\n");
 	auto groups = base::flat_set<not_null<const Data::Group*>>();
-	auto fullSize = 0;
-	auto texts = base::flat_map<Data::MessagePosition, TextForMimeData>();
+	texts.reserve(selected.size());
 
 	const auto wrapItem = [&](
 			not_null<HistoryItem*> item,
@@ -1914,11 +1970,10 @@ TextForMimeData HistoryInner::getSelectedText() const {
 		auto size = item->author()->name.size()
 			+ time.size()
 			+ unwrapped.expanded.size();
-		part.reserve(size);
+		part.reserve(size, unwrapped.rich.entities.size());
 		part.append(item->author()->name).append(time);
 		part.append(std::move(unwrapped));
-		texts.emplace(item->position(), part);
-		fullSize += size;
+		texts.emplace_back(item->position(), std::move(part));
 	};
 	const auto addItem = [&](not_null<HistoryItem*> item) {
 		wrapItem(item, HistoryItemText(item));
@@ -1944,17 +1999,7 @@ TextForMimeData HistoryInner::getSelectedText() const {
 			addItem(item);
 		}
 	}
-
-	auto result = TextForMimeData();
-	const auto sep = qstr("\n\n");
-	result.reserve(fullSize + (texts.size() - 1) * sep.size());
-	for (auto i = texts.begin(), e = texts.end(); i != e;) {
-		result.append(std::move(i->second));
-		if (++i != e) {
-			result.append(sep);
-		}
-	}
-	return result;
+	return texts;
 }
 
 void HistoryInner::keyPressEvent(QKeyEvent *e) {
@@ -1987,9 +2032,21 @@ void HistoryInner::recountHistoryGeometry() {
 		accumulate_max(oldHistoryPaddingTop, st::msgMargin.top() + st::msgMargin.bottom() + st::msgPadding.top() + st::msgPadding.bottom() + st::msgNameFont->height + st::botDescSkip + _botAbout->height);
 	}
 
-	_history->resizeToWidth(_contentWidth);
+	// Elements more than a screen away from the viewport are resized
+	// later, see HistoryWidget::resizeDeferredItems().
+	const auto immediateTop = _visibleAreaTop - visibleHeight;
+	const auto immediateBottom = _visibleAreaBottom + visibleHeight;
+	const auto historyTopWas = historyTop();
+	const auto migratedTopWas = migratedTop();
+	_history->resizeToWidth(
+		_contentWidth,
+		immediateTop - historyTopWas,
+		immediateBottom - historyTopWas);
 	if (_migrated) {
-		_migrated->resizeToWidth(_contentWidth);
+		_migrated->resizeToWidth(
+			_contentWidth,
+			immediateTop - migratedTopWas,
+			immediateBottom - migratedTopWas);
 	}
 
 	// With migrated history we perhaps do not need to display
@@ -2143,6 +2200,10 @@ void HistoryInner::visibleAreaUpdated(int top, int bottom) {
 	const auto from = _visibleAreaTop - pages * visibleAreaHeight;
 	const auto till = _visibleAreaBottom + pages * visibleAreaHeight;
 	Auth().data().unloadHeavyViewParts(ElementDelegate(), from, till);
+	Auth().data().updateHeavyViewPartsVisibility(
+		ElementDelegate(),
+		_visibleAreaTop,
+		_visibleAreaBottom);
 }
 
 bool HistoryInner::displayScrollDate() const {
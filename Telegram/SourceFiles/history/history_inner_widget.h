@@ -13,6 +13,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/widgets/tooltip.h"
 #include "ui/widgets/scroll_area.h"
 #include "history/view/history_view_top_bar_widget.h"
+#include "data/data_messages.h"
 
 namespace Data {
 struct Group;
@@ -57,6 +58,9 @@ public:
 
 	TextForMimeData getSelectedText() const;
 
+	using SelectedTexts = std::vector<
+		std::pair<Data::MessagePosition, TextForMimeData>>;
+
 	void touchScrollUpdated(const QPoint &screenPos);
 
 	void recountHistoryGeometry();
@@ -64,6 +68,7 @@ public:
 
 	void repaintItem(const HistoryItem *item);
 	void repaintItem(const Element *view);
+	void repaintSkippedItems();
 
 	bool canCopySelected() const;
 	bool canDeleteSelected() const;
@@ -254,6 +259,7 @@ private:
 
 	void applyDragSelection();
 	void applyDragSelection(not_null<SelectedItems*> toItems) const;
+	SelectedTexts collectSelectedTexts() const;
 	void addSelectionRange(
 		not_null<SelectedItems*> toItems,
 		not_null<History*> history,
@@ -368,6 +374,10 @@ private:
 	int _visibleAreaTop = 0;
 	int _visibleAreaBottom = 0;
 
+	// Items asking for a repaint while the history is being scrolled
+	// are repainted together later, only in their bounding rect.
+	QRect _skippedRepaint;
+
 	bool _scrollDateShown = false;
 	Ui::Animations::Simple _scrollDateOpacity;
 	SingleQueuedInvokation _scrollDateCheck;
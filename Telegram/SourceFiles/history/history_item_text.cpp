@@ -82,7 +82,7 @@ TextForMimeData HistoryItemText(not_null<HistoryItem*> item) {
 				title,
 				Ui::WebpageTextTitleOptions().flags));
 		auto descriptionResult = TextForMimeData::Rich(
-			base::duplicate(entry->page->description));
+			base::duplicate(entry->page->description()));
 		if (titleResult.empty()) {
 			return descriptionResult;
 		} else if (descriptionResult.empty()) {
@@ -700,7 +700,7 @@ void HistoryMessage::createComponents(const CreateConfig &config) {
 		edited->date = config.editDate;
 	}
 	if (const auto msgsigned = Get<HistoryMessageSigned>()) {
-		msgsigned->author = config.author;
+		msgsigned->author = Data::InternedString(config.author);
 	}
 	setupForwardedComponent(config);
 	if (const auto markup = Get<HistoryMessageReplyMarkup>()) {
@@ -731,7 +731,8 @@ void HistoryMessage::setupForwardedComponent(const CreateConfig &config) {
 			config.senderNameOriginal);
 	}
 	forwarded->originalId = config.originalId;
-	forwarded->originalAuthor = config.authorOriginal;
+	forwarded->originalAuthor = Data::InternedString(
+		config.authorOriginal);
 	forwarded->savedFromPeer = history()->owner().peerLoaded(
 		config.savedFromPeer);
 	forwarded->savedFromMsgId = config.savedFromMsgId;
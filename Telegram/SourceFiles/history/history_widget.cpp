@@ -82,6 +82,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/shortcuts.h"
 #include "support/support_common.h"
 #include "support/support_autocomplete.h"
+#include "support/support_helper.h"
 #include "dialogs/dialogs_key.h"
 #include "styles/style_history.h"
 #include "styles/style_dialogs.h"
@@ -95,7 +96,12 @@ namespace {
 
 constexpr auto kMessagesPerPageFirst = 30;
 constexpr auto kMessagesPerPage = 50;
-constexpr auto kPreloadHeightsCount = 3; // when 3 screens to scroll left make a preload request
+using PreloadDirection = HistoryView::PreloadPredictor::Direction;
+
+// A support chat slice loaded in advance is passed as a request result.
+constexpr auto kPrefetchedRequestId = mtpRequestId(-2);
+// The slice saved on disk is shown until the first request is finished.
+constexpr auto kCachedSliceRequestId = mtpRequestId(-3);
 constexpr auto kTabbedSelectorToggleTooltipTimeoutMs = 3000;
 constexpr auto kTabbedSelectorToggleTooltipCount = 3;
 constexpr auto kScrollToVoiceAfterScrolledMs = 1000;
@@ -109,6 +115,10 @@ constexpr auto kSaveDraftAnywayTimeout = 5000;
 constexpr auto kSaveCloudDraftIdleTimeout = 14000;
 constexpr auto kRecordingUpdateDelta = crl::time(100);
 
+// Elements far from the viewport are resized in chunks after a resize.
+constexpr auto kResizeDeferredChunk = 100;
+constexpr auto kResizeDeferredDelay = crl::time(16);
+
 ApiWrap::RequestMessageDataCallback replyEditMessageDataCallback() {
 	return [](ChannelData *channel, MsgId msgId) {
 		if (App::main()) {
@@ -236,6 +246,18 @@ object_ptr<Ui::FlatButton> SetupDiscussButton(
 	return result;
 }
 
+Image *PreloadedThumbnail(HistoryItem *item) {
+	const auto media = item ? item->media() : nullptr;
+	if (!media) {
+		return nullptr;
+	} else if (const auto photo = media->photo()) {
+		return photo->thumbnail();
+	} else if (const auto document = media->document()) {
+		return document->thumbnail();
+	}
+	return nullptr;
+}
+
 } // namespace
 
 ReportSpamPanel::ReportSpamPanel(QWidget *parent) : TWidget(parent),
@@ -329,6 +351,7 @@ HistoryWidget::HistoryWidget(
 , _attachDragDocument(this)
 , _attachDragPhoto(this)
 , _sendActionStopTimer([this] { cancelTypingAction(); })
+, _resizeDeferredTimer([this] { resizeDeferredItems(); })
 , _topShadow(this) {
 	setAcceptDrops(true);
 
@@ -1897,7 +1920,13 @@ void HistoryWidget::clearAllLoadRequests() {
 	if (_firstLoadRequest) MTP::cancel(_firstLoadRequest);
 	if (_preloadRequest) MTP::cancel(_preloadRequest);
 	if (_preloadDownRequest) MTP::cancel(_preloadDownRequest);
+	if (_cachedSliceReconcileRequest) {
+		MTP::cancel(_cachedSliceReconcileRequest);
+	}
 	_preloadRequest = _preloadDownRequest = _firstLoadRequest = 0;
+	_cachedSliceReconcileRequest = 0;
+	_cachedSliceIds.clear();
+	_preloadPredictor.reset();
 }
 
 void HistoryWidget::updateFieldSubmitSettings() {
@@ -2363,6 +2392,14 @@ bool HistoryWidget::messagesFailed(const RPCError &error, mtpRequestId requestId
 		_preloadRequest = 0;
 	} else if (_preloadDownRequest == requestId) {
 		_preloadDownRequest = 0;
+	} else if (_cachedSliceReconcileRequest == requestId) {
+		// Leave the cached slice if it is already shown.
+		_cachedSliceReconcileRequest = 0;
+		_cachedSliceIds.clear();
+		if (_firstLoadRequest == kCachedSliceRequestId) {
+			_firstLoadRequest = 0;
+			controller()->showBackFromStack();
+		}
 	} else if (_firstLoadRequest == requestId) {
 		_firstLoadRequest = 0;
 		controller()->showBackFromStack();
@@ -2435,10 +2472,35 @@ void HistoryWidget::messagesReceived(PeerData *peer, const MTPmessages_Messages
 		return QString("Bad-%1").arg(peerId);
 	};
 
+	if (requestId && _cachedSliceReconcileRequest == requestId) {
+		_cachedSliceReconcileRequest = 0;
+		if (_firstLoadRequest == kCachedSliceRequestId) {
+			// The server answered before the disk did.
+			_firstLoadRequest = requestId;
+		} else {
+			// Replace the shown cached slice with the received one.
+			session().api().reconcileCachedHistorySlice(
+				_history,
+				base::take(_cachedSliceIds),
+				messages);
+			_history->clear(History::ClearType::Unload);
+			_history->getReadyFor(ShowAtTheEndMsgId);
+			_historyInited = false;
+			_firstLoadRequest = requestId;
+		}
+	}
+
 	if (_preloadRequest == requestId) {
 		auto to = toMigrated ? _migrated : _history;
+		const auto wasHeight = _list->height();
 		addMessagesToFront(peer, *histList);
 		_preloadRequest = 0;
+		_preloadPredictor.requestDone(PreloadDirection::Up);
+		_preloadPredictor.sliceAdded(
+			PreloadDirection::Up,
+			_list->height() - wasHeight,
+			histList->size());
+		preloadThumbnails(peer, *histList);
 		preloadHistoryIfNeeded();
 		if (_reportSpamStatus == dbiprsUnknown) {
 			updateReportSpamStatus();
@@ -2446,8 +2508,15 @@ void HistoryWidget::messagesReceived(PeerData *peer, const MTPmessages_Messages
 		}
 	} else if (_preloadDownRequest == requestId) {
 		auto to = toMigrated ? _migrated : _history;
+		const auto wasHeight = _list->height();
 		addMessagesToBack(peer, *histList);
 		_preloadDownRequest = 0;
+		_preloadPredictor.requestDone(PreloadDirection::Down);
+		_preloadPredictor.sliceAdded(
+			PreloadDirection::Down,
+			_list->height() - wasHeight,
+			histList->size());
+		preloadThumbnails(peer, *histList);
 		preloadHistoryIfNeeded();
 		if (_history->loadedAtBottom() && App::wnd()) App::wnd()->checkHistoryActivation();
 	} else if (_firstLoadRequest == requestId) {
@@ -2456,6 +2525,9 @@ void HistoryWidget::messagesReceived(PeerData *peer, const MTPmessages_Messages
 		} else if (_migrated) {
 			_migrated->clear(History::ClearType::Unload);
 		}
+		if (_firstLoadFromEnd && requestId != kCachedSliceRequestId) {
+			session().api().cacheHistorySlice(_history, messages);
+		}
 		addMessagesToFront(peer, *histList);
 		_firstLoadRequest = 0;
 		if (_history->loadedAtTop() && _history->isEmpty() && count > 0) {
@@ -2520,6 +2592,9 @@ void HistoryWidget::windowShown() {
 bool HistoryWidget::doWeReadServerHistory() const {
 	if (!_history || !_list) return true;
 	if (_firstLoadRequest || _a_show.animating()) return false;
+
+	// The cached slice may miss the newest messages.
+	if (_cachedSliceReconcileRequest) return false;
 	if (_history->loadedAtBottom()) {
 		int scrollTop = _scroll->scrollTop();
 		if (scrollTop + 1 > _scroll->scrollTopMax()) return true;
@@ -2541,11 +2616,14 @@ bool HistoryWidget::doWeReadServerHistory() const {
 bool HistoryWidget::doWeReadMentions() const {
 	if (!_history || !_list) return true;
 	if (_firstLoadRequest || _a_show.animating()) return false;
+	if (_cachedSliceReconcileRequest) return false;
 	return true;
 }
 
 void HistoryWidget::firstLoadMessages() {
-	if (!_history || _firstLoadRequest) return;
+	if (!_history || _firstLoadRequest || _cachedSliceReconcileRequest) {
+		return;
+	}
 
 	auto from = _peer;
 	auto offsetId = 0;
@@ -2582,12 +2660,32 @@ void HistoryWidget::firstLoadMessages() {
 		}
 	}
 
+	_firstLoadFromEnd = (from == _peer) && !offsetId && !offset;
+	if (session().supportMode()) {
+		auto prefetched = session().supportHelper().takePrefetched(
+			from,
+			offsetId,
+			offset,
+			loadCount);
+		if (prefetched) {
+			_firstLoadRequest = kPrefetchedRequestId;
+			crl::on_main(this, [=, result = std::move(*prefetched)] {
+				if (_firstLoadRequest == kPrefetchedRequestId
+					&& _peer
+					&& (from == _peer || from == _peer->migrateFrom())) {
+					messagesReceived(from, result, kPrefetchedRequestId);
+				}
+			});
+			return;
+		}
+	}
+
 	auto offsetDate = 0;
 	auto maxId = 0;
 	auto minId = 0;
 	auto historyHash = 0;
 
-	_firstLoadRequest = MTP::send(
+	const auto requestId = MTP::send(
 		MTPmessages_GetHistory(
 			from->input,
 			MTP_int(offsetId),
@@ -2599,10 +2697,48 @@ void HistoryWidget::firstLoadMessages() {
 			MTP_int(historyHash)),
 		rpcDone(&HistoryWidget::messagesReceived, from),
 		rpcFail(&HistoryWidget::messagesFailed));
+	if (!_firstLoadFromEnd
+		|| !_history->isEmpty()
+		|| (_migrated && !_migrated->isEmpty())) {
+		_firstLoadRequest = requestId;
+		return;
+	}
+
+	// Show the slice saved on disk while the request is in progress.
+	const auto history = _history;
+	_firstLoadRequest = kCachedSliceRequestId;
+	_cachedSliceReconcileRequest = requestId;
+	session().api().requestCachedHistorySlice(history, crl::guard(this, [=](
+			const std::optional<MTPmessages_Messages> &slice) {
+		cachedSliceReceived(history, slice);
+	}));
+}
+
+void HistoryWidget::cachedSliceReceived(
+		not_null<History*> history,
+		const std::optional<MTPmessages_Messages> &slice) {
+	if (_history != history
+		|| _firstLoadRequest != kCachedSliceRequestId
+		|| !_cachedSliceReconcileRequest) {
+		return;
+	} else if (!slice) {
+		_firstLoadRequest = base::take(_cachedSliceReconcileRequest);
+		return;
+	}
+	slice->match([](const MTPDmessages_messagesNotModified &) {
+	}, [&](const auto &data) {
+		_cachedSliceIds.reserve(data.vmessages.v.size());
+		for (const auto &message : data.vmessages.v) {
+			_cachedSliceIds.push_back(IdFromMessage(message));
+		}
+	});
+	messagesReceived(_peer, *slice, kCachedSliceRequestId);
 }
 
 void HistoryWidget::loadMessages() {
-	if (!_history || _preloadRequest) return;
+	if (!_history || _preloadRequest || _cachedSliceReconcileRequest) {
+		return;
+	}
 
 	if (_history->isEmpty() && _migrated && _migrated->isEmpty()) {
 		return firstLoadMessages();
@@ -2617,7 +2753,7 @@ void HistoryWidget::loadMessages() {
 	auto offsetId = from->minMsgId();
 	auto addOffset = 0;
 	auto loadCount = offsetId
-		? kMessagesPerPage
+		? _preloadPredictor.sliceSize(PreloadDirection::Up, kMessagesPerPage)
 		: kMessagesPerPageFirst;
 	auto offsetDate = 0;
 	auto maxId = 0;
@@ -2636,10 +2772,13 @@ void HistoryWidget::loadMessages() {
 			MTP_int(historyHash)),
 		rpcDone(&HistoryWidget::messagesReceived, from->peer.get()),
 		rpcFail(&HistoryWidget::messagesFailed));
+	_preloadPredictor.requestSent(PreloadDirection::Up);
 }
 
 void HistoryWidget::loadMessagesDown() {
-	if (!_history || _preloadDownRequest) return;
+	if (!_history || _preloadDownRequest || _cachedSliceReconcileRequest) {
+		return;
+	}
 
 	if (_history->isEmpty() && _migrated && _migrated->isEmpty()) {
 		return firstLoadMessages();
@@ -2651,7 +2790,9 @@ void HistoryWidget::loadMessagesDown() {
 		return;
 	}
 
-	auto loadCount = kMessagesPerPage;
+	auto loadCount = _preloadPredictor.sliceSize(
+		PreloadDirection::Down,
+		kMessagesPerPage);
 	auto addOffset = -loadCount;
 	auto offsetId = from->maxMsgId();
 	if (!offsetId) {
@@ -2676,6 +2817,7 @@ void HistoryWidget::loadMessagesDown() {
 			MTP_int(historyHash)),
 		rpcDone(&HistoryWidget::messagesReceived, from->peer.get()),
 		rpcFail(&HistoryWidget::messagesFailed));
+	_preloadPredictor.requestSent(PreloadDirection::Down);
 }
 
 void HistoryWidget::delayedShowAt(MsgId showAtMsgId) {
@@ -2735,6 +2877,10 @@ void HistoryWidget::onScroll() {
 	visibleAreaUpdated();
 	if (!_synteticScrollEvent) {
 		_lastUserScrolled = crl::now();
+		if (hasDeferredResizedItems()) {
+			// Resize the deferred elements that were scrolled into view.
+			updateHistoryGeometry();
+		}
 	}
 }
 
@@ -2778,6 +2924,10 @@ void HistoryWidget::preloadHistoryIfNeeded() {
 		return;
 	}
 
+	if (_scroll->scrollTop() != _lastScrollTop) {
+		_preloadPredictor.scrolled(_scroll->scrollTop());
+	}
+
 	updateHistoryDownVisibility();
 	if (!_scrollToAnimation.animating()) {
 		preloadHistoryByScroll();
@@ -2799,10 +2949,16 @@ void HistoryWidget::preloadHistoryByScroll() {
 	auto scrollTop = _scroll->scrollTop();
 	auto scrollTopMax = _scroll->scrollTopMax();
 	auto scrollHeight = _scroll->height();
-	if (scrollTop + kPreloadHeightsCount * scrollHeight >= scrollTopMax) {
+	const auto preloadDown = _preloadPredictor.distance(
+		PreloadDirection::Down,
+		scrollHeight);
+	const auto preloadUp = _preloadPredictor.distance(
+		PreloadDirection::Up,
+		scrollHeight);
+	if (scrollTop + preloadDown >= scrollTopMax) {
 		loadMessagesDown();
 	}
-	if (scrollTop <= kPreloadHeightsCount * scrollHeight) {
+	if (scrollTop <= preloadUp) {
 		loadMessages();
 	}
 }
@@ -3216,14 +3372,24 @@ void HistoryWidget::chooseAttach() {
 				uploadFile(result.remoteContent, SendMediaType::File);
 			}
 		} else {
-			auto list = Storage::PrepareMediaList(
+			const auto history = _history;
+			Storage::PrepareMediaListAsync(
 				result.paths,
-				st::sendMediaPreviewSize);
-			if (list.allFilesForCompress || list.albumIsPossible) {
-				confirmSendingFiles(std::move(list), CompressConfirm::Auto);
-			} else if (!showSendingFilesError(list)) {
-				confirmSendingFiles(std::move(list), CompressConfirm::No);
-			}
+				st::sendMediaPreviewSize,
+				crl::guard(this, [=](Storage::PreparedList &&list) {
+					if (_history != history) {
+						return;
+					} else if (list.allFilesForCompress
+						|| list.albumIsPossible) {
+						confirmSendingFiles(
+							std::move(list),
+							CompressConfirm::Auto);
+					} else if (!showSendingFilesError(list)) {
+						confirmSendingFiles(
+							std::move(list),
+							CompressConfirm::No);
+					}
+				}));
 		}
 	}));
 }
@@ -4145,10 +4311,19 @@ bool HistoryWidget::confirmSendingFiles(
 		const QStringList &files,
 		CompressConfirm compressed,
 		const QString &insertTextOnCancel) {
-	return confirmSendingFiles(
-		Storage::PrepareMediaList(files, st::sendMediaPreviewSize),
-		compressed,
-		insertTextOnCancel);
+	const auto history = _history;
+	Storage::PrepareMediaListAsync(
+		files,
+		st::sendMediaPreviewSize,
+		crl::guard(this, [=](Storage::PreparedList &&list) {
+			if (_history == history) {
+				confirmSendingFiles(
+					std::move(list),
+					compressed,
+					insertTextOnCancel);
+			}
+		}));
+	return true;
 }
 
 bool HistoryWidget::confirmSendingFiles(
@@ -4267,21 +4442,40 @@ bool HistoryWidget::confirmSendingFiles(
 
 	const auto hasImage = data->hasImage();
 
-	if (const auto urls = data->urls(); !urls.empty()) {
-		auto list = Storage::PrepareMediaList(
+	const auto urls = data->urls();
+	const auto allLocal = !urls.empty() && ranges::find_if(
+		urls,
+		[](const QUrl &url) { return !url.isLocalFile(); }
+	) == urls.end();
+	if (allLocal) {
+		// The image is the fallback if the files can't be sent.
+		const auto image = hasImage
+			? qvariant_cast<QImage>(data->imageData())
+			: QImage();
+		const auto history = _history;
+		Storage::PrepareMediaListAsync(
 			urls,
-			st::sendMediaPreviewSize);
-		if (list.error != Storage::PreparedList::Error::NonLocalUrl) {
-			if (list.error == Storage::PreparedList::Error::None
-				|| !hasImage) {
-				const auto emptyTextOnCancel = QString();
-				confirmSendingFiles(
-					std::move(list),
-					compressed,
-					emptyTextOnCancel);
-				return true;
-			}
-		}
+			st::sendMediaPreviewSize,
+			crl::guard(this, [=](Storage::PreparedList &&list) {
+				if (_history != history) {
+					return;
+				} else if (list.error == Storage::PreparedList::Error::None
+					|| image.isNull()) {
+					const auto emptyTextOnCancel = QString();
+					confirmSendingFiles(
+						std::move(list),
+						compressed,
+						emptyTextOnCancel);
+				} else {
+					auto copy = image;
+					confirmSendingFiles(
+						std::move(copy),
+						QByteArray(),
+						compressed,
+						insertTextOnCancel);
+				}
+			}));
+		return true;
 	}
 
 	if (hasImage) {
@@ -4785,7 +4979,7 @@ void HistoryWidget::onUpdateHistoryItems() {
 
 	auto ms = crl::now();
 	if (_lastScrolled + kSkipRepaintWhileScrollMs <= ms) {
-		_list->update();
+		_list->repaintSkippedItems();
 	} else {
 		_updateHistoryItems.start(_lastScrolled + kSkipRepaintWhileScrollMs - ms);
 	}
@@ -5086,6 +5280,9 @@ void HistoryWidget::updateHistoryGeometry(bool initial, bool loadedDown, const S
 
 void HistoryWidget::updateListSize() {
 	_list->recountHistoryGeometry();
+	if (hasDeferredResizedItems() && !_resizeDeferredTimer.isActive()) {
+		_resizeDeferredTimer.callOnce(kResizeDeferredDelay);
+	}
 	auto washidden = _scroll->isHidden();
 	if (washidden) {
 		_scroll->show();
@@ -5102,6 +5299,34 @@ bool HistoryWidget::hasPendingResizedItems() const {
 		|| (_migrated && _migrated->hasPendingResizedItems());
 }
 
+bool HistoryWidget::hasDeferredResizedItems() const {
+	return (_history && _history->hasDeferredResizedItems())
+		|| (_migrated && _migrated->hasDeferredResizedItems());
+}
+
+void HistoryWidget::resizeDeferredItems() {
+	if (!_list || !hasDeferredResizedItems()) {
+		return;
+	} else if (hasPendingResizedItems()) {
+		_resizeDeferredTimer.callOnce(kResizeDeferredDelay);
+		return;
+	}
+	auto resized = false;
+	if (_migrated && _migrated->resizeDeferredItems(kResizeDeferredChunk)) {
+		resized = true;
+	}
+	if (_history->resizeDeferredItems(kResizeDeferredChunk)) {
+		resized = true;
+	}
+	if (resized) {
+		// Keeps the scroll attached to the top visible item.
+		updateHistoryGeometry();
+	}
+	if (hasDeferredResizedItems()) {
+		_resizeDeferredTimer.callOnce(kResizeDeferredDelay);
+	}
+}
+
 std::optional<int> HistoryWidget::unreadBarTop() const {
 	auto getUnreadBar = [this]() -> HistoryView::Element* {
 		if (const auto bar = _migrated ? _migrated->unreadBar() : nullptr) {
@@ -5139,6 +5364,44 @@ void HistoryWidget::addMessagesToFront(PeerData *peer, const QVector<MTPMessage>
 	}
 }
 
+void HistoryWidget::preloadThumbnails(
+		not_null<PeerData*> peer,
+		const QVector<MTPMessage> &messages) {
+	const auto channel = peerToChannel(peer->id);
+	auto ids = std::vector<FullMsgId>();
+	auto keys = std::vector<Storage::Cache::Key>();
+	for (const auto &message : messages) {
+		const auto id = FullMsgId(channel, IdFromMessage(message));
+		const auto image = PreloadedThumbnail(session().data().message(id));
+		if (!image || image->loaded() || image->loading()) {
+			continue;
+		} else if (const auto key = image->cacheKey()) {
+			ids.push_back(id);
+			keys.push_back(*key);
+		}
+	}
+	if (keys.empty()) {
+		return;
+	}
+
+	// All the thumbnails of the slice are read from the cache at once.
+	const auto done = [=](std::vector<QByteArray> &&values) {
+		crl::on_main(this, [=, values = std::move(values)] {
+			for (auto i = 0, count = int(ids.size()); i != count; ++i) {
+				const auto image = PreloadedThumbnail(
+					session().data().message(ids[i]));
+				if (!values[i].isEmpty()
+					&& image
+					&& !image->loaded()
+					&& image->cacheKey() == keys[i]) {
+					image->setImageBytes(values[i]);
+				}
+			}
+		});
+	};
+	session().data().cache().getMany(base::duplicate(keys), done);
+}
+
 void HistoryWidget::addMessagesToBack(PeerData *peer, const QVector<MTPMessage> &messages) {
 	_list->messagesReceivedDown(peer, messages);
 	if (!_firstLoadRequest) {
@@ -6213,20 +6476,20 @@ void HistoryWidget::updatePreview() {
 			QString title, desc;
 			if (_previewData->siteName.isEmpty()) {
 				if (_previewData->title.isEmpty()) {
-					if (_previewData->description.text.isEmpty()) {
+					if (_previewData->descriptionText().isEmpty()) {
 						title = _previewData->author;
 						desc = ((_previewData->document && !_previewData->document->filename().isEmpty()) ? _previewData->document->filename() : _previewData->url);
 					} else {
-						title = _previewData->description.text;
+						title = _previewData->descriptionText();
 						desc = _previewData->author.isEmpty() ? ((_previewData->document && !_previewData->document->filename().isEmpty()) ? _previewData->document->filename() : _previewData->url) : _previewData->author;
 					}
 				} else {
 					title = _previewData->title;
-					desc = _previewData->description.text.isEmpty() ? (_previewData->author.isEmpty() ? ((_previewData->document && !_previewData->document->filename().isEmpty()) ? _previewData->document->filename() : _previewData->url) : _previewData->author) : _previewData->description.text;
+					desc = _previewData->descriptionText().isEmpty() ? (_previewData->author.isEmpty() ? ((_previewData->document && !_previewData->document->filename().isEmpty()) ? _previewData->document->filename() : _previewData->url) : _previewData->author) : _previewData->descriptionText();
 				}
 			} else {
 				title = _previewData->siteName;
-				desc = _previewData->title.isEmpty() ? (_previewData->description.text.isEmpty() ? (_previewData->author.isEmpty() ? ((_previewData->document && !_previewData->document->filename().isEmpty()) ? _previewData->document->filename() : _previewData->url) : _previewData->author) : _previewData->description.text) : _previewData->title;
+				desc = _previewData->title.isEmpty() ? (_previewData->descriptionText().isEmpty() ? (_previewData->author.isEmpty() ? ((_previewData->document && !_previewData->document->filename().isEmpty()) ? _previewData->document->filename() : _previewData->url) : _previewData->author) : _previewData->descriptionText()) : _previewData->title;
 			}
 			if (title.isEmpty()) {
 				if (_previewData->document) {
@@ -16,6 +16,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/rp_widget.h"
 #include "base/flags.h"
 #include "base/timer.h"
+#include "history/view/history_view_preload_predictor.h"
 
 struct FileLoadResult;
 struct FileMediaInformation;
@@ -604,6 +605,12 @@ private:
 	bool messagesFailed(const RPCError &error, mtpRequestId requestId);
 	void addMessagesToFront(PeerData *peer, const QVector<MTPMessage> &messages);
 	void addMessagesToBack(PeerData *peer, const QVector<MTPMessage> &messages);
+	void preloadThumbnails(
+		not_null<PeerData*> peer,
+		const QVector<MTPMessage> &messages);
+	void cachedSliceReceived(
+		not_null<History*> history,
+		const std::optional<MTPmessages_Messages> &slice);
 
 	struct BotCallbackInfo {
 		UserData *bot;
@@ -632,6 +639,8 @@ private:
 
 	// Does any of the shown histories has this flag set.
 	bool hasPendingResizedItems() const;
+	bool hasDeferredResizedItems() const;
+	void resizeDeferredItems();
 
 	// Counts scrollTop for placing the scroll right at the unread
 	// messages bar, choosing from _history and _migrated unreadBar.
@@ -694,8 +703,12 @@ private:
 	MsgId _showAtMsgId = ShowAtUnreadMsgId;
 
 	mtpRequestId _firstLoadRequest = 0;
+	bool _firstLoadFromEnd = false;
+	mtpRequestId _cachedSliceReconcileRequest = 0;
+	std::vector<MsgId> _cachedSliceIds;
 	mtpRequestId _preloadRequest = 0;
 	mtpRequestId _preloadDownRequest = 0;
+	HistoryView::PreloadPredictor _preloadPredictor;
 
 	MsgId _delayedShowAtMsgId = -1;
 	mtpRequestId _delayedShowAtRequest = 0;
@@ -822,6 +835,7 @@ private:
 
 	QMap<QPair<not_null<History*>, SendAction::Type>, mtpRequestId> _sendActionRequests;
 	base::Timer _sendActionStopTimer;
+	base::Timer _resizeDeferredTimer;
 
 	crl::time _saveDraftStart = 0;
 	bool _saveDraftText = false;
@@ -222,6 +222,8 @@ public:
 
 	virtual void unloadHeavyPart() {
 	}
+	virtual void setHeavyPartVisible(bool visible) {
+	}
 
 	// Should be called only by Data::Session.
 	virtual void updateSharedContactUserId(UserId userId) {
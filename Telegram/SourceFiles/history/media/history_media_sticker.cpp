@@ -105,6 +105,8 @@ void HistorySticker::setupLottie() {
 		: Lottie::FromData(_data->data());
 	_parent->data()->history()->owner().registerHeavyViewPart(_parent);
 
+	// There may be many stickers in a chat, the media viewer goes first.
+	_lottie->setPriority(Lottie::Priority::Low);
 	_lottie->updates(
 	) | rpl::start_with_next_error([=](Lottie::Update update) {
 		update.data.match([&](const Lottie::Information &information) {
@@ -116,6 +118,12 @@ void HistorySticker::setupLottie() {
 	}, _lifetime);
 }
 
+void HistorySticker::setHeavyPartVisible(bool visible) {
+	if (_lottie) {
+		_lottie->setVisible(visible);
+	}
+}
+
 void HistorySticker::unloadLottie() {
 	if (!_lottie) {
 		return;
@@ -192,6 +200,7 @@ void HistorySticker::draw(Painter &p, const QRect &r, TextSelection selection, c
 			request.colored = st::msgStickerOverlay->c;
 		}
 		const auto paused = App::wnd()->controller()->isGifPausedAtLeastFor(Window::GifPauseReason::Any);
+		_lottie->setVisible(true);
 		if (!paused) {
 			_lottie->markFrameShown();
 		}
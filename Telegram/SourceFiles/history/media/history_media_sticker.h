@@ -58,6 +58,7 @@ public:
 	void unloadHeavyPart() override {
 		unloadLottie();
 	}
+	void setHeavyPartVisible(bool visible) override;
 
 private:
 	QSize countOptimalSize() override;
@@ -161,7 +161,7 @@ QSize HistoryWebPage::countOptimalSize() {
 			_asArticle = true;
 		}
 		if (_asArticle
-			&& _data->description.text.isEmpty()
+			&& _data->descriptionText().isEmpty()
 			&& title.isEmpty()
 			&& _data->siteName.isEmpty()) {
 			_asArticle = false;
@@ -183,8 +183,8 @@ QSize HistoryWebPage::countOptimalSize() {
 	auto textFloatsAroundInfo = !_asArticle && !_attach && isBubbleBottom();
 
 	// init strings
-	if (_description.isEmpty() && !_data->description.text.isEmpty()) {
-		auto text = _data->description;
+	if (_description.isEmpty() && !_data->descriptionText().isEmpty()) {
+		auto text = _data->description();
 
 		if (textFloatsAroundInfo) {
 			text.text += _parent->skipBlock();
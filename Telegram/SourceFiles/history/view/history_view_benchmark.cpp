@@ -0,0 +1,569 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "history/view/history_view_benchmark.h"
+
+#include "history/view/history_view_element.h"
+#include "history/admin_log/history_admin_log_item.h"
+#include "history/history.h"
+#include "history/history_message.h"
+#include "data/data_session.h"
+#include "data/data_photo.h"
+#include "data/data_document.h"
+#include "ui/image/image.h"
+#include "auth_session.h"
+
+#include <chrono>
+#include <random>
+
+namespace HistoryView {
+namespace {
+
+constexpr auto kSeed = 20190101U;
+constexpr auto kSamplesOfKind = 32;
+constexpr auto kRepeats = 5;
+constexpr auto kAlbumSize = 4;
+constexpr auto kStickerSize = 256;
+constexpr auto kFirstPhotoId = PhotoId(0x7FFF'0000'0000'0000ULL);
+constexpr auto kStickerId = DocumentId(0x7FFF'0000'0000'0000ULL);
+constexpr auto kWidths = std::array<int, 4>{ { 320, 480, 640, 960 } };
+
+using Clock = std::chrono::steady_clock;
+using Nanoseconds = std::chrono::nanoseconds;
+
+enum class Kind {
+	Text,
+	Entities,
+	Emoji,
+	Reply,
+	Forward,
+	Photo,
+	Album,
+	Sticker,
+};
+
+const auto Kinds = {
+	Kind::Text,
+	Kind::Entities,
+	Kind::Emoji,
+	Kind::Reply,
+	Kind::Forward,
+	Kind::Photo,
+	Kind::Album,
+	Kind::Sticker,
+};
+
+QString KindName(Kind kind) {
+	switch (kind) {
+	case Kind::Text: return qsl("text");
+	case Kind::Entities: return qsl("entities");
+	case Kind::Emoji: return qsl("emoji");
+	case Kind::Reply: return qsl("reply");
+	case Kind::Forward: return qsl("forward");
+	case Kind::Photo: return qsl("photo");
+	case Kind::Album: return qsl("album");
+	case Kind::Sticker: return qsl("sticker");
+	}
+	Unexpected("Kind in HistoryView::KindName.");
+}
+
+// Photos of different aspect ratios, so that albums get different layouts.
+const auto PhotoSizes = {
+	QSize(800, 600),
+	QSize(600, 800),
+	QSize(800, 800),
+	QSize(1000, 500),
+};
+
+const auto Words = {
+	"lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing",
+	"elit", "sed", "do", "eiusmod", "tempor", "incididunt", "ut", "labore",
+	"et", "dolore", "magna", "aliqua", "enim", "ad", "minim", "veniam",
+	"quis", "nostrud", "exercitation", "ullamco", "laboris", "nisi",
+	"aliquip", "ex", "ea", "commodo", "consequat",
+};
+
+const auto Emoji = {
+	"\xF0\x9F\x98\x80", // grinning face
+	"\xF0\x9F\x91\x8D", // thumbs up
+	"\xE2\x9D\xA4\xEF\xB8\x8F", // red heart
+	"\xF0\x9F\x8E\x89", // party popper
+	"\xF0\x9F\x98\x82", // face with tears of joy
+	"\xF0\x9F\x91\x8D\xF0\x9F\x8F\xBD", // thumbs up, medium skin tone
+};
+
+struct Costs {
+	Nanoseconds create = Nanoseconds(0);
+	Nanoseconds layout = Nanoseconds(0);
+	std::array<Nanoseconds, kWidths.size()> resize = { {} };
+	std::array<Nanoseconds, kWidths.size()> paint = { {} };
+	int count = 0;
+};
+
+struct Sample {
+	std::vector<AdminLog::OwnedItem> owned;
+	Element *view = nullptr;
+};
+
+template <typename Method>
+Nanoseconds Measure(Method &&method) {
+	const auto start = Clock::now();
+	method();
+	return std::chrono::duration_cast<Nanoseconds>(Clock::now() - start);
+}
+
+QString Microseconds(Nanoseconds total, int count) {
+	return QString::number(total.count() / (1000. * count), 'f', 1);
+}
+
+QImage GeneratePhoto(QSize size, int index) {
+	auto result = QImage(size, QImage::Format_ARGB32_Premultiplied);
+	result.fill(QColor::fromHsv((index * 67) % 360, 160, 200));
+	return result;
+}
+
+class Delegate final : public SimpleElementDelegate {
+public:
+	Context elementContext() override {
+		return Context::History;
+	}
+
+};
+
+class Generator final {
+public:
+	Generator(
+		not_null<History*> history,
+		not_null<ElementDelegate*> delegate);
+
+	[[nodiscard]] Sample generate(Kind kind);
+
+private:
+	[[nodiscard]] MsgId nextId();
+	[[nodiscard]] bool nextOut();
+	[[nodiscard]] UserId from(bool out) const;
+	[[nodiscard]] int random(int from, int till);
+	[[nodiscard]] QString words(int from, int till);
+	[[nodiscard]] TextWithEntities text(int from, int till);
+	[[nodiscard]] TextWithEntities entities();
+	[[nodiscard]] TextWithEntities emoji();
+
+	[[nodiscard]] not_null<HistoryMessage*> makeText(
+		const TextWithEntities &text,
+		MsgId replyTo = 0);
+	[[nodiscard]] not_null<HistoryMessage*> makeForward(
+		not_null<HistoryMessage*> original);
+	[[nodiscard]] not_null<HistoryMessage*> makePhoto(
+		not_null<PhotoData*> photo,
+		const TextWithEntities &caption,
+		MessageGroupId groupId = MessageGroupId());
+	[[nodiscard]] not_null<HistoryMessage*> makeSticker();
+
+	[[nodiscard]] Sample single(not_null<HistoryItem*> item);
+	[[nodiscard]] Sample album();
+
+	void preparePhotos();
+	void prepareSticker();
+	void prepareOriginals();
+
+	const not_null<History*> _history;
+	const not_null<ElementDelegate*> _delegate;
+	std::mt19937 _engine;
+	std::vector<not_null<PhotoData*>> _photos;
+	DocumentData *_sticker = nullptr;
+	std::vector<AdminLog::OwnedItem> _originals;
+	uint64 _groupId = 0;
+
+};
+
+Generator::Generator(
+	not_null<History*> history,
+	not_null<ElementDelegate*> delegate)
+: _history(history)
+, _delegate(delegate)
+, _engine(kSeed) {
+	preparePhotos();
+	prepareSticker();
+	prepareOriginals();
+}
+
+void Generator::preparePhotos() {
+	auto index = 0;
+	for (const auto size : PhotoSizes) {
+		const auto small = size.scaled(
+			QSize(100, 100),
+			Qt::KeepAspectRatio);
+		const auto medium = size.scaled(
+			QSize(320, 320),
+			Qt::KeepAspectRatio);
+		_photos.push_back(_history->owner().photo(
+			kFirstPhotoId + index,
+			0,
+			QByteArray(),
+			unixtime(),
+			0,
+			false,
+			ImagePtr(),
+			Images::Create(GeneratePhoto(small, index), "JPG"),
+			Images::Create(GeneratePhoto(medium, index), "JPG"),
+			Images::Create(GeneratePhoto(size, index), "JPG")));
+		++index;
+	}
+}
+
+void Generator::prepareSticker() {
+	auto bytes = QByteArray();
+	auto buffer = QBuffer(&bytes);
+	GeneratePhoto(QSize(kStickerSize, kStickerSize), 0).save(&buffer, "PNG");
+
+	auto attributes = QVector<MTPDocumentAttribute>();
+	attributes.push_back(MTP_documentAttributeImageSize(
+		MTP_int(kStickerSize),
+		MTP_int(kStickerSize)));
+	attributes.push_back(MTP_documentAttributeSticker(
+		MTP_flags(0),
+		MTP_string(QString()),
+		MTP_inputStickerSetEmpty(),
+		MTPMaskCoords()));
+	_sticker = _history->owner().document(
+		kStickerId,
+		0,
+		QByteArray(),
+		unixtime(),
+		attributes,
+		qsl("image/webp"),
+		ImagePtr(),
+		ImagePtr(),
+		0,
+		bytes.size(),
+		StorageImageLocation());
+
+	// Mark it loaded, so that painting doesn't start a download.
+	_sticker->setData(bytes);
+}
+
+void Generator::prepareOriginals() {
+	_originals.reserve(kSamplesOfKind);
+	for (auto i = 0; i != kSamplesOfKind; ++i) {
+		_originals.emplace_back(_delegate, makeText(text(3, 40)));
+	}
+}
+
+MsgId Generator::nextId() {
+	static auto id = ServerMaxMsgId + (ServerMaxMsgId / 4);
+	return ++id;
+}
+
+bool Generator::nextOut() {
+	return (random(0, 1) == 1);
+}
+
+UserId Generator::from(bool out) const {
+	return out
+		? _history->session().userId()
+		: peerToUser(_history->peer->id);
+}
+
+int Generator::random(int from, int till) {
+	return std::uniform_int_distribution<int>(from, till)(_engine);
+}
+
+QString Generator::words(int from, int till) {
+	const auto count = random(from, till);
+	auto result = QString();
+	for (auto i = 0; i != count; ++i) {
+		if (i) {
+			result.append(' ');
+		}
+		result.append(QLatin1String(
+			*(begin(Words) + random(0, int(Words.size()) - 1))));
+	}
+	return result;
+}
+
+TextWithEntities Generator::text(int from, int till) {
+	return { words(from, till) };
+}
+
+TextWithEntities Generator::entities() {
+	const auto types = {
+		EntityType::Bold,
+		EntityType::Italic,
+		EntityType::Code,
+		EntityType::Url,
+	};
+	auto result = TextWithEntities();
+	const auto count = random(2, 8);
+	for (auto i = 0; i != count; ++i) {
+		result.text.append(words(1, 5)).append(' ');
+		const auto type = *(begin(types) + random(0, 3));
+		const auto part = (type == EntityType::Url)
+			? qsl("https://telegram.org/")
+			: words(1, 3);
+		result.entities.push_back(
+			EntityInText(type, result.text.size(), part.size()));
+		result.text.append(part).append(' ');
+	}
+	result.text.append(words(1, 5));
+	return result;
+}
+
+TextWithEntities Generator::emoji() {
+	auto result = TextWithEntities();
+	const auto count = random(2, 10);
+	for (auto i = 0; i != count; ++i) {
+		result.text.append(words(0, 4)).append(' ');
+		result.text.append(QString::fromUtf8(
+			*(begin(Emoji) + random(0, int(Emoji.size()) - 1))));
+		result.text.append(' ');
+	}
+	return result;
+}
+
+not_null<HistoryMessage*> Generator::makeText(
+		const TextWithEntities &text,
+		MsgId replyTo) {
+	using Flag = MTPDmessage::Flag;
+	const auto out = nextOut();
+	const auto flags = Flag::f_entities
+		| Flag::f_from_id
+		| (out ? Flag::f_out : Flag(0))
+		| (replyTo ? Flag::f_reply_to_msg_id : Flag(0));
+	const auto viaBotId = UserId(0);
+	return _history->owner().makeMessage(
+		_history,
+		nextId(),
+		flags,
+		replyTo,
+		viaBotId,
+		unixtime(),
+		from(out),
+		QString(),
+		text);
+}
+
+not_null<HistoryMessage*> Generator::makeForward(
+		not_null<HistoryMessage*> original) {
+	using Flag = MTPDmessage::Flag;
+	const auto out = nextOut();
+	const auto flags = Flag::f_from_id | (out ? Flag::f_out : Flag(0));
+	return _history->owner().makeMessage(
+		_history,
+		nextId(),
+		flags,
+		unixtime(),
+		from(out),
+		QString(),
+		original);
+}
+
+not_null<HistoryMessage*> Generator::makePhoto(
+		not_null<PhotoData*> photo,
+		const TextWithEntities &caption,
+		MessageGroupId groupId) {
+	using Flag = MTPDmessage::Flag;
+	const auto out = nextOut();
+	const auto flags = Flag::f_from_id
+		| Flag::f_media
+		| (out ? Flag::f_out : Flag(0));
+	if (!groupId) {
+		const auto replyTo = MsgId(0);
+		const auto viaBotId = UserId(0);
+		return _history->owner().makeMessage(
+			_history,
+			nextId(),
+			flags | Flag::f_entities,
+			replyTo,
+			viaBotId,
+			unixtime(),
+			from(out),
+			QString(),
+			photo,
+			caption,
+			MTPReplyMarkup());
+	}
+
+	// Only messages received from the server can be grouped. The photo
+	// is sent without sizes, so that the generated images are kept.
+	const auto media = MTP_messageMediaPhoto(
+		MTP_flags(MTPDmessageMediaPhoto::Flag::f_photo),
+		MTP_photo(
+			MTP_flags(0),
+			MTP_long(photo->id),
+			MTP_long(0),
+			MTP_bytes(QByteArray()),
+			MTP_int(unixtime()),
+			MTP_vector<MTPPhotoSize>(),
+			MTP_int(0)),
+		MTPint());
+	const auto message = MTP_message(
+		MTP_flags(flags | Flag::f_grouped_id),
+		MTP_int(nextId()),
+		MTP_int(from(out)),
+		peerToMTP(_history->peer->id),
+		MTPMessageFwdHeader(),
+		MTPint(),
+		MTPint(),
+		MTP_int(unixtime()),
+		MTP_string(caption.text),
+		media,
+		MTPReplyMarkup(),
+		MTPVector<MTPMessageEntity>(),
+		MTPint(),
+		MTPint(),
+		MTPstring(),
+		MTP_long(groupId.raw()));
+	return _history->owner().makeMessage(_history, message.c_message());
+}
+
+not_null<HistoryMessage*> Generator::makeSticker() {
+	using Flag = MTPDmessage::Flag;
+	const auto out = nextOut();
+	const auto flags = Flag::f_from_id
+		| Flag::f_media
+		| (out ? Flag::f_out : Flag(0));
+	const auto replyTo = MsgId(0);
+	const auto viaBotId = UserId(0);
+	return _history->owner().makeMessage(
+		_history,
+		nextId(),
+		flags,
+		replyTo,
+		viaBotId,
+		unixtime(),
+		from(out),
+		QString(),
+		_sticker,
+		TextWithEntities(),
+		MTPReplyMarkup());
+}
+
+Sample Generator::single(not_null<HistoryItem*> item) {
+	auto result = Sample();
+	result.owned.emplace_back(_delegate, item);
+	result.view = result.owned.back().get();
+	return result;
+}
+
+Sample Generator::album() {
+	const auto groupId = MessageGroupId::FromRaw(
+		_history->peer->id,
+		++_groupId);
+	auto items = std::vector<not_null<HistoryMessage*>>();
+	const auto offset = random(0, int(_photos.size()) - 1);
+	for (auto i = 0; i != kAlbumSize; ++i) {
+		const auto photo = _photos[(offset + i) % _photos.size()];
+		const auto caption = (i + 1 == kAlbumSize)
+			? text(0, 20)
+			: TextWithEntities();
+		items.push_back(makePhoto(photo, caption, groupId));
+	}
+
+	// All the items should be grouped before any view is created.
+	auto result = Sample();
+	for (const auto item : items) {
+		result.owned.emplace_back(_delegate, item);
+	}
+	result.view = result.owned.back().get();
+	return result;
+}
+
+Sample Generator::generate(Kind kind) {
+	const auto original = [&] {
+		const auto index = random(0, int(_originals.size()) - 1);
+		return _originals[index]->data()->toHistoryMessage();
+	};
+	switch (kind) {
+	case Kind::Text: return single(makeText(text(1, 100)));
+	case Kind::Entities: return single(makeText(entities()));
+	case Kind::Emoji: return single(makeText(emoji()));
+	case Kind::Reply:
+		return single(makeText(text(1, 40), original()->id));
+	case Kind::Forward: return single(makeForward(original()));
+	case Kind::Photo: return single(makePhoto(
+		_photos[random(0, int(_photos.size()) - 1)],
+		text(0, 20)));
+	case Kind::Album: return album();
+	case Kind::Sticker: return single(makeSticker());
+	}
+	Unexpected("Kind in Generator::generate.");
+}
+
+Costs MeasureKind(not_null<Generator*> generator, Kind kind) {
+	auto result = Costs();
+	for (auto repeat = 0; repeat != kRepeats; ++repeat) {
+		auto samples = std::vector<Sample>();
+		samples.reserve(kSamplesOfKind);
+		result.create += Measure([&] {
+			for (auto i = 0; i != kSamplesOfKind; ++i) {
+				samples.push_back(generator->generate(kind));
+			}
+		});
+		result.layout += Measure([&] {
+			for (const auto &sample : samples) {
+				sample.view->initDimensions();
+			}
+		});
+		for (auto i = 0; i != int(kWidths.size()); ++i) {
+			const auto width = kWidths[i];
+			auto height = 0;
+			result.resize[i] += Measure([&] {
+				for (const auto &sample : samples) {
+					accumulate_max(
+						height,
+						sample.view->resizeGetHeight(width));
+				}
+			});
+
+			const auto factor = cIntRetinaFactor();
+			auto image = QImage(
+				QSize(width, std::max(height, 1)) * factor,
+				QImage::Format_ARGB32_Premultiplied);
+			image.setDevicePixelRatio(cRetinaFactor());
+			image.fill(Qt::transparent);
+			Painter p(&image);
+			const auto ms = crl::now();
+			result.paint[i] += Measure([&] {
+				for (const auto &sample : samples) {
+					const auto view = sample.view;
+					const auto clip = QRect(0, 0, width, view->height());
+					view->draw(p, clip, TextSelection(), ms);
+				}
+			});
+		}
+		result.count += samples.size();
+	}
+	return result;
+}
+
+} // namespace
+
+QString RenderBenchmark(not_null<History*> history) {
+	auto delegate = Delegate();
+	auto generator = Generator(history, &delegate);
+
+	auto lines = QStringList();
+	auto header = qsl("kind, us per element: create, layout");
+	for (const auto width : kWidths) {
+		header += qsl(", resize %1, paint %1").arg(width);
+	}
+	lines.push_back(header);
+	for (const auto kind : Kinds) {
+		const auto costs = MeasureKind(&generator, kind);
+		auto line = KindName(kind)
+			+ ": " + Microseconds(costs.create, costs.count)
+			+ ", " + Microseconds(costs.layout, costs.count);
+		for (auto i = 0; i != int(kWidths.size()); ++i) {
+			line += ", " + Microseconds(costs.resize[i], costs.count)
+				+ ", " + Microseconds(costs.paint[i], costs.count);
+		}
+		lines.push_back(line);
+	}
+	return lines.join('\n');
+}
+
+} // namespace HistoryView
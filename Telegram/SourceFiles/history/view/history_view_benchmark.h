@@ -0,0 +1,21 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+class History;
+
+namespace HistoryView {
+
+// Fills the history with generated messages of each kind (plain text,
+// entities, emoji, replies, forwards, photos, albums, stickers) that are
+// never added to its blocks. Measures how long creating, laying out,
+// resizing and painting their views into an offscreen image takes at
+// several widths. The seed is fixed, so the reports can be compared.
+[[nodiscard]] QString RenderBenchmark(not_null<History*> history);
+
+} // namespace HistoryView
@@ -17,6 +17,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_session.h"
 #include "data/data_groups.h"
 #include "data/data_media_types.h"
+#include "base/memory_usage.h"
 #include "lang/lang_keys.h"
 #include "layout.h"
 #include "styles/style_history.h"
@@ -195,6 +196,9 @@ Element::Element(
 , _dateTime(ItemDateTime(data))
 , _context(delegate->elementContext()) {
 	history()->owner().registerItemView(this);
+	base::memory::Allocated(
+		base::memory::Tag::HistoryElements,
+		sizeof(Element));
 	refreshMedia();
 	if (_context == Context::History) {
 		history()->setHasPendingResizedItems();
@@ -281,6 +285,17 @@ bool Element::pendingResize() const {
 	return _flags & Flag::NeedsResize;
 }
 
+void Element::setResizeDeferred() {
+	_flags |= Flag::ResizeDeferred;
+	if (_context == Context::History) {
+		data()->_history->setHasDeferredResizedItems();
+	}
+}
+
+bool Element::resizeDeferred() const {
+	return _flags & Flag::ResizeDeferred;
+}
+
 bool Element::isAttachedToPrevious() const {
 	return _flags & Flag::AttachedToPrevious;
 }
@@ -462,6 +477,7 @@ QSize Element::countOptimalSize() {
 }
 
 QSize Element::countCurrentSize(int newWidth) {
+	_flags &= ~Flag::ResizeDeferred;
 	if (_flags & Flag::NeedsResize) {
 		_flags &= ~Flag::NeedsResize;
 		initDimensions();
@@ -574,6 +590,12 @@ void Element::unloadHeavyPart() {
 	}
 }
 
+void Element::setHeavyPartVisible(bool visible) {
+	if (_media) {
+		_media->setHeavyPartVisible(visible);
+	}
+}
+
 HistoryBlock *Element::block() {
 	return _block;
 }
@@ -707,6 +729,7 @@ Element::~Element() {
 		history()->owner().notifyViewRemoved(this);
 	}
 	history()->owner().unregisterItemView(this);
+	base::memory::Freed(base::memory::Tag::HistoryElements, sizeof(Element));
 }
 
 } // namespace HistoryView
@@ -137,6 +137,7 @@ public:
 		AttachedToPrevious = 0x02,
 		AttachedToNext     = 0x04,
 		HiddenByGroup      = 0x08,
+		ResizeDeferred     = 0x10,
 	};
 	using Flags = base::flags<Flag>;
 	friend inline constexpr auto is_flag_type(Flag) { return true; }
@@ -158,6 +159,11 @@ public:
 
 	void setPendingResize();
 	bool pendingResize() const;
+
+	// The current width changed, but the element is far from the viewport,
+	// so it keeps the old height until History::resizeDeferredItems().
+	void setResizeDeferred();
+	bool resizeDeferred() const;
 	bool isUnderCursor() const;
 
 	bool isAttachedToPrevious() const;
@@ -255,6 +261,7 @@ public:
 	virtual bool hasVisibleText() const;
 
 	virtual void unloadHeavyPart();
+	virtual void setHeavyPartVisible(bool visible);
 
 	// Legacy blocks structure.
 	HistoryBlock *block();
@@ -321,6 +321,7 @@ void ListWidget::refreshRows() {
 			_items.push_back(enforceViewForItem(item));
 		}
 	}
+	destroyViewsOutsideRows();
 	updateAroundPositionFromRows();
 
 	updateItemsGeometry();
@@ -330,6 +331,26 @@ void ListWidget::refreshRows() {
 	_delegate->listContentRefreshed();
 }
 
+// Only the rows of the current slice around the viewport keep views,
+// so scrolling through a long list doesn't accumulate views of all rows.
+void ListWidget::destroyViewsOutsideRows() {
+	if (_views.size() == _items.size()) {
+		return;
+	}
+	const auto rows = base::flat_set<not_null<const Element*>>(
+		begin(_items),
+		end(_items));
+	for (auto i = begin(_views); i != end(_views);) {
+		const auto view = i->second.get();
+		if (rows.contains(view)) {
+			++i;
+		} else {
+			viewReplaced(view, nullptr);
+			i = _views.erase(i);
+		}
+	}
+}
+
 std::optional<int> ListWidget::scrollTopForPosition(
 		Data::MessagePosition position) const {
 	if (position == Data::MaxMessagePosition) {
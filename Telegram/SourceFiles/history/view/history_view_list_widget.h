@@ -260,6 +260,7 @@ private:
 	void refreshViewer();
 	void updateAroundPositionFromRows();
 	void refreshRows();
+	void destroyViewsOutsideRows();
 	ScrollTopState countScrollState() const;
 	void saveScrollState();
 	void restoreScrollState();
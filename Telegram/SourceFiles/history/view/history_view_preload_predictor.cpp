@@ -0,0 +1,119 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "history/view/history_view_preload_predictor.h"
+
+namespace HistoryView {
+namespace {
+
+// At least three screens are preloaded, as before, at most twenty.
+constexpr auto kMinPreloadScreens = 3;
+constexpr auto kMaxPreloadScreens = 20;
+
+// The slice should arrive in half of the time to reach the edge.
+constexpr auto kLatencyReserve = 2.;
+
+// messages.getHistory doesn't return more than that.
+constexpr auto kMaxSliceSize = 100;
+
+// Scroll velocity is forgotten after a short pause.
+constexpr auto kVelocityTimeout = crl::time(300);
+constexpr auto kVelocitySmoothing = 0.3;
+constexpr auto kEstimateSmoothing = 0.25;
+
+constexpr auto kDefaultLatency = 500.;
+constexpr auto kDefaultMessageHeight = 60.;
+
+[[nodiscard]] int Index(PreloadPredictor::Direction direction) {
+	return (direction == PreloadPredictor::Direction::Up) ? 0 : 1;
+}
+
+[[nodiscard]] float64 Smooth(float64 was, float64 now, float64 smoothing) {
+	return (was > 0.) ? (was * (1. - smoothing) + now * smoothing) : now;
+}
+
+} // namespace
+
+void PreloadPredictor::reset() {
+	_lastTop = 0;
+	_lastScrolled = 0;
+	_velocity = 0.;
+	_sentAt = { { 0, 0 } };
+}
+
+void PreloadPredictor::scrolled(int top) {
+	const auto now = crl::now();
+	const auto elapsed = now - _lastScrolled;
+	if (_lastScrolled && elapsed > 0 && elapsed < kVelocityTimeout) {
+		const auto velocity = float64(top - _lastTop) / elapsed;
+		_velocity = _velocity * (1. - kVelocitySmoothing)
+			+ velocity * kVelocitySmoothing;
+	} else {
+		_velocity = 0.;
+	}
+	_lastTop = top;
+	_lastScrolled = now;
+}
+
+void PreloadPredictor::requestSent(Direction direction) {
+	_sentAt[Index(direction)] = crl::now();
+}
+
+void PreloadPredictor::requestDone(Direction direction) {
+	if (const auto sent = base::take(_sentAt[Index(direction)])) {
+		_latency = Smooth(
+			_latency,
+			float64(crl::now() - sent),
+			kEstimateSmoothing);
+	}
+}
+
+void PreloadPredictor::sliceAdded(Direction direction, int height, int count) {
+	if (height <= 0 || count <= 0) {
+		return;
+	}
+	if (direction == Direction::Up) {
+		_lastTop += height;
+	}
+	_messageHeight = Smooth(
+		_messageHeight,
+		float64(height) / count,
+		kEstimateSmoothing);
+}
+
+float64 PreloadPredictor::speed(Direction direction) const {
+	if (!_lastScrolled || crl::now() - _lastScrolled >= kVelocityTimeout) {
+		return 0.;
+	}
+	const auto velocity = (direction == Direction::Down)
+		? _velocity
+		: -_velocity;
+	return std::max(velocity, 0.);
+}
+
+int PreloadPredictor::distance(Direction direction, int viewport) const {
+	const auto latency = (_latency > 0.) ? _latency : kDefaultLatency;
+	const auto predicted = speed(direction) * latency * kLatencyReserve;
+	return std::clamp(
+		int(std::ceil(predicted)),
+		kMinPreloadScreens * viewport,
+		kMaxPreloadScreens * viewport);
+}
+
+int PreloadPredictor::sliceSize(Direction direction, int minimal) const {
+	const auto latency = (_latency > 0.) ? _latency : kDefaultLatency;
+	const auto height = (_messageHeight > 0.)
+		? _messageHeight
+		: kDefaultMessageHeight;
+	const auto pixels = speed(direction) * latency * kLatencyReserve;
+	return std::clamp(
+		int(std::ceil(pixels / height)),
+		minimal,
+		std::max(minimal, kMaxSliceSize));
+}
+
+} // namespace HistoryView
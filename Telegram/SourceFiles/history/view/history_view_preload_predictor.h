@@ -0,0 +1,47 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace HistoryView {
+
+// Chooses how early the next slice of messages should be requested and
+// how many messages it should have, so that the slice arrives before
+// the scroll reaches the edge even if the list is flicked fast.
+class PreloadPredictor final {
+public:
+	enum class Direction {
+		Up,
+		Down,
+	};
+
+	// Forgets the scroll state, keeps the latency and height estimates.
+	void reset();
+
+	void scrolled(int top);
+	void requestSent(Direction direction);
+	void requestDone(Direction direction);
+
+	// Slices added above the viewport shift the scroll top by their height.
+	void sliceAdded(Direction direction, int height, int count);
+
+	[[nodiscard]] int distance(Direction direction, int viewport) const;
+	[[nodiscard]] int sliceSize(Direction direction, int minimal) const;
+
+private:
+	[[nodiscard]] float64 speed(Direction direction) const;
+
+	int _lastTop = 0;
+	crl::time _lastScrolled = 0;
+	float64 _velocity = 0.;
+	std::array<crl::time, 2> _sentAt = { { 0, 0 } };
+	float64 _latency = 0.;
+	float64 _messageHeight = 0.;
+
+};
+
+} // namespace HistoryView
@@ -29,6 +29,14 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace InlineBots {
 namespace Layout {
 namespace internal {
+namespace {
+
+// Gif layouts with clip readers in all the panels, the least recently
+// painted first. Others show thumbnails until they get a free slot.
+constexpr auto kPlayingGifsLimit = 12;
+std::vector<not_null<Gif*>> PlayingGifs;
+
+} // namespace
 
 using TextState = HistoryView::TextState;
 
@@ -40,13 +48,6 @@ FileBase::FileBase(not_null<Context*> context, DocumentData *document)
 : ItemBase(context, document) {
 }
 
-DocumentData *FileBase::getShownDocument() const {
-	if (const auto result = getDocument()) {
-		return result;
-	}
-	return getResultDocument();
-}
-
 int FileBase::content_width() const {
 	if (const auto document = getShownDocument()) {
 		if (document->dimensions.width() > 0) {
@@ -98,6 +99,10 @@ Gif::Gif(not_null<Context*> context, DocumentData *document, bool hasDeleteButto
 	}
 }
 
+Gif::~Gif() {
+	releasePlaying();
+}
+
 void Gif::initDimensions() {
 	int32 w = content_width(), h = content_height();
 	if (w <= 0 || h <= 0) {
@@ -113,6 +118,44 @@ void Gif::setPosition(int32 position) {
 	ItemBase::setPosition(position);
 	if (_position < 0) {
 		_gif.reset();
+		releasePlaying();
+	}
+}
+
+bool Gif::acquirePlaying() {
+	const auto i = ranges::find(PlayingGifs, this);
+	if (i != end(PlayingGifs)) {
+		std::rotate(i, i + 1, end(PlayingGifs));
+		return true;
+	} else if (int(PlayingGifs.size()) >= kPlayingGifsLimit) {
+		// A hidden gif gives its slot to anyone, a visible one only to
+		// the gif under the cursor.
+		const auto over = (_state & StateFlag::Over);
+		const auto j = ranges::find_if(PlayingGifs, [&](not_null<Gif*> gif) {
+			return !gif->context()->inlineItemVisible(gif)
+				|| (over && !(gif->_state & StateFlag::Over));
+		});
+		if (j == end(PlayingGifs)) {
+			return false;
+		}
+		(*j)->stopPlaying();
+	}
+	PlayingGifs.push_back(this);
+	return true;
+}
+
+void Gif::releasePlaying() {
+	PlayingGifs.erase(
+		ranges::remove(PlayingGifs, this),
+		end(PlayingGifs));
+}
+
+void Gif::stopPlaying() {
+	releasePlaying();
+	if (_gif) {
+		_gif.reset();
+		getShownDocument()->unload();
+		update();
 	}
 }
 
@@ -138,12 +181,16 @@ void Gif::paint(Painter &p, const QRect &clip, const PaintContext *context) cons
 	document->automaticLoad(fileOrigin(), nullptr);
 
 	bool loaded = document->loaded(), loading = document->loading(), displayLoading = document->displayLoading();
-	if (loaded && !_gif && !_gif.isBad()) {
-		auto that = const_cast<Gif*>(this);
+	auto that = const_cast<Gif*>(this);
+	if (loaded && !_gif.isBad() && that->acquirePlaying() && !_gif) {
 		that->_gif = Media::Clip::MakeReader(document, FullMsgId(), [that](Media::Clip::Notification notification) {
 			that->clipCallback(notification);
 		});
-		if (_gif) _gif->setAutoplay();
+		if (_gif) {
+			_gif->setAutoplay();
+		} else {
+			that->releasePlaying();
+		}
 	}
 
 	const auto animating = (_gif && _gif->started());
@@ -361,6 +408,7 @@ void Gif::clipCallback(Media::Clip::Notification notification) {
 		if (_gif) {
 			if (_gif->state() == State::Error) {
 				_gif.setBad();
+				releasePlaying();
 				getShownDocument()->unload();
 			} else if (_gif->ready() && !_gif->started()) {
 				auto height = st::inlineMediaHeight;
@@ -368,6 +416,7 @@ void Gif::clipCallback(Media::Clip::Notification notification) {
 				_gif->start(frame.width(), frame.height(), _width, height, ImageRoundRadius::None, RectPart::None);
 			} else if (_gif->autoPausedGif() && !context()->inlineItemVisible(this)) {
 				_gif.reset();
+				releasePlaying();
 				getShownDocument()->unload();
 			}
 		}
@@ -24,8 +24,6 @@ public:
 	FileBase(not_null<Context*> context, DocumentData *doc);
 
 protected:
-	DocumentData *getShownDocument() const;
-
 	int content_width() const;
 	int content_height() const;
 	int content_duration() const;
@@ -49,6 +47,7 @@ class Gif : public FileBase {
 public:
 	Gif(not_null<Context*> context, Result *result);
 	Gif(not_null<Context*> context, DocumentData *doc, bool hasDeleteButton);
+	~Gif();
 
 	void setPosition(int32 position) override;
 	void initDimensions() override;
@@ -73,6 +72,10 @@ public:
 private:
 	QSize countFrameSize() const;
 
+	bool acquirePlaying();
+	void releasePlaying();
+	void stopPlaying();
+
 	enum class StateFlag {
 		Over       = (1 << 0),
 		DeleteOver = (1 << 1),
@@ -46,6 +46,13 @@ PhotoData *ItemBase::getPhoto() const {
 	return _photo;
 }
 
+DocumentData *ItemBase::getShownDocument() const {
+	if (const auto result = getDocument()) {
+		return result;
+	}
+	return getResultDocument();
+}
+
 DocumentData *ItemBase::getPreviewDocument() const {
 	auto previewDocument = [this]() -> DocumentData* {
 		if (_doc) {
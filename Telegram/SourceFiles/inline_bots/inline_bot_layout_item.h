@@ -71,6 +71,9 @@ public:
 	DocumentData *getDocument() const;
 	PhotoData *getPhoto() const;
 
+	// Saved gif document or the document of the result, if any.
+	DocumentData *getShownDocument() const;
+
 	// Get document or photo (possibly from InlineBots::Result) for
 	// showing sticker / GIF / photo preview by long mouse press.
 	DocumentData *getPreviewDocument() const;
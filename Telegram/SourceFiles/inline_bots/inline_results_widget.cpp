@@ -78,6 +78,7 @@ void Inner::visibleTopBottomUpdated(
 		_visibleTop = visibleTop;
 		_lastScrolled = crl::now();
 	}
+	preloadImages();
 }
 
 void Inner::checkRestrictedPeer() {
@@ -291,7 +292,6 @@ bool Inner::inlineRowsAddItem(Result *result, Row &row, int32 &sumWidth) {
 	auto layout = layoutPrepareInlineResult(result, (_rows.size() * MatrixRowShift) + row.items.size());
 	if (!layout) return false;
 
-	layout->preload();
 	if (inlineRowFinalize(row, sumWidth, layout->isFullLine())) {
 		layout->setPosition(_rows.size() * MatrixRowShift);
 	}
@@ -404,9 +404,44 @@ Inner::Row &Inner::layoutInlineRow(Row &row, int32 sumWidth) {
 }
 
 void Inner::preloadImages() {
-	for (auto row = 0, rows = _rows.size(); row != rows; ++row) {
-		for (auto col = 0, cols = _rows[row].items.size(); col != cols; ++col) {
-			_rows[row].items[col]->preload();
+	// Thumbnails are loaded for the visible rows and one screen around.
+	const auto visibleHeight = _visibleBottom - _visibleTop;
+	const auto preloadTop = _visibleTop - visibleHeight;
+	const auto preloadBottom = _visibleBottom + visibleHeight;
+	auto top = st::stickerPanPadding;
+	if (_switchPmButton) {
+		top += _switchPmButton->height() + st::inlineResultsSkip;
+	}
+	for_const (auto &row, _rows) {
+		if (top >= preloadBottom) {
+			break;
+		} else if (top + row.height > preloadTop) {
+			for_const (auto &item, row.items) {
+				item->preload();
+			}
+		}
+		top += row.height;
+	}
+}
+
+// Results of the previous queries are not shown anymore,
+// so their gif downloads are not needed, unless shown again.
+void Inner::cancelUnusedLoads() {
+	auto used = base::flat_set<not_null<DocumentData*>>();
+	for_const (auto &row, _rows) {
+		for_const (auto &item, row.items) {
+			if (const auto document = item->getShownDocument()) {
+				used.emplace(document);
+			}
+		}
+	}
+	for (const auto &[result, layout] : _inlineLayouts) {
+		if (layout->position() >= 0) {
+			continue;
+		} else if (const auto document = layout->getShownDocument()) {
+			if (document->loading() && !used.contains(document)) {
+				document->cancel();
+			}
 		}
 	}
 }
@@ -485,6 +520,7 @@ int Inner::refreshInlineRows(PeerData *queryPeer, UserData *bot, const CacheEntr
 		}
 		inlineRowFinalize(row, sumWidth, true);
 	}
+	cancelUnusedLoads();
 
 	auto h = countHeight();
 	if (h != height()) resize(width(), h);
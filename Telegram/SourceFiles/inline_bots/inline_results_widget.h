@@ -124,6 +124,7 @@ private:
 
 	Row &layoutInlineRow(Row &row, int32 sumWidth = 0);
 	void deleteUnusedInlineLayouts();
+	void cancelUnusedLoads();
 
 	int validateExistingInlineRows(const Results &results);
 	void selectInlineResult(int row, int column);
@@ -207,6 +207,49 @@ void ParseKeyValue(
 	}
 }
 
+using ParsedValues = std::vector<std::pair<LangKey, QString>>;
+
+// Parsed values are written after the raw ones, so that the app of the
+// same version can skip ValueParser when it reads the cached langpack.
+ParsedValues ParseValues(const std::map<QByteArray, QByteArray> &values) {
+	auto result = ParsedValues();
+	result.reserve(values.size());
+	for (const auto &[key, value] : values) {
+		ParseKeyValue(key, value, [&](LangKey index, QString &&value) {
+			result.emplace_back(index, std::move(value));
+		});
+	}
+	return result;
+}
+
+std::optional<ParsedValues> ReadParsedValues(
+		QDataStream &stream,
+		int valuesCount) {
+	auto keysCount = qint32();
+	auto count = qint32();
+	stream >> keysCount >> count;
+	if (stream.status() != QDataStream::Ok
+		|| keysCount != kLangKeysCount
+		|| count < 0
+		|| count > valuesCount) {
+		return std::nullopt;
+	}
+	auto result = ParsedValues();
+	result.reserve(count);
+	for (auto i = 0; i != count; ++i) {
+		auto index = qint32();
+		auto value = QString();
+		stream >> index >> value;
+		if (stream.status() != QDataStream::Ok
+			|| index < 0
+			|| index >= kLangKeysCount) {
+			return std::nullopt;
+		}
+		result.emplace_back(LangKey(index), std::move(value));
+	}
+	return result;
+}
+
 } // namespace
 
 QString DefaultLanguageId() {
@@ -387,6 +430,12 @@ QByteArray Instance::serialize() const {
 	}
 	const auto base = _base ? _base->serialize() : QByteArray();
 	size += Serialize::bytearraySize(base);
+	const auto parsed = ParseValues(_nonDefaultValues);
+	size += sizeof(qint32) // kLangKeysCount
+		+ sizeof(qint32); // parsed.size()
+	for (const auto &[index, value] : parsed) {
+		size += sizeof(qint32) + Serialize::stringSize(value);
+	}
 
 	auto result = QByteArray();
 	result.reserve(size);
@@ -408,7 +457,13 @@ QByteArray Instance::serialize() const {
 		for (const auto &nonDefault : _nonDefaultValues) {
 			stream << nonDefault.first << nonDefault.second;
 		}
-		stream << base;
+		stream
+			<< base
+			<< qint32(kLangKeysCount)
+			<< qint32(parsed.size());
+		for (const auto &[index, value] : parsed) {
+			stream << qint32(index) << value;
+		}
 	}
 	return result;
 }
@@ -516,6 +571,10 @@ void Instance::fillFromSerialized(
 	} else {
 		stream >> base;
 	}
+	auto parsed = std::optional<ParsedValues>();
+	if (!legacyFormat && !stream.atEnd() && dataAppVersion == AppVersion) {
+		parsed = ReadParsedValues(stream, nonDefaultValuesCount);
+	}
 	if (!base.isEmpty()) {
 		_base = std::make_unique<Instance>(this, PrivateTag{});
 		_base->fillFromSerialized(base, dataAppVersion);
@@ -533,9 +592,20 @@ void Instance::fillFromSerialized(
 	_customFilePathAbsolute = customFilePathAbsolute;
 	_customFilePathRelative = customFilePathRelative;
 	_customFileContent = customFileContent;
-	LOG(("Lang Info: Loaded cached, keys: %1").arg(nonDefaultValuesCount));
+	LOG(("Lang Info: Loaded cached, keys: %1, parsed: %2"
+		).arg(nonDefaultValuesCount
+		).arg(Logs::b(parsed.has_value())));
 	for (auto i = 0, count = nonDefaultValuesCount * 2; i != count; i += 2) {
-		applyValue(nonDefaultStrings[i], nonDefaultStrings[i + 1]);
+		if (parsed) {
+			_nonDefaultValues[nonDefaultStrings[i]] = nonDefaultStrings[i + 1];
+		} else {
+			applyValue(nonDefaultStrings[i], nonDefaultStrings[i + 1]);
+		}
+	}
+	if (parsed) {
+		for (auto &[index, value] : *parsed) {
+			applyParsedValue(index, std::move(value));
+		}
 	}
 	updatePluralRules();
 }
@@ -693,14 +763,27 @@ void Instance::applyDifferenceToMe(
 	Expects(difference.vfrom_version.v <= _version);
 
 	_version = difference.vversion.v;
+
+	// Most differences don't change anything for the desktop keys,
+	// a full retranslate is requested only if some value has changed.
+	auto changed = false;
 	for (const auto &string : difference.vstrings.v) {
 		HandleString(string, [&](auto &&key, auto &&value) {
-			applyValue(key, value);
+			const auto i = _nonDefaultValues.find(key);
+			if (i == end(_nonDefaultValues) || i->second != value) {
+				applyValue(key, value);
+				changed = true;
+			}
 		}, [&](auto &&key) {
-			resetValue(key);
+			if (_nonDefaultValues.find(key) != end(_nonDefaultValues)) {
+				resetValue(key);
+				changed = true;
+			}
 		});
 	}
-	if (!_derived) {
+	if (!changed) {
+		return;
+	} else if (!_derived) {
 		_updated.notify();
 	} else {
 		_derived->_updated.notify();
@@ -737,15 +820,19 @@ QString Instance::getNonDefaultValue(const QByteArray &key) const {
 void Instance::applyValue(const QByteArray &key, const QByteArray &value) {
 	_nonDefaultValues[key] = value;
 	ParseKeyValue(key, value, [&](LangKey key, QString &&value) {
-		_nonDefaultSet[key] = 1;
-		if (!_derived) {
-			_values[key] = std::move(value);
-		} else if (!_derived->_nonDefaultSet[key]) {
-			_derived->_values[key] = std::move(value);
-		}
+		applyParsedValue(key, std::move(value));
 	});
 }
 
+void Instance::applyParsedValue(LangKey key, QString &&value) {
+	_nonDefaultSet[key] = 1;
+	if (!_derived) {
+		_values[key] = std::move(value);
+	} else if (!_derived->_nonDefaultSet[key]) {
+		_derived->_values[key] = std::move(value);
+	}
+}
+
 void Instance::updatePluralRules() {
 	if (_pluralId.isEmpty()) {
 		_pluralId = isCustom()
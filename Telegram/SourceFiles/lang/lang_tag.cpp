@@ -889,6 +889,55 @@ int FindTagReplacementPosition(const QString &original, ushort tag) {
 
 }
 
+QString ReplaceTags(
+		QString &&original,
+		std::initializer_list<TagReplacement> replacements) {
+	Expects(replacements.size() < 64);
+
+	auto size = original.size();
+	for (const auto &replacement : replacements) {
+		size += replacement.value.size() - kTagReplacementSize;
+	}
+	auto result = QString();
+	auto replaced = uint64(0);
+	const auto s = original.constData();
+	const auto e = s + original.size();
+	auto from = s;
+	for (auto ch = s; ch != e;) {
+		if (*ch != TextCommand) {
+			++ch;
+		} else if (ch + kTagReplacementSize <= e
+			&& (ch + 1)->unicode() == TextCommandLangTag
+			&& *(ch + 3) == TextCommand) {
+			auto index = 0;
+			for (const auto &replacement : replacements) {
+				const auto mask = (uint64(1) << index++);
+				if ((ch + 2)->unicode() != 0x0020 + replacement.tag
+					|| (replaced & mask)) {
+					continue;
+				}
+				replaced |= mask;
+				if (result.isEmpty()) {
+					result.reserve(size);
+				}
+				result.append(from, ch - from);
+				result.append(replacement.value);
+				from = ch + kTagReplacementSize;
+				break;
+			}
+			ch += kTagReplacementSize;
+		} else {
+			const auto next = textSkipCommand(ch, e);
+			ch = (next == ch) ? (ch + 1) : next;
+		}
+	}
+	if (from == s) {
+		return std::move(original);
+	}
+	result.append(from, e - from);
+	return result;
+}
+
 QString FormatDouble(float64 value) {
 	auto result = QString::number(value, 'f', 6);
 	while (result.endsWith('0')) {
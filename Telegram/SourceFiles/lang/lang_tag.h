@@ -15,6 +15,16 @@ constexpr auto kTagReplacementSize = 4;
 
 int FindTagReplacementPosition(const QString &original, ushort tag);
 
+struct TagReplacement {
+	ushort tag = 0;
+	const QString &value;
+};
+
+// Replaces all the tags of a phrase in a single pass over it.
+QString ReplaceTags(
+	QString &&original,
+	std::initializer_list<TagReplacement> replacements);
+
 struct ShortenedCount {
 	int64 number = 0;
 	QString string;
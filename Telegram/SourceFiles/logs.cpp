@@ -11,6 +11,11 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/connection.h"
 #include "core/crash_reports.h"
 #include "core/launcher.h"
+#include "base/mpsc_queue.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 enum LogDataType {
 	LogDataMain,
@@ -67,7 +72,13 @@ public:
 		return reopen(LogDataMain, 0, qsl("start"));
 	}
 
-	void closeMain() {
+	void flushOnCrash() {
+	if (LogsDebugWriter) {
+		LogsDebugWriter->flushOnCrash();
+	}
+}
+
+void closeMain() {
 		QMutexLocker lock(_logsMutex(LogDataMain));
 		const auto file = files[LogDataMain].get();
 		if (file && file->isOpen()) {
@@ -92,8 +103,22 @@ public:
 		return QString();
 	}
 
-	void write(LogDataType type, const QString &msg) {
+	void write(LogDataType type, const QByteArray &bytes) {
 		QMutexLocker lock(_logsMutex(type));
+		writeLocked(type, bytes);
+	}
+
+	// Called from the crash handler, skips the file if it is busy.
+	void writeOnCrash(LogDataType type, const QByteArray &bytes) {
+		const auto mutex = _logsMutex(type);
+		if (mutex->tryLock()) {
+			writeLocked(type, bytes);
+			mutex->unlock();
+		}
+	}
+
+private:
+	void writeLocked(LogDataType type, const QByteArray &bytes) {
 		if (type != LogDataMain) {
 			reopenDebug();
 		}
@@ -101,11 +126,10 @@ public:
 		if (!file || !file->isOpen()) {
 			return;
 		}
-		file->write(msg.toUtf8());
+		file->write(bytes);
 		file->flush();
 	}
 
-private:
 	std::unique_ptr<QFile> files[LogDataCount];
 
 	int32 part = -1;
@@ -233,6 +257,91 @@ NEW LOGGING INSTANCE STARTED!!!\n\
 
 LogsDataFields *LogsData = 0;
 
+// Debug, tcp and mtp log lines are pushed without locks from any thread
+// and written to the files in batches by a separate thread.
+class LogsWriter {
+public:
+	LogsWriter();
+	LogsWriter(const LogsWriter &other) = delete;
+	LogsWriter &operator=(const LogsWriter &other) = delete;
+	~LogsWriter();
+
+	void push(LogDataType type, const QString &msg);
+	void flushOnCrash();
+
+private:
+	using Line = std::pair<LogDataType, QString>;
+
+	void run();
+	void write(std::vector<Line> &&lines, bool crashed = false);
+
+	base::mpsc_queue<Line> _lines;
+
+	std::mutex _mutex;
+	std::condition_variable _variable;
+	bool _finishing = false;
+	std::thread _thread;
+
+};
+
+LogsWriter::LogsWriter() {
+	_thread = std::thread([=] { run(); });
+}
+
+LogsWriter::~LogsWriter() {
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_finishing = true;
+	}
+	_variable.notify_one();
+	_thread.join();
+}
+
+void LogsWriter::push(LogDataType type, const QString &msg) {
+	_lines.push({ type, msg });
+}
+
+void LogsWriter::flushOnCrash() {
+	write(_lines.take(), true);
+}
+
+void LogsWriter::run() {
+	constexpr auto kWriteInterval = std::chrono::milliseconds(100);
+
+	auto lock = std::unique_lock<std::mutex>(_mutex);
+	while (true) {
+		_variable.wait_for(lock, kWriteInterval, [&] { return _finishing; });
+		const auto finishing = _finishing;
+		lock.unlock();
+		write(_lines.take());
+		if (finishing) {
+			return;
+		}
+		lock.lock();
+	}
+}
+
+void LogsWriter::write(std::vector<Line> &&lines, bool crashed) {
+	if (lines.empty() || !LogsData) {
+		return;
+	}
+	QByteArray bytes[LogDataCount];
+	for (const auto &[type, msg] : lines) {
+		bytes[type].append(msg.toUtf8());
+	}
+	for (auto type = 0; type != LogDataCount; ++type) {
+		if (bytes[type].isEmpty()) {
+			continue;
+		} else if (crashed) {
+			LogsData->writeOnCrash(LogDataType(type), bytes[type]);
+		} else {
+			LogsData->write(LogDataType(type), bytes[type]);
+		}
+	}
+}
+
+LogsWriter *LogsDebugWriter = nullptr;
+
 using LogsInMemoryList = QList<QPair<LogDataType, QString>>;
 LogsInMemoryList *LogsInMemory = 0;
 LogsInMemoryList *DeletedLogsInMemory = SharedMemoryLocation<LogsInMemoryList, 0>();
@@ -241,8 +350,12 @@ QString LogsBeforeSingleInstanceChecked; // LogsInMemory already dumped in LogsD
 
 void _logsWrite(LogDataType type, const QString &msg) {
 	if (LogsData && (type == LogDataMain || LogsStartIndexChosen < 0)) {
-		if (type == LogDataMain || Logs::DebugEnabled()) {
-			LogsData->write(type, msg);
+		if (type != LogDataMain && !Logs::DebugEnabled()) {
+			return;
+		} else if (type != LogDataMain && LogsDebugWriter) {
+			LogsDebugWriter->push(type, msg);
+		} else {
+			LogsData->write(type, msg.toUtf8());
 		}
 	} else if (LogsInMemory != DeletedLogsInMemory) {
 		if (!LogsInMemory) {
@@ -446,6 +559,7 @@ void start(not_null<Core::Launcher*> launcher) {
 }
 
 void finish() {
+	delete base::take(LogsDebugWriter);
 	delete LogsData;
 	LogsData = 0;
 
@@ -475,6 +589,7 @@ bool instanceChecked() {
 		return false;
 	}
 
+	LogsDebugWriter = new LogsWriter();
 	if (LogsInMemory) {
 		Assert(LogsInMemory != DeletedLogsInMemory);
 		LogsInMemoryList list = *LogsInMemory;
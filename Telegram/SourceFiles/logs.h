@@ -28,6 +28,9 @@ void multipleInstances();
 
 void closeMain();
 
+// Writes the queued debug log lines, best-effort, from the crash handler.
+void flushOnCrash();
+
 void writeMain(const QString &v);
 
 void writeDebug(const char *file, int32 line, const QString &v);
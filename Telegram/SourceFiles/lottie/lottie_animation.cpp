@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "lottie/lottie_animation.h"
 
 #include "lottie/lottie_frame_renderer.h"
+#include "lottie/lottie_frame_cache.h"
 #include "rasterrenderer/rasterrenderer.h"
 #include "json.h"
 #include "base/algorithm.h"
@@ -67,29 +68,31 @@ std::unique_ptr<Animation> FromData(const QByteArray &data) {
 	return std::make_unique<Animation>(base::duplicate(data));
 }
 
-auto Init(QByteArray &&content)
+auto Init(QByteArray &&content, std::shared_ptr<FrameCache> cache)
 -> base::variant<std::unique_ptr<SharedState>, Error> {
-	if (content.size() > kMaxFileSize) {
-		qWarning()
-			<< "Lottie Error: Too large file: "
-			<< content.size();
-		return Error::ParseFailed;
-	}
-	content = UnpackGzip(content);
-	if (content.size() > kMaxFileSize) {
-		qWarning()
-			<< "Lottie Error: Too large file: "
-			<< content.size();
-		return Error::ParseFailed;
-	}
-	const auto document = JsonDocument(std::move(content));
-	if (const auto error = document.error()) {
-		qWarning()
-			<< "Lottie Error: Parse failed with code: "
-			<< error;
-		return Error::ParseFailed;
+	auto document = cache->document();
+	if (!document) {
+		content = UnpackGzip(content);
+		if (content.size() > kMaxFileSize) {
+			qWarning()
+				<< "Lottie Error: Too large file: "
+				<< content.size();
+			return Error::ParseFailed;
+		}
+		const auto size = content.size();
+		auto parsed = std::make_shared<JsonDocument>(std::move(content));
+		if (const auto error = parsed->error()) {
+			qWarning()
+				<< "Lottie Error: Parse failed with code: "
+				<< error;
+			return Error::ParseFailed;
+		}
+		document = std::move(parsed);
+		cache->setDocument(document, size);
 	}
-	auto result = std::make_unique<SharedState>(document.root());
+	auto result = std::make_unique<SharedState>(
+		document->root(),
+		std::move(cache));
 	auto information = result->information();
 	if (!information.frameRate
 		|| information.framesCount <= 0
@@ -99,8 +102,27 @@ auto Init(QByteArray &&content)
 	return std::move(result);
 }
 
+auto Init(QByteArray &&content)
+-> base::variant<std::unique_ptr<SharedState>, Error> {
+	if (content.size() > kMaxFileSize) {
+		qWarning()
+			<< "Lottie Error: Too large file: "
+			<< content.size();
+		return Error::ParseFailed;
+	}
+	auto cache = FrameCache::Get(content);
+	return Init(std::move(content), std::move(cache));
+}
+
 QImage ReadThumbnail(QByteArray &&content) {
-	return Init(std::move(content)).match([](
+	if (content.size() > kMaxFileSize) {
+		return QImage();
+	}
+	auto cache = FrameCache::Get(content);
+	if (auto cover = cache->cover(); !cover.isNull()) {
+		return cover;
+	}
+	return Init(std::move(content), std::move(cache)).match([](
 		const std::unique_ptr<SharedState> &state) {
 		return state->frameForPaint()->original;
 	}, [](Error) {
@@ -136,7 +158,7 @@ void Animation::parseDone(std::unique_ptr<SharedState> state) {
 	_state = state.get();
 	_state->start(this, crl::now());
 	_renderer = FrameRenderer::Instance();
-	_renderer->append(std::move(state));
+	_renderer->append(std::move(state), _hints);
 	_updates.fire({ std::move(information) });
 
 	crl::on_main_update_requests(
@@ -170,6 +192,28 @@ bool Animation::ready() const {
 	return (_renderer != nullptr);
 }
 
+void Animation::setVisible(bool visible) {
+	auto hints = _hints;
+	hints.visible = visible;
+	updateRenderHints(hints);
+}
+
+void Animation::setPriority(Priority priority) {
+	auto hints = _hints;
+	hints.priority = priority;
+	updateRenderHints(hints);
+}
+
+void Animation::updateRenderHints(RenderHints hints) {
+	if (_hints == hints) {
+		return;
+	}
+	_hints = hints;
+	if (_renderer) {
+		_renderer->updateRenderHints(_state, hints);
+	}
+}
+
 crl::time Animation::markFrameDisplayed(crl::time now) {
 	Expects(_renderer != nullptr);
 
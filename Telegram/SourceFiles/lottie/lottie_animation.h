@@ -49,6 +49,10 @@ public:
 
 	[[nodiscard]] bool ready() const;
 
+	// Hidden animations don't render new frames until shown again.
+	void setVisible(bool visible);
+	void setPriority(Priority priority);
+
 	// Returns frame position, if any frame was marked as displayed.
 	crl::time markFrameDisplayed(crl::time now);
 	crl::time markFrameShown();
@@ -61,12 +65,14 @@ private:
 
 	void checkNextFrameAvailability();
 	void checkNextFrameRender();
+	void updateRenderHints(RenderHints hints);
 
 	//crl::time _started = 0;
 	//PlaybackOptions _options;
 
 	base::Timer _timer;
 	crl::time _nextFrameTime = kTimeUnknown;
+	RenderHints _hints;
 	SharedState *_state = nullptr;
 	std::shared_ptr<FrameRenderer> _renderer;
 	rpl::event_stream<Update, Error> _updates;
@@ -46,6 +46,25 @@ enum class Error {
 	NotSupported,
 };
 
+// Low priority animations render at half frame rate while the renderer
+// can't keep up with all the animations shown.
+enum class Priority {
+	Normal,
+	Low,
+};
+
+struct RenderHints {
+	Priority priority = Priority::Normal;
+	bool visible = true;
+
+	bool operator==(const RenderHints &other) const {
+		return (priority == other.priority) && (visible == other.visible);
+	}
+	bool operator!=(const RenderHints &other) const {
+		return !(*this == other);
+	}
+};
+
 struct FrameRequest {
 	QSize resize;
 	std::optional<QColor> colored;
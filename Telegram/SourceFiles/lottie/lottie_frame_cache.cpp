@@ -0,0 +1,238 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "lottie/lottie_frame_cache.h"
+
+#include "base/openssl_help.h"
+#include "base/memory_usage.h"
+#include "json.h"
+#include "zlib.h"
+
+#include <atomic>
+
+namespace Lottie {
+namespace {
+
+// Caches of animations not shown right now are dropped over this limit.
+// Animations that are shown stop adding frames until memory is freed.
+constexpr auto kMemoryLimit = int64(64 * 1024 * 1024);
+
+// Least recently used covers are dropped over this limit.
+constexpr auto kCoversMemoryLimit = int64(16 * 1024 * 1024);
+
+struct Cover {
+	QImage image;
+	int64 usedAt = 0;
+};
+
+struct Registry {
+	QMutex mutex;
+	base::flat_map<QByteArray, std::shared_ptr<FrameCache>> caches;
+	base::flat_map<QByteArray, Cover> covers;
+	int64 coversMemory = 0;
+	int64 counter = 0;
+};
+
+Registry &GetRegistry() {
+	static Registry result;
+	return result;
+}
+
+std::atomic<int64> TotalMemory = 0;
+
+void AddMemory(int64 amount) {
+	TotalMemory += amount;
+	base::memory::Allocated(base::memory::Tag::LottieCaches, amount);
+}
+
+void RemoveMemory(int64 amount) {
+	TotalMemory -= amount;
+	base::memory::Freed(base::memory::Tag::LottieCaches, amount);
+}
+
+void AddCoversMemory(Registry &registry, int64 amount) {
+	registry.coversMemory += amount;
+	base::memory::Allocated(base::memory::Tag::LottieCaches, amount);
+}
+
+QByteArray Compress(const QImage &image) {
+	const auto size = image.byteCount();
+	auto result = QByteArray(
+		int(compressBound(size)),
+		Qt::Uninitialized);
+	auto length = uLongf(result.size());
+	const auto error = compress2(
+		reinterpret_cast<Bytef*>(result.data()),
+		&length,
+		image.constBits(),
+		uLong(size),
+		Z_BEST_SPEED);
+	if (error != Z_OK) {
+		return QByteArray();
+	}
+	result.resize(int(length));
+	return result;
+}
+
+bool Decompress(QImage &image, const QByteArray &compressed) {
+	const auto size = image.byteCount();
+	auto length = uLongf(size);
+	const auto error = uncompress(
+		image.bits(),
+		&length,
+		reinterpret_cast<const Bytef*>(compressed.constData()),
+		uLong(compressed.size()));
+	return (error == Z_OK) && (length == uLongf(size));
+}
+
+} // namespace
+
+std::shared_ptr<FrameCache> FrameCache::Get(const QByteArray &content) {
+	const auto hash = openssl::Sha1(bytes::make_span(content));
+	const auto key = QByteArray(
+		reinterpret_cast<const char*>(hash.data()),
+		int(hash.size()));
+
+	auto &registry = GetRegistry();
+	QMutexLocker lock(&registry.mutex);
+	auto &caches = registry.caches;
+	auto &result = caches[key];
+	if (!result) {
+		result = std::make_shared<FrameCache>();
+		result->_key = key;
+	}
+	result->_usedAt = ++registry.counter;
+	auto strong = result;
+
+	while (TotalMemory.load(std::memory_order_relaxed) > kMemoryLimit) {
+		auto oldest = end(caches);
+		for (auto i = begin(caches); i != end(caches); ++i) {
+			if (i->second.use_count() > 1) {
+				continue;
+			} else if (oldest == end(caches)
+				|| i->second->_usedAt < oldest->second->_usedAt) {
+				oldest = i;
+			}
+		}
+		if (oldest == end(caches)) {
+			break;
+		}
+		RemoveMemory(oldest->second->_memory);
+		caches.erase(oldest);
+	}
+	return strong;
+}
+
+std::shared_ptr<const JsonDocument> FrameCache::document() const {
+	QMutexLocker lock(&_mutex);
+	return _document;
+}
+
+void FrameCache::setDocument(
+		std::shared_ptr<const JsonDocument> document,
+		int64 memory) {
+	QMutexLocker lock(&_mutex);
+	if (!_document) {
+		_document = std::move(document);
+		_memory += memory;
+		AddMemory(memory);
+	}
+}
+
+void FrameCache::ClearUnused() {
+	auto &registry = GetRegistry();
+	QMutexLocker lock(&registry.mutex);
+	auto &caches = registry.caches;
+	for (auto i = begin(caches); i != end(caches);) {
+		if (i->second.use_count() > 1) {
+			++i;
+		} else {
+			RemoveMemory(i->second->_memory);
+			i = caches.erase(i);
+		}
+	}
+	AddCoversMemory(registry, -registry.coversMemory);
+	registry.covers.clear();
+}
+
+QImage FrameCache::cover() const {
+	auto &registry = GetRegistry();
+	QMutexLocker lock(&registry.mutex);
+	const auto i = registry.covers.find(_key);
+	if (i == end(registry.covers)) {
+		return QImage();
+	}
+	i->second.usedAt = ++registry.counter;
+	return i->second.image;
+}
+
+void FrameCache::setCover(const QImage &cover) {
+	if (cover.isNull()) {
+		return;
+	}
+	auto &registry = GetRegistry();
+	QMutexLocker lock(&registry.mutex);
+	auto &covers = registry.covers;
+	auto &already = covers[_key];
+	AddCoversMemory(
+		registry,
+		cover.byteCount() - already.image.byteCount());
+	already.image = cover;
+	already.usedAt = ++registry.counter;
+
+	while (registry.coversMemory > kCoversMemoryLimit && covers.size() > 1) {
+		auto oldest = begin(covers);
+		for (auto i = begin(covers); i != end(covers); ++i) {
+			if (i->second.usedAt < oldest->second.usedAt) {
+				oldest = i;
+			}
+		}
+		AddCoversMemory(registry, -oldest->second.image.byteCount());
+		covers.erase(oldest);
+	}
+}
+
+bool FrameCache::fill(QImage &image, int index) const {
+	Expects(index >= 0);
+
+	auto compressed = QByteArray();
+	{
+		QMutexLocker lock(&_mutex);
+		const auto i = _frames.find({ image.width(), image.height() });
+		if (i == end(_frames) || index >= i->second.size()) {
+			return false;
+		}
+		compressed = i->second[index];
+	}
+	return !compressed.isEmpty() && Decompress(image, compressed);
+}
+
+void FrameCache::put(const QImage &image, int index) {
+	Expects(index >= 0);
+
+	if (TotalMemory.load(std::memory_order_relaxed) >= kMemoryLimit) {
+		return;
+	}
+	auto compressed = Compress(image);
+	if (compressed.isEmpty()) {
+		return;
+	}
+	const auto size = int64(compressed.size());
+
+	QMutexLocker lock(&_mutex);
+	auto &frames = _frames[{ image.width(), image.height() }];
+	if (frames.size() <= index) {
+		frames.resize(index + 1);
+	}
+	if (frames[index].isEmpty()) {
+		frames[index] = std::move(compressed);
+		_memory += size;
+		AddMemory(size);
+	}
+}
+
+} // namespace Lottie
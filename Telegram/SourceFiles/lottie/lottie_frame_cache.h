@@ -0,0 +1,64 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/basic_types.h"
+#include "base/flat_map.h"
+
+#include <QImage>
+#include <QMutex>
+#include <vector>
+
+namespace Lottie {
+
+class JsonDocument;
+
+// Rendered frames are shared between all animations with equal content.
+// Frames are kept compressed, so a cached frame costs a decompression
+// instead of a rasterization. The parsed document is kept as well, so
+// equal animations skip unpacking and parsing of the content.
+// First frames are kept apart in a small list of recent covers that
+// outlives the caches, so a preview doesn't need the animation parsed.
+class FrameCache final {
+public:
+	// Any thread.
+	[[nodiscard]] static std::shared_ptr<FrameCache> Get(
+		const QByteArray &content);
+
+	// Any thread.
+	// Drops the caches of animations that don't exist now and all covers.
+	static void ClearUnused();
+
+	// Any thread.
+	[[nodiscard]] std::shared_ptr<const JsonDocument> document() const;
+	void setDocument(
+		std::shared_ptr<const JsonDocument> document,
+		int64 memory);
+
+	// Any thread.
+	[[nodiscard]] QImage cover() const;
+	void setCover(const QImage &cover);
+
+	// Any thread.
+	// The image should already have the required size and format.
+	[[nodiscard]] bool fill(QImage &image, int index) const;
+	void put(const QImage &image, int index);
+
+private:
+	using SizeKey = std::pair<int, int>;
+
+	QByteArray _key;
+	mutable QMutex _mutex;
+	std::shared_ptr<const JsonDocument> _document;
+	base::flat_map<SizeKey, std::vector<QByteArray>> _frames;
+	int64 _usedAt = 0;
+	int64 _memory = 0;
+
+};
+
+} // namespace Lottie
@@ -8,12 +8,17 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "lottie/lottie_frame_renderer.h"
 
 #include "lottie/lottie_animation.h"
+#include "lottie/lottie_frame_cache.h"
 #include "rasterrenderer/rasterrenderer.h"
 #include "logs.h"
+#include "base/trace.h"
+#include "base/memory_usage.h"
 
 #include <range/v3/algorithm/find.hpp>
 #include <range/v3/algorithm/count_if.hpp>
+#include <range/v3/algorithm/min_element.hpp>
 #include <QPainter>
+#include <QThread>
 
 namespace Images {
 QImage prepareColored(QColor add, QImage image);
@@ -23,11 +28,24 @@ namespace Lottie {
 namespace {
 
 constexpr auto kDisplaySkipped = crl::time(-1);
+constexpr auto kMaxRenderQueues = 8;
+
+// If a rendering pass takes longer than a 60 fps frame, low priority
+// animations are slowed down until passes get twice faster than that.
+constexpr auto kRenderPassBudget = crl::time(16);
 
 std::weak_ptr<FrameRenderer> GlobalInstance;
 
 constexpr auto kImageFormat = QImage::Format_ARGB32_Premultiplied;
 
+void AccountFrameMemory(int64 was, int64 now) {
+	if (now > was) {
+		base::memory::Allocated(base::memory::Tag::LottieFrames, now - was);
+	} else if (now < was) {
+		base::memory::Freed(base::memory::Tag::LottieFrames, was - now);
+	}
+}
+
 bool GoodStorageForFrame(const QImage &storage, QSize size) {
 	return !storage.isNull()
 		&& (storage.format() == kImageFormat)
@@ -39,6 +57,10 @@ QImage CreateFrameStorage(QSize size) {
 	return QImage(size, kImageFormat);
 }
 
+int RenderQueuesCount() {
+	return std::clamp(QThread::idealThreadCount(), 1, kMaxRenderQueues);
+}
+
 } // namespace
 
 class FrameRendererObject final {
@@ -46,17 +68,21 @@ public:
 	explicit FrameRendererObject(
 		crl::weak_on_queue<FrameRendererObject> weak);
 
-	void append(std::unique_ptr<SharedState> entry);
+	void append(std::unique_ptr<SharedState> entry, RenderHints hints);
 	void frameShown(not_null<SharedState*> entry);
 	void updateFrameRequest(
 		not_null<SharedState*> entry,
 		const FrameRequest &request);
+	void updateRenderHints(
+		not_null<SharedState*> entry,
+		RenderHints hints);
 	void remove(not_null<SharedState*> entry);
 
 private:
 	struct Entry {
 		std::unique_ptr<SharedState> state;
 		FrameRequest request;
+		RenderHints hints;
 	};
 
 	static not_null<SharedState*> StateFromEntry(const Entry &entry) {
@@ -69,6 +95,7 @@ private:
 	crl::weak_on_queue<FrameRendererObject> _weak;
 	std::vector<Entry> _entries;
 	bool _queued = false;
+	bool _overloaded = false;
 
 };
 
@@ -115,10 +142,12 @@ QImage PrepareFrameByRequest(
 	if (GoodForRequest(frame->original, frame->request)) {
 		return frame->original;
 	} else if (frame->prepared.isNull() || !useExistingPrepared) {
+		const auto was = frame->prepared.byteCount();
 		frame->prepared = PrepareByRequest(
 			frame->original,
 			frame->request,
 			std::move(frame->prepared));
+		AccountFrameMemory(was, frame->prepared.byteCount());
 	}
 	return frame->prepared;
 }
@@ -128,8 +157,10 @@ FrameRendererObject::FrameRendererObject(
 : _weak(std::move(weak)) {
 }
 
-void FrameRendererObject::append(std::unique_ptr<SharedState> state) {
-	_entries.push_back({ std::move(state) });
+void FrameRendererObject::append(
+		std::unique_ptr<SharedState> state,
+		RenderHints hints) {
+	_entries.push_back({ std::move(state), FrameRequest(), hints });
 	queueGenerateFrames();
 }
 
@@ -145,6 +176,15 @@ void FrameRendererObject::updateFrameRequest(
 	i->request = request;
 }
 
+void FrameRendererObject::updateRenderHints(
+		not_null<SharedState*> entry,
+		RenderHints hints) {
+	const auto i = ranges::find(_entries, entry, &StateFromEntry);
+	Assert(i != end(_entries));
+	i->hints = hints;
+	queueGenerateFrames();
+}
+
 void FrameRendererObject::remove(not_null<SharedState*> entry) {
 	const auto i = ranges::find(_entries, entry, &StateFromEntry);
 	Assert(i != end(_entries));
@@ -152,10 +192,25 @@ void FrameRendererObject::remove(not_null<SharedState*> entry) {
 }
 
 void FrameRendererObject::generateFrames() {
-	const auto renderOne = [&](const Entry & entry) {
-		return entry.state->renderNextFrame(entry.request);
+	const auto span = base::trace::Span("generateFrames", "lottie");
+	const auto started = crl::now();
+	const auto renderOne = [&](const Entry &entry) {
+		if (!entry.hints.visible) {
+			return false;
+		}
+		const auto slow = _overloaded
+			&& (entry.hints.priority == Priority::Low);
+		return entry.state->renderNextFrame(entry.request, slow ? 2 : 1);
 	};
-	if (ranges::count_if(_entries, renderOne) > 0) {
+	const auto rendered = ranges::count_if(_entries, renderOne);
+	base::trace::Counter("rendered", rendered, "lottie");
+	const auto duration = crl::now() - started;
+	if (duration > kRenderPassBudget) {
+		_overloaded = true;
+	} else if (duration * 2 < kRenderPassBudget) {
+		_overloaded = false;
+	}
+	if (rendered > 0) {
 		queueGenerateFrames();
 	}
 }
@@ -171,19 +226,34 @@ void FrameRendererObject::queueGenerateFrames() {
 	});
 }
 
-SharedState::SharedState(const JsonObject &definition)
-: _scene(definition) {
+SharedState::SharedState(
+	const JsonObject &definition,
+	std::shared_ptr<FrameCache> cache)
+: _scene(definition)
+, _cache(std::move(cache)) {
 	if (_scene.isValid()) {
 		auto cover = QImage();
 		renderFrame(cover, FrameRequest::NonStrict(), 0);
+		if (_cache) {
+			_cache->setCover(cover);
+		}
 		init(std::move(cover));
 	}
 }
 
+SharedState::~SharedState() {
+	auto memory = int64();
+	for (const auto &frame : _frames) {
+		memory += frame.original.byteCount() + frame.prepared.byteCount();
+	}
+	AccountFrameMemory(memory, 0);
+}
+
 void SharedState::renderFrame(
 		QImage &image,
 		const FrameRequest &request,
 		int index) {
+	const auto span = base::trace::Span("renderFrame", "lottie");
 	const auto realSize = QSize(_scene.width(), _scene.height());
 	if (realSize.isEmpty() || _scene.endFrame() <= _scene.startFrame()) {
 		return;
@@ -193,7 +263,21 @@ void SharedState::renderFrame(
 	if (!GoodStorageForFrame(image, size)) {
 		image = CreateFrameStorage(size);
 	}
+	if (_cache && _cache->fill(image, index)) {
+		return;
+	}
 	image.fill(Qt::transparent);
+	renderFrameToImage(image, realSize, index);
+	if (_cache) {
+		_cache->put(image, index);
+	}
+}
+
+void SharedState::renderFrameToImage(
+		QImage &image,
+		QSize realSize,
+		int index) {
+	const auto size = image.size();
 
 	QPainter p(&image);
 	p.setRenderHints(QPainter::Antialiasing);
@@ -225,6 +309,7 @@ void SharedState::init(QImage cover) {
 
 	_frames[0].original = std::move(cover);
 	_frames[0].position = 0;
+	AccountFrameMemory(0, _frames[0].original.byteCount());
 
 	// Usually main thread sets displayed time before _counter increment.
 	// But in this case we update _counter, so we set a fake displayed time.
@@ -245,24 +330,31 @@ bool IsRendered(not_null<const Frame*> frame) {
 
 void SharedState::renderNextFrame(
 		not_null<Frame*> frame,
-		const FrameRequest &request) {
+		const FrameRequest &request,
+		int frameStep) {
 	Expects(_framesCount > 0);
+	Expects(frameStep > 0);
 
-	renderFrame(frame->original, request, (++_frameIndex) % _framesCount);
+	_frameIndex += frameStep;
+	const auto was = frame->original.byteCount();
+	renderFrame(frame->original, request, _frameIndex % _framesCount);
+	AccountFrameMemory(was, frame->original.byteCount());
 	PrepareFrameByRequest(frame);
 	frame->position = crl::time(1000) * _frameIndex / _frameRate;
 	frame->displayed = kTimeUnknown;
 }
 
-bool SharedState::renderNextFrame(const FrameRequest &request) {
+bool SharedState::renderNextFrame(
+		const FrameRequest &request,
+		int frameStep) {
 	const auto prerender = [&](int index) {
 		const auto frame = getFrame(index);
 		const auto next = getFrame((index + 1) % kFramesCount);
 		if (!IsRendered(frame)) {
-			renderNextFrame(frame, request);
+			renderNextFrame(frame, request, frameStep);
 			return true;
 		} else if (!IsRendered(next)) {
-			renderNextFrame(next, request);
+			renderNextFrame(next, request, frameStep);
 			return true;
 		}
 		return false;
@@ -270,7 +362,7 @@ bool SharedState::renderNextFrame(const FrameRequest &request) {
 	const auto present = [&](int counter, int index) {
 		const auto frame = getFrame(index);
 		if (!IsRendered(frame)) {
-			renderNextFrame(frame, request);
+			renderNextFrame(frame, request, frameStep);
 		}
 		frame->display = _started + _accumulatedDelayMs + frame->position;
 
@@ -430,15 +522,35 @@ std::shared_ptr<FrameRenderer> FrameRenderer::Instance() {
 	return result;
 }
 
-void FrameRenderer::append(std::unique_ptr<SharedState> entry) {
-	_wrapped.with([entry = std::move(entry)](
+FrameRenderer::FrameRenderer()
+: _entriesCount(RenderQueuesCount()) {
+	_wrapped.reserve(_entriesCount.size());
+	for (auto i = 0, count = int(_entriesCount.size()); i != count; ++i) {
+		_wrapped.push_back(std::make_unique<Wrapped>());
+	}
+}
+
+auto FrameRenderer::wrapped(not_null<SharedState*> entry) -> Wrapped & {
+	const auto i = _shards.find(entry);
+	Assert(i != end(_shards));
+	return *_wrapped[i->second];
+}
+
+void FrameRenderer::append(
+		std::unique_ptr<SharedState> entry,
+		RenderHints hints) {
+	const auto shard = int(ranges::min_element(_entriesCount)
+		- begin(_entriesCount));
+	++_entriesCount[shard];
+	_shards.emplace(entry.get(), shard);
+	_wrapped[shard]->with([entry = std::move(entry), hints](
 			FrameRendererObject &unwrapped) mutable {
-		unwrapped.append(std::move(entry));
+		unwrapped.append(std::move(entry), hints);
 	});
 }
 
 void FrameRenderer::frameShown(not_null<SharedState*> entry) {
-	_wrapped.with([=](FrameRendererObject &unwrapped) {
+	wrapped(entry).with([=](FrameRendererObject &unwrapped) {
 		unwrapped.frameShown(entry);
 	});
 }
@@ -446,13 +558,26 @@ void FrameRenderer::frameShown(not_null<SharedState*> entry) {
 void FrameRenderer::updateFrameRequest(
 		not_null<SharedState*> entry,
 		const FrameRequest &request) {
-	_wrapped.with([=](FrameRendererObject &unwrapped) {
+	wrapped(entry).with([=](FrameRendererObject &unwrapped) {
 		unwrapped.updateFrameRequest(entry, request);
 	});
 }
 
+void FrameRenderer::updateRenderHints(
+		not_null<SharedState*> entry,
+		RenderHints hints) {
+	wrapped(entry).with([=](FrameRendererObject &unwrapped) {
+		unwrapped.updateRenderHints(entry, hints);
+	});
+}
+
 void FrameRenderer::remove(not_null<SharedState*> entry) {
-	_wrapped.with([=](FrameRendererObject &unwrapped) {
+	const auto i = _shards.find(entry);
+	Assert(i != end(_shards));
+	const auto shard = i->second;
+	_shards.erase(i);
+	--_entriesCount[shard];
+	_wrapped[shard]->with([=](FrameRendererObject &unwrapped) {
 		unwrapped.remove(entry);
 	});
 }
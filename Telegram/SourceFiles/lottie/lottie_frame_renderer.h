@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "base/basic_types.h"
+#include "base/flat_map.h"
 #include "base/weak_ptr.h"
 #include "lottie/lottie_common.h"
 #include "bmscene.h"
@@ -24,6 +25,7 @@ namespace Lottie {
 
 class Animation;
 class JsonObject;
+class FrameCache;
 
 struct Frame {
 	QImage original;
@@ -41,7 +43,10 @@ QImage PrepareFrameByRequest(
 
 class SharedState {
 public:
-	explicit SharedState(const JsonObject &definition);
+	SharedState(
+		const JsonObject &definition,
+		std::shared_ptr<FrameCache> cache);
+	~SharedState();
 
 	void start(not_null<Animation*> owner, crl::time now);
 
@@ -54,18 +59,23 @@ public:
 	crl::time markFrameShown();
 
 	void renderFrame(QImage &image, const FrameRequest &request, int index);
-	[[nodiscard]] bool renderNextFrame(const FrameRequest &request);
+	[[nodiscard]] bool renderNextFrame(
+		const FrameRequest &request,
+		int frameStep = 1);
 
 private:
 	void init(QImage cover);
+	void renderFrameToImage(QImage &image, QSize realSize, int index);
 	void renderNextFrame(
 		not_null<Frame*> frame,
-		const FrameRequest &request);
+		const FrameRequest &request,
+		int frameStep);
 	[[nodiscard]] not_null<Frame*> getFrame(int index);
 	[[nodiscard]] not_null<const Frame*> getFrame(int index) const;
 	[[nodiscard]] int counter() const;
 
 	BMScene _scene;
+	const std::shared_ptr<FrameCache> _cache;
 
 	static constexpr auto kCounterUninitialized = -1;
 	std::atomic<int> _counter = kCounterUninitialized;
@@ -85,20 +95,34 @@ private:
 
 class FrameRendererObject;
 
+// Animations are spread between several queues, each animation always
+// renders on the same queue, so its frames are presented in order.
 class FrameRenderer final {
 public:
 	static std::shared_ptr<FrameRenderer> Instance();
 
-	void append(std::unique_ptr<SharedState> entry);
+	FrameRenderer();
+
+	// Main thread.
+	void append(std::unique_ptr<SharedState> entry, RenderHints hints);
 	void updateFrameRequest(
 		not_null<SharedState*> entry,
 		const FrameRequest &request);
+	void updateRenderHints(
+		not_null<SharedState*> entry,
+		RenderHints hints);
 	void frameShown(not_null<SharedState*> entry);
 	void remove(not_null<SharedState*> state);
 
 private:
 	using Implementation = FrameRendererObject;
-	crl::object_on_queue<Implementation> _wrapped;
+	using Wrapped = crl::object_on_queue<Implementation>;
+
+	[[nodiscard]] Wrapped &wrapped(not_null<SharedState*> entry);
+
+	std::vector<std::unique_ptr<Wrapped>> _wrapped;
+	std::vector<int> _entriesCount;
+	base::flat_map<not_null<SharedState*>, int> _shards;
 
 };
 
@@ -82,6 +82,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/file_utilities.h"
 #include "core/update_checker.h"
 #include "core/shortcuts.h"
+#include "core/startup_trace.h"
+#include "core/init_scheduler.h"
 #include "core/application.h"
 #include "calls/calls_instance.h"
 #include "calls/calls_top_bar.h"
@@ -101,6 +103,9 @@ namespace {
 
 constexpr auto kChannelGetDifferenceLimit = 100;
 
+// Don't send more getChannelDifference requests at once.
+constexpr auto kChannelGetDifferenceConcurrency = 4;
+
 // 1s wait after show channel history before sending getChannelDifference.
 constexpr auto kWaitForChannelGetDifference = crl::time(1000);
 
@@ -112,9 +117,16 @@ constexpr auto kNoUpdatesAfterSleepTimeout = 60 * crl::time(1000);
 
 // Send channel views each second.
 constexpr auto kSendViewsTimeout = crl::time(1000);
+constexpr auto kSendViewsLimit = 100;
+
+// Cache background scaled image when resizing settles,
+// keep a few sizes to switch between maximized and normal fast.
+constexpr auto kCacheBackgroundTimeout = crl::time(300);
+constexpr auto kCachedBackgroundsLimit = 3;
 
-// Cache background scaled image after 3s.
-constexpr auto kCacheBackgroundTimeout = 3000;
+// Apply a big difference in 8ms parts, messages are applied in groups.
+constexpr auto kDifferenceFeedTimeout = crl::time(8);
+constexpr auto kDifferenceFeedMessages = 16;
 
 enum class DataIsLoadedResult {
 	NotLoaded = 0,
@@ -252,6 +264,36 @@ DataIsLoadedResult AllDataLoadedForMessage(
 	});
 }
 
+QImage PrepareTiledBackground(const QImage &tile, QSize size) {
+	auto result = QImage(
+		size * cIntRetinaFactor(),
+		QImage::Format_RGB32);
+	result.setDevicePixelRatio(cRetinaFactor());
+	{
+		QPainter p(&result);
+		const auto w = tile.width() / cRetinaFactor();
+		const auto h = tile.height() / cRetinaFactor();
+		const auto cx = qCeil(size.width() / w);
+		const auto cy = qCeil(size.height() / h);
+		for (auto i = 0; i < cx; ++i) {
+			for (auto j = 0; j < cy; ++j) {
+				p.drawImage(QPointF(i * w, j * h), tile);
+			}
+		}
+	}
+	return result;
+}
+
+QImage PrepareScaledBackground(const QImage &image, QRect to, QRect from) {
+	auto result = image.copy(from).scaled(
+		to.width() * cIntRetinaFactor(),
+		to.height() * cIntRetinaFactor(),
+		Qt::IgnoreAspectRatio,
+		Qt::SmoothTransformation);
+	result.setDevicePixelRatio(cRetinaFactor());
+	return result;
+}
+
 } // namespace
 
 enum StackItemType {
@@ -372,7 +414,10 @@ MainWidget::MainWidget(
 , _idleFinishTimer([=] { checkIdleFinish(); })
 , _failDifferenceTimer([=] { getDifferenceAfterFail(); })
 , _cacheBackgroundTimer([=] { cacheBackground(); })
-, _viewsIncrementTimer([=] { viewsIncrement(); }) {
+, _viewsToIncrement(kSendViewsTimeout, kSendViewsLimit, [=](
+		std::vector<std::pair<PeerData*, MsgId>> &&views) {
+	viewsIncrement(std::move(views));
+}) {
 	_controller->setDefaultFloatPlayerDelegate(floatPlayerDelegate());
 	_controller->floatPlayerClosed(
 	) | rpl::start_with_next([=](FullMsgId itemId) {
@@ -475,8 +520,13 @@ MainWidget::MainWidget(
 	orderWidgets();
 
 	if (!Core::UpdaterDisabled()) {
-		Core::UpdateChecker checker;
-		checker.start();
+		Core::App().initScheduler().add({
+			"updater",
+			Core::InitScheduler::Priority::Low,
+			{},
+			false,
+			[] { Core::UpdateChecker().start(); }
+		});
 	}
 }
 
@@ -928,45 +978,54 @@ bool MainWidget::sendMessageFail(const RPCError &error) {
 }
 
 void MainWidget::cacheBackground() {
-	if (Window::Theme::Background()->colorForFill()) {
+	const auto background = Window::Theme::Background();
+	if (background->colorForFill()) {
 		return;
-	} else if (Window::Theme::Background()->tile()) {
-		auto &bg = Window::Theme::Background()->pixmapForTiled();
-
-		auto result = QImage(_willCacheFor.width() * cIntRetinaFactor(), _willCacheFor.height() * cIntRetinaFactor(), QImage::Format_RGB32);
-        result.setDevicePixelRatio(cRetinaFactor());
-		{
-			QPainter p(&result);
-			auto left = 0;
-			auto top = 0;
-			auto right = _willCacheFor.width();
-			auto bottom = _willCacheFor.height();
-			auto w = bg.width() / cRetinaFactor();
-			auto h = bg.height() / cRetinaFactor();
-			auto sx = 0;
-			auto sy = 0;
-			auto cx = qCeil(_willCacheFor.width() / w);
-			auto cy = qCeil(_willCacheFor.height() / h);
-			for (int i = sx; i < cx; ++i) {
-				for (int j = sy; j < cy; ++j) {
-					p.drawPixmap(QPointF(i * w, j * h), bg);
-				}
-			}
-		}
-		_cachedX = 0;
-		_cachedY = 0;
-		_cachedBackground = App::pixmapFromImageInPlace(std::move(result));
-	} else {
-		auto &bg = Window::Theme::Background()->pixmap();
+	}
+	auto cached = CachedBackground();
+	cached.rect = _willCacheFor;
+	cached.factor = cIntRetinaFactor();
+	const auto tile = background->tile();
+	auto to = QRect();
+	auto from = QRect();
+	if (!tile) {
+		const auto size = background->pixmap().size();
+		Window::Theme::ComputeBackgroundRects(cached.rect, size, to, from);
+		cached.x = to.x();
+		cached.y = to.y();
+	}
+
+	// Scaling a big wallpaper takes a while, it is done in the background.
+	auto image = (tile
+		? background->pixmapForTiled()
+		: background->pixmap()).toImage();
+	crl::async([
+		=,
+		guard = _cacheBackgroundGuard.make_guard(),
+		image = std::move(image)
+	]() mutable {
+		auto result = tile
+			? PrepareTiledBackground(image, cached.rect.size())
+			: PrepareScaledBackground(image, to, from);
+		crl::on_main(std::move(guard), [
+			=,
+			result = std::move(result)
+		]() mutable {
+			cacheBackgroundReady(std::move(cached), std::move(result));
+		});
+	});
+}
 
-		QRect to, from;
-		Window::Theme::ComputeBackgroundRects(_willCacheFor, bg.size(), to, from);
-		_cachedX = to.x();
-		_cachedY = to.y();
-		_cachedBackground = App::pixmapFromImageInPlace(bg.toImage().copy(from).scaled(to.width() * cIntRetinaFactor(), to.height() * cIntRetinaFactor(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
-		_cachedBackground.setDevicePixelRatio(cRetinaFactor());
+void MainWidget::cacheBackgroundReady(
+		CachedBackground &&cached,
+		QImage &&image) {
+	cached.pixmap = App::pixmapFromImageInPlace(std::move(image));
+	cached.pixmap.setDevicePixelRatio(cRetinaFactor());
+	_cachedBackgrounds.insert(begin(_cachedBackgrounds), std::move(cached));
+	if (int(_cachedBackgrounds.size()) > kCachedBackgroundsLimit) {
+		_cachedBackgrounds.pop_back();
 	}
-	_cachedFor = _willCacheFor;
+	update();
 }
 
 crl::time MainWidget::highlightStartTime(not_null<const HistoryItem*> item) const {
@@ -1324,16 +1383,24 @@ bool MainWidget::isIdle() const {
 }
 
 void MainWidget::clearCachedBackground() {
-	_cachedBackground = QPixmap();
+	_cachedBackgrounds.clear();
 	_cacheBackgroundTimer.cancel();
+	_cacheBackgroundGuard = nullptr;
 	update();
 }
 
 QPixmap MainWidget::cachedBackground(const QRect &forRect, int &x, int &y) {
-	if (!_cachedBackground.isNull() && forRect == _cachedFor) {
-		x = _cachedX;
-		y = _cachedY;
-		return _cachedBackground;
+	const auto factor = cIntRetinaFactor();
+	const auto i = ranges::find_if(_cachedBackgrounds, [&](
+			const CachedBackground &cached) {
+		return (cached.rect == forRect) && (cached.factor == factor);
+	});
+	if (i != end(_cachedBackgrounds)) {
+		std::rotate(begin(_cachedBackgrounds), i, i + 1);
+		const auto &cached = _cachedBackgrounds.front();
+		x = cached.x;
+		y = cached.y;
+		return cached.pixmap;
 	}
 	if (_willCacheFor != forRect || !_cacheBackgroundTimer.isActive()) {
 		_willCacheFor = forRect;
@@ -1342,6 +1409,10 @@ QPixmap MainWidget::cachedBackground(const QRect &forRect, int &x, int &y) {
 	return QPixmap();
 }
 
+bool MainWidget::hasCachedBackgrounds() const {
+	return !_cachedBackgrounds.empty();
+}
+
 void MainWidget::updateScrollColors() {
 	_history->updateScrollColors();
 }
@@ -1480,66 +1551,40 @@ void MainWidget::scheduleViewIncrement(HistoryItem *item) {
 		i = _viewsIncremented.insert(peer, ViewsIncrementMap());
 	}
 	i.value().insert(item->id, true);
-	auto j = _viewsToIncrement.find(peer);
-	if (j == _viewsToIncrement.cend()) {
-		j = _viewsToIncrement.insert(peer, ViewsIncrementMap());
-		_viewsIncrementTimer.callOnce(kSendViewsTimeout);
-	}
-	j.value().insert(item->id, true);
+	_viewsToIncrement.add({ peer, item->id });
 }
 
-void MainWidget::viewsIncrement() {
-	for (auto i = _viewsToIncrement.begin(); i != _viewsToIncrement.cend();) {
-		if (_viewsIncrementRequests.contains(i.key())) {
-			++i;
-			continue;
-		}
-
+void MainWidget::viewsIncrement(
+		std::vector<std::pair<PeerData*, MsgId>> &&views) {
+	// Views are sorted by peer, one request is sent for each of them.
+	for (auto i = begin(views); i != end(views);) {
+		const auto peer = i->first;
 		QVector<MTPint> ids;
-		ids.reserve(i.value().size());
-		for (ViewsIncrementMap::const_iterator j = i.value().cbegin(), end = i.value().cend(); j != end; ++j) {
-			ids.push_back(MTP_int(j.key()));
+		for (; i != end(views) && i->first == peer; ++i) {
+			ids.push_back(MTP_int(i->second));
 		}
-		auto req = MTP::send(MTPmessages_GetMessagesViews(i.key()->input, MTP_vector<MTPint>(ids), MTP_bool(true)), rpcDone(&MainWidget::viewsIncrementDone, ids), rpcFail(&MainWidget::viewsIncrementFail), 0, 5);
-		_viewsIncrementRequests.insert(i.key(), req);
-		i = _viewsToIncrement.erase(i);
+		auto req = MTP::send(MTPmessages_GetMessagesViews(peer->input, MTP_vector<MTPint>(ids), MTP_bool(true)), rpcDone(&MainWidget::viewsIncrementDone, ids), rpcFail(&MainWidget::viewsIncrementFail), 0, 5);
+		_viewsIncrementByRequest.insert(req, peer);
 	}
 }
 
 void MainWidget::viewsIncrementDone(QVector<MTPint> ids, const MTPVector<MTPint> &result, mtpRequestId req) {
+	const auto peer = _viewsIncrementByRequest.take(req);
 	auto &v = result.v;
-	if (ids.size() == v.size()) {
-		for (auto i = _viewsIncrementRequests.begin(); i != _viewsIncrementRequests.cend(); ++i) {
-			if (i.value() == req) {
-				PeerData *peer = i.key();
-				ChannelId channel = peerToChannel(peer->id);
-				for (int32 j = 0, l = ids.size(); j < l; ++j) {
-					if (HistoryItem *item = session().data().message(channel, ids.at(j).v)) {
-						item->setViewsCount(v.at(j).v);
-					}
-				}
-				_viewsIncrementRequests.erase(i);
-				break;
+	if (peer && ids.size() == v.size()) {
+		ChannelId channel = peerToChannel(peer->id);
+		for (int32 j = 0, l = ids.size(); j < l; ++j) {
+			if (HistoryItem *item = session().data().message(channel, ids.at(j).v)) {
+				item->setViewsCount(v.at(j).v);
 			}
 		}
 	}
-	if (!_viewsToIncrement.isEmpty() && !_viewsIncrementTimer.isActive()) {
-		_viewsIncrementTimer.callOnce(kSendViewsTimeout);
-	}
 }
 
 bool MainWidget::viewsIncrementFail(const RPCError &error, mtpRequestId req) {
 	if (MTP::isDefaultHandledError(error)) return false;
 
-	for (auto i = _viewsIncrementRequests.begin(); i != _viewsIncrementRequests.cend(); ++i) {
-		if (i.value() == req) {
-			_viewsIncrementRequests.erase(i);
-			break;
-		}
-	}
-	if (!_viewsToIncrement.isEmpty() && !_viewsIncrementTimer.isActive()) {
-		_viewsIncrementTimer.callOnce(kSendViewsTimeout);
-	}
+	_viewsIncrementByRequest.remove(req);
 	return false;
 }
 
@@ -2873,6 +2918,7 @@ void MainWidget::gotChannelDifference(
 		ChannelData *channel,
 		const MTPupdates_ChannelDifference &difference) {
 	_channelFailDifferenceTimeout.remove(channel);
+	_channelDifferenceSent.remove(channel);
 
 	const auto timeout = difference.match([&](const auto &data) {
 		return data.has_timeout() ? data.vtimeout.v : 0;
@@ -2919,6 +2965,7 @@ void MainWidget::gotChannelDifference(
 			? (timeout * crl::time(1000))
 			: kWaitForChannelGetDifference);
 	}
+	sendChannelDifferenceRequests();
 }
 
 void MainWidget::feedChannelDifference(
@@ -2939,7 +2986,10 @@ bool MainWidget::failChannelDifference(ChannelData *channel, const RPCError &err
 	if (MTP::isDefaultHandledError(error)) return false;
 
 	LOG(("RPC Error in getChannelDifference: %1 %2: %3").arg(error.code()).arg(error.type()).arg(error.description()));
+	_channelDifferenceSent.remove(channel);
+	channel->ptsSetRequesting(false);
 	failDifferenceStartTimerFor(channel);
+	sendChannelDifferenceRequests();
 	return true;
 }
 
@@ -2970,21 +3020,28 @@ void MainWidget::gotDifference(const MTPupdates_Difference &difference) {
 	} break;
 	case mtpc_updates_differenceSlice: {
 		auto &d = difference.c_updates_differenceSlice();
-		feedDifference(d.vusers, d.vchats, d.vnew_messages, d.vother_updates);
-
 		auto &s = d.vintermediate_state.c_updates_state();
-		updSetState(s.vpts.v, s.vdate.v, s.vqts.v, s.vseq.v);
+		const auto pts = s.vpts.v;
+		const auto date = s.vdate.v;
+		const auto qts = s.vqts.v;
+		const auto seq = s.vseq.v;
 
-		_ptsWaiter.setRequesting(false);
+		// The next slice is requested when this one is applied,
+		// so that it is applied over the intermediate state.
+		feedDifference(d.vusers, d.vchats, d.vnew_messages, d.vother_updates, [=] {
+			updSetState(pts, date, qts, seq);
 
-		MTP_LOG(0, ("getDifference { good - after a slice of difference was received }%1").arg(cTestMode() ? " TESTMODE" : ""));
-		getDifference();
+			_ptsWaiter.setRequesting(false);
+
+			MTP_LOG(0, ("getDifference { good - after a slice of difference was received }%1").arg(cTestMode() ? " TESTMODE" : ""));
+			getDifference();
+		});
 	} break;
 	case mtpc_updates_difference: {
 		auto &d = difference.c_updates_difference();
-		feedDifference(d.vusers, d.vchats, d.vnew_messages, d.vother_updates);
-
-		gotState(d.vstate);
+		feedDifference(d.vusers, d.vchats, d.vnew_messages, d.vother_updates, [=, state = d.vstate] {
+			gotState(state);
+		});
 	} break;
 	case mtpc_updates_differenceTooLong: {
 		auto &d = difference.c_updates_differenceTooLong();
@@ -3072,13 +3129,62 @@ void MainWidget::feedDifference(
 		const MTPVector<MTPUser> &users,
 		const MTPVector<MTPChat> &chats,
 		const MTPVector<MTPMessage> &msgs,
-		const MTPVector<MTPUpdate> &other) {
+		const MTPVector<MTPUpdate> &other,
+		FnMut<void()> done) {
+	Expects(_differenceFeed == nullptr);
+
 	session().checkAutoLock();
 	session().data().processUsers(users);
 	session().data().processChats(chats);
 	feedMessageIds(other);
-	session().data().processMessages(msgs, NewMessageType::Unread);
-	feedUpdateVector(other, true);
+
+	// Data::Session::processMessages adds messages sorted by id,
+	// sort them all here so that the order doesn't depend on the parts.
+	auto messages = msgs.v;
+	std::stable_sort(
+		messages.begin(),
+		messages.end(),
+		[](const MTPMessage &a, const MTPMessage &b) {
+			return uint32(IdFromMessage(a)) < uint32(IdFromMessage(b));
+		});
+	_differenceFeed = std::make_unique<DifferenceFeed>();
+	_differenceFeed->messages = std::move(messages);
+	_differenceFeed->other = other.v;
+	_differenceFeed->done = std::move(done);
+	feedDifferencePart();
+}
+
+void MainWidget::feedDifferencePart() {
+	Expects(_differenceFeed != nullptr);
+
+	const auto feed = _differenceFeed.get();
+	const auto till = crl::now() + kDifferenceFeedTimeout;
+	do {
+		if (feed->messagesFed < feed->messages.size()) {
+			session().data().processMessages(
+				feed->messages.mid(feed->messagesFed, kDifferenceFeedMessages),
+				NewMessageType::Unread);
+			feed->messagesFed = std::min(
+				feed->messagesFed + kDifferenceFeedMessages,
+				feed->messages.size());
+		} else if (feed->otherFed < feed->other.size()) {
+			const auto &update = feed->other[feed->otherFed++];
+			if (update.type() != mtpc_updateMessageID) {
+				feedUpdate(update);
+			}
+		} else {
+			session().data().sendHistoryChangeNotifications();
+			auto done = std::move(feed->done);
+			_differenceFeed = nullptr;
+			done();
+			return;
+		}
+	} while (crl::now() < till);
+
+	session().data().sendHistoryChangeNotifications();
+	crl::on_main(this, [=] {
+		feedDifferencePart();
+	});
 }
 
 bool MainWidget::failDifference(const RPCError &error) {
@@ -3163,7 +3269,9 @@ void MainWidget::getDifference() {
 			MTPint(),
 			MTP_int(updDate),
 			MTP_int(updQts)),
-		rpcDone(&MainWidget::gotDifference),
+		rpcDoneInBackground(
+			&MainWidget::gotDifference,
+			&MainWidget::failDifference),
 		rpcFail(&MainWidget::failDifference));
 }
 
@@ -3180,8 +3288,56 @@ void MainWidget::getChannelDifference(ChannelData *channel, ChannelDifferenceReq
 		_channelGetDifferenceTimeAfterFail.remove(channel);
 	}
 
+	// Updates for the channel wait while it is in the queue.
 	channel->ptsSetRequesting(true);
 
+	_channelDifferenceQueue.emplace(
+		channel,
+		ChannelDifferenceQueued{ from, ++_channelDifferenceOrder });
+	sendChannelDifferenceRequests();
+}
+
+int MainWidget::channelDifferencePriority(
+		not_null<ChannelData*> channel) const {
+	if (_controller->activeChatCurrent().peer() == channel) {
+		return 3;
+	}
+	const auto history = session().data().historyLoaded(channel->id);
+	if (!history || !history->inChatList()) {
+		return 0;
+	}
+	return (history->unreadCount() > 0 && !history->mute()) ? 2 : 1;
+}
+
+void MainWidget::sendChannelDifferenceRequests() {
+	while (!_channelDifferenceQueue.empty()
+		&& (int(_channelDifferenceSent.size())
+			< kChannelGetDifferenceConcurrency)) {
+		// The open chat goes first, then unread unmuted chats from the list.
+		auto best = _channelDifferenceQueue.begin();
+		auto bestPriority = channelDifferencePriority(best->first);
+		const auto till = _channelDifferenceQueue.end();
+		for (auto i = std::next(best); i != till; ++i) {
+			const auto priority = channelDifferencePriority(i->first);
+			if (priority > bestPriority
+				|| (priority == bestPriority
+					&& i->second.order < best->second.order)) {
+				best = i;
+				bestPriority = priority;
+			}
+		}
+		const auto channel = best->first;
+		const auto from = best->second.from;
+		_channelDifferenceQueue.erase(best);
+		sendChannelDifferenceRequest(channel, from);
+	}
+}
+
+void MainWidget::sendChannelDifferenceRequest(
+		not_null<ChannelData*> channel,
+		ChannelDifferenceRequest from) {
+	_channelDifferenceSent.emplace(channel);
+
 	auto filter = MTP_channelMessagesFilterEmpty();
 	auto flags = MTPupdates_GetChannelDifference::Flag::f_force | 0;
 	if (from != ChannelDifferenceRequest::PtsGapOrShortPoll) {
@@ -3196,8 +3352,8 @@ void MainWidget::getChannelDifference(ChannelData *channel, ChannelDifferenceReq
 			filter,
 			MTP_int(channel->pts()),
 			MTP_int(kChannelGetDifferenceLimit)),
-		rpcDone(&MainWidget::gotChannelDifference, channel),
-		rpcFail(&MainWidget::failChannelDifference, channel));
+		rpcDone(&MainWidget::gotChannelDifference, channel.get()),
+		rpcFail(&MainWidget::failChannelDifference, channel.get()));
 }
 
 void MainWidget::sendPing() {
@@ -3205,6 +3361,8 @@ void MainWidget::sendPing() {
 }
 
 void MainWidget::start() {
+	const auto trace = Core::StartupTrace::Scope("MainWidget::start");
+
 	session().api().requestNotifySettings(MTP_inputNotifyUsers());
 	session().api().requestNotifySettings(MTP_inputNotifyChats());
 	session().api().requestNotifySettings(MTP_inputNotifyBroadcasts());
@@ -3221,6 +3379,7 @@ void MainWidget::start() {
 	Local::readRecentStickers();
 	Local::readFavedStickers();
 	Local::readSavedGifs();
+	session().api().applyDialogsSnapshot();
 	if (const auto availableAt = Local::ReadExportSettings().availableAt) {
 		session().data().suggestStartExport(availableAt);
 	}
@@ -8,6 +8,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "base/timer.h"
+#include "base/delayed_batch.h"
+#include "base/binary_guard.h"
 #include "base/weak_ptr.h"
 #include "ui/rp_widget.h"
 #include "ui/effects/animations.h"
@@ -214,6 +216,7 @@ public:
 	bool isIdle() const;
 
 	QPixmap cachedBackground(const QRect &forRect, int &x, int &y);
+	bool hasCachedBackgrounds() const;
 	void updateScrollColors();
 
 	void setChatBackground(
@@ -249,7 +252,7 @@ public:
 	// Made public for ApiWrap, while it is still here.
 	// Better would be for this to be moved to ApiWrap.
 	bool requestingDifference() const {
-		return _ptsWaiter.requesting();
+		return _ptsWaiter.requesting() || (_differenceFeed != nullptr);
 	}
 	void getDifference();
 	void updateOnline(bool gotOtherOffline = false);
@@ -326,7 +329,7 @@ private:
 		UserData *from;
 	};
 
-	void viewsIncrement();
+	void viewsIncrement(std::vector<std::pair<PeerData*, MsgId>> &&views);
 	void sendPing();
 	void getDifferenceByPts();
 	void getDifferenceAfterFail();
@@ -380,12 +383,23 @@ private:
 	void getChannelDifference(ChannelData *channel, ChannelDifferenceRequest from = ChannelDifferenceRequest::Unknown);
 	void gotDifference(const MTPupdates_Difference &diff);
 	bool failDifference(const RPCError &e);
-	void feedDifference(const MTPVector<MTPUser> &users, const MTPVector<MTPChat> &chats, const MTPVector<MTPMessage> &msgs, const MTPVector<MTPUpdate> &other);
+	void feedDifference(
+		const MTPVector<MTPUser> &users,
+		const MTPVector<MTPChat> &chats,
+		const MTPVector<MTPMessage> &msgs,
+		const MTPVector<MTPUpdate> &other,
+		FnMut<void()> done);
+	void feedDifferencePart();
 	void gotState(const MTPupdates_State &state);
 	void updSetState(int32 pts, int32 date, int32 qts, int32 seq);
 	void gotChannelDifference(ChannelData *channel, const MTPupdates_ChannelDifference &diff);
 	bool failChannelDifference(ChannelData *channel, const RPCError &err);
 	void failDifferenceStartTimerFor(ChannelData *channel);
+	void sendChannelDifferenceRequests();
+	void sendChannelDifferenceRequest(
+		not_null<ChannelData*> channel,
+		ChannelDifferenceRequest from);
+	int channelDifferencePriority(not_null<ChannelData*> channel) const;
 
 	void feedUpdateVector(
 		const MTPVector<MTPUpdate> &updates,
@@ -405,7 +419,15 @@ private:
 	void showAll();
 	void clearHider(not_null<Window::HistoryHider*> instance);
 
+	struct CachedBackground {
+		QRect rect;
+		int factor = 0;
+		int x = 0;
+		int y = 0;
+		QPixmap pixmap;
+	};
 	void cacheBackground();
+	void cacheBackgroundReady(CachedBackground &&cached, QImage &&image);
 	void clearCachedBackground();
 
 	not_null<Media::Player::FloatDelegate*> floatPlayerDelegate();
@@ -495,6 +517,16 @@ private:
 
 	PtsWaiter _ptsWaiter;
 
+	// Big differences are applied in parts, the event loop runs between.
+	struct DifferenceFeed {
+		QVector<MTPMessage> messages;
+		QVector<MTPUpdate> other;
+		int messagesFed = 0;
+		int otherFed = 0;
+		FnMut<void()> done;
+	};
+	std::unique_ptr<DifferenceFeed> _differenceFeed;
+
 	ChannelGetDifferenceTime _channelGetDifferenceTimeByPts, _channelGetDifferenceTimeAfterFail;
 	crl::time _getDifferenceTimeByPts = 0;
 	crl::time _getDifferenceTimeAfterFail = 0;
@@ -517,22 +549,31 @@ private:
 	QMap<ChannelData*, int32> _channelFailDifferenceTimeout; // growing timeout for getChannelDifference calls, if it fails
 	base::Timer _failDifferenceTimer;
 
+	// Channels waiting for a getChannelDifference slot, by queue order.
+	struct ChannelDifferenceQueued {
+		ChannelDifferenceRequest from = ChannelDifferenceRequest::Unknown;
+		int order = 0;
+	};
+	base::flat_map<
+		not_null<ChannelData*>,
+		ChannelDifferenceQueued> _channelDifferenceQueue;
+	base::flat_set<not_null<ChannelData*>> _channelDifferenceSent;
+	int _channelDifferenceOrder = 0;
+
 	crl::time _lastUpdateTime = 0;
 	bool _handlingChannelDifference = false;
 
-	QPixmap _cachedBackground;
-	QRect _cachedFor, _willCacheFor;
-	int _cachedX = 0;
-	int _cachedY = 0;
+	std::vector<CachedBackground> _cachedBackgrounds;
+	QRect _willCacheFor;
 	base::Timer _cacheBackgroundTimer;
+	base::binary_guard _cacheBackgroundGuard;
 
 	PhotoData *_deletingPhoto = nullptr;
 
 	using ViewsIncrementMap = QMap<MsgId, bool>;
-	QMap<PeerData*, ViewsIncrementMap> _viewsIncremented, _viewsToIncrement;
-	QMap<PeerData*, mtpRequestId> _viewsIncrementRequests;
+	QMap<PeerData*, ViewsIncrementMap> _viewsIncremented;
+	base::DelayedBatch<std::pair<PeerData*, MsgId>> _viewsToIncrement;
 	QMap<mtpRequestId, PeerData*> _viewsIncrementByRequest;
-	base::Timer _viewsIncrementTimer;
 
 	struct SettingBackground;
 	std::unique_ptr<SettingBackground> _background;
@@ -23,6 +23,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "lang/lang_keys.h"
 #include "core/shortcuts.h"
 #include "core/sandbox.h"
+#include "core/startup_trace.h"
 #include "core/application.h"
 #include "auth_session.h"
 #include "intro/introwidget.h"
@@ -46,6 +47,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace {
 
+constexpr auto kIconsCacheLimit = 64;
+
 // Code for testing languages is F7-F6-F7-F8
 void FeedLangTestingKey(int key) {
 	static auto codeState = 0;
@@ -233,7 +236,10 @@ void MainWindow::setupMain() {
 
 	clearWidgets();
 
-	_main.create(bodyWidget(), controller());
+	{
+		const auto trace = Core::StartupTrace::Scope("MainWidget::create");
+		_main.create(bodyWidget(), controller());
+	}
 	_main->show();
 	updateControlsGeometry();
 
@@ -844,6 +850,27 @@ void MainWindow::placeSmallCounter(QImage &img, int size, int count, style::colo
 }
 
 QImage MainWindow::iconWithCounter(int size, int count, style::color bg, style::color fg, bool smallIcon) {
+	const auto support = AuthSession::Exists() && Auth().supportMode();
+	const auto key = IconCacheKey{
+		size,
+		Window::IconCounterSlice(count),
+		bg->c.rgba(),
+		fg->c.rgba(),
+		smallIcon,
+		support
+	};
+	if (const auto i = _iconsCache.find(key); i != end(_iconsCache)) {
+		return i->second;
+	}
+	auto result = generateIconWithCounter(size, count, bg, fg, smallIcon);
+	if (_iconsCache.size() >= kIconsCacheLimit) {
+		_iconsCache.clear();
+	}
+	_iconsCache.emplace(key, result);
+	return result;
+}
+
+QImage MainWindow::generateIconWithCounter(int size, int count, style::color bg, style::color fg, bool smallIcon) {
 	bool layer = false;
 	if (size < 0) {
 		size = -size;
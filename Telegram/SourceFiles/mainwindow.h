@@ -161,8 +161,13 @@ private:
 	QPixmap grabInner();
 
 	void placeSmallCounter(QImage &img, int size, int count, style::color bg, const QPoint &shift, style::color color) override;
+	QImage generateIconWithCounter(int size, int count, style::color bg, style::color fg, bool smallIcon);
 	QImage icon16, icon32, icon64, iconbig16, iconbig32, iconbig64;
 
+	// Rendered icons by (size, counter slice, colors, small, support).
+	using IconCacheKey = std::tuple<int, int, QRgb, QRgb, bool, bool>;
+	base::flat_map<IconCacheKey, QImage> _iconsCache;
+
 	crl::time _lastTrayClickTime = 0;
 
 	object_ptr<Window::PasscodeLockWidget> _passcodeLock = { nullptr };
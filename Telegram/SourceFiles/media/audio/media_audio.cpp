@@ -451,7 +451,7 @@ void Mixer::Track::started() {
 	frequency = kDefaultFrequency;
 	for (auto i = 0; i != kBuffersCount; ++i) {
 		samplesCount[i] = 0;
-		bufferSamples[i] = QByteArray();
+		bufferSamples[i].resize(0);
 	}
 }
 
@@ -486,14 +486,18 @@ int Mixer::Track::getNotQueuedBufferIndex() {
 				auto samplesInBuffer = samplesCount[i];
 				bufferedPosition += samplesInBuffer;
 				bufferedLength -= samplesInBuffer;
+
+				// Keep the samples storage for the next loaded buffer.
+				auto freed = std::move(bufferSamples[i]);
 				for (auto j = i + 1; j != kBuffersCount; ++j) {
 					samplesCount[j - 1] = samplesCount[j];
 					stream.buffers[j - 1] = stream.buffers[j];
-					bufferSamples[j - 1] = bufferSamples[j];
+					bufferSamples[j - 1] = std::move(bufferSamples[j]);
 				}
+				freed.resize(0);
 				samplesCount[kBuffersCount - 1] = 0;
 				stream.buffers[kBuffersCount - 1] = buffer;
-				bufferSamples[kBuffersCount - 1] = QByteArray();
+				bufferSamples[kBuffersCount - 1] = std::move(freed);
 				found = true;
 				break;
 			}
@@ -512,6 +516,15 @@ int Mixer::Track::getNotQueuedBufferIndex() {
 	return -1;
 }
 
+QByteArray Mixer::Track::takeFreeBuffer() {
+	for (auto i = 0; i != kBuffersCount; ++i) {
+		if (!samplesCount[i]) {
+			return base::take(bufferSamples[i]);
+		}
+	}
+	return QByteArray();
+}
+
 void Mixer::Track::setExternalData(
 		std::unique_ptr<ExternalSoundData> data) {
 #ifndef TDESKTOP_DISABLE_OPENAL_EFFECTS
@@ -1674,13 +1687,22 @@ public:
 
 		auto fmt = format();
 		auto peak = uint16(0);
-		auto callback = [&](uint16 sample) {
-			accumulate_max(peak, sample);
-			sumbytes += Media::Player::kWaveformSamplesCount;
-			if (sumbytes >= countbytes) {
-				sumbytes -= countbytes;
-				peaks.push_back(peak);
-				peak = 0;
+		const auto feed = [&](auto samples, int64 count) {
+			constexpr auto kStep = int64(Media::Player::kWaveformSamplesCount);
+			while (count > 0) {
+				// Each sample adds kStep to sumbytes, so we find the peak
+				// of all the samples till the next waveform value at once.
+				const auto till = (countbytes - sumbytes + kStep - 1) / kStep;
+				const auto portion = std::min(count, std::max(till, int64(1)));
+				accumulate_max(peak, Media::Audio::MaxSample(samples, portion));
+				sumbytes += portion * kStep;
+				samples += portion;
+				count -= portion;
+				if (sumbytes >= countbytes) {
+					sumbytes -= countbytes;
+					peaks.push_back(peak);
+					peak = 0;
+				}
 			}
 		};
 		while (processed < countbytes) {
@@ -1695,11 +1717,14 @@ public:
 				continue;
 			}
 
-			auto sampleBytes = bytes::make_span(buffer);
 			if (fmt == AL_FORMAT_MONO8 || fmt == AL_FORMAT_STEREO8) {
-				Media::Audio::IterateSamples<uchar>(sampleBytes, callback);
+				feed(
+					reinterpret_cast<const uchar*>(buffer.constData()),
+					buffer.size());
 			} else if (fmt == AL_FORMAT_MONO16 || fmt == AL_FORMAT_STEREO16) {
-				Media::Audio::IterateSamples<int16>(sampleBytes, callback);
+				feed(
+					reinterpret_cast<const int16*>(buffer.constData()),
+					buffer.size() / int(sizeof(int16)));
 			}
 			processed += sampleSize() * samples;
 		}
@@ -211,6 +211,9 @@ private:
 
 		int getNotQueuedBufferIndex();
 
+		// Storage of the first not queued buffer, to be filled and returned.
+		QByteArray takeFreeBuffer();
+
 		void setExternalData(std::unique_ptr<ExternalSoundData> data);
 #ifndef TDESKTOP_DISABLE_OPENAL_EFFECTS
 		void changeSpeedEffect(float64 speed);
@@ -380,6 +383,16 @@ TG_FORCE_INLINE uint16 ReadOneSample(int16 data) {
 	return qAbs(data);
 }
 
+// A plain loop over the contiguous samples, the compiler vectorizes it.
+template <typename SampleType>
+uint16 MaxSample(const SampleType *samples, int64 count) {
+	auto result = uint16(0);
+	for (auto i = int64(0); i != count; ++i) {
+		result = std::max(result, ReadOneSample(samples[i]));
+	}
+	return result;
+}
+
 template <typename SampleType, typename Callback>
 void IterateSamples(bytes::const_span bytes, Callback &&callback) {
 	auto samplesPointer = reinterpret_cast<const SampleType*>(bytes.data());
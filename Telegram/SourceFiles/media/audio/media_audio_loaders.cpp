@@ -17,6 +17,9 @@ namespace {
 
 constexpr auto kPlaybackBufferSize = 256 * 1024;
 
+// The last decoded frame is appended above the playback buffer size.
+constexpr auto kPlaybackBufferReserve = kPlaybackBufferSize + 64 * 1024;
+
 } // namespace
 
 Loaders::Loaders(QThread *thread)
@@ -166,7 +169,13 @@ void Loaders::loadData(AudioMsgId audio, crl::time positionMs) {
 	int64 samplesCount = 0;
 	if (l->holdsSavedDecodedSamples()) {
 		l->takeSavedDecodedSamples(&samples, &samplesCount);
+	} else {
+		QMutexLocker lock(internal::audioPlayerMutex());
+		if (const auto track = checkLoader(type)) {
+			samples = track->takeFreeBuffer();
+		}
 	}
+	samples.reserve(kPlaybackBufferReserve);
 	while (samples.size() < kPlaybackBufferSize) {
 		auto res = l->readMore(samples, samplesCount);
 		using Result = AudioPlayerLoader::ReadResult;
@@ -248,10 +257,11 @@ void Loaders::loadData(AudioMsgId audio, crl::time positionMs) {
 			l->setForceToBuffer(false);
 		}
 
-		track->bufferSamples[bufferIndex] = samples;
+		auto &buffer = track->bufferSamples[bufferIndex];
+		buffer = std::move(samples);
 		track->samplesCount[bufferIndex] = samplesCount;
 		track->bufferedLength += samplesCount;
-		alBufferData(track->stream.buffers[bufferIndex], track->format, samples.constData(), samples.size(), track->frequency);
+		alBufferData(track->stream.buffers[bufferIndex], track->format, buffer.constData(), buffer.size(), track->frequency);
 
 		alSourceQueueBuffers(track->stream.source, 1, track->stream.buffers + bufferIndex);
 
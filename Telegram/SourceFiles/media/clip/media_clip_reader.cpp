@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/file_download.h"
 #include "media/clip/media_clip_ffmpeg.h"
 #include "media/clip/media_clip_check_streaming.h"
+#include "media/streaming/media_streaming_utility.h"
 #include "mainwidget.h"
 #include "mainwindow.h"
 
@@ -25,9 +26,21 @@ namespace Media {
 namespace Clip {
 namespace {
 
+// Each thread plays many clips, so only more cores benefit from more threads.
+constexpr auto kMinThreadsCount = 2;
+constexpr auto kMaxThreadsCount = 16;
+
 QVector<QThread*> threads;
 QVector<Manager*> managers;
 
+int ThreadsCount() {
+	static const auto result = std::clamp(
+		QThread::idealThreadCount(),
+		kMinThreadsCount,
+		kMaxThreadsCount);
+	return result;
+}
+
 QImage PrepareFrameImage(const FrameRequest &request, const QImage &original, bool hasAlpha, QImage &cache) {
 	auto needResize = (original.width() != request.framew) || (original.height() != request.frameh);
 	auto needOuterFill = (request.outerw != request.framew) || (request.outerh != request.frameh);
@@ -39,7 +52,7 @@ QImage PrepareFrameImage(const FrameRequest &request, const QImage &original, bo
 	auto factor = request.factor;
 	auto needNewCache = (cache.width() != request.outerw || cache.height() != request.outerh);
 	if (needNewCache) {
-		cache = QImage(request.outerw, request.outerh, QImage::Format_ARGB32_Premultiplied);
+		cache = Streaming::CreateFrameStorage(QSize(request.outerw, request.outerh));
 		cache.setDevicePixelRatio(factor);
 	}
 	{
@@ -106,7 +119,7 @@ Reader::Reader(const QByteArray &data, Callback &&callback, Mode mode, crl::time
 }
 
 void Reader::init(const FileLocation &location, const QByteArray &data) {
-	if (threads.size() < ClipThreadsCount) {
+	if (threads.size() < ThreadsCount()) {
 		_threadIndex = threads.size();
 		threads.push_back(new QThread());
 		managers.push_back(new Manager(threads.back()));
@@ -39,6 +39,9 @@ constexpr auto kIdsLimit = 32;
 // Preload next messages if we went further from current than that.
 constexpr auto kIdsPreloadAfter = 28;
 
+// Start loading the next track if the current one ends sooner than that.
+constexpr auto kPrefetchNextBefore = 10 * crl::time(1000);
+
 } // namespace
 
 void start(not_null<Audio::Instance*> instance) {
@@ -305,6 +308,35 @@ bool Instance::moveInPlaylist(
 	return false;
 }
 
+void Instance::checkPrefetchNext(not_null<Data*> data) {
+	if (!data->streamed || !data->playlistIndex || data->repeatEnabled) {
+		return;
+	}
+	const auto &state = data->streamed->info.audio.state;
+	if (state.duration == kTimeUnknown
+		|| (state.receivedTill < state.duration
+			&& state.position + kPrefetchNextBefore < state.duration)) {
+		return;
+	}
+	const auto item = itemByIndex(data, *data->playlistIndex + 1);
+	const auto media = item ? item->media() : nullptr;
+	const auto document = media ? media->document() : nullptr;
+	if (!document
+		|| (!document->isAudioFile()
+			&& !document->isVoiceMessage()
+			&& !document->isVideoMessage())) {
+		return;
+	}
+	// Keep the Reader alive so that play() gets it from the Data::Session.
+	auto reader = document->owner().documentStreamedReader(
+		document,
+		item->fullId());
+	if (reader && reader != data->prefetched) {
+		reader->startPrefetch();
+		data->prefetched = std::move(reader);
+	}
+}
+
 bool Instance::previousAvailable(AudioMsgId::Type type) const {
 	const auto data = getData(type);
 	Assert(data != nullptr);
@@ -391,6 +423,7 @@ void Instance::playStreamed(
 		audioId,
 		&audioId.audio()->owner(),
 		std::move(reader));
+	data->prefetched = nullptr;
 
 	data->streamed->player.updates(
 	) | rpl::start_with_next_error([=](Streaming::Update &&update) {
@@ -444,6 +477,7 @@ void Instance::stop(AudioMsgId::Type type) {
 		if (data->streamed) {
 			clearStreamed(data);
 		}
+		data->prefetched = nullptr;
 		data->resumeOnCallEnd = false;
 	}
 }
@@ -703,9 +737,11 @@ void Instance::handleStreamingUpdate(
 	}, [&](PreloadedAudio &update) {
 		data->streamed->info.audio.state.receivedTill = update.till;
 		//emitUpdate(data->type, [](AudioMsgId) { return true; });
+		checkPrefetchNext(data);
 	}, [&](UpdateAudio &update) {
 		data->streamed->info.audio.state.position = update.position;
 		emitUpdate(data->type);
+		checkPrefetchNext(data);
 	}, [&](WaitingForData) {
 	}, [&](MutedByOther) {
 	}, [&](Finished) {
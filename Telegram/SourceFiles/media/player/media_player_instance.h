@@ -184,6 +184,7 @@ private:
 		bool isPlaying = false;
 		bool resumeOnCallEnd = false;
 		std::unique_ptr<Streamed> streamed;
+		std::shared_ptr<Streaming::Reader> prefetched;
 	};
 
 	Instance();
@@ -214,6 +215,7 @@ private:
 	void playlistUpdated(not_null<Data*> data);
 	bool moveInPlaylist(not_null<Data*> data, int delta, bool autonext);
 	HistoryItem *itemByIndex(not_null<Data*> data, int index);
+	void checkPrefetchNext(not_null<Data*> data);
 
 	void handleStreamingUpdate(
 		not_null<Data*> data,
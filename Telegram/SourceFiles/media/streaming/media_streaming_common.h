@@ -103,6 +103,21 @@ struct Update {
 		Finished> data;
 };
 
+struct Statistics {
+	crl::time buffered = kTimeUnknown;
+	int stallsCount = 0;
+	crl::time stallsDuration = 0;
+
+	int framesDecoded = 0;
+	int framesDropped = 0;
+	int64 decodeTimeAverage = 0; // In microseconds.
+	bool hardwareDecoding = false;
+
+	int cacheReads = 0;
+	int cacheHits = 0;
+	int64 bytesPerSecond = 0;
+};
+
 enum class Error {
 	OpenFailed,
 	LoadFailed,
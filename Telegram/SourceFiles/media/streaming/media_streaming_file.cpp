@@ -16,6 +16,35 @@ namespace {
 
 constexpr auto kMaxSingleReadAmount = 8 * 1024 * 1024;
 
+[[nodiscard]] std::vector<SeekPoint> ReadSeekIndex(
+		not_null<AVStream*> stream,
+		int size) {
+	auto result = std::vector<SeekPoint>();
+	const auto till = stream->index_entries + stream->nb_index_entries;
+	for (auto entry = stream->index_entries; entry != till; ++entry) {
+		const auto position = PtsToTime(entry->timestamp, stream->time_base);
+		if ((entry->flags & AVINDEX_KEYFRAME)
+			&& (position != kTimeUnknown && position >= 0)
+			&& (entry->pos >= 0 && entry->pos < size)
+			&& (result.empty() || result.back().position <= position)) {
+			result.push_back({ position, int(entry->pos) });
+		}
+	}
+	return result;
+}
+
+// Bytes per second.
+[[nodiscard]] int64 ComputeBitrate(
+		not_null<AVFormatContext*> format,
+		int size) {
+	if (format->bit_rate > 0) {
+		return format->bit_rate / 8;
+	} else if (format->duration > 0) {
+		return size * int64(AV_TIME_BASE) / format->duration;
+	}
+	return 0;
+}
+
 } // namespace
 
 File::Context::Context(
@@ -135,7 +164,7 @@ Stream File::Context::initStream(
 		}
 	}
 
-	result.codec = MakeCodecPointer(info);
+	result.codec = MakeCodecPointer(info, (type == AVMEDIA_TYPE_VIDEO));
 	if (!result.codec) {
 		return result;
 	}
@@ -247,6 +276,13 @@ void File::Context::start(crl::time position) {
 	}
 
 	_reader->headerDone();
+	if (const auto bitrate = ComputeBitrate(format.get(), _size)) {
+		_reader->setBitrate(bitrate);
+	}
+	if (video.codec || audio.codec) {
+		const auto index = (video.codec ? video : audio).index;
+		_reader->setSeekIndex(ReadSeekIndex(format->streams[index], _size));
+	}
 	if (_reader->isRemoteLoader()) {
 		sendFullInCache(true);
 	}
@@ -355,6 +391,7 @@ void File::start(not_null<FileDelegate*> delegate, crl::time position) {
 	stop(true);
 
 	_reader->startStreaming();
+	_reader->prefetchForSeek(position);
 	_context.emplace(delegate, _reader.get());
 	_thread = std::thread([=, context = &*_context] {
 		context->start(position);
@@ -383,6 +420,10 @@ bool File::isRemoteLoader() const {
 	return _reader->isRemoteLoader();
 }
 
+void File::fillStatistics(Statistics &statistics) const {
+	_reader->fillStatistics(statistics);
+}
+
 File::~File() {
 	stop();
 }
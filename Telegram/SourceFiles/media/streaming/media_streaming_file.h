@@ -36,6 +36,7 @@ public:
 	void stop(bool stillActive = false);
 
 	[[nodiscard]] bool isRemoteLoader() const;
+	void fillStatistics(Statistics &statistics) const;
 
 	~File();
 
@@ -16,7 +16,13 @@ namespace Media {
 namespace Streaming {
 namespace {
 
-constexpr auto kMaxConcurrentRequests = 4;
+// The amount of parallel requests grows while parts are waiting in queue
+// and responses are fast, and falls back when responses are slow.
+constexpr auto kMinConcurrentRequests = 2;
+constexpr auto kDefaultConcurrentRequests = 4;
+constexpr auto kMaxConcurrentRequests = 8;
+constexpr auto kFastRequestDuration = crl::time(1000);
+constexpr auto kSlowRequestDuration = 4 * crl::time(1000);
 
 } // namespace
 
@@ -29,7 +35,8 @@ LoaderMtproto::LoaderMtproto(
 , _location(location)
 , _dcId(location.dcId())
 , _size(size)
-, _origin(origin) {
+, _origin(origin)
+, _concurrentRequests(kDefaultConcurrentRequests) {
 }
 
 LoaderMtproto::~LoaderMtproto() {
@@ -109,8 +116,22 @@ void LoaderMtproto::changeRequestedAmount(int index, int amount) {
 	_amountByDcIndex[index] += amount;
 }
 
+void LoaderMtproto::updateConcurrentRequests(crl::time duration) {
+	if (duration >= kSlowRequestDuration) {
+		_concurrentRequests = std::max(
+			_concurrentRequests / 2,
+			kMinConcurrentRequests);
+	} else if (duration < kFastRequestDuration
+		&& _requested.front().has_value()
+		&& _requests.size() >= _concurrentRequests) {
+		_concurrentRequests = std::min(
+			_concurrentRequests + 1,
+			kMaxConcurrentRequests);
+	}
+}
+
 void LoaderMtproto::sendNext() {
-	if (_requests.size() >= kMaxConcurrentRequests) {
+	if (_requests.size() >= _concurrentRequests) {
 		return;
 	}
 	const auto offset = _requested.take().value_or(-1);
@@ -122,12 +143,14 @@ void LoaderMtproto::sendNext() {
 	changeRequestedAmount(index, kPartSize);
 
 	const auto usedFileReference = _location.fileReference();
+	const auto started = crl::now();
 	const auto id = _sender.request(MTPupload_GetFile(
 		_location.tl(Auth().userId()),
 		MTP_int(offset),
 		MTP_int(kPartSize)
 	)).done([=](const MTPupload_File &result) {
 		changeRequestedAmount(index, -kPartSize);
+		updateConcurrentRequests(crl::now() - started);
 		requestDone(offset, result);
 	}).fail([=](const RPCError &error) {
 		changeRequestedAmount(index, -kPartSize);
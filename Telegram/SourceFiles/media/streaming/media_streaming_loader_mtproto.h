@@ -45,6 +45,7 @@ public:
 
 private:
 	void sendNext();
+	void updateConcurrentRequests(crl::time duration);
 
 	void requestDone(int offset, const MTPupload_File &result);
 	void requestFailed(
@@ -74,6 +75,7 @@ private:
 
 	PriorityQueue _requested;
 	base::flat_map<int, mtpRequestId> _requests;
+	int _concurrentRequests = 0;
 	base::flat_map<int, int> _amountByDcIndex;
 	rpl::event_stream<LoadedPart> _parts;
 
@@ -622,9 +622,24 @@ bool Player::receivedTillEnd() const {
 		&& (!_audio || FullTrackReceived(_information.audio.state));
 }
 
+void Player::startStall() {
+	if (_stallStarted == kTimeUnknown) {
+		_stallStarted = crl::now();
+		++_stallsCount;
+	}
+}
+
+void Player::finishStall() {
+	if (_stallStarted != kTimeUnknown) {
+		_stallsDuration += crl::now() - _stallStarted;
+		_stallStarted = kTimeUnknown;
+	}
+}
+
 void Player::checkResumeFromWaitingForData() {
 	if (_pausedByWaitingForData && bothReceivedEnough(kBufferFor)) {
 		_pausedByWaitingForData = false;
+		finishStall();
 		updatePausedState();
 		_updates.fire({ WaitingForData{ false } });
 	}
@@ -643,6 +658,7 @@ void Player::start() {
 		return !bothReceivedEnough(kBufferFor);
 	}) | rpl::start_with_next([=] {
 		_pausedByWaitingForData = true;
+		startStall();
 		updatePausedState();
 		_updates.fire({ WaitingForData{ true } });
 	}, _sessionLifetime);
@@ -704,6 +720,7 @@ void Player::stop(bool stillActive) {
 	_audio = nullptr;
 	_video = nullptr;
 	invalidate_weak_ptrs(&_sessionGuard);
+	finishStall();
 	_pausedByUser = _pausedByWaitingForData = _paused = false;
 	_renderFrameTimer.cancel();
 	_nextFrameTime = kTimeUnknown;
@@ -784,6 +801,36 @@ rpl::producer<bool> Player::fullInCache() const {
 	return _fullInCache.events();
 }
 
+Statistics Player::statistics() const {
+	auto result = Statistics();
+	_file->fillStatistics(result);
+	if (_video) {
+		_video->fillStatistics(result);
+	}
+	const auto bufferedInTrack = [&](const TrackState &state) {
+		return (state.position != kTimeUnknown
+			&& state.receivedTill != kTimeUnknown)
+			? std::max(state.receivedTill - state.position, crl::time(0))
+			: kTimeUnknown;
+	};
+	const auto buffered = [&](crl::time a, crl::time b) {
+		return (a == kTimeUnknown)
+			? b
+			: (b == kTimeUnknown)
+			? a
+			: std::min(a, b);
+	};
+	result.buffered = buffered(
+		_audio ? bufferedInTrack(_information.audio.state) : kTimeUnknown,
+		_video ? bufferedInTrack(_information.video.state) : kTimeUnknown);
+	result.stallsCount = _stallsCount;
+	result.stallsDuration = _stallsDuration
+		+ ((_stallStarted != kTimeUnknown)
+			? (crl::now() - _stallStarted)
+			: crl::time(0));
+	return result;
+}
+
 QSize Player::videoSize() const {
 	return _information.video.size;
 }
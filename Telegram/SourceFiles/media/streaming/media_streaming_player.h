@@ -59,6 +59,8 @@ public:
 	[[nodiscard]] rpl::producer<Update, Error> updates() const;
 	[[nodiscard]] rpl::producer<bool> fullInCache() const;
 
+	[[nodiscard]] Statistics statistics() const;
+
 	[[nodiscard]] QSize videoSize() const;
 	[[nodiscard]] QImage frame(const FrameRequest &request) const;
 
@@ -104,6 +106,8 @@ private:
 	void videoPlayedTill(crl::time position);
 
 	void updatePausedState();
+	void startStall();
+	void finishStall();
 	[[nodiscard]] bool trackReceivedEnough(
 		const TrackState &state,
 		crl::time amount) const;
@@ -176,6 +180,9 @@ private:
 	crl::time _startedTime = kTimeUnknown;
 	crl::time _pausedTime = kTimeUnknown;
 	crl::time _nextFrameTime = kTimeUnknown;
+	crl::time _stallStarted = kTimeUnknown;
+	crl::time _stallsDuration = 0;
+	int _stallsCount = 0;
 	base::Timer _renderFrameTimer;
 	rpl::event_stream<Update, Error> _updates;
 	rpl::event_stream<bool> _fullInCache;
@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "media/streaming/media_streaming_loader.h"
 #include "storage/cache/storage_cache_database.h"
 #include "data/data_session.h"
+#include "base/memory_usage.h"
 
 namespace Media {
 namespace Streaming {
@@ -24,12 +25,46 @@ constexpr auto kMaxOnlyInHeader = 80 * kPartSize;
 constexpr auto kPartsOutsideFirstSliceGood = 8;
 constexpr auto kSlicesInMemory = 2;
 
-// 1 MB of parts are requested from cloud ahead of reading demand.
+// If all readers together hold more slices they keep only the last one.
+constexpr auto kSlicesInMemoryTotal = 8;
+
+// At least 1 MB of parts are requested from cloud ahead of reading demand.
+// For high bitrates the amount grows to cover some time of playback.
 constexpr auto kPreloadPartsAhead = 8;
+constexpr auto kPreloadPartsAheadMax = 32;
+constexpr auto kPreloadTimeAhead = 2 * crl::time(1000);
 constexpr auto kDownloaderRequestsLimit = 4;
 
+// Before the file is played only the beginning of it is loaded.
+constexpr auto kPrefetchPartsCount = 8;
+
+// Slice numbers take the lower 16 bits of the base cache key.
+constexpr auto kSeekIndexSliceNumber = 0xFFFF;
+constexpr auto kSeekIndexMaxPoints = 64 * 1024;
+
+// Download speed is measured over windows of this duration.
+constexpr auto kLoadedBytesWindow = crl::time(1000);
+
 using PartsMap = base::flat_map<int, QByteArray>;
 
+std::atomic<int> SlicesInMemoryTotal = 0;
+
+int64 CountBytes(const PartsMap &parts) {
+	auto result = int64();
+	for (const auto &[offset, bytes] : parts) {
+		result += bytes.size();
+	}
+	return result;
+}
+
+void PartsAllocated(int64 bytes) {
+	base::memory::Allocated(base::memory::Tag::StreamingSlices, bytes);
+}
+
+void PartsFreed(int64 bytes) {
+	base::memory::Freed(base::memory::Tag::StreamingSlices, bytes);
+}
+
 struct ParsedCacheEntry {
 	PartsMap parts;
 	std::optional<PartsMap> included;
@@ -191,6 +226,45 @@ void CopyLoaded(bytes::span buffer, Range &&parts, int offset, int till) {
 	}
 }
 
+QByteArray SerializeSeekIndex(const std::vector<SeekPoint> &index) {
+	auto result = QByteArray();
+	QDataStream stream(&result, QIODevice::WriteOnly);
+	stream.setVersion(QDataStream::Qt_5_1);
+	stream << qint32(index.size());
+	for (const auto &point : index) {
+		stream << qint64(point.position) << qint32(point.offset);
+	}
+	return result;
+}
+
+std::vector<SeekPoint> ParseSeekIndex(const QByteArray &data, int size) {
+	QDataStream stream(data);
+	stream.setVersion(QDataStream::Qt_5_1);
+	auto count = qint32();
+	stream >> count;
+	if (stream.status() != QDataStream::Ok
+		|| count <= 0
+		|| count > kSeekIndexMaxPoints) {
+		return {};
+	}
+	auto result = std::vector<SeekPoint>();
+	result.reserve(count);
+	for (auto i = 0; i != count; ++i) {
+		auto position = qint64();
+		auto offset = qint32();
+		stream >> position >> offset;
+		if (stream.status() != QDataStream::Ok
+			|| position < 0
+			|| offset < 0
+			|| offset >= size
+			|| (!result.empty() && result.back().position > position)) {
+			return {};
+		}
+		result.push_back({ crl::time(position), int(offset) });
+	}
+	return result;
+}
+
 } // namespace
 
 template <int Size>
@@ -226,6 +300,7 @@ struct Reader::CacheHelper {
 	QMutex mutex;
 	base::flat_map<int, PartsMap> results;
 	std::vector<int> sizes;
+	std::optional<std::vector<SeekPoint>> seekIndex;
 	std::atomic<crl::semaphore*> waiting = nullptr;
 };
 
@@ -247,9 +322,13 @@ void Reader::Slice::processCacheData(PartsMap &&data) {
 	});
 	if (parts.empty()) {
 		parts = std::move(data);
+		PartsAllocated(CountBytes(parts));
 	} else {
 		for (auto &[offset, bytes] : data) {
-			parts.emplace(offset, std::move(bytes));
+			const auto size = bytes.size();
+			if (parts.emplace(offset, std::move(bytes)).second) {
+				PartsAllocated(size);
+			}
 		}
 	}
 }
@@ -257,20 +336,21 @@ void Reader::Slice::processCacheData(PartsMap &&data) {
 void Reader::Slice::addPart(int offset, QByteArray bytes) {
 	Expects(!parts.contains(offset));
 
+	PartsAllocated(bytes.size());
 	parts.emplace(offset, std::move(bytes));
 	if (flags & Flag::LoadedFromCache) {
 		flags |= Flag::ChangedSinceCache;
 	}
 }
 
-auto Reader::Slice::prepareFill(int from, int till) -> PrepareFillResult {
+auto Reader::Slice::prepareFill(int from, int till, int preloadParts)
+-> PrepareFillResult {
 	auto result = PrepareFillResult();
 
 	result.ready = false;
 	const auto fromOffset = (from / kPartSize) * kPartSize;
 	const auto tillPart = (till + kPartSize - 1) / kPartSize;
-	const auto preloadTillOffset = (tillPart + kPreloadPartsAhead)
-		* kPartSize;
+	const auto preloadTillOffset = (tillPart + preloadParts) * kPartSize;
 
 	const auto after = ranges::upper_bound(
 		parts,
@@ -334,7 +414,8 @@ auto Reader::Slice::offsetsFromLoader(int from, int till) const
 }
 
 Reader::Slices::Slices(int size, bool useCache)
-: _size(size) {
+: _size(size)
+, _preloadParts(kPreloadPartsAhead) {
 	Expects(size > 0);
 
 	if (useCache) {
@@ -347,6 +428,18 @@ Reader::Slices::Slices(int size, bool useCache)
 	}
 }
 
+Reader::Slices::~Slices() {
+	SlicesInMemoryTotal.fetch_sub(
+		int(_usedSlices.size()),
+		std::memory_order_relaxed);
+
+	auto memory = CountBytes(_header.parts);
+	for (const auto &slice : _data) {
+		memory += CountBytes(slice.parts);
+	}
+	PartsFreed(memory);
+}
+
 bool Reader::Slices::headerModeUnknown() const {
 	return (_headerMode == HeaderMode::Unknown);
 }
@@ -382,6 +475,12 @@ void Reader::Slices::headerDone(bool fromCache) {
 	}
 }
 
+void Reader::Slices::setPreloadParts(int count) {
+	static_assert(kPreloadPartsAheadMax <= kLoadFromRemoteMax);
+
+	_preloadParts = std::clamp(count, kPreloadPartsAhead, kPreloadPartsAheadMax);
+}
+
 int Reader::Slices::headerSize() const {
 	return _header.parts.size() * kPartSize;
 }
@@ -596,9 +695,15 @@ auto Reader::Slices::fill(int offset, bytes::span buffer) -> FillResult {
 	const auto firstTill = std::min(kInSlice, till - fromSlice * kInSlice);
 	const auto secondFrom = 0;
 	const auto secondTill = till - (fromSlice + 1) * kInSlice;
-	const auto first = _data[fromSlice].prepareFill(firstFrom, firstTill);
+	const auto first = _data[fromSlice].prepareFill(
+		firstFrom,
+		firstTill,
+		_preloadParts);
 	const auto second = (fromSlice + 1 < tillSlice)
-		? _data[fromSlice + 1].prepareFill(secondFrom, secondTill)
+		? _data[fromSlice + 1].prepareFill(
+			secondFrom,
+			secondTill,
+			_preloadParts)
 		: Slice::PrepareFillResult();
 	handlePrepareResult(fromSlice, first);
 	if (fromSlice + 1 < tillSlice) {
@@ -636,7 +741,7 @@ auto Reader::Slices::fillFromHeader(int offset, bytes::span buffer)
 	const auto from = offset;
 	const auto till = int(offset + buffer.size());
 
-	const auto prepared = _header.prepareFill(from, till);
+	const auto prepared = _header.prepareFill(from, till, _preloadParts);
 	for (const auto full : prepared.offsetsFromLoader.values()) {
 		if (full < _size) {
 			result.offsetsFromLoader.add(full);
@@ -688,6 +793,7 @@ void Reader::Slices::markSliceUsed(int sliceIndex) {
 	const auto end = _usedSlices.end();
 	if (i == end) {
 		_usedSlices.push_back(sliceIndex);
+		SlicesInMemoryTotal.fetch_add(1, std::memory_order_relaxed);
 	} else {
 		const auto next = i + 1;
 		if (next != end) {
@@ -703,12 +809,14 @@ int Reader::Slices::maxSliceSize(int sliceNumber) const {
 Reader::SerializedSlice Reader::Slices::serializeAndUnloadUnused() {
 	using Flag = Slice::Flag;
 
-	if (_headerMode == HeaderMode::Unknown
-		|| _usedSlices.size() <= kSlicesInMemory) {
+	const auto total = SlicesInMemoryTotal.load(std::memory_order_relaxed);
+	const auto limit = (total > kSlicesInMemoryTotal) ? 1 : kSlicesInMemory;
+	if (_headerMode == HeaderMode::Unknown || _usedSlices.size() <= limit) {
 		return {};
 	}
 	const auto purgeSlice = _usedSlices.front();
 	_usedSlices.pop_front();
+	SlicesInMemoryTotal.fetch_sub(1, std::memory_order_relaxed);
 	if (!(_data[purgeSlice].flags & Flag::LoadedFromCache)) {
 		// If the only data in this slice was from _header, just leave it.
 		return {};
@@ -791,6 +899,7 @@ Reader::SerializedSlice Reader::Slices::serializeAndUnloadSlice(
 
 void Reader::Slices::unloadSlice(Slice &slice) const {
 	const auto full = (slice.flags & Slice::Flag::FullInCache);
+	PartsFreed(CountBytes(slice.parts));
 	slice = Slice();
 	if (full) {
 		slice.flags |= Slice::Flag::FullInCache;
@@ -822,7 +931,11 @@ QByteArray Reader::Slices::serializeAndUnloadFirstSliceNoHeader() {
 
 	auto &slice = _data[0];
 	for (const auto &[offset, part] : _header.parts) {
-		slice.parts.erase(offset);
+		const auto i = slice.parts.find(offset);
+		if (i != end(slice.parts)) {
+			PartsFreed(i->second.size());
+			slice.parts.erase(i);
+		}
 	}
 	auto result = serializeComplexSlice(slice);
 	unloadSlice(slice);
@@ -854,10 +967,11 @@ Reader::Reader(
 , _slices(_loader->size(), _cacheHelper != nullptr) {
 	_loader->parts(
 	) | rpl::start_with_next([=](LoadedPart &&part) {
+		countLoadedBytes(part.bytes.size());
 		if (_attachedDownloader) {
 			_partsForDownloader.fire_copy(part);
 		}
-		if (_streamingActive) {
+		if (_streamingActive || _prefetchActive) {
 			_loadedParts.emplace(std::move(part));
 		}
 		if (const auto waiting = _waiting.load(std::memory_order_acquire)) {
@@ -868,6 +982,7 @@ Reader::Reader(
 
 	if (_cacheHelper) {
 		readFromCache(0);
+		readSeekIndexFromCache();
 	}
 }
 
@@ -889,6 +1004,7 @@ void Reader::stopSleep() {
 
 void Reader::startStreaming() {
 	_streamingActive = true;
+	_prefetchActive = false;
 }
 
 void Reader::stopStreaming(bool stillActive) {
@@ -902,6 +1018,32 @@ void Reader::stopStreaming(bool stillActive) {
 	}
 }
 
+void Reader::startPrefetch() {
+	if (_streamingActive || _prefetchActive || !_cacheHelper) {
+		return;
+	}
+	_prefetchActive = true;
+	checkPrefetch();
+}
+
+void Reader::checkPrefetch() {
+	if (!_prefetchActive) {
+		return;
+	}
+	processCacheResults();
+	if (_slices.waitingForHeaderCache() || !_slices.headerModeUnknown()) {
+		// Wait for the header from cache or use it if it was found there.
+		return;
+	}
+
+	// Loaded parts wait in _loadedParts until the streaming starts,
+	// so the streaming thread gets them as if it requested them itself.
+	const auto till = std::min(size(), kPrefetchPartsCount * kPartSize);
+	for (auto offset = 0; offset < till; offset += kPartSize) {
+		loadAtOffset(offset);
+	}
+}
+
 rpl::producer<LoadedPart> Reader::partsForDownloader() const {
 	return _partsForDownloader.events();
 }
@@ -1079,12 +1221,34 @@ void Reader::checkCacheResultsForDownloader() {
 		return;
 	}
 	processDownloaderRequests();
+	checkPrefetch();
 }
 
 bool Reader::isRemoteLoader() const {
 	return _loader->baseCacheKey().has_value();
 }
 
+void Reader::countLoadedBytes(int amount) {
+	const auto now = crl::now();
+	if (!_loadedSince) {
+		_loadedSince = now;
+	}
+	_loadedInWindow += amount;
+	if (const auto passed = now - _loadedSince; passed >= kLoadedBytesWindow) {
+		_bytesPerSecond = _loadedInWindow * 1000 / passed;
+		_loadedInWindow = 0;
+		_loadedSince = now;
+	}
+}
+
+void Reader::fillStatistics(Statistics &statistics) const {
+	const auto stale = _loadedSince
+		&& (crl::now() - _loadedSince >= 2 * kLoadedBytesWindow);
+	statistics.cacheReads = _cacheReads.load(std::memory_order_relaxed);
+	statistics.cacheHits = _cacheHits.load(std::memory_order_relaxed);
+	statistics.bytesPerSecond = stale ? 0 : _bytesPerSecond;
+}
+
 std::shared_ptr<Reader::CacheHelper> Reader::InitCacheHelper(
 		std::optional<Storage::Cache::Key> baseKey) {
 	if (!baseKey) {
@@ -1143,6 +1307,85 @@ void Reader::readFromCache(int sliceNumber) {
 	_owner->cacheBigFile().getWithSizes(key, std::move(keys), ready);
 }
 
+void Reader::readSeekIndexFromCache() {
+	Expects(_cacheHelper != nullptr);
+
+	const auto size = _loader->size();
+	const auto cache = std::weak_ptr<CacheHelper>(_cacheHelper);
+	_owner->cacheBigFile().get(
+		_cacheHelper->key(kSeekIndexSliceNumber),
+		[=](QByteArray &&result) {
+			auto index = ParseSeekIndex(result, size);
+			if (const auto strong = cache.lock()) {
+				QMutexLocker lock(&strong->mutex);
+				strong->seekIndex = std::move(index);
+			}
+		});
+}
+
+void Reader::takeSeekIndexFromCache() {
+	if (!_cacheHelper || _seekIndexInCache) {
+		return;
+	}
+	QMutexLocker lock(&_cacheHelper->mutex);
+	if (!_cacheHelper->seekIndex) {
+		return;
+	}
+	auto index = base::take(*_cacheHelper->seekIndex);
+	lock.unlock();
+
+	if (!index.empty()) {
+		_seekIndexInCache = true;
+		if (_seekIndex.empty()) {
+			_seekIndex = std::move(index);
+		}
+	}
+}
+
+void Reader::setSeekIndex(std::vector<SeekPoint> &&index) {
+	if (index.empty()) {
+		return;
+	}
+	takeSeekIndexFromCache();
+	if (_cacheHelper
+		&& !_seekIndexInCache
+		&& int(index.size()) <= kSeekIndexMaxPoints) {
+		_owner->cacheBigFile().put(
+			_cacheHelper->key(kSeekIndexSliceNumber),
+			SerializeSeekIndex(index));
+		_seekIndexInCache = true;
+	}
+	_seekIndex = std::move(index);
+}
+
+void Reader::setBitrate(int64 bytesPerSecond) {
+	const auto ahead = bytesPerSecond * kPreloadTimeAhead / 1000;
+	_slices.setPreloadParts(int((ahead + kPartSize - 1) / kPartSize));
+}
+
+void Reader::prefetchForSeek(crl::time position) {
+	takeSeekIndexFromCache();
+	processCacheResults();
+	if (!position || _seekIndex.empty() || _slices.headerModeUnknown()) {
+		return;
+	}
+	const auto i = ranges::upper_bound(
+		_seekIndex,
+		position,
+		ranges::less(),
+		&SeekPoint::position);
+	if (i == begin(_seekIndex)) {
+		return;
+	}
+
+	// Request the keyframe slice from cache or cloud right away,
+	// while the demuxer is still parsing the header.
+	auto byte = bytes::type();
+	[[maybe_unused]] const auto filled = fillFromSlices(
+		(i - 1)->offset,
+		bytes::span(&byte, 1));
+}
+
 bool Reader::readFromCacheForDownloader(int sliceNumber) {
 	Expects(_cacheHelper != nullptr);
 	Expects(sliceNumber > 0);
@@ -1211,6 +1454,10 @@ bool Reader::fill(
 		return false;
 	};
 
+	if (fillFromLastPart(offset, buffer)) {
+		return true;
+	}
+
 	checkForSomethingMoreReceived();
 	if (_streamingError) {
 		return failed();
@@ -1218,6 +1465,7 @@ bool Reader::fill(
 
 	do {
 		if (fillFromSlices(offset, buffer)) {
+			rememberLastPart(offset, buffer);
 			clearWaiting();
 			return true;
 		}
@@ -1227,6 +1475,31 @@ bool Reader::fill(
 	return _streamingError ? failed() : false;
 }
 
+// The demuxer reads through a small AVIO buffer, so most reads land inside
+// the part of the previous read. Such reads are copied from that part right
+// away, the first read of each part still goes through the slices.
+bool Reader::fillFromLastPart(int offset, bytes::span buffer) const {
+	const auto from = offset - _lastPartOffset;
+	if (_lastPart.isEmpty()
+		|| from < 0
+		|| from + buffer.size() > _lastPart.size()) {
+		return false;
+	}
+	bytes::copy(
+		buffer,
+		bytes::make_span(_lastPart).subspan(from, buffer.size()));
+	return true;
+}
+
+void Reader::rememberLastPart(int offset, bytes::span buffer) {
+	const auto partOffset = offset - (offset % kPartSize);
+	if (offset + buffer.size() > partOffset + kPartSize) {
+		return;
+	}
+	_lastPart = _slices.partForDownloader(partOffset);
+	_lastPartOffset = partOffset;
+}
+
 bool Reader::fillFromSlices(int offset, bytes::span buffer) {
 	using namespace rpl::mappers;
 
@@ -1300,6 +1573,10 @@ bool Reader::processCacheResults() {
 		return false;
 	}
 	for (auto &[sliceNumber, result] : loaded) {
+		_cacheReads.fetch_add(1, std::memory_order_relaxed);
+		if (!result.empty()) {
+			_cacheHits.fetch_add(1, std::memory_order_relaxed);
+		}
 		_slices.processCacheResult(sliceNumber, std::move(result));
 	}
 	if (!sizes.empty()) {
@@ -7,6 +7,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #pragma once
 
+#include "media/streaming/media_streaming_common.h"
 #include "media/streaming/media_streaming_loader.h"
 #include "base/bytes.h"
 #include "base/weak_ptr.h"
@@ -33,6 +34,12 @@ class Loader;
 struct LoadedPart;
 enum class Error;
 
+// Keyframe position in the stream and its offset in the file.
+struct SeekPoint {
+	crl::time position = 0;
+	int offset = 0;
+};
+
 class Reader final : public base::has_weak_ptr {
 public:
 	// Main thread.
@@ -51,6 +58,8 @@ public:
 	void headerDone();
 	[[nodiscard]] int headerSize() const;
 	[[nodiscard]] bool fullInCache() const;
+	void setSeekIndex(std::vector<SeekPoint> &&index);
+	void setBitrate(int64 bytesPerSecond);
 
 	// Thread safe.
 	void startSleep(not_null<crl::semaphore*> wake);
@@ -60,6 +69,11 @@ public:
 	// Main thread.
 	void startStreaming();
 	void stopStreaming(bool stillActive = false);
+	void startPrefetch();
+	void fillStatistics(Statistics &statistics) const;
+
+	// Main thread, before the streaming thread starts.
+	void prefetchForSeek(crl::time position);
 	[[nodiscard]] rpl::producer<LoadedPart> partsForDownloader() const;
 	void loadForDownloader(
 		Storage::StreamedFileDownloader *downloader,
@@ -70,7 +84,7 @@ public:
 	~Reader();
 
 private:
-	static constexpr auto kLoadFromRemoteMax = 8;
+	static constexpr auto kLoadFromRemoteMax = 32;
 
 	struct CacheHelper;
 
@@ -119,7 +133,7 @@ private:
 
 		void processCacheData(PartsMap &&data);
 		void addPart(int offset, QByteArray bytes);
-		PrepareFillResult prepareFill(int from, int till);
+		PrepareFillResult prepareFill(int from, int till, int preloadParts);
 
 		// Get up to kLoadFromRemoteMax not loaded parts in from-till range.
 		StackIntVector<kLoadFromRemoteMax> offsetsFromLoader(
@@ -134,8 +148,10 @@ private:
 	class Slices {
 	public:
 		Slices(int size, bool useCache);
+		~Slices();
 
 		void headerDone(bool fromCache);
+		void setPreloadParts(int count);
 		[[nodiscard]] int headerSize() const;
 		[[nodiscard]] bool fullInCache() const;
 		[[nodiscard]] bool headerWontBeFilled() const;
@@ -186,6 +202,7 @@ private:
 		Slice _header;
 		std::deque<int> _usedSlices;
 		int _size = 0;
+		int _preloadParts = 0;
 		HeaderMode _headerMode = HeaderMode::Unknown;
 		bool _fullInCache = false;
 
@@ -197,6 +214,8 @@ private:
 	[[nodiscard]] bool readFromCacheForDownloader(int sliceNumber);
 	bool processCacheResults();
 	void putToCache(SerializedSlice &&data);
+	void readSeekIndexFromCache();
+	void takeSeekIndexFromCache();
 
 	void cancelLoadInRange(int from, int till);
 	void loadAtOffset(int offset);
@@ -206,9 +225,14 @@ private:
 	bool checkForSomethingMoreReceived();
 
 	bool fillFromSlices(int offset, bytes::span buffer);
+	bool fillFromLastPart(int offset, bytes::span buffer) const;
+	void rememberLastPart(int offset, bytes::span buffer);
 
 	void finalizeCache();
 
+	void checkPrefetch();
+	void countLoadedBytes(int amount);
+
 	void processDownloaderRequests();
 	void checkCacheResultsForDownloader();
 	void pruneDownloaderCache(int minimalOffset);
@@ -236,15 +260,28 @@ private:
 	// Even if streaming had failed, the Reader can work for the downloader.
 	std::optional<Error> _streamingError;
 
+	// Used only when the streaming thread is not working or from it.
+	std::vector<SeekPoint> _seekIndex;
+	bool _seekIndexInCache = false;
+
 	// In case streaming is active both main and streaming threads have work.
 	// In case only downloader is active, all work is done on main thread.
 
+	std::atomic<int> _cacheReads = 0;
+	std::atomic<int> _cacheHits = 0;
+
 	// Main thread.
 	Storage::StreamedFileDownloader *_attachedDownloader = nullptr;
+	crl::time _loadedSince = 0;
+	int64 _loadedInWindow = 0;
+	int64 _bytesPerSecond = 0;
 	rpl::event_stream<LoadedPart> _partsForDownloader;
 	bool _streamingActive = false;
+	bool _prefetchActive = false;
 
 	// Streaming thread.
+	int _lastPartOffset = 0;
+	QByteArray _lastPart;
 	std::deque<int> _offsetsForDownloader;
 	base::flat_set<int> _downloaderOffsetsRequested;
 	base::flat_map<int, std::optional<PartsMap>> _downloaderReadCache;
@@ -12,6 +12,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 extern "C" {
 #include <libavutil/opt.h>
+#include <libavutil/hwcontext.h>
+#include <libavutil/pixdesc.h>
 } // extern "C"
 
 namespace Media {
@@ -25,9 +27,101 @@ constexpr auto kImageFormat = QImage::Format_ARGB32_Premultiplied;
 constexpr auto kAvioBlockSize = 4096;
 constexpr auto kMaxScaleByAspectRatio = 16;
 
+// Small videos are decoded fast enough and there may be many of them,
+// while hardware decoders often support only a few sessions at once.
+constexpr auto kHwDecodeMinPixels = 1280 * 720;
+
+struct HwDeviceType {
+	AVHWDeviceType type = AV_HWDEVICE_TYPE_NONE;
+	AVPixelFormat format = AV_PIX_FMT_NONE;
+};
+
+const auto kHwDeviceTypes = {
+#ifdef Q_OS_WIN
+	HwDeviceType{ AV_HWDEVICE_TYPE_D3D11VA, AV_PIX_FMT_D3D11 },
+	HwDeviceType{ AV_HWDEVICE_TYPE_DXVA2, AV_PIX_FMT_DXVA2_VLD },
+#elif defined Q_OS_MAC // Q_OS_WIN
+	HwDeviceType{ AV_HWDEVICE_TYPE_VIDEOTOOLBOX, AV_PIX_FMT_VIDEOTOOLBOX },
+#else // Q_OS_WIN || Q_OS_MAC
+	HwDeviceType{ AV_HWDEVICE_TYPE_VAAPI, AV_PIX_FMT_VAAPI },
+	HwDeviceType{ AV_HWDEVICE_TYPE_VDPAU, AV_PIX_FMT_VDPAU },
+#endif // Q_OS_WIN || Q_OS_MAC
+};
+
+// Frames of the same size are allocated again and again while playing,
+// so freed frame buffers are kept here until they're needed or evicted.
+constexpr auto kFramePoolSizeLimit = 32 * 1024 * 1024;
+
+class FrameBufferPool final {
+public:
+	[[nodiscard]] uchar *take(int size);
+	void put(uchar *buffer);
+
+private:
+	struct Header {
+		int size = 0;
+	};
+	static constexpr auto kHeaderSize = int(sizeof(Header));
+
+	[[nodiscard]] static int SizeOf(uchar *buffer);
+
+	QMutex _mutex;
+	std::deque<uchar*> _buffers;
+	int _total = 0;
+
+};
+
+uchar *FrameBufferPool::take(int size) {
+	{
+		QMutexLocker lock(&_mutex);
+		const auto i = ranges::find(_buffers, size, &FrameBufferPool::SizeOf);
+		if (i != end(_buffers)) {
+			const auto result = *i;
+			_buffers.erase(i);
+			_total -= size;
+			return result + kHeaderSize;
+		}
+	}
+	const auto result = new uchar[kHeaderSize + size];
+	reinterpret_cast<Header*>(result)->size = size;
+	return result + kHeaderSize;
+}
+
+void FrameBufferPool::put(uchar *buffer) {
+	const auto data = buffer - kHeaderSize;
+	const auto size = SizeOf(data);
+	if (size > kFramePoolSizeLimit) {
+		delete[] data;
+		return;
+	}
+	auto evicted = std::vector<uchar*>();
+	{
+		QMutexLocker lock(&_mutex);
+		_buffers.push_back(data);
+		_total += size;
+		while (_total > kFramePoolSizeLimit) {
+			_total -= SizeOf(_buffers.front());
+			evicted.push_back(_buffers.front());
+			_buffers.pop_front();
+		}
+	}
+	for (const auto buffer : evicted) {
+		delete[] buffer;
+	}
+}
+
+int FrameBufferPool::SizeOf(uchar *buffer) {
+	return reinterpret_cast<const Header*>(buffer)->size;
+}
+
+FrameBufferPool &FramePool() {
+	// Never destroyed, because frames may be freed at any time on exit.
+	static const auto result = new FrameBufferPool();
+	return *result;
+}
+
 void AlignedImageBufferCleanupHandler(void* data) {
-	const auto buffer = static_cast<uchar*>(data);
-	delete[] buffer;
+	FramePool().put(static_cast<uchar*>(data));
 }
 
 [[nodiscard]] bool IsAlignedImage(const QImage &image) {
@@ -35,6 +129,109 @@ void AlignedImageBufferCleanupHandler(void* data) {
 		&& !(image.bytesPerLine() % kAlignImageBy);
 }
 
+AVPixelFormat GetHwFormat(
+		AVCodecContext *context,
+		const AVPixelFormat *formats) {
+	const auto device = context->hw_device_ctx
+		? reinterpret_cast<AVHWDeviceContext*>(context->hw_device_ctx->data)
+		: nullptr;
+	if (device) {
+		for (const auto &entry : kHwDeviceTypes) {
+			if (entry.type != device->type) {
+				continue;
+			}
+			for (auto format = formats; *format != AV_PIX_FMT_NONE; ++format) {
+				if (*format == entry.format) {
+					return entry.format;
+				}
+			}
+		}
+	}
+
+	// Decoder falls back to software if the hardware format wasn't offered.
+	return avcodec_default_get_format(context, formats);
+}
+
+[[nodiscard]] bool HwDecodeAllowed(not_null<AVStream*> stream) {
+	const auto parameters = stream->codecpar;
+	return (parameters->codec_type == AVMEDIA_TYPE_VIDEO)
+		&& (parameters->width * parameters->height >= kHwDecodeMinPixels);
+}
+
+[[nodiscard]] bool InitHwDevice(not_null<AVCodecContext*> context) {
+	for (const auto &entry : kHwDeviceTypes) {
+		auto device = (AVBufferRef*)nullptr;
+		const auto error = AvErrorWrap(av_hwdevice_ctx_create(
+			&device,
+			entry.type,
+			nullptr,
+			nullptr,
+			0));
+		if (!error) {
+			context->hw_device_ctx = device;
+			context->get_format = GetHwFormat;
+			return true;
+		}
+	}
+	return false;
+}
+
+[[nodiscard]] CodecPointer OpenCodec(not_null<AVStream*> stream, bool hw) {
+	auto error = AvErrorWrap();
+
+	auto result = CodecPointer(avcodec_alloc_context3(nullptr));
+	const auto context = result.get();
+	if (!context) {
+		LogError(qstr("avcodec_alloc_context3"));
+		return {};
+	}
+	error = avcodec_parameters_to_context(context, stream->codecpar);
+	if (error) {
+		LogError(qstr("avcodec_parameters_to_context"), error);
+		return {};
+	}
+	av_codec_set_pkt_timebase(context, stream->time_base);
+	av_opt_set_int(context, "refcounted_frames", 1, 0);
+	if (hw && !InitHwDevice(context)) {
+		return {};
+	}
+
+	const auto codec = avcodec_find_decoder(context->codec_id);
+	if (!codec) {
+		LogError(qstr("avcodec_find_decoder"), context->codec_id);
+		return {};
+	} else if ((error = avcodec_open2(context, codec, nullptr))) {
+		LogError(qstr("avcodec_open2"), error);
+		return {};
+	}
+	return result;
+}
+
+// Copy the frame to the system memory right away, so that the decoder
+// doesn't run out of surfaces while decoded frames wait in the queue.
+[[nodiscard]] AvErrorWrap TransferHwFrame(Stream &stream) {
+	if (!stream.transferred) {
+		stream.transferred = MakeFramePointer();
+		if (!stream.transferred) {
+			return AvErrorWrap(AVERROR(ENOMEM));
+		}
+	}
+	const auto hw = stream.frame.get();
+	const auto sw = stream.transferred.get();
+	auto error = AvErrorWrap(av_hwframe_transfer_data(sw, hw, 0));
+	if (!error) {
+		error = av_frame_copy_props(sw, hw);
+	}
+	if (error) {
+		LogError(qstr("av_hwframe_transfer_data"), error);
+		ClearFrameMemory(sw);
+		return error;
+	}
+	ClearFrameMemory(hw);
+	std::swap(stream.frame, stream.transferred);
+	return error;
+}
+
 [[nodiscard]] bool IsValidAspectRatio(AVRational aspect) {
 	return (aspect.num > 0)
 		&& (aspect.den > 0)
@@ -61,7 +258,7 @@ QImage CreateFrameStorage(QSize size) {
 		? (widthAlign - (width % widthAlign))
 		: 0);
 	const auto perLine = neededWidth * kPixelBytesSize;
-	const auto buffer = new uchar[perLine * height + kAlignImageBy];
+	const auto buffer = FramePool().take(perLine * height + kAlignImageBy);
 	const auto cleanupData = static_cast<void *>(buffer);
 	const auto address = reinterpret_cast<uintptr_t>(buffer);
 	const auto alignedBuffer = buffer + ((address % kAlignImageBy)
@@ -153,32 +350,14 @@ void FormatDeleter::operator()(AVFormatContext *value) {
 	}
 }
 
-CodecPointer MakeCodecPointer(not_null<AVStream*> stream) {
-	auto error = AvErrorWrap();
-
-	auto result = CodecPointer(avcodec_alloc_context3(nullptr));
-	const auto context = result.get();
-	if (!context) {
-		LogError(qstr("avcodec_alloc_context3"));
-		return {};
-	}
-	error = avcodec_parameters_to_context(context, stream->codecpar);
-	if (error) {
-		LogError(qstr("avcodec_parameters_to_context"), error);
-		return {};
-	}
-	av_codec_set_pkt_timebase(context, stream->time_base);
-	av_opt_set_int(context, "refcounted_frames", 1, 0);
-
-	const auto codec = avcodec_find_decoder(context->codec_id);
-	if (!codec) {
-		LogError(qstr("avcodec_find_decoder"), context->codec_id);
-		return {};
-	} else if ((error = avcodec_open2(context, codec, nullptr))) {
-		LogError(qstr("avcodec_open2"), error);
-		return {};
+CodecPointer MakeCodecPointer(not_null<AVStream*> stream, bool hwAllowed) {
+	if (hwAllowed && HwDecodeAllowed(stream)) {
+		if (auto result = OpenCodec(stream, true)) {
+			return result;
+		}
+		LOG(("Streaming Info: Falling back to software decoding."));
 	}
-	return result;
+	return OpenCodec(stream, false);
 }
 
 void CodecDeleter::operator()(AVCodecContext *value) {
@@ -227,6 +406,10 @@ SwscalePointer MakeSwscalePointer(
 		return SwscalePointer();
 	}
 
+	// Without scaling sws uses its vectorized special converters,
+	// while the default bicubic scaler is too slow for many small frames.
+	const auto frameSize = QSize(frame->width, frame->height);
+	const auto flags = (resize == frameSize) ? SWS_POINT : SWS_BILINEAR;
 	const auto result = sws_getCachedContext(
 		existing ? existing->release() : nullptr,
 		frame->width,
@@ -235,16 +418,14 @@ SwscalePointer MakeSwscalePointer(
 		resize.width(),
 		resize.height(),
 		AV_PIX_FMT_BGRA,
-		0,
+		flags,
 		nullptr,
 		nullptr,
 		nullptr);
 	if (!result) {
 		LogError(qstr("sws_getCachedContext"));
 	}
-	return SwscalePointer(
-		result,
-		{ resize, QSize{ frame->width, frame->height }, frame->format });
+	return SwscalePointer(result, { resize, frameSize, frame->format });
 }
 
 void SwscaleDeleter::operator()(SwsContext *value) {
@@ -390,9 +571,11 @@ AvErrorWrap ReadNextFrame(Stream &stream) {
 		error = avcodec_receive_frame(
 			stream.codec.get(),
 			stream.frame.get());
-		if (!error
-			|| error.code() != AVERROR(EAGAIN)
-			|| stream.queue.empty()) {
+		if (!error) {
+			return stream.frame->hw_frames_ctx
+				? TransferHwFrame(stream)
+				: error;
+		} else if (error.code() != AVERROR(EAGAIN) || stream.queue.empty()) {
 			return error;
 		}
 
@@ -501,7 +684,18 @@ QImage PrepareByRequest(
 	if (!GoodStorageForFrame(storage, request.outer)) {
 		storage = CreateFrameStorage(request.outer);
 	}
-	{
+	if (original.size() == request.outer
+		&& original.format() == kImageFormat) {
+		// The frame was already scaled by sws, only corners are left.
+		const auto perLine = request.outer.width() * kPixelBytesSize;
+		const auto from = original.constBits();
+		const auto to = storage.bits();
+		const auto fromPerLine = original.bytesPerLine();
+		const auto toPerLine = storage.bytesPerLine();
+		for (auto y = 0, height = request.outer.height(); y != height; ++y) {
+			memcpy(to + y * toPerLine, from + y * fromPerLine, perLine);
+		}
+	} else {
 		Painter p(&storage);
 		PainterHighQualityEnabler hq(p);
 		p.drawImage(QRect(QPoint(), request.outer), original);
@@ -140,7 +140,9 @@ struct CodecDeleter {
 	void operator()(AVCodecContext *value);
 };
 using CodecPointer = std::unique_ptr<AVCodecContext, CodecDeleter>;
-[[nodiscard]] CodecPointer MakeCodecPointer(not_null<AVStream*> stream);
+[[nodiscard]] CodecPointer MakeCodecPointer(
+	not_null<AVStream*> stream,
+	bool hwAllowed = false);
 
 struct FrameDeleter {
 	void operator()(AVFrame *value);
@@ -179,6 +181,7 @@ struct Stream {
 	int rotation = 0;
 	AVRational aspect = kNormalAspect;
 	SwscalePointer swscale;
+	FramePointer transferred;
 };
 
 void LogError(QLatin1String method);
@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "media/audio/media_audio.h"
 #include "base/concurrent_timer.h"
+#include "base/trace.h"
 
 namespace Media {
 namespace Streaming {
@@ -192,6 +193,7 @@ void VideoTrackObject::queueReadFrames(crl::time delay) {
 }
 
 void VideoTrackObject::readFrames() {
+	const auto span = base::trace::Span("readFrames", "streaming");
 	if (interrupted()) {
 		return;
 	}
@@ -233,6 +235,7 @@ auto VideoTrackObject::readEnoughFrames(crl::time trackTime)
 				|| !VideoTrack::IsStale(frame, trackTime)) {
 				return std::nullopt;
 			}
+			_shared->addDropped();
 		}
 	}, [&](Shared::PrepareNextCheck delay) -> ReadEnoughState {
 		return delay;
@@ -265,6 +268,8 @@ crl::time VideoTrackObject::computeDuration() const {
 }
 
 auto VideoTrackObject::readFrame(not_null<Frame*> frame) -> FrameResult {
+	const auto span = base::trace::Span("readFrame", "streaming");
+	const auto started = std::chrono::steady_clock::now();
 	if (const auto error = ReadNextFrame(_stream)) {
 		if (error.code() == AVERROR_EOF) {
 			if (!_options.loop) {
@@ -293,6 +298,10 @@ auto VideoTrackObject::readFrame(not_null<Frame*> frame) -> FrameResult {
 	std::swap(frame->decoded, _stream.frame);
 	frame->position = position;
 	frame->displayed = kTimeUnknown;
+	const auto duration = std::chrono::steady_clock::now() - started;
+	_shared->addDecoded(
+		std::chrono::duration_cast<std::chrono::microseconds>(
+			duration).count());
 	return FrameResult::Done;
 }
 
@@ -662,6 +671,24 @@ auto VideoTrack::Shared::presentFrame(
 	Unexpected("Counter value in VideoTrack::Shared::prepareState.");
 }
 
+void VideoTrack::Shared::addDecoded(int64 microseconds) {
+	_decodeTime.fetch_add(microseconds, std::memory_order_relaxed);
+	_framesDecoded.fetch_add(1, std::memory_order_relaxed);
+}
+
+void VideoTrack::Shared::addDropped() {
+	_framesDropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void VideoTrack::Shared::fillStatistics(Statistics &statistics) const {
+	const auto decoded = _framesDecoded.load(std::memory_order_relaxed);
+	statistics.framesDecoded = decoded;
+	statistics.framesDropped = _framesDropped.load(std::memory_order_relaxed);
+	statistics.decodeTimeAverage = decoded
+		? (_decodeTime.load(std::memory_order_relaxed) / decoded)
+		: 0;
+}
+
 crl::time VideoTrack::Shared::nextFrameDisplayTime() const {
 	const auto frameDisplayTime = [&](int counter) {
 		const auto next = (counter + 1) % (2 * kFramesCount);
@@ -732,6 +759,7 @@ VideoTrack::VideoTrack(
 : _streamIndex(stream.index)
 , _streamTimeBase(stream.timeBase)
 , _streamDuration(stream.duration)
+, _hardwareDecoding(stream.codec && stream.codec->hw_device_ctx)
 //, _streamRotation(stream.rotation)
 //, _streamAspect(stream.aspect)
 , _shared(std::make_unique<Shared>())
@@ -756,6 +784,11 @@ crl::time VideoTrack::streamDuration() const {
 	return _streamDuration;
 }
 
+void VideoTrack::fillStatistics(Statistics &statistics) const {
+	_shared->fillStatistics(statistics);
+	statistics.hardwareDecoding = _hardwareDecoding;
+}
+
 void VideoTrack::process(Packet &&packet) {
 	_wrapped.with([
 		packet = std::move(packet)
@@ -31,6 +31,7 @@ public:
 	[[nodiscard]] int streamIndex() const;
 	[[nodiscard]] AVRational streamTimeBase() const;
 	[[nodiscard]] crl::time streamDuration() const;
+	void fillStatistics(Statistics &statistics) const;
 
 	// Called from the same unspecified thread.
 	void process(Packet &&packet);
@@ -104,6 +105,11 @@ private:
 		[[nodiscard]] crl::time nextFrameDisplayTime() const;
 		[[nodiscard]] not_null<Frame*> frameForPaint();
 
+		// Any thread.
+		void addDecoded(int64 microseconds);
+		void addDropped();
+		void fillStatistics(Statistics &statistics) const;
+
 	private:
 		[[nodiscard]] not_null<Frame*> getFrame(int index);
 		[[nodiscard]] not_null<const Frame*> getFrame(int index) const;
@@ -115,6 +121,10 @@ private:
 		static constexpr auto kFramesCount = 4;
 		std::array<Frame, kFramesCount> _frames;
 
+		std::atomic<int> _framesDecoded = 0;
+		std::atomic<int> _framesDropped = 0;
+		std::atomic<int64> _decodeTime = 0;
+
 	};
 
 	static QImage PrepareFrameByRequest(
@@ -129,6 +139,7 @@ private:
 	const int _streamIndex = 0;
 	const AVRational _streamTimeBase;
 	const crl::time _streamDuration = 0;
+	const bool _hardwareDecoding = false;
 	//const int _streamRotation = 0;
 	//AVRational _streamAspect = kNormalAspect;
 	std::unique_ptr<Shared> _shared;
@@ -59,6 +59,9 @@ constexpr auto kPreloadCount = 4;
 // even though it reports that max texture size is 16384.
 constexpr auto kMaxDisplayImageSize = 4096;
 
+// Each mipmap level is half the size of the previous one.
+constexpr auto kMaxMipmapLevels = 6;
+
 // Preload X message ids before and after current.
 constexpr auto kIdsLimit = 48;
 
@@ -72,6 +75,25 @@ Images::Options VideoThumbOptions(not_null<DocumentData*> document) {
 		: result;
 }
 
+// Decodes the complete scans of a loading progressive jpeg right at the
+// size it is displayed at, libjpeg skips the unneeded detail this way.
+QImage ReadProgressiveScans(const QByteArray &bytes, QSize box) {
+	auto buffer = QBuffer();
+	buffer.setData(bytes);
+	auto reader = QImageReader(&buffer, "JPG");
+	const auto original = reader.size();
+	if (original.isEmpty()) {
+		return QImage();
+	} else if (original.width() > box.width()
+		|| original.height() > box.height()) {
+		reader.setScaledSize(original.scaled(box, Qt::KeepAspectRatio));
+	}
+	auto result = reader.read();
+	return result.isNull()
+		? result
+		: std::move(result).convertToFormat(QImage::Format_RGB32);
+}
+
 void PaintImageProfile(QPainter &p, const QImage &image, QRect rect, QRect fill) {
 	const auto argb = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
 	const auto rgb = image.convertToFormat(QImage::Format_RGB32);
@@ -187,6 +209,10 @@ struct OverlayWidget::Streamed {
 	base::Timer timer;
 	QImage frameForDirectPaint;
 
+	// Shown by Ctrl + D when debug logs are enabled.
+	base::Timer statisticsTimer;
+	bool statisticsShown = false;
+
 	bool withSound = false;
 	bool pausedBySeek = false;
 	bool resumeOnCallEnd = false;
@@ -247,6 +273,7 @@ OverlayWidget::OverlayWidget()
 			subscribe(Auth().downloaderTaskFinished(), [this] {
 				if (!isHidden()) {
 					updateControls();
+					decodePreloadedPhotos();
 				}
 			});
 			subscribe(Auth().calls().currentCallChanged(), [this](Calls::Call *call) {
@@ -982,6 +1009,8 @@ void OverlayWidget::clearData() {
 	_fromName = QString();
 	_photo = nullptr;
 	_doc = nullptr;
+	_preloadedPhotos.clear();
+	_preloadedReaders.clear();
 	_fullScreenVideo = false;
 	_caption.clear();
 }
@@ -1784,6 +1813,8 @@ void OverlayWidget::displayPhoto(not_null<PhotoData*> photo, HistoryItem *item)
 	_zoomToScreen = 0;
 	Auth().downloader().clearPriorities();
 	_blurred = true;
+	_progressiveScans = 0;
+	_progressiveDecoding = false;
 	_current = QPixmap();
 	_down = OverNone;
 	_w = ConvertScale(photo->width());
@@ -2464,8 +2495,40 @@ void OverlayWidget::validatePhotoImage(Image *image, bool blurred) {
 	_blurred = blurred;
 }
 
+void OverlayWidget::validatePhotoProgressive() {
+	const auto large = _photo->large();
+	if (!_blurred || _progressiveDecoding || large->loaded()) {
+		return;
+	}
+	const auto scans = large->progressiveScans();
+	if (scans <= _progressiveScans) {
+		return;
+	}
+	_progressiveDecoding = true;
+	const auto photo = _photo;
+	const auto box = QSize(_width, _height) * cIntRetinaFactor();
+	const auto weak = make_weak(this);
+	crl::async([=, bytes = large->progressiveBytes()] {
+		auto image = ReadProgressiveScans(bytes, box);
+		crl::on_main(weak, [=, image = std::move(image)]() mutable {
+			if (_photo != photo) {
+				return;
+			}
+			_progressiveDecoding = false;
+			_progressiveScans = scans;
+			if (!_blurred || image.isNull()) {
+				return;
+			}
+			_current = Images::PixmapFast(std::move(image));
+			_current.setDevicePixelRatio(cRetinaFactor());
+			update(contentRect());
+		});
+	});
+}
+
 void OverlayWidget::validatePhotoCurrentImage() {
 	validatePhotoImage(_photo->large(), false);
+	validatePhotoProgressive();
 	validatePhotoImage(_photo->thumbnail(), true);
 	validatePhotoImage(_photo->thumbnailSmall(), true);
 	validatePhotoImage(_photo->thumbnailInline(), true);
@@ -2474,6 +2537,82 @@ void OverlayWidget::validatePhotoCurrentImage() {
 	}
 }
 
+void OverlayWidget::paintCurrent(Painter &p, QRect clip) {
+	const auto rect = contentRect();
+	const auto visible = rect.intersected(clip);
+	if (visible.isEmpty()) {
+		return;
+	}
+
+	// Only the visible part of the source is scaled, so a zoomed in
+	// image costs as much as the screen area it covers.
+	const auto &pixmap = currentMipmap(rect.size() * cIntRetinaFactor());
+	const auto scaleX = pixmap.width() / float64(rect.width());
+	const auto scaleY = pixmap.height() / float64(rect.height());
+	const auto source = QRectF(
+		(visible.x() - rect.x()) * scaleX,
+		(visible.y() - rect.y()) * scaleY,
+		visible.width() * scaleX,
+		visible.height() * scaleY);
+	PainterHighQualityEnabler hq(p);
+	p.drawPixmap(QRectF(visible), pixmap, source);
+}
+
+const QPixmap &OverlayWidget::currentMipmap(QSize size) {
+	if (_currentMipmapsKey != _current.cacheKey()) {
+		_currentMipmapsKey = _current.cacheKey();
+		_currentMipmaps.clear();
+		_currentMipmapsGenerating = false;
+	}
+	const auto full = _current.size();
+	auto levels = 0;
+	while (levels < kMaxMipmapLevels
+		&& (full.width() >> (levels + 1)) >= size.width()
+		&& (full.height() >> (levels + 1)) >= size.height()) {
+		++levels;
+	}
+	if (levels > int(_currentMipmaps.size())
+		&& !_currentMipmapsGenerating) {
+		generateCurrentMipmaps(levels);
+	}
+
+	// Until the finer levels are ready the closest one is scaled.
+	const auto ready = std::min(levels, int(_currentMipmaps.size()));
+	return ready ? _currentMipmaps[ready - 1] : _current;
+}
+
+void OverlayWidget::generateCurrentMipmaps(int levels) {
+	Expects(levels > int(_currentMipmaps.size()));
+
+	_currentMipmapsGenerating = true;
+	const auto key = _currentMipmapsKey;
+	const auto ready = int(_currentMipmaps.size());
+	auto from = (ready ? _currentMipmaps.back() : _current).toImage();
+	const auto weak = make_weak(this);
+	crl::async([=, from = std::move(from)]() mutable {
+		auto result = std::vector<QImage>();
+		for (auto i = ready; i != levels; ++i) {
+			from = from.scaled(
+				from.size() / 2,
+				Qt::IgnoreAspectRatio,
+				Qt::SmoothTransformation);
+			result.push_back(from);
+		}
+		crl::on_main(weak, [=, result = std::move(result)]() mutable {
+			if (_currentMipmapsKey != key
+				|| int(_currentMipmaps.size()) != ready) {
+				return;
+			}
+			_currentMipmapsGenerating = false;
+			for (auto &image : result) {
+				_currentMipmaps.push_back(
+					App::pixmapFromImageInPlace(std::move(image)));
+			}
+			update(contentRect());
+		});
+	});
+}
+
 void OverlayWidget::paintEvent(QPaintEvent *e) {
 	const auto r = e->rect();
 	const auto &region = e->region();
@@ -2517,8 +2656,7 @@ void OverlayWidget::paintEvent(QPaintEvent *e) {
 					p.fillRect(rect, _transparentBrush);
 				}
 				if (!_current.isNull()) {
-					PainterHighQualityEnabler hq(p);
-					p.drawPixmap(rect, _current);
+					paintCurrent(p, r);
 				}
 			}
 
@@ -2526,6 +2664,9 @@ void OverlayWidget::paintEvent(QPaintEvent *e) {
 			const auto radialOpacity = radial ? _radial.opacity() : 0.;
 			paintRadialLoading(p, radial, radialOpacity);
 		}
+		if (_streamed && _streamed->statisticsShown) {
+			paintStreamingStatistics(p);
+		}
 		if (_saveMsgStarted && _saveMsg.intersects(r)) {
 			float64 dt = float64(ms) - _saveMsgStarted, hidingDt = dt - st::mediaviewSaveMsgShowing - st::mediaviewSaveMsgShown;
 			if (dt < st::mediaviewSaveMsgShowing + st::mediaviewSaveMsgShown + st::mediaviewSaveMsgHiding) {
@@ -2937,6 +3078,77 @@ void OverlayWidget::paintLottieFrame(Painter &p, QRect clip) {
 	}
 }
 
+void OverlayWidget::toggleStreamingStatistics() {
+	Expects(_streamed != nullptr);
+
+	_streamed->statisticsShown = !_streamed->statisticsShown;
+	if (_streamed->statisticsShown) {
+		_streamed->statisticsTimer.setCallback([=] { update(); });
+		_streamed->statisticsTimer.callEach(crl::time(500));
+	} else {
+		_streamed->statisticsTimer.cancel();
+	}
+	update();
+}
+
+void OverlayWidget::paintStreamingStatistics(Painter &p) {
+	Expects(_streamed != nullptr);
+
+	const auto statistics = _streamed->player.statistics();
+	const auto time = [](crl::time value) {
+		return (value == kTimeUnknown)
+			? QString("-")
+			: QString::number(value) + " ms";
+	};
+	const auto hitRate = statistics.cacheReads
+		? (statistics.cacheHits * 100 / statistics.cacheReads)
+		: 0;
+	const auto lines = QStringList{
+		QString("Decode: %1 us, %2"
+		).arg(statistics.decodeTimeAverage
+		).arg(statistics.hardwareDecoding ? "hardware" : "software"),
+		QString("Frames: %1 decoded, %2 dropped"
+		).arg(statistics.framesDecoded
+		).arg(statistics.framesDropped),
+		QString("Buffered: %1").arg(time(statistics.buffered)),
+		QString("Cache: %1 of %2 hit (%3%)"
+		).arg(statistics.cacheHits
+		).arg(statistics.cacheReads
+		).arg(hitRate),
+		QString("Download: %1 KB/s"
+		).arg(statistics.bytesPerSecond / 1024),
+		QString("Stalls: %1, %2"
+		).arg(statistics.stallsCount
+		).arg(time(statistics.stallsDuration)),
+	};
+	const auto &font = st::mediaviewFont;
+	const auto &padding = st::mediaviewCaptionPadding;
+	auto textWidth = 0;
+	for (const auto &line : lines) {
+		accumulate_max(textWidth, font->width(line));
+	}
+	const auto outer = QRect(
+		padding.left(),
+		padding.top(),
+		padding.left() + textWidth + padding.right(),
+		padding.top() + lines.size() * font->height + padding.bottom());
+
+	p.setOpacity(1.);
+	p.setPen(Qt::NoPen);
+	p.setBrush(st::mediaviewCaptionBg);
+	p.drawRoundedRect(
+		outer,
+		st::mediaviewCaptionRadius,
+		st::mediaviewCaptionRadius);
+	p.setPen(st::mediaviewCaptionFg);
+	p.setFont(font);
+	auto top = outer.y() + padding.top();
+	for (const auto &line : lines) {
+		p.drawTextLeft(outer.x() + padding.left(), top, width(), line);
+		top += font->height;
+	}
+}
+
 void OverlayWidget::keyPressEvent(QKeyEvent *e) {
 	const auto ctrl = e->modifiers().testFlag(Qt::ControlModifier);
 	if (_streamed) {
@@ -2949,6 +3161,9 @@ void OverlayWidget::keyPressEvent(QKeyEvent *e) {
 		} else if (e->key() == Qt::Key_Space) {
 			playbackPauseResume();
 			return;
+		} else if (e->key() == Qt::Key_D && ctrl && Logs::DebugEnabled()) {
+			toggleStreamingStatistics();
+			return;
 		} else if (_fullScreenVideo) {
 			if (e->key() == Qt::Key_Escape) {
 				playbackToggleFullScreen();
@@ -3229,6 +3444,53 @@ void OverlayWidget::preloadData(int delta) {
 			}
 		}
 	}
+	preloadNeighbours();
+}
+
+void OverlayWidget::preloadNeighbours() {
+	Expects(_index.has_value());
+
+	auto photos = std::vector<not_null<PhotoData*>>();
+	auto readers = std::vector<std::shared_ptr<Streaming::Reader>>();
+	for (const auto delta : { -1, 1 }) {
+		const auto entity = entityByIndex(*_index + delta);
+		if (const auto photo = base::get_if<not_null<PhotoData*>>(
+				&entity.data)) {
+			photos.push_back(*photo);
+		} else if (const auto document = base::get_if<not_null<DocumentData*>>(
+				&entity.data)) {
+			const auto video = (*document)->isVideoFile()
+				|| (*document)->isAnimation();
+			if (!video || !(*document)->canBePlayed()) {
+				continue;
+			}
+			// Keep the Reader alive so that the Player gets it from the
+			// Data::Session with the header already loaded.
+			const auto origin = entity.item
+				? Data::FileOrigin(entity.item->fullId())
+				: fileOrigin();
+			auto reader = (*document)->owner().documentStreamedReader(
+				*document,
+				origin);
+			if (reader) {
+				reader->startPrefetch();
+				readers.push_back(std::move(reader));
+			}
+		}
+	}
+	_preloadedPhotos = std::move(photos);
+	_preloadedReaders = std::move(readers);
+	decodePreloadedPhotos();
+}
+
+void OverlayWidget::decodePreloadedPhotos() {
+	// Checking the image takes a loaded file into the images cache,
+	// the downloaded file starts decoding on a background thread.
+	for (const auto photo : _preloadedPhotos) {
+		if (const auto large = photo->large()) {
+			large->loaded();
+		}
+	}
 }
 
 void OverlayWidget::mousePressEvent(QMouseEvent *e) {
@@ -3680,6 +3942,7 @@ void OverlayWidget::setVisibleHook(bool visible) {
 		destroyThemePreview();
 		_radial.stop();
 		_current = QPixmap();
+		_currentMipmaps.clear();
 		_themePreview = nullptr;
 		_themeApply.destroyDelayed();
 		_themeCancel.destroyDelayed();
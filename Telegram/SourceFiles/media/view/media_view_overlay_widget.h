@@ -40,6 +40,7 @@ namespace Streaming {
 struct Information;
 struct Update;
 enum class Error;
+class Reader;
 } // namespace Streaming
 } // namespace Media
 
@@ -177,6 +178,8 @@ private:
 	void moveToScreen(bool force = false);
 	bool moveToNext(int delta);
 	void preloadData(int delta);
+	void preloadNeighbours();
+	void decodePreloadedPhotos();
 
 	Entity entityForUserPhotos(int index) const;
 	Entity entityForSharedMedia(int index) const;
@@ -291,6 +294,9 @@ private:
 		bool radial,
 		float64 radialOpacity) const;
 	void paintThemePreview(Painter &p, QRect clip);
+	void paintCurrent(Painter &p, QRect clip);
+	[[nodiscard]] const QPixmap &currentMipmap(QSize size);
+	void generateCurrentMipmaps(int levels);
 
 	void updateOverRect(OverState state);
 	bool updateOverState(OverState newState);
@@ -301,6 +307,7 @@ private:
 
 	void validatePhotoImage(Image *image, bool blurred);
 	void validatePhotoCurrentImage();
+	void validatePhotoProgressive();
 
 	[[nodiscard]] bool videoShown() const;
 	[[nodiscard]] QSize videoSize() const;
@@ -311,6 +318,8 @@ private:
 	[[nodiscard]] bool documentContentShown() const;
 	[[nodiscard]] bool documentBubbleShown() const;
 	void paintTransformedVideoFrame(Painter &p);
+	void paintStreamingStatistics(Painter &p);
+	void toggleStreamingStatistics();
 	void clearStreaming();
 
 	void paintLottieFrame(Painter &p, QRect clip);
@@ -320,6 +329,12 @@ private:
 
 	PhotoData *_photo = nullptr;
 	DocumentData *_doc = nullptr;
+
+	// Photos next to the current one are decoded as soon as they are
+	// loaded, videos next to it have their first parts prefetched.
+	std::vector<not_null<PhotoData*>> _preloadedPhotos;
+	std::vector<std::shared_ptr<Streaming::Reader>> _preloadedReaders;
+
 	std::unique_ptr<SharedMedia> _sharedMedia;
 	std::optional<SharedMediaWithLastSlice> _sharedMediaData;
 	std::optional<SharedMediaWithLastSlice::Key> _sharedMediaDataKey;
@@ -363,6 +378,13 @@ private:
 	QPixmap _current;
 	bool _blurred = true;
 
+	// Downscaled copies of _current for painting it zoomed out.
+	std::vector<QPixmap> _currentMipmaps;
+	qint64 _currentMipmapsKey = 0;
+	bool _currentMipmapsGenerating = false;
+	int _progressiveScans = 0;
+	bool _progressiveDecoding = false;
+
 	std::unique_ptr<Streamed> _streamed;
 	std::unique_ptr<LottieFile> _lottie;
 	bool _lottieDark = false;
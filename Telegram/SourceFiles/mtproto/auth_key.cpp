@@ -10,9 +10,67 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 extern "C" {
 #include <openssl/aes.h>
 #include <openssl/modes.h>
+#include <openssl/evp.h>
 } // extern "C"
 
 namespace MTP {
+namespace {
+
+constexpr auto kIgeBlockSize = uint32(AES_BLOCK_SIZE);
+
+// AES_ige_encrypt works with the portable AES_encrypt / AES_decrypt,
+// so we chain IGE blocks manually over the EVP cipher, which uses
+// hardware AES instructions when the CPU supports them.
+void AesIgeProcess(
+		const uchar *src,
+		uchar *dst,
+		uint32 len,
+		const void *key,
+		const void *iv,
+		bool encrypt) {
+	Expects(len % kIgeBlockSize == 0);
+
+	const auto context = EVP_CIPHER_CTX_new();
+	Assert(context != nullptr);
+	const auto guard = gsl::finally([&] { EVP_CIPHER_CTX_free(context); });
+
+	EVP_CipherInit_ex(
+		context,
+		EVP_aes_256_ecb(),
+		nullptr,
+		static_cast<const uchar*>(key),
+		nullptr,
+		encrypt ? 1 : 0);
+	EVP_CIPHER_CTX_set_padding(context, 0);
+
+	// iv contains previous ciphertext block and previous plaintext block.
+	uchar previousOut[kIgeBlockSize], previousIn[kIgeBlockSize];
+	memcpy(previousOut, iv, kIgeBlockSize);
+	memcpy(
+		previousIn,
+		static_cast<const uchar*>(iv) + kIgeBlockSize,
+		kIgeBlockSize);
+	const auto before = encrypt ? previousOut : previousIn;
+	const auto after = encrypt ? previousIn : previousOut;
+
+	uchar input[kIgeBlockSize], block[kIgeBlockSize];
+	for (auto offset = uint32(0); offset != len; offset += kIgeBlockSize) {
+		memcpy(input, src + offset, kIgeBlockSize);
+		for (auto i = uint32(0); i != kIgeBlockSize; ++i) {
+			block[i] = input[i] ^ before[i];
+		}
+		auto written = 0;
+		EVP_CipherUpdate(context, block, &written, block, kIgeBlockSize);
+		const auto output = dst + offset;
+		for (auto i = uint32(0); i != kIgeBlockSize; ++i) {
+			output[i] = block[i] ^ after[i];
+		}
+		memcpy(encrypt ? previousOut : previousIn, output, kIgeBlockSize);
+		memcpy(encrypt ? previousIn : previousOut, input, kIgeBlockSize);
+	}
+}
+
+} // namespace
 
 void AuthKey::prepareAES_oldmtp(const MTPint128 &msgKey, MTPint256 &aesKey, MTPint256 &aesIV, bool send) const {
 	uint32 x = send ? 0 : 8;
@@ -73,23 +131,11 @@ void AuthKey::prepareAES(const MTPint128 &msgKey, MTPint256 &aesKey, MTPint256 &
 }
 
 void aesIgeEncryptRaw(const void *src, void *dst, uint32 len, const void *key, const void *iv) {
-	uchar aes_key[32], aes_iv[32];
-	memcpy(aes_key, key, 32);
-	memcpy(aes_iv, iv, 32);
-
-	AES_KEY aes;
-	AES_set_encrypt_key(aes_key, 256, &aes);
-	AES_ige_encrypt(static_cast<const uchar*>(src), static_cast<uchar*>(dst), len, &aes, aes_iv, AES_ENCRYPT);
+	AesIgeProcess(static_cast<const uchar*>(src), static_cast<uchar*>(dst), len, key, iv, true);
 }
 
 void aesIgeDecryptRaw(const void *src, void *dst, uint32 len, const void *key, const void *iv) {
-	uchar aes_key[32], aes_iv[32];
-	memcpy(aes_key, key, 32);
-	memcpy(aes_iv, iv, 32);
-
-	AES_KEY aes;
-	AES_set_decrypt_key(aes_key, 256, &aes);
-	AES_ige_encrypt(static_cast<const uchar*>(src), static_cast<uchar*>(dst), len, &aes, aes_iv, AES_DECRYPT);
+	AesIgeProcess(static_cast<const uchar*>(src), static_cast<uchar*>(dst), len, key, iv, false);
 }
 
 void aesCtrEncrypt(bytes::span data, const void *key, CTRState *state) {
@@ -11,6 +11,31 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/rpc_sender.h"
 
 namespace MTP {
+namespace {
+
+QByteArray CoalesceKey(
+		const SecureRequest &request,
+		ShiftedDcId dcId,
+		int failSkipPolicy) {
+	// Serialized body is the same for identical requests.
+	const auto from = request->constData()
+		+ SecureRequest::kMessageBodyPosition;
+	const auto till = request->constData() + request->size();
+	auto result = QByteArray();
+	result.reserve(sizeof(dcId)
+		+ sizeof(failSkipPolicy)
+		+ (till - from) * sizeof(mtpPrime));
+	result.append(reinterpret_cast<const char*>(&dcId), sizeof(dcId));
+	result.append(
+		reinterpret_cast<const char*>(&failSkipPolicy),
+		sizeof(failSkipPolicy));
+	result.append(
+		reinterpret_cast<const char*>(from),
+		(till - from) * sizeof(mtpPrime));
+	return result;
+}
+
+} // namespace
 
 class ConcurrentSender::RPCDoneHandler : public RPCAbstractDoneHandler {
 public:
@@ -132,6 +157,10 @@ void ConcurrentSender::RequestBuilder::setAfter(
 	_afterRequestId = requestId;
 }
 
+void ConcurrentSender::RequestBuilder::setCoalesce() noexcept {
+	_coalesce = true;
+}
+
 mtpRequestId ConcurrentSender::RequestBuilder::send() {
 	const auto requestId = GetNextRequestId();
 	const auto dcId = _dcId;
@@ -139,6 +168,12 @@ mtpRequestId ConcurrentSender::RequestBuilder::send() {
 	const auto afterRequestId = _afterRequestId;
 
 	_sender->senderRequestRegister(requestId, std::move(_handlers));
+	if (_coalesce && !afterRequestId) {
+		auto key = CoalesceKey(_serialized, dcId, int(_failSkipPolicy));
+		if (_sender->senderRequestCoalesce(std::move(key), requestId)) {
+			return requestId;
+		}
+	}
 	_sender->with_instance([
 		=,
 		request = std::move(_serialized),
@@ -174,18 +209,60 @@ void ConcurrentSender::senderRequestRegister(
 	_requests.emplace(requestId, std::move(handlers));
 }
 
+bool ConcurrentSender::senderRequestCoalesce(
+		QByteArray &&key,
+		mtpRequestId requestId) {
+	const auto i = _coalescedByKey.find(key);
+	if (i != _coalescedByKey.end()) {
+		_coalesced[i->second].followers.push_back(requestId);
+		return true;
+	}
+	_coalescedByKey.emplace(key, requestId);
+	_coalesced.emplace(requestId, CoalescedRequest{ std::move(key) });
+	return false;
+}
+
+std::vector<mtpRequestId> ConcurrentSender::senderRequestTakeCoalesced(
+		mtpRequestId requestId) {
+	auto result = std::vector<mtpRequestId>(1, requestId);
+	if (auto coalesced = _coalesced.take(requestId)) {
+		_coalescedByKey.remove(coalesced->key);
+		result.insert(
+			end(result),
+			begin(coalesced->followers),
+			end(coalesced->followers));
+	}
+	return result;
+}
+
+bool ConcurrentSender::senderRequestHasFollowers(
+		mtpRequestId requestId) const {
+	const auto i = _coalesced.find(requestId);
+	if (i == _coalesced.end()) {
+		return false;
+	}
+	return ranges::find_if(i->second.followers, [&](mtpRequestId id) {
+		return _requests.contains(id);
+	}) != end(i->second.followers);
+}
+
 void ConcurrentSender::senderRequestDone(
 		mtpRequestId requestId,
 		bytes::const_span result) {
-	if (auto handlers = _requests.take(requestId)) {
-		try {
-			handlers->done(requestId, result);
-		} catch (Exception &e) {
-			handlers->fail(
-				requestId,
-				RPCError::Local(
-					"RESPONSE_PARSE_FAILED",
-					QString("exception text: ") + e.what()));
+	const auto weak = base::make_weak(this);
+	for (const auto id : senderRequestTakeCoalesced(requestId)) {
+		if (!weak) {
+			return;
+		} else if (auto handlers = _requests.take(id)) {
+			try {
+				handlers->done(id, result);
+			} catch (Exception &e) {
+				handlers->fail(
+					id,
+					RPCError::Local(
+						"RESPONSE_PARSE_FAILED",
+						QString("exception text: ") + e.what()));
+			}
 		}
 	}
 }
@@ -193,23 +270,38 @@ void ConcurrentSender::senderRequestDone(
 void ConcurrentSender::senderRequestFail(
 		mtpRequestId requestId,
 		RPCError &&error) {
-	if (auto handlers = _requests.take(requestId)) {
-		handlers->fail(requestId, std::move(error));
+	const auto weak = base::make_weak(this);
+	for (const auto id : senderRequestTakeCoalesced(requestId)) {
+		if (!weak) {
+			return;
+		} else if (auto handlers = _requests.take(id)) {
+			handlers->fail(id, RPCError(error));
+		}
 	}
 }
 
 void ConcurrentSender::senderRequestCancel(mtpRequestId requestId) {
 	senderRequestDetach(requestId);
+	if (senderRequestHasFollowers(requestId)) {
+		// Someone still waits for the shared network request.
+		return;
+	}
+	senderRequestTakeCoalesced(requestId);
 	with_instance([=](not_null<Instance*> instance) {
 		instance->cancel(requestId);
 	});
 }
 
 void ConcurrentSender::senderRequestCancelAll() {
-	auto list = std::vector<mtpRequestId>(_requests.size());
+	auto list = std::vector<mtpRequestId>();
+	list.reserve(_requests.size() + _coalesced.size());
 	for (const auto &pair : base::take(_requests)) {
 		list.push_back(pair.first);
 	}
+	for (const auto &pair : base::take(_coalesced)) {
+		list.push_back(pair.first);
+	}
+	_coalescedByKey.clear();
 	with_instance([list = std::move(list)](not_null<Instance*> instance) {
 		for (const auto requestId : list) {
 			instance->cancel(requestId);
@@ -71,6 +71,7 @@ class ConcurrentSender : public base::has_weak_ptr {
 		void setFailHandler(InvokeFullFail &&invoke) noexcept;
 		void setFailSkipPolicy(FailSkipPolicy policy) noexcept;
 		void setAfter(mtpRequestId requestId) noexcept;
+		void setCoalesce() noexcept;
 
 	private:
 		not_null<ConcurrentSender*> _sender;
@@ -81,6 +82,7 @@ class ConcurrentSender : public base::has_weak_ptr {
 		Handlers _handlers;
 		FailSkipPolicy _failSkipPolicy = FailSkipPolicy::Simple;
 		mtpRequestId _afterRequestId = 0;
+		bool _coalesce = false;
 
 	};
 
@@ -134,6 +136,10 @@ public:
 		[[nodiscard]] SpecificRequestBuilder &afterRequest(
 			mtpRequestId requestId) noexcept;
 
+		// Share one network request with identical ones in flight.
+		// Use only for read-only requests, the result is fanned out.
+		[[nodiscard]] SpecificRequestBuilder &coalesce() noexcept;
+
 	private:
 		SpecificRequestBuilder(
 			not_null<ConcurrentSender*> sender,
@@ -180,7 +186,16 @@ private:
 	friend class RequestBuilder;
 	friend class SentRequestWrap;
 
+	struct CoalescedRequest {
+		QByteArray key;
+		std::vector<mtpRequestId> followers;
+	};
+
 	void senderRequestRegister(mtpRequestId requestId, Handlers &&handlers);
+	bool senderRequestCoalesce(QByteArray &&key, mtpRequestId requestId);
+	std::vector<mtpRequestId> senderRequestTakeCoalesced(
+		mtpRequestId requestId);
+	bool senderRequestHasFollowers(mtpRequestId requestId) const;
 	void senderRequestDone(
 		mtpRequestId requestId,
 		bytes::const_span result);
@@ -193,6 +208,8 @@ private:
 
 	const Fn<void(FnMut<void()>)> _runner;
 	base::flat_map<mtpRequestId, Handlers> _requests;
+	base::flat_map<QByteArray, mtpRequestId> _coalescedByKey;
+	base::flat_map<mtpRequestId, CoalescedRequest> _coalesced;
 
 };
 
@@ -442,6 +459,13 @@ auto ConcurrentSender::SpecificRequestBuilder<Request>::afterRequest(
 	return *this;
 }
 
+template <typename Request>
+auto ConcurrentSender::SpecificRequestBuilder<Request>::coalesce(
+) noexcept -> SpecificRequestBuilder & {
+	setCoalesce();
+	return *this;
+}
+
 inline void ConcurrentSender::SentRequestWrap::cancel() {
 	_sender->senderRequestCancel(_requestId);
 }
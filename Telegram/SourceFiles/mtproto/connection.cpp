@@ -12,12 +12,15 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/rpc_sender.h"
 #include "mtproto/dc_options.h"
 #include "mtproto/connection_abstract.h"
+#include "mtproto/mtp_latency.h"
 #include "zlib.h"
 #include "core/application.h"
 #include "core/launcher.h"
+#include "storage/localstorage.h"
 #include "lang/lang_keys.h"
 #include "base/openssl_help.h"
 #include "base/qthelp_url.h"
+#include "base/trace.h"
 
 extern "C" {
 #include <openssl/bn.h>
@@ -39,7 +42,7 @@ namespace {
 constexpr auto kRecreateKeyId = AuthKey::KeyId(0xFFFFFFFFFFFFFFFFULL);
 constexpr auto kIntSize = static_cast<int>(sizeof(mtpPrime));
 constexpr auto kMaxModExpSize = 256;
-constexpr auto kWaitForBetterTimeout = crl::time(2000);
+constexpr auto kTestConnectionStagger = crl::time(250);
 constexpr auto kMinConnectedTimeout = crl::time(1000);
 constexpr auto kMaxConnectedTimeout = crl::time(8000);
 constexpr auto kMinReceiveTimeout = crl::time(4000);
@@ -175,7 +178,22 @@ bool IsPrimeAndGood(bytes::const_span primeBytes, int g) {
 		}
 	}
 
-	return IsPrimeAndGoodCheck(openssl::BigNum(primeBytes), g);
+	// Servers send the same few primes, each is fully checked only once.
+	static QMutex CheckedMutex;
+	static auto Checked = base::flat_set<std::pair<bytes::vector, int>>();
+	auto key = std::make_pair(openssl::Sha256(primeBytes), g);
+	{
+		QMutexLocker lock(&CheckedMutex);
+		if (Checked.contains(key)) {
+			return true;
+		}
+	}
+	if (!IsPrimeAndGoodCheck(openssl::BigNum(primeBytes), g)) {
+		return false;
+	}
+	QMutexLocker lock(&CheckedMutex);
+	Checked.emplace(std::move(key));
+	return true;
 }
 
 bytes::vector CreateAuthKey(
@@ -284,41 +302,135 @@ bool parsePQ(const QByteArray &pqStr, QByteArray &pStr, QByteArray &qStr) {
 	return true;
 }
 
+// There is no SSID or gateway access here, the local subnets identify
+// the network well enough. The proxy in use is a part of the network.
+DcOptions::NetworkId ComputeNetworkId(const ProxyData &proxy) {
+	auto parts = QStringList();
+	for (const auto &interface : QNetworkInterface::allInterfaces()) {
+		const auto flags = interface.flags();
+		if (!(flags & QNetworkInterface::IsUp)
+			|| !(flags & QNetworkInterface::IsRunning)
+			|| (flags & QNetworkInterface::IsLoopBack)) {
+			continue;
+		}
+		for (const auto &entry : interface.addressEntries()) {
+			const auto ip = entry.ip();
+			const auto prefix = entry.prefixLength();
+			if (ip.protocol() == QAbstractSocket::IPv4Protocol) {
+				const auto mask = entry.netmask().toIPv4Address();
+				const auto subnet = QHostAddress(ip.toIPv4Address() & mask);
+				parts.push_back(
+					subnet.toString() + '/' + QString::number(prefix));
+			} else if (ip.protocol() == QAbstractSocket::IPv6Protocol
+				&& prefix > 0
+				&& prefix < 128) {
+				auto address = ip.toIPv6Address();
+				for (auto i = prefix; i != 128; ++i) {
+					address[i / 8] &= quint8(~(0x80 >> (i % 8)));
+				}
+				if (address[0] == 0xFE && (address[1] & 0xC0) == 0x80) {
+					continue; // Link-local.
+				}
+				const auto subnet = QHostAddress(address);
+				parts.push_back(
+					subnet.toString() + '/' + QString::number(prefix));
+			}
+		}
+	}
+	parts.sort();
+	parts.push_back(QString::number(int(proxy.type)));
+	parts.push_back(proxy.host + ':' + QString::number(proxy.port));
+	parts.push_back(proxy.password);
+	const auto hash = openssl::Sha256(
+		bytes::make_span(parts.join('\n').toUtf8()));
+	auto result = DcOptions::NetworkId();
+	bytes::copy(
+		bytes::object_as_span(&result),
+		bytes::make_span(hash).subspan(0, sizeof(result)));
+	return result;
+}
+
 } // namespace
 
+void Thread::run() {
+	base::trace::SetThreadName("mtproto");
+	QThread::run();
+}
+
+ConnectionThreads::ConnectionThreads()
+: _limit(std::max(QThread::idealThreadCount(), 2)) {
+}
+
+ConnectionThreads::~ConnectionThreads() {
+	for (const auto &entry : _threads) {
+		Assert(entry.connections == 0);
+
+		entry.thread->quit();
+	}
+	for (const auto &entry : _threads) {
+		entry.thread->wait();
+	}
+}
+
+not_null<QThread*> ConnectionThreads::acquire() {
+	const auto i = ranges::min_element(
+		_threads,
+		ranges::less(),
+		&Entry::connections);
+	if (i != end(_threads)
+		&& (!i->connections || int(_threads.size()) >= _limit)) {
+		++i->connections;
+		return i->thread.get();
+	}
+	_threads.push_back({ std::make_unique<Thread>(), 1 });
+	_threads.back().thread->start();
+	return _threads.back().thread.get();
+}
+
+void ConnectionThreads::release(not_null<QThread*> thread) {
+	const auto i = ranges::find(
+		_threads,
+		thread.get(),
+		[](const Entry &entry) { return entry.thread.get(); });
+	Assert(i != end(_threads) && i->connections > 0);
+
+	--i->connections;
+}
+
 Connection::Connection(not_null<Instance*> instance) : _instance(instance) {
 }
 
 void Connection::start(SessionData *sessionData, ShiftedDcId shiftedDcId) {
 	Expects(_thread == nullptr && _private == nullptr);
 
-	_thread = std::make_unique<Thread>();
-	auto newData = std::make_unique<ConnectionPrivate>(
+	_threads = _instance->connectionThreads();
+	_thread = _threads->acquire();
+
+	// will be deleted after finishAndDestroy() in its thread
+	_private = new ConnectionPrivate(
 		_instance,
-		_thread.get(),
+		_thread,
 		this,
 		sessionData,
 		shiftedDcId);
-
-	// will be deleted in the thread::finished signal
-	_private = newData.release();
-	_thread->start();
 }
 
 void Connection::kill() {
 	Expects(_private != nullptr && _thread != nullptr);
 
 	_private->stop();
-	_private = nullptr;
-	_thread->quit();
+	const auto finishing = base::take(_private);
+	InvokeQueued(finishing, [=] {
+		finishing->finishAndDestroy();
+	});
 }
 
 void Connection::waitTillFinish() {
 	Expects(_private == nullptr && _thread != nullptr);
 
-	DEBUG_LOG(("Waiting for connectionThread to finish"));
-	_thread->wait();
-	_thread.reset();
+	DEBUG_LOG(("Waiting for connection to finish"));
+	_destroyed.acquire();
+	_threads->release(base::take(_thread));
 }
 
 int32 Connection::state() const {
@@ -357,7 +469,11 @@ void ConnectionPrivate::appendTestConnection(
 			protocol,
 			thread(),
 			_connectionOptions->proxy),
-		priority
+		priority,
+		protocol,
+		ip,
+		port,
+		protocolSecret
 	});
 	auto weak = _testConnections.back().data.get();
 	connect(weak, &AbstractConnection::error, [=](int errorCode) {
@@ -378,10 +494,31 @@ void ConnectionPrivate::appendTestConnection(
 	connect(weak, &AbstractConnection::disconnected, [=] {
 		onDisconnected(weak);
 	});
+}
 
-	InvokeQueued(_testConnections.back().data, [=] {
+void ConnectionPrivate::startNextTestConnection() {
+	const auto i = ranges::find(
+		_testConnections,
+		crl::time(0),
+		&TestConnection::startedAt);
+	if (i == end(_testConnections)) {
+		return;
+	}
+	i->startedAt = crl::now();
+	const auto weak = i->data.get();
+	const auto ip = i->ip;
+	const auto port = i->port;
+	const auto protocolSecret = i->protocolSecret;
+	InvokeQueued(i->data, [=] {
 		weak->connectToServer(ip, port, protocolSecret, getProtocolDcId());
 	});
+
+	// Candidates are raced: the next one starts after a short delay
+	// or right when one fails, the first connected one is used.
+	_waitForConnectedTimer.callOnce(_waitForConnected);
+	if (i + 1 != end(_testConnections)) {
+		_startNextTestTimer.callOnce(kTestConnectionStagger);
+	}
 }
 
 int16 ConnectionPrivate::getProtocolDcId() const {
@@ -398,7 +535,7 @@ int16 ConnectionPrivate::getProtocolDcId() const {
 }
 
 void ConnectionPrivate::destroyAllConnections() {
-	_waitForBetterTimer.cancel();
+	_startNextTestTimer.cancel();
 	_waitForReceivedTimer.cancel();
 	_waitForConnectedTimer.cancel();
 	_testConnections.clear();
@@ -420,17 +557,17 @@ ConnectionPrivate::ConnectionPrivate(
 , _oldConnectionTimer(thread, [=] { markConnectionOld(); })
 , _waitForConnectedTimer(thread, [=] { waitConnectedFailed(); })
 , _waitForReceivedTimer(thread, [=] { waitReceivedFailed(); })
-, _waitForBetterTimer(thread, [=] { waitBetterFailed(); })
+, _startNextTestTimer(thread, [=] { startNextTestConnection(); })
 , _waitForReceived(kMinReceiveTimeout)
 , _waitForConnected(kMinConnectedTimeout)
 , _pingSender(thread, [=] { sendPingByTimer(); })
 , sessionData(data) {
 	Expects(_shiftedDcId != 0);
 
+	_authKeyMathGuard->that = this;
 	moveToThread(thread);
 
-	connect(thread, &QThread::started, this, [=] { connectToServer(); });
-	connect(thread, &QThread::finished, this, [=] { finishAndDestroy(); });
+	InvokeQueued(this, [=] { connectToServer(); });
 	connect(this, SIGNAL(finished(internal::Connection*)), _instance, SLOT(connectionFinished(internal::Connection*)), Qt::QueuedConnection);
 
 	connect(sessionData->owner(), SIGNAL(authKeyCreated()), this, SLOT(updateAuthKey()), Qt::QueuedConnection);
@@ -723,6 +860,7 @@ mtpMsgId ConnectionPrivate::placeToContainer(SecureRequest &toSendRequest, mtpMs
 }
 
 void ConnectionPrivate::tryToSend() {
+	const auto span = base::trace::Span("tryToSend", "mtproto");
 	QReadLocker lockFinished(&sessionDataMutex);
 	if (!sessionData || !_connection) {
 		return;
@@ -971,6 +1109,11 @@ void ConnectionPrivate::tryToSend() {
 			QWriteLocker locker3(sessionData->wereAckedMutex());
 			auto &wereAcked = sessionData->wereAckedMap();
 
+			// Take the whole batch at once, so that new requests can be
+			// queued while this container is being packed.
+			auto batch = base::take(toSend);
+			locker1.unlock();
+
 			// prepare "request-like" wrap for msgId vector
 			auto haveSentIdsWrap = SecureRequest::Prepare(idsWrapSize);
 			haveSentIdsWrap->requestId = 0;
@@ -983,7 +1126,7 @@ void ConnectionPrivate::tryToSend() {
 			} else if (resendRequest || stateRequest) {
 				needAnyResponse = true;
 			}
-			for (auto i = toSend.begin(), e = toSend.end(); i != e; ++i) {
+			for (auto i = batch.begin(), e = batch.end(); i != e; ++i) {
 				auto &req = i.value();
 				auto msgId = prepareToSend(req, bigMsgId);
 				if (msgId > bigMsgId) msgId = replaceMsgId(req, bigMsgId);
@@ -1035,7 +1178,6 @@ void ConnectionPrivate::tryToSend() {
 			*(mtpMsgId*)(haveSentIdsWrap->data() + 4) = contMsgId;
 			(*haveSentIdsWrap)[6] = 0; // for container, msDate = 0, seqNo = 0
 			haveSent.insert(contMsgId, haveSentIdsWrap);
-			toSend.clear();
 		}
 	}
 	sendSecureRequest(
@@ -1171,6 +1313,22 @@ void ConnectionPrivate::connectToServer(bool afterConfig) {
 		).arg(_shiftedDcId
 		).arg(_testConnections.size()));
 
+	// Endpoints that connected in this network before are tried first.
+	_networkId = ComputeNetworkId(_connectionOptions->proxy);
+	const auto options = _instance->dcOptions();
+	const auto expected = [&](const TestConnection &test) {
+		return options->expectedConnectDuration(
+			_networkId,
+			bareDc,
+			test.protocol,
+			test.ip.toStdString(),
+			test.port);
+	};
+	ranges::stable_sort(_testConnections, std::less<>(), [&](
+			const TestConnection &test) {
+		return std::make_pair(expected(test), -test.priority);
+	});
+
 	if (!_startedConnectingAt) {
 		_startedConnectingAt = crl::now();
 	} else if (crl::now() - _startedConnectingAt > kRequestConfigTimeout) {
@@ -1186,7 +1344,7 @@ void ConnectionPrivate::connectToServer(bool afterConfig) {
 	_pingId = _pingMsgId = _pingIdToSend = _pingSendAt = 0;
 	_pingSender.cancel();
 
-	_waitForConnectedTimer.callOnce(_waitForConnected);
+	startNextTestConnection();
 }
 
 void ConnectionPrivate::restart() {
@@ -1242,7 +1400,7 @@ void ConnectionPrivate::onSentSome(uint64 size) {
 		if (isUploadDcId(_shiftedDcId)) {
 			remain *= kUploadSessionsCount;
 		} else if (isDownloadDcId(_shiftedDcId)) {
-			remain *= kDownloadSessionsCount;
+			remain *= kDefaultDownloadSessionsCount;
 		}
 		_waitForReceivedTimer.callOnce(remain);
 	}
@@ -1326,6 +1484,7 @@ void ConnectionPrivate::waitConnectedFailed() {
 	auto maxTimeout = kMaxConnectedTimeout;
 	for (const auto &connection : _testConnections) {
 		accumulate_max(maxTimeout, connection.data->fullConnectTimeout());
+		testConnectionFailed(connection.data.get());
 	}
 	if (_waitForConnected < maxTimeout) {
 		_waitForConnected = std::min(maxTimeout, 2 * _waitForConnected);
@@ -1338,9 +1497,6 @@ void ConnectionPrivate::waitConnectedFailed() {
 	InvokeQueued(this, [=] { connectToServer(); });
 }
 
-void ConnectionPrivate::waitBetterFailed() {
-	confirmBestConnection();
-}
 
 void ConnectionPrivate::doDisconnect() {
 	destroyAllConnections();
@@ -1378,6 +1534,7 @@ void ConnectionPrivate::requestCDNConfig() {
 }
 
 void ConnectionPrivate::handleReceived() {
+	const auto span = base::trace::Span("handleReceived", "mtproto");
 	QReadLocker lockFinished(&sessionDataMutex);
 	if (!sessionData) return;
 
@@ -1412,7 +1569,11 @@ void ConnectionPrivate::handleReceived() {
 		constexpr auto kMinimalEncryptedIntsCount = kEncryptedHeaderIntsCount + 4U; // + 1 data + 3 padding
 		constexpr auto kMinimalIntsCount = kExternalHeaderIntsCount + kMinimalEncryptedIntsCount;
 		auto intsCount = uint32(intsBuffer.size());
-		auto ints = intsBuffer.constData();
+		auto ints = intsBuffer.data();
+		base::trace::Counter(
+			"received bytes",
+			int64(intsCount) * kIntSize,
+			"mtproto");
 		if ((intsCount < kMinimalIntsCount) || (intsCount > kMaxMessageLength / kIntSize)) {
 			LOG(("TCP Error: bad message received, len %1").arg(intsCount * kIntSize));
 			TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(ints, intsCount * kIntSize).str()));
@@ -1429,16 +1590,16 @@ void ConnectionPrivate::handleReceived() {
 		auto encryptedInts = ints + kExternalHeaderIntsCount;
 		auto encryptedIntsCount = (intsCount - kExternalHeaderIntsCount) & ~0x03U;
 		auto encryptedBytesCount = encryptedIntsCount * kIntSize;
-		auto decryptedBuffer = QByteArray(encryptedBytesCount, Qt::Uninitialized);
 		auto msgKey = *(MTPint128*)(ints + 2);
 
+		// Decrypt in place, the received packet buffer is ours now.
+		auto decryptedInts = encryptedInts;
 #ifdef TDESKTOP_MTPROTO_OLD
-		aesIgeDecrypt_oldmtp(encryptedInts, decryptedBuffer.data(), encryptedBytesCount, key, msgKey);
+		aesIgeDecrypt_oldmtp(encryptedInts, decryptedInts, encryptedBytesCount, key, msgKey);
 #else // TDESKTOP_MTPROTO_OLD
-		aesIgeDecrypt(encryptedInts, decryptedBuffer.data(), encryptedBytesCount, key, msgKey);
+		aesIgeDecrypt(encryptedInts, decryptedInts, encryptedBytesCount, key, msgKey);
 #endif // TDESKTOP_MTPROTO_OLD
 
-		auto decryptedInts = reinterpret_cast<const mtpPrime*>(decryptedBuffer.constData());
 		auto serverSalt = *(uint64*)&decryptedInts[0];
 		auto session = *(uint64*)&decryptedInts[2];
 		auto msgId = *(uint64*)&decryptedInts[4];
@@ -1573,12 +1734,13 @@ void ConnectionPrivate::handleReceived() {
 			emit sendAnythingAsync(kAckSendWaiting);
 		}
 
-		bool emitSignal = false;
+		bool emitSignal = sessionData->hasReceivedUpdates();
 		{
 			QReadLocker locker(sessionData->haveReceivedMutex());
-			emitSignal = !sessionData->haveReceivedResponses().isEmpty() || !sessionData->haveReceivedUpdates().isEmpty();
+			const auto responses = sessionData->haveReceivedResponses().size();
+			emitSignal = emitSignal || (responses > 0);
 			if (emitSignal) {
-				DEBUG_LOG(("MTP Info: emitting needToReceive() - need to parse in another thread, %1 responses, %2 updates.").arg(sessionData->haveReceivedResponses().size()).arg(sessionData->haveReceivedUpdates().size()));
+				DEBUG_LOG(("MTP Info: emitting needToReceive() - need to parse in another thread, %1 responses.").arg(responses));
 			}
 		}
 
@@ -1604,6 +1766,7 @@ void ConnectionPrivate::handleReceived() {
 				emit needToSendAsync();
 			}
 		}
+		_connection->recycleReceived(std::move(intsBuffer));
 	}
 	if (_connection->needHttpWait()) {
 		emit sendHttpWaitAsync();
@@ -2069,6 +2232,7 @@ ConnectionPrivate::HandleResult ConnectionPrivate::handleOneReceived(const mtpPr
 		auto requestId = wasSent(reqMsgId.v);
 		if (requestId && requestId != mtpRequestId(0xFFFFFFFF)) {
 			// Save rpc_result for processing in the main thread.
+			base::trace::FlowEnd("request", requestId, "mtproto");
 			QWriteLocker locker(sessionData->haveReceivedMutex());
 			sessionData->haveReceivedResponses().insert(requestId, response);
 		} else {
@@ -2111,8 +2275,7 @@ ConnectionPrivate::HandleResult ConnectionPrivate::handleOneReceived(const mtpPr
 		if (from > start) memcpy(update.data(), start, (from - start) * sizeof(mtpPrime));
 
 		// Notify main process about new session - need to get difference.
-		QWriteLocker locker(sessionData->haveReceivedMutex());
-		sessionData->haveReceivedUpdates().push_back(SerializedMessage(update));
+		sessionData->pushReceivedUpdate(std::move(update));
 	} return HandleResult::Success;
 
 	case mtpc_ping: {
@@ -2168,8 +2331,7 @@ ConnectionPrivate::HandleResult ConnectionPrivate::handleOneReceived(const mtpPr
 		if (end > from) memcpy(update.data(), from, (end - from) * sizeof(mtpPrime));
 
 		// Notify main process about the new updates.
-		QWriteLocker locker(sessionData->haveReceivedMutex());
-		sessionData->haveReceivedUpdates().push_back(SerializedMessage(update));
+		sessionData->pushReceivedUpdate(std::move(update));
 
 		if (cons != mtpc_updatesTooLong
 			&& cons != mtpc_updateShortMessage
@@ -2249,6 +2411,17 @@ bool ConnectionPrivate::requestsFixTimeSalt(const QVector<MTPlong> &ids, int32 s
 	return false;
 }
 
+void ConnectionPrivate::recordLatency(const SecureRequest &request) const {
+	if (request->size() <= SecureRequest::kMessageBodyPosition) {
+		return;
+	}
+	RecordLatency(
+		LatencyPhase::Network,
+		mtpTypeId(request->at(SecureRequest::kMessageBodyPosition)),
+		_shiftedDcId,
+		(crl::now() - request->msDate) * 1000);
+}
+
 void ConnectionPrivate::requestsAcked(const QVector<MTPlong> &ids, bool byResponse) {
 	uint32 idsCount = ids.size();
 
@@ -2284,6 +2457,9 @@ void ConnectionPrivate::requestsAcked(const QVector<MTPlong> &ids, bool byRespon
 							moveToAcked = !_instance->hasCallbacks(reqId);
 						}
 						if (moveToAcked) {
+							if (byResponse) {
+								recordLatency(req.value());
+							}
 							wereAcked.insert(msgId, reqId);
 							haveSent.erase(req);
 						} else {
@@ -2428,65 +2604,63 @@ void ConnectionPrivate::onConnected(
 
 	_waitForConnected = kMinConnectedTimeout;
 	_waitForConnectedTimer.cancel();
+	_startNextTestTimer.cancel();
 
 	const auto i = ranges::find(
 		_testConnections,
 		connection.get(),
 		[](const TestConnection &test) { return test.data.get(); });
 	Assert(i != end(_testConnections));
-	const auto my = i->priority;
-	const auto j = ranges::find_if(
-		_testConnections,
-		[&](const TestConnection &test) { return test.priority > my; });
-	if (j != end(_testConnections)) {
-		DEBUG_LOG(("MTP Info: connection %1 succeed, "
-			"waiting for %2.").arg(i->data->tag()).arg(j->data->tag()));
-		_waitForBetterTimer.callOnce(kWaitForBetterTimeout);
-	} else {
-		DEBUG_LOG(("MTP Info: connection through IPv4 succeed."));
-		_waitForBetterTimer.cancel();
-		_connection = std::move(i->data);
-		_testConnections.clear();
 
-		lockFinished.unlock();
-		updateAuthKey();
+	DEBUG_LOG(("MTP Info: connection %1 succeed first."
+		).arg(i->data->tag()));
+	const auto remember = _instance->dcOptions()->reportConnected(
+		_networkId,
+		BareDcId(_shiftedDcId),
+		i->protocol,
+		i->ip.toStdString(),
+		i->port,
+		crl::now() - i->startedAt);
+	if (remember) {
+		InvokeQueued(_instance, [] {
+			Local::writeSettings();
+		});
 	}
+	_connection = std::move(i->data);
+	_testConnections.clear();
+
+	lockFinished.unlock();
+	updateAuthKey();
 }
 
 void ConnectionPrivate::onDisconnected(
 		not_null<AbstractConnection*> connection) {
+	testConnectionFailed(connection);
 	removeTestConnection(connection);
 
 	if (_testConnections.empty()) {
 		destroyAllConnections();
 		restart();
 	} else {
-		confirmBestConnection();
+		startNextTestConnection();
 	}
 }
 
-void ConnectionPrivate::confirmBestConnection() {
-	if (_waitForBetterTimer.isActive()) {
-		return;
-	}
-	const auto i = ranges::max_element(
+void ConnectionPrivate::testConnectionFailed(
+		not_null<AbstractConnection*> connection) {
+	const auto i = ranges::find(
 		_testConnections,
-		std::less<>(),
-		[](const TestConnection &test) {
-			return test.data->isConnected() ? test.priority : -1;
-		});
-	Assert(i != end(_testConnections));
-	if (!i->data->isConnected()) {
+		connection.get(),
+		[](const TestConnection &test) { return test.data.get(); });
+	if (i == end(_testConnections) || !i->startedAt) {
 		return;
 	}
-
-	DEBUG_LOG(("MTP Info: can't connect through better, using %1."
-		).arg(i->data->tag()));
-
-	_connection = std::move(i->data);
-	_testConnections.clear();
-
-	updateAuthKey();
+	_instance->dcOptions()->reportFailed(
+		_networkId,
+		BareDcId(_shiftedDcId),
+		i->protocol,
+		i->ip.toStdString(),
+		i->port);
 }
 
 void ConnectionPrivate::removeTestConnection(
@@ -2737,12 +2911,6 @@ void ConnectionPrivate::dhParamsAnswered() {
 		}
 		unixtimeSet(dh_inner_data.vserver_time.v);
 
-		// check that dhPrime and (dhPrime - 1) / 2 are really prime
-		if (!IsPrimeAndGood(bytes::make_span(dh_inner_data.vdh_prime.v), dh_inner_data.vg.v)) {
-			LOG(("AuthKey Error: bad dh_prime primality!"));
-			return restart();
-		}
-
 		_authKeyStrings->dh_prime = bytes::make_vector(
 			dh_inner_data.vdh_prime.v);
 		_authKeyData->g = dh_inner_data.vg.v;
@@ -2786,13 +2954,63 @@ void ConnectionPrivate::dhClientParamsSend() {
 	// gen rand 'b'
 	auto randomSeed = bytes::vector(ModExpFirst::kRandomPowerSize);
 	bytes::set_random(randomSeed);
-	auto g_b_data = CreateModExp(_authKeyData->g, _authKeyStrings->dh_prime, randomSeed);
+
+	// The prime check and the modular exponentiations are done
+	// on a worker thread, so that this connection thread is not stalled.
+	const auto nonce = _authKeyData->nonce;
+	const auto serverNonce = _authKeyData->server_nonce;
+	crl::async([
+		guard = _authKeyMathGuard,
+		g = _authKeyData->g,
+		prime = _authKeyStrings->dh_prime,
+		g_a = _authKeyStrings->g_a,
+		randomSeed = std::move(randomSeed),
+		nonce,
+		serverNonce
+	] {
+		auto result = AuthKeyMathResult();
+
+		// check that dhPrime and (dhPrime - 1) / 2 are really prime
+		result.primeGood = IsPrimeAndGood(prime, g);
+		if (result.primeGood) {
+			result.g_b = CreateModExp(g, prime, randomSeed);
+			if (!result.g_b.modexp.empty()) {
+				result.authKey = CreateAuthKey(
+					g_a,
+					result.g_b.randomPower,
+					prime);
+			}
+		}
+
+		QMutexLocker lock(&guard->mutex);
+		if (const auto that = guard->that) {
+			InvokeQueued(that, [=] {
+				that->dhClientParamsComputed(nonce, serverNonce, result);
+			});
+		}
+	});
+}
+
+void ConnectionPrivate::dhClientParamsComputed(
+		const MTPint128 &nonce,
+		const MTPint128 &serverNonce,
+		const AuthKeyMathResult &result) {
+	if (!_authKeyData
+		|| !_authKeyStrings
+		|| _authKeyData->nonce != nonce
+		|| _authKeyData->server_nonce != serverNonce) {
+		return; // Restarted while computing.
+	} else if (!result.primeGood) {
+		LOG(("AuthKey Error: bad dh_prime primality!"));
+		return restart();
+	}
+	const auto &g_b_data = result.g_b;
 	if (g_b_data.modexp.empty()) {
 		LOG(("AuthKey Error: could not generate good g_b."));
 		return restart();
 	}
 
-	auto computedAuthKey = CreateAuthKey(_authKeyStrings->g_a, g_b_data.randomPower, _authKeyStrings->dh_prime);
+	const auto &computedAuthKey = result.authKey;
 	if (computedAuthKey.empty()) {
 		LOG(("AuthKey Error: could not generate auth_key."));
 		return restart();
@@ -3023,12 +3241,13 @@ void ConnectionPrivate::onError(
 			instance->badConfigurationError();
 		});
 	}
+	testConnectionFailed(connection);
 	removeTestConnection(connection);
 
 	if (_testConnections.empty()) {
 		handleError(errorCode);
 	} else {
-		confirmBestConnection();
+		startNextTestConnection();
 	}
 }
 
@@ -3182,6 +3401,11 @@ bool ConnectionPrivate::sendSecureRequest(
 
 	DEBUG_LOG(("MTP Info: sending request, size: %1, num: %2, time: %3").arg(fullSize + 6).arg((*request)[4]).arg((*request)[5]));
 
+	base::trace::Counter(
+		"sent bytes",
+		int64((prefix + fullSize) * sizeof(mtpPrime)),
+		"mtproto");
+
 	_connection->setSentEncrypted();
 	_connection->sendData(std::move(packet));
 
@@ -3233,8 +3457,14 @@ void ConnectionPrivate::unlockKey() {
 }
 
 ConnectionPrivate::~ConnectionPrivate() {
+	{
+		QMutexLocker lock(&_authKeyMathGuard->mutex);
+		_authKeyMathGuard->that = nullptr;
+	}
 	clearAuthKeyData();
 	Assert(_finished && _connection == nullptr && _testConnections.empty());
+
+	_owner->_destroyed.release();
 }
 
 void ConnectionPrivate::stop() {
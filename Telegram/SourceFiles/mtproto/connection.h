@@ -52,11 +52,36 @@ public:
 		return _threadIndex;
 	}
 
+protected:
+	void run() override;
+
 private:
 	int _threadIndex = 0;
 
 };
 
+// All connections of an instance share a small pool of threads.
+class ConnectionThreads {
+public:
+	ConnectionThreads();
+	ConnectionThreads(const ConnectionThreads &other) = delete;
+	ConnectionThreads &operator=(const ConnectionThreads &other) = delete;
+	~ConnectionThreads();
+
+	[[nodiscard]] not_null<QThread*> acquire();
+	void release(not_null<QThread*> thread);
+
+private:
+	struct Entry {
+		std::unique_ptr<Thread> thread;
+		int connections = 0;
+	};
+
+	const int _limit = 0;
+	std::vector<Entry> _threads;
+
+};
+
 class Connection {
 public:
 	enum ConnectionType {
@@ -78,9 +103,13 @@ public:
 	QString transport() const;
 
 private:
+	friend class ConnectionPrivate;
+
 	not_null<Instance*> _instance;
-	std::unique_ptr<QThread> _thread;
+	ConnectionThreads *_threads = nullptr;
+	QThread *_thread = nullptr;
 	ConnectionPrivate *_private = nullptr;
+	crl::semaphore _destroyed;
 
 };
 
@@ -150,6 +179,11 @@ private:
 	struct TestConnection {
 		ConnectionPointer data;
 		int priority = 0;
+		DcOptions::Variants::Protocol protocol = DcOptions::Variants::Tcp;
+		QString ip;
+		int port = 0;
+		bytes::vector protocolSecret;
+		crl::time startedAt = 0;
 	};
 	void connectToServer(bool afterConfig = false);
 	void doDisconnect();
@@ -166,12 +200,12 @@ private:
 	void retryByTimer();
 	void waitConnectedFailed();
 	void waitReceivedFailed();
-	void waitBetterFailed();
 	void markConnectionOld();
 	void sendPingByTimer();
 
 	void destroyAllConnections();
-	void confirmBestConnection();
+	void startNextTestConnection();
+	void testConnectionFailed(not_null<AbstractConnection*> connection);
 	void removeTestConnection(not_null<AbstractConnection*> connection);
 	int16 getProtocolDcId() const;
 
@@ -216,6 +250,7 @@ private:
 
 	// remove msgs with such ids from sessionData->haveSent, add to sessionData->wereAcked
 	void requestsAcked(const QVector<MTPlong> &ids, bool byResponse = false);
+	void recordLatency(const SecureRequest &request) const;
 
 	void resend(quint64 msgId, qint64 msCanWait = 0, bool forceContainer = false, bool sendMsgStateInfo = false);
 	void resendMany(QVector<quint64> msgIds, qint64 msCanWait = 0, bool forceContainer = false, bool sendMsgStateInfo = false);
@@ -239,6 +274,7 @@ private:
 	not_null<Connection*> _owner;
 	ConnectionPointer _connection;
 	std::vector<TestConnection> _testConnections;
+	DcOptions::NetworkId _networkId = 0;
 	crl::time _startedConnectingAt = 0;
 
 	base::Timer _retryTimer; // exp retry timer
@@ -250,7 +286,7 @@ private:
 
 	base::Timer _waitForConnectedTimer;
 	base::Timer _waitForReceivedTimer;
-	base::Timer _waitForBetterTimer;
+	base::Timer _startNextTestTimer;
 	crl::time _waitForReceived = 0;
 	crl::time _waitForConnected = 0;
 	crl::time firstSentAt = -1;
@@ -303,7 +339,25 @@ private:
 	std::unique_ptr<AuthKeyCreateData> _authKeyData;
 	std::unique_ptr<AuthKeyCreateStrings> _authKeyStrings;
 
+	// Results of the worker thread math are delivered through the guard
+	// only while this connection is alive.
+	struct AuthKeyMathGuard {
+		QMutex mutex;
+		ConnectionPrivate *that = nullptr;
+	};
+	struct AuthKeyMathResult {
+		bool primeGood = false;
+		ModExpFirst g_b;
+		bytes::vector authKey;
+	};
+	const std::shared_ptr<AuthKeyMathGuard> _authKeyMathGuard
+		= std::make_shared<AuthKeyMathGuard>();
+
 	void dhClientParamsSend();
+	void dhClientParamsComputed(
+		const MTPint128 &nonce,
+		const MTPint128 &serverNonce,
+		const AuthKeyMathResult &result);
 	void authKeyCreated();
 	void clearAuthKeyData();
 
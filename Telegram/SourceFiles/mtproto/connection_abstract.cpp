@@ -14,6 +14,13 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace MTP {
 namespace internal {
+namespace {
+
+constexpr auto kMaxRecycledBuffers = 4;
+constexpr auto kMaxRecycledBufferInts = (1024 * 1024 + 1024)
+	/ int(sizeof(mtpPrime));
+
+} // namespace
 
 ConnectionPointer::ConnectionPointer() = default;
 
@@ -75,6 +82,28 @@ ConnectionPointer::~ConnectionPointer() {
 	reset();
 }
 
+void AbstractConnection::recycleReceived(mtpBuffer &&buffer) {
+	if (_recycledBuffers.size() >= kMaxRecycledBuffers
+		|| !buffer.isDetached()
+		|| buffer.capacity() > kMaxRecycledBufferInts) {
+		return;
+	}
+
+	// Reserved capacity is not released when the buffer shrinks.
+	buffer.reserve(buffer.capacity());
+	_recycledBuffers.push_back(std::move(buffer));
+}
+
+mtpBuffer AbstractConnection::takeReceiveBuffer(int size) {
+	if (_recycledBuffers.empty()) {
+		return mtpBuffer(size);
+	}
+	auto result = std::move(_recycledBuffers.back());
+	_recycledBuffers.pop_back();
+	result.resize(size);
+	return result;
+}
+
 mtpBuffer AbstractConnection::prepareSecurePacket(
 		uint64 keyId,
 		MTPint128 msgKey,
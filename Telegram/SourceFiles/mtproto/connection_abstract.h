@@ -101,6 +101,9 @@ public:
 		return _receivedQueue;
 	}
 
+	// Processed packet buffers are reused for the next received packets.
+	void recycleReceived(mtpBuffer &&buffer);
+
 	template <typename Request>
 	mtpBuffer prepareNotSecurePacket(const Request &request) const;
 	mtpBuffer prepareSecurePacket(
@@ -125,12 +128,15 @@ signals:
 
 protected:
 	BuffersQueue _receivedQueue; // list of received packets, not processed yet
+	std::vector<mtpBuffer> _recycledBuffers;
 	bool _sentEncrypted = false;
 	int _pingTime = 0;
 	ProxyData _proxy;
 
 	// first we always send fake MTPReq_pq to see if connection works at all
 	// we send them simultaneously through TCP/HTTP/IPv4/IPv6 to choose the working one
+	[[nodiscard]] mtpBuffer takeReceiveBuffer(int size);
+
 	mtpBuffer preparePQFake(const MTPint128 &nonce) const;
 	MTPResPQ readPQFakeReply(const mtpBuffer &buffer) const;
 
@@ -9,9 +9,197 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "zlib.h"
 
+#include <QtCore/QMutex>
+
 namespace MTP {
 namespace {
 
+// Typing, read receipts and other tiny requests are sent thousands of
+// times, so small request buffers are reused instead of reallocated.
+class RequestsPool {
+public:
+	static RequestsPool &Instance();
+
+	std::shared_ptr<SecureRequestData> take(int capacity);
+
+private:
+	static constexpr auto kClassesCount = 3;
+	static constexpr auto kMaxPerClass = 64;
+
+	static int ClassSize(int index);
+	static int ClassForTake(int capacity);
+	static int ClassForPut(int capacity);
+
+	void put(SecureRequestData *data);
+
+	QMutex _mutex;
+	std::array<std::vector<SecureRequestData*>, kClassesCount> _free;
+
+};
+
+RequestsPool &RequestsPool::Instance() {
+	// Never destroyed, requests may be released after the static cleanup.
+	static const auto result = new RequestsPool();
+	return *result;
+}
+
+int RequestsPool::ClassSize(int index) {
+	return 64 << (2 * index); // 64, 256 and 1024 ints.
+}
+
+int RequestsPool::ClassForTake(int capacity) {
+	for (auto i = 0; i != kClassesCount; ++i) {
+		if (capacity <= ClassSize(i)) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+int RequestsPool::ClassForPut(int capacity) {
+	if (capacity > 2 * ClassSize(kClassesCount - 1)) {
+		return -1;
+	}
+	for (auto i = kClassesCount; i != 0; --i) {
+		if (capacity >= ClassSize(i - 1)) {
+			return i - 1;
+		}
+	}
+	return -1;
+}
+
+std::shared_ptr<SecureRequestData> RequestsPool::take(int capacity) {
+	const auto deleter = [=](SecureRequestData *data) { put(data); };
+	const auto index = ClassForTake(capacity);
+	if (index >= 0) {
+		QMutexLocker lock(&_mutex);
+		auto &list = _free[index];
+		if (!list.empty()) {
+			const auto result = list.back();
+			list.pop_back();
+			lock.unlock();
+
+			result->reserve(capacity);
+			return std::shared_ptr<SecureRequestData>(result, deleter);
+		}
+	}
+	const auto result = new SecureRequestData(
+		details::SecureRequestCreateTag{});
+	result->reserve(
+		(index >= 0) ? std::max(capacity, ClassSize(index)) : capacity);
+	return std::shared_ptr<SecureRequestData>(result, deleter);
+}
+
+void RequestsPool::put(SecureRequestData *data) {
+	const auto index = ClassForPut(data->capacity());
+	if (index < 0 || !data->isDetached()) {
+		delete data;
+		return;
+	}
+
+	// Reset outside of the lock, "after" may return one more request.
+	data->resize(0);
+	data->msDate = 0;
+	data->requestId = 0;
+	data->after = SecureRequest();
+	data->needsLayer = false;
+
+	QMutexLocker lock(&_mutex);
+	auto &list = _free[index];
+	if (int(list.size()) < kMaxPerClass) {
+		list.push_back(data);
+		return;
+	}
+	lock.unlock();
+	delete data;
+}
+
+// Reading a big response creates tens of thousands of small data objects
+// of the generated types, so freed ones are kept for the next responses.
+class TypeDataPool {
+public:
+	static void *Take(std::size_t size);
+	static void Put(void *pointer, std::size_t size);
+
+private:
+	static constexpr auto kBlockSize = std::size_t(16);
+	static constexpr auto kClassesCount = std::size_t(16); // Up to 256 bytes.
+	static constexpr auto kMaxPerClass = 512;
+
+	struct FreeBlock {
+		FreeBlock *next = nullptr;
+	};
+	struct List {
+		FreeBlock *first = nullptr;
+		int count = 0;
+	};
+
+	TypeDataPool() = default;
+	~TypeDataPool();
+
+	static TypeDataPool *Current();
+	static std::size_t ClassIndex(std::size_t size);
+
+	std::array<List, kClassesCount> _free;
+
+};
+
+// Objects may be freed while the thread local storage is destroyed.
+thread_local auto TypeDataPoolDestroyed = false;
+
+TypeDataPool *TypeDataPool::Current() {
+	if (TypeDataPoolDestroyed) {
+		return nullptr;
+	}
+	thread_local auto result = TypeDataPool();
+	return &result;
+}
+
+TypeDataPool::~TypeDataPool() {
+	TypeDataPoolDestroyed = true;
+	for (auto &list : _free) {
+		while (const auto block = list.first) {
+			list.first = block->next;
+			::operator delete(block);
+		}
+	}
+}
+
+std::size_t TypeDataPool::ClassIndex(std::size_t size) {
+	return (size + kBlockSize - 1) / kBlockSize - 1;
+}
+
+void *TypeDataPool::Take(std::size_t size) {
+	const auto index = ClassIndex(size);
+	if (index >= kClassesCount) {
+		return ::operator new(size);
+	} else if (const auto pool = Current()) {
+		auto &list = pool->_free[index];
+		if (const auto block = list.first) {
+			list.first = block->next;
+			--list.count;
+			return block;
+		}
+	}
+	return ::operator new((index + 1) * kBlockSize);
+}
+
+void TypeDataPool::Put(void *pointer, std::size_t size) {
+	const auto index = ClassIndex(size);
+	if (index < kClassesCount) {
+		if (const auto pool = Current()) {
+			auto &list = pool->_free[index];
+			if (list.count < kMaxPerClass) {
+				const auto block = new (pointer) FreeBlock{ list.first };
+				list.first = block;
+				++list.count;
+				return;
+			}
+		}
+	}
+	::operator delete(pointer);
+}
+
 uint32 CountPaddingAmountInInts(uint32 requestSize, bool extended) {
 #ifdef TDESKTOP_MTPROTO_OLD
 	return ((8 + requestSize) & 0x03)
@@ -38,15 +226,24 @@ uint32 CountPaddingAmountInInts(uint32 requestSize, bool extended) {
 
 } // namespace
 
-SecureRequest::SecureRequest(const details::SecureRequestCreateTag &tag)
-: _data(std::make_shared<SecureRequestData>(tag)) {
+namespace internal {
+
+void *TypeData::operator new(std::size_t size) {
+	return TypeDataPool::Take(size);
 }
 
+void TypeData::operator delete(void *pointer, std::size_t size) {
+	TypeDataPool::Put(pointer, size);
+}
+
+} // namespace internal
+
 SecureRequest SecureRequest::Prepare(uint32 size, uint32 reserveSize) {
 	const auto finalSize = std::max(size, reserveSize);
 
-	auto result = SecureRequest(details::SecureRequestCreateTag{});
-	result->reserve(kMessageBodyPosition + finalSize);
+	auto result = SecureRequest();
+	result._data = RequestsPool::Instance().take(
+		int(kMessageBodyPosition + finalSize));
 	result->resize(kMessageBodyPosition);
 	result->back() = (size << 2);
 	return result;
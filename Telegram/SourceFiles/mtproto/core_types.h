@@ -102,6 +102,10 @@ public:
 	virtual ~TypeData() {
 	}
 
+	// Freed data objects are reused by the thread that has freed them.
+	static void *operator new(std::size_t size);
+	static void operator delete(void *pointer, std::size_t size);
+
 private:
 	void incrementCounter() const {
 		_counter.ref();
@@ -340,8 +344,6 @@ public:
 	using ResponseType = void; // don't know real response type =(
 
 private:
-	explicit SecureRequest(const details::SecureRequestCreateTag &);
-
 	std::shared_ptr<SecureRequestData> _data;
 
 };
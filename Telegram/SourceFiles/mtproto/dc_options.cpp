@@ -12,6 +12,11 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace MTP {
 namespace {
 
+constexpr auto kMaxEndpointStats = 256;
+constexpr auto kMaxEndpointAttempts = 64;
+constexpr auto kUnknownEndpointDuration = crl::time(10000);
+constexpr auto kFailingEndpointDuration = crl::time(60000);
+
 const char *(PublicRSAKeys[]) = { "\
 -----BEGIN RSA PUBLIC KEY-----\n\
 MIIBCgKCAQEAwVACPi9w23mF3tBkdZz+zwrzKOaaQdr01vAbU4E1pvkfj4sqDsm6\n\
@@ -371,7 +376,16 @@ QByteArray DcOptions::serialize() const {
 		}
 	}
 
-	constexpr auto kVersion = 1;
+	// Endpoint stats.
+	QMutexLocker statsLock(&_endpointStatsMutex);
+	size += sizeof(qint32);
+	for (const auto &[key, stats] : _endpointStats) {
+		// network + used + id + protocol + port + successes + failures + duration
+		size += 2 * sizeof(quint64) + 6 * sizeof(qint32);
+		size += sizeof(qint32) + key.ip.size();
+	}
+
+	constexpr auto kVersion = 2;
 
 	auto result = QByteArray();
 	result.reserve(size);
@@ -406,6 +420,21 @@ QByteArray DcOptions::serialize() const {
 				<< Serialize::bytes(key.n)
 				<< Serialize::bytes(key.e);
 		}
+
+		// Endpoint stats.
+		stream << qint32(_endpointStats.size());
+		for (const auto &[key, stats] : _endpointStats) {
+			stream << quint64(key.network)
+				<< quint64(stats.used)
+				<< qint32(key.dcId)
+				<< qint32(key.protocol)
+				<< qint32(key.port)
+				<< qint32(stats.successes)
+				<< qint32(stats.failures)
+				<< qint32(stats.duration)
+				<< qint32(key.ip.size());
+			stream.writeRawData(key.ip.data(), key.ip.size());
+		}
 	}
 	return result;
 }
@@ -500,6 +529,52 @@ void DcOptions::constructFromSerialized(const QByteArray &serialized) {
 			}
 		}
 	}
+
+	// Read endpoint stats
+	if (version > 1 && !stream.atEnd()) {
+		auto count = qint32(0);
+		stream >> count;
+		if (stream.status() != QDataStream::Ok) {
+			LOG(("MTP Error: Bad data for endpoint stats in DcOptions::constructFromSerialized()"));
+			return;
+		}
+
+		QMutexLocker statsLock(&_endpointStatsMutex);
+		_endpointStats.clear();
+		for (auto i = 0; i != count; ++i) {
+			quint64 network = 0, used = 0;
+			qint32 dcId = 0, protocol = 0, port = 0;
+			qint32 successes = 0, failures = 0, duration = 0, ipSize = 0;
+			stream >> network >> used >> dcId >> protocol >> port
+				>> successes >> failures >> duration >> ipSize;
+
+			constexpr auto kMaxIpSize = 45;
+			if (stream.status() != QDataStream::Ok
+				|| ipSize < 0
+				|| ipSize > kMaxIpSize
+				|| protocol < 0
+				|| protocol >= Variants::ProtocolCount) {
+				LOG(("MTP Error: Bad data for endpoint stats inside DcOptions::constructFromSerialized()"));
+				_endpointStats.clear();
+				return;
+			}
+			auto ip = std::string(ipSize, ' ');
+			stream.readRawData(ip.data(), ipSize);
+
+			auto &stats = _endpointStats[EndpointKey{
+				network,
+				DcId(dcId),
+				Variants::Protocol(protocol),
+				ip,
+				port
+			}];
+			stats.successes = successes;
+			stats.failures = failures;
+			stats.duration = duration;
+			stats.used = used;
+			accumulate_max(_endpointStatsUsed, used);
+		}
+	}
 }
 
 DcOptions::Ids DcOptions::configEnumDcIds() const {
@@ -534,6 +609,66 @@ DcType DcOptions::dcType(ShiftedDcId shiftedDcId) const {
 	return DcType::Regular;
 }
 
+DcOptions::EndpointStats &DcOptions::endpointStats(EndpointKey &&key) {
+	auto &result = _endpointStats[std::move(key)];
+	result.used = ++_endpointStatsUsed;
+	if (result.successes + result.failures >= kMaxEndpointAttempts) {
+		// Let the old results fade out.
+		result.successes /= 2;
+		result.failures /= 2;
+	}
+	if (int(_endpointStats.size()) > kMaxEndpointStats) {
+		_endpointStats.erase(ranges::min_element(
+			_endpointStats,
+			std::less<>(),
+			[](const auto &pair) { return pair.second.used; }));
+	}
+	return result;
+}
+
+bool DcOptions::reportConnected(
+		NetworkId network,
+		DcId dcId,
+		Variants::Protocol protocol,
+		const std::string &ip,
+		int port,
+		crl::time duration) {
+	QMutexLocker lock(&_endpointStatsMutex);
+	auto &stats = endpointStats({ network, dcId, protocol, ip, port });
+	stats.duration = stats.successes
+		? ((stats.duration * 3 + duration) / 4)
+		: duration;
+	return (++stats.successes == 1);
+}
+
+void DcOptions::reportFailed(
+		NetworkId network,
+		DcId dcId,
+		Variants::Protocol protocol,
+		const std::string &ip,
+		int port) {
+	QMutexLocker lock(&_endpointStatsMutex);
+	++endpointStats({ network, dcId, protocol, ip, port }).failures;
+}
+
+crl::time DcOptions::expectedConnectDuration(
+		NetworkId network,
+		DcId dcId,
+		Variants::Protocol protocol,
+		const std::string &ip,
+		int port) const {
+	QMutexLocker lock(&_endpointStatsMutex);
+	const auto i = _endpointStats.find({ network, dcId, protocol, ip, port });
+	if (i == end(_endpointStats)) {
+		return kUnknownEndpointDuration;
+	}
+	const auto &stats = i->second;
+	if (stats.failures > stats.successes) {
+		return kFailingEndpointDuration + stats.failures;
+	}
+	return stats.successes ? stats.duration : kUnknownEndpointDuration;
+}
+
 void DcOptions::setCDNConfig(const MTPDcdnConfig &config) {
 	WriteLocker lock(this);
 	_cdnPublicKeys.clear();
@@ -13,6 +13,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <string>
 #include <vector>
 #include <map>
+#include <tuple>
 
 namespace MTP {
 
@@ -85,6 +86,33 @@ public:
 	Variants lookup(DcId dcId, DcType type, bool throughProxy) const;
 	DcType dcType(ShiftedDcId shiftedDcId) const;
 
+	// Connection results are remembered for each network, so that
+	// the endpoints that worked there before are tried first.
+	using NetworkId = uint64;
+
+	// Returns true if the endpoint connected in this network first time.
+	bool reportConnected(
+		NetworkId network,
+		DcId dcId,
+		Variants::Protocol protocol,
+		const std::string &ip,
+		int port,
+		crl::time duration);
+	void reportFailed(
+		NetworkId network,
+		DcId dcId,
+		Variants::Protocol protocol,
+		const std::string &ip,
+		int port);
+
+	// Endpoints with smaller values should be tried first.
+	[[nodiscard]] crl::time expectedConnectDuration(
+		NetworkId network,
+		DcId dcId,
+		Variants::Protocol protocol,
+		const std::string &ip,
+		int port) const;
+
 	void setCDNConfig(const MTPDcdnConfig &config);
 	bool hasCDNKeysForDc(DcId dcId) const;
 	bool getDcRSAKey(DcId dcId, const QVector<MTPlong> &fingerprints, internal::RSAPublicKey *result) const;
@@ -94,6 +122,32 @@ public:
 	bool writeToFile(const QString &path) const;
 
 private:
+	struct EndpointKey {
+		NetworkId network = 0;
+		DcId dcId = 0;
+		Variants::Protocol protocol = Variants::Tcp;
+		std::string ip;
+		int port = 0;
+
+		bool operator<(const EndpointKey &other) const {
+			return std::tie(network, dcId, protocol, ip, port)
+				< std::tie(
+					other.network,
+					other.dcId,
+					other.protocol,
+					other.ip,
+					other.port);
+		}
+	};
+	struct EndpointStats {
+		int successes = 0;
+		int failures = 0;
+		crl::time duration = 0;
+		uint64 used = 0;
+	};
+
+	EndpointStats &endpointStats(EndpointKey &&key);
+
 	bool applyOneGuarded(
 		DcId dcId,
 		Flags flags,
@@ -129,6 +183,10 @@ private:
 	std::map<DcId, std::map<uint64, internal::RSAPublicKey>> _cdnPublicKeys;
 	mutable QReadWriteLock _useThroughLockers;
 
+	std::map<EndpointKey, EndpointStats> _endpointStats;
+	uint64 _endpointStatsUsed = 0;
+	mutable QMutex _endpointStatsMutex;
+
 	mutable base::Observable<Ids> _changed;
 
 	// True when we have overriden options from a .tdesktop-endpoints file.
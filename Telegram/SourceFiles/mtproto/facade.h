@@ -58,7 +58,9 @@ constexpr ShiftedDcId updaterDcId(DcId dcId) {
 	return ShiftDcId(dcId, kUpdaterDcShift);
 }
 
-constexpr auto kDownloadSessionsCount = 2;
+// Downloader adds sessions up to the maximum on fast links.
+constexpr auto kDefaultDownloadSessionsCount = 2;
+constexpr auto kDownloadSessionsCount = 8;
 constexpr auto kUploadSessionsCount = 2;
 
 namespace internal {
@@ -15,6 +15,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/connection.h"
 #include "mtproto/sender.h"
 #include "mtproto/rsa_public_key.h"
+#include "mtproto/mtp_latency.h"
 #include "storage/localstorage.h"
 #include "calls/calls_instance.h"
 #include "auth_session.h"
@@ -24,11 +25,16 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "lang/lang_cloud_manager.h"
 #include "base/timer.h"
 
+#include <chrono>
+
 namespace MTP {
 namespace {
 
 constexpr auto kConfigBecomesOldIn = 2 * 60 * crl::time(1000);
 constexpr auto kConfigBecomesOldForBlockedIn = 8 * crl::time(1000);
+constexpr auto kLatencyDumpInterval = 10 * 60 * crl::time(1000);
+constexpr auto kLatencyDumpLimit = 64;
+constexpr auto kBackgroundRequestsCanWait = crl::time(50);
 
 } // namespace
 
@@ -50,6 +56,8 @@ public:
 
 	not_null<DcOptions*> dcOptions();
 
+	void setRequestsCanWait(mtpTypeId type, crl::time msCanWait);
+
 	// Thread safe.
 	QString deviceModel() const;
 	QString systemVersion() const;
@@ -78,6 +86,7 @@ public:
 
 	void queueQuittingConnection(
 		std::unique_ptr<internal::Connection> &&connection);
+	not_null<internal::ConnectionThreads*> connectionThreads();
 	void connectionFinished(internal::Connection *connection);
 
 	void sendRequest(
@@ -178,6 +187,9 @@ private:
 	QString _deviceModel;
 	QString _systemVersion;
 
+	// Destroyed after all the sessions and connections that use it.
+	internal::ConnectionThreads _connectionThreads;
+
 	internal::Session *_mainSession = nullptr;
 	std::map<ShiftedDcId, std::unique_ptr<internal::Session>> _sessions;
 	std::vector<std::unique_ptr<internal::Session>> _killedSessions; // delayed delete
@@ -209,6 +221,8 @@ private:
 	std::map<mtpRequestId, SecureRequest> _requestMap;
 	QReadWriteLock _requestMapLock;
 
+	base::flat_map<mtpTypeId, crl::time> _requestsCanWait;
+
 	std::deque<std::pair<mtpRequestId, crl::time>> _delayedRequests;
 
 	std::map<mtpRequestId, int> _requestsDelays;
@@ -222,6 +236,7 @@ private:
 	Fn<void(ShiftedDcId shiftedDcId)> _sessionResetHandler;
 
 	base::Timer _checkDelayedTimer;
+	base::Timer _latencyDumpTimer;
 
 	// Debug flag to find out how we end up crashing.
 	bool MustNotCreateSessions = false;
@@ -288,6 +303,22 @@ void Instance::Private::start(Config &&config) {
 	}
 
 	_checkDelayedTimer.setCallback([this] { checkDelayedRequests(); });
+	if (isNormal()) {
+		const auto background = {
+			mtpc_messages_getMessagesViews,
+			mtpc_messages_readMessageContents,
+			mtpc_messages_readFeaturedStickers,
+			mtpc_help_saveAppLog,
+		};
+		for (const auto type : background) {
+			setRequestsCanWait(type, kBackgroundRequestsCanWait);
+		}
+
+		_latencyDumpTimer.setCallback([] {
+			DEBUG_LOG(("MTP Latency:\n%1").arg(LatencyReport(kLatencyDumpLimit)));
+		});
+		_latencyDumpTimer.callEach(kLatencyDumpInterval);
+	}
 
 	Assert((_mainDcId == Config::kNoneMainDc) == isKeysDestroyer());
 	requestConfig();
@@ -734,6 +765,20 @@ void Instance::Private::queueQuittingConnection(
 	_quittingConnections.insert(std::move(connection));
 }
 
+void Instance::Private::setRequestsCanWait(
+		mtpTypeId type,
+		crl::time msCanWait) {
+	if (msCanWait > 0) {
+		_requestsCanWait[type] = msCanWait;
+	} else {
+		_requestsCanWait.remove(type);
+	}
+}
+
+not_null<internal::ConnectionThreads*> Instance::Private::connectionThreads() {
+	return &_connectionThreads;
+}
+
 void Instance::Private::connectionFinished(internal::Connection *connection) {
 	auto it = _quittingConnections.find(connection);
 	if (it != _quittingConnections.end()) {
@@ -909,6 +954,15 @@ void Instance::Private::sendRequest(
 	request->msDate = crl::now(); // > 0 - can send without container
 	request->needsLayer = needsLayer;
 
+	if (!_requestsCanWait.empty()
+		&& request->size() > SecureRequest::kMessageBodyPosition) {
+		const auto type = mtpTypeId(
+			request->at(SecureRequest::kMessageBodyPosition));
+		const auto i = _requestsCanWait.find(type);
+		if (i != _requestsCanWait.end()) {
+			accumulate_max(msCanWait, i->second);
+		}
+	}
 	session->sendPrepared(request, msCanWait);
 }
 
@@ -1046,6 +1100,9 @@ void Instance::Private::execCallback(
 		}
 	}
 	if (h.onDone || h.onFail) {
+		const auto request = getRequest(requestId);
+		const auto shiftedDcId = queryRequestByDc(requestId);
+		const auto started = std::chrono::steady_clock::now();
 		const auto handleError = [&](const RPCError &error) {
 			DEBUG_LOG(("RPC Info: "
 				"error received, code %1, type %2, description: %3"
@@ -1077,6 +1134,16 @@ void Instance::Private::execCallback(
 				"RESPONSE_PARSE_FAILED",
 				QString("exception text: ") + e.what()));
 		}
+		if (request
+			&& request->size() > SecureRequest::kMessageBodyPosition) {
+			const auto duration = std::chrono::steady_clock::now() - started;
+			RecordLatency(
+				LatencyPhase::Handler,
+				mtpTypeId(request->at(SecureRequest::kMessageBodyPosition)),
+				shiftedDcId.value_or(0),
+				std::chrono::duration_cast<std::chrono::microseconds>(
+					duration).count());
+		}
 	} else {
 		DEBUG_LOG(("RPC Info: parser not found for %1").arg(requestId));
 		unregisterRequest(requestId);
@@ -1678,6 +1745,14 @@ void Instance::queueQuittingConnection(
 	_private->queueQuittingConnection(std::move(connection));
 }
 
+void Instance::setRequestsCanWait(mtpTypeId type, crl::time msCanWait) {
+	_private->setRequestsCanWait(type, msCanWait);
+}
+
+not_null<internal::ConnectionThreads*> Instance::connectionThreads() {
+	return _private->connectionThreads();
+}
+
 void Instance::setUpdatesHandler(RPCDoneHandlerPtr onDone) {
 	_private->setUpdatesHandler(onDone);
 }
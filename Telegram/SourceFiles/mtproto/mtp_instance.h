@@ -16,6 +16,7 @@ namespace internal {
 class Dcenter;
 class Session;
 class Connection;
+class ConnectionThreads;
 } // namespace internal
 
 class DcOptions;
@@ -137,6 +138,10 @@ public:
 
 	void sendAnything(ShiftedDcId shiftedDcId = 0, crl::time msCanWait = 0);
 
+	// Requests of this type wait at least that long for others to join
+	// them in one container, unless something is sent right away.
+	void setRequestsCanWait(mtpTypeId type, crl::time msCanWait);
+
 	void restart();
 	void restart(ShiftedDcId shiftedDcId);
 	int32 dcstate(ShiftedDcId shiftedDcId = 0);
@@ -153,6 +158,7 @@ public:
 	void unpaused();
 
 	void queueQuittingConnection(std::unique_ptr<internal::Connection> &&connection);
+	[[nodiscard]] not_null<internal::ConnectionThreads*> connectionThreads();
 
 	void setUpdatesHandler(RPCDoneHandlerPtr onDone);
 	void setGlobalFailHandler(RPCFailHandlerPtr onFail);
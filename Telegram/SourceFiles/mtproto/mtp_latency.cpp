@@ -0,0 +1,191 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "mtproto/mtp_latency.h"
+
+namespace MTP {
+namespace details {
+namespace {
+
+constexpr auto kSubBucketBits = 3;
+constexpr auto kSubBuckets = (1 << kSubBucketBits);
+constexpr auto kHalfSubBuckets = kSubBuckets / 2;
+constexpr auto kSlotsCount = 256;
+
+int BucketIndex(int64 value) {
+	if (value < kSubBuckets) {
+		return int(std::max(value, int64(0)));
+	}
+	auto shift = 0;
+	while ((value >> shift) >= kSubBuckets) {
+		++shift;
+	}
+	return std::min(
+		shift * kHalfSubBuckets + int(value >> shift),
+		LatencyHistogram::kBucketsCount - 1);
+}
+
+int64 BucketValue(int index) {
+	if (index < kSubBuckets) {
+		return index;
+	}
+	const auto shift = index / kHalfSubBuckets - 1;
+	return int64(index - shift * kHalfSubBuckets) << shift;
+}
+
+uint64 SlotKey(mtpTypeId type, ShiftedDcId shiftedDcId) {
+	return (uint64(type) << 32) | uint64(uint32(shiftedDcId));
+}
+
+struct Slot {
+	std::atomic<uint64> key = 0;
+	LatencyHistogram histogram;
+};
+
+// Open addressing without removals, so lookups never take a lock.
+class LatencyTable {
+public:
+	LatencyHistogram *histogram(uint64 key);
+
+	template <typename Method>
+	void enumerate(Method &&method) const;
+
+private:
+	Slot _slots[kSlotsCount];
+
+};
+
+LatencyHistogram *LatencyTable::histogram(uint64 key) {
+	const auto start = (key * 0x9E3779B97F4A7C15ULL) >> 56;
+	for (auto i = 0; i != kSlotsCount; ++i) {
+		auto &slot = _slots[(start + i) % kSlotsCount];
+		auto current = slot.key.load(std::memory_order_acquire);
+		if (!current && slot.key.compare_exchange_strong(
+				current,
+				key,
+				std::memory_order_acq_rel)) {
+			return &slot.histogram;
+		} else if (current == key) {
+			return &slot.histogram;
+		}
+	}
+	return nullptr;
+}
+
+template <typename Method>
+void LatencyTable::enumerate(Method &&method) const {
+	for (const auto &slot : _slots) {
+		if (const auto key = slot.key.load(std::memory_order_acquire)) {
+			method(
+				mtpTypeId(key >> 32),
+				ShiftedDcId(uint32(key & 0xFFFFFFFFULL)),
+				slot.histogram);
+		}
+	}
+}
+
+LatencyTable &Table(LatencyPhase phase) {
+	static auto Tables = std::array<LatencyTable, 2>();
+	return Tables[(phase == LatencyPhase::Network) ? 0 : 1];
+}
+
+QString FormatMilliseconds(int64 microseconds) {
+	return QString::number(microseconds / 1000., 'f', 1) + " ms";
+}
+
+QString PhaseReport(LatencyPhase phase, int limit) {
+	struct Entry {
+		mtpTypeId type = 0;
+		ShiftedDcId shiftedDcId = 0;
+		const LatencyHistogram *histogram = nullptr;
+		int64 count = 0;
+	};
+	auto entries = std::vector<Entry>();
+	Table(phase).enumerate([&](
+			mtpTypeId type,
+			ShiftedDcId shiftedDcId,
+			const LatencyHistogram &histogram) {
+		if (const auto count = histogram.count()) {
+			entries.push_back({ type, shiftedDcId, &histogram, count });
+		}
+	});
+	ranges::sort(entries, ranges::greater(), &Entry::count);
+	if (entries.size() > size_t(limit)) {
+		entries.erase(begin(entries) + limit, end(entries));
+	}
+
+	auto result = QStringList();
+	for (const auto &entry : entries) {
+		result.push_back(QString("0x%1 dc %2: %3, p50 %4, p90 %5, p99 %6"
+		).arg(entry.type, 8, 16, QChar('0')
+		).arg(entry.shiftedDcId
+		).arg(entry.count
+		).arg(FormatMilliseconds(entry.histogram->percentile(50))
+		).arg(FormatMilliseconds(entry.histogram->percentile(90))
+		).arg(FormatMilliseconds(entry.histogram->percentile(99))));
+	}
+	return result.join('\n');
+}
+
+} // namespace
+
+void LatencyHistogram::add(int64 microseconds) {
+	_buckets[BucketIndex(microseconds)].fetch_add(
+		1,
+		std::memory_order_relaxed);
+}
+
+int64 LatencyHistogram::count() const {
+	auto result = int64();
+	for (const auto &bucket : _buckets) {
+		result += bucket.load(std::memory_order_relaxed);
+	}
+	return result;
+}
+
+int64 LatencyHistogram::percentile(int value) const {
+	auto counts = std::array<int64, kBucketsCount>();
+	auto total = int64();
+	for (auto i = 0; i != kBucketsCount; ++i) {
+		counts[i] = _buckets[i].load(std::memory_order_relaxed);
+		total += counts[i];
+	}
+	if (!total) {
+		return 0;
+	}
+	const auto rank = std::min(total * value / 100, total - 1);
+	auto accumulated = int64();
+	for (auto i = 0; i != kBucketsCount; ++i) {
+		accumulated += counts[i];
+		if (accumulated > rank) {
+			return BucketValue(i);
+		}
+	}
+	return BucketValue(kBucketsCount - 1);
+}
+
+} // namespace details
+
+void RecordLatency(
+		LatencyPhase phase,
+		mtpTypeId type,
+		ShiftedDcId shiftedDcId,
+		int64 microseconds) {
+	const auto key = details::SlotKey(type, shiftedDcId);
+	if (const auto histogram = details::Table(phase).histogram(key)) {
+		histogram->add(microseconds);
+	}
+}
+
+QString LatencyReport(int limit) {
+	return "Network:\n"
+		+ details::PhaseReport(LatencyPhase::Network, limit)
+		+ "\n\nHandler:\n"
+		+ details::PhaseReport(LatencyPhase::Handler, limit);
+}
+
+} // namespace MTP
@@ -0,0 +1,48 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <atomic>
+
+namespace MTP {
+namespace details {
+
+// Log-linear buckets with three significant bits, ~12% precision.
+// Any thread may add values concurrently, readers get a snapshot.
+class LatencyHistogram {
+public:
+	static constexpr auto kBucketsCount = 128;
+
+	void add(int64 microseconds);
+
+	[[nodiscard]] int64 count() const;
+	[[nodiscard]] int64 percentile(int value) const;
+
+private:
+	std::atomic<uint32> _buckets[kBucketsCount] = {};
+
+};
+
+} // namespace details
+
+enum class LatencyPhase {
+	Network, // From packet sent to its rpc_result received.
+	Handler, // Response parsing and handler in the main thread.
+};
+
+// Any thread.
+void RecordLatency(
+	LatencyPhase phase,
+	mtpTypeId type,
+	ShiftedDcId shiftedDcId,
+	int64 microseconds);
+
+// Most frequent request types and dcs first.
+[[nodiscard]] QString LatencyReport(int limit);
+
+} // namespace MTP
@@ -63,6 +63,39 @@ inline bool isDefaultHandledError(const RPCError &error) {
 	return isTemporaryError(error);
 }
 
+// Reads a big response on a background thread, the callback is called on
+// the main thread with the result and the parse error, if it has failed.
+template <typename TResponse, typename Callback>
+void ReadInBackground(
+		const mtpPrime *from,
+		const mtpPrime *end,
+		Callback &&callback) {
+	crl::async([
+		data = std::vector<mtpPrime>(from, end),
+		callback = std::forward<Callback>(callback)
+	]() mutable {
+		auto result = TResponse();
+		auto failed = std::optional<QString>();
+		try {
+			const mtpPrime *from = data.data();
+			result.read(from, from + data.size());
+		} catch (Exception &e) {
+			failed = QString("exception text: ") + e.what();
+		}
+		crl::on_main([
+			callback = std::move(callback),
+			result = std::move(result),
+			failed = std::move(failed)
+		]() mutable {
+			auto error = failed
+				? std::make_optional(
+					RPCError::Local("RESPONSE_PARSE_FAILED", *failed))
+				: std::nullopt;
+			callback(std::move(result), std::move(error));
+		});
+	});
+}
+
 } // namespace MTP
 
 class RPCAbstractDoneHandler { // abstract done
@@ -443,6 +476,40 @@ private:
 
 };
 
+template <typename TReturn, typename TReceiver, typename TResponse>
+class RPCDoneHandlerOwnedInBackground // done(result), read in background
+: public RPCOwnedDoneHandler
+, public std::enable_shared_from_this<
+	RPCDoneHandlerOwnedInBackground<TReturn, TReceiver, TResponse>> {
+	using CallbackType = TReturn (TReceiver::*)(const TResponse &);
+	using FailCallbackType = bool (TReceiver::*)(const RPCError &);
+
+public:
+	RPCDoneHandlerOwnedInBackground(TReceiver *receiver, CallbackType onDone, FailCallbackType onFail) : RPCOwnedDoneHandler(receiver), _onDone(onDone), _onFail(onFail) {
+	}
+	void operator()(mtpRequestId requestId, const mtpPrime *from, const mtpPrime *end) override {
+		if (!_owner) {
+			return;
+		}
+		MTP::ReadInBackground<TResponse>(from, end, [that = this->shared_from_this()](
+				TResponse &&result,
+				std::optional<RPCError> &&error) {
+			if (const auto receiver = static_cast<TReceiver*>(that->_owner)) {
+				if (error) {
+					(receiver->*(that->_onFail))(*error);
+				} else {
+					(receiver->*(that->_onDone))(std::move(result));
+				}
+			}
+		});
+	}
+
+private:
+	CallbackType _onDone;
+	FailCallbackType _onFail;
+
+};
+
 template <typename T, typename TReturn, typename TReceiver>
 class RPCBindedDoneHandlerBareOwned : public RPCOwnedDoneHandler { // done(b, from, end)
 	using CallbackType = TReturn (TReceiver::*)(T, const mtpPrime *, const mtpPrime *);
@@ -717,6 +784,12 @@ public:
 		return RPCDoneHandlerPtr(new RPCDoneHandlerOwnedNoReq<TReturn, TReceiver>(static_cast<TReceiver*>(this), onDone));
 	}
 
+	// The response is read on a background thread, parse errors go to onFail.
+	template <typename TReturn, typename TReceiver, typename TResponse> // done(result)
+	RPCDoneHandlerPtr rpcDoneInBackground(TReturn (TReceiver::*onDone)(const TResponse &), bool (TReceiver::*onFail)(const RPCError &)) {
+		return RPCDoneHandlerPtr(new RPCDoneHandlerOwnedInBackground<TReturn, TReceiver, TResponse>(static_cast<TReceiver*>(this), onDone, onFail));
+	}
+
 	template <typename TReceiver> // fail(error)
 	RPCFailHandlerPtr rpcFail(bool (TReceiver::*onFail)(const RPCError &)) {
 		return RPCFailHandlerPtr(new RPCFailHandlerOwned<TReceiver>(static_cast<TReceiver*>(this), onFail));
@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "base/variant.h"
+#include "base/binary_guard.h"
 
 namespace MTP {
 
@@ -44,9 +45,15 @@ class Sender {
 				handler(result, requestId);
 			}
 
+		};
+		template <typename Response>
+		class TypedDoneHandler : public RPCAbstractDoneHandler {
+		public:
+			virtual void handle(mtpRequestId requestId, Response &&result) = 0;
+
 		};
 		template <typename Response, template <typename> typename PolicyTemplate>
-		class DoneHandler : public RPCAbstractDoneHandler {
+		class DoneHandler : public TypedDoneHandler<Response> {
 			using Policy = PolicyTemplate<Response>;
 			using Callback = typename Policy::Callback;
 
@@ -65,12 +72,59 @@ class Sender {
 				}
 			}
 
+			void handle(mtpRequestId requestId, Response &&result) override {
+				auto handler = std::move(_handler);
+				_sender->senderRequestHandled(requestId);
+
+				if (handler) {
+					Policy::handle(std::move(handler), requestId, std::move(result));
+				}
+			}
+
 		private:
 			not_null<Sender*> _sender;
 			Callback _handler;
 
 		};
 
+		template <typename Response>
+		class ReadInBackgroundHandler
+		: public RPCAbstractDoneHandler
+		, public std::enable_shared_from_this<ReadInBackgroundHandler<Response>> {
+		public:
+			ReadInBackgroundHandler(
+				not_null<Sender*> sender,
+				std::shared_ptr<TypedDoneHandler<Response>> done,
+				RPCFailHandlerPtr fail)
+			: _sender(sender)
+			, _done(std::move(done))
+			, _fail(std::move(fail)) {
+			}
+
+			void operator()(mtpRequestId requestId, const mtpPrime *from, const mtpPrime *end) override {
+				ReadInBackground<Response>(from, end, [
+					that = this->shared_from_this(),
+					guard = _sender->senderRequestGuard(requestId),
+					requestId
+				](Response &&result, std::optional<RPCError> &&error) {
+					if (!guard) {
+						return;
+					} else if (!error) {
+						that->_done->handle(requestId, std::move(result));
+					} else if (!that->_fail
+						|| !(*that->_fail)(requestId, *error)) {
+						that->_sender->senderRequestHandled(requestId);
+					}
+				});
+			}
+
+		private:
+			not_null<Sender*> _sender;
+			std::shared_ptr<TypedDoneHandler<Response>> _done;
+			RPCFailHandlerPtr _fail;
+
+		};
+
 		struct FailPlainPolicy {
 			using Callback = FnMut<void(const RPCError &error)>;
 			static void handle(Callback &&handler, mtpRequestId requestId, const RPCError &error) {
@@ -148,6 +202,9 @@ class Sender {
 		void setAfter(mtpRequestId requestId) noexcept {
 			_afterRequestId = requestId;
 		}
+		void setReadInBackground() noexcept {
+			_readInBackground = true;
+		}
 
 		ShiftedDcId takeDcId() const noexcept {
 			return _dcId;
@@ -169,6 +226,9 @@ class Sender {
 		mtpRequestId takeAfter() const noexcept {
 			return _afterRequestId;
 		}
+		bool takeReadInBackground() const noexcept {
+			return _readInBackground;
+		}
 
 		not_null<Sender*> sender() const noexcept {
 			return _sender;
@@ -185,6 +245,7 @@ class Sender {
 		base::variant<FailPlainHandler, FailRequestIdHandler> _fail;
 		FailSkipPolicy _failSkipPolicy = FailSkipPolicy::Simple;
 		mtpRequestId _afterRequestId = 0;
+		bool _readInBackground = false;
 
 	};
 
@@ -238,11 +299,29 @@ public:
 			return *this;
 		}
 
+		// Read the big responses on a background thread, the handlers
+		// are still called on the main thread.
+		[[nodiscard]] SpecificRequestBuilder &readInBackground() noexcept {
+			setReadInBackground();
+			return *this;
+		}
+
 		mtpRequestId send() {
+			using Response = typename Request::ResponseType;
+
+			auto done = takeOnDone();
+			auto fail = takeOnFail();
+			if (done && takeReadInBackground()) {
+				done = std::make_shared<ReadInBackgroundHandler<Response>>(
+					sender(),
+					std::static_pointer_cast<TypedDoneHandler<Response>>(
+						std::move(done)),
+					fail);
+			}
 			const auto id = MainInstance()->send(
 				_request,
-				takeOnDone(),
-				takeOnFail(),
+				std::move(done),
+				std::move(fail),
 				takeDcId(),
 				takeCanWait(),
 				takeAfter());
@@ -378,15 +457,21 @@ private:
 			it->handled();
 			_requests.erase(it);
 		}
+		_readingInBackground.remove(requestId);
 	}
 	void senderRequestCancel(mtpRequestId requestId) {
 		auto it = _requests.find(requestId);
 		if (it != _requests.cend()) {
 			_requests.erase(it);
 		}
+		_readingInBackground.remove(requestId);
+	}
+	base::binary_guard senderRequestGuard(mtpRequestId requestId) {
+		return _readingInBackground[requestId].make_guard();
 	}
 
 	base::flat_set<RequestWrap, RequestWrapComparator> _requests;
+	base::flat_map<mtpRequestId, base::binary_guard> _readingInBackground;
 
 };
 
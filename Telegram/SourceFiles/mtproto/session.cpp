@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/dcenter.h"
 #include "mtproto/auth_key.h"
 #include "core/crash_reports.h"
+#include "base/trace.h"
 
 namespace MTP {
 namespace internal {
@@ -541,6 +542,9 @@ void Session::sendPrepared(
 	}
 
 	DEBUG_LOG(("MTP Info: added, requestId %1").arg(request->requestId));
+	if (newRequest) {
+		base::trace::FlowBegin("request", request->requestId, "mtproto");
+	}
 
 	sendAnything(msCanWait);
 }
@@ -596,6 +600,8 @@ void Session::tryToReceive() {
 		_needToReceive = true;
 		return;
 	}
+	auto updates = std::vector<SerializedMessage>();
+	auto nextUpdate = begin(updates);
 	while (true) {
 		auto requestId = mtpRequestId(0);
 		auto isUpdate = false;
@@ -604,22 +610,23 @@ void Session::tryToReceive() {
 			QWriteLocker locker(data.haveReceivedMutex());
 			auto &responses = data.haveReceivedResponses();
 			auto response = responses.begin();
-			if (response == responses.cend()) {
-				auto &updates = data.haveReceivedUpdates();
-				auto update = updates.begin();
-				if (update == updates.cend()) {
-					return;
-				} else {
-					message = std::move(*update);
-					isUpdate = true;
-					updates.pop_front();
-				}
-			} else {
+			if (response != responses.cend()) {
 				requestId = response.key();
 				message = std::move(response.value());
 				responses.erase(response);
 			}
 		}
+		if (!requestId) {
+			if (nextUpdate == end(updates)) {
+				updates = data.takeReceivedUpdates();
+				nextUpdate = begin(updates);
+				if (nextUpdate == end(updates)) {
+					return;
+				}
+			}
+			message = std::move(*nextUpdate++);
+			isUpdate = true;
+		}
 		if (isUpdate) {
 			if (dcWithShift == BareDcId(dcWithShift)) { // call globalCallback only in main session
 				_instance->globalCallback(message.constData(), message.constData() + message.size());
@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "base/timer.h"
+#include "base/mpsc_queue.h"
 #include "mtproto/rpc_sender.h"
 
 namespace MTP {
@@ -42,35 +43,39 @@ public:
 
 };
 
+// Sorted window of the last received msgIds. They come almost ordered,
+// so new ids are appended at the back and the oldest are dropped from
+// the front, both without moving the rest of the window.
 class ReceivedMsgIds {
 public:
 	bool registerMsgId(mtpMsgId msgId, bool needAck) {
-		auto i = _idsNeedAck.constFind(msgId);
-		if (i == _idsNeedAck.cend()) {
-			if (_idsNeedAck.size() < kIdsBufferSize || msgId > min()) {
-				_idsNeedAck.insert(msgId, needAck);
-				return true;
-			}
-			MTP_LOG(-1, ("No need to handle - %1 < min = %2").arg(msgId).arg(min()));
-		} else {
+		if (_ids.empty() || msgId > _ids.back().msgId) {
+			_ids.push_back(Entry{ msgId, needAck });
+			return true;
+		}
+		const auto i = find(msgId);
+		if (i != end(_ids) && i->msgId == msgId) {
 			MTP_LOG(-1, ("No need to handle - %1 already is in map").arg(msgId));
+		} else if (_ids.size() < kIdsBufferSize || msgId > min()) {
+			_ids.insert(i, Entry{ msgId, needAck });
+			return true;
+		} else {
+			MTP_LOG(-1, ("No need to handle - %1 < min = %2").arg(msgId).arg(min()));
 		}
 		return false;
 	}
 
 	mtpMsgId min() const {
-		return _idsNeedAck.isEmpty() ? 0 : _idsNeedAck.cbegin().key();
+		return _ids.empty() ? 0 : _ids.front().msgId;
 	}
 
 	mtpMsgId max() const {
-		auto end = _idsNeedAck.cend();
-		return _idsNeedAck.isEmpty() ? 0 : (--end).key();
+		return _ids.empty() ? 0 : _ids.back().msgId;
 	}
 
 	void shrink() {
-		auto size = _idsNeedAck.size();
-		while (size-- > kIdsBufferSize) {
-			_idsNeedAck.erase(_idsNeedAck.begin());
+		while (_ids.size() > kIdsBufferSize) {
+			_ids.pop_front();
 		}
 	}
 
@@ -80,19 +85,31 @@ public:
 		NoAckNeeded,
 	};
 	State lookup(mtpMsgId msgId) const {
-		auto i = _idsNeedAck.constFind(msgId);
-		if (i == _idsNeedAck.cend()) {
+		if (_ids.empty() || msgId < min() || msgId > max()) {
+			return State::NotFound;
+		}
+		const auto i = find(msgId);
+		if (i == end(_ids) || i->msgId != msgId) {
 			return State::NotFound;
 		}
-		return i.value() ? State::NeedsAck : State::NoAckNeeded;
+		return i->needAck ? State::NeedsAck : State::NoAckNeeded;
 	}
 
 	void clear() {
-		_idsNeedAck.clear();
+		_ids.clear();
 	}
 
 private:
-	QMap<mtpMsgId, bool> _idsNeedAck;
+	struct Entry {
+		mtpMsgId msgId = 0;
+		bool needAck = false;
+	};
+
+	std::deque<Entry>::const_iterator find(mtpMsgId msgId) const {
+		return ranges::lower_bound(_ids, msgId, ranges::less(), &Entry::msgId);
+	}
+
+	std::deque<Entry> _ids;
 
 };
 
@@ -250,11 +267,17 @@ public:
 	const QMap<mtpRequestId, SerializedMessage> &haveReceivedResponses() const {
 		return _receivedResponses;
 	}
-	QList<SerializedMessage> &haveReceivedUpdates() {
-		return _receivedUpdates;
+
+	// Updates don't take haveReceivedMutex(), any thread pushes them
+	// and only the main thread takes them.
+	void pushReceivedUpdate(SerializedMessage &&update) {
+		_receivedUpdates.push(std::move(update));
+	}
+	[[nodiscard]] bool hasReceivedUpdates() const {
+		return !_receivedUpdates.empty();
 	}
-	const QList<SerializedMessage> &haveReceivedUpdates() const {
-		return _receivedUpdates;
+	[[nodiscard]] std::vector<SerializedMessage> takeReceivedUpdates() {
+		return _receivedUpdates.take();
 	}
 	QMap<mtpMsgId, bool> &stateRequestMap() {
 		return _stateRequest;
@@ -300,7 +323,7 @@ private:
 	QMap<mtpMsgId, bool> _stateRequest; // set of msg_id's, whose state should be requested
 
 	QMap<mtpRequestId, SerializedMessage> _receivedResponses; // map of request_id -> response that should be processed in the main thread
-	QList<SerializedMessage> _receivedUpdates; // list of updates that should be processed in the main thread
+	base::mpsc_queue<SerializedMessage> _receivedUpdates; // list of updates that should be processed in the main thread
 
 	// mutexes
 	mutable QReadWriteLock _lock;
@@ -77,6 +77,18 @@ struct PeerUpdate {
 
 };
 
+void mergePeerUpdate(PeerUpdate &mergeTo, const PeerUpdate &mergeFrom);
+
+// Updates of the same peer queued in PeerUpdated() are merged.
+inline PeerData *observable_event_key(const PeerUpdate &update) {
+	return update.peer;
+}
+inline void merge_observable_event(
+		PeerUpdate &mergeTo,
+		const PeerUpdate &mergeFrom) {
+	mergePeerUpdate(mergeTo, mergeFrom);
+}
+
 void peerUpdatedDelayed(const PeerUpdate &update);
 inline void peerUpdatedDelayed(PeerData *peer, PeerUpdate::Flags events) {
 	PeerUpdate update(peer);
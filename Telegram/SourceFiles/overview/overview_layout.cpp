@@ -31,6 +31,9 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/image/image.h"
 #include "ui/text_options.h"
 
+#include <crl/crl_async.h>
+#include <crl/crl_on_main.h>
+
 namespace Overview {
 namespace Layout {
 namespace {
@@ -44,6 +47,34 @@ TextParseOptions _documentNameOptions = {
 	Qt::LayoutDirectionAuto, // dir
 };
 
+// Crops to a square and scales, may be called from any thread.
+QImage PreparePhotoPix(QImage image, int size, bool blur) {
+	if (blur) {
+		image = Images::prepareBlur(std::move(image));
+	}
+	if (image.width() > image.height()) {
+		image = image.copy(
+			(image.width() - image.height()) / 2,
+			0,
+			image.height(),
+			image.height());
+	} else if (image.width() < image.height()) {
+		image = image.copy(
+			0,
+			(image.height() - image.width()) / 2,
+			image.width(),
+			image.width());
+	}
+	if (image.width() != size) {
+		image = image.scaled(
+			size,
+			size,
+			Qt::KeepAspectRatioByExpanding,
+			Qt::SmoothTransformation);
+	}
+	return image;
+}
+
 TextWithEntities ComposeNameWithEntities(DocumentData *document) {
 	TextWithEntities result;
 	const auto song = document->song();
@@ -315,9 +346,8 @@ void Photo::paint(Painter &p, const QRect &clip, TextSelection selection, const
 		_data->thumbnail()->automaticLoad(parent()->fullId(), parent());
 		good = _data->thumbnail()->loaded();
 	}
-	if ((good && !_goodLoaded) || _pix.width() != _width * cIntRetinaFactor()) {
+	if ((good && !_goodLoaded) || _pixWidth != _width * cIntRetinaFactor()) {
 		_goodLoaded = good;
-		_pix = QPixmap();
 		if (_goodLoaded) {
 			setPixFrom(_data->loaded()
 				? _data->large()
@@ -337,7 +367,8 @@ void Photo::paint(Painter &p, const QRect &clip, TextSelection selection, const
 	if (_pix.isNull()) {
 		p.fillRect(0, 0, _width, _height, st::overviewPhotoBg);
 	} else {
-		p.drawPixmap(0, 0, _pix);
+		// Until the prepared pixmap for the current size is ready.
+		p.drawPixmap(QRect(0, 0, _width, _height), _pix);
 	}
 
 	if (selected) {
@@ -352,29 +383,31 @@ void Photo::paint(Painter &p, const QRect &clip, TextSelection selection, const
 void Photo::setPixFrom(not_null<Image*> image) {
 	Expects(image->loaded());
 
+	// Blurring and scaling a large photo takes a while,
+	// so the pixmap is prepared in the background.
 	const auto size = _width * cIntRetinaFactor();
-	auto img = image->original();
-	if (!_goodLoaded) {
-		img = Images::prepareBlur(std::move(img));
-	}
-	if (img.width() == img.height()) {
-		if (img.width() != size) {
-			img = img.scaled(size, size, Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
-		}
-	} else if (img.width() > img.height()) {
-		img = img.copy((img.width() - img.height()) / 2, 0, img.height(), img.height()).scaled(size, size, Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
-	} else {
-		img = img.copy(0, (img.height() - img.width()) / 2, img.width(), img.width()).scaled(size, size, Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
-	}
-	img.setDevicePixelRatio(cRetinaFactor());
+	const auto blur = !_goodLoaded;
+	const auto ratio = cRetinaFactor();
+	const auto generation = ++_pixGeneration;
+	const auto weak = base::make_weak(this);
+	_pixWidth = size;
+	crl::async([=, original = image->original()]() mutable {
+		auto prepared = PreparePhotoPix(std::move(original), size, blur);
+		prepared.setDevicePixelRatio(ratio);
+		crl::on_main(weak, [=, prepared = std::move(prepared)]() mutable {
+			if (_pixGeneration != generation) {
+				return;
+			}
+			_pix = App::pixmapFromImageInPlace(std::move(prepared));
+			Auth().data().requestItemRepaint(parent());
+		});
+	});
 
 	// In case we have inline thumbnail we can unload all images and we still
 	// won't get a blank image in the media viewer when the photo is opened.
 	if (_data->thumbnailInline() != nullptr) {
 		_data->unload();
 	}
-
-	_pix = App::pixmapFromImageInPlace(std::move(img));
 }
 
 TextState Photo::getState(
@@ -1382,7 +1415,7 @@ Link::Link(
 		_photol = std::make_shared<UrlClickHandler>(mainUrl);
 	}
 	if (from >= till && _page) {
-		text = _page->description.text;
+		text = _page->descriptionText();
 		from = 0;
 		till = text.size();
 	}
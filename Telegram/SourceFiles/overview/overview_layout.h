@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "layout.h"
+#include "base/weak_ptr.h"
 #include "core/click_handler_types.h"
 #include "ui/effects/animations.h"
 #include "ui/effects/radial_animation.h"
@@ -198,7 +199,7 @@ private:
 
 };
 
-class Photo : public ItemBase {
+class Photo : public ItemBase, public base::has_weak_ptr {
 public:
 	Photo(
 		not_null<HistoryItem*> parent,
@@ -218,6 +219,8 @@ private:
 	ClickHandlerPtr _link;
 
 	QPixmap _pix;
+	int _pixWidth = 0;
+	int _pixGeneration = 0;
 	bool _goodLoaded = false;
 
 };
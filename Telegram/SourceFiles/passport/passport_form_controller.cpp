@@ -1375,10 +1375,13 @@ void FormController::uploadScan(
 		return std::nullopt;
 	}();
 	auto &scan = nonconst->fileInEdit(type, fileIndex);
-	encryptFile(scan, std::move(content), [=](UploadScanData &&result) {
-		uploadEncryptedFile(
-			nonconst->fileInEdit(type, fileIndex),
-			std::move(result));
+	encryptFile(scan, std::move(content), [=](
+			UploadScanData &&result,
+			QImage &&image) {
+		auto &file = nonconst->fileInEdit(type, fileIndex);
+		file.fields.image = std::move(image);
+		uploadEncryptedFile(file, std::move(result));
+		_scanUpdated.fire(&file);
 	});
 }
 
@@ -1405,7 +1408,6 @@ void FormController::prepareFile(
 	file.fields.dcId = MTP::maindc();
 	file.fields.secret = GenerateSecretBytes();
 	file.fields.date = unixtime();
-	file.fields.image = ReadImage(bytes::make_span(content));
 	file.fields.downloadOffset = file.fields.size;
 
 	_scanUpdated.fire(&file);
@@ -1414,9 +1416,11 @@ void FormController::prepareFile(
 void FormController::encryptFile(
 		EditFile &file,
 		QByteArray &&content,
-		Fn<void(UploadScanData &&result)> callback) {
+		Fn<void(UploadScanData &&result, QImage &&image)> callback) {
 	prepareFile(file, content);
 
+	// Each file is decoded and encrypted on its own worker thread,
+	// so the scans chosen together are prepared in parallel.
 	const auto weak = std::weak_ptr<bool>(file.guard);
 	crl::async([
 		=,
@@ -1424,6 +1428,7 @@ void FormController::encryptFile(
 		bytes = std::move(content),
 		fileSecret = file.fields.secret
 	] {
+		auto image = ReadImage(bytes::make_span(bytes));
 		auto data = EncryptData(
 			bytes::make_span(bytes),
 			fileSecret);
@@ -1436,9 +1441,13 @@ void FormController::encryptFile(
 			result.bytes.data(),
 			result.bytes.size(),
 			result.md5checksum.data());
-		crl::on_main([=, encrypted = std::move(result)]() mutable {
+		crl::on_main([
+			=,
+			encrypted = std::move(result),
+			image = std::move(image)
+		]() mutable {
 			if (weak.lock()) {
-				callback(std::move(encrypted));
+				callback(std::move(encrypted), std::move(image));
 			}
 		});
 	});
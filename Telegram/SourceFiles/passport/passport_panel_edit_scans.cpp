@@ -32,6 +32,9 @@ constexpr auto kMaxDimensions = 2048;
 constexpr auto kMaxSize = 10 * 1024 * 1024;
 constexpr auto kJpegQuality = 89;
 
+// Several chosen scans are read and processed at the same time.
+constexpr auto kMaxProcessingScans = 4;
+
 static_assert(kMaxSize <= Storage::kUseBigFilesFrom);
 
 base::variant<ReadScanError, QByteArray> ProcessImage(QByteArray &&bytes) {
@@ -64,6 +67,99 @@ base::variant<ReadScanError, QByteArray> ProcessImage(QByteArray &&bytes) {
 	return result;
 }
 
+struct ProcessedScan {
+	QByteArray content;
+	std::optional<ReadScanError> error;
+	bool stop = false;
+	bool finished = false;
+};
+
+struct ProcessScansState {
+	QStringList paths;
+	std::vector<ProcessedScan> scans;
+	int started = 0;
+	int delivered = 0;
+	bool stopped = false;
+	Fn<void(QByteArray&&)> done;
+	Fn<void(ReadScanError)> error;
+};
+
+ProcessedScan ProcessScanFile(const QString &path) {
+	auto result = ProcessedScan();
+	result.finished = true;
+
+	auto content = [&] {
+		QFile f(path);
+		if (f.size() > App::kImageSizeLimit) {
+			result.error = ReadScanError::FileTooLarge;
+			return QByteArray();
+		} else if (!f.open(QIODevice::ReadOnly)) {
+			result.error = ReadScanError::CantReadImage;
+			return QByteArray();
+		}
+		return f.readAll();
+	}();
+	if (content.isEmpty()) {
+		return result;
+	}
+	auto processed = ProcessImage(std::move(content));
+	if (const auto error = base::get_if<ReadScanError>(&processed)) {
+		// The rest of the chosen files are skipped after such an error.
+		result.error = *error;
+		result.stop = true;
+	} else {
+		const auto bytes = base::get_if<QByteArray>(&processed);
+		Assert(bytes != nullptr);
+		result.content = std::move(*bytes);
+	}
+	return result;
+}
+
+void StartProcessingScans(const std::shared_ptr<ProcessScansState> &state);
+
+void DeliverProcessedScans(const std::shared_ptr<ProcessScansState> &state) {
+	while (!state->stopped
+		&& state->delivered < int(state->scans.size())
+		&& state->scans[state->delivered].finished) {
+		auto &scan = state->scans[state->delivered++];
+		if (scan.error) {
+			state->error(*scan.error);
+			state->stopped = scan.stop;
+		} else if (!scan.content.isEmpty()) {
+			state->done(base::take(scan.content));
+		}
+	}
+	StartProcessingScans(state);
+}
+
+void StartProcessingScans(const std::shared_ptr<ProcessScansState> &state) {
+	while (!state->stopped
+		&& state->started < state->paths.size()
+		&& state->started - state->delivered < kMaxProcessingScans) {
+		const auto index = state->started++;
+		crl::async([=, path = state->paths[index]] {
+			auto result = ProcessScanFile(path);
+			crl::on_main([=, scan = std::move(result)]() mutable {
+				state->scans[index] = std::move(scan);
+				DeliverProcessedScans(state);
+			});
+		});
+	}
+}
+
+// Results are passed to the callbacks in the order of the paths.
+void ProcessScanFiles(
+		QStringList &&paths,
+		Fn<void(QByteArray&&)> done,
+		Fn<void(ReadScanError)> error) {
+	const auto state = std::make_shared<ProcessScansState>();
+	state->scans.resize(paths.size());
+	state->paths = std::move(paths);
+	state->done = std::move(done);
+	state->error = std::move(error);
+	StartProcessingScans(state);
+}
+
 } // namespace
 
 class ScanButton : public Ui::AbstractButton {
@@ -859,75 +955,34 @@ void EditScans::ChooseScan(
 		Fn<void(ReadScanError)> errorCallback) {
 	Expects(parent != nullptr);
 
-	const auto processFiles = std::make_shared<Fn<void(QStringList&&)>>();
 	const auto filter = FileDialog::AllFilesFilter()
 		+ qsl(";;Image files (*")
 		+ cImgExtensions().join(qsl(" *"))
 		+ qsl(")");
 	const auto guardedCallback = crl::guard(parent, doneCallback);
 	const auto guardedError = crl::guard(parent, errorCallback);
-	const auto onMainCallback = [=](
-			QByteArray &&content,
-			QStringList &&remainingFiles) {
-		crl::on_main([
-			=,
-			bytes = std::move(content),
-			remainingFiles = std::move(remainingFiles)
-		]() mutable {
-			guardedCallback(std::move(bytes));
-			(*processFiles)(std::move(remainingFiles));
-		});
-	};
-	const auto onMainError = [=](ReadScanError error) {
-		crl::on_main([=] {
-			guardedError(error);
-		});
-	};
-	const auto processImage = [=](
-			QByteArray &&content,
-			QStringList &&remainingFiles) {
-		crl::async([
-			=,
-			bytes = std::move(content),
-			remainingFiles = std::move(remainingFiles)
-		]() mutable {
+	const auto processImage = [=](QByteArray &&content) {
+		crl::async([=, bytes = std::move(content)]() mutable {
 			auto result = ProcessImage(std::move(bytes));
-			if (const auto error = base::get_if<ReadScanError>(&result)) {
-				onMainError(*error);
-			} else {
-				auto content = base::get_if<QByteArray>(&result);
-				Assert(content != nullptr);
-				onMainCallback(std::move(*content), std::move(remainingFiles));
-			}
+			crl::on_main([=, result = std::move(result)]() mutable {
+				if (const auto error = base::get_if<ReadScanError>(&result)) {
+					guardedError(*error);
+				} else {
+					auto content = base::get_if<QByteArray>(&result);
+					Assert(content != nullptr);
+					guardedCallback(std::move(*content));
+				}
+			});
 		});
 	};
 	const auto processOpened = [=](FileDialog::OpenResult &&result) {
 		if (result.paths.size() > 0) {
-			(*processFiles)(std::move(result.paths));
+			ProcessScanFiles(
+				std::move(result.paths),
+				guardedCallback,
+				guardedError);
 		} else if (!result.remoteContent.isEmpty()) {
-			processImage(std::move(result.remoteContent), {});
-		}
-	};
-	*processFiles = [=](QStringList &&files) {
-		while (!files.isEmpty()) {
-			auto file = files.front();
-			files.removeAt(0);
-
-			auto content = [&] {
-				QFile f(file);
-				if (f.size() > App::kImageSizeLimit) {
-					guardedError(ReadScanError::FileTooLarge);
-					return QByteArray();
-				} else if (!f.open(QIODevice::ReadOnly)) {
-					guardedError(ReadScanError::CantReadImage);
-					return QByteArray();
-				}
-				return f.readAll();
-			}();
-			if (!content.isEmpty()) {
-				processImage(std::move(content), std::move(files));
-				return;
-			}
+			processImage(std::move(result.remoteContent));
 		}
 	};
 	const auto allowMany = (type == FileType::Scan)
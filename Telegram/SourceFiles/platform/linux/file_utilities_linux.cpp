@@ -14,6 +14,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mainwindow.h"
 #include "storage/localstorage.h"
 
+#include <fcntl.h>
+
 QStringList qt_make_filter_list(const QString &filter);
 
 namespace Platform {
@@ -79,6 +81,10 @@ void UnsafeShowInFolder(const QString &filepath) {
 	}
 }
 
+void PreallocateFile(QFile &file, int64 size) {
+	fallocate(file.handle(), FALLOC_FL_KEEP_SIZE, 0, size);
+}
+
 } // namespace File
 
 namespace FileDialog {
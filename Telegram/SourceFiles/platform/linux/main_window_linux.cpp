@@ -75,9 +75,7 @@ gboolean _trayIconResized(GtkStatusIcon *status_icon, gint size, gpointer popup_
 QImage _trayIconImageGen() {
 	const auto counter = Core::App().unreadBadge();
 	const auto muted = Core::App().unreadBadgeMuted();
-	const auto counterSlice = (counter >= 1000)
-		? (1000 + (counter % 100))
-		: counter;
+	const auto counterSlice = Window::IconCounterSlice(counter);
 	if (_trayIconImage.isNull() || _trayIconImage.width() != _trayIconSize || muted != _trayIconMuted || counterSlice != _trayIconCount) {
 		if (_trayIconImageBack.isNull() || _trayIconImageBack.width() != _trayIconSize) {
 			_trayIconImageBack = Core::App().logo().scaled(_trayIconSize, _trayIconSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
@@ -118,7 +116,7 @@ QImage _trayIconImageGen() {
 QString _trayIconImageFile() {
 	const auto counter = Core::App().unreadBadge();
 	const auto muted = Core::App().unreadBadgeMuted();
-	const auto counterSlice = (counter >= 1000) ? (1000 + (counter % 100)) : counter;
+	const auto counterSlice = Window::IconCounterSlice(counter);
 
 	QString name = cWorkingDir() + qsl("tdata/ticons/icon%1_%2_%3.png").arg(muted ? "mute" : "").arg(_trayIconSize).arg(counterSlice);
 	QFileInfo info(name);
@@ -334,7 +332,9 @@ void MainWindow::psUpdateIndicator() {
 
 void MainWindow::unreadCounterChangedHook() {
 	setWindowTitle(titleText());
-	updateIconCounters();
+	if (iconCounterChanged()) {
+		updateIconCounters();
+	}
 }
 
 void MainWindow::updateIconCounters() {
@@ -13,6 +13,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/history.h"
 #include "lang/lang_keys.h"
 
+#include <crl/crl_object_on_queue.h>
+
 namespace Platform {
 namespace Notifications {
 #ifndef TDESKTOP_DISABLE_GTK_INTEGRATION
@@ -227,6 +229,33 @@ private:
 
 using Notification = std::shared_ptr<NotificationData>;
 
+// The libnotify calls wait for the notifications daemon over DBus, so they
+// are done on a separate queue together with writing the userpic files.
+class NotificationsWorker final {
+public:
+	explicit NotificationsWorker(crl::weak_on_queue<NotificationsWorker> weak) {
+	}
+
+	void show(
+			const Notification &notification,
+			const QString &imagePath,
+			QImage &&image,
+			FnMut<void()> failed) {
+		if (!image.isNull()) {
+			image.save(imagePath, "PNG");
+		}
+		notification->setImage(imagePath);
+		if (!notification->show()) {
+			failed();
+		}
+	}
+
+	void close(const Notification &notification) {
+		notification->close();
+	}
+
+};
+
 QString GetServerName() {
 	if (!LibNotifyLoaded()) {
 		return QString();
@@ -321,6 +350,7 @@ public:
 private:
 	QString escapeNotificationText(const QString &text) const;
 	void showNextNotification();
+	void closeNotification(const Notification &notification);
 
 	struct QueuedNotification {
 		PeerData *peer = nullptr;
@@ -346,6 +376,8 @@ private:
 
 	std::shared_ptr<Manager*> _guarded;
 
+	crl::object_on_queue<NotificationsWorker> _worker;
+
 };
 #endif // !TDESKTOP_DISABLE_GTK_INTEGRATION
 
@@ -443,7 +475,7 @@ void Manager::Private::showNextNotification() {
 	const auto key = data.hideNameAndPhoto
 		? InMemoryKey()
 		: data.peer->userpicUniqueKey();
-	notification->setImage(_cachedUserpics.get(key, data.peer));
+	auto userpic = _cachedUserpics.prepare(key, data.peer);
 
 	auto i = _notifications.find(peerId);
 	if (i != _notifications.cend()) {
@@ -451,7 +483,7 @@ void Manager::Private::showNextNotification() {
 		if (j != i->cend()) {
 			auto oldNotification = j.value();
 			i->erase(j);
-			oldNotification->close();
+			closeNotification(oldNotification);
 			i = _notifications.find(peerId);
 		}
 	}
@@ -459,14 +491,26 @@ void Manager::Private::showNextNotification() {
 		i = _notifications.insert(peerId, QMap<MsgId, Notification>());
 	}
 	_notifications[peerId].insert(msgId, notification);
-	if (!notification->show()) {
-		i = _notifications.find(peerId);
-		if (i != _notifications.cend()) {
-			i->remove(msgId);
-			if (i->isEmpty()) _notifications.erase(i);
-		}
-		showNextNotification();
-	}
+
+	const auto weak = std::weak_ptr<Manager*>(_guarded);
+	_worker.with([
+		=,
+		path = std::move(userpic.path),
+		image = std::move(userpic.image)
+	](NotificationsWorker &worker) mutable {
+		worker.show(notification, path, std::move(image), [=] {
+			crl::on_main(weak, [=] {
+				(*weak.lock())->clearNotification(peerId, msgId);
+			});
+		});
+	});
+}
+
+void Manager::Private::closeNotification(
+		const Notification &notification) {
+	_worker.with([=](NotificationsWorker &worker) {
+		worker.close(notification);
+	});
 }
 
 void Manager::Private::clearAll() {
@@ -475,7 +519,7 @@ void Manager::Private::clearAll() {
 	auto temp = base::take(_notifications);
 	for_const (auto &notifications, temp) {
 		for_const (auto notification, notifications) {
-			notification->close();
+			closeNotification(notification);
 		}
 	}
 }
@@ -495,7 +539,7 @@ void Manager::Private::clearFromHistory(History *history) {
 		_notifications.erase(i);
 
 		for_const (auto notification, temp) {
-			notification->close();
+			closeNotification(notification);
 		}
 	}
 
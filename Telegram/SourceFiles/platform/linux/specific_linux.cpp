@@ -114,6 +114,30 @@ QString CurrentExecutablePath(int argc, char *argv[]) {
 	return argc ? QFile::decodeName(argv[0]) : QString();
 }
 
+bool SystemMemoryIsLow() {
+	// Less than a tenth of the memory is available without swapping.
+	constexpr auto kLowAvailableDivider = 10;
+
+	QFile file(qsl("/proc/meminfo"));
+	if (!file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+	const auto content = file.readAll();
+	const auto value = [&](const QByteArray &key) {
+		const auto start = content.indexOf(key);
+		if (start < 0) {
+			return int64(0);
+		}
+		const auto line = content.mid(start + key.size()).split('\n').front();
+		return line.trimmed().split(' ').front().toLongLong();
+	};
+	const auto total = value("MemTotal:");
+	const auto available = value("MemAvailable:");
+	return (total > 0)
+		&& (available > 0)
+		&& (available * kLowAvailableDivider < total);
+}
+
 } // namespace Platform
 
 namespace {
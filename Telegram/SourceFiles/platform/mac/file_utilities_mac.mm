@@ -12,6 +12,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include <Cocoa/Cocoa.h>
 #include <CoreFoundation/CFURL.h>
+#include <fcntl.h>
 
 namespace {
 
@@ -578,5 +579,17 @@ void UnsafeShowInFolder(const QString &filepath) {
 	}
 }
 
+void PreallocateFile(QFile &file, int64 size) {
+	auto store = fstore_t();
+	store.fst_flags = F_ALLOCATECONTIG;
+	store.fst_posmode = F_PEOFPOSMODE;
+	store.fst_offset = 0;
+	store.fst_length = size;
+	if (fcntl(file.handle(), F_PREALLOCATE, &store) == -1) {
+		store.fst_flags = F_ALLOCATEALL;
+		fcntl(file.handle(), F_PREALLOCATE, &store);
+	}
+}
+
 } // namespace File
 } // namespace Platform
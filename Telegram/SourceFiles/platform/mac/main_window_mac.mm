@@ -550,7 +550,9 @@ void MainWindow::updateTitleCounter() {
 
 void MainWindow::unreadCounterChangedHook() {
 	updateTitleCounter();
-	updateIconCounters();
+	if (iconCounterChanged()) {
+		updateIconCounters();
+	}
 }
 
 void MainWindow::updateIconCounters() {
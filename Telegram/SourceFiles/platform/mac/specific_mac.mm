@@ -20,6 +20,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <cstdlib>
 #include <execinfo.h>
 #include <sys/xattr.h>
+#include <sys/sysctl.h>
 
 #include <Cocoa/Cocoa.h>
 #include <CoreFoundation/CFURL.h>
@@ -287,6 +288,20 @@ std::optional<crl::time> LastUserInputTime() {
 	return (crl::now() - static_cast<crl::time>(idleTime));
 }
 
+bool SystemMemoryIsLow() {
+	// 1 - normal, 2 - warning, 4 - critical.
+	constexpr auto kPressureWarning = 2;
+
+	auto level = int32(0);
+	auto size = sizeof(level);
+	return !sysctlbyname(
+		"kern.memorystatus_vm_pressure_level",
+		&level,
+		&size,
+		nullptr,
+		0) && (level >= kPressureWarning);
+}
+
 } // namespace Platform
 
 void psNewVersion() {
@@ -23,6 +23,9 @@ void UnsafeShowInFolder(const QString &filepath);
 
 void PostprocessDownloaded(const QString &filepath);
 
+// Reserves the disk space for a file without changing its size.
+void PreallocateFile(QFile &file, int64 size);
+
 } // namespace File
 
 namespace FileDialog {
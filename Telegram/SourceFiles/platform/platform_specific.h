@@ -45,6 +45,9 @@ bool OpenSystemSettings(SystemSettingsType type);
 	return LastUserInputTime().has_value();
 }
 
+// The system is about to start swapping or even killing processes.
+[[nodiscard]] bool SystemMemoryIsLow();
+
 namespace ThirdParty {
 
 void start();
@@ -16,6 +16,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include <Shlwapi.h>
 #include <Windowsx.h>
+#include <io.h>
 
 HBITMAP qt_pixmapToWinHBITMAP(const QPixmap &, int hbitmapFormat);
 
@@ -285,6 +286,25 @@ void PostprocessDownloaded(const QString &filepath) {
 	}
 }
 
+void PreallocateFile(QFile &file, int64 size) {
+	// SetFileValidData() would require SE_MANAGE_VOLUME_NAME privilege,
+	// so only the allocation size is set, the file size stays the same.
+	if (!Dlls::SetFileInformationByHandle) {
+		return;
+	}
+	const auto handle = HANDLE(_get_osfhandle(file.handle()));
+	if (handle == INVALID_HANDLE_VALUE) {
+		return;
+	}
+	auto info = FILE_ALLOCATION_INFO();
+	info.AllocationSize.QuadPart = size;
+	Dlls::SetFileInformationByHandle(
+		handle,
+		FileAllocationInfo,
+		&info,
+		sizeof(info));
+}
+
 } // namespace File
 
 namespace FileDialog {
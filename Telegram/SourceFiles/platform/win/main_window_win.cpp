@@ -721,7 +721,9 @@ void MainWindow::workmodeUpdated(DBIWorkMode mode) {
 
 void MainWindow::unreadCounterChangedHook() {
 	setWindowTitle(titleText());
-	updateIconCounters();
+	if (iconCounterChanged()) {
+		updateIconCounters();
+	}
 }
 
 void MainWindow::updateIconCounters() {
@@ -323,6 +323,15 @@ std::optional<crl::time> LastUserInputTime() {
 		: std::nullopt;
 }
 
+bool SystemMemoryIsLow() {
+	constexpr auto kLowMemoryLoad = 90;
+
+	auto status = MEMORYSTATUSEX{ 0 };
+	status.dwLength = sizeof(MEMORYSTATUSEX);
+	return GlobalMemoryStatusEx(&status)
+		&& (status.dwMemoryLoad >= kLowMemoryLoad);
+}
+
 } // namespace Platform
 
 namespace {
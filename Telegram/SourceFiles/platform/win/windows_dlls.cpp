@@ -14,6 +14,7 @@ namespace Platform {
 namespace Dlls {
 
 f_SetDllDirectory SetDllDirectory;
+f_SetFileInformationByHandle SetFileInformationByHandle;
 
 HINSTANCE LibKernel32;
 
@@ -28,6 +29,7 @@ void init() {
 		// Remove the current directory from the DLL search order.
 		SetDllDirectory(L"");
 	}
+	load(LibKernel32, "SetFileInformationByHandle", SetFileInformationByHandle);
 }
 
 f_SetWindowTheme SetWindowTheme;
@@ -24,6 +24,13 @@ void init();
 using f_SetDllDirectory = BOOL(FAR STDAPICALLTYPE*)(LPCWSTR lpPathName);
 extern f_SetDllDirectory SetDllDirectory;
 
+using f_SetFileInformationByHandle = BOOL(FAR STDAPICALLTYPE*)(
+	HANDLE hFile,
+	FILE_INFO_BY_HANDLE_CLASS FileInformationClass,
+	LPVOID lpFileInformation,
+	DWORD dwBufferSize);
+extern f_SetFileInformationByHandle SetFileInformationByHandle;
+
 void start();
 
 template <typename Function>
@@ -128,6 +128,18 @@ inline void event_stream<Value, Error>::fire_forward(
 	}
 
 	++copy->depth;
+	if (consumers.size() == 1) {
+		// Most of the streams have a single consumer.
+		// It gets the value as is, without any list bookkeeping.
+		const auto alive = consumers.front().put_next_forward(
+			std::forward<OtherValue>(value));
+		if (!alive && copy->depth == 1) {
+			// New consumers could be added while handling the value.
+			consumers.erase(consumers.begin());
+		}
+		--copy->depth;
+		return;
+	}
 	const auto begin = base::index_based_begin(consumers);
 	const auto end = base::index_based_end(consumers);
 
@@ -0,0 +1,148 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include <rpl/rpl.h>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+using namespace rpl;
+
+namespace {
+
+constexpr auto kEventsCount = 10'000'000;
+constexpr auto kSubscriptionsCount = 1'000'000;
+
+using Clock = std::chrono::steady_clock;
+using Nanoseconds = std::chrono::nanoseconds;
+
+void Report(const std::string &title, int count, Clock::duration duration) {
+	const auto nanoseconds = std::chrono::duration_cast<Nanoseconds>(
+		duration).count();
+	std::cout
+		<< std::setw(36) << std::left << title
+		<< std::setw(10) << std::right << std::fixed << std::setprecision(2)
+		<< (double(nanoseconds) / count) << " ns/op"
+		<< std::endl;
+}
+
+template <typename Method>
+void Measure(const std::string &title, int count, Method &&method) {
+	const auto start = Clock::now();
+	method();
+	Report(title, count, Clock::now() - start);
+}
+
+void BenchmarkFire(int consumers) {
+	auto sum = 0LL;
+	auto lifetime = rpl::lifetime();
+	auto stream = event_stream<int>();
+	for (auto i = 0; i != consumers; ++i) {
+		stream.events(
+		) | rpl::start_with_next([&](int value) {
+			sum += value;
+		}, lifetime);
+	}
+	Measure(
+		"fire, " + std::to_string(consumers) + " consumers",
+		kEventsCount,
+		[&] {
+			for (auto i = 0; i != kEventsCount; ++i) {
+				stream.fire_copy(i);
+			}
+		});
+	REQUIRE(sum == consumers * (kEventsCount - 1LL) * kEventsCount / 2);
+}
+
+} // namespace
+
+TEST_CASE("event_stream fire benchmark", "[benchmark]") {
+	BenchmarkFire(1);
+	BenchmarkFire(2);
+	BenchmarkFire(8);
+}
+
+TEST_CASE("producer chain benchmark", "[benchmark]") {
+	auto sum = 0LL;
+	auto stream = event_stream<int>();
+	auto lifetime = rpl::lifetime();
+
+	SECTION("not type erased chain") {
+		stream.events(
+		) | rpl::filter([](int value) {
+			return (value % 2) == 0;
+		}) | rpl::map([](int value) {
+			return value / 2;
+		}) | rpl::start_with_next([&](int value) {
+			sum += value;
+		}, lifetime);
+		Measure("fire, filter | map", kEventsCount, [&] {
+			for (auto i = 0; i != kEventsCount; ++i) {
+				stream.fire_copy(i);
+			}
+		});
+	}
+
+	SECTION("type erased chain") {
+		auto erased = rpl::producer<int>(stream.events(
+		) | rpl::filter([](int value) {
+			return (value % 2) == 0;
+		}) | rpl::map([](int value) {
+			return value / 2;
+		}));
+		std::move(
+			erased
+		) | rpl::start_with_next([&](int value) {
+			sum += value;
+		}, lifetime);
+		Measure("fire, erased filter | map", kEventsCount, [&] {
+			for (auto i = 0; i != kEventsCount; ++i) {
+				stream.fire_copy(i);
+			}
+		});
+	}
+
+	SECTION("combine") {
+		auto other = event_stream<int>();
+		rpl::combine(
+			stream.events(),
+			other.events_starting_with(0)
+		) | rpl::start_with_next([&](int a, int b) {
+			sum += a + b;
+		}, lifetime);
+		Measure("fire, combine", kEventsCount, [&] {
+			for (auto i = 0; i != kEventsCount; ++i) {
+				stream.fire_copy(i);
+			}
+		});
+	}
+	REQUIRE(sum > 0);
+}
+
+TEST_CASE("event_stream subscription benchmark", "[benchmark]") {
+	auto stream = event_stream<int>();
+	auto lifetime = rpl::lifetime();
+	stream.events(
+	) | rpl::start_with_next([](int) {}, lifetime);
+
+	Measure(
+		"subscribe and unsubscribe",
+		kSubscriptionsCount,
+		[&] {
+			for (auto i = 0; i != kSubscriptionsCount; ++i) {
+				auto subscription = rpl::lifetime();
+				stream.events(
+				) | rpl::start_with_next([](int) {}, subscription);
+				stream.fire(0);
+			}
+		});
+	REQUIRE(stream.has_consumers());
+}
@@ -19,6 +19,7 @@ bool gTestMode = false;
 bool gManyInstance = false;
 QString gKeyFile;
 QString gWorkingDir, gExeDir, gExeName;
+QString gSharedCacheDir;
 
 QStringList gSendPaths;
 QString gStartUrl;
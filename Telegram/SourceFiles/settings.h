@@ -57,6 +57,7 @@ inline void cForceWorkingDir(const QString &newDir) {
 	}
 
 }
+DeclareSetting(QString, SharedCacheDir);
 DeclareReadSetting(QString, ExeName);
 DeclareReadSetting(QString, ExeDir);
 DeclareSetting(QString, DialogLastPath);
@@ -18,11 +18,16 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/application.h"
 #include "mtproto/mtp_instance.h"
 #include "mtproto/dc_options.h"
+#include "mtproto/mtp_latency.h"
 #include "core/file_utilities.h"
 #include "core/update_checker.h"
 #include "window/themes/window_theme.h"
 #include "window/themes/window_theme_editor.h"
 #include "media/audio/media_audio_track.h"
+#include "history/view/history_view_benchmark.h"
+#include "data/data_peer.h"
+#include "base/trace.h"
+#include "base/memory_usage.h"
 
 namespace Settings {
 
@@ -65,6 +70,53 @@ auto GenerateCodes() {
 		}
 		Ui::show(Box<InformBox>(DebugLogging::FileLoader() ? qsl("Enabled file download logging") : qsl("Disabled file download logging")));
 	});
+	codes.emplace(qsl("mtplatency"), [] {
+		if (!Logs::DebugEnabled()) {
+			return;
+		}
+		Ui::show(Box<InformBox>(MTP::LatencyReport(8)));
+	});
+	codes.emplace(qsl("tracestart"), [] {
+		if (base::trace::Enabled()) {
+			base::trace::Stop();
+			Ui::Toast::Show("Tracing stopped.");
+		} else {
+			base::trace::Start();
+			Ui::Toast::Show("Tracing started.");
+		}
+	});
+	codes.emplace(qsl("tracedump"), [] {
+		const auto path = cWorkingDir() + qsl("trace.json");
+		auto file = QFile(path);
+		if (!file.open(QIODevice::WriteOnly)) {
+			Ui::Toast::Show("Could not write the trace.");
+			return;
+		}
+		file.write(base::trace::Dump());
+		file.close();
+		File::ShowInFolder(path);
+	});
+	codes.emplace(qsl("renderbench"), [] {
+		if (!AuthSession::Exists()) {
+			return;
+		}
+		const auto history = Auth().data().history(
+			PeerData::kServiceNotificationsId);
+		const auto report = HistoryView::RenderBenchmark(history);
+		LOG(("Render benchmark:\n%1").arg(report));
+		Ui::show(Box<InformBox>(report));
+	});
+	codes.emplace(qsl("memoryreport"), [] {
+		const auto report = base::memory::Report();
+		LOG(("Memory report:\n%1").arg(report));
+		Ui::show(Box<InformBox>(report));
+	});
+	codes.emplace(qsl("memorytrim"), [] {
+		base::memory::TrimAll();
+		const auto report = base::memory::Report();
+		LOG(("Memory report after trim:\n%1").arg(report));
+		Ui::show(Box<InformBox>(report));
+	});
 	codes.emplace(qsl("crashplease"), [] {
 		Unexpected("Crashed in Settings!");
 	});
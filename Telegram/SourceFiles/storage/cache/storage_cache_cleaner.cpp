@@ -7,8 +7,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "storage/cache/storage_cache_cleaner.h"
 
+#include "base/concurrent_timer.h"
 #include <crl/crl.h>
 #include <QtCore/QDir>
+#include <QtCore/QDirIterator>
 #include <QtCore/QFile>
 #include <unordered_map>
 #include <set>
@@ -22,19 +24,29 @@ public:
 	CleanerObject(
 		crl::weak_on_queue<CleanerObject> weak,
 		const QString &base,
+		const Settings &settings,
 		base::binary_guard &&guard,
+		Fn<void(int64, int64)> progress,
 		FnMut<void(Error)> done);
 
 private:
 	void start();
+	void countTotalSize();
 	void scheduleNext();
 	void cleanNext();
+	bool cleanNextFile(int64 &removedSize);
 	void done();
 
 	crl::weak_on_queue<CleanerObject> _weak;
 	QString _base, _errorPath;
+	Settings _settings;
 	std::vector<QString> _queue;
+	std::unique_ptr<QDirIterator> _files;
+	int64 _totalSize = 0;
+	int64 _removedSize = 0;
+	base::ConcurrentTimer _cleanNextTimer;
 	base::binary_guard _guard;
+	Fn<void(int64, int64)> _progress;
 	FnMut<void(Error)> _done;
 
 };
@@ -42,11 +54,16 @@ private:
 CleanerObject::CleanerObject(
 	crl::weak_on_queue<CleanerObject> weak,
 	const QString &base,
+	const Settings &settings,
 	base::binary_guard &&guard,
+	Fn<void(int64, int64)> progress,
 	FnMut<void(Error)> done)
 : _weak(std::move(weak))
 , _base(base)
+, _settings(settings)
+, _cleanNextTimer(_weak, [=] { cleanNext(); })
 , _guard(std::move(guard))
+, _progress(std::move(progress))
 , _done(std::move(done)) {
 	start();
 }
@@ -61,6 +78,7 @@ void CleanerObject::start() {
 		_queue.erase(
 			ranges::remove(_queue, QString::number(*version)),
 			end(_queue));
+		countTotalSize();
 		scheduleNext();
 	} else {
 		_errorPath = VersionFilePath(_base);
@@ -68,11 +86,34 @@ void CleanerObject::start() {
 	}
 }
 
+void CleanerObject::countTotalSize() {
+	for (const auto &entry : _queue) {
+		auto files = QDirIterator(
+			_base + entry,
+			QDir::Files | QDir::Hidden | QDir::System,
+			QDirIterator::Subdirectories);
+		while (files.hasNext()) {
+			files.next();
+			_totalSize += files.fileInfo().size();
+		}
+	}
+	if (_totalSize > 0 && _progress) {
+		_progress(_removedSize, _totalSize);
+	}
+}
+
 void CleanerObject::scheduleNext() {
 	if (_queue.empty()) {
 		done();
 		return;
 	}
+
+	// Spread the removal in time, so that the new generation reads and
+	// writes are not stuck behind a long burst of file deletions.
+	if (_removedSize > 0 && _settings.cleanChunkDelay > 0) {
+		_cleanNextTimer.callOnce(_settings.cleanChunkDelay);
+		return;
+	}
 	_weak.with([](CleanerObject &that) {
 		if (that._guard) {
 			that.cleanNext();
@@ -81,14 +122,53 @@ void CleanerObject::scheduleNext() {
 }
 
 void CleanerObject::cleanNext() {
-	const auto path = _base + _queue.back();
-	_queue.pop_back();
-	if (!QDir(path).removeRecursively()) {
-		_errorPath = path;
+	if (!_guard) {
+		return;
+	}
+	auto removedSize = int64(0);
+	for (auto i = 0; i != _settings.cleanChunkFiles; ++i) {
+		if (!cleanNextFile(removedSize)
+			|| removedSize >= _settings.cleanChunkSize) {
+			break;
+		}
+	}
+	_removedSize += removedSize;
+	if (removedSize > 0 && _progress) {
+		_progress(_removedSize, std::max(_totalSize, _removedSize));
 	}
 	scheduleNext();
 }
 
+bool CleanerObject::cleanNextFile(int64 &removedSize) {
+	if (_queue.empty()) {
+		return false;
+	}
+	const auto path = _base + _queue.back();
+	if (!_files) {
+		_files = std::make_unique<QDirIterator>(
+			path,
+			QDir::Files | QDir::Hidden | QDir::System,
+			QDirIterator::Subdirectories);
+	}
+	if (!_files->hasNext()) {
+		// Only the empty directories are left.
+		_files = nullptr;
+		_queue.pop_back();
+		if (!QDir(path).removeRecursively()) {
+			_errorPath = path;
+		}
+		return true;
+	}
+	const auto file = _files->next();
+	const auto size = _files->fileInfo().size();
+	if (QFile::remove(file)) {
+		removedSize += size;
+	} else {
+		_errorPath = file;
+	}
+	return true;
+}
+
 void CleanerObject::done() {
 	if (_done) {
 		_done(_errorPath.isEmpty()
@@ -99,9 +179,16 @@ void CleanerObject::done() {
 
 Cleaner::Cleaner(
 	const QString &base,
+	const Settings &settings,
 	base::binary_guard &&guard,
+	Fn<void(int64, int64)> progress,
 	FnMut<void(Error)> done)
-: _wrapped(base, std::move(guard), std::move(done)) {
+: _wrapped(
+	base,
+	settings,
+	std::move(guard),
+	std::move(progress),
+	std::move(done)) {
 }
 
 Cleaner::~Cleaner() = default;
@@ -18,9 +18,12 @@ class CleanerObject;
 
 class Cleaner {
 public:
+	// The progress callback gets the removed and the total size in bytes.
 	Cleaner(
 		const QString &base,
+		const Settings &settings,
 		base::binary_guard &&guard,
+		Fn<void(int64, int64)> progress,
 		FnMut<void(Error)> done);
 
 	~Cleaner();
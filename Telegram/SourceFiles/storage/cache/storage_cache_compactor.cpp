@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "storage/cache/storage_cache_database_object.h"
 #include "storage/cache/storage_cache_binlog_reader.h"
+#include "base/concurrent_timer.h"
 #include <unordered_set>
 
 namespace Storage {
@@ -41,6 +42,7 @@ private:
 	bool readHeader();
 	bool openCompact();
 	void parseChunk();
+	void parseChunkDelayed();
 	void fail();
 	void done(int64 till);
 	void finish();
@@ -79,6 +81,7 @@ private:
 	base::variant<
 		std::vector<MultiStore::Part>,
 		std::vector<MultiStoreWithTime::Part>> _list;
+	base::ConcurrentTimer _parseChunkTimer;
 
 };
 
@@ -98,7 +101,8 @@ CompactorObject::CompactorObject(
 , _key(std::move(key))
 , _info(info)
 , _wrapper(_binlog, _settings, _info.till)
-, _partSize(_settings.maxBundledRecords) { // Perhaps a better estimate?
+, _partSize(_settings.maxBundledRecords) // Perhaps a better estimate?
+, _parseChunkTimer(_weak, [=] { parseChunk(); }) {
 	Expects(_settings.compactChunkSize > 0);
 
 	_written.reserve(_info.keysCount);
@@ -158,7 +162,9 @@ bool CompactorObject::openCompact() {
 	const auto result = _compact.open(path, File::Mode::Write, _key);
 	if (result != File::Result::Success) {
 		return false;
-	} else if (!_compact.write(bytes::object_as_span(&_header))) {
+	}
+	_header.keysCountHint = uint32(_info.keysCount);
+	if (!_compact.write(bytes::object_as_span(&_header))) {
 		return false;
 	}
 	return true;
@@ -328,7 +334,17 @@ void CompactorObject::processValues(
 			return;
 		}
 	}
-	parseChunk();
+	parseChunkDelayed();
+}
+
+void CompactorObject::parseChunkDelayed() {
+	// Spread the binlog rewrite in time so that it doesn't
+	// saturate slow disks with one long burst of reads and writes.
+	if (_settings.compactChunkDelay > 0) {
+		_parseChunkTimer.callOnce(_settings.compactChunkDelay);
+	} else {
+		parseChunk();
+	}
 }
 
 auto CompactorObject::fillList(RawSpan values) -> RawSpan {
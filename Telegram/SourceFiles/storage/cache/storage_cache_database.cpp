@@ -8,48 +8,252 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/cache/storage_cache_database.h"
 
 #include "storage/cache/storage_cache_database_object.h"
+#include "storage/cache/storage_cache_membership_filter.h"
+#include "storage/storage_encryption.h"
+#include "base/algorithm.h"
+#include "base/flat_map.h"
+#include <rpl/combine.h>
+#include <QtCore/QDir>
+#include <atomic>
 
 namespace Storage {
 namespace Cache {
+namespace {
 
-Database::Database(const QString &path, const Settings &settings)
-: _wrapped(path, settings) {
+// Consecutive keys, like streaming slices of one file, go to one shard.
+constexpr auto kShardSliceShift = 10;
+
+QString ShardPath(const QString &path, int index) {
+	return index
+		? (QDir(path).absolutePath() + '_' + QString::number(index))
+		: path;
+}
+
+int64 ShardSizeLimit(int64 limit, int count) {
+	// Each shard should still be able to hold the largest value.
+	const auto minimal = int64(details::kDataSizeLimit);
+	return limit ? std::max(limit / count, minimal) : limit;
+}
+
+Database::Settings ShardSettings(Database::Settings settings) {
+	const auto count = settings.shardsCount;
+	settings.totalSizeLimit = ShardSizeLimit(settings.totalSizeLimit, count);
+	settings.compactAfterFullSize /= count;
+	return settings;
+}
+
+// Collects results from several shards and calls done from the last one.
+template <typename Result>
+class Gather {
+public:
+	Gather(int count, FnMut<void(std::vector<Result>&&)> &&done)
+	: _results(count)
+	, _left(count)
+	, _done(std::move(done)) {
+	}
+
+	void set(int index, Result &&result) {
+		_results[index] = std::move(result);
+		if (_left.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			_done(std::move(_results));
+		}
+	}
+
+private:
+	std::vector<Result> _results;
+	std::atomic<int> _left = 0;
+	FnMut<void(std::vector<Result>&&)> _done;
+
+};
+
+template <typename Result>
+auto MakeGather(int count, FnMut<void(std::vector<Result>&&)> &&done) {
+	return std::make_shared<Gather<Result>>(count, std::move(done));
+}
+
+FnMut<void(std::vector<Error>&&)> IgnoreErrors(FnMut<void()> &&done) {
+	return [done = std::move(done)](std::vector<Error> &&errors) mutable {
+		done();
+	};
+}
+
+FnMut<void(std::vector<Error>&&)> FirstError(FnMut<void(Error)> &&done) {
+	return [done = std::move(done)](std::vector<Error> &&errors) mutable {
+		const auto i = ranges::find_if(errors, [](const Error &error) {
+			return (error.type != Error::Type::None);
+		});
+		done((i != end(errors)) ? *i : Error::NoError());
+	};
+}
+
+FnMut<void(Error)> ShardCallback(
+		const std::shared_ptr<Gather<Error>> &gather,
+		int index) {
+	if (!gather) {
+		return nullptr;
+	}
+	return [=](Error error) {
+		gather->set(index, std::move(error));
+	};
+}
+
+FnMut<void()> ShardDoneCallback(
+		const std::shared_ptr<Gather<Error>> &gather,
+		int index) {
+	if (!gather) {
+		return nullptr;
+	}
+	return [=] {
+		gather->set(index, Error::NoError());
+	};
+}
+
+Database::Stats MergeStats(const std::vector<Database::Stats> &list) {
+	auto result = Database::Stats();
+	for (const auto &stats : list) {
+		result.full.count += stats.full.count;
+		result.full.totalSize += stats.full.totalSize;
+		for (const auto &[tag, summary] : stats.tagged) {
+			auto &merged = result.tagged[tag];
+			merged.count += summary.count;
+			merged.totalSize += summary.totalSize;
+		}
+		result.clearing = result.clearing || stats.clearing;
+	}
+	return result;
+}
+
+} // namespace
+
+struct Database::Shard {
+	Shard(const QString &path, const Settings &settings);
+
+	// Answers obvious misses without a hop to the database queue.
+	const std::shared_ptr<details::MembershipFilter> filter;
+	crl::object_on_queue<Implementation> wrapped;
+};
+
+Database::Shard::Shard(const QString &path, const Settings &settings)
+: filter(std::make_shared<details::MembershipFilter>())
+, wrapped(path, settings, filter) {
+}
+
+Database::Database(const QString &path, const Settings &settings) {
+	Expects(settings.shardsCount > 0);
+
+	_shards.reserve(settings.shardsCount);
+	for (auto i = 0; i != settings.shardsCount; ++i) {
+		_shards.push_back(std::make_shared<Shard>(
+			ShardPath(path, i),
+			ShardSettings(settings)));
+	}
+}
+
+int Database::shardIndex(const Key &key) const {
+	if (_shards.size() == 1) {
+		return 0;
+	}
+	const auto mixed = (key.high ^ (key.low >> kShardSliceShift))
+		* 0x9E3779B97F4A7C15ULL;
+	return int((mixed >> 32) % uint64(_shards.size()));
+}
+
+auto Database::shard(const Key &key) const -> Shard & {
+	return *_shards[shardIndex(key)];
+}
+
+template <typename Method>
+void Database::withKeysChange(Shard &shard, Method &&method) {
+	// While any request that may add keys is in flight
+	// the filter can't be used for synchronous answers.
+	shard.filter->requestStarted();
+	shard.wrapped.with([
+		method = std::forward<Method>(method),
+		filter = shard.filter
+	](Implementation &unwrapped) mutable {
+		method(unwrapped);
+		filter->requestFinished();
+	});
+}
+
+template <typename Method>
+void Database::withKeysChange(const Key &key, Method &&method) {
+	withKeysChange(shard(key), std::forward<Method>(method));
+}
+
+template <typename Method>
+void Database::withEachShard(Method &&method) {
+	for (auto i = 0, count = int(_shards.size()); i != count; ++i) {
+		method(*_shards[i], i);
+	}
 }
 
 void Database::reconfigure(const Settings &settings) {
-	_wrapped.with([settings](Implementation &unwrapped) mutable {
-		unwrapped.reconfigure(settings);
+	Expects(settings.shardsCount == int(_shards.size()));
+
+	withEachShard([&](Shard &shard, int index) {
+		shard.wrapped.with([
+			settings = ShardSettings(settings)
+		](Implementation &unwrapped) mutable {
+			unwrapped.reconfigure(settings);
+		});
 	});
 }
 
 void Database::updateSettings(const SettingsUpdate &update) {
-	_wrapped.with([update](Implementation &unwrapped) mutable {
-		unwrapped.updateSettings(update);
+	auto shardUpdate = update;
+	shardUpdate.totalSizeLimit = ShardSizeLimit(
+		update.totalSizeLimit,
+		int(_shards.size()));
+	withEachShard([&](Shard &shard, int index) {
+		shard.wrapped.with([
+			update = shardUpdate
+		](Implementation &unwrapped) mutable {
+			unwrapped.updateSettings(update);
+		});
 	});
 }
 
 void Database::open(EncryptionKey &&key, FnMut<void(Error)> &&done) {
-	_wrapped.with([
-		key = std::move(key),
-		done = std::move(done)
-	](Implementation &unwrapped) mutable {
-		unwrapped.open(std::move(key), std::move(done));
+	const auto gather = done
+		? MakeGather<Error>(int(_shards.size()), FirstError(std::move(done)))
+		: nullptr;
+	withEachShard([&](Shard &shard, int index) {
+		auto opened = ShardCallback(gather, index);
+		withKeysChange(shard, [
+			key = base::duplicate(key),
+			done = std::move(opened)
+		](Implementation &unwrapped) mutable {
+			unwrapped.open(std::move(key), std::move(done));
+		});
 	});
 }
 
 void Database::close(FnMut<void()> &&done) {
-	_wrapped.with([
-		done = std::move(done)
-	](Implementation &unwrapped) mutable {
-		unwrapped.close(std::move(done));
+	const auto gather = done
+		? MakeGather<Error>(int(_shards.size()), IgnoreErrors(std::move(done)))
+		: nullptr;
+	withEachShard([&](Shard &shard, int index) {
+		auto closed = ShardDoneCallback(gather, index);
+		shard.wrapped.with([
+			done = std::move(closed)
+		](Implementation &unwrapped) mutable {
+			unwrapped.close(std::move(done));
+		});
 	});
 }
 
 void Database::waitForCleaner(FnMut<void()> &&done) {
-	_wrapped.with([
-		done = std::move(done)
-	](Implementation &unwrapped) mutable {
-		unwrapped.waitForCleaner(std::move(done));
+	const auto gather = done
+		? MakeGather<Error>(int(_shards.size()), IgnoreErrors(std::move(done)))
+		: nullptr;
+	withEachShard([&](Shard &shard, int index) {
+		auto cleaned = ShardDoneCallback(gather, index);
+		shard.wrapped.with([
+			done = std::move(cleaned)
+		](Implementation &unwrapped) mutable {
+			unwrapped.waitForCleaner(std::move(done));
+		});
 	});
 }
 
@@ -72,7 +276,7 @@ void Database::get(const Key &key, FnMut<void(QByteArray&&)> &&done) {
 }
 
 void Database::remove(const Key &key, FnMut<void(Error)> &&done) {
-	_wrapped.with([
+	shard(key).wrapped.with([
 		key,
 		done = std::move(done)
 	](Implementation &unwrapped) mutable {
@@ -94,7 +298,11 @@ void Database::copyIfEmpty(
 		const Key &from,
 		const Key &to,
 		FnMut<void(Error)> &&done) {
-	_wrapped.with([
+	if (shardIndex(from) != shardIndex(to)) {
+		copyBetweenShards(from, to, false, std::move(done));
+		return;
+	}
+	withKeysChange(to, [
 		from,
 		to,
 		done = std::move(done)
@@ -107,7 +315,11 @@ void Database::moveIfEmpty(
 		const Key &from,
 		const Key &to,
 		FnMut<void(Error)> &&done) {
-	_wrapped.with([
+	if (shardIndex(from) != shardIndex(to)) {
+		copyBetweenShards(from, to, true, std::move(done));
+		return;
+	}
+	withKeysChange(to, [
 		from,
 		to,
 		done = std::move(done)
@@ -116,11 +328,66 @@ void Database::moveIfEmpty(
 	});
 }
 
+void Database::copyBetweenShards(
+		const Key &from,
+		const Key &to,
+		bool eraseFrom,
+		FnMut<void(Error)> &&done) {
+	// The value is read on one queue and written on the other one,
+	// the destination filter stays unusable until the write is done.
+	const auto filter = shard(to).filter;
+	filter->requestStarted();
+	shard(from).wrapped.with([
+		from,
+		to,
+		eraseFrom,
+		done = std::move(done),
+		source = std::weak_ptr<Shard>(_shards[shardIndex(from)]),
+		destination = std::weak_ptr<Shard>(_shards[shardIndex(to)]),
+		filter
+	](Implementation &unwrapped) mutable {
+		auto value = TaggedValue();
+		unwrapped.get(from, [&](TaggedValue &&result) {
+			value = std::move(result);
+		});
+		const auto strong = destination.lock();
+		if (value.bytes.isEmpty() || !strong) {
+			filter->requestFinished();
+			if (done) {
+				done(Error::NoError());
+			}
+			return;
+		}
+		auto written = [=, done = std::move(done)](Error error) mutable {
+			const auto origin = source.lock();
+			if (eraseFrom && origin && error.type == Error::Type::None) {
+				origin->wrapped.with([
+					from,
+					done = std::move(done)
+				](Implementation &unwrapped) mutable {
+					unwrapped.remove(from, std::move(done));
+				});
+			} else if (done) {
+				done(error);
+			}
+		};
+		strong->wrapped.with([
+			to,
+			value = std::move(value),
+			done = std::move(written),
+			filter
+		](Implementation &unwrapped) mutable {
+			unwrapped.putIfEmpty(to, std::move(value), std::move(done));
+			filter->requestFinished();
+		});
+	});
+}
+
 void Database::put(
 		const Key &key,
 		TaggedValue &&value,
 		FnMut<void(Error)> &&done) {
-	_wrapped.with([
+	withKeysChange(key, [
 		key,
 		value = std::move(value),
 		done = std::move(done)
@@ -133,7 +400,7 @@ void Database::putIfEmpty(
 		const Key &key,
 		TaggedValue &&value,
 		FnMut<void(Error)> &&done) {
-	_wrapped.with([
+	withKeysChange(key, [
 		key,
 		value = std::move(value),
 		done = std::move(done)
@@ -145,7 +412,12 @@ void Database::putIfEmpty(
 void Database::getWithTag(
 		const Key &key,
 		FnMut<void(TaggedValue&&)> &&done) {
-	_wrapped.with([
+	auto &shard = this->shard(key);
+	if (done && shard.filter->definitelyMissing(key)) {
+		done(TaggedValue());
+		return;
+	}
+	shard.wrapped.with([
 		key,
 		done = std::move(done)
 	](Implementation &unwrapped) mutable {
@@ -157,7 +429,20 @@ void Database::getWithSizes(
 		const Key &key,
 		std::vector<Key> &&keys,
 		FnMut<void(QByteArray&&, std::vector<int>&&)> &&done) {
-	_wrapped.with([
+	auto &shard = this->shard(key);
+	if (done && shard.filter->definitelyMissing(key)) {
+		done(QByteArray(), std::vector<int>());
+		return;
+	}
+	const auto index = shardIndex(key);
+	const auto other = [&](const Key &sizeKey) {
+		return (shardIndex(sizeKey) != index);
+	};
+	if (done && ranges::any_of(keys, other)) {
+		getSizesFromShards(key, std::move(keys), std::move(done));
+		return;
+	}
+	shard.wrapped.with([
 		key,
 		keys = std::move(keys),
 		done = std::move(done)
@@ -166,35 +451,198 @@ void Database::getWithSizes(
 	});
 }
 
-auto Database::statsOnMain() const -> rpl::producer<Stats> {
-	return _wrapped.producer_on_main([](const Implementation &unwrapped) {
-		return unwrapped.stats();
+void Database::getSizesFromShards(
+		const Key &key,
+		std::vector<Key> &&keys,
+		FnMut<void(QByteArray&&, std::vector<int>&&)> &&done) {
+	using Sizes = std::vector<std::pair<Key, int>>;
+	struct Part {
+		QByteArray value;
+		Sizes sizes;
+	};
+
+	const auto mainIndex = shardIndex(key);
+	auto keysByShard = std::vector<std::vector<Key>>(_shards.size());
+	for (const auto &sizeKey : keys) {
+		keysByShard[shardIndex(sizeKey)].push_back(sizeKey);
+	}
+	auto merge = [
+		mainIndex,
+		keys = std::move(keys),
+		done = std::move(done)
+	](std::vector<Part> &&parts) mutable {
+		auto &value = parts[mainIndex].value;
+		if (value.isEmpty()) {
+			done(QByteArray(), std::vector<int>());
+			return;
+		}
+		auto found = base::flat_map<Key, int>();
+		for (const auto &part : parts) {
+			for (const auto &[sizeKey, size] : part.sizes) {
+				found.emplace(sizeKey, size);
+			}
+		}
+		auto sizes = keys | ranges::view::transform([&](const Key &sizeKey) {
+			const auto i = found.find(sizeKey);
+			return (i != end(found)) ? i->second : 0;
+		}) | ranges::to_vector;
+		done(std::move(value), std::move(sizes));
+	};
+	const auto gather = MakeGather<Part>(int(_shards.size()), std::move(merge));
+	withEachShard([&](Shard &shard, int index) {
+		shard.wrapped.with([
+			key,
+			keys = std::move(keysByShard[index]),
+			main = (index == mainIndex),
+			gather,
+			index
+		](Implementation &unwrapped) mutable {
+			auto part = Part();
+			for (const auto &[sizeKey, entry] : unwrapped.getManyRaw(keys)) {
+				part.sizes.emplace_back(sizeKey, int(entry.size));
+			}
+			if (main) {
+				unwrapped.get(key, [&](TaggedValue &&value) {
+					part.value = std::move(value.bytes);
+				});
+			}
+			gather->set(index, std::move(part));
+		});
 	});
 }
 
-void Database::clear(FnMut<void(Error)> &&done) {
-	_wrapped.with([
+void Database::getMany(
+		std::vector<Key> &&keys,
+		FnMut<void(std::vector<QByteArray>&&)> &&done) {
+	if (done) {
+		auto untag = [done = std::move(done)](
+				std::vector<TaggedValue> &&values) mutable {
+			auto result = std::vector<QByteArray>();
+			result.reserve(values.size());
+			for (auto &value : values) {
+				result.push_back(std::move(value.bytes));
+			}
+			done(std::move(result));
+		};
+		getManyWithTags(std::move(keys), std::move(untag));
+	} else {
+		getManyWithTags(std::move(keys), nullptr);
+	}
+}
+
+void Database::getManyWithTags(
+		std::vector<Key> &&keys,
+		FnMut<void(std::vector<TaggedValue>&&)> &&done) {
+	const auto missing = [&](const Key &key) {
+		return shard(key).filter->definitelyMissing(key);
+	};
+	if (!done) {
+		return;
+	} else if (ranges::all_of(keys, missing)) {
+		done(std::vector<TaggedValue>(keys.size()));
+		return;
+	} else if (_shards.size() == 1) {
+		_shards.front()->wrapped.with([
+			keys = std::move(keys),
+			done = std::move(done)
+		](Implementation &unwrapped) mutable {
+			unwrapped.getMany(keys, std::move(done));
+		});
+		return;
+	}
+	struct Part {
+		std::vector<Key> keys;
+		std::vector<size_type> indices;
+		std::vector<TaggedValue> values;
+	};
+	auto parts = std::vector<Part>(_shards.size());
+	for (auto i = size_type(0); i != keys.size(); ++i) {
+		auto &part = parts[shardIndex(keys[i])];
+		part.keys.push_back(keys[i]);
+		part.indices.push_back(i);
+	}
+	auto merge = [
+		count = keys.size(),
 		done = std::move(done)
-	](Implementation &unwrapped) mutable {
-		unwrapped.clear(std::move(done));
+	](std::vector<Part> &&parts) mutable {
+		auto result = std::vector<TaggedValue>(count);
+		for (auto &part : parts) {
+			for (auto i = size_type(0); i != part.indices.size(); ++i) {
+				result[part.indices[i]] = std::move(part.values[i]);
+			}
+		}
+		done(std::move(result));
+	};
+	const auto gather = MakeGather<Part>(int(_shards.size()), std::move(merge));
+	withEachShard([&](Shard &shard, int index) {
+		shard.wrapped.with([
+			part = std::move(parts[index]),
+			gather,
+			index
+		](Implementation &unwrapped) mutable {
+			unwrapped.getMany(part.keys, [&](
+					std::vector<TaggedValue> &&values) {
+				part.values = std::move(values);
+			});
+			gather->set(index, std::move(part));
+		});
+	});
+}
+
+auto Database::statsOnMain() const -> rpl::producer<Stats> {
+	auto list = std::vector<rpl::producer<Stats>>();
+	list.reserve(_shards.size());
+	for (const auto &shard : _shards) {
+		list.push_back(shard->wrapped.producer_on_main([](
+				const Implementation &unwrapped) {
+			return unwrapped.stats();
+		}));
+	}
+	if (list.size() == 1) {
+		return std::move(list.front());
+	}
+	return rpl::combine(std::move(list), MergeStats);
+}
+
+void Database::clear(FnMut<void(Error)> &&done) {
+	const auto gather = done
+		? MakeGather<Error>(int(_shards.size()), FirstError(std::move(done)))
+		: nullptr;
+	withEachShard([&](Shard &shard, int index) {
+		auto cleared = ShardCallback(gather, index);
+		withKeysChange(shard, [
+			done = std::move(cleared)
+		](Implementation &unwrapped) mutable {
+			unwrapped.clear(std::move(done));
+		});
 	});
 }
 
 void Database::clearByTag(uint8 tag, FnMut<void(Error)> &&done) {
-	_wrapped.with([
-		tag,
-		done = std::move(done)
-	](Implementation &unwrapped) mutable {
-		unwrapped.clearByTag(tag, std::move(done));
+	const auto gather = done
+		? MakeGather<Error>(int(_shards.size()), FirstError(std::move(done)))
+		: nullptr;
+	withEachShard([&](Shard &shard, int index) {
+		auto cleared = ShardCallback(gather, index);
+		shard.wrapped.with([
+			tag,
+			done = std::move(cleared)
+		](Implementation &unwrapped) mutable {
+			unwrapped.clearByTag(tag, std::move(done));
+		});
 	});
 }
 
 void Database::sync() {
 	auto semaphore = crl::semaphore();
-	_wrapped.with([&](Implementation &) {
-		semaphore.release();
+	withEachShard([&](Shard &shard, int index) {
+		shard.wrapped.with([&](Implementation &) {
+			semaphore.release();
+		});
 	});
-	semaphore.acquire();
+	for (auto i = 0, count = int(_shards.size()); i != count; ++i) {
+		semaphore.acquire();
+	}
 }
 
 Database::~Database() = default;
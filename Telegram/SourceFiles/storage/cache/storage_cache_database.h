@@ -19,6 +19,7 @@ class EncryptionKey;
 namespace Cache {
 namespace details {
 class DatabaseObject;
+class MembershipFilter;
 } // namespace details
 
 class Database {
@@ -69,6 +70,14 @@ public:
 		std::vector<Key> &&keys,
 		FnMut<void(QByteArray&&, std::vector<int>&&)> &&done);
 
+	// Values are returned in the order of keys, empty for missing ones.
+	void getMany(
+		std::vector<Key> &&keys,
+		FnMut<void(std::vector<QByteArray>&&)> &&done);
+	void getManyWithTags(
+		std::vector<Key> &&keys,
+		FnMut<void(std::vector<TaggedValue>&&)> &&done);
+
 	using Stats = details::Stats;
 	using TaggedSummary = details::TaggedSummary;
 	rpl::producer<Stats> statsOnMain() const;
@@ -83,7 +92,30 @@ public:
 
 private:
 	using Implementation = details::DatabaseObject;
-	crl::object_on_queue<Implementation> _wrapped;
+	struct Shard;
+
+	[[nodiscard]] int shardIndex(const Key &key) const;
+	[[nodiscard]] Shard &shard(const Key &key) const;
+
+	template <typename Method>
+	void withKeysChange(Shard &shard, Method &&method);
+	template <typename Method>
+	void withKeysChange(const Key &key, Method &&method);
+	template <typename Method>
+	void withEachShard(Method &&method);
+
+	void copyBetweenShards(
+		const Key &from,
+		const Key &to,
+		bool eraseFrom,
+		FnMut<void(Error)> &&done);
+	void getSizesFromShards(
+		const Key &key,
+		std::vector<Key> &&keys,
+		FnMut<void(QByteArray&&, std::vector<int>&&)> &&done);
+
+	// Keys are spread between shards, each with its own queue and binlog.
+	std::vector<std::shared_ptr<Shard>> _shards;
 
 };
 
@@ -0,0 +1,299 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "storage/cache/storage_cache_database.h"
+#include "storage/storage_encryption.h"
+#include "base/concurrent_timer.h"
+#include <crl/crl.h>
+#include <QtCore/QFile>
+#include <QtCore/QCoreApplication>
+
+#ifdef Q_OS_WIN
+#include "platform/win/windows_dlls.h"
+#endif // Q_OS_WIN
+
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <iostream>
+#include <iomanip>
+#include <limits>
+
+using namespace Storage::Cache;
+
+namespace {
+
+// Cache sizes above 1 GB take a lot of disk space and time.
+const auto EnableHugeBenchmarks = false;
+constexpr auto kHugeSize = int64(1024) * 1024 * 1024;
+
+const auto key = Storage::EncryptionKey(bytes::make_vector(
+	bytes::make_span("\
+abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
+abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
+abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
+abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
+").subspan(0, Storage::EncryptionKey::kSize)));
+
+const auto name = QString("benchmark.db");
+
+using Clock = std::chrono::steady_clock;
+using Microseconds = std::chrono::microseconds;
+
+struct Distribution {
+	const char *name = nullptr;
+	int minimal = 0;
+	int maximal = 0;
+};
+
+// Sizes are distributed log-uniformly inside the range.
+const auto Distributions = std::vector<Distribution>{
+	{ "tiny", 512, 16 * 1024 }, // Stickers, userpics, emoji.
+	{ "mixed", 1024, 512 * 1024 }, // Thumbnails and photos.
+	{ "large", 512 * 1024, 8 * 1024 * 1024 }, // Streaming slices.
+};
+
+const auto CacheSizes = std::vector<int64>{
+	int64(10) * 1024 * 1024,
+	int64(100) * 1024 * 1024,
+	int64(1024) * 1024 * 1024,
+	int64(20) * 1024 * 1024 * 1024,
+};
+
+class Latencies {
+public:
+	void add(Clock::duration duration) {
+		_values.push_back(
+			std::chrono::duration_cast<Microseconds>(duration).count());
+	}
+	int64 percentile(int value) {
+		if (_values.empty()) {
+			return 0;
+		}
+		std::sort(begin(_values), end(_values));
+		const auto index = (_values.size() - 1) * value / 100;
+		return _values[index];
+	}
+
+private:
+	std::vector<int64> _values;
+
+};
+
+crl::semaphore Semaphore;
+
+Error Open(Database &db) {
+	auto result = Error();
+	db.open(base::duplicate(key), [&](Error error) {
+		result = error;
+		Semaphore.release();
+	});
+	Semaphore.acquire();
+	return result;
+}
+
+void Close(Database &db) {
+	db.close([&] { Semaphore.release(); });
+	Semaphore.acquire();
+}
+
+Error Clear(Database &db) {
+	auto result = Error();
+	db.clear([&](Error error) {
+		result = error;
+		Semaphore.release();
+	});
+	Semaphore.acquire();
+	return result;
+}
+
+int64 BinlogSize() {
+	QFile versionFile(name + "/version");
+	if (!versionFile.open(QIODevice::ReadOnly)) {
+		return 0;
+	}
+	const auto bytes = versionFile.readAll();
+	if (bytes.size() != 4) {
+		return 0;
+	}
+	const auto version = *reinterpret_cast<const int32*>(bytes.data());
+	return QFile(name + '/' + QString::number(version) + "/binlog").size();
+}
+
+Key KeyByIndex(int index) {
+	return Key{ uint64(index) * 7 + 1, (uint64(index) << 32) + 13 };
+}
+
+double Megabytes(int64 size) {
+	return size / (1024. * 1024.);
+}
+
+double Seconds(Clock::duration duration) {
+	return std::chrono::duration_cast<Microseconds>(duration).count()
+		/ 1'000'000.;
+}
+
+void Report(
+		const std::string &title,
+		int64 count,
+		int64 total,
+		Clock::duration duration,
+		Latencies &latencies) {
+	const auto seconds = std::max(Seconds(duration), 0.000001);
+	std::cout
+		<< std::setw(28) << std::left << title
+		<< std::setw(10) << std::right << int64(count / seconds) << " op/s"
+		<< std::setw(10) << std::fixed << std::setprecision(1)
+		<< (Megabytes(total) / seconds) << " MB/s"
+		<< "  p50 " << latencies.percentile(50) << " us"
+		<< "  p99 " << latencies.percentile(99) << " us"
+		<< std::endl;
+}
+
+void Report(const std::string &title, Clock::duration duration) {
+	std::cout
+		<< std::setw(28) << std::left << title
+		<< std::setw(10) << std::right << std::fixed
+		<< std::setprecision(3) << Seconds(duration) << " s"
+		<< std::endl;
+}
+
+void RunBenchmark(
+		int64 cacheSize,
+		const Distribution &distribution,
+		Database::Settings settings) {
+	std::cout
+		<< "--- " << int64(Megabytes(cacheSize)) << " MB, "
+		<< distribution.name << " values ---" << std::endl;
+
+	auto engine = std::mt19937(int(cacheSize) ^ distribution.minimal);
+	auto sizes = std::uniform_real_distribution<double>(
+		std::log(double(distribution.minimal)),
+		std::log(double(distribution.maximal)));
+	auto values = std::vector<int>();
+	for (auto total = int64(); total < cacheSize;) {
+		values.push_back(int(std::exp(sizes(engine))));
+		total += values.back();
+	}
+	const auto count = int(values.size());
+	auto bytes = QByteArray(distribution.maximal, Qt::Uninitialized);
+	for (auto i = 0; i != bytes.size(); ++i) {
+		bytes[i] = char(engine() & 0xFF);
+	}
+
+	settings.totalSizeLimit = 0;
+	settings.totalTimeLimit = 0;
+	Database db(name, settings);
+	REQUIRE(Clear(db).type == Error::Type::None);
+	REQUIRE(Open(db).type == Error::Type::None);
+
+	auto written = int64();
+	auto latencies = Latencies();
+	const auto putStart = Clock::now();
+	for (auto i = 0; i != count; ++i) {
+		const auto started = Clock::now();
+		db.put(KeyByIndex(i), bytes.mid(0, values[i]), [&](Error error) {
+			latencies.add(Clock::now() - started);
+			Semaphore.release();
+		});
+		Semaphore.acquire();
+		written += values[i];
+	}
+	Report("put", count, written, Clock::now() - putStart, latencies);
+
+	auto read = int64();
+	latencies = Latencies();
+	auto order = std::vector<int>(count);
+	std::iota(begin(order), end(order), 0);
+	std::shuffle(begin(order), end(order), engine);
+	const auto getStart = Clock::now();
+	for (const auto index : order) {
+		const auto started = Clock::now();
+		db.get(KeyByIndex(index), [&](QByteArray &&value) {
+			latencies.add(Clock::now() - started);
+			read += value.size();
+			Semaphore.release();
+		});
+		Semaphore.acquire();
+	}
+	Report("random get", count, read, Clock::now() - getStart, latencies);
+
+	latencies = Latencies();
+	const auto missStart = Clock::now();
+	for (auto i = 0; i != count; ++i) {
+		const auto started = Clock::now();
+		db.get(KeyByIndex(count + i), [&](QByteArray &&value) {
+			latencies.add(Clock::now() - started);
+			Semaphore.release();
+		});
+		Semaphore.acquire();
+	}
+	Report("missing get", count, 0, Clock::now() - missStart, latencies);
+
+	// Remove half of the values, so that the binlog has enough excess.
+	for (auto i = 0; i < count; i += 2) {
+		db.remove(KeyByIndex(i), nullptr);
+	}
+	db.sync();
+	Close(db);
+
+	// Compactor starts right after open and runs in background.
+	const auto original = BinlogSize();
+	auto compacting = settings;
+	compacting.compactAfterExcess = 1;
+	db.reconfigure(compacting);
+
+	const auto openStart = Clock::now();
+	REQUIRE(Open(db).type == Error::Type::None);
+	Report("open", Clock::now() - openStart);
+
+	// Wait for the compactor to replace the binlog.
+	const auto compactStart = Clock::now();
+	while (BinlogSize() >= original
+		&& Clock::now() - compactStart < std::chrono::seconds(600)) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	Report("compact", Clock::now() - compactStart);
+
+	Close(db);
+	REQUIRE(Clear(db).type == Error::Type::None);
+}
+
+} // namespace
+
+TEST_CASE("init timers", "[storage_cache_database_benchmarks]") {
+	static auto init = [] {
+		int argc = 0;
+		char **argv = nullptr;
+		static QCoreApplication application(argc, argv);
+		static base::ConcurrentTimerEnvironment environment;
+#ifdef Q_OS_WIN
+		Platform::Dlls::start();
+#endif // Q_OS_WIN
+		return true;
+	}();
+}
+
+TEST_CASE("cache db throughput", "[storage_cache_database_benchmarks]") {
+	auto settings = Database::Settings();
+	settings.compactAfterExcess = std::numeric_limits<int64>::max();
+	settings.writeBundleDelay = crl::time(1000);
+	settings.trackEstimatedTime = true;
+
+	for (const auto cacheSize : CacheSizes) {
+		if (cacheSize > kHugeSize && !EnableHugeBenchmarks) {
+			continue;
+		}
+		for (const auto &distribution : Distributions) {
+			RunBenchmark(cacheSize, distribution, settings);
+		}
+	}
+}
@@ -10,6 +10,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/cache/storage_cache_cleaner.h"
 #include "storage/cache/storage_cache_compactor.h"
 #include "storage/cache/storage_cache_binlog_reader.h"
+#include "storage/cache/storage_cache_membership_filter.h"
 #include "storage/storage_encryption.h"
 #include "storage/storage_encrypted_file.h"
 #include "base/flat_map.h"
@@ -76,11 +77,14 @@ DatabaseObject::Entry::Entry(
 DatabaseObject::DatabaseObject(
 	crl::weak_on_queue<DatabaseObject> weak,
 	const QString &path,
-	const Settings &settings)
+	const Settings &settings,
+	std::shared_ptr<MembershipFilter> filter)
 : _weak(std::move(weak))
 , _base(ComputeBasePath(path))
 , _settings(settings)
+, _filter(std::move(filter))
 , _writeBundlesTimer(_weak, [=] { writeBundles(); checkCompactor(); })
+, _writeStoresTimer(_weak, [=] { writePendingStores(); })
 , _pruneTimer(_weak, [=] { prune(); }) {
 	checkSettings();
 }
@@ -220,6 +224,10 @@ File::Result DatabaseObject::openBinlog(
 bool DatabaseObject::readHeader() {
 	if (const auto header = BinlogWrapper::ReadHeader(_binlog, _settings)) {
 		_time.setRelative((_time.system = header->systemTime));
+
+		// A compacted binlog is a snapshot of the whole index,
+		// so we can avoid rehashing the map while replaying it.
+		_map.reserve(header->keysCountHint);
 		return true;
 	}
 	return false;
@@ -280,10 +288,15 @@ void DatabaseObject::readBinlog() {
 			return processRecordMultiRemove(header, element);
 		});
 	}
+	rebuildFilter();
 	adjustRelativeTime();
 	optimize();
 }
 
+void DatabaseObject::rebuildFilter() {
+	_filter->rebuild(_map | ranges::view::keys);
+}
+
 uint64 DatabaseObject::countRelativeTime() const {
 	const auto now = GetUnixtime();
 	const auto delta = std::max(int64(now) - int64(_time.system), 0LL);
@@ -373,6 +386,7 @@ void DatabaseObject::clearStaleNow(const base::flat_set<Key> &stale) {
 
 	// Report correct status async.
 	_stale.clear();
+	rebuildFilter();
 	optimize();
 }
 
@@ -401,6 +415,7 @@ void DatabaseObject::clearStaleChunk() {
 	_stale.resize(count - clear);
 	if (_stale.empty()) {
 		base::take(_stale);
+		rebuildFilter();
 		optimize();
 	} else {
 		clearStaleChunkDelayed();
@@ -583,11 +598,14 @@ bool DatabaseObject::processRecordMultiAccess(
 void DatabaseObject::setMapEntry(const Key &key, Entry &&entry) {
 	auto &already = _map[key];
 	updateStats(already, entry);
+	_filter->add(key);
 	if (already.size != 0) {
 		_binlogExcessLength += _settings.trackEstimatedTime
 			? sizeof(StoreWithTime)
 			: sizeof(Store);
+		releasePlace(already);
 	}
+	usePlace(entry);
 	if (entry.useTime != 0
 		&& (entry.useTime < _minimalEntryTime || !_minimalEntryTime)) {
 		_minimalEntryTime = entry.useTime;
@@ -657,10 +675,52 @@ void DatabaseObject::eraseMapEntry(const Map::const_iterator &i) {
 				_minimalEntryTime = 0;
 			}
 		}
+		releasePlace(entry);
 		_map.erase(i);
 	}
 }
 
+void DatabaseObject::usePlace(const Entry &entry) {
+	if (!_placeUsage[entry.place]++) {
+		_contents.emplace(ContentId(entry.size, entry.checksum), entry.place);
+	}
+}
+
+void DatabaseObject::releasePlace(const Entry &entry) {
+	const auto i = _placeUsage.find(entry.place);
+	Assert(i != end(_placeUsage) && i->second > 0);
+
+	if (--i->second) {
+		return;
+	}
+	_placeUsage.erase(i);
+	const auto j = _contents.find(ContentId(entry.size, entry.checksum));
+	if (j != end(_contents) && j->second == entry.place) {
+		_contents.erase(j);
+	}
+}
+
+bool DatabaseObject::isUsedPlace(PlaceId place) const {
+	return _placeUsage.find(place) != end(_placeUsage);
+}
+
+bool DatabaseObject::isSharedPlace(PlaceId place) const {
+	const auto i = _placeUsage.find(place);
+	return (i != end(_placeUsage)) && (i->second > 1);
+}
+
+std::optional<PlaceId> DatabaseObject::findSamePlace(
+		const TaggedValue &value,
+		uint32 checksum) const {
+	const auto size = size_type(value.bytes.size());
+	const auto i = _contents.find(ContentId(size, checksum));
+	if (i == end(_contents)
+		|| readValueData(i->second, size) != value.bytes) {
+		return std::nullopt;
+	}
+	return i->second;
+}
+
 EstimatedTimePoint DatabaseObject::countTimePoint() const {
 	const auto now = GetUnixtime();
 	const auto delta = std::max(int64(now) - int64(_time.system), 0LL);
@@ -741,12 +801,17 @@ void DatabaseObject::close(FnMut<void()> &&done) {
 }
 
 void DatabaseObject::clearState() {
+	_filter->invalidate();
 	_path = QString();
 	_key = {};
 	_map = {};
+	_placeUsage = {};
+	_contents = {};
 	_removing = {};
 	_accessed = {};
 	_stale = {};
+	_pendingStores = {};
+	_pendingStoresCount = 0;
 	_time = {};
 	_binlogExcessLength = 0;
 	_totalSize = 0;
@@ -755,6 +820,7 @@ void DatabaseObject::clearState() {
 	_taggedStats = {};
 	_pushingStats = false;
 	_writeBundlesTimer.cancel();
+	_writeStoresTimer.cancel();
 	_pruneTimer.cancel();
 	_compactor = CompactorWrap();
 }
@@ -776,7 +842,7 @@ void DatabaseObject::put(
 		invokeCallback(done, ioError(binlogPath()));
 		return;
 	} else if (maybepath->isEmpty()) {
-		// Nothing changed.
+		// Nothing changed or the same value is stored for another key.
 		invokeCallback(done, Error::NoError());
 		recordEntryAccess(key);
 		return;
@@ -826,6 +892,7 @@ std::optional<QString> DatabaseObject::writeKeyPlaceGeneric(
 	record.key = key;
 	record.setSize(size);
 	record.checksum = checksum;
+	auto was = std::optional<PlaceId>();
 	if (const auto i = _map.find(key); i != end(_map)) {
 		const auto &already = i->second;
 		if (already.tag == record.tag
@@ -834,25 +901,32 @@ std::optional<QString> DatabaseObject::writeKeyPlaceGeneric(
 			&& readValueData(already.place, size) == value.bytes) {
 			return QString();
 		}
-		record.place = already.place;
+		was = already.place;
+	}
+	const auto same = findSamePlace(value, checksum);
+	if (same) {
+		// The value is stored already, no need to write it once again.
+		record.place = *same;
+	} else if (was && !isSharedPlace(*was)) {
+		record.place = *was;
 	} else {
 		do {
 			bytes::set_random(bytes::object_as_span(&record.place));
 		} while (!isFreePlace(record.place));
 	}
-	const auto result = placePath(record.place);
-	auto writeable = record;
-	const auto success = _binlog.write(bytes::object_as_span(&writeable));
-	if (!success) {
-		_binlog.close();
+	const auto result = same ? QString() : placePath(record.place);
+	if (!writeStoreRecord(record)) {
 		return QString();
 	}
-	_binlog.flush();
 
 	const auto applied = processRecordStore(
 		&record,
 		std::is_class<StoreRecord>{});
 	Assert(applied);
+
+	if (was && *was != record.place && !isUsedPlace(*was)) {
+		QFile(placePath(*was)).remove();
+	}
 	return result;
 }
 
@@ -897,6 +971,10 @@ Error DatabaseObject::writeExistingPlaceGeneric(
 		}
 	}
 	record.place = entry.place;
+	const auto pending = writePendingStores();
+	if (pending.type != Error::Type::None) {
+		return pending;
+	}
 	auto writeable = record;
 	const auto success = _binlog.write(bytes::object_as_span(&writeable));
 	if (!success) {
@@ -974,12 +1052,38 @@ void DatabaseObject::getWithSizes(
 	});
 }
 
+void DatabaseObject::getMany(
+		const std::vector<Key> &keys,
+		FnMut<void(std::vector<TaggedValue>&&)> &&done) {
+	auto result = std::vector<TaggedValue>(keys.size());
+
+	// Read values sorted by place so that files from the same
+	// place directory are read one after another.
+	auto order = std::vector<std::pair<PlaceId, size_type>>();
+	order.reserve(keys.size());
+	for (auto index = size_type(0); index != keys.size(); ++index) {
+		if (const auto i = _map.find(keys[index]); i != end(_map)) {
+			order.emplace_back(i->second.place, index);
+		}
+	}
+	ranges::sort(order);
+	for (const auto &[place, index] : order) {
+		get(keys[index], [&](TaggedValue &&value) {
+			result[index] = std::move(value);
+		});
+	}
+	invokeCallback(done, std::move(result));
+}
+
 QByteArray DatabaseObject::readValueData(
 		PlaceId place,
 		size_type size) const {
 	const auto path = placePath(place);
+	const auto mode = _settings.readPlacesMapped
+		? File::Mode::ReadMapped
+		: File::Mode::Read;
 	File data;
-	const auto result = data.open(path, File::Mode::Read, _key);
+	const auto result = data.open(path, mode, _key);
 	switch (result) {
 	case File::Result::Failed:
 	case File::Result::WrongKey: return QByteArray();
@@ -1011,9 +1115,12 @@ void DatabaseObject::remove(const Key &key, FnMut<void(Error)> &&done) {
 		_removing.emplace(key);
 		writeMultiRemoveLazy();
 
-		const auto path = placePath(i->second.place);
+		const auto place = i->second.place;
+		const auto path = placePath(place);
 		eraseMapEntry(i);
-		if (QFile(path).remove() || !QFile(path).exists()) {
+		if (isUsedPlace(place)
+			|| QFile(path).remove()
+			|| !QFile(path).exists()) {
 			invokeCallback(done, Error::NoError());
 		} else {
 			invokeCallback(done, ioError(path));
@@ -1085,6 +1192,8 @@ Stats DatabaseObject::collectStats() const {
 	result.full.count = _map.size();
 	result.full.totalSize = _totalSize;
 	result.clearing = (_cleaner.object != nullptr) || !_stale.empty();
+	result.clearingTotalSize = _cleaner.totalSize;
+	result.clearingRemovedSize = _cleaner.removedSize;
 	return result;
 }
 
@@ -1094,6 +1203,52 @@ void DatabaseObject::writeBundlesLazy() {
 	}
 }
 
+template <typename StoreRecord>
+bool DatabaseObject::writeStoreRecord(const StoreRecord &record) {
+	if (_settings.writeStoresDelay <= 0) {
+		auto writeable = record;
+		const auto success = _binlog.write(
+			bytes::object_as_span(&writeable));
+		if (!success) {
+			_binlog.close();
+			return false;
+		}
+		_binlog.flush();
+		return true;
+	}
+
+	// Many puts in a row (f.e. when opening a sticker panel) produce
+	// one MultiStore record and one flush instead of one per value.
+	const auto data = bytes::object_as_span(&record);
+	_pendingStores.insert(end(_pendingStores), data.begin(), data.end());
+	if (++_pendingStoresCount == _settings.maxBundledRecords) {
+		return (writePendingStores().type == Error::Type::None);
+	} else if (!_writeStoresTimer.isActive()) {
+		_writeStoresTimer.callOnce(_settings.writeStoresDelay);
+	}
+	return true;
+}
+
+Error DatabaseObject::writePendingStores() {
+	Expects(_pendingStoresCount <= _settings.maxBundledRecords);
+
+	if (!_pendingStoresCount) {
+		return Error::NoError();
+	}
+	_writeStoresTimer.cancel();
+
+	// MultiStoreWithTime has the same header as MultiStore.
+	auto header = MultiStore(base::take(_pendingStoresCount));
+	auto list = base::take(_pendingStores);
+	if (_binlog.write(bytes::object_as_span(&header))
+		&& _binlog.write(bytes::make_span(list))) {
+		_binlog.flush();
+		return Error::NoError();
+	}
+	_binlog.close();
+	return ioError(binlogPath());
+}
+
 void DatabaseObject::writeMultiRemoveLazy() {
 	if (_removing.size() == _settings.maxBundledRecords) {
 		writeMultiRemove();
@@ -1108,6 +1263,10 @@ Error DatabaseObject::writeMultiRemove() {
 	if (_removing.empty()) {
 		return Error::NoError();
 	}
+	const auto pending = writePendingStores();
+	if (pending.type != Error::Type::None) {
+		return pending;
+	}
 	const auto size = _removing.size();
 	auto header = MultiRemove(size);
 	auto list = std::vector<MultiRemove::Part>();
@@ -1145,6 +1304,10 @@ Error DatabaseObject::writeMultiAccessBlock() {
 	Expects(_settings.trackEstimatedTime);
 	Expects(_accessed.size() <= _settings.maxBundledRecords);
 
+	const auto pending = writePendingStores();
+	if (pending.type != Error::Type::None) {
+		return pending;
+	}
 	const auto time = countTimePoint();
 	const auto size = _accessed.size();
 	auto header = MultiAccess(time, size);
@@ -1174,6 +1337,7 @@ Error DatabaseObject::writeMultiAccessBlock() {
 }
 
 void DatabaseObject::writeBundles() {
+	writePendingStores();
 	writeMultiRemove();
 	if (_settings.trackEstimatedTime) {
 		writeMultiAccess();
@@ -1181,18 +1345,35 @@ void DatabaseObject::writeBundles() {
 }
 
 void DatabaseObject::createCleaner() {
+	auto progress = [weak = _weak](int64 removedSize, int64 totalSize) {
+		weak.with([=](DatabaseObject &that) {
+			that.cleanerProgress(removedSize, totalSize);
+		});
+	};
 	auto done = [weak = _weak](Error error) {
 		weak.with([=](DatabaseObject &that) {
 			that.cleanerDone(error);
 		});
 	};
+	_cleaner.removedSize = _cleaner.totalSize = 0;
 	_cleaner.object = std::make_unique<Cleaner>(
 		_base,
+		_settings,
 		_cleaner.guard.make_guard(),
+		std::move(progress),
 		std::move(done));
 	pushStatsDelayed();
 }
 
+void DatabaseObject::cleanerProgress(int64 removedSize, int64 totalSize) {
+	if (!_cleaner.object) {
+		return;
+	}
+	_cleaner.removedSize = removedSize;
+	_cleaner.totalSize = totalSize;
+	pushStatsDelayed();
+}
+
 void DatabaseObject::cleanerDone(Error error) {
 	invokeCallback(_cleaner.done);
 	_cleaner = CleanerWrap();
@@ -14,6 +14,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/bytes.h"
 #include "base/flat_set.h"
 #include <set>
+#include <map>
 #include <rpl/event_stream.h>
 
 namespace Storage {
@@ -22,6 +23,7 @@ namespace details {
 
 class Cleaner;
 class Compactor;
+class MembershipFilter;
 
 class DatabaseObject {
 public:
@@ -29,7 +31,8 @@ public:
 	DatabaseObject(
 		crl::weak_on_queue<DatabaseObject> weak,
 		const QString &path,
-		const Settings &settings);
+		const Settings &settings,
+		std::shared_ptr<MembershipFilter> filter);
 	void reconfigure(const Settings &settings);
 	void updateSettings(const SettingsUpdate &update);
 
@@ -60,6 +63,9 @@ public:
 		const Key &key,
 		std::vector<Key> &&keys,
 		FnMut<void(QByteArray&&, std::vector<int>&&)> &&done);
+	void getMany(
+		const std::vector<Key> &keys,
+		FnMut<void(std::vector<TaggedValue>&&)> &&done);
 
 	rpl::producer<Stats> stats() const;
 
@@ -98,6 +104,8 @@ private:
 		std::unique_ptr<Cleaner> object;
 		base::binary_guard guard;
 		FnMut<void()> done;
+		int64 removedSize = 0;
+		int64 totalSize = 0;
 	};
 	struct CompactorWrap {
 		std::unique_ptr<Compactor> object;
@@ -107,6 +115,7 @@ private:
 		base::binary_guard guard;
 	};
 	using Map = std::unordered_map<Key, Entry>;
+	using ContentId = std::pair<size_type, uint32>;
 
 	template <typename Callback, typename ...Args>
 	void invokeCallback(Callback &&callback, Args &&...args) const;
@@ -180,6 +189,13 @@ private:
 
 	void setMapEntry(const Key &key, Entry &&entry);
 	void eraseMapEntry(const Map::const_iterator &i);
+	void usePlace(const Entry &entry);
+	void releasePlace(const Entry &entry);
+	bool isUsedPlace(PlaceId place) const;
+	bool isSharedPlace(PlaceId place) const;
+	std::optional<PlaceId> findSamePlace(
+		const TaggedValue &value,
+		uint32 checksum) const;
 	void recordEntryAccess(const Key &key);
 	QByteArray readValueData(PlaceId place, size_type size) const;
 
@@ -209,6 +225,9 @@ private:
 	Error writeExistingPlace(
 		const Key &key,
 		const Entry &entry);
+	template <typename StoreRecord>
+	bool writeStoreRecord(const StoreRecord &record);
+	Error writePendingStores();
 	void writeMultiRemoveLazy();
 	Error writeMultiRemove();
 	void writeMultiAccessLazy();
@@ -218,18 +237,29 @@ private:
 	void writeBundles();
 
 	void createCleaner();
+	void cleanerProgress(int64 removedSize, int64 totalSize);
 	void cleanerDone(Error error);
 	void clearState();
+	void rebuildFilter();
 
 	crl::weak_on_queue<DatabaseObject> _weak;
 	QString _base, _path;
 	Settings _settings;
+	const std::shared_ptr<MembershipFilter> _filter;
 	EncryptionKey _key;
 	File _binlog;
 	Map _map;
+
+	// Keys with equal values share one place, so place files are removed
+	// only when the last key using them is removed.
+	std::map<PlaceId, int> _placeUsage;
+	std::map<ContentId, PlaceId> _contents;
+
 	std::set<Key> _removing;
 	std::set<Key> _accessed;
 	std::vector<Key> _stale;
+	bytes::vector _pendingStores;
+	size_type _pendingStoresCount = 0;
 
 	EstimatedTimePoint _time;
 
@@ -244,6 +274,7 @@ private:
 	bool _clearingStale = false;
 
 	base::ConcurrentTimer _writeBundlesTimer;
+	base::ConcurrentTimer _writeStoresTimer;
 	base::ConcurrentTimer _pruneTimer;
 
 	CleanerWrap _cleaner;
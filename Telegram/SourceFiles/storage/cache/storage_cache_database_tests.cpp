@@ -8,11 +8,15 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "catch.hpp"
 
 #include "storage/cache/storage_cache_database.h"
+#include "storage/cache/storage_cache_membership_filter.h"
 #include "storage/storage_encryption.h"
 #include "storage/storage_encrypted_file.h"
 #include "base/concurrent_timer.h"
+#include "base/algorithm.h"
 #include <crl/crl.h>
 #include <QtCore/QFile>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
 #include <QtWidgets/QApplication>
 #include <thread>
 
@@ -117,6 +121,16 @@ Database::TaggedValue GetWithTag(Database &db, const Key &key) {
 	return ValueWithTag;
 }
 
+auto Values = std::vector<QByteArray>();
+std::vector<QByteArray> GetMany(Database &db, std::vector<Key> &&keys) {
+	db.getMany(std::move(keys), [&](std::vector<QByteArray> &&values) {
+		Values = std::move(values);
+		Semaphore.release();
+	});
+	Semaphore.acquire();
+	return base::take(Values);
+}
+
 Error Put(Database &db, const Key &key, QByteArray &&value) {
 	db.put(key, std::move(value), GetResult);
 	Semaphore.acquire();
@@ -181,6 +195,35 @@ TEST_CASE("init timers", "[storage_cache_database]") {
 	}();
 }
 
+TEST_CASE("membership filter", "[storage_cache_database]") {
+	using details::MembershipFilter;
+
+	SECTION("filter is not used before rebuild") {
+		MembershipFilter filter;
+		REQUIRE(!filter.definitelyMissing(Key{ 0, 1 }));
+	}
+	SECTION("filter answers after rebuild") {
+		MembershipFilter filter;
+		filter.rebuild(std::vector<Key>{ Key{ 0, 1 }, Key{ 1, 0 } });
+		REQUIRE(!filter.definitelyMissing(Key{ 0, 1 }));
+		REQUIRE(!filter.definitelyMissing(Key{ 1, 0 }));
+		REQUIRE(filter.definitelyMissing(Key{ 5, 7 }));
+
+		filter.add(Key{ 5, 7 });
+		REQUIRE(!filter.definitelyMissing(Key{ 5, 7 }));
+	}
+	SECTION("filter is not used while keys are changing") {
+		MembershipFilter filter;
+		filter.rebuild(std::vector<Key>());
+		filter.requestStarted();
+		REQUIRE(!filter.definitelyMissing(Key{ 5, 7 }));
+		filter.requestFinished();
+		REQUIRE(filter.definitelyMissing(Key{ 5, 7 }));
+		filter.invalidate();
+		REQUIRE(!filter.definitelyMissing(Key{ 5, 7 }));
+	}
+}
+
 TEST_CASE("compacting db", "[storage_cache_database]") {
 	if (DisableCompactTests || !DisableLargeTest) {
 		return;
@@ -448,6 +491,23 @@ TEST_CASE("encrypted cache db", "[storage_cache_database]") {
 		REQUIRE((Get(db, Key{ 1, 0 }) == Test2()));
 		Close(db);
 	}
+	SECTION("reading many values from db") {
+		Database db(name, Settings);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		const auto values = GetMany(db, {
+			Key{ 1, 0 },
+			Key{ 1, 1 },
+			Key{ 0, 1 },
+			Key{ 1, 0 },
+		});
+		REQUIRE(values.size() == 4);
+		REQUIRE((values[0] == Test2()));
+		REQUIRE(values[1].isEmpty());
+		REQUIRE((values[2] == Test1()));
+		REQUIRE((values[3] == Test2()));
+		Close(db);
+	}
 	SECTION("deleting in db by tag") {
 		Database db(name, Settings);
 
@@ -538,6 +598,166 @@ TEST_CASE("cache db remove", "[storage_cache_database]") {
 	}
 }
 
+TEST_CASE("cache db equal values", "[storage_cache_database]") {
+	if (!DisableLargeTest) {
+		return;
+	}
+	SECTION("db equal values survive removing one of them") {
+		Database db(name, Settings);
+
+		REQUIRE(Clear(db).type == Error::Type::None);
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE(Put(db, Key{ 0, 1 }, Test1()).type == Error::Type::None);
+		REQUIRE(Put(db, Key{ 0, 2 }, Test1()).type == Error::Type::None);
+		REQUIRE(Put(db, Key{ 0, 3 }, Test1()).type == Error::Type::None);
+		Remove(db, Key{ 0, 1 });
+		REQUIRE(Get(db, Key{ 0, 1 }).isEmpty());
+		REQUIRE((Get(db, Key{ 0, 2 }) == Test1()));
+		REQUIRE(Put(db, Key{ 0, 2 }, Test2()).type == Error::Type::None);
+		REQUIRE((Get(db, Key{ 0, 2 }) == Test2()));
+		REQUIRE((Get(db, Key{ 0, 3 }) == Test1()));
+		Close(db);
+	}
+	SECTION("db equal values survive reopening") {
+		Database db(name, Settings);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE((Get(db, Key{ 0, 2 }) == Test2()));
+		REQUIRE((Get(db, Key{ 0, 3 }) == Test1()));
+		REQUIRE(Put(db, Key{ 0, 4 }, Test1()).type == Error::Type::None);
+		Remove(db, Key{ 0, 3 });
+		REQUIRE((Get(db, Key{ 0, 4 }) == Test1()));
+		Close(db);
+	}
+}
+
+TEST_CASE("cache db coalesced stores", "[storage_cache_database]") {
+	if (!DisableLargeTest) {
+		return;
+	}
+	auto settings = Settings;
+	settings.writeStoresDelay = crl::time(500);
+	settings.maxBundledRecords = 5;
+
+	SECTION("db stores written lazily") {
+		Database db(name, settings);
+
+		REQUIRE(Clear(db).type == Error::Type::None);
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		const auto path = GetBinlogPath();
+		const auto size = QFile(path).size();
+		REQUIRE(Put(db, Key{ 0, 1 }, Test1()).type == Error::Type::None);
+		REQUIRE(Put(db, Key{ 1, 0 }, Test2()).type == Error::Type::None);
+		REQUIRE(QFile(path).size() == size);
+		REQUIRE((Get(db, Key{ 0, 1 }) == Test1()));
+		AdvanceTime(1);
+		REQUIRE(QFile(path).size() > size);
+		Close(db);
+	}
+	SECTION("db stores written on close and on overflow") {
+		Database db(name, settings);
+
+		REQUIRE(Clear(db).type == Error::Type::None);
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		const auto path = GetBinlogPath();
+		const auto size = QFile(path).size();
+		for (auto i = 0U; i != 5U; ++i) {
+			REQUIRE(Put(db, Key{ i, i }, Test1()).type == Error::Type::None);
+		}
+		REQUIRE(QFile(path).size() > size);
+		REQUIRE(Put(db, Key{ 5, 5 }, Test2()).type == Error::Type::None);
+		Remove(db, Key{ 0, 0 });
+		Close(db);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE(Get(db, Key{ 0, 0 }).isEmpty());
+		REQUIRE((Get(db, Key{ 4, 4 }) == Test1()));
+		REQUIRE((Get(db, Key{ 5, 5 }) == Test2()));
+		Close(db);
+	}
+}
+
+TEST_CASE("cache db shards", "[storage_cache_database]") {
+	if (!DisableLargeTest) {
+		return;
+	}
+	auto settings = Settings;
+	settings.shardsCount = 4;
+	const auto ShardKey = [](uint64 index) {
+		return Key{ index, index << 20 };
+	};
+
+	SECTION("db values are spread between shards") {
+		Database db(name, settings);
+
+		REQUIRE(Clear(db).type == Error::Type::None);
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		for (auto i = 0U; i != 16U; ++i) {
+			REQUIRE(Put(db, ShardKey(i), Test1()).type == Error::Type::None);
+		}
+		REQUIRE(Put(db, Key{ 16, 0 }, Test2()).type == Error::Type::None);
+		for (auto i = 17U; i != 32U; ++i) {
+			REQUIRE(CopyIfEmpty(db, Key{ 16, 0 }, ShardKey(i)).type
+				== Error::Type::None);
+		}
+		REQUIRE((Get(db, ShardKey(0)) == Test1()));
+		REQUIRE((Get(db, ShardKey(31)) == Test2()));
+		REQUIRE(MoveIfEmpty(db, ShardKey(1), ShardKey(40)).type
+			== Error::Type::None);
+		REQUIRE(Get(db, ShardKey(1)).isEmpty());
+		REQUIRE((Get(db, ShardKey(40)) == Test1()));
+		Close(db);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		const auto values = GetMany(
+			db,
+			{ ShardKey(0), ShardKey(1), ShardKey(15), ShardKey(20) });
+		REQUIRE(values.size() == 4);
+		REQUIRE((values[0] == Test1()));
+		REQUIRE(values[1].isEmpty());
+		REQUIRE((values[2] == Test1()));
+		REQUIRE((values[3] == Test2()));
+		Close(db);
+	}
+	SECTION("db shards are cleared together") {
+		Database db(name, settings);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE(Clear(db).type == Error::Type::None);
+		for (auto i = 0U; i != 32U; ++i) {
+			REQUIRE(Get(db, ShardKey(i)).isEmpty());
+		}
+		Close(db);
+	}
+}
+
+TEST_CASE("cache db clear", "[storage_cache_database]") {
+	SECTION("db old generation removed by chunks") {
+		auto settings = Settings;
+		settings.cleanChunkFiles = 1;
+		settings.cleanChunkDelay = 10;
+		Database db(name, settings);
+
+		REQUIRE(Clear(db).type == Error::Type::None);
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE(Put(db, Key{ 0, 1 }, Test1()).type == Error::Type::None);
+		REQUIRE(Put(db, Key{ 0, 2 }, Test2()).type == Error::Type::None);
+		const auto old = QFileInfo(GetBinlogPath()).path();
+		REQUIRE(QDir(old).exists());
+
+		REQUIRE(Clear(db).type == Error::Type::None);
+		REQUIRE(Put(db, Key{ 0, 3 }, Test1()).type == Error::Type::None);
+		REQUIRE(Get(db, Key{ 0, 1 }).isEmpty());
+		REQUIRE((Get(db, Key{ 0, 3 }) == Test1()));
+
+		db.waitForCleaner([&] { Semaphore.release(); });
+		Semaphore.acquire();
+		REQUIRE(!QDir(old).exists());
+		REQUIRE((Get(db, Key{ 0, 3 }) == Test1()));
+		Close(db);
+	}
+}
+
 TEST_CASE("cache db bundled actions", "[storage_cache_database]") {
 	if (!DisableLargeTest) {
 		return;
@@ -0,0 +1,97 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "storage/cache/storage_cache_membership_filter.h"
+
+namespace Storage {
+namespace Cache {
+namespace details {
+namespace {
+
+constexpr auto kPartBits = 64;
+constexpr auto kPartsCount = (1 << 21) / kPartBits;
+constexpr auto kTotalBits = uint64(kPartsCount) * kPartBits;
+constexpr auto kHashesCount = 4;
+
+template <typename Method>
+bool EnumerateBits(const Key &key, Method &&method) {
+	// Keys are random enough, so we use double hashing on their parts.
+	const auto first = key.low;
+	const auto second = key.high | 1ULL;
+	for (auto i = 0; i != kHashesCount; ++i) {
+		const auto bit = (first + i * second) % kTotalBits;
+		const auto mask = (1ULL << (bit % kPartBits));
+		if (!method(bit / kPartBits, mask)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace
+
+MembershipFilter::MembershipFilter()
+: _parts(std::make_unique<std::atomic<uint64>[]>(kPartsCount)) {
+	for (auto i = 0; i != kPartsCount; ++i) {
+		_parts[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+bool MembershipFilter::definitelyMissing(const Key &key) const {
+	const auto version = _version.load(std::memory_order_acquire);
+	if ((version & 1U) || _requests.load(std::memory_order_acquire) > 0) {
+		return false;
+	}
+	const auto missing = !EnumerateBits(key, [&](int part, uint64 mask) {
+		return (_parts[part].load(std::memory_order_relaxed) & mask) != 0;
+	});
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return missing
+		&& (_version.load(std::memory_order_relaxed) == version);
+}
+
+void MembershipFilter::requestStarted() {
+	_requests.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void MembershipFilter::requestFinished() {
+	const auto was = _requests.fetch_sub(1, std::memory_order_acq_rel);
+	Assert(was > 0);
+}
+
+void MembershipFilter::add(const Key &key) {
+	EnumerateBits(key, [&](int part, uint64 mask) {
+		_parts[part].fetch_or(mask, std::memory_order_relaxed);
+		return true;
+	});
+}
+
+void MembershipFilter::invalidate() {
+	const auto version = _version.load(std::memory_order_relaxed);
+	if (!(version & 1U)) {
+		_version.store(version + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+}
+
+void MembershipFilter::startRebuild() {
+	invalidate();
+	for (auto i = 0; i != kPartsCount; ++i) {
+		_parts[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+void MembershipFilter::finishRebuild() {
+	const auto version = _version.load(std::memory_order_relaxed);
+	Assert(version & 1U);
+
+	_version.store(version + 1, std::memory_order_release);
+}
+
+} // namespace details
+} // namespace Cache
+} // namespace Storage
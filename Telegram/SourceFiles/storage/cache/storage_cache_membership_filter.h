@@ -0,0 +1,57 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "storage/cache/storage_cache_types.h"
+#include <atomic>
+#include <memory>
+
+namespace Storage {
+namespace Cache {
+namespace details {
+
+// Bloom filter of the database keys, readable from any thread.
+//
+// It is modified only on the database queue, so readers must check
+// that no key-creating request is in flight before trusting a miss.
+class MembershipFilter {
+public:
+	MembershipFilter();
+
+	// Any thread.
+	[[nodiscard]] bool definitelyMissing(const Key &key) const;
+	void requestStarted();
+
+	// Database queue.
+	void requestFinished();
+	void add(const Key &key);
+	void invalidate();
+	template <typename Keys>
+	void rebuild(const Keys &keys) {
+		startRebuild();
+		for (const auto &key : keys) {
+			add(key);
+		}
+		finishRebuild();
+	}
+
+private:
+	void startRebuild();
+	void finishRebuild();
+
+	std::unique_ptr<std::atomic<uint64>[]> _parts;
+
+	// Odd while the bits are not ready to be used.
+	std::atomic<uint32> _version = 1;
+	std::atomic<int> _requests = 0;
+
+};
+
+} // namespace details
+} // namespace Cache
+} // namespace Storage
@@ -69,11 +69,19 @@ struct Settings {
 	size_type readBlockSize = 8 * 1024 * 1024;
 	size_type maxDataSize = (kDataSizeLimit - 1);
 	crl::time writeBundleDelay = 15 * 60 * crl::time(1000);
+	crl::time writeStoresDelay = 0; // Coalesce puts into one MultiStore.
 	size_type staleRemoveChunk = 256;
 
 	int64 compactAfterExcess = 8 * 1024 * 1024;
 	int64 compactAfterFullSize = 0;
 	size_type compactChunkSize = 16 * 1024;
+	crl::time compactChunkDelay = 0;
+
+	// Old generations are removed by chunks of files, each chunk stops
+	// after the files count or the removed bytes reach these limits.
+	size_type cleanChunkFiles = 256;
+	int64 cleanChunkSize = 64 * 1024 * 1024;
+	crl::time cleanChunkDelay = 0;
 
 	bool trackEstimatedTime = true;
 	int64 totalSizeLimit = 1024 * 1024 * 1024;
@@ -82,6 +90,10 @@ struct Settings {
 	crl::time maxPruneCheckTimeout = 3600 * crl::time(1000);
 
 	bool clearOnWrongKey = false;
+	bool readPlacesMapped = false;
+
+	// Each shard has its own queue and binlog, read only in constructor.
+	int shardsCount = 1;
 };
 
 struct SettingsUpdate {
@@ -105,6 +117,8 @@ struct Stats {
 	TaggedSummary full;
 	base::flat_map<uint8, TaggedSummary> tagged;
 	bool clearing = false;
+	int64 clearingTotalSize = 0;
+	int64 clearingRemovedSize = 0;
 };
 
 using Version = int32;
@@ -136,7 +150,7 @@ struct BasicHeader {
 	uint32 format : 8;
 	uint32 flags : 24;
 	uint32 systemTime = 0;
-	uint32 reserved1 = 0;
+	uint32 keysCountHint = 0; // Written by the compactor, zero if unknown.
 	uint32 reserved2 = 0;
 };
 
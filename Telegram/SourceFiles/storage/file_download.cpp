@@ -21,6 +21,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/crash_reports.h"
 #include "base/bytes.h"
 #include "base/openssl_help.h"
+#include "storage/storage_file_writer.h"
+#include "storage/storage_shared_cache.h"
 
 namespace Storage {
 namespace {
@@ -28,12 +30,48 @@ namespace {
 // How much time without download causes additional session kill.
 constexpr auto kKillSessionTimeout = crl::time(5000);
 
-// Max 16 file parts downloaded at the same time, 128 KB each.
-constexpr auto kMaxFileQueries = 16;
+// At least 16 file parts downloaded at the same time, 128 KB each.
+constexpr auto kMinFileQueries = 16;
+
+// Up to 64 parts in flight (8 MB) on high bandwidth-delay links.
+constexpr auto kMaxFileQueries = 64;
+
+// Each download session gets about 8 parts in flight.
+constexpr auto kFileQueriesPerSession = 8;
+
+// Keep twice the estimated bandwidth-delay product in flight,
+// this way the window grows until the bandwidth stops growing.
+constexpr auto kInFlightGain = 2.;
+
+// Bandwidth is measured each second and the old maximum decays slowly.
+constexpr auto kBandwidthWindow = crl::time(1000);
+constexpr auto kBandwidthDecay = 0.9;
+
+// Minimal latency is forgotten from time to time, the route may change.
+constexpr auto kMinLatencyTimeout = 10 * crl::time(1000);
+
+// Automatic loads use at most a half of the parts in flight
+// and at most 4 MB each second, whatever the link can do.
+constexpr auto kAutoLoadingQueriesShare = 2;
+constexpr auto kAutoLoadingBytesPerWindow = int64(4 * 1024 * 1024);
+constexpr auto kAutoLoadingWindow = crl::time(1000);
 
 // Max 8 http[s] files downloaded at the same time.
 constexpr auto kMaxWebFileQueries = 8;
 
+// Max 4 of them from the same host, so that a page full of previews
+// from one server doesn't hold the rest back.
+constexpr auto kMaxWebFileQueriesPerHost = 4;
+
+// Loads to disk of 8 MB and more are resumable,
+// the loaded parts list is saved each 16 parts (2 MB).
+constexpr auto kResumableMinSize = 8 * 1024 * 1024;
+constexpr auto kResumeSaveEachParts = 16;
+constexpr auto kResumeMagic = quint32(0x54504152U);
+
+// Loads to disk of 8 MB and more reserve the disk space at start.
+constexpr auto kPreallocateMinSize = 8 * 1024 * 1024;
+
 // Different part sizes are not supported for now :(
 // Because we start downloading with some part size
 // and then we get a cdn-redirect where we support only
@@ -45,6 +83,7 @@ constexpr auto kPartSize = 128 * 1024;
 Downloader::Downloader(not_null<ApiWrap*> api)
 : _api(api)
 , _killDownloadSessionsTimer([=] { killDownloadSessions(); })
+, _autoLoadingTimer([=] { autoLoadingBudgetRestored(); })
 , _queueForWeb(kMaxWebFileQueries) {
 }
 
@@ -52,6 +91,37 @@ void Downloader::clearPriorities() {
 	++_priority;
 }
 
+bool Downloader::autoLoadingAllowed(not_null<const Queue*> queue) const {
+	const auto queriesLimit = std::max(
+		queue->queriesLimit / kAutoLoadingQueriesShare,
+		1);
+	if (queue->autoQueriesCount >= queriesLimit) {
+		return false;
+	}
+	return (_autoLoadingWindowBytes < kAutoLoadingBytesPerWindow)
+		|| (crl::now() >= _autoLoadingWindowStart + kAutoLoadingWindow);
+}
+
+void Downloader::autoLoadingRequested(int bytes) {
+	const auto now = crl::now();
+	if (now >= _autoLoadingWindowStart + kAutoLoadingWindow) {
+		_autoLoadingWindowStart = now;
+		_autoLoadingWindowBytes = 0;
+	}
+	_autoLoadingWindowBytes += bytes;
+	if (_autoLoadingWindowBytes >= kAutoLoadingBytesPerWindow
+		&& !_autoLoadingTimer.isActive()) {
+		_autoLoadingTimer.callOnce(
+			_autoLoadingWindowStart + kAutoLoadingWindow - now);
+	}
+}
+
+void Downloader::autoLoadingBudgetRestored() {
+	for (auto &[dcId, queue] : _queuesForDc) {
+		FileLoader::LoadNextFromQueue(&queue);
+	}
+}
+
 void Downloader::requestedAmountIncrement(MTP::DcId dcId, int index, int amount) {
 	Expects(index >= 0 && index < MTP::kDownloadSessionsCount);
 
@@ -66,9 +136,61 @@ void Downloader::requestedAmountIncrement(MTP::DcId dcId, int index, int amount)
 		killDownloadSessionsStop(dcId);
 	} else if (ranges::find_if(it->second, _1 > 0) == end(it->second)) {
 		killDownloadSessionsStart(dcId);
+	} else if (!it->second[index]) {
+		const auto link = _links.find(dcId);
+		if (link != end(_links) && index >= link->second.sessionsCount) {
+			// This session is not used after the window shrinked.
+			MTP::stopSession(MTP::downloadDcId(dcId, index));
+		}
 	}
 }
 
+void Downloader::partLoaded(MTP::DcId dcId, int bytes, crl::time latency) {
+	const auto now = crl::now();
+	auto &link = _links[dcId];
+	if (!link.minLatency
+		|| latency < link.minLatency
+		|| now >= link.minLatencyReset) {
+		link.minLatency = std::max(latency, crl::time(1));
+		link.minLatencyReset = now + kMinLatencyTimeout;
+	}
+	if (!link.windowStart) {
+		link.windowStart = now - latency;
+	}
+	link.windowBytes += bytes;
+	const auto elapsed = now - link.windowStart;
+	if (elapsed < kBandwidthWindow) {
+		return;
+	}
+	const auto bandwidth = link.windowBytes / float64(elapsed);
+	link.maxBandwidth = std::max(
+		bandwidth,
+		link.maxBandwidth * kBandwidthDecay);
+	link.windowStart = now;
+	link.windowBytes = 0;
+	applyLink(dcId, link);
+}
+
+void Downloader::applyLink(MTP::DcId dcId, const DcLink &link) {
+	const auto product = link.maxBandwidth * link.minLatency;
+	const auto queries = snap(
+		int(std::ceil(kInFlightGain * product / kPartSize)),
+		kMinFileQueries,
+		kMaxFileQueries);
+	const auto sessions = snap(
+		(queries + kFileQueriesPerSession - 1) / kFileQueriesPerSession,
+		MTP::kDefaultDownloadSessionsCount,
+		MTP::kDownloadSessionsCount);
+	if (link.sessionsCount != sessions) {
+		DEBUG_LOG(("Download Info: dc %1 sessions %2, queries limit %3."
+			).arg(dcId
+			).arg(sessions
+			).arg(queries));
+	}
+	_links[dcId].sessionsCount = sessions;
+	queueForDc(dcId)->queriesLimit = queries;
+}
+
 void Downloader::killDownloadSessionsStart(MTP::DcId dcId) {
 	if (!_killDownloadSessionTimes.contains(dcId)) {
 		_killDownloadSessionTimes.emplace(
@@ -113,7 +235,11 @@ int Downloader::chooseDcIndexForRequest(MTP::DcId dcId) const {
 	auto result = 0;
 	auto it = _requestedBytesAmount.find(dcId);
 	if (it != _requestedBytesAmount.cend()) {
-		for (auto i = 1; i != MTP::kDownloadSessionsCount; ++i) {
+		const auto link = _links.find(dcId);
+		const auto count = (link != end(_links))
+			? link->second.sessionsCount
+			: MTP::kDefaultDownloadSessionsCount;
+		for (auto i = 1; i != count; ++i) {
 			if (it->second[i] < it->second[result]) {
 				result = i;
 			}
@@ -126,7 +252,7 @@ not_null<Downloader::Queue*> Downloader::queueForDc(MTP::DcId dcId) {
 	const auto i = _queuesForDc.find(dcId);
 	const auto result = (i != end(_queuesForDc))
 		? i
-		: _queuesForDc.emplace(dcId, Queue(kMaxFileQueries)).first;
+		: _queuesForDc.emplace(dcId, Queue(kMinFileQueries)).first;
 	return &result->second;
 }
 
@@ -149,6 +275,23 @@ WebLoadManager *webLoadManager() {
 }
 WebLoadMainManager *_webLoadMainManager = nullptr;
 
+QImage ReadShrinkedImage(
+		const QByteArray &data,
+		QByteArray *format,
+		const QSize &shrinkBox) {
+	auto image = App::readImage(data, format, false, nullptr, shrinkBox);
+	if (!image.isNull()
+		&& !shrinkBox.isEmpty()
+		&& (image.width() > shrinkBox.width()
+			|| image.height() > shrinkBox.height())) {
+		return image.scaled(
+			shrinkBox,
+			Qt::KeepAspectRatio,
+			Qt::SmoothTransformation);
+	}
+	return image;
+}
+
 } // namespace
 
 FileLoader::FileLoader(
@@ -163,7 +306,6 @@ FileLoader::FileLoader(
 , _autoLoading(autoLoading)
 , _cacheTag(cacheTag)
 , _filename(toFile)
-, _file(_filename)
 , _toCache(toCache)
 , _fromCloud(fromCloud)
 , _size(size)
@@ -174,52 +316,83 @@ FileLoader::FileLoader(
 void FileLoader::finishWithBytes(const QByteArray &data) {
 	_data = data;
 	_localStatus = LocalStatus::Loaded;
-	if (!_filename.isEmpty() && _toCache == LoadToCacheAsWell) {
-		if (!_fileIsOpen) _fileIsOpen = _file.open(QIODevice::WriteOnly);
-		if (!_fileIsOpen) {
-			cancel(true);
-			return;
-		}
-		_file.seek(0);
-		if (_file.write(_data) != qint64(_data.size())) {
-			cancel(true);
-			return;
-		}
+	const auto toFile = (_writer != nullptr)
+		|| (!_filename.isEmpty() && _toCache == LoadToCacheAsWell);
+	if (_writer) {
+		finishWriter();
+	} else if (toFile && !writeWholeFile()) {
+		cancel(true);
+		return;
 	}
 
 	_finished = true;
-	if (_fileIsOpen) {
-		_file.close();
-		_fileIsOpen = false;
+	if (toFile) {
 		Platform::File::PostprocessDownloaded(
-			QFileInfo(_file).absoluteFilePath());
+			QFileInfo(_filename).absoluteFilePath());
 	}
 	_downloader->taskFinished().notify();
 }
 
 QByteArray FileLoader::imageFormat(const QSize &shrinkBox) const {
-	if (_imageFormat.isEmpty() && _locationType == UnknownFileLocation) {
+	if (!imageDecoded()) {
 		readImage(shrinkBox);
 	}
 	return _imageFormat;
 }
 
 QImage FileLoader::imageData(const QSize &shrinkBox) const {
-	if (_imageData.isNull() && _locationType == UnknownFileLocation) {
+	if (!imageDecoded()) {
 		readImage(shrinkBox);
 	}
 	return _imageData;
 }
 
+bool FileLoader::imageDecoded() const {
+	return _imageDecoded || (_locationType != UnknownFileLocation);
+}
+
+void FileLoader::decodeImageAsync(const QSize &shrinkBox) {
+	Expects(_finished);
+
+	if (imageDecoded() || _imageDecoding) {
+		return;
+	}
+	crl::async([
+		=,
+		data = _data,
+		guard = _imageDecoding.make_guard()
+	]() mutable {
+		auto format = QByteArray();
+		auto image = ReadShrinkedImage(data, &format, shrinkBox);
+		crl::on_main(std::move(guard), [
+			=,
+			image = std::move(image),
+			format = std::move(format)
+		]() mutable {
+			_imageDecoded = true;
+			if (!image.isNull()) {
+				_imageData = std::move(image);
+				_imageFormat = std::move(format);
+			}
+			_downloader->taskFinished().notify();
+		});
+	});
+}
+
+int FileLoader::progressiveScans() const {
+	return _finished ? 0 : _progressive.scans();
+}
+
+QByteArray FileLoader::progressiveBytes() const {
+	return _finished ? QByteArray() : _data.left(_progressive.scansSize());
+}
+
 void FileLoader::readImage(const QSize &shrinkBox) const {
+	_imageDecoded = true;
 	auto format = QByteArray();
-	auto image = App::readImage(_data, &format, false);
+	auto image = ReadShrinkedImage(_data, &format, shrinkBox);
 	if (!image.isNull()) {
-		if (!shrinkBox.isEmpty() && (image.width() > shrinkBox.width() || image.height() > shrinkBox.height())) {
-			_imageData = image.scaled(shrinkBox, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-		} else {
-			_imageData = std::move(image);
-		}
+		_imageData = std::move(image);
 		_imageFormat = format;
 	}
 }
@@ -243,7 +416,6 @@ bool FileLoader::setFileName(const QString &fileName) {
 		return fileName.isEmpty() || (fileName == _filename);
 	}
 	_filename = fileName;
-	_file.setFileName(_filename);
 	return true;
 }
 
@@ -257,18 +429,27 @@ void FileLoader::notifyAboutProgress() {
 	LoadNextFromQueue(queue);
 }
 
+void FileLoader::stopAutoLoading() {
+	_autoLoading = false;
+}
+
 void FileLoader::LoadNextFromQueue(not_null<Queue*> queue) {
-	if (queue->queriesCount >= queue->queriesLimit) {
-		return;
-	}
-	for (auto i = queue->start; i;) {
-		if (i->loadPart()) {
-			if (queue->queriesCount >= queue->queriesLimit) {
-				return;
+	// The files the user asked for take the free parts first,
+	// then the automatic loads, each in the queue order.
+	const auto fill = [&](bool autoLoading) {
+		for (auto i = queue->start; i;) {
+			if (i->_autoLoading == autoLoading && i->loadPart()) {
+				if (queue->queriesCount >= queue->queriesLimit) {
+					return false;
+				}
+			} else {
+				i = i->_next;
 			}
-		} else {
-			i = i->_next;
 		}
+		return true;
+	};
+	if (queue->queriesCount < queue->queriesLimit && fill(false)) {
+		fill(true);
 	}
 }
 
@@ -305,6 +486,7 @@ void FileLoader::localLoaded(
 		return;
 	}
 	if (!imageData.isNull()) {
+		_imageDecoded = true;
 		_imageFormat = imageFormat;
 		_imageData = imageData;
 	}
@@ -320,10 +502,9 @@ void FileLoader::start() {
 		return;
 	}
 
-	if (!_filename.isEmpty() && _toCache == LoadToFileOnly && !_fileIsOpen) {
-		_fileIsOpen = _file.open(QIODevice::WriteOnly);
-		if (!_fileIsOpen) {
-			return cancel(true);
+	if (!_filename.isEmpty() && _toCache == LoadToFileOnly && !_writer) {
+		if (!openFileToResume()) {
+			openWriter(false, 0);
 		}
 	}
 
@@ -411,7 +592,7 @@ void FileLoader::loadLocal(const Storage::Cache::Key &key) {
 				std::move(image));
 		});
 	};
-	Auth().data().cache().get(key, [=, callback = std::move(done)](
+	auto read = [=, callback = std::move(done)](
 			QByteArray &&value) mutable {
 		if (readImage) {
 			crl::async([
@@ -432,9 +613,26 @@ void FileLoader::loadLocal(const Storage::Cache::Key &key) {
 		} else {
 			callback(std::move(value), {}, {});
 		}
+	};
+	const auto fromShared = shared();
+	Auth().data().cache().get(key, [=, read = std::move(read)](
+			QByteArray &&value) mutable {
+		if (!value.isEmpty() || !fromShared) {
+			read(std::move(value));
+			return;
+		}
+		crl::async([=, read = std::move(read)]() mutable {
+			read(Storage::ReadShared(key));
+		});
 	});
 }
 
+bool FileLoader::shared() const {
+	// Stickers are public, so instances with different accounts can share.
+	return (_cacheTag == Data::kStickerCacheTag)
+		&& Storage::SharedCacheEnabled();
+}
+
 bool FileLoader::tryLoadLocal() {
 	if (_localStatus == LocalStatus::NotFound
 		|| _localStatus == LocalStatus::Loaded) {
@@ -469,10 +667,14 @@ void FileLoader::cancel(bool fail) {
 	cancelRequests();
 	_cancelled = true;
 	_finished = true;
-	if (_fileIsOpen) {
-		_file.close();
-		_fileIsOpen = false;
-		_file.remove();
+	if (_writer) {
+		finishWriter();
+		if (fail && !_partsLoaded.isEmpty()) {
+			saveResumeState();
+		} else {
+			QFile::remove(_filename);
+			removeResumeState();
+		}
 	}
 	_data = QByteArray();
 	removeFromQueue();
@@ -486,7 +688,6 @@ void FileLoader::cancel(bool fail) {
 	}
 	if (weak) {
 		_filename = QString();
-		_file.setFileName(_filename);
 	}
 	LoadNextFromQueue(queue);
 }
@@ -499,7 +700,7 @@ void FileLoader::startLoading() {
 }
 
 int FileLoader::currentOffset() const {
-	return (_fileIsOpen ? _file.size() : _data.size()) - _skippedBytes;
+	return int(_writer ? _writer->size() : _data.size()) - _skippedBytes;
 }
 
 bool FileLoader::writeResultPart(int offset, bytes::const_span buffer) {
@@ -508,18 +709,16 @@ bool FileLoader::writeResultPart(int offset, bytes::const_span buffer) {
 	if (buffer.empty()) {
 		return true;
 	}
-	if (_fileIsOpen) {
-		auto fsize = _file.size();
+	if (_writer) {
+		const auto fsize = int(_writer->size());
 		if (offset < fsize) {
 			_skippedBytes -= buffer.size();
 		} else if (offset > fsize) {
 			_skippedBytes += offset - fsize;
 		}
-		_file.seek(offset);
-		if (_file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size()) != qint64(buffer.size())) {
-			cancel(true);
-			return false;
-		}
+		_writer->write(offset, QByteArray(
+			reinterpret_cast<const char*>(buffer.data()),
+			buffer.size()));
 		return true;
 	}
 	_data.reserve(offset + buffer.size());
@@ -539,26 +738,31 @@ bool FileLoader::writeResultPart(int offset, bytes::const_span buffer) {
 			buffer.size());
 		bytes::copy(dst, buffer);
 	}
+	extendLoadedPrefix(offset, buffer.size());
 	return true;
 }
 
+void FileLoader::extendLoadedPrefix(int offset, int size) {
+	if (offset > _loadedPrefix) {
+		_loadedAfterPrefix.emplace(offset, size);
+		return;
+	}
+	_loadedPrefix = std::max(_loadedPrefix, offset + size);
+	auto i = _loadedAfterPrefix.begin();
+	while (i != _loadedAfterPrefix.end() && i->first <= _loadedPrefix) {
+		_loadedPrefix = std::max(_loadedPrefix, i->first + i->second);
+		i = _loadedAfterPrefix.erase(i);
+	}
+	if (_locationType == UnknownFileLocation) {
+		_progressive.feed(_data, _loadedPrefix);
+	}
+}
+
 QByteArray FileLoader::readLoadedPartBack(int offset, int size) {
 	Expects(offset >= 0 && size > 0);
 
-	if (_fileIsOpen) {
-		if (_file.openMode() == QIODevice::WriteOnly) {
-			_file.close();
-			_fileIsOpen = _file.open(QIODevice::ReadWrite);
-			if (!_fileIsOpen) {
-				cancel(true);
-				return QByteArray();
-			}
-		}
-		if (!_file.seek(offset)) {
-			return QByteArray();
-		}
-		auto result = _file.read(size);
-		return (result.size() == size) ? result : QByteArray();
+	if (_writer) {
+		return _writer->read(offset, size);
 	}
 	return (offset + size <= _data.size())
 		? _data.mid(offset, size)
@@ -568,23 +772,28 @@ QByteArray FileLoader::readLoadedPartBack(int offset, int size) {
 bool FileLoader::finalizeResult() {
 	Expects(!_finished);
 
-	if (!_filename.isEmpty() && (_toCache == LoadToCacheAsWell)) {
-		if (!_fileIsOpen) {
-			_fileIsOpen = _file.open(QIODevice::WriteOnly);
-		}
-		_file.seek(0);
-		if (!_fileIsOpen || _file.write(_data) != qint64(_data.size())) {
+	const auto toFile = (_writer != nullptr)
+		|| (!_filename.isEmpty() && _toCache == LoadToCacheAsWell);
+	if (_writer) {
+		// The file is used right after the load is finished,
+		// so here we wait for the last parts to be written.
+		if (!_writer->finish()) {
 			cancel(true);
 			return false;
 		}
+		_writer = nullptr;
+	} else if (toFile && !writeWholeFile()) {
+		cancel(true);
+		return false;
 	}
 
 	_finished = true;
-	if (_fileIsOpen) {
-		_file.close();
-		_fileIsOpen = false;
+	if (toFile) {
+		if (!_partsLoaded.isEmpty()) {
+			removeResumeState();
+		}
 		Platform::File::PostprocessDownloaded(
-			QFileInfo(_file).absoluteFilePath());
+			QFileInfo(_filename).absoluteFilePath());
 	}
 	removeFromQueue();
 
@@ -601,12 +810,154 @@ bool FileLoader::finalizeResult() {
 				Storage::Cache::Database::TaggedValue(
 					base::duplicate(_data),
 					_cacheTag));
+			if (shared()) {
+				crl::async([key = cacheKey(), data = _data] {
+					Storage::WriteShared(key, data);
+				});
+			}
 		}
 	}
 	_downloader->taskFinished().notify();
 	return true;
 }
 
+bool FileLoader::partLoadedBefore(int offset) const {
+	const auto index = offset / Storage::kPartSize;
+	return (index / 8 < _partsLoaded.size())
+		&& (uchar(_partsLoaded[index / 8]) & (1 << (index % 8)));
+}
+
+void FileLoader::openWriter(bool resume, int64 existingSize) {
+	const auto preallocateSize = (_size >= kPreallocateMinSize) ? _size : 0;
+	_writer = std::make_unique<Storage::FileWriter>(
+		_filename,
+		(resume
+			? Storage::FileWriter::Mode::Resume
+			: Storage::FileWriter::Mode::Create),
+		existingSize,
+		preallocateSize,
+		[=](std::vector<int> &&offsets) {
+			for (const auto offset : offsets) {
+				markPartLoaded(offset);
+			}
+		},
+		[=] { cancel(true); });
+}
+
+bool FileLoader::finishWriter() {
+	Expects(_writer != nullptr);
+
+	const auto result = _writer->finish();
+	_writer = nullptr;
+	return result;
+}
+
+bool FileLoader::writeWholeFile() {
+	QFile file(_filename);
+	return file.open(QIODevice::WriteOnly)
+		&& (file.write(_data) == qint64(_data.size()));
+}
+
+QString FileLoader::resumePath() const {
+	return _filename + qstr(".parts");
+}
+
+bool FileLoader::openFileToResume() {
+	_partsLoaded = QByteArray();
+	_partsUnsaved = 0;
+	if (!resumable() || _size < kResumableMinSize) {
+		return false;
+	}
+	const auto key = fileLocationKey();
+	if (!key) {
+		return false;
+	}
+	const auto partsCount = (_size + Storage::kPartSize - 1)
+		/ Storage::kPartSize;
+	const auto bitmapSize = (partsCount + 7) / 8;
+	const auto startNew = [&] {
+		removeResumeState();
+		_partsLoaded = QByteArray(bitmapSize, char(0));
+		return false;
+	};
+
+	QFile parts(resumePath());
+	if (!parts.open(QIODevice::ReadOnly)) {
+		return startNew();
+	}
+	auto magic = quint32();
+	auto first = quint64();
+	auto second = quint64();
+	auto size = qint32();
+	auto loaded = QByteArray();
+	QDataStream stream(&parts);
+	stream.setVersion(QDataStream::Qt_5_1);
+	stream >> magic >> first >> second >> size >> loaded;
+	parts.close();
+	if (stream.status() != QDataStream::Ok
+		|| magic != kResumeMagic
+		|| MediaKey(first, second) != *key
+		|| size != _size
+		|| loaded.size() != bitmapSize
+		|| !QFile::exists(_filename)) {
+		return startNew();
+	}
+	auto loadedBytes = int64();
+	for (auto i = 0; i != partsCount; ++i) {
+		if (uchar(loaded[i / 8]) & (1 << (i % 8))) {
+			loadedBytes += std::min(
+				Storage::kPartSize,
+				_size - i * Storage::kPartSize);
+		}
+	}
+	if (!loadedBytes || loadedBytes >= _size) {
+		return startNew();
+	}
+	const auto existingSize = QFileInfo(_filename).size();
+	_partsLoaded = loaded;
+	_skippedBytes = int(existingSize - loadedBytes);
+	openWriter(true, existingSize);
+	return true;
+}
+
+void FileLoader::markPartLoaded(int offset) {
+	if (_partsLoaded.isEmpty()) {
+		return;
+	}
+	const auto index = offset / Storage::kPartSize;
+	Assert(index / 8 < _partsLoaded.size());
+	_partsLoaded[index / 8] = char(
+		uchar(_partsLoaded[index / 8]) | (1 << (index % 8)));
+	if (++_partsUnsaved >= kResumeSaveEachParts) {
+		saveResumeState();
+	}
+}
+
+void FileLoader::saveResumeState() {
+	const auto key = fileLocationKey();
+	if (!key) {
+		return;
+	}
+	// The parts are marked as loaded only when they are on disk.
+	_partsUnsaved = 0;
+	QFile parts(resumePath());
+	if (!parts.open(QIODevice::WriteOnly)) {
+		return;
+	}
+	QDataStream stream(&parts);
+	stream.setVersion(QDataStream::Qt_5_1);
+	stream
+		<< kResumeMagic
+		<< quint64(key->first)
+		<< quint64(key->second)
+		<< qint32(_size)
+		<< _partsLoaded;
+}
+
+void FileLoader::removeResumeState() {
+	QFile::remove(resumePath());
+}
+
 mtpFileLoader::mtpFileLoader(
 	const StorageFileLocation &location,
 	Data::FileOrigin origin,
@@ -695,11 +1046,22 @@ void mtpFileLoader::refreshFileReferenceFrom(
 	makeRequest(offset);
 }
 
+void mtpFileLoader::skipLoadedParts() {
+	while (_size
+		&& _nextRequestOffset < _size
+		&& partLoadedBefore(_nextRequestOffset)) {
+		_nextRequestOffset += Storage::kPartSize;
+	}
+}
+
 bool mtpFileLoader::loadPart() {
+	skipLoadedParts();
 	if (_finished || _lastComplete || (!_sentRequests.empty() && !_size)) {
 		return false;
 	} else if (_size && _nextRequestOffset >= _size) {
 		return false;
+	} else if (_autoLoading && !_downloader->autoLoadingAllowed(_queue)) {
+		return false;
 	}
 
 	makeRequest(_nextRequestOffset);
@@ -825,11 +1187,16 @@ void mtpFileLoader::normalPartLoaded(
 	Expects(!_finished);
 	Expects(result.type() == mtpc_upload_fileCdnRedirect || result.type() == mtpc_upload_file);
 
-	auto offset = finishSentRequestGetOffset(requestId);
+	const auto requestData = finishSentRequest(requestId);
+	const auto offset = requestData.offset;
 	if (result.type() == mtpc_upload_fileCdnRedirect) {
 		return switchToCDN(offset, result.c_upload_fileCdnRedirect());
 	}
 	auto buffer = bytes::make_span(result.c_upload_file().vbytes.v);
+	_downloader->partLoaded(
+		requestData.dcId,
+		int(buffer.size()),
+		crl::now() - requestData.sent);
 	return partLoaded(offset, buffer);
 }
 
@@ -855,7 +1222,8 @@ void mtpFileLoader::webPartLoaded(
 void mtpFileLoader::cdnPartLoaded(const MTPupload_CdnFile &result, mtpRequestId requestId) {
 	Expects(!_finished);
 
-	const auto offset = finishSentRequestGetOffset(requestId);
+	const auto sent = finishSentRequest(requestId);
+	const auto offset = sent.offset;
 	result.match([&](const MTPDupload_cdnFileReuploadNeeded &data) {
 		auto requestData = RequestData();
 		requestData.dcId = dcId();
@@ -873,8 +1241,13 @@ void mtpFileLoader::cdnPartLoaded(const MTPupload_CdnFile &result, mtpRequestId
 			shiftedDcId);
 		placeSentRequest(requestId, requestData);
 	}, [&](const MTPDupload_cdnFile &data) {
-		auto key = bytes::make_span(_cdnEncryptionKey);
-		auto iv = bytes::make_span(_cdnEncryptionIV);
+		_downloader->partLoaded(
+			sent.dcId,
+			data.vbytes.v.size(),
+			crl::now() - sent.sent);
+
+		const auto key = _cdnEncryptionKey;
+		const auto iv = bytes::make_span(_cdnEncryptionIV);
 		Expects(key.size() == MTP::CTRState::KeySize);
 		Expects(iv.size() == MTP::CTRState::IvecSize);
 
@@ -888,27 +1261,63 @@ void mtpFileLoader::cdnPartLoaded(const MTPupload_CdnFile &result, mtpRequestId
 		state.ivec[13] = static_cast<uchar>((counterOffset >> 16) & 0xFF);
 		state.ivec[12] = static_cast<uchar>((counterOffset >> 24) & 0xFF);
 
-		auto decryptInPlace = data.vbytes.v;
-		auto buffer = bytes::make_detached_span(decryptInPlace);
-		MTP::aesCtrEncrypt(buffer, key.data(), &state);
+		// Decryption and hashing of a part take a while for large files,
+		// so they're done in the background while other parts are loaded.
+		const auto hashIt = _cdnFileHashes.find(offset);
+		const auto hash = (hashIt != _cdnFileHashes.end())
+			? hashIt->second.hash
+			: QByteArray();
+		crl::async([
+			=,
+			decryptInPlace = data.vbytes.v,
+			guard = _cdnDecryptingParts[offset].make_guard()
+		]() mutable {
+			auto buffer = bytes::make_detached_span(decryptInPlace);
+			MTP::aesCtrEncrypt(buffer, key.constData(), &state);
+			const auto result = hash.isEmpty()
+				? CheckCdnHashResult::NoHash
+				: bytes::compare(openssl::Sha256(buffer), bytes::make_span(hash))
+				? CheckCdnHashResult::Invalid
+				: CheckCdnHashResult::Good;
+			crl::on_main(std::move(guard), [
+				=,
+				decryptInPlace = std::move(decryptInPlace)
+			]() mutable {
+				cdnPartDecrypted(offset, result, std::move(decryptInPlace));
+			});
+		});
+	});
+}
 
-		switch (checkCdnFileHash(offset, buffer)) {
-		case CheckCdnHashResult::NoHash: {
-			_cdnUncheckedParts.emplace(offset, decryptInPlace);
-			requestMoreCdnFileHashes();
-		} return;
+void mtpFileLoader::cdnPartDecrypted(
+		int offset,
+		CheckCdnHashResult result,
+		QByteArray &&decrypted) {
+	Expects(!_finished);
 
-		case CheckCdnHashResult::Invalid: {
-			LOG(("API Error: Wrong cdnFileHash for offset %1.").arg(offset));
-			cancel(true);
-		} return;
+	_cdnDecryptingParts.erase(offset);
 
-		case CheckCdnHashResult::Good: {
-			partLoaded(offset, buffer);
-		} return;
-		}
-		Unexpected("Result of checkCdnFileHash()");
-	});
+	auto buffer = bytes::make_span(decrypted);
+	if (result == CheckCdnHashResult::NoHash) {
+		// The hashes could've been received while we were decrypting.
+		result = checkCdnFileHash(offset, buffer);
+	}
+	switch (result) {
+	case CheckCdnHashResult::NoHash: {
+		_cdnUncheckedParts.emplace(offset, std::move(decrypted));
+		requestMoreCdnFileHashes();
+	} return;
+
+	case CheckCdnHashResult::Invalid: {
+		LOG(("API Error: Wrong cdnFileHash for offset %1.").arg(offset));
+		cancel(true);
+	} return;
+
+	case CheckCdnHashResult::Good: {
+		partLoaded(offset, buffer);
+	} return;
+	}
+	Unexpected("Result of checkCdnFileHash()");
 }
 
 mtpFileLoader::CheckCdnHashResult mtpFileLoader::checkCdnFileHash(
@@ -1003,10 +1412,18 @@ void mtpFileLoader::placeSentRequest(
 		requestData.dcIndex,
 		Storage::kPartSize);
 	++_queue->queriesCount;
-	_sentRequests.emplace(requestId, requestData);
+	if (_autoLoading) {
+		++_queue->autoQueriesCount;
+		_downloader->autoLoadingRequested(Storage::kPartSize);
+	}
+	auto sent = requestData;
+	sent.sent = crl::now();
+	sent.autoLoading = _autoLoading;
+	_sentRequests.emplace(requestId, sent);
 }
 
-int mtpFileLoader::finishSentRequestGetOffset(mtpRequestId requestId) {
+auto mtpFileLoader::finishSentRequest(mtpRequestId requestId)
+-> RequestData {
 	auto it = _sentRequests.find(requestId);
 	Assert(it != _sentRequests.cend());
 
@@ -1017,9 +1434,16 @@ int mtpFileLoader::finishSentRequestGetOffset(mtpRequestId requestId) {
 		-Storage::kPartSize);
 
 	--_queue->queriesCount;
+	if (requestData.autoLoading) {
+		--_queue->autoQueriesCount;
+	}
 	_sentRequests.erase(it);
 
-	return requestData.offset;
+	return requestData;
+}
+
+int mtpFileLoader::finishSentRequestGetOffset(mtpRequestId requestId) {
+	return finishSentRequest(requestId).offset;
 }
 
 bool mtpFileLoader::feedPart(int offset, bytes::const_span buffer) {
@@ -1029,8 +1453,10 @@ bool mtpFileLoader::feedPart(int offset, bytes::const_span buffer) {
 	if (buffer.empty() || (buffer.size() % 1024)) { // bad next offset
 		_lastComplete = true;
 	}
+	skipLoadedParts();
 	const auto finished = _sentRequests.empty()
 		&& _cdnUncheckedParts.empty()
+		&& _cdnDecryptingParts.empty()
 		&& (_lastComplete || (_size && _nextRequestOffset >= _size));
 	if (finished && !finalizeResult()) {
 		return false;
@@ -1105,6 +1531,7 @@ void mtpFileLoader::cancelRequests() {
 		MTP::cancel(requestId);
 		finishSentRequestGetOffset(requestId);
 	}
+	_cdnDecryptingParts.clear();
 }
 
 void mtpFileLoader::switchToCDN(
@@ -1180,6 +1607,10 @@ Storage::Cache::Key mtpFileLoader::cacheKey() const {
 	});
 }
 
+bool mtpFileLoader::resumable() const {
+	return base::get_if<StorageFileLocation>(&_location) != nullptr;
+}
+
 std::optional<MediaKey> mtpFileLoader::fileLocationKey() const {
 	if (_locationType != UnknownFileLocation) {
 		return mediaKey(_locationType, dcId(), objId());
@@ -1272,6 +1703,7 @@ public:
 	webFileLoaderPrivate(webFileLoader *loader, const QString &url)
 		: _interface(loader)
 		, _url(url)
+		, _host(_url.host())
 		, _redirectsLeft(kMaxHttpRedirects) {
 	}
 
@@ -1285,6 +1717,9 @@ public:
 		QNetworkRequest req(_url);
 		QByteArray rangeHeaderValue = "bytes=" + QByteArray::number(_already) + "-";
 		req.setRawHeader("Range", rangeHeaderValue);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+		req.setAttribute(QNetworkRequest::HTTP2AllowedAttribute, true);
+#endif // Qt >= 5.8.0
 		_reply = manager.get(req);
 		return _reply;
 	}
@@ -1323,6 +1758,8 @@ private:
 
 	webFileLoader *_interface = nullptr;
 	QUrl _url;
+	QString _host;
+	bool _started = false;
 	qint64 _already = 0;
 	qint64 _size = 0;
 	QNetworkReply *_reply = nullptr;
@@ -1430,8 +1867,7 @@ void WebLoadManager::onFailed(QNetworkReply *reply) {
 	LOG(("Network Error: Failed to request '%1', error %2 (%3)").arg(QString::fromLatin1(loader->_url.toEncoded())).arg(int(reply->error())).arg(reply->errorString()));
 
 	if (!handleReplyResult(loader, WebReplyProcessError)) {
-		_loaders.remove(loader);
-		delete loader;
+		removeLoader(loader);
 	}
 }
 
@@ -1477,8 +1913,7 @@ void WebLoadManager::onProgress(qint64 already, qint64 size) {
 	}
 	if (!handleReplyResult(loader, result)) {
 		_replies.erase(j);
-		_loaders.remove(loader);
-		delete loader;
+		removeLoader(loader);
 
 		reply->abort();
 		reply->deleteLater();
@@ -1503,8 +1938,7 @@ void WebLoadManager::onMeta() {
 				loader->setProgress(qMax(qint64(loader->data().size()), loader->already()), m.captured(1).toLongLong());
 				if (!handleReplyResult(loader, WebReplyProcessProgress)) {
 					_replies.erase(j);
-					_loaders.remove(loader);
-					delete loader;
+					removeLoader(loader);
 
 					reply->abort();
 					reply->deleteLater();
@@ -1539,6 +1973,7 @@ void WebLoadManager::process() {
 					reply->abort();
 					reply->deleteLater();
 				}
+				forgetLoader(*i);
 				delete (*i);
 				i = _loaders.erase(i);
 			} else {
@@ -1548,9 +1983,48 @@ void WebLoadManager::process() {
 	}
 	for_const (webFileLoaderPrivate *loader, newLoaders) {
 		if (_loaders.contains(loader)) {
-			sendRequest(loader);
+			_queued.push_back(loader);
 		}
 	}
+	sendQueued();
+}
+
+void WebLoadManager::sendQueued() {
+	for (auto i = _queued.begin(); i != _queued.end();) {
+		const auto loader = *i;
+		auto &requests = _requestsByHost[loader->_host];
+		if (requests >= kMaxWebFileQueriesPerHost) {
+			++i;
+			continue;
+		}
+		++requests;
+		loader->_started = true;
+		i = _queued.erase(i);
+		sendRequest(loader);
+	}
+}
+
+void WebLoadManager::forgetLoader(webFileLoaderPrivate *loader) {
+	if (!loader->_started) {
+		_queued.erase(
+			ranges::remove(_queued, loader),
+			end(_queued));
+		return;
+	}
+	const auto i = _requestsByHost.find(loader->_host);
+	Assert(i != end(_requestsByHost) && i->second > 0);
+	if (!--i->second) {
+		_requestsByHost.erase(i);
+	}
+}
+
+void WebLoadManager::removeLoader(webFileLoaderPrivate *loader) {
+	forgetLoader(loader);
+	_loaders.remove(loader);
+	delete loader;
+
+	// Let the next queued loader from the same host start.
+	emit processDelayed();
 }
 
 void WebLoadManager::sendRequest(webFileLoaderPrivate *loader, const QString &redirect) {
@@ -1590,6 +2064,8 @@ void WebLoadManager::clear() {
 		delete loader;
 	}
 	_loaders.clear();
+	_queued.clear();
+	_requestsByHost.clear();
 
 	for (auto i = _replies.begin(), e = _replies.end(); i != e; ++i) {
 		delete i.key();
@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/timer.h"
 #include "base/binary_guard.h"
 #include "data/data_file_origin.h"
+#include "storage/storage_progressive_jpeg.h"
 
 class ApiWrap;
 
@@ -19,6 +20,8 @@ namespace Cache {
 struct Key;
 } // namespace Cache
 
+class FileWriter;
+
 constexpr auto kMaxFileInMemory = 10 * 1024 * 1024; // 10 MB max file could be hold in memory
 constexpr auto kMaxVoiceInMemory = 2 * 1024 * 1024; // 2 MB audio is hold in memory and auto loaded
 constexpr auto kMaxStickerInMemory = 2 * 1024 * 1024; // 2 MB stickers hold in memory, auto loaded and displayed inline
@@ -33,6 +36,7 @@ public:
 		}
 		int queriesCount = 0;
 		int queriesLimit = 0;
+		int autoQueriesCount = 0;
 		FileLoader *start = nullptr;
 		FileLoader *end = nullptr;
 	};
@@ -56,13 +60,32 @@ public:
 	void requestedAmountIncrement(MTP::DcId dcId, int index, int amount);
 	int chooseDcIndexForRequest(MTP::DcId dcId) const;
 
+	// Adapts sessions count and parallel parts to the measured link.
+	void partLoaded(MTP::DcId dcId, int bytes, crl::time latency);
+
 	not_null<Queue*> queueForDc(MTP::DcId dcId);
 	not_null<Queue*> queueForWeb();
 
+	// Automatic loads get only a share of the queries and a bytes budget,
+	// so the files the user asked for don't wait behind them.
+	[[nodiscard]] bool autoLoadingAllowed(not_null<const Queue*> queue) const;
+	void autoLoadingRequested(int bytes);
+
 private:
+	struct DcLink {
+		int sessionsCount = MTP::kDefaultDownloadSessionsCount;
+		crl::time minLatency = 0;
+		crl::time minLatencyReset = 0;
+		float64 maxBandwidth = 0.; // Bytes per millisecond.
+		crl::time windowStart = 0;
+		int64 windowBytes = 0;
+	};
+
+	void applyLink(MTP::DcId dcId, const DcLink &link);
 	void killDownloadSessionsStart(MTP::DcId dcId);
 	void killDownloadSessionsStop(MTP::DcId dcId);
 	void killDownloadSessions();
+	void autoLoadingBudgetRestored();
 
 	not_null<ApiWrap*> _api;
 
@@ -71,10 +94,15 @@ private:
 
 	using RequestedInDc = std::array<int64, MTP::kDownloadSessionsCount>;
 	std::map<MTP::DcId, RequestedInDc> _requestedBytesAmount;
+	std::map<MTP::DcId, DcLink> _links;
 
 	base::flat_map<MTP::DcId, crl::time> _killDownloadSessionTimes;
 	base::Timer _killDownloadSessionsTimer;
 
+	crl::time _autoLoadingWindowStart = 0;
+	int64 _autoLoadingWindowBytes = 0;
+	base::Timer _autoLoadingTimer;
+
 	std::map<MTP::DcId, Queue> _queuesForDc;
 	Queue _queueForWeb;
 
@@ -122,6 +150,17 @@ public:
 	}
 	QByteArray imageFormat(const QSize &shrinkBox = QSize()) const;
 	QImage imageData(const QSize &shrinkBox = QSize()) const;
+
+	// After the decoding is finished the downloader notifies and
+	// imageData() returns the decoded image without blocking.
+	bool imageDecoded() const;
+	void decodeImageAsync(const QSize &shrinkBox = QSize());
+
+	// While a progressive jpeg is loading its complete scans can be
+	// decoded to show a coarse image that is refined with each scan.
+	int progressiveScans() const;
+	QByteArray progressiveBytes() const;
+
 	QString fileName() const {
 		return _filename;
 	}
@@ -133,6 +172,9 @@ public:
 	bool setFileName(const QString &filename); // set filename for loaders to cache
 	void permitLoadFromCloud();
 
+	// The user asked for the file, it goes before the automatic loads.
+	void stopAutoLoading();
+
 	void start();
 	void cancel();
 
@@ -149,6 +191,8 @@ public:
 		return _autoLoading;
 	}
 
+	static void LoadNextFromQueue(not_null<Queue*> queue);
+
 	virtual void stop() {
 	}
 	virtual ~FileLoader();
@@ -176,6 +220,7 @@ protected:
 
 	bool tryLoadLocal();
 	void loadLocal(const Storage::Cache::Key &key);
+	bool shared() const;
 	virtual Storage::Cache::Key cacheKey() const = 0;
 	virtual std::optional<MediaKey> fileLocationKey() const = 0;
 	virtual void cancelRequests() = 0;
@@ -185,13 +230,20 @@ protected:
 	void cancel(bool failed);
 
 	void notifyAboutProgress();
-	static void LoadNextFromQueue(not_null<Queue*> queue);
 	virtual bool loadPart() = 0;
 
 	bool writeResultPart(int offset, bytes::const_span buffer);
+	void extendLoadedPrefix(int offset, int size);
 	bool finalizeResult();
 	[[nodiscard]] QByteArray readLoadedPartBack(int offset, int size);
 
+	// Large files loaded to disk keep the list of their loaded parts in
+	// a file next to them, so a failed or interrupted load is resumed.
+	virtual bool resumable() const {
+		return false;
+	}
+	[[nodiscard]] bool partLoadedBefore(int offset) const;
+
 	not_null<Storage::Downloader*> _downloader;
 	FileLoader *_prev = nullptr;
 	FileLoader *_next = nullptr;
@@ -206,21 +258,39 @@ protected:
 	mutable LocalStatus _localStatus = LocalStatus::NotTried;
 
 	QString _filename;
-	QFile _file;
-	bool _fileIsOpen = false;
+	std::unique_ptr<Storage::FileWriter> _writer;
 
 	LoadToCacheSetting _toCache;
 	LoadFromCloudSetting _fromCloud;
 
 	QByteArray _data;
+	int _loadedPrefix = 0;
+	base::flat_map<int, int> _loadedAfterPrefix;
+	Storage::ProgressiveJpeg _progressive;
 
 	int _size = 0;
 	int _skippedBytes = 0;
 	LocationType _locationType = LocationType();
 
+	QByteArray _partsLoaded;
+	int _partsUnsaved = 0;
+
 	base::binary_guard _localLoading;
 	mutable QByteArray _imageFormat;
 	mutable QImage _imageData;
+	mutable bool _imageDecoded = false;
+	base::binary_guard _imageDecoding;
+
+private:
+	void openWriter(bool resume, int64 existingSize);
+	bool finishWriter();
+	bool writeWholeFile();
+
+	QString resumePath() const;
+	bool openFileToResume();
+	void markPartLoaded(int offset);
+	void saveResumeState();
+	void removeResumeState();
 
 };
 
@@ -270,6 +340,8 @@ private:
 		MTP::DcId dcId = 0;
 		int dcIndex = 0;
 		int offset = 0;
+		crl::time sent = 0;
+		bool autoLoading = false;
 	};
 	struct CdnFileHash {
 		CdnFileHash(int limit, QByteArray hash) : limit(limit), hash(hash) {
@@ -280,11 +352,13 @@ private:
 	Storage::Cache::Key cacheKey() const override;
 	std::optional<MediaKey> fileLocationKey() const override;
 	void cancelRequests() override;
+	bool resumable() const override;
 
 	MTP::DcId dcId() const;
 	RequestData prepareRequest(int offset) const;
 	void makeRequest(int offset);
 
+	void skipLoadedParts();
 	bool loadPart() override;
 	void normalPartLoaded(const MTPupload_File &result, mtpRequestId requestId);
 	void webPartLoaded(const MTPupload_WebFile &result, mtpRequestId requestId);
@@ -302,6 +376,7 @@ private:
 
 	mtpRequestId sendRequest(const RequestData &requestData);
 	void placeSentRequest(mtpRequestId requestId, const RequestData &requestData);
+	RequestData finishSentRequest(mtpRequestId requestId);
 	int finishSentRequestGetOffset(mtpRequestId requestId);
 	void switchToCDN(int offset, const MTPDupload_fileCdnRedirect &redirect);
 	void addCdnHashes(const QVector<MTPFileHash> &hashes);
@@ -313,6 +388,10 @@ private:
 		Good,
 	};
 	CheckCdnHashResult checkCdnFileHash(int offset, bytes::const_span buffer);
+	void cdnPartDecrypted(
+		int offset,
+		CheckCdnHashResult result,
+		QByteArray &&decrypted);
 
 	std::map<mtpRequestId, RequestData> _sentRequests;
 
@@ -332,6 +411,7 @@ private:
 	QByteArray _cdnEncryptionIV;
 	std::map<int, CdnFileHash> _cdnFileHashes;
 	std::map<int, QByteArray> _cdnUncheckedParts;
+	std::map<int, base::binary_guard> _cdnDecryptingParts;
 	mtpRequestId _cdnHashesRequestId = 0;
 
 };
@@ -411,6 +491,9 @@ public slots:
 
 private:
 	void clear();
+	void sendQueued();
+	void forgetLoader(webFileLoaderPrivate *loader);
+	void removeLoader(webFileLoaderPrivate *loader);
 	void sendRequest(webFileLoaderPrivate *loader, const QString &redirect = QString());
 	bool handleReplyResult(webFileLoaderPrivate *loader, WebReplyProcessResult result);
 
@@ -425,6 +508,9 @@ private:
 	typedef QMap<QNetworkReply*, webFileLoaderPrivate*> Replies;
 	Replies _replies;
 
+	std::deque<webFileLoaderPrivate*> _queued;
+	base::flat_map<QString, int> _requestsByHost;
+
 };
 
 class WebLoadMainManager : public QObject {
@@ -18,8 +18,28 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace Storage {
 namespace {
 
-// max 512kb uploaded at the same time in each session
-constexpr auto kMaxUploadFileParallelSize = MTP::kUploadSessionsCount * 512 * 1024;
+// At least 512kb uploaded at the same time in each session.
+constexpr auto kMinUploadFileParallelSize = MTP::kUploadSessionsCount * 512 * 1024;
+
+// Up to 16mb in flight on high bandwidth-delay links.
+constexpr auto kMaxUploadFileParallelSize = 16 * 1024 * 1024;
+
+// Keep twice the estimated bandwidth-delay product in flight.
+constexpr auto kInFlightGain = 2.;
+
+// Ack bandwidth is measured each second and the maximum decays slowly.
+constexpr auto kBandwidthWindow = crl::time(1000);
+constexpr auto kBandwidthDecay = 0.9;
+
+// Minimal ack latency is forgotten from time to time.
+constexpr auto kMinLatencyTimeout = 10 * crl::time(1000);
+
+// File parts are read from disk on a worker thread up to 4mb ahead.
+constexpr auto kReadAheadSize = 4 * 1024 * 1024;
+
+// Pages of the mapped files are touched by the worker thread,
+// so that sending the parts on the main thread doesn't wait for disk.
+constexpr auto kMappedPageSize = 4096;
 
 constexpr auto kDocumentMaxPartsCount = 3000;
 
@@ -63,9 +83,14 @@ struct Uploader::File {
 	uint64 thumbId() const;
 	const QString &filename() const;
 
-	HashMd5 md5Hash;
+	// Parts read from disk are hashed by the reading thread.
+	std::shared_ptr<HashMd5> md5Hash = std::make_shared<HashMd5>();
 
-	std::unique_ptr<QFile> docFile;
+	std::shared_ptr<QFile> docFile;
+	const uchar *docMapped = nullptr;
+	std::deque<QByteArray> docReadyParts;
+	int32 docReadParts = 0;
+	bool docReading = false;
 	int32 docSentParts = 0;
 	int32 docSize = 0;
 	int32 docPartSize = 0;
@@ -141,7 +166,8 @@ const QString &Uploader::File::filename() const {
 }
 
 Uploader::Uploader(not_null<ApiWrap*> api)
-: _api(api) {
+: _api(api)
+, _parallelSize(kMinUploadFileParallelSize) {
 	nextTimer.setSingleShot(true);
 	connect(&nextTimer, SIGNAL(timeout()), this, SLOT(sendNext()));
 	stopSessionsTimer.setSingleShot(true);
@@ -251,6 +277,7 @@ void Uploader::currentFailed() {
 	requestsSent.clear();
 	docRequestsSent.clear();
 	dcMap.clear();
+	sentTimes.clear();
 	uploadingId = FullMsgId();
 	sentSize = 0;
 	for (int i = 0; i < MTP::kUploadSessionsCount; ++i) {
@@ -267,7 +294,12 @@ void Uploader::stopSessions() {
 }
 
 void Uploader::sendNext() {
-	if (sentSize >= kMaxUploadFileParallelSize || _pausedId.msg) return;
+	while (sendNextPart()) {
+	}
+}
+
+bool Uploader::sendNextPart() {
+	if (sentSize >= _parallelSize || _pausedId.msg) return false;
 
 	bool stopping = stopSessionsTimer.isActive();
 	if (queue.empty()) {
@@ -275,7 +307,7 @@ void Uploader::sendNext() {
 			stopSessionsTimer.start(
 				MTP::kAckSendWaiting + kKillSessionTimeout);
 		}
-		return;
+		return false;
 	}
 
 	if (stopping) {
@@ -337,7 +369,7 @@ void Uploader::sendNext() {
 					|| uploadingData.type() == SendMediaType::WallPaper
 					|| uploadingData.type() == SendMediaType::Audio) {
 					QByteArray docMd5(32, Qt::Uninitialized);
-					hashMd5Hex(uploadingData.md5Hash.result(), docMd5.data());
+					hashMd5Hex(uploadingData.md5Hash->result(), docMd5.data());
 
 					const auto file = (uploadingData.docSize > kUseBigFilesFrom)
 						? MTP_inputFileBig(
@@ -382,9 +414,9 @@ void Uploader::sendNext() {
 				}
 				queue.erase(uploadingId);
 				uploadingId = FullMsgId();
-				sendNext();
+				return true;
 			}
-			return;
+			return false;
 		}
 
 		auto &content = uploadingData.file
@@ -396,16 +428,24 @@ void Uploader::sendNext() {
 				const auto filepath = uploadingData.file
 					? uploadingData.file->filepath
 					: uploadingData.media.file;
-				uploadingData.docFile = std::make_unique<QFile>(filepath);
+				uploadingData.docFile = std::make_shared<QFile>(filepath);
 				if (!uploadingData.docFile->open(QIODevice::ReadOnly)) {
 					currentFailed();
-					return;
+					return false;
+				}
+				if (uploadingData.docFile->size() == uploadingData.docSize) {
+					uploadingData.docMapped = uploadingData.docFile->map(
+						0,
+						uploadingData.docSize);
 				}
 			}
-			toSend = uploadingData.docFile->read(uploadingData.docPartSize);
-			if (uploadingData.docSize <= kUseBigFilesFrom) {
-				uploadingData.md5Hash.feed(toSend.constData(), toSend.size());
+			if (uploadingData.docReadyParts.empty()) {
+				readDocParts(uploadingData);
+				return false;
 			}
+			toSend = std::move(uploadingData.docReadyParts.front());
+			uploadingData.docReadyParts.pop_front();
+			readDocParts(uploadingData);
 		} else {
 			const auto offset = uploadingData.docSentParts
 				* uploadingData.docPartSize;
@@ -414,14 +454,14 @@ void Uploader::sendNext() {
 				|| uploadingData.type() == SendMediaType::WallPaper
 				|| uploadingData.type() == SendMediaType::Audio)
 				&& uploadingData.docSentParts <= kUseBigFilesFrom) {
-				uploadingData.md5Hash.feed(toSend.constData(), toSend.size());
+				uploadingData.md5Hash->feed(toSend.constData(), toSend.size());
 			}
 		}
 		if ((toSend.size() > uploadingData.docPartSize)
 			|| ((toSend.size() < uploadingData.docPartSize
 				&& uploadingData.docSentParts + 1 != uploadingData.docPartsCount))) {
 			currentFailed();
-			return;
+			return false;
 		}
 		mtpRequestId requestId;
 		if (uploadingData.docSize > kUseBigFilesFrom) {
@@ -446,6 +486,7 @@ void Uploader::sendNext() {
 		}
 		docRequestsSent.emplace(requestId, uploadingData.docSentParts);
 		dcMap.emplace(requestId, todc);
+		sentTimes.emplace(requestId, crl::now());
 		sentSize += uploadingData.docPartSize;
 		sentSizes[todc] += uploadingData.docPartSize;
 
@@ -463,12 +504,106 @@ void Uploader::sendNext() {
 			MTP::uploadDcId(todc));
 		requestsSent.emplace(requestId, part.value());
 		dcMap.emplace(requestId, todc);
+		sentTimes.emplace(requestId, crl::now());
 		sentSize += part.value().size();
 		sentSizes[todc] += part.value().size();
 
 		parts.erase(part);
 	}
 	nextTimer.start(kUploadRequestInterval);
+	return true;
+}
+
+void Uploader::readDocParts(File &file) {
+	const auto ready = int(file.docReadyParts.size());
+	const auto limit = std::max(kReadAheadSize / file.docPartSize, 1);
+	const auto count = std::min(
+		limit - ready,
+		file.docPartsCount - file.docReadParts);
+	if (file.docReading || count <= 0 || ready * 2 > limit) {
+		return;
+	}
+	const auto first = file.docReadParts;
+	file.docReading = true;
+	file.docReadParts += count;
+	crl::async([
+		=,
+		weak = QPointer<Uploader>(this),
+		msgId = uploadingId,
+		id = file.id(),
+		docFile = file.docFile,
+		mapped = reinterpret_cast<const char*>(file.docMapped),
+		size = file.docSize,
+		partSize = file.docPartSize,
+		md5Hash = (file.docSize <= kUseBigFilesFrom
+			? file.md5Hash
+			: nullptr)
+	] {
+		const auto readPart = [&](int index) {
+			if (!mapped) {
+				return docFile->read(partSize);
+			}
+			// The parts are views into the mapped file, they are
+			// copied only once, when the request is serialized.
+			const auto offset = index * partSize;
+			const auto length = std::min(partSize, size - offset);
+			const auto pages = reinterpret_cast<const volatile char*>(
+				mapped + offset);
+			for (auto i = 0; i < length; i += kMappedPageSize) {
+				static_cast<void>(pages[i]);
+			}
+			return QByteArray::fromRawData(mapped + offset, length);
+		};
+		auto parts = std::deque<QByteArray>();
+		for (auto i = 0; i != count; ++i) {
+			parts.push_back(readPart(first + i));
+			if (md5Hash) {
+				const auto &part = parts.back();
+				md5Hash->feed(part.constData(), part.size());
+			}
+		}
+		crl::on_main([=, parts = std::move(parts)]() mutable {
+			if (!weak) {
+				return;
+			}
+			const auto i = queue.find(msgId);
+			if (i == end(queue) || i->second.id() != id) {
+				return;
+			}
+			auto &file = i->second;
+			file.docReading = false;
+			for (auto &part : parts) {
+				file.docReadyParts.push_back(std::move(part));
+			}
+			sendNext();
+		});
+	});
+}
+
+void Uploader::updateParallelSize(int bytes, crl::time latency) {
+	const auto now = crl::now();
+	if (!_minLatency || latency < _minLatency || now >= _minLatencyReset) {
+		_minLatency = std::max(latency, crl::time(1));
+		_minLatencyReset = now + kMinLatencyTimeout;
+	}
+	if (!_windowStart) {
+		_windowStart = now - latency;
+	}
+	_windowBytes += bytes;
+	const auto elapsed = now - _windowStart;
+	if (elapsed < kBandwidthWindow) {
+		return;
+	}
+	const auto bandwidth = _windowBytes / float64(elapsed);
+	_maxBandwidth = std::max(bandwidth, _maxBandwidth * kBandwidthDecay);
+	_windowStart = now;
+	_windowBytes = 0;
+
+	const auto product = _maxBandwidth * _minLatency;
+	_parallelSize = snap(
+		uint32(std::ceil(kInFlightGain * product)),
+		uint32(kMinUploadFileParallelSize),
+		uint32(kMaxUploadFileParallelSize));
 }
 
 void Uploader::cancel(const FullMsgId &msgId) {
@@ -504,6 +639,7 @@ void Uploader::clear() {
 	}
 	docRequestsSent.clear();
 	dcMap.clear();
+	sentTimes.clear();
 	sentSize = 0;
 	for (int i = 0; i < MTP::kUploadSessionsCount; ++i) {
 		MTP::stopSession(MTP::uploadDcId(i));
@@ -531,6 +667,13 @@ void Uploader::partLoaded(const MTPBool &result, mtpRequestId requestId) {
 			auto dc = dcIt->second;
 			dcMap.erase(dcIt);
 
+			auto latency = crl::time(0);
+			const auto sentIt = sentTimes.find(requestId);
+			if (sentIt != sentTimes.cend()) {
+				latency = crl::now() - sentIt->second;
+				sentTimes.erase(sentIt);
+			}
+
 			int32 sentPartSize = 0;
 			auto k = queue.find(uploadingId);
 			Assert(k != queue.cend());
@@ -544,6 +687,7 @@ void Uploader::partLoaded(const MTPBool &result, mtpRequestId requestId) {
 			}
 			sentSize -= sentPartSize;
 			sentSizes[dc] -= sentPartSize;
+			updateParallelSize(sentPartSize, latency);
 			if (file.type() == SendMediaType::Photo) {
 				file.fileSentSize += sentPartSize;
 				const auto photo = Auth().data().photo(file.id());
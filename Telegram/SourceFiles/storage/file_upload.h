@@ -107,8 +107,11 @@ public slots:
 private:
 	struct File;
 
+	bool sendNextPart();
+	void readDocParts(File &file);
 	void partLoaded(const MTPBool &result, mtpRequestId requestId);
 	bool partFailed(const RPCError &err, mtpRequestId requestId);
+	void updateParallelSize(int bytes, crl::time latency);
 
 	void currentFailed();
 
@@ -116,9 +119,18 @@ private:
 	base::flat_map<mtpRequestId, QByteArray> requestsSent;
 	base::flat_map<mtpRequestId, int32> docRequestsSent;
 	base::flat_map<mtpRequestId, int32> dcMap;
+	base::flat_map<mtpRequestId, crl::time> sentTimes;
 	uint32 sentSize = 0;
 	uint32 sentSizes[MTP::kUploadSessionsCount] = { 0 };
 
+	// In-flight bytes window, adapted from the part ack latency.
+	uint32 _parallelSize = 0;
+	crl::time _minLatency = 0;
+	crl::time _minLatencyReset = 0;
+	float64 _maxBandwidth = 0.; // Bytes per millisecond.
+	crl::time _windowStart = 0;
+	int64 _windowBytes = 0;
+
 	FullMsgId uploadingId;
 	FullMsgId _pausedId;
 	std::map<FullMsgId, File> queue;
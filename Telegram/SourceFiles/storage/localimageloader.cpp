@@ -24,6 +24,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mainwindow.h"
 #include "auth_session.h"
 
+#include <crl/crl_semaphore.h>
+
 namespace {
 
 constexpr auto kThumbnailQuality = 87;
@@ -32,6 +34,16 @@ constexpr auto kPhotoUploadPartSize = 32 * 1024;
 
 using Storage::ValidateThumbDimensions;
 
+QImage ScaleToFit(const QImage &image, int size) {
+	return (image.width() > size || image.height() > size)
+		? image.scaled(
+			size,
+			size,
+			Qt::KeepAspectRatio,
+			Qt::SmoothTransformation)
+		: image;
+}
+
 struct PreparedFileThumbnail {
 	uint64 id = 0;
 	QString name;
@@ -309,7 +321,8 @@ SendMediaReady PrepareWallPaper(const QImage &image) {
 		0);
 }
 
-TaskQueue::TaskQueue(crl::time stopTimeoutMs) {
+TaskQueue::TaskQueue(crl::time stopTimeoutMs, int threadsCount)
+: _threadsCount(std::max(threadsCount, 1)) {
 	if (stopTimeoutMs > 0) {
 		_stopTimer = new QTimer(this);
 		connect(_stopTimer, SIGNAL(timeout()), this, SLOT(stop()));
@@ -325,7 +338,7 @@ TaskId TaskQueue::addTask(std::unique_ptr<Task> &&task) {
 		_tasksToProcess.push_back(std::move(task));
 	}
 
-	wakeThread();
+	wakeThreads();
 
 	return result;
 }
@@ -338,25 +351,40 @@ void TaskQueue::addTasks(std::vector<std::unique_ptr<Task>> &&tasks) {
 		}
 	}
 
-	wakeThread();
+	wakeThreads();
 }
 
-void TaskQueue::wakeThread() {
-	if (!_thread) {
-		_thread = new QThread();
+void TaskQueue::wakeThreads() {
+	if (_threads.empty()) {
+		for (auto i = 0; i != _threadsCount; ++i) {
+			const auto thread = new QThread();
+			const auto worker = new TaskQueueWorker(this);
+			worker->moveToThread(thread);
 
-		_worker = new TaskQueueWorker(this);
-		_worker->moveToThread(_thread);
+			connect(this, SIGNAL(taskAdded()), worker, SLOT(onTaskAdded()));
+			connect(worker, SIGNAL(taskProcessed()), this, SLOT(onTaskProcessed()));
 
-		connect(this, SIGNAL(taskAdded()), _worker, SLOT(onTaskAdded()));
-		connect(_worker, SIGNAL(taskProcessed()), this, SLOT(onTaskProcessed()));
-
-		_thread->start();
+			thread->start();
+			_threads.push_back(thread);
+			_workers.push_back(worker);
+		}
 	}
 	if (_stopTimer) _stopTimer->stop();
 	emit taskAdded();
 }
 
+bool TaskQueue::moveProcessedToFinish() {
+	const auto wasEmpty = _tasksToFinish.empty();
+	auto moved = false;
+	while (!_tasksInProcess.empty() && _tasksInProcess.front().processed) {
+		_tasksToFinish.push_back(
+			std::move(_tasksInProcess.front().processed));
+		_tasksInProcess.pop_front();
+		moved = true;
+	}
+	return moved && wasEmpty;
+}
+
 void TaskQueue::cancelTask(TaskId id) {
 	const auto removeFrom = [&](std::deque<std::unique_ptr<Task>> &queue) {
 		const auto proj = [](const std::unique_ptr<Task> &task) {
@@ -367,15 +395,29 @@ void TaskQueue::cancelTask(TaskId id) {
 			queue.erase(i);
 		}
 	};
+	auto emitTaskProcessed = false;
 	{
 		QMutexLocker lock(&_tasksToProcessMutex);
 		removeFrom(_tasksToProcess);
-		if (_taskInProcessId == id) {
-			_taskInProcessId = TaskId();
+		const auto i = ranges::find(
+			_tasksInProcess,
+			id,
+			&TaskInProcess::id);
+		if (i != _tasksInProcess.end()) {
+			// The tasks processed after this one don't wait for it now.
+			_tasksInProcess.erase(i);
+
+			QMutexLocker lockToFinish(&_tasksToFinishMutex);
+			emitTaskProcessed = moveProcessedToFinish();
 		}
 	}
-	QMutexLocker lock(&_tasksToFinishMutex);
-	removeFrom(_tasksToFinish);
+	{
+		QMutexLocker lock(&_tasksToFinishMutex);
+		removeFrom(_tasksToFinish);
+	}
+	if (emitTaskProcessed) {
+		crl::on_main(this, [=] { onTaskProcessed(); });
+	}
 }
 
 void TaskQueue::onTaskProcessed() {
@@ -392,24 +434,32 @@ void TaskQueue::onTaskProcessed() {
 
 	if (_stopTimer) {
 		QMutexLocker lock(&_tasksToProcessMutex);
-		if (_tasksToProcess.empty() && !_taskInProcessId) {
+		if (_tasksToProcess.empty() && _tasksInProcess.empty()) {
 			_stopTimer->start();
 		}
 	}
 }
 
 void TaskQueue::stop() {
-	if (_thread) {
-		_thread->requestInterruption();
-		_thread->quit();
-		DEBUG_LOG(("Waiting for taskThread to finish"));
-		_thread->wait();
-		delete base::take(_worker);
-		delete base::take(_thread);
+	if (!_threads.empty()) {
+		for (const auto thread : _threads) {
+			thread->requestInterruption();
+			thread->quit();
+		}
+		DEBUG_LOG(("Waiting for taskThreads to finish"));
+		for (const auto thread : _threads) {
+			thread->wait();
+		}
+		for (const auto worker : base::take(_workers)) {
+			delete worker;
+		}
+		for (const auto thread : base::take(_threads)) {
+			delete thread;
+		}
 	}
 	_tasksToProcess.clear();
+	_tasksInProcess.clear();
 	_tasksToFinish.clear();
-	_taskInProcessId = TaskId();
 }
 
 TaskQueue::~TaskQueue() {
@@ -429,23 +479,28 @@ void TaskQueueWorker::onTaskAdded() {
 			if (!_queue->_tasksToProcess.empty()) {
 				task = std::move(_queue->_tasksToProcess.front());
 				_queue->_tasksToProcess.pop_front();
-				_queue->_taskInProcessId = task->id();
+				_queue->_tasksInProcess.emplace_back(task->id());
 			}
 		}
 
+		someTasksLeft = false;
 		if (task) {
 			task->process();
 			bool emitTaskProcessed = false;
 			{
 				QMutexLocker lockToProcess(&_queue->_tasksToProcessMutex);
-				if (_queue->_taskInProcessId == task->id()) {
-					_queue->_taskInProcessId = TaskId();
-					someTasksLeft = !_queue->_tasksToProcess.empty();
+				auto &inProcess = _queue->_tasksInProcess;
+				const auto i = ranges::find(
+					inProcess,
+					task->id(),
+					&TaskQueue::TaskInProcess::id);
+				if (i != inProcess.end()) {
+					i->processed = std::move(task);
 
 					QMutexLocker lockToFinish(&_queue->_tasksToFinishMutex);
-					emitTaskProcessed = _queue->_tasksToFinish.empty();
-					_queue->_tasksToFinish.push_back(std::move(task));
+					emitTaskProcessed = _queue->moveProcessedToFinish();
 				}
+				someTasksLeft = !_queue->_tasksToProcess.empty();
 			}
 			if (emitTaskProcessed) {
 				emit taskProcessed();
@@ -885,22 +940,31 @@ void FileLoadTask::process() {
 			if (isAnimation) {
 				attributes.push_back(MTP_documentAttributeAnimated());
 			} else if (_type != SendMediaType::File) {
-				auto thumb = (w > 100 || h > 100) ? fullimage.scaled(100, 100, Qt::KeepAspectRatio, Qt::SmoothTransformation) : fullimage;
+				// Camera photos are large, so only the biggest size is
+				// scaled from the original and it is encoded to JPEG
+				// while the smaller sizes are scaled from it.
+				const auto full = ScaleToFit(fullimage, 1280);
+				auto encoded = crl::semaphore();
+				crl::async([&] {
+					QBuffer buffer(&filedata);
+					full.save(&buffer, "JPG", 87);
+					encoded.release();
+				});
+				const auto medium = ScaleToFit(full, 320);
+				const auto thumb = ScaleToFit(medium, 100);
+				encoded.acquire();
+
 				photoThumbs.emplace('s', thumb);
 				photoSizes.push_back(MTP_photoSize(MTP_string("s"), MTP_fileLocationToBeDeprecated(MTP_long(0), MTP_int(0)), MTP_int(thumb.width()), MTP_int(thumb.height()), MTP_int(0)));
 
-				auto medium = (w > 320 || h > 320) ? fullimage.scaled(320, 320, Qt::KeepAspectRatio, Qt::SmoothTransformation) : fullimage;
 				photoThumbs.emplace('m', medium);
 				photoSizes.push_back(MTP_photoSize(MTP_string("m"), MTP_fileLocationToBeDeprecated(MTP_long(0), MTP_int(0)), MTP_int(medium.width()), MTP_int(medium.height()), MTP_int(0)));
 
-				auto full = (w > 1280 || h > 1280) ? fullimage.scaled(1280, 1280, Qt::KeepAspectRatio, Qt::SmoothTransformation) : fullimage;
 				photoThumbs.emplace('y', full);
 				photoSizes.push_back(MTP_photoSize(MTP_string("y"), MTP_fileLocationToBeDeprecated(MTP_long(0), MTP_int(0)), MTP_int(full.width()), MTP_int(full.height()), MTP_int(0)));
 
-				{
-					QBuffer buffer(&filedata);
-					full.save(&buffer, "JPG", 87);
-				}
+				// The file thumbnail is smaller, it can be scaled from it too.
+				fullimage = full;
 
 				photo = MTP_photo(
 					MTP_flags(0),
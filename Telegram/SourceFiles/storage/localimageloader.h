@@ -105,7 +105,10 @@ class TaskQueue : public QObject {
 	Q_OBJECT
 
 public:
-	explicit TaskQueue(crl::time stopTimeoutMs = 0); // <= 0 - never stop worker
+	// stopTimeoutMs <= 0 - never stop workers.
+	// Tasks are processed in parallel by threadsCount workers,
+	// but they are finished in the same order they were added.
+	explicit TaskQueue(crl::time stopTimeoutMs = 0, int threadsCount = 1);
 
 	TaskId addTask(std::unique_ptr<Task> &&task);
 	void addTasks(std::vector<std::unique_ptr<Task>> &&tasks);
@@ -123,14 +126,27 @@ public slots:
 private:
 	friend class TaskQueueWorker;
 
-	void wakeThread();
+	struct TaskInProcess {
+		explicit TaskInProcess(TaskId id) : id(id) {
+		}
+
+		TaskId id = TaskId();
+		std::unique_ptr<Task> processed;
+	};
+
+	void wakeThreads();
+
+	// Both mutexes should be locked, returns true if taskProcessed()
+	// should be emitted.
+	bool moveProcessedToFinish();
 
 	std::deque<std::unique_ptr<Task>> _tasksToProcess;
+	std::deque<TaskInProcess> _tasksInProcess;
 	std::deque<std::unique_ptr<Task>> _tasksToFinish;
-	TaskId _taskInProcessId = TaskId();
 	QMutex _tasksToProcessMutex, _tasksToFinishMutex;
-	QThread *_thread = nullptr;
-	TaskQueueWorker *_worker = nullptr;
+	int _threadsCount = 1;
+	std::vector<QThread*> _threads;
+	std::vector<TaskQueueWorker*> _workers;
 	QTimer *_stopTimer = nullptr;
 
 };
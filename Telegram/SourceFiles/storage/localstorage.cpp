@@ -21,6 +21,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "export/export_settings.h"
 #include "core/crash_reports.h"
 #include "core/update_checker.h"
+#include "core/startup_trace.h"
 #include "observer_peer.h"
 #include "mainwidget.h"
 #include "mainwindow.h"
@@ -48,6 +49,13 @@ constexpr auto kFileLoaderQueueStopTimeout = crl::time(5000);
 constexpr auto kDefaultStickerInstallDate = TimeId(1);
 constexpr auto kProxyTypeShift = 1024;
 constexpr auto kWriteMapTimeout = crl::time(1000);
+constexpr auto kWriteFilesTimeout = crl::time(300);
+constexpr auto kKeysLogCompactSize = int64(256 * 1024);
+constexpr auto kCacheCompactChunkDelay = crl::time(100);
+constexpr auto kCacheCleanChunkDelay = crl::time(100);
+constexpr auto kCacheWriteStoresDelay = crl::time(250);
+constexpr auto kCacheMessagesSizeLimit = int64(32 * 1024 * 1024);
+constexpr auto kCacheMessagesTimeLimit = 7 * 24 * 60 * 60; // One week.
 constexpr auto kSavedBackgroundFormat = QImage::Format_ARGB32_Premultiplied;
 
 constexpr auto kWallPaperLegacySerializeTagId = int32(-111);
@@ -61,7 +69,7 @@ constexpr auto kSinglePeerTypeSelf = qint32(4);
 constexpr auto kSinglePeerTypeEmpty = qint32(0);
 
 constexpr auto kStickersVersionTag = quint32(-1);
-constexpr auto kStickersSerializeVersion = 1;
+constexpr auto kStickersSerializeVersion = 2;
 constexpr auto kMaxSavedStickerSetsCount = 1000;
 
 using Database = Storage::Cache::Database;
@@ -102,6 +110,282 @@ enum class FileOption {
 using FileOptions = base::flags<FileOption>;
 inline constexpr auto is_flag_type(FileOption) { return true; };
 
+// Files are prepared on the main thread and written in the background.
+// Contents passed while the previous contents of the same file are still
+// waiting replace them, so only the last contents are written.
+struct PendingFile {
+	QByteArray content;
+	bool safe = false;
+};
+
+QMutex _pendingFilesMutex;
+base::flat_map<QString, PendingFile> _pendingFiles;
+
+void writeFileNow(const QString &path, const PendingFile &pending) {
+	// detect order of read attempts and file version
+	QString toTry[2], toDelete;
+	toTry[0] = path + '0';
+	if (pending.safe) {
+		toTry[1] = path + '1';
+		QFileInfo toTry0(toTry[0]);
+		QFileInfo toTry1(toTry[1]);
+		if (toTry0.exists()) {
+			if (toTry1.exists()) {
+				QDateTime mod0 = toTry0.lastModified(), mod1 = toTry1.lastModified();
+				if (mod0 > mod1) {
+					qSwap(toTry[0], toTry[1]);
+				}
+			} else {
+				qSwap(toTry[0], toTry[1]);
+			}
+			toDelete = toTry[1];
+		} else if (toTry1.exists()) {
+			toDelete = toTry[1];
+		}
+	}
+
+	QFile file(toTry[0]);
+	if (!file.open(QIODevice::WriteOnly)) {
+		LOG(("App Error: failed to open '%1' for writing").arg(toTry[0]));
+		return;
+	}
+	const auto written = file.write(pending.content);
+	file.close();
+	if (written == pending.content.size() && !toDelete.isEmpty()) {
+		QFile::remove(toDelete);
+	}
+}
+
+// Small user files are kept as records in one log file, so they are all
+// read at once. A record with a null value removes the key. The log is
+// rewritten when replaced and removed records take most of its size.
+struct KeysLogRecord {
+	qint32 version = 0;
+	QByteArray encrypted;
+};
+
+struct PendingKeysLog {
+	QString path;
+	std::optional<QByteArray> content;
+	base::flat_map<FileKey, QByteArray> records;
+};
+
+base::flat_map<FileKey, KeysLogRecord> _keysLog;
+int64 _keysLogSize = 0;
+int64 _keysLogLiveSize = 0;
+std::optional<PendingKeysLog> _pendingKeysLog;
+
+QString keysLogPath() {
+	return _userBasePath + qsl("keys");
+}
+
+QByteArray serializeKeysLogRecord(
+		FileKey key,
+		const KeysLogRecord &record) {
+	auto result = QByteArray();
+	QDataStream stream(&result, QIODevice::WriteOnly);
+	stream.setVersion(QDataStream::Qt_5_1);
+	stream << quint64(key) << record.version << record.encrypted;
+	return result;
+}
+
+QByteArray serializeKeysLog() {
+	auto result = QByteArray();
+	result.reserve(int(tdfMagicLen + sizeof(qint32) + _keysLogLiveSize));
+	result.append(tdfMagic, tdfMagicLen);
+	qint32 version = AppVersion;
+	result.append((const char*)&version, sizeof(version));
+	for (const auto &[key, record] : _keysLog) {
+		result.append(serializeKeysLogRecord(key, record));
+	}
+	return result;
+}
+
+void writePendingKeysLog() {
+	if (!_pendingKeysLog) {
+		return;
+	}
+	const auto pending = *base::take(_pendingKeysLog);
+	if (pending.content) {
+		const auto temp = pending.path + qsl("_new");
+		QFile file(temp);
+		if (!file.open(QIODevice::WriteOnly)) {
+			LOG(("App Error: failed to open '%1' for writing").arg(temp));
+			return;
+		}
+		const auto written = file.write(*pending.content);
+		file.close();
+		if (written != pending.content->size()
+			|| (QFile::exists(pending.path) && !QFile::remove(pending.path))
+			|| !QFile::rename(temp, pending.path)) {
+			LOG(("App Error: failed to replace '%1'").arg(pending.path));
+			return;
+		}
+	}
+	if (!pending.records.empty()) {
+		QFile file(pending.path);
+		if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+			LOG(("App Error: failed to open '%1' for appending"
+				).arg(pending.path));
+			return;
+		}
+		for (const auto &[key, record] : pending.records) {
+			file.write(record);
+		}
+	}
+}
+
+// Files read at startup are decrypted in the background right after the
+// map is read. The main thread takes the result when it reads the file or
+// reads the file itself if the background task didn't start yet.
+struct PrefetchedFile {
+	QMutex mutex;
+	bool done = false;
+	bool read = false;
+	int32 version = 0;
+	QByteArray data;
+	qint64 position = 0;
+};
+
+base::flat_map<FileKey, std::shared_ptr<PrefetchedFile>> _prefetched;
+
+void writeKeysLog(FileKey key, KeysLogRecord &&record) {
+	_prefetched.remove(key);
+
+	const auto i = _keysLog.find(key);
+	if (i != end(_keysLog)) {
+		_keysLogLiveSize -= serializeKeysLogRecord(key, i->second).size();
+	}
+	auto serialized = serializeKeysLogRecord(key, record);
+	if (record.encrypted.isNull()) {
+		if (i == end(_keysLog)) {
+			return;
+		}
+		_keysLog.erase(i);
+	} else {
+		_keysLogLiveSize += serialized.size();
+		_keysLog[key] = std::move(record);
+	}
+	_keysLogSize += serialized.size();
+
+	QMutexLocker lock(&_pendingFilesMutex);
+	if (!_pendingKeysLog) {
+		_pendingKeysLog = PendingKeysLog{ keysLogPath() };
+	}
+	if (_keysLogSize == serialized.size()
+		|| (_keysLogSize > kKeysLogCompactSize
+			&& _keysLogSize > 2 * _keysLogLiveSize)) {
+		_pendingKeysLog->content = serializeKeysLog();
+		_pendingKeysLog->records.clear();
+		_keysLogSize = _pendingKeysLog->content->size();
+	} else {
+		_pendingKeysLog->records[key] = std::move(serialized);
+	}
+	lock.unlock();
+
+	if (_manager) {
+		_manager->writeFiles();
+	}
+}
+
+void readKeysLog() {
+	_keysLog.clear();
+	_keysLogSize = _keysLogLiveSize = 0;
+	{
+		QMutexLocker lock(&_pendingFilesMutex);
+		writePendingKeysLog();
+	}
+
+	const auto path = keysLogPath();
+	const auto temp = path + qsl("_new");
+	if (!QFile::exists(path) && QFile::exists(temp)) {
+		QFile::rename(temp, path);
+	}
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return;
+	}
+	auto bytes = file.readAll();
+	file.close();
+
+	const auto header = tdfMagicLen + int(sizeof(qint32));
+	if (bytes.size() < header || memcmp(bytes.constData(), tdfMagic, tdfMagicLen)) {
+		LOG(("App Error: bad keys log file."));
+		return;
+	}
+	QBuffer buffer(&bytes);
+	buffer.open(QIODevice::ReadOnly);
+	buffer.seek(header);
+	QDataStream stream(&buffer);
+	stream.setVersion(QDataStream::Qt_5_1);
+	auto read = int64(header);
+	while (!stream.atEnd()) {
+		quint64 key = 0;
+		auto record = KeysLogRecord();
+		stream >> key >> record.version >> record.encrypted;
+		if (stream.status() != QDataStream::Ok) {
+			LOG(("App Error: bad record in the keys log file."));
+
+			// Rewrite the log without the broken tail on the next write.
+			read = 0;
+			break;
+		}
+		read = buffer.pos();
+		if (record.encrypted.isNull()) {
+			_keysLog.remove(key);
+		} else {
+			_keysLog[key] = std::move(record);
+		}
+	}
+	_keysLogSize = read;
+	for (const auto &[key, record] : _keysLog) {
+		_keysLogLiveSize += serializeKeysLogRecord(key, record).size();
+	}
+}
+
+void clearKeysLog() {
+	_keysLog.clear();
+	_keysLogSize = _keysLogLiveSize = 0;
+
+	QMutexLocker lock(&_pendingFilesMutex);
+	_pendingKeysLog = std::nullopt;
+}
+
+void writePendingFiles() {
+	QMutexLocker lock(&_pendingFilesMutex);
+	for (const auto &[path, pending] : base::take(_pendingFiles)) {
+		writeFileNow(path, pending);
+	}
+	writePendingKeysLog();
+}
+
+void writePendingFile(const QString &path) {
+	QMutexLocker lock(&_pendingFilesMutex);
+	const auto i = _pendingFiles.find(path);
+	if (i != end(_pendingFiles)) {
+		const auto pending = std::move(i->second);
+		_pendingFiles.erase(i);
+		writeFileNow(path, pending);
+	}
+}
+
+void cancelPendingFile(const QString &path) {
+	QMutexLocker lock(&_pendingFilesMutex);
+	_pendingFiles.remove(path);
+}
+
+void cancelPendingUserFiles() {
+	QMutexLocker lock(&_pendingFilesMutex);
+	_pendingKeysLog = std::nullopt;
+	for (auto i = begin(_pendingFiles); i != end(_pendingFiles);) {
+		if (i->first.startsWith(_userBasePath)) {
+			i = _pendingFiles.erase(i);
+		} else {
+			++i;
+		}
+	}
+}
+
 bool keyAlreadyUsed(QString &name, FileOptions options = FileOption::User | FileOption::Safe) {
 	name += '0';
 	if (QFileInfo(name).exists()) return true;
@@ -127,7 +411,9 @@ FileKey genKey(FileOptions options = FileOption::User | FileOption::Safe) {
 		result = rand_value<FileKey>();
 		path.resize(base.size());
 		path += toFilePart(result);
-	} while (!result || keyAlreadyUsed(path, options));
+	} while (!result
+		|| keyAlreadyUsed(path, options)
+		|| ((options & FileOption::User) && _keysLog.contains(result)));
 
 	return result;
 }
@@ -135,13 +421,16 @@ FileKey genKey(FileOptions options = FileOption::User | FileOption::Safe) {
 void clearKey(const FileKey &key, FileOptions options = FileOption::User | FileOption::Safe) {
 	if (options & FileOption::User) {
 		if (!_userWorking()) return;
+		writeKeysLog(key, KeysLogRecord());
 	} else {
 		if (!_working()) return;
 	}
 
 	QString base = (options & FileOption::User) ? _userBasePath : _basePath, name;
 	name.reserve(base.size() + 0x11);
-	name.append(base).append(toFilePart(key)).append('0');
+	name.append(base).append(toFilePart(key));
+	cancelPendingFile(name);
+	name.append('0');
 	QFile::remove(name);
 	if (options & FileOption::Safe) {
 		name[name.size() - 1] = '1';
@@ -183,6 +472,99 @@ void createLocalKey(const QByteArray &pass, QByteArray *salt, MTP::AuthKeyPtr *r
 	*result = std::make_shared<MTP::AuthKey>(key);
 }
 
+// Local keys for a non-empty passcode are derived with PBKDF2-HMAC-SHA512,
+// the iterations count is tuned on this machine when the passcode is set.
+// The parameters are written to the map file after the encrypted map,
+// map files without them use the legacy PBKDF2-HMAC-SHA1 derivation.
+constexpr auto kPassKeyDerivationTime = crl::time(500);
+constexpr auto kPassKeyTuneIterations = 20000;
+constexpr auto kPassKeyMinIterations = 100000;
+constexpr auto kPassKeyMaxIterations = 20000000;
+
+struct PassKeyParams {
+	enum class Hash : quint32 {
+		Sha1 = 0,
+		Sha512 = 1,
+	};
+	Hash hash = Hash::Sha1;
+	quint32 iterations = LocalEncryptIterCount;
+};
+
+PassKeyParams _passKeyParams;
+
+QByteArray SerializePassKeyParams(const PassKeyParams &params) {
+	auto result = QByteArray();
+	{
+		QDataStream stream(&result, QIODevice::WriteOnly);
+		stream.setVersion(QDataStream::Qt_5_1);
+		stream << quint32(params.hash) << quint32(params.iterations);
+	}
+	return result;
+}
+
+std::optional<PassKeyParams> DeserializePassKeyParams(
+		const QByteArray &serialized) {
+	QDataStream stream(serialized);
+	stream.setVersion(QDataStream::Qt_5_1);
+	auto hash = quint32();
+	auto iterations = quint32();
+	stream >> hash >> iterations;
+	if (stream.status() != QDataStream::Ok
+		|| hash != quint32(PassKeyParams::Hash::Sha512)
+		|| iterations < kPassKeyMinIterations
+		|| iterations > kPassKeyMaxIterations) {
+		return std::nullopt;
+	}
+	auto result = PassKeyParams();
+	result.hash = PassKeyParams::Hash::Sha512;
+	result.iterations = iterations;
+	return result;
+}
+
+// Called on a background thread, it takes hundreds of milliseconds.
+MTP::AuthKeyPtr DerivePassKey(
+		const QByteArray &pass,
+		const QByteArray &salt,
+		const PassKeyParams &params) {
+	if (pass.isEmpty() || params.hash == PassKeyParams::Hash::Sha1) {
+		auto copy = salt;
+		auto result = MTP::AuthKeyPtr();
+		createLocalKey(pass, &copy, &result);
+		return result;
+	}
+	auto key = MTP::AuthKey::Data { { gsl::byte{} } };
+	PKCS5_PBKDF2_HMAC(
+		pass.constData(),
+		pass.size(),
+		reinterpret_cast<const uchar*>(salt.constData()),
+		salt.size(),
+		params.iterations,
+		EVP_sha512(),
+		key.size(),
+		reinterpret_cast<uchar*>(key.data()));
+	return std::make_shared<MTP::AuthKey>(key);
+}
+
+PassKeyParams TunedPassKeyParams() {
+	auto params = PassKeyParams();
+	params.hash = PassKeyParams::Hash::Sha512;
+	params.iterations = kPassKeyTuneIterations;
+
+	const auto pass = QByteArray(kLocalKeySize, Qt::Uninitialized);
+	const auto salt = QByteArray(LocalEncryptSaltSize, Qt::Uninitialized);
+	const auto started = crl::now();
+	DerivePassKey(pass, salt, params);
+	const auto elapsed = std::max(crl::now() - started, crl::time(1));
+	const auto iterations = kPassKeyTuneIterations
+		* kPassKeyDerivationTime
+		/ elapsed;
+	params.iterations = quint32(snap(
+		iterations,
+		crl::time(kPassKeyMinIterations),
+		crl::time(kPassKeyMaxIterations)));
+	return params;
+}
+
 struct FileReadDescriptor {
 	int32 version = 0;
 	QByteArray data;
@@ -239,40 +621,20 @@ struct FileWriteDescriptor {
 			if (!_working()) return;
 		}
 
-		// detect order of read attempts and file version
-		QString toTry[2];
-		toTry[0] = ((options & FileOption::User) ? _userBasePath : _basePath) + name + '0';
-		if (options & FileOption::Safe) {
-			toTry[1] = ((options & FileOption::User) ? _userBasePath : _basePath) + name + '1';
-			QFileInfo toTry0(toTry[0]);
-			QFileInfo toTry1(toTry[1]);
-			if (toTry0.exists()) {
-				if (toTry1.exists()) {
-					QDateTime mod0 = toTry0.lastModified(), mod1 = toTry1.lastModified();
-					if (mod0 > mod1) {
-						qSwap(toTry[0], toTry[1]);
-					}
-				} else {
-					qSwap(toTry[0], toTry[1]);
-				}
-				toDelete = toTry[1];
-			} else if (toTry1.exists()) {
-				toDelete = toTry[1];
-			}
-		}
+		path = ((options & FileOption::User) ? _userBasePath : _basePath) + name;
+		safe = (options & FileOption::Safe);
 
-		file.setFileName(toTry[0]);
-		if (file.open(QIODevice::WriteOnly)) {
-			file.write(tdfMagic, tdfMagicLen);
-			qint32 version = AppVersion;
-			file.write((const char*)&version, sizeof(version));
+		buffer.setBuffer(&content);
+		buffer.open(QIODevice::WriteOnly);
+		buffer.write(tdfMagic, tdfMagicLen);
+		qint32 version = AppVersion;
+		buffer.write((const char*)&version, sizeof(version));
 
-			stream.setDevice(&file);
-			stream.setVersion(QDataStream::Qt_5_1);
-		}
+		stream.setDevice(&buffer);
+		stream.setVersion(QDataStream::Qt_5_1);
 	}
 	bool writeData(const QByteArray &data) {
-		if (!file.isOpen()) return false;
+		if (!buffer.isOpen()) return false;
 
 		stream << data;
 		quint32 len = data.isNull() ? 0xffffffff : data.size();
@@ -285,7 +647,7 @@ struct FileWriteDescriptor {
 
 		return true;
 	}
-	static QByteArray prepareEncrypted(EncryptedDescriptor &data, const MTP::AuthKeyPtr &key = LocalKey) {
+	static uint32 prepareForEncryption(EncryptedDescriptor &data) {
 		data.finish();
 		QByteArray &toEncrypt(data.data);
 
@@ -297,17 +659,43 @@ struct FileWriteDescriptor {
 			memset_rand(toEncrypt.data() + size, fullSize - size);
 		}
 		*(uint32*)toEncrypt.data() = size;
-		QByteArray encrypted(0x10 + fullSize, Qt::Uninitialized); // 128bit of sha1 - key128, sizeof(data), data
-		hashSha1(toEncrypt.constData(), toEncrypt.size(), encrypted.data());
-		MTP::aesEncryptLocal(toEncrypt.constData(), encrypted.data() + 0x10, fullSize, key, encrypted.constData());
-
+		return 0x10 + fullSize; // 128bit of sha1 - key128, sizeof(data), data
+	}
+	static void encrypt(const EncryptedDescriptor &data, char *to, const MTP::AuthKeyPtr &key) {
+		const auto &toEncrypt = data.data;
+		hashSha1(toEncrypt.constData(), toEncrypt.size(), to);
+		MTP::aesEncryptLocal(toEncrypt.constData(), to + 0x10, toEncrypt.size(), key, to);
+	}
+	static QByteArray prepareEncrypted(EncryptedDescriptor &data, const MTP::AuthKeyPtr &key = LocalKey) {
+		QByteArray encrypted(prepareForEncryption(data), Qt::Uninitialized);
+		encrypt(data, encrypted.data(), key);
 		return encrypted;
 	}
 	bool writeEncrypted(EncryptedDescriptor &data, const MTP::AuthKeyPtr &key = LocalKey) {
-		return writeData(prepareEncrypted(data, key));
+		if (!buffer.isOpen()) return false;
+
+		// Same as writeData(prepareEncrypted(data, key)), but encrypts
+		// straight into the file contents without a temporary QByteArray.
+		const auto encryptedSize = prepareForEncryption(data);
+		stream << quint32(encryptedSize);
+		const auto offset = content.size();
+		content.reserve(offset + encryptedSize + 0x10); // + md5
+		content.resize(offset + encryptedSize);
+		encrypt(data, content.data() + offset, key);
+		buffer.seek(content.size());
+
+		quint32 len = encryptedSize;
+		if (QSysInfo::ByteOrder != QSysInfo::BigEndian) {
+			len = qbswap(len);
+		}
+		md5.feed(&len, sizeof(len));
+		md5.feed(content.constData() + offset, encryptedSize);
+		dataSize += sizeof(len) + encryptedSize;
+
+		return true;
 	}
 	void finish() {
-		if (!file.isOpen()) return;
+		if (!buffer.isOpen()) return;
 
 		stream.setDevice(nullptr);
 
@@ -315,18 +703,23 @@ struct FileWriteDescriptor {
 		qint32 version = AppVersion;
 		md5.feed(&version, sizeof(version));
 		md5.feed(tdfMagic, tdfMagicLen);
-		file.write((const char*)md5.result(), 0x10);
-		file.close();
+		buffer.write((const char*)md5.result(), 0x10);
+		buffer.close();
+
+		QMutexLocker lock(&_pendingFilesMutex);
+		_pendingFiles[path] = PendingFile{ base::take(content), safe };
+		lock.unlock();
 
-		if (!toDelete.isEmpty()) {
-			QFile::remove(toDelete);
+		if (_manager) {
+			_manager->writeFiles();
 		}
 	}
-	QFile file;
+	QString path;
+	bool safe = false;
+	QByteArray content;
+	QBuffer buffer;
 	QDataStream stream;
 
-	QString toDelete;
-
 	HashMd5 md5;
 	int32 dataSize = 0;
 
@@ -342,6 +735,8 @@ bool readFile(FileReadDescriptor &result, const QString &name, FileOptions optio
 		if (!_working()) return false;
 	}
 
+	writePendingFile(((options & FileOption::User) ? _userBasePath : _basePath) + name);
+
 	// detect order of read attempts
 	QString toTry[2];
 	toTry[0] = ((options & FileOption::User) ? _userBasePath : _basePath) + name + '0';
@@ -498,10 +893,129 @@ bool readEncryptedFile(FileReadDescriptor &result, const QString &name, FileOpti
 	return true;
 }
 
+bool readKeysLogRecord(FileReadDescriptor &result, const FileKey &fkey) {
+	const auto i = _keysLog.find(fkey);
+	if (i == end(_keysLog)) {
+		return false;
+	}
+	EncryptedDescriptor data;
+	if (!decryptLocal(data, i->second.encrypted)) {
+		return false;
+	}
+	result.version = i->second.version;
+	result.data = data.data;
+	result.buffer.setBuffer(&result.data);
+	result.buffer.open(QIODevice::ReadOnly);
+	result.buffer.seek(data.buffer.pos());
+	result.stream.setDevice(&result.buffer);
+	result.stream.setVersion(QDataStream::Qt_5_1);
+	return true;
+}
+
+void prefetchEncryptedFiles(std::initializer_list<FileKey> keys) {
+	for (const auto fkey : keys) {
+		if (!fkey || _prefetched.contains(fkey)) {
+			continue;
+		}
+		const auto file = std::make_shared<PrefetchedFile>();
+		_prefetched.emplace(fkey, file);
+
+		// The keys log is changed on the main thread, so take the record.
+		const auto i = _keysLog.find(fkey);
+		const auto record = (i != end(_keysLog))
+			? i->second
+			: KeysLogRecord();
+		const auto name = (i != end(_keysLog))
+			? QString()
+			: toFilePart(fkey);
+		crl::async([=, key = LocalKey] {
+			QMutexLocker lock(&file->mutex);
+			if (file->done) {
+				return;
+			}
+			file->done = true;
+
+			FileReadDescriptor result;
+			if (!name.isEmpty()) {
+				file->read = readEncryptedFile(
+					result,
+					name,
+					FileOption::User | FileOption::Safe,
+					key);
+				file->version = result.version;
+			} else {
+				EncryptedDescriptor decrypted;
+				file->read = decryptLocal(decrypted, record.encrypted, key);
+				result.data = decrypted.data;
+				result.buffer.setBuffer(&result.data);
+				result.buffer.open(QIODevice::ReadOnly);
+				result.buffer.seek(decrypted.buffer.pos());
+				file->version = record.version;
+			}
+			if (file->read) {
+				file->position = result.buffer.pos();
+				file->data = result.data;
+			}
+		});
+	}
+}
+
+bool takePrefetchedFile(FileReadDescriptor &result, const FileKey &fkey) {
+	const auto i = _prefetched.find(fkey);
+	if (i == end(_prefetched)) {
+		return false;
+	}
+	const auto file = std::move(i->second);
+	_prefetched.erase(i);
+
+	QMutexLocker lock(&file->mutex);
+	if (!file->done) {
+		file->done = true;
+		return false;
+	} else if (!file->read) {
+		return false;
+	}
+	result.version = file->version;
+	result.data = base::take(file->data);
+	result.buffer.setBuffer(&result.data);
+	result.buffer.open(QIODevice::ReadOnly);
+	result.buffer.seek(file->position);
+	result.stream.setDevice(&result.buffer);
+	result.stream.setVersion(QDataStream::Qt_5_1);
+	return true;
+}
+
 bool readEncryptedFile(FileReadDescriptor &result, const FileKey &fkey, FileOptions options = FileOption::User | FileOption::Safe, const MTP::AuthKeyPtr &key = LocalKey) {
+	if ((options & FileOption::User)
+		&& (key == LocalKey)
+		&& takePrefetchedFile(result, fkey)) {
+		return true;
+	}
+	if ((options & FileOption::User) && _keysLog.contains(fkey)) {
+		return _userWorking() && readKeysLogRecord(result, fkey);
+	}
 	return readEncryptedFile(result, toFilePart(fkey), options, key);
 }
 
+// Keys written here are moved from their own files to the keys log.
+void writeEncryptedKey(const FileKey &fkey, EncryptedDescriptor &data) {
+	if (!_userWorking()) return;
+
+	const auto moved = _keysLog.contains(fkey);
+	writeKeysLog(fkey, {
+		AppVersion,
+		FileWriteDescriptor::prepareEncrypted(data)
+	});
+	if (!moved) {
+		auto name = _userBasePath + toFilePart(fkey);
+		cancelPendingFile(name);
+		name.append('0');
+		QFile::remove(name);
+		name[name.size() - 1] = '1';
+		QFile::remove(name);
+	}
+}
+
 FileKey _dataNameKey = 0;
 
 enum { // Local Storage Keys
@@ -527,6 +1041,7 @@ enum { // Local Storage Keys
 	lskExportSettings = 0x13, // no data
 	lskBackground = 0x14, // no data
 	lskSelfSerialized = 0x15, // serialized self
+	lskDialogsSnapshot = 0x16, // no data
 };
 
 enum {
@@ -685,6 +1200,7 @@ bool NoTimeLimit(qint32 storedLimitValue) {
 }
 
 FileKey _exportSettingsKey = 0;
+FileKey _dialogsSnapshotKey = 0;
 
 FileKey _langPackKey = 0;
 FileKey _languagesKey = 0;
@@ -775,8 +1291,7 @@ void _writeLocations(WriteMapWhen when = WriteMapWhen::Soon) {
 			data.stream << quint64(i.key().first) << quint64(i.key().second) << quint64(i.value().first) << quint64(i.value().second);
 		}
 
-		FileWriteDescriptor file(_locationsKey);
-		file.writeEncrypted(data);
+		writeEncryptedKey(_locationsKey, data);
 	}
 }
 
@@ -868,8 +1383,7 @@ void _writeReportSpamStatuses() {
 			data.stream << quint64(i.key()) << qint32(i.value());
 		}
 
-		FileWriteDescriptor file(_reportSpamStatusesKey);
-		file.writeEncrypted(data);
+		writeEncryptedKey(_reportSpamStatusesKey, data);
 	}
 }
 
@@ -2167,8 +2681,7 @@ void _writeUserSettings() {
 	}
 	data.stream << qint32(dbiCallSettings) << callSettings;
 
-	FileWriteDescriptor file(_userSettingsKey);
-	file.writeEncrypted(data);
+	writeEncryptedKey(_userSettingsKey, data);
 }
 
 void _readUserSettings() {
@@ -2248,7 +2761,9 @@ void _readMtpData() {
 	applyReadContext(std::move(context));
 }
 
-ReadMapState _readMap(const QByteArray &pass) {
+ReadMapState _readMap(
+		const QByteArray &pass,
+		MTP::AuthKeyPtr passKey = nullptr) {
 	auto ms = crl::now();
 	QByteArray dataNameUtf8 = (cDataFile() + (cTestMode() ? qsl(":/test/") : QString())).toUtf8();
 	FileKey dataNameHash[2];
@@ -2271,12 +2786,25 @@ ReadMapState _readMap(const QByteArray &pass) {
 	if (!_checkStreamStatus(mapData.stream)) {
 		return ReadMapFailed;
 	}
+	auto params = PassKeyParams();
+	if (!mapData.stream.atEnd()) {
+		QByteArray serialized;
+		mapData.stream >> serialized;
+		if (!_checkStreamStatus(mapData.stream)) {
+			return ReadMapFailed;
+		} else if (const auto parsed = DeserializePassKeyParams(serialized)) {
+			params = *parsed;
+		} else {
+			LOG(("App Error: bad passcode key params in map file."));
+			return ReadMapFailed;
+		}
+	}
 
 	if (salt.size() != LocalEncryptSaltSize) {
 		LOG(("App Error: bad salt in map file, size: %1").arg(salt.size()));
 		return ReadMapFailed;
 	}
-	createLocalKey(pass, &salt, &PassKey);
+	PassKey = passKey ? passKey : DerivePassKey(pass, salt, params);
 
 	EncryptedDescriptor keyData, map;
 	if (!decryptLocal(keyData, keyEncrypted, PassKey)) {
@@ -2292,6 +2820,7 @@ ReadMapState _readMap(const QByteArray &pass) {
 
 	_passKeyEncrypted = keyEncrypted;
 	_passKeySalt = salt;
+	_passKeyParams = params;
 
 	if (!decryptLocal(map, mapEncrypted)) {
 		LOG(("App Error: could not decrypt map."));
@@ -2308,6 +2837,7 @@ ReadMapState _readMap(const QByteArray &pass) {
 	quint64 savedGifsKey = 0;
 	quint64 backgroundKeyDay = 0, backgroundKeyNight = 0;
 	quint64 userSettingsKey = 0, recentHashtagsAndBotsKey = 0, exportSettingsKey = 0;
+	quint64 dialogsSnapshotKey = 0;
 	while (!map.stream.atEnd()) {
 		quint32 keyType;
 		map.stream >> keyType;
@@ -2398,6 +2928,9 @@ ReadMapState _readMap(const QByteArray &pass) {
 		case lskExportSettings: {
 			map.stream >> exportSettingsKey;
 		} break;
+		case lskDialogsSnapshot: {
+			map.stream >> dialogsSnapshotKey;
+		} break;
 		default:
 		LOG(("App Error: unknown key type in encrypted map: %1").arg(keyType));
 		return ReadMapFailed;
@@ -2426,6 +2959,7 @@ ReadMapState _readMap(const QByteArray &pass) {
 	_userSettingsKey = userSettingsKey;
 	_recentHashtagsAndBotsKey = recentHashtagsAndBotsKey;
 	_exportSettingsKey = exportSettingsKey;
+	_dialogsSnapshotKey = dialogsSnapshotKey;
 	_oldMapVersion = mapData.version;
 	if (_oldMapVersion < AppVersion) {
 		_mapChanged = true;
@@ -2434,6 +2968,21 @@ ReadMapState _readMap(const QByteArray &pass) {
 		_mapChanged = false;
 	}
 
+	readKeysLog();
+	prefetchEncryptedFiles({
+		_locationsKey,
+		_reportSpamStatusesKey,
+		_userSettingsKey,
+		_trustedBotsKey,
+		_recentHashtagsAndBotsKey,
+		_installedStickersKey,
+		_featuredStickersKey,
+		_recentStickersKey,
+		_favedStickersKey,
+		_archivedStickersKey,
+		_savedGifsKey,
+		_dialogsSnapshotKey,
+	});
 	if (_locationsKey) {
 		_readLocations();
 	}
@@ -2480,6 +3029,7 @@ void _writeMap(WriteMapWhen when) {
 
 		_passKeySalt.resize(LocalEncryptSaltSize);
 		memset_rand(_passKeySalt.data(), _passKeySalt.size());
+		_passKeyParams = PassKeyParams();
 		createLocalKey(QByteArray(), &_passKeySalt, &PassKey);
 
 		EncryptedDescriptor passKeyData(kLocalKeySize);
@@ -2528,6 +3078,7 @@ void _writeMap(WriteMapWhen when) {
 	if (_userSettingsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_recentHashtagsAndBotsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_exportSettingsKey) mapSize += sizeof(quint32) + sizeof(quint64);
+	if (_dialogsSnapshotKey) mapSize += sizeof(quint32) + sizeof(quint64);
 
 	EncryptedDescriptor mapData(mapSize);
 	if (!self.isEmpty()) {
@@ -2582,7 +3133,13 @@ void _writeMap(WriteMapWhen when) {
 	if (_exportSettingsKey) {
 		mapData.stream << quint32(lskExportSettings) << quint64(_exportSettingsKey);
 	}
+	if (_dialogsSnapshotKey) {
+		mapData.stream << quint32(lskDialogsSnapshot) << quint64(_dialogsSnapshotKey);
+	}
 	map.writeEncrypted(mapData);
+	if (_passKeyParams.hash != PassKeyParams::Hash::Sha1) {
+		map.writeData(SerializePassKeyParams(_passKeyParams));
+	}
 
 	_mapChanged = false;
 }
@@ -2605,8 +3162,13 @@ void readLangPack();
 void start() {
 	Expects(!_manager);
 
+	const auto trace = Core::StartupTrace::Scope("Local::start", "local");
+
 	_manager = new internal::Manager();
-	_localLoader = new TaskQueue(kFileLoaderQueueStopTimeout);
+	// Voice waveforms are counted independently of each other.
+	_localLoader = new TaskQueue(
+		kFileLoaderQueueStopTimeout,
+		QThread::idealThreadCount());
 
 	_basePath = cWorkingDir() + qsl("tdata/");
 	if (!QDir().exists(_basePath)) QDir().mkpath(_basePath);
@@ -2819,6 +3381,7 @@ void writeAutoupdatePrefix(const QString &prefix) {
 }
 
 QString readAutoupdatePrefix() {
+	const auto trace = Core::StartupTrace::Scope("Local::readAutoupdatePrefix", "local");
 	Expects(!Core::UpdaterDisabled());
 
 	auto result = readAutoupdatePrefixRaw();
@@ -2831,6 +3394,9 @@ void reset() {
 	}
 
 	_passKeySalt.clear(); // reset passcode, local key
+	_prefetched.clear();
+	clearKeysLog();
+	_stickerSetsDocuments.clear();
 	_draftsMap.clear();
 	_draftCursorsMap.clear();
 	_fileLocations.clear();
@@ -2844,6 +3410,7 @@ void reset() {
 	_backgroundKeyDay = _backgroundKeyNight = 0;
 	Window::Theme::Background()->reset();
 	_userSettingsKey = _recentHashtagsAndBotsKey = _exportSettingsKey = 0;
+	_dialogsSnapshotKey = 0;
 	_oldMapVersion = _oldSettingsVersion = 0;
 	_cacheTotalSizeLimit = Database::Settings().totalSizeLimit;
 	_cacheTotalTimeLimit = Database::Settings().totalTimeLimit;
@@ -2856,24 +3423,46 @@ void reset() {
 	_writeMtpData();
 }
 
-bool checkPasscode(const QByteArray &passcode) {
-	auto checkKey = MTP::AuthKeyPtr();
-	createLocalKey(passcode, &_passKeySalt, &checkKey);
-	return checkKey->equals(PassKey);
+void checkPasscode(const QByteArray &passcode, Fn<void(bool)> done) {
+	const auto salt = _passKeySalt;
+	const auto params = _passKeyParams;
+	crl::async([=] {
+		auto checkKey = DerivePassKey(passcode, salt, params);
+		crl::on_main([=, checkKey = std::move(checkKey)] {
+			done(PassKey
+				&& (_passKeySalt == salt)
+				&& checkKey->equals(PassKey));
+		});
+	});
 }
 
-void setPasscode(const QByteArray &passcode) {
-	createLocalKey(passcode, &_passKeySalt, &PassKey);
+void setPasscode(const QByteArray &passcode, Fn<void()> done) {
+	const auto salt = _passKeySalt;
+	crl::async([=] {
+		const auto params = passcode.isEmpty()
+			? PassKeyParams()
+			: TunedPassKeyParams();
+		auto passKey = DerivePassKey(passcode, salt, params);
+		crl::on_main([=, passKey = std::move(passKey)] {
+			if (!_manager || _passKeySalt != salt) {
+				return;
+			}
+			PassKey = passKey;
+			_passKeyParams = params;
 
-	EncryptedDescriptor passKeyData(kLocalKeySize);
-	LocalKey->write(passKeyData.stream);
-	_passKeyEncrypted = FileWriteDescriptor::prepareEncrypted(passKeyData, PassKey);
+			EncryptedDescriptor passKeyData(kLocalKeySize);
+			LocalKey->write(passKeyData.stream);
+			_passKeyEncrypted = FileWriteDescriptor::prepareEncrypted(passKeyData, PassKey);
 
-	_mapChanged = true;
-	_writeMap(WriteMapWhen::Now);
+			_mapChanged = true;
+			_writeMap(WriteMapWhen::Now);
+
+			Global::SetLocalPasscode(!passcode.isEmpty());
+			Global::RefLocalPasscodeChanged().notify();
 
-	Global::SetLocalPasscode(!passcode.isEmpty());
-	Global::RefLocalPasscodeChanged().notify();
+			done();
+		});
+	});
 }
 
 base::flat_set<QString> CollectGoodNames() {
@@ -2892,9 +3481,10 @@ base::flat_set<QString> CollectGoodNames() {
 		_backgroundKeyDay,
 		_recentHashtagsAndBotsKey,
 		_exportSettingsKey,
+		_dialogsSnapshotKey,
 		_trustedBotsKey
 	};
-	auto result = base::flat_set<QString>{ "map0", "map1" };
+	auto result = base::flat_set<QString>{ "map0", "map1", "keys", "keys_new" };
 	const auto push = [&](FileKey key) {
 		if (!key) {
 			return;
@@ -2922,8 +3512,9 @@ void FilterLegacyFiles(FnMut<void(base::flat_set<QString>&&)> then) {
 	});
 }
 
-ReadMapState readMap(const QByteArray &pass) {
-	ReadMapState result = _readMap(pass);
+ReadMapState readMap(const QByteArray &pass, MTP::AuthKeyPtr passKey) {
+	const auto trace = Core::StartupTrace::Scope("Local::readMap", "local");
+	ReadMapState result = _readMap(pass, std::move(passKey));
 	if (result == ReadMapFailed) {
 		_mapChanged = true;
 		_writeMap(WriteMapWhen::Now);
@@ -2934,6 +3525,32 @@ ReadMapState readMap(const QByteArray &pass) {
 	return result;
 }
 
+void readMapAsync(const QByteArray &pass, Fn<void(ReadMapState)> done) {
+	FileReadDescriptor mapData;
+	if (!readFile(mapData, qsl("map"))) {
+		done(readMap(pass));
+		return;
+	}
+	QByteArray salt, keyEncrypted, mapEncrypted, serialized;
+	mapData.stream >> salt >> keyEncrypted >> mapEncrypted;
+	if (!mapData.stream.atEnd()) {
+		mapData.stream >> serialized;
+	}
+	const auto params = serialized.isEmpty()
+		? std::make_optional(PassKeyParams())
+		: DeserializePassKeyParams(serialized);
+	if (mapData.stream.status() != QDataStream::Ok || !params) {
+		done(readMap(pass));
+		return;
+	}
+	crl::async([=] {
+		auto passKey = DerivePassKey(pass, salt, *params);
+		crl::on_main([=, passKey = std::move(passKey)]() mutable {
+			done(readMap(pass, std::move(passKey)));
+		});
+	});
+}
+
 int32 oldMapVersion() {
 	return _oldMapVersion;
 }
@@ -2979,8 +3596,7 @@ void writeDrafts(const PeerId &peer, const MessageDraft &localDraft, const Messa
 		data.stream << editDraft.textWithTags.text << editTags;
 		data.stream << qint32(editDraft.msgId) << qint32(editDraft.previewCancelled ? 1 : 0);
 
-		FileWriteDescriptor file(i.value());
-		file.writeEncrypted(data);
+		writeEncryptedKey(i.value(), data);
 
 		_draftsNotReadMap.remove(peer);
 	}
@@ -3025,6 +3641,7 @@ void _readDraftCursors(const PeerId &peer, MessageCursor &localCursor, MessageCu
 }
 
 void readDraftsWithCursors(History *h) {
+	const auto trace = Core::StartupTrace::Scope("Local::readDraftsWithCursors", "local");
 	PeerId peer = h->peer->id;
 	if (!_draftsNotReadMap.remove(peer)) {
 		clearDraftCursors(peer);
@@ -3121,8 +3738,7 @@ void writeDraftCursors(const PeerId &peer, const MessageCursor &msgCursor, const
 		data.stream << quint64(peer) << qint32(msgCursor.position) << qint32(msgCursor.anchor) << qint32(msgCursor.scroll);
 		data.stream << qint32(editCursor.position) << qint32(editCursor.anchor) << qint32(editCursor.scroll);
 
-		FileWriteDescriptor file(i.value());
-		file.writeEncrypted(data);
+		writeEncryptedKey(i.value(), data);
 	}
 }
 
@@ -3224,6 +3840,10 @@ QString cachePath() {
 Storage::Cache::Database::Settings cacheSettings() {
 	auto result = Storage::Cache::Database::Settings();
 	result.clearOnWrongKey = true;
+	result.readPlacesMapped = true;
+	result.compactChunkDelay = kCacheCompactChunkDelay;
+	result.cleanChunkDelay = kCacheCleanChunkDelay;
+	result.writeStoresDelay = kCacheWriteStoresDelay;
 	result.totalSizeLimit = _cacheTotalSizeLimit;
 	result.totalTimeLimit = _cacheTotalTimeLimit;
 	result.maxDataSize = Storage::kMaxFileInMemory;
@@ -3260,12 +3880,34 @@ QString cacheBigFilePath() {
 Storage::Cache::Database::Settings cacheBigFileSettings() {
 	auto result = Storage::Cache::Database::Settings();
 	result.clearOnWrongKey = true;
+	result.readPlacesMapped = true;
+	result.compactChunkDelay = kCacheCompactChunkDelay;
+	result.cleanChunkDelay = kCacheCleanChunkDelay;
+	result.writeStoresDelay = kCacheWriteStoresDelay;
 	result.totalSizeLimit = _cacheBigFileTotalSizeLimit;
 	result.totalTimeLimit = _cacheBigFileTotalTimeLimit;
 	result.maxDataSize = Storage::kMaxFileInMemory;
 	return result;
 }
 
+QString cacheMessagesPath() {
+	Expects(!_userDbPath.isEmpty());
+
+	return _userDbPath + "messages_cache";
+}
+
+Storage::Cache::Database::Settings cacheMessagesSettings() {
+	auto result = Storage::Cache::Database::Settings();
+	result.clearOnWrongKey = true;
+	result.readPlacesMapped = true;
+	result.compactChunkDelay = kCacheCompactChunkDelay;
+	result.cleanChunkDelay = kCacheCleanChunkDelay;
+	result.writeStoresDelay = kCacheWriteStoresDelay;
+	result.totalSizeLimit = kCacheMessagesSizeLimit;
+	result.totalTimeLimit = kCacheMessagesTimeLimit;
+	return result;
+}
+
 class CountWaveformTask : public Task {
 public:
 	CountWaveformTask(DocumentData *doc)
@@ -3335,6 +3977,14 @@ void cancelTask(TaskId id) {
 	}
 }
 
+struct StickerSetDocuments {
+	qint32 version = 0;
+	QByteArray documents;
+};
+
+// Documents of the sets that were read but not used yet.
+base::flat_map<uint64, StickerSetDocuments> _stickerSetsDocuments;
+
 void _writeStickerSet(QDataStream &stream, const Stickers::Set &set) {
 	const auto writeInfo = [&](int count) {
 		stream
@@ -3358,23 +4008,28 @@ void _writeStickerSet(QDataStream &stream, const Stickers::Set &set) {
 	}
 
 	writeInfo(set.stickers.size());
-	for (const auto &sticker : set.stickers) {
-		Serialize::Document::writeToStream(stream, sticker);
-	}
-	stream << qint32(set.dates.size());
-	if (!set.dates.empty()) {
-		Assert(set.dates.size() == set.stickers.size());
-		for (const auto date : set.dates) {
-			stream << qint32(date);
+
+	// Documents are written as a separate block, so that they can be
+	// read only when the sets are used, not when the app is started.
+	Serialize::writeBlock(stream, [&] {
+		for (const auto &sticker : set.stickers) {
+			Serialize::Document::writeToStream(stream, sticker);
 		}
-	}
-	stream << qint32(set.emoji.size());
-	for (auto j = set.emoji.cbegin(), e = set.emoji.cend(); j != e; ++j) {
-		stream << j.key()->id() << qint32(j->size());
-		for (const auto sticker : *j) {
-			stream << quint64(sticker->id);
+		stream << qint32(set.dates.size());
+		if (!set.dates.empty()) {
+			Assert(set.dates.size() == set.stickers.size());
+			for (const auto date : set.dates) {
+				stream << qint32(date);
+			}
 		}
-	}
+		stream << qint32(set.emoji.size());
+		for (auto j = set.emoji.cbegin(), e = set.emoji.cend(); j != e; ++j) {
+			stream << j.key()->id() << qint32(j->size());
+			for (const auto sticker : *j) {
+				stream << quint64(sticker->id);
+			}
+		}
+	});
 }
 
 // In generic method _writeStickerSets() we look through all the sets and call a
@@ -3425,6 +4080,7 @@ void _writeStickerSets(FileKey &stickersKey, CheckSet checkSet, const Stickers::
 			continue;
 		}
 
+		size += sizeof(quint32); // documentsSize
 		for (const auto sticker : set.stickers) {
 			sticker->refreshStickerThumbFileReference();
 			size += Serialize::Document::sizeInStream(sticker);
@@ -3475,8 +4131,106 @@ void _writeStickerSets(FileKey &stickersKey, CheckSet checkSet, const Stickers::
 	}
 	data.stream << order;
 
-	FileWriteDescriptor file(stickersKey);
-	file.writeEncrypted(data);
+	writeEncryptedKey(stickersKey, data);
+}
+
+bool _readStickerSetDocuments(
+		Stickers::Set &set,
+		qint32 version,
+		const QByteArray &documents) {
+	QDataStream stream(documents);
+	stream.setVersion(QDataStream::Qt_5_1);
+
+	const auto inputSet = MTP_inputStickerSetID(
+		MTP_long(set.id),
+		MTP_long(set.access));
+	const auto scnt = set.count;
+	set.stickers.reserve(scnt);
+	set.count = 0;
+
+	Serialize::Document::StickerSetInfo info(set.id, set.access, set.shortName);
+	base::flat_set<DocumentId> read;
+	for (int32 j = 0; j < scnt; ++j) {
+		auto document = Serialize::Document::readStickerFromStream(version, stream, info);
+		if (!_checkStreamStatus(stream)) {
+			return false;
+		} else if (!document
+			|| !document->sticker()
+			|| read.contains(document->id)) {
+			continue;
+		}
+		read.emplace(document->id);
+		set.stickers.push_back(document);
+		if (!(set.flags & MTPDstickerSet_ClientFlag::f_special)) {
+			if (document->sticker()->set.type() != mtpc_inputStickerSetID) {
+				document->sticker()->set = inputSet;
+			}
+		}
+		++set.count;
+	}
+
+	qint32 datesCount = 0;
+	stream >> datesCount;
+	if (datesCount > 0) {
+		if (datesCount != scnt) {
+			return false;
+		}
+		const auto fillDates = (set.id == Stickers::CloudRecentSetId)
+			&& (set.stickers.size() == datesCount);
+		if (fillDates) {
+			set.dates.clear();
+			set.dates.reserve(datesCount);
+		}
+		for (auto i = 0; i != datesCount; ++i) {
+			qint32 date = 0;
+			stream >> date;
+			if (fillDates) {
+				set.dates.push_back(TimeId(date));
+			}
+		}
+	}
+
+	qint32 emojiCount = 0;
+	stream >> emojiCount;
+	if (!_checkStreamStatus(stream) || emojiCount < 0) {
+		return false;
+	}
+	for (int32 j = 0; j < emojiCount; ++j) {
+		QString emojiString;
+		qint32 stickersCount;
+		stream >> emojiString >> stickersCount;
+		Stickers::Pack pack;
+		pack.reserve(stickersCount);
+		for (int32 k = 0; k < stickersCount; ++k) {
+			quint64 id;
+			stream >> id;
+			const auto doc = Auth().data().document(id);
+			if (!doc->sticker()) continue;
+
+			pack.push_back(doc);
+		}
+		if (auto emoji = Ui::Emoji::Find(emojiString)) {
+			emoji = emoji->original();
+			set.emoji.insert(emoji, pack);
+		}
+	}
+	return _checkStreamStatus(stream);
+}
+
+void _readPendingStickerSetsDocuments() {
+	auto &sets = Auth().data().stickerSetsInfoRef();
+	for (auto &[setId, pending] : base::take(_stickerSetsDocuments)) {
+		const auto i = sets.find(setId);
+		if (i == sets.end() || !i->stickers.isEmpty()) {
+			continue;
+		} else if (!_readStickerSetDocuments(*i, pending.version, pending.documents)) {
+			LOG(("App Error: could not read documents of a sticker set."));
+			i->stickers.clear();
+			i->dates.clear();
+			i->emoji.clear();
+			i->count = 0;
+		}
+	}
 }
 
 void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr, MTPDstickerSet::Flags readingFlags = 0) {
@@ -3493,7 +4247,7 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 		stickersKey = 0;
 	};
 
-	auto &sets = Auth().data().stickerSetsRef();
+	auto &sets = Auth().data().stickerSetsInfoRef();
 	if (outOrder) outOrder->clear();
 
 	quint32 versionTag = 0;
@@ -3580,7 +4334,6 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 				Images::Create(setThumbnail)));
 		}
 		auto &set = it.value();
-		auto inputSet = MTP_inputStickerSetID(MTP_long(set.id), MTP_long(set.access));
 		const auto fillStickers = set.stickers.isEmpty();
 
 		if (scnt < 0) { // disabled not loaded set
@@ -3590,81 +4343,29 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 			continue;
 		}
 
-		if (fillStickers) {
-			set.stickers.reserve(scnt);
-			set.count = 0;
-		}
-
-		Serialize::Document::StickerSetInfo info(setId, setAccess, setShortName);
-		base::flat_set<DocumentId> read;
-		for (int32 j = 0; j < scnt; ++j) {
-			auto document = Serialize::Document::readStickerFromStream(stickers.version, stickers.stream, info);
-			if (!_checkStreamStatus(stickers.stream)) {
-				return failed();
-			} else if (!document
-				|| !document->sticker()
-				|| read.contains(document->id)) {
-				continue;
-			}
-			read.emplace(document->id);
-			if (fillStickers) {
-				set.stickers.push_back(document);
-				if (!(set.flags & MTPDstickerSet_ClientFlag::f_special)) {
-					if (document->sticker()->set.type() != mtpc_inputStickerSetID) {
-						document->sticker()->set = inputSet;
-					}
-				}
-				++set.count;
-			}
+		auto documents = QByteArray();
+		stickers.stream >> documents;
+		if (!_checkStreamStatus(stickers.stream)) {
+			return failed();
+		} else if (!fillStickers) {
+			continue;
 		}
-
-		qint32 datesCount = 0;
-		stickers.stream >> datesCount;
-		if (datesCount > 0) {
-			if (datesCount != scnt) {
+		set.count = scnt;
+		if (set.flags & MTPDstickerSet_ClientFlag::f_special) {
+			if (!_readStickerSetDocuments(set, stickers.version, documents)) {
 				return failed();
 			}
-			const auto fillDates = (set.id == Stickers::CloudRecentSetId)
-				&& (set.stickers.size() == datesCount);
-			if (fillDates) {
-				set.dates.clear();
-				set.dates.reserve(datesCount);
-			}
-			for (auto i = 0; i != datesCount; ++i) {
-				qint32 date = 0;
-				stickers.stream >> date;
-				if (fillDates) {
-					set.dates.push_back(TimeId(date));
-				}
-			}
+		} else {
+			_stickerSetsDocuments[set.id] = StickerSetDocuments{
+				stickers.version,
+				std::move(documents)
+			};
 		}
+	}
 
-		qint32 emojiCount = 0;
-		stickers.stream >> emojiCount;
-		if (!_checkStreamStatus(stickers.stream) || emojiCount < 0) {
-			return failed();
-		}
-		for (int32 j = 0; j < emojiCount; ++j) {
-			QString emojiString;
-			qint32 stickersCount;
-			stickers.stream >> emojiString >> stickersCount;
-			Stickers::Pack pack;
-			pack.reserve(stickersCount);
-			for (int32 k = 0; k < stickersCount; ++k) {
-				quint64 id;
-				stickers.stream >> id;
-				const auto doc = Auth().data().document(id);
-				if (!doc->sticker()) continue;
-
-				pack.push_back(doc);
-			}
-			if (fillStickers) {
-				if (auto emoji = Ui::Emoji::Find(emojiString)) {
-					emoji = emoji->original();
-					set.emoji.insert(emoji, pack);
-				}
-			}
-		}
+	if (!_stickerSetsDocuments.empty()) {
+		Auth().data().setStickerSetsDocumentsReader(
+			_readPendingStickerSetsDocuments);
 	}
 
 	// Read orders of installed and featured stickers.
@@ -3872,11 +4573,13 @@ void importOldRecentStickers() {
 }
 
 void readInstalledStickers() {
+	const auto trace = Core::StartupTrace::Scope("Local::readInstalledStickers", "local");
 	if (!_installedStickersKey) {
 		return importOldRecentStickers();
 	}
 
-	Auth().data().stickerSetsRef().clear();
+	Auth().data().stickerSetsInfoRef().clear();
+	_stickerSetsDocuments.clear();
 	_readStickerSets(
 		_installedStickersKey,
 		&Auth().data().stickerSetsOrderRef(),
@@ -3884,12 +4587,13 @@ void readInstalledStickers() {
 }
 
 void readFeaturedStickers() {
+	const auto trace = Core::StartupTrace::Scope("Local::readFeaturedStickers", "local");
 	_readStickerSets(
 		_featuredStickersKey,
 		&Auth().data().featuredStickerSetsOrderRef(),
 		MTPDstickerSet::Flags() | MTPDstickerSet_ClientFlag::f_featured);
 
-	auto &sets = Auth().data().stickerSets();
+	auto &sets = Auth().data().stickerSetsInfo();
 	int unreadCount = 0;
 	for_const (auto setId, Auth().data().featuredStickerSetsOrder()) {
 		auto it = sets.constFind(setId);
@@ -3901,14 +4605,17 @@ void readFeaturedStickers() {
 }
 
 void readRecentStickers() {
+	const auto trace = Core::StartupTrace::Scope("Local::readRecentStickers", "local");
 	_readStickerSets(_recentStickersKey);
 }
 
 void readFavedStickers() {
+	const auto trace = Core::StartupTrace::Scope("Local::readFavedStickers", "local");
 	_readStickerSets(_favedStickersKey);
 }
 
 void readArchivedStickers() {
+	const auto trace = Core::StartupTrace::Scope("Local::readArchivedStickers", "local");
 	static bool archivedStickersRead = false;
 	if (!archivedStickersRead) {
 		_readStickerSets(_archivedStickersKey, &Auth().data().archivedStickerSetsOrderRef());
@@ -3927,7 +4634,7 @@ int32 countDocumentVectorHash(const QVector<DocumentData*> vector) {
 }
 
 int32 countSpecialStickerSetHash(uint64 setId) {
-	auto &sets = Auth().data().stickerSets();
+	auto &sets = Auth().data().stickerSetsInfo();
 	auto it = sets.constFind(setId);
 	if (it != sets.cend()) {
 		return countDocumentVectorHash(it->stickers);
@@ -3938,7 +4645,7 @@ int32 countSpecialStickerSetHash(uint64 setId) {
 int32 countStickersHash(bool checkOutdatedInfo) {
 	uint32 acc = 0;
 	bool foundOutdated = false;
-	auto &sets = Auth().data().stickerSets();
+	auto &sets = Auth().data().stickerSetsInfo();
 	auto &order = Auth().data().stickerSetsOrder();
 	for (auto i = order.cbegin(), e = order.cend(); i != e; ++i) {
 		auto j = sets.constFind(*i);
@@ -3964,7 +4671,7 @@ int32 countFavedStickersHash() {
 
 int32 countFeaturedStickersHash() {
 	uint32 acc = 0;
-	auto &sets = Auth().data().stickerSets();
+	auto &sets = Auth().data().stickerSetsInfo();
 	auto &featured = Auth().data().featuredStickerSetsOrder();
 	for_const (auto setId, featured) {
 		acc = (acc * 20261) + uint32(setId >> 32);
@@ -4009,12 +4716,12 @@ void writeSavedGifs() {
 		for_const (auto gif, saved) {
 			Serialize::Document::writeToStream(data.stream, gif);
 		}
-		FileWriteDescriptor file(_savedGifsKey);
-		file.writeEncrypted(data);
+		writeEncryptedKey(_savedGifsKey, data);
 	}
 }
 
 void readSavedGifs() {
+	const auto trace = Core::StartupTrace::Scope("Local::readSavedGifs", "local");
 	if (!_savedGifsKey) return;
 
 	FileReadDescriptor gifs;
@@ -4114,6 +4821,7 @@ void writeBackground(const Data::WallPaper &paper, const QImage &image) {
 }
 
 bool readBackground() {
+	const auto trace = Core::StartupTrace::Scope("Local::readBackground", "local");
 	FileReadDescriptor bg;
 	auto &backgroundKey = Window::Theme::IsNightMode()
 		? _backgroundKeyNight
@@ -4351,6 +5059,7 @@ void loadTheme() {
 }
 
 Window::Theme::Saved readThemeAfterSwitch() {
+	const auto trace = Core::StartupTrace::Scope("Local::readThemeAfterSwitch", "local");
 	const auto key = Window::Theme::IsNightMode()
 		? _themeKeyNight
 		: _themeKeyDay;
@@ -4358,6 +5067,7 @@ Window::Theme::Saved readThemeAfterSwitch() {
 }
 
 void readLangPack() {
+	const auto trace = Core::StartupTrace::Scope("Local::readLangPack", "local");
 	FileReadDescriptor langpack;
 	if (!_langPackKey || !readEncryptedFile(langpack, _langPackKey, FileOption::Safe, SettingsKey)) {
 		return;
@@ -4448,6 +5158,7 @@ void removeRecentLanguage(const QString &id) {
 }
 
 std::vector<Lang::Language> readRecentLanguages() {
+	const auto trace = Core::StartupTrace::Scope("Local::readRecentLanguages", "local");
 	FileReadDescriptor languages;
 	if (!_languagesKey || !readEncryptedFile(languages, _languagesKey, FileOption::Safe, SettingsKey)) {
 		return {};
@@ -4545,12 +5256,12 @@ void writeRecentHashtagsAndBots() {
 		for (auto i = bots.cbegin(), e = bots.cend(); i != e; ++i) {
 			Serialize::writePeer(data.stream, *i);
 		}
-		FileWriteDescriptor file(_recentHashtagsAndBotsKey);
-		file.writeEncrypted(data);
+		writeEncryptedKey(_recentHashtagsAndBotsKey, data);
 	}
 }
 
 void readRecentHashtagsAndBots() {
+	const auto trace = Core::StartupTrace::Scope("Local::readRecentHashtagsAndBots", "local");
 	if (_recentHashtagsAndBotsWereRead) return;
 	_recentHashtagsAndBotsWereRead = true;
 
@@ -4759,12 +5470,12 @@ void WriteExportSettings(const Export::Settings &settings) {
 		data.stream << qint32(settings.singlePeerFrom);
 		data.stream << qint32(settings.singlePeerTill);
 
-		FileWriteDescriptor file(_exportSettingsKey);
-		file.writeEncrypted(data);
+		writeEncryptedKey(_exportSettingsKey, data);
 	}
 }
 
 Export::Settings ReadExportSettings() {
+	const auto trace = Core::StartupTrace::Scope("Local::ReadExportSettings", "local");
 	FileReadDescriptor file;
 	if (!readEncryptedFile(file, _exportSettingsKey)) {
 		clearKey(_exportSettingsKey);
@@ -4842,6 +5553,46 @@ void writeReportSpamStatuses() {
 	_writeReportSpamStatuses();
 }
 
+void writeDialogsSnapshot(const QByteArray &serialized) {
+	if (!_working()) return;
+
+	if (serialized.isEmpty()) {
+		if (_dialogsSnapshotKey) {
+			clearKey(_dialogsSnapshotKey);
+			_dialogsSnapshotKey = 0;
+			_mapChanged = true;
+		}
+		_writeMap();
+		return;
+	}
+	if (!_dialogsSnapshotKey) {
+		_dialogsSnapshotKey = genKey();
+		_mapChanged = true;
+		_writeMap(WriteMapWhen::Fast);
+	}
+	EncryptedDescriptor data(Serialize::bytearraySize(serialized));
+	data.stream << serialized;
+
+	writeEncryptedKey(_dialogsSnapshotKey, data);
+}
+
+QByteArray readDialogsSnapshot() {
+	const auto trace = Core::StartupTrace::Scope("Local::readDialogsSnapshot", "local");
+	if (!_dialogsSnapshotKey) {
+		return QByteArray();
+	}
+	FileReadDescriptor file;
+	if (!readEncryptedFile(file, _dialogsSnapshotKey)) {
+		clearKey(_dialogsSnapshotKey);
+		_dialogsSnapshotKey = 0;
+		_writeMap();
+		return QByteArray();
+	}
+	auto result = QByteArray();
+	file.stream >> result;
+	return _checkStreamStatus(file.stream) ? result : QByteArray();
+}
+
 void writeSelf() {
 	_mapChanged = true;
 	_writeMap();
@@ -4889,8 +5640,7 @@ void writeTrustedBots() {
 			data.stream << quint64(botId);
 		}
 
-		FileWriteDescriptor file(_trustedBotsKey);
-		file.writeEncrypted(data);
+		writeEncryptedKey(_trustedBotsKey, data);
 	}
 }
 
@@ -4964,6 +5714,7 @@ bool ClearManager::addTask(int task) {
 	if (!data->tasks.isEmpty() && (data->tasks.at(0) == ClearManagerAll)) return true;
 	if (task == ClearManagerAll) {
 		data->tasks.clear();
+		cancelPendingUserFiles();
 		if (!_draftsMap.isEmpty()) {
 			_draftsMap.clear();
 			_mapChanged = true;
@@ -4996,6 +5747,10 @@ bool ClearManager::addTask(int task) {
 			_recentHashtagsAndBotsKey = 0;
 			_mapChanged = true;
 		}
+		if (_dialogsSnapshotKey) {
+			_dialogsSnapshotKey = 0;
+			_mapChanged = true;
+		}
 		_writeMap();
 	} else {
 		for (int32 i = 0, l = data->tasks.size(); i < l; ++i) {
@@ -5095,6 +5850,8 @@ void ClearManager::onStart() {
 namespace internal {
 
 Manager::Manager() {
+	_filesWriteTimer.setSingleShot(true);
+	connect(&_filesWriteTimer, SIGNAL(timeout()), this, SLOT(filesWriteTimeout()));
 	_mapWriteTimer.setSingleShot(true);
 	connect(&_mapWriteTimer, SIGNAL(timeout()), this, SLOT(mapWriteTimeout()));
 	_locationsWriteTimer.setSingleShot(true);
@@ -5113,6 +5870,12 @@ void Manager::writingMap() {
 	_mapWriteTimer.stop();
 }
 
+void Manager::writeFiles() {
+	if (!_filesWriteTimer.isActive()) {
+		_filesWriteTimer.start(kWriteFilesTimeout);
+	}
+}
+
 void Manager::writeLocations(bool fast) {
 	if (!_locationsWriteTimer.isActive() || fast) {
 		_locationsWriteTimer.start(fast ? 1 : kWriteMapTimeout);
@@ -5133,6 +5896,10 @@ void Manager::locationsWriteTimeout() {
 	_writeLocations(WriteMapWhen::Now);
 }
 
+void Manager::filesWriteTimeout() {
+	crl::async(writePendingFiles);
+}
+
 void Manager::finish() {
 	if (_mapWriteTimer.isActive()) {
 		mapWriteTimeout();
@@ -5140,6 +5907,8 @@ void Manager::finish() {
 	if (_locationsWriteTimer.isActive()) {
 		locationsWriteTimeout();
 	}
+	_filesWriteTimer.stop();
+	writePendingFiles();
 }
 
 } // namespace internal
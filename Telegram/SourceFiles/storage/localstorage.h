@@ -24,6 +24,11 @@ namespace Storage {
 class EncryptionKey;
 } // namespace Storage
 
+namespace MTP {
+class AuthKey;
+using AuthKeyPtr = std::shared_ptr<AuthKey>;
+} // namespace MTP
+
 namespace Window {
 namespace Theme {
 struct Saved;
@@ -49,8 +54,10 @@ QString readAutoupdatePrefix();
 
 void reset();
 
-bool checkPasscode(const QByteArray &passcode);
-void setPasscode(const QByteArray &passcode);
+// The passcode key derivation is slow on purpose, so it is done on a
+// background thread and "done" is called on the main thread.
+void checkPasscode(const QByteArray &passcode, Fn<void(bool)> done);
+void setPasscode(const QByteArray &passcode, Fn<void()> done);
 
 enum ClearManagerTask {
 	ClearManagerAll = 0xFFFF,
@@ -88,7 +95,13 @@ enum ReadMapState {
 	ReadMapDone = 1,
 	ReadMapPassNeeded = 2,
 };
-ReadMapState readMap(const QByteArray &pass);
+ReadMapState readMap(
+	const QByteArray &pass,
+	MTP::AuthKeyPtr passKey = nullptr);
+
+// Derives the passcode key on a background thread, then reads the map.
+void readMapAsync(const QByteArray &pass, Fn<void(ReadMapState)> done);
+
 int32 oldMapVersion();
 
 int32 oldSettingsVersion();
@@ -124,6 +137,9 @@ Storage::EncryptionKey cacheBigFileKey();
 QString cacheBigFilePath();
 Storage::Cache::Database::Settings cacheBigFileSettings();
 
+QString cacheMessagesPath();
+Storage::Cache::Database::Settings cacheMessagesSettings();
+
 void countVoiceWaveform(DocumentData *document);
 
 void cancelTask(TaskId id);
@@ -171,6 +187,10 @@ Export::Settings ReadExportSettings();
 
 void writeReportSpamStatuses();
 
+// Pinned and top chats as they were received, shown until a new list.
+void writeDialogsSnapshot(const QByteArray &serialized);
+QByteArray readDialogsSnapshot();
+
 void writeSelf();
 void readSelf(const QByteArray &serialized, int32 streamVersion);
 
@@ -188,6 +208,7 @@ class Manager : public QObject {
 public:
 	Manager();
 
+	void writeFiles();
 	void writeMap(bool fast);
 	void writingMap();
 	void writeLocations(bool fast);
@@ -197,8 +218,10 @@ public:
 public slots:
 	void mapWriteTimeout();
 	void locationsWriteTimeout();
+	void filesWriteTimeout();
 
 private:
+	QTimer _filesWriteTimer;
 	QTimer _mapWriteTimer;
 	QTimer _locationsWriteTimer;
 
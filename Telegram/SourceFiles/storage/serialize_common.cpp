@@ -59,7 +59,11 @@ int storageImageLocationSize(const StorageImageLocation &location) {
 void writeStorageImageLocation(
 		QDataStream &stream,
 		const StorageImageLocation &location) {
-	stream << kModernImageLocationTag << location.serialize();
+	// Same as writing location.serialize(), without a temporary QByteArray.
+	stream
+		<< kModernImageLocationTag
+		<< quint32(location.serializeSize());
+	location.writeToStream(stream);
 }
 
 std::optional<StorageImageLocation> readStorageImageLocation(
@@ -80,6 +80,24 @@ inline QDataStream &operator<<(QDataStream &stream, ReadBytesVectorWrap data) {
 	return stream << WriteBytesWrap { data.bytes };
 }
 
+// Compatible with QDataStream &operator>>(QDataStream &, QByteArray &),
+// the block is written straight to the stream device and the length is
+// filled after that, so the device should support seeking.
+template <typename Method>
+void writeBlock(QDataStream &stream, Method &&method) {
+	const auto device = stream.device();
+
+	Expects(device != nullptr && !device->isSequential());
+
+	const auto start = device->pos();
+	stream << quint32(0);
+	method();
+	const auto till = device->pos();
+	device->seek(start);
+	stream << quint32(till - start - sizeof(quint32));
+	device->seek(till);
+}
+
 inline int dateTimeSize() {
 	return (sizeof(qint64) + sizeof(quint32) + sizeof(qint8));
 }
@@ -8,11 +8,18 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/storage_encrypted_file.h"
 
 #include "base/openssl_help.h"
+#include "base/algorithm.h"
+#include <crl/crl_async.h>
+#include <crl/crl_semaphore.h>
+#include <atomic>
 
 namespace Storage {
 namespace {
 
 constexpr auto kBlockSize = CtrState::kBlockSize;
+constexpr auto kParallelChunkSize = size_type(512 * 1024);
+constexpr auto kParallelChunksMin = 4;
+constexpr auto kParallelThreadsMax = 4;
 
 enum class Format : uint32 {
 	Format_0,
@@ -41,6 +48,53 @@ BasicHeader::BasicHeader()
 , reserved1(0) {
 }
 
+// CTR mode has no dependencies between blocks, so large spans
+// (binlog read blocks, big cached values) are decrypted in chunks.
+//
+// Chunks are claimed from a shared counter both by the calling thread
+// and by the helpers, so the caller never waits for a helper that
+// wasn't scheduled yet and no deadlock is possible on a busy pool.
+void DecryptParallel(CtrState &state, bytes::span bytes, int64 offset) {
+	static_assert(kParallelChunkSize % kBlockSize == 0);
+
+	struct Shared {
+		std::atomic<int> next = 0;
+		std::atomic<int> left = 0;
+		crl::semaphore finished;
+	};
+	const auto count = int((bytes.size() + kParallelChunkSize - 1)
+		/ kParallelChunkSize);
+	const auto shared = std::make_shared<Shared>();
+	shared->left = count;
+
+	// Only dereferenced after a successful claim, so helpers that start
+	// after all the work is done never touch the (dead) span or state.
+	const auto process = [=, state = &state](int index) {
+		const auto from = index * kParallelChunkSize;
+		const auto size = std::min(kParallelChunkSize, bytes.size() - from);
+		state->decrypt(bytes.subspan(from, size), offset + from);
+	};
+	const auto work = [=] {
+		while (true) {
+			const auto index = shared->next.fetch_add(1);
+			if (index >= count) {
+				return;
+			}
+			process(index);
+			if (shared->left.fetch_sub(1) == 1) {
+				shared->finished.release();
+			}
+		}
+	};
+	const auto helpers = std::min(count, kParallelThreadsMax) - 1;
+	for (auto i = 0; i != helpers; ++i) {
+		crl::async(work);
+	}
+	work();
+	shared->finished.acquire();
+}
+
+
 } // namespace
 
 File::Result File::open(
@@ -75,6 +129,7 @@ File::Result File::open(
 File::Result File::attemptOpen(Mode mode, const EncryptionKey &key) {
 	switch (mode) {
 	case Mode::Read: return attemptOpenForRead(key);
+	case Mode::ReadMapped: return attemptOpenForReadMapped(key);
 	case Mode::ReadAppend: return attemptOpenForReadAppend(key);
 	case Mode::Write: return attemptOpenForWrite(key);
 	}
@@ -88,6 +143,22 @@ File::Result File::attemptOpenForRead(const EncryptionKey &key) {
 	return readHeader(key);
 }
 
+File::Result File::attemptOpenForReadMapped(const EncryptionKey &key) {
+	if (!_data.open(QIODevice::ReadOnly)) {
+		return Result::Failed;
+	}
+	const auto size = _data.size();
+	if (size > 0) {
+		// If mapping fails (f.e. on some network file systems)
+		// we just fall back to the usual buffered reading.
+		if ((_mapped = _data.map(0, size))) {
+			_mappedSize = size;
+			_mappedPosition = 0;
+		}
+	}
+	return readHeader(key);
+}
+
 File::Result File::attemptOpenForReadAppend(const EncryptionKey &key) {
 	if (!_lock.lock(_data, QIODevice::ReadWrite)) {
 		return Result::LockFailed;
@@ -138,9 +209,9 @@ bool File::writeHeader(const EncryptionKey &key) {
 
 File::Result File::readHeader(const EncryptionKey &key) {
 	Expects(!_state.has_value());
-	Expects(_data.pos() == 0);
+	Expects(positionPlain() == 0);
 
-	if (!_data.seek(FileLock::kSkipBytes)) {
+	if (!seekPlain(FileLock::kSkipBytes)) {
 		return Result::Failed;
 	}
 	auto header = BasicHeader();
@@ -171,6 +242,17 @@ File::Result File::readHeader(const EncryptionKey &key) {
 }
 
 size_type File::readPlain(bytes::span bytes) {
+	if (_mapped) {
+		const auto available = std::max(
+			_mappedSize - _mappedPosition,
+			int64(0));
+		const auto count = std::min(int64(bytes.size()), available);
+		if (count > 0) {
+			memcpy(bytes.data(), _mapped + _mappedPosition, count);
+			_mappedPosition += count;
+		}
+		return size_type(count);
+	}
 	return _data.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
 }
 
@@ -180,10 +262,28 @@ size_type File::writePlain(bytes::const_span bytes) {
 		bytes.size());
 }
 
+int64 File::positionPlain() const {
+	return _mapped ? _mappedPosition : _data.pos();
+}
+
+bool File::seekPlain(int64 position) {
+	if (!_mapped) {
+		return _data.seek(position);
+	} else if (position < 0 || position > _mappedSize) {
+		return false;
+	}
+	_mappedPosition = position;
+	return true;
+}
+
 void File::decrypt(bytes::span bytes) {
 	Expects(_state.has_value());
 
-	_state->decrypt(bytes, _encryptionOffset);
+	if (bytes.size() >= kParallelChunkSize * kParallelChunksMin) {
+		DecryptParallel(*_state, bytes, _encryptionOffset);
+	} else {
+		_state->decrypt(bytes, _encryptionOffset);
+	}
 	_encryptionOffset += bytes.size();
 }
 
@@ -199,7 +299,7 @@ size_type File::read(bytes::span bytes) {
 
 	auto count = readPlain(bytes);
 	if (const auto back = -(count % kBlockSize)) {
-		if (!_data.seek(_data.pos() + back)) {
+		if (!seekPlain(positionPlain() + back)) {
 			return 0;
 		}
 		count += back;
@@ -291,6 +391,10 @@ bool File::flush() {
 }
 
 void File::close() {
+	if (const auto mapped = base::take(_mapped)) {
+		_data.unmap(mapped);
+	}
+	_mappedSize = _mappedPosition = 0;
 	_lock.unlock();
 	_data.close();
 	_data.setFileName(QString());
@@ -316,7 +420,7 @@ bool File::seek(int64 offset) {
 	const auto realOffset = sizeof(BasicHeader) + offset;
 	if (offset < 0 || offset > _dataSize) {
 		return false;
-	} else if (!_data.seek(FileLock::kSkipBytes + realOffset)) {
+	} else if (!seekPlain(FileLock::kSkipBytes + realOffset)) {
 		return false;
 	}
 	_encryptionOffset = realOffset - kSaltSize;
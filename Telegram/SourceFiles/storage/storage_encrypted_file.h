@@ -18,6 +18,7 @@ class File {
 public:
 	enum class Mode {
 		Read,
+		ReadMapped,
 		ReadAppend,
 		Write,
 	};
@@ -49,6 +50,7 @@ public:
 private:
 	Result attemptOpen(Mode mode, const EncryptionKey &key);
 	Result attemptOpenForRead(const EncryptionKey &key);
+	Result attemptOpenForReadMapped(const EncryptionKey &key);
 	Result attemptOpenForReadAppend(const EncryptionKey &key);
 	Result attemptOpenForWrite(const EncryptionKey &key);
 
@@ -57,6 +59,8 @@ private:
 
 	size_type readPlain(bytes::span bytes);
 	size_type writePlain(bytes::const_span bytes);
+	int64 positionPlain() const;
+	bool seekPlain(int64 position);
 	void decrypt(bytes::span bytes);
 	void encrypt(bytes::span bytes);
 	void decryptBack(bytes::span bytes);
@@ -66,6 +70,11 @@ private:
 	int64 _encryptionOffset = 0;
 	int64 _dataSize = 0;
 
+	// In ReadMapped mode the whole file is mapped and read without syscalls.
+	uchar *_mapped = nullptr;
+	int64 _mappedSize = 0;
+	int64 _mappedPosition = 0;
+
 	std::optional<CtrState> _state;
 
 };
@@ -160,6 +160,25 @@ TEST_CASE("simple encrypted file", "[storage_encrypted_file]") {
 		REQUIRE(read == data.size());
 		REQUIRE(data == bytes::concatenate(Test1, Test1));
 	}
+	SECTION("reading mapped file") {
+		Storage::File file;
+
+		const auto result = file.open(
+			Name,
+			Storage::File::Mode::ReadMapped,
+			Key);
+		REQUIRE(result == Storage::File::Result::Success);
+
+		auto data = bytes::vector(32);
+		const auto read = file.read(data);
+		REQUIRE(read == data.size());
+		REQUIRE(data == bytes::concatenate(Test1, Test1));
+
+		REQUIRE(file.seek(Test1.size()));
+		auto tail = bytes::vector(64);
+		const auto last = file.read(tail);
+		REQUIRE(last == 2 * Test1.size());
+	}
 	SECTION("moving file") {
 		const auto result = Storage::File::Move(Name, "other.file");
 		REQUIRE(result);
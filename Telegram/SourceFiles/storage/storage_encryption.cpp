@@ -19,31 +19,33 @@ CtrState::CtrState(bytes::const_span key, bytes::const_span iv) {
 	bytes::copy(_iv, iv);
 }
 
-template <typename Method>
-void CtrState::process(bytes::span data, int64 offset, Method method) {
+void CtrState::process(bytes::span data, int64 offset) {
 	Expects((data.size() % kBlockSize) == 0);
 	Expects((offset % kBlockSize) == 0);
+	Expects(data.size() <= std::numeric_limits<int>::max());
 
-	AES_KEY aes;
-	AES_set_encrypt_key(
-		reinterpret_cast<const uchar*>(_key.data()),
-		_key.size() * CHAR_BIT,
-		&aes);
+	// EVP uses hardware AES instructions when the CPU supports them.
+	const auto context = EVP_CIPHER_CTX_new();
+	Assert(context != nullptr);
+	const auto guard = gsl::finally([&] { EVP_CIPHER_CTX_free(context); });
 
-	unsigned char ecountBuf[kBlockSize] = { 0 };
-	unsigned int offsetInBlock = 0;
 	const auto blockIndex = offset / kBlockSize;
 	auto iv = incrementedIv(blockIndex);
+	EVP_EncryptInit_ex(
+		context,
+		EVP_aes_256_ctr(),
+		nullptr,
+		reinterpret_cast<const uchar*>(_key.data()),
+		reinterpret_cast<const uchar*>(iv.data()));
 
-	CRYPTO_ctr128_encrypt(
-		reinterpret_cast<const uchar*>(data.data()),
+	auto written = 0;
+	EVP_EncryptUpdate(
+		context,
 		reinterpret_cast<uchar*>(data.data()),
-		data.size(),
-		&aes,
-		reinterpret_cast<unsigned char*>(iv.data()),
-		ecountBuf,
-		&offsetInBlock,
-		(block128_f)method);
+		&written,
+		reinterpret_cast<const uchar*>(data.data()),
+		int(data.size()));
+	Assert(written == data.size());
 }
 
 auto CtrState::incrementedIv(int64 blockIndex)
@@ -66,11 +68,11 @@ auto CtrState::incrementedIv(int64 blockIndex)
 }
 
 void CtrState::encrypt(bytes::span data, int64 offset) {
-	return process(data, offset, AES_encrypt);
+	return process(data, offset);
 }
 
 void CtrState::decrypt(bytes::span data, int64 offset) {
-	return process(data, offset, AES_encrypt);
+	return process(data, offset);
 }
 
 EncryptionKey::EncryptionKey(bytes::vector &&data)
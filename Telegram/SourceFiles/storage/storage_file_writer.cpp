@@ -0,0 +1,220 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "storage/storage_file_writer.h"
+
+#include "platform/platform_file_utilities.h"
+
+#include <crl/crl_semaphore.h>
+
+namespace Storage {
+namespace {
+
+constexpr auto kMaxBufferSize = 1024 * 1024;
+
+} // namespace
+
+class FileWriterObject {
+public:
+	FileWriterObject(
+		crl::weak_on_queue<FileWriterObject> weak,
+		base::weak_ptr<FileWriter> owner,
+		std::shared_ptr<std::atomic<int>> queued,
+		const QString &path,
+		FileWriter::Mode mode,
+		int64 preallocateSize);
+
+	void write(int offset, QByteArray &&bytes);
+	QByteArray read(int offset, int size);
+	bool close();
+
+private:
+	void writeBuffer();
+	void fail();
+
+	base::weak_ptr<FileWriter> _owner;
+	std::shared_ptr<std::atomic<int>> _queued;
+	QFile _file;
+	bool _failed = false;
+
+	int _bufferOffset = 0;
+	QByteArray _buffer;
+	std::vector<int> _bufferParts;
+
+};
+
+FileWriterObject::FileWriterObject(
+	crl::weak_on_queue<FileWriterObject> weak,
+	base::weak_ptr<FileWriter> owner,
+	std::shared_ptr<std::atomic<int>> queued,
+	const QString &path,
+	FileWriter::Mode mode,
+	int64 preallocateSize)
+: _owner(std::move(owner))
+, _queued(std::move(queued))
+, _file(path) {
+	const auto flags = (mode == FileWriter::Mode::Create)
+		? (QIODevice::ReadWrite | QIODevice::Truncate)
+		: QIODevice::ReadWrite;
+	if (!_file.open(flags)) {
+		fail();
+	} else if (preallocateSize > 0) {
+		Platform::File::PreallocateFile(_file, preallocateSize);
+	}
+}
+
+void FileWriterObject::write(int offset, QByteArray &&bytes) {
+	if (!_buffer.isEmpty() && offset != _bufferOffset + _buffer.size()) {
+		writeBuffer();
+	}
+	if (_buffer.isEmpty()) {
+		_bufferOffset = offset;
+		_buffer = std::move(bytes);
+	} else {
+		_buffer.append(bytes);
+	}
+	_bufferParts.push_back(offset);
+
+	// Wait for the next part only if it is already queued.
+	if (--*_queued == 0 || _buffer.size() >= kMaxBufferSize) {
+		writeBuffer();
+	}
+}
+
+void FileWriterObject::writeBuffer() {
+	if (_buffer.isEmpty()) {
+		return;
+	}
+	const auto written = !_failed
+		&& _file.seek(_bufferOffset)
+		&& (_file.write(_buffer) == qint64(_buffer.size()))
+		&& _file.flush();
+	_buffer = QByteArray();
+	auto parts = base::take(_bufferParts);
+	if (!written) {
+		fail();
+		return;
+	}
+	crl::on_main(_owner, [owner = _owner, parts = std::move(parts)]() mutable {
+		owner->written(std::move(parts));
+	});
+}
+
+void FileWriterObject::fail() {
+	if (_failed) {
+		return;
+	}
+	_failed = true;
+	crl::on_main(_owner, [owner = _owner] {
+		owner->failed();
+	});
+}
+
+QByteArray FileWriterObject::read(int offset, int size) {
+	writeBuffer();
+	if (_failed || !_file.seek(offset)) {
+		return QByteArray();
+	}
+	auto result = _file.read(size);
+	return (result.size() == size) ? result : QByteArray();
+}
+
+bool FileWriterObject::close() {
+	writeBuffer();
+	if (_file.isOpen()) {
+		_file.close();
+	}
+	return !_failed;
+}
+
+FileWriter::FileWriter(
+	const QString &path,
+	Mode mode,
+	int64 existingSize,
+	int64 preallocateSize,
+	Fn<void(std::vector<int> &&offsets)> written,
+	Fn<void()> failed)
+: _written(std::move(written))
+, _failed(std::move(failed))
+, _size(existingSize)
+, _queuedCount(std::make_shared<std::atomic<int>>(0))
+, _wrapped(
+	base::make_weak(this),
+	_queuedCount,
+	path,
+	mode,
+	preallocateSize) {
+}
+
+template <typename Method>
+void FileWriter::sync(Method &&method) {
+	auto semaphore = crl::semaphore();
+	_wrapped.with([&](Implementation &unwrapped) {
+		method(unwrapped);
+		semaphore.release();
+	});
+	semaphore.acquire();
+}
+
+int64 FileWriter::size() const {
+	return _size;
+}
+
+void FileWriter::write(int offset, QByteArray &&bytes) {
+	Expects(!bytes.isEmpty());
+
+	_size = std::max(_size, int64(offset) + bytes.size());
+	_queued.emplace(offset);
+	++*_queuedCount;
+	_wrapped.with([
+		=,
+		bytes = std::move(bytes)
+	](Implementation &unwrapped) mutable {
+		unwrapped.write(offset, std::move(bytes));
+	});
+}
+
+QByteArray FileWriter::read(int offset, int size) {
+	auto result = QByteArray();
+	sync([&](Implementation &unwrapped) {
+		result = unwrapped.read(offset, size);
+	});
+	return result;
+}
+
+bool FileWriter::finish() {
+	auto result = false;
+	sync([&](Implementation &unwrapped) {
+		result = unwrapped.close();
+	});
+
+	// Everything queued is on disk now, the posted reports are not needed.
+	invalidate_weak_ptrs(this);
+	auto offsets = std::vector<int>(begin(_queued), end(_queued));
+	_queued.clear();
+	if (result && !offsets.empty()) {
+		_written(std::move(offsets));
+	}
+	return result;
+}
+
+void FileWriter::written(std::vector<int> &&offsets) {
+	for (const auto offset : offsets) {
+		_queued.remove(offset);
+	}
+	_written(std::move(offsets));
+}
+
+void FileWriter::failed() {
+	if (const auto callback = base::take(_failed)) {
+		callback();
+	}
+}
+
+FileWriter::~FileWriter() = default;
+
+} // namespace Storage
@@ -0,0 +1,68 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/weak_ptr.h"
+#include "base/flat_set.h"
+
+#include <crl/crl_object_on_queue.h>
+
+namespace Storage {
+
+class FileWriterObject;
+
+// Writes the loaded file parts on a background queue, the sequential
+// parts that are queued together are written by one call.
+class FileWriter final : public base::has_weak_ptr {
+public:
+	enum class Mode {
+		Create,
+		Resume,
+	};
+
+	// Callbacks are called on the main thread, "written" gets the offsets
+	// of the parts that are on disk now.
+	FileWriter(
+		const QString &path,
+		Mode mode,
+		int64 existingSize,
+		int64 preallocateSize,
+		Fn<void(std::vector<int> &&offsets)> written,
+		Fn<void()> failed);
+	FileWriter(const FileWriter &other) = delete;
+	FileWriter &operator=(const FileWriter &other) = delete;
+	~FileWriter();
+
+	[[nodiscard]] int64 size() const;
+	void write(int offset, QByteArray &&bytes);
+
+	// These wait for all the queued writes to finish.
+	[[nodiscard]] QByteArray read(int offset, int size);
+	[[nodiscard]] bool finish();
+
+private:
+	using Implementation = FileWriterObject;
+
+	template <typename Method>
+	void sync(Method &&method);
+
+	void written(std::vector<int> &&offsets);
+	void failed();
+
+	Fn<void(std::vector<int> &&offsets)> _written;
+	Fn<void()> _failed;
+	int64 _size = 0;
+	base::flat_set<int> _queued;
+	const std::shared_ptr<std::atomic<int>> _queuedCount;
+	crl::object_on_queue<Implementation> _wrapped;
+
+	friend class FileWriterObject;
+
+};
+
+} // namespace Storage
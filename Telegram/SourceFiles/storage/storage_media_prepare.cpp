@@ -52,6 +52,52 @@ QSize PrepareShownDimensions(const QImage &preview) {
 		: result;
 }
 
+void PrepareAlbumMedia(PreparedFile &file, int previewWidth) {
+	if (!file.path.isEmpty()) {
+		file.mime = Core::MimeTypeForFile(QFileInfo(file.path)).name();
+		file.information = FileLoadTask::ReadMediaInformation(
+			file.path,
+			QByteArray(),
+			file.mime);
+	} else if (!file.content.isEmpty()) {
+		file.mime = Core::MimeTypeForData(file.content).name();
+		file.information = FileLoadTask::ReadMediaInformation(
+			QString(),
+			file.content,
+			file.mime);
+	} else {
+		Assert(file.information != nullptr);
+	}
+
+	using Image = FileMediaInformation::Image;
+	using Video = FileMediaInformation::Video;
+	if (const auto image = base::get_if<Image>(
+			&file.information->media)) {
+		if (ValidPhotoForAlbum(*image)) {
+			file.shownDimensions = PrepareShownDimensions(image->data);
+			file.preview = Images::prepareOpaque(image->data.scaledToWidth(
+				std::min(previewWidth, ConvertScale(image->data.width()))
+					* cIntRetinaFactor(),
+				Qt::SmoothTransformation));
+			Assert(!file.preview.isNull());
+			file.preview.setDevicePixelRatio(cRetinaFactor());
+			file.type = PreparedFile::AlbumType::Photo;
+		}
+	} else if (const auto video = base::get_if<Video>(
+			&file.information->media)) {
+		if (ValidVideoForAlbum(*video)) {
+			auto blurred = Images::prepareBlur(Images::prepareOpaque(video->thumbnail));
+			file.shownDimensions = PrepareShownDimensions(video->thumbnail);
+			file.preview = std::move(blurred).scaledToWidth(
+				previewWidth * cIntRetinaFactor(),
+				Qt::SmoothTransformation);
+			Assert(!file.preview.isNull());
+			file.preview.setDevicePixelRatio(cRetinaFactor());
+			file.type = PreparedFile::AlbumType::Video;
+		}
+	}
+}
+
 bool PrepareAlbumMediaIsWaiting(
 		QSemaphore &semaphore,
 		PreparedFile &file,
@@ -59,53 +105,21 @@ bool PrepareAlbumMediaIsWaiting(
 	// TODO: Use some special thread queue, like a separate QThreadPool.
 	crl::async([=, &semaphore, &file] {
 		const auto guard = gsl::finally([&] { semaphore.release(); });
-		if (!file.path.isEmpty()) {
-			file.mime = Core::MimeTypeForFile(QFileInfo(file.path)).name();
-			file.information = FileLoadTask::ReadMediaInformation(
-				file.path,
-				QByteArray(),
-				file.mime);
-		} else if (!file.content.isEmpty()) {
-			file.mime = Core::MimeTypeForData(file.content).name();
-			file.information = FileLoadTask::ReadMediaInformation(
-				QString(),
-				file.content,
-				file.mime);
-		} else {
-			Assert(file.information != nullptr);
-		}
-
-		using Image = FileMediaInformation::Image;
-		using Video = FileMediaInformation::Video;
-		if (const auto image = base::get_if<Image>(
-				&file.information->media)) {
-			if (ValidPhotoForAlbum(*image)) {
-				file.shownDimensions = PrepareShownDimensions(image->data);
-				file.preview = Images::prepareOpaque(image->data.scaledToWidth(
-					std::min(previewWidth, ConvertScale(image->data.width()))
-						* cIntRetinaFactor(),
-					Qt::SmoothTransformation));
-				Assert(!file.preview.isNull());
-				file.preview.setDevicePixelRatio(cRetinaFactor());
-				file.type = PreparedFile::AlbumType::Photo;
-			}
-		} else if (const auto video = base::get_if<Video>(
-				&file.information->media)) {
-			if (ValidVideoForAlbum(*video)) {
-				auto blurred = Images::prepareBlur(Images::prepareOpaque(video->thumbnail));
-				file.shownDimensions = PrepareShownDimensions(video->thumbnail);
-				file.preview = std::move(blurred).scaledToWidth(
-					previewWidth * cIntRetinaFactor(),
-					Qt::SmoothTransformation);
-				Assert(!file.preview.isNull());
-				file.preview.setDevicePixelRatio(cRetinaFactor());
-				file.type = PreparedFile::AlbumType::Video;
-			}
-		}
+		PrepareAlbumMedia(file, previewWidth);
 	});
 	return true;
 }
 
+void CheckAlbumIsPossible(PreparedList &result) {
+	if (result.albumIsPossible) {
+		const auto badIt = ranges::find(
+			result.files,
+			PreparedFile::AlbumType::None,
+			[](const PreparedFile &file) { return file.type; });
+		result.albumIsPossible = (badIt == result.files.end());
+	}
+}
+
 void PrepareAlbum(PreparedList &result, int previewWidth) {
 	const auto count = int(result.files.size());
 	if (count > kMaxAlbumCount) {
@@ -122,14 +136,75 @@ void PrepareAlbum(PreparedList &result, int previewWidth) {
 	}
 	if (waiting > 0) {
 		semaphore.acquire(waiting);
-		if (result.albumIsPossible) {
-			const auto badIt = ranges::find(
-				result.files,
-				PreparedFile::AlbumType::None,
-				[](const PreparedFile &file) { return file.type; });
-			result.albumIsPossible = (badIt == result.files.end());
+		CheckAlbumIsPossible(result);
+	}
+}
+
+// Same as PrepareAlbum, but the files are read without blocking anybody,
+// "done" is called on the main thread when all of them are ready.
+void PrepareAlbumAsync(
+		PreparedList &&list,
+		int previewWidth,
+		Fn<void(PreparedList&&)> done) {
+	const auto count = int(list.files.size());
+	if (count > kMaxAlbumCount || !count) {
+		crl::on_main([=, list = std::move(list)]() mutable {
+			done(std::move(list));
+		});
+		return;
+	}
+	list.albumIsPossible = (count > 1);
+
+	struct State {
+		PreparedList list;
+		std::atomic<int> waiting = { 0 };
+	};
+	const auto state = std::make_shared<State>();
+	state->list = std::move(list);
+	state->waiting = count;
+	for (auto &file : state->list.files) {
+		crl::async([=, &file] {
+			PrepareAlbumMedia(file, previewWidth);
+			if (--state->waiting == 0) {
+				CheckAlbumIsPossible(state->list);
+				crl::on_main([=] {
+					done(std::move(state->list));
+				});
+			}
+		});
+	}
+}
+
+PreparedList PrepareFilesList(const QStringList &files) {
+	auto result = PreparedList();
+	result.files.reserve(files.size());
+	const auto extensionsToCompress = cExtensionsForCompress();
+	for (const auto &file : files) {
+		const auto fileinfo = QFileInfo(file);
+		const auto filesize = fileinfo.size();
+		if (fileinfo.isDir()) {
+			return {
+				PreparedList::Error::Directory,
+				file
+			};
+		} else if (filesize <= 0) {
+			return {
+				PreparedList::Error::EmptyFile,
+				file
+			};
+		} else if (filesize > App::kFileSizeLimit) {
+			return {
+				PreparedList::Error::TooLargeFile,
+				file
+			};
 		}
+		const auto toCompress = HasExtensionFrom(file, extensionsToCompress);
+		if (filesize > App::kImageSizeLimit || !toCompress) {
+			result.allFilesForCompress = false;
+		}
+		result.files.emplace_back(file);
 	}
+	return result;
 }
 
 } // namespace
@@ -215,38 +290,48 @@ PreparedList PrepareMediaList(const QList<QUrl> &files, int previewWidth) {
 }
 
 PreparedList PrepareMediaList(const QStringList &files, int previewWidth) {
-	auto result = PreparedList();
-	result.files.reserve(files.size());
-	const auto extensionsToCompress = cExtensionsForCompress();
-	for (const auto &file : files) {
-		const auto fileinfo = QFileInfo(file);
-		const auto filesize = fileinfo.size();
-		if (fileinfo.isDir()) {
-			return {
-				PreparedList::Error::Directory,
-				file
-			};
-		} else if (filesize <= 0) {
-			return {
-				PreparedList::Error::EmptyFile,
-				file
-			};
-		} else if (filesize > App::kFileSizeLimit) {
-			return {
-				PreparedList::Error::TooLargeFile,
-				file
-			};
-		}
-		const auto toCompress = HasExtensionFrom(file, extensionsToCompress);
-		if (filesize > App::kImageSizeLimit || !toCompress) {
-			result.allFilesForCompress = false;
-		}
-		result.files.emplace_back(file);
+	auto result = PrepareFilesList(files);
+	if (result.error == PreparedList::Error::None) {
+		PrepareAlbum(result, previewWidth);
 	}
-	PrepareAlbum(result, previewWidth);
 	return result;
 }
 
+void PrepareMediaListAsync(
+		const QList<QUrl> &files,
+		int previewWidth,
+		Fn<void(PreparedList&&)> done) {
+	auto locals = QStringList();
+	locals.reserve(files.size());
+	for (const auto &url : files) {
+		if (!url.isLocalFile()) {
+			done({
+				PreparedList::Error::NonLocalUrl,
+				url.toDisplayString()
+			});
+			return;
+		}
+		locals.push_back(Platform::File::UrlToLocal(url));
+	}
+	PrepareMediaListAsync(locals, previewWidth, std::move(done));
+}
+
+void PrepareMediaListAsync(
+		const QStringList &files,
+		int previewWidth,
+		Fn<void(PreparedList&&)> done) {
+	crl::async([=] {
+		auto result = PrepareFilesList(files);
+		if (result.error != PreparedList::Error::None) {
+			crl::on_main([=, result = std::move(result)]() mutable {
+				done(std::move(result));
+			});
+			return;
+		}
+		PrepareAlbumAsync(std::move(result), previewWidth, done);
+	});
+}
+
 PreparedList PrepareMediaFromImage(
 		QImage &&image,
 		QByteArray &&content,
@@ -74,6 +74,18 @@ struct PreparedList {
 bool ValidateThumbDimensions(int width, int height);
 PreparedList PrepareMediaList(const QList<QUrl> &files, int previewWidth);
 PreparedList PrepareMediaList(const QStringList &files, int previewWidth);
+
+// These check and read the files on background threads and call "done"
+// on the main thread, so that big lists from slow drives don't hang it.
+void PrepareMediaListAsync(
+	const QList<QUrl> &files,
+	int previewWidth,
+	Fn<void(PreparedList&&)> done);
+void PrepareMediaListAsync(
+	const QStringList &files,
+	int previewWidth,
+	Fn<void(PreparedList&&)> done);
+
 PreparedList PrepareMediaFromImage(
 	QImage &&image,
 	QByteArray &&content,
@@ -0,0 +1,122 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "storage/storage_progressive_jpeg.h"
+
+namespace Storage {
+namespace {
+
+constexpr auto kMarkerStart = uchar(0xFF);
+constexpr auto kStartOfImage = uchar(0xD8);
+constexpr auto kEndOfImage = uchar(0xD9);
+constexpr auto kStartOfFrameProgressive = uchar(0xC2);
+constexpr auto kStartOfScan = uchar(0xDA);
+constexpr auto kRestartFirst = uchar(0xD0);
+constexpr auto kRestartLast = uchar(0xD7);
+
+uchar ByteAt(const QByteArray &data, int index) {
+	return uchar(data[index]);
+}
+
+} // namespace
+
+void ProgressiveJpeg::feed(const QByteArray &data, int available) {
+	Expects(available <= data.size());
+
+	if (_failed) {
+		return;
+	} else if (!_position) {
+		if (available < 2) {
+			return;
+		} else if (ByteAt(data, 0) != kMarkerStart
+			|| ByteAt(data, 1) != kStartOfImage) {
+			_failed = true;
+			return;
+		}
+		_position = 2;
+	}
+	while (!_failed && (_entropy
+		? parseEntropy(data, available)
+		: parseSegment(data, available))) {
+	}
+}
+
+bool ProgressiveJpeg::parseSegment(const QByteArray &data, int available) {
+	if (_position + 2 > available) {
+		return false;
+	} else if (ByteAt(data, _position) != kMarkerStart) {
+		_failed = true;
+		return false;
+	}
+	const auto marker = ByteAt(data, _position + 1);
+	if (marker == kMarkerStart) {
+		// Fill byte before the marker.
+		++_position;
+		return true;
+	} else if (marker == kEndOfImage) {
+		_failed = true;
+		return false;
+	} else if (marker == kStartOfScan) {
+		if (!_progressive) {
+			// A baseline jpeg is drawn top to bottom, nothing to refine.
+			_failed = true;
+			return false;
+		}
+		// Everything before this scan header is complete.
+		_scans = _started;
+		_scansSize = _position;
+	}
+	if (_position + 4 > available) {
+		return false;
+	}
+	const auto length = (int(ByteAt(data, _position + 2)) << 8)
+		| int(ByteAt(data, _position + 3));
+	if (length < 2) {
+		_failed = true;
+		return false;
+	} else if (_position + 2 + length > available) {
+		return false;
+	}
+	if (marker == kStartOfFrameProgressive) {
+		_progressive = true;
+	} else if (marker == kStartOfScan) {
+		++_started;
+		_entropy = true;
+	}
+	_position += 2 + length;
+	return true;
+}
+
+bool ProgressiveJpeg::parseEntropy(const QByteArray &data, int available) {
+	// Inside the entropy coded data 0xFF is followed by a zero byte or
+	// by a restart marker, anything else is the next segment.
+	for (auto i = _position; i + 1 < available; ++i) {
+		if (ByteAt(data, i) != kMarkerStart) {
+			continue;
+		}
+		const auto next = ByteAt(data, i + 1);
+		if (next == 0 || (next >= kRestartFirst && next <= kRestartLast)) {
+			++i;
+			continue;
+		}
+		_position = i;
+		_entropy = false;
+		return true;
+	}
+	_position = std::max(_position, available - 1);
+	return false;
+}
+
+int ProgressiveJpeg::scans() const {
+	return _scans;
+}
+
+int ProgressiveJpeg::scansSize() const {
+	return _scansSize;
+}
+
+} // namespace Storage
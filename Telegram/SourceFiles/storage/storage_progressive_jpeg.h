@@ -0,0 +1,37 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Storage {
+
+// Finds the complete scans of a progressive jpeg in the loaded beginning
+// of the file. Each feed() goes on parsing from where the last one ended.
+class ProgressiveJpeg final {
+public:
+	void feed(const QByteArray &data, int available);
+
+	// The first scansSize() bytes hold scans() complete scans and can be
+	// decoded to a coarse version of the image.
+	[[nodiscard]] int scans() const;
+	[[nodiscard]] int scansSize() const;
+
+private:
+	[[nodiscard]] bool parseSegment(const QByteArray &data, int available);
+	[[nodiscard]] bool parseEntropy(const QByteArray &data, int available);
+
+	int _position = 0;
+	int _started = 0;
+	int _scans = 0;
+	int _scansSize = 0;
+	bool _entropy = false;
+	bool _progressive = false;
+	bool _failed = false;
+
+};
+
+} // namespace Storage
@@ -0,0 +1,100 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "storage/storage_shared_cache.h"
+
+#include <xxhash.h>
+
+namespace Storage {
+namespace {
+
+constexpr auto kMagic = uint32(0x43535444);
+constexpr auto kMaxSize = 16 * 1024 * 1024;
+
+struct Header {
+	uint32 magic = kMagic;
+	uint32 size = 0;
+	uint32 checksum = 0;
+};
+
+uint32 CountChecksum(const QByteArray &bytes) {
+	return XXH32(bytes.constData(), bytes.size(), 0);
+}
+
+QString SharedPath(const Cache::Key &key) {
+	return cSharedCacheDir()
+		+ '/'
+		+ QString("%1").arg(key.high, 16, 16, QChar('0'))
+		+ QString("%1").arg(key.low, 16, 16, QChar('0'));
+}
+
+} // namespace
+
+bool SharedCacheEnabled() {
+	return !cSharedCacheDir().isEmpty() && !cTestMode();
+}
+
+QByteArray ReadShared(const Cache::Key &key) {
+	if (!SharedCacheEnabled()) {
+		return QByteArray();
+	}
+	auto file = QFile(SharedPath(key));
+	if (!file.open(QIODevice::ReadOnly)) {
+		return QByteArray();
+	}
+	auto header = Header();
+	const auto read = file.read(
+		reinterpret_cast<char*>(&header),
+		sizeof(Header));
+	if (read != sizeof(Header)
+		|| header.magic != kMagic
+		|| header.size > kMaxSize
+		|| file.size() != int64(sizeof(Header)) + header.size) {
+		return QByteArray();
+	}
+	auto result = file.read(header.size);
+	if (result.size() != int(header.size)
+		|| CountChecksum(result) != header.checksum) {
+		return QByteArray();
+	}
+	return result;
+}
+
+void WriteShared(const Cache::Key &key, const QByteArray &bytes) {
+	if (!SharedCacheEnabled()
+		|| bytes.isEmpty()
+		|| bytes.size() > kMaxSize) {
+		return;
+	}
+	const auto path = SharedPath(key);
+	if (QFile::exists(path) || !QDir().mkpath(cSharedCacheDir())) {
+		return;
+	}
+	const auto temp = path
+		+ '.'
+		+ QString::number(rand_value<uint32>(), 16)
+		+ ".tmp";
+	auto file = QFile(temp);
+	if (!file.open(QIODevice::WriteOnly)) {
+		return;
+	}
+	auto header = Header();
+	header.size = uint32(bytes.size());
+	header.checksum = CountChecksum(bytes);
+	const auto written = file.write(
+		reinterpret_cast<const char*>(&header),
+		sizeof(Header)) == sizeof(Header)
+		&& file.write(bytes) == bytes.size();
+	file.close();
+
+	// Renaming fails if another instance has already written this file.
+	if (!written || !QFile::rename(temp, path)) {
+		QFile::remove(temp);
+	}
+}
+
+} // namespace Storage
@@ -0,0 +1,25 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "storage/cache/storage_cache_types.h"
+
+namespace Storage {
+
+// Files that are the same for everyone, like stickers and emoji sets,
+// may be kept in a folder shared by several instances, see -sharedcache.
+// Each file is written to a temporary name and then renamed to the name
+// made from its key, it is never changed after that. So the instances
+// don't need any locks and never see a partially written file.
+[[nodiscard]] bool SharedCacheEnabled();
+
+// Any thread.
+[[nodiscard]] QByteArray ReadShared(const Cache::Key &key);
+void WriteShared(const Cache::Key &key, const QByteArray &bytes);
+
+} // namespace Storage
@@ -11,45 +11,42 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace Storage {
 
-std::map<PeerId, SharedMedia::Lists>::iterator
-		SharedMedia::enforceLists(PeerId peer) {
-	auto result = _lists.find(peer);
-	if (result != _lists.end()) {
-		return result;
-	}
-	result = _lists.emplace(peer, Lists {}).first;
-	for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
-		auto &list = result->second[index];
-		auto type = static_cast<SharedMediaType>(index);
-
-		list.sliceUpdated(
+SparseIdsList &SharedMedia::enforceList(
+		PeerId peer,
+		Lists &lists,
+		Type type) {
+	auto &result = lists.types[static_cast<int>(type)];
+	if (!result) {
+		result = std::make_unique<SparseIdsList>();
+		result->sliceUpdated(
 		) | rpl::map([=](const SparseIdsSliceUpdate &update) {
 			return SharedMediaSliceUpdate(
 				peer,
 				type,
 				update);
-		}) | rpl::start_to_stream(_sliceUpdated, _lifetime);
+		}) | rpl::start_to_stream(_sliceUpdated, lists.lifetime);
 	}
-	return result;
+	return *result;
 }
 
 void SharedMedia::add(SharedMediaAddNew &&query) {
-	auto peer = query.peerId;
-	auto peerIt = enforceLists(peer);
+	auto &lists = _lists[query.peerId];
 	for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
 		auto type = static_cast<SharedMediaType>(index);
 		if (query.types.test(type)) {
-			peerIt->second[index].addNew(query.messageId);
+			enforceList(query.peerId, lists, type).addNew(query.messageId);
 		}
 	}
 }
 
 void SharedMedia::add(SharedMediaAddExisting &&query) {
-	auto peerIt = enforceLists(query.peerId);
+	auto &lists = _lists[query.peerId];
 	for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
 		auto type = static_cast<SharedMediaType>(index);
 		if (query.types.test(type)) {
-			peerIt->second[index].addExisting(query.messageId, query.noSkipRange);
+			enforceList(query.peerId, lists, type).addExisting(
+				query.messageId,
+				query.noSkipRange);
 		}
 	}
 }
@@ -57,9 +54,8 @@ void SharedMedia::add(SharedMediaAddExisting &&query) {
 void SharedMedia::add(SharedMediaAddSlice &&query) {
 	Expects(IsValidSharedMediaType(query.type));
 
-	auto peerIt = enforceLists(query.peerId);
-	auto index = static_cast<int>(query.type);
-	peerIt->second[index].addSlice(
+	auto &lists = _lists[query.peerId];
+	enforceList(query.peerId, lists, query.type).addSlice(
 		std::move(query.messageIds),
 		query.noSkipRange,
 		query.count);
@@ -70,8 +66,9 @@ void SharedMedia::remove(SharedMediaRemoveOne &&query) {
 	if (peerIt != _lists.end()) {
 		for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
 			auto type = static_cast<SharedMediaType>(index);
-			if (query.types.test(type)) {
-				peerIt->second[index].removeOne(query.messageId);
+			const auto &list = peerIt->second.types[index];
+			if (list && query.types.test(type)) {
+				list->removeOne(query.messageId);
 			}
 		}
 		_oneRemoved.fire(std::move(query));
@@ -81,8 +78,10 @@ void SharedMedia::remove(SharedMediaRemoveOne &&query) {
 void SharedMedia::remove(SharedMediaRemoveAll &&query) {
 	auto peerIt = _lists.find(query.peerId);
 	if (peerIt != _lists.end()) {
+		// All the types become known to be empty, not only the used ones.
 		for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
-			peerIt->second[index].removeAll();
+			auto type = static_cast<SharedMediaType>(index);
+			enforceList(query.peerId, peerIt->second, type).removeAll();
 		}
 		_allRemoved.fire(std::move(query));
 	}
@@ -91,8 +90,10 @@ void SharedMedia::remove(SharedMediaRemoveAll &&query) {
 void SharedMedia::invalidate(SharedMediaInvalidateBottom &&query) {
 	auto peerIt = _lists.find(query.peerId);
 	if (peerIt != _lists.end()) {
-		for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
-			peerIt->second[index].invalidateBottom();
+		for (const auto &list : peerIt->second.types) {
+			if (list) {
+				list->invalidateBottom();
+			}
 		}
 		_bottomInvalidated.fire(std::move(query));
 	}
@@ -101,9 +102,11 @@ void SharedMedia::invalidate(SharedMediaInvalidateBottom &&query) {
 rpl::producer<SharedMediaResult> SharedMedia::query(SharedMediaQuery &&query) const {
 	Expects(IsValidSharedMediaType(query.key.type));
 	auto peerIt = _lists.find(query.key.peerId);
-	if (peerIt != _lists.end()) {
-		auto index = static_cast<int>(query.key.type);
-		return peerIt->second[index].query(SparseIdsListQuery(
+	const auto list = (peerIt != _lists.end())
+		? peerIt->second.types[static_cast<int>(query.key.type)].get()
+		: nullptr;
+	if (list) {
+		return list->query(SparseIdsListQuery(
 			query.key.messageId,
 			query.limitBefore,
 			query.limitAfter));
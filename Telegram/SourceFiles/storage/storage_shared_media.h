@@ -197,18 +197,24 @@ public:
 	rpl::producer<SharedMediaInvalidateBottom> bottomInvalidated() const;
 
 private:
-	using Lists = std::array<SparseIdsList, kSharedMediaTypeCount>;
-
-	std::map<PeerId, Lists>::iterator enforceLists(PeerId peer);
-
-	std::map<PeerId, Lists> _lists;
+	// Most of the peers have only a few media types, so the lists are
+	// created on the first use and the updates of a peer are forwarded
+	// until the peer lists are destroyed.
+	struct Lists {
+		std::array<
+			std::unique_ptr<SparseIdsList>,
+			kSharedMediaTypeCount> types;
+		rpl::lifetime lifetime;
+	};
+
+	SparseIdsList &enforceList(PeerId peer, Lists &lists, Type type);
 
 	rpl::event_stream<SharedMediaSliceUpdate> _sliceUpdated;
 	rpl::event_stream<SharedMediaRemoveOne> _oneRemoved;
 	rpl::event_stream<SharedMediaRemoveAll> _allRemoved;
 	rpl::event_stream<SharedMediaInvalidateBottom> _bottomInvalidated;
 
-	rpl::lifetime _lifetime;
+	base::flat_map<PeerId, Lists> _lists;
 
 };
 
@@ -9,14 +9,15 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace Storage {
 
-void UserPhotos::List::addNew(PhotoId photoId) {
-	if (!base::contains(_photoIds, photoId)) {
-		_photoIds.push_back(photoId);
-		if (_count) {
-			++*_count;
-		}
-		sendUpdate();
+bool UserPhotos::List::addNew(PhotoId photoId) {
+	if (base::contains(_photoIds, photoId)) {
+		return false;
 	}
+	_photoIds.push_back(photoId);
+	if (_count) {
+		++*_count;
+	}
+	return true;
 }
 
 void UserPhotos::List::addSlice(
@@ -32,7 +33,6 @@ void UserPhotos::List::addSlice(
 	if ((_count && *_count < _photoIds.size()) || photoIds.empty()) {
 		_count = _photoIds.size();
 	}
-	sendUpdate();
 }
 
 void UserPhotos::List::removeOne(PhotoId photoId) {
@@ -45,7 +45,6 @@ void UserPhotos::List::removeOne(PhotoId photoId) {
 		}
 		_photoIds.erase(position);
 	}
-	sendUpdate();
 }
 
 void UserPhotos::List::removeAfter(PhotoId photoId) {
@@ -59,14 +58,10 @@ void UserPhotos::List::removeAfter(PhotoId photoId) {
 		}
 		_photoIds.erase(position, _photoIds.end());
 	}
-	sendUpdate();
 }
 
-void UserPhotos::List::sendUpdate() {
-	auto update = SliceUpdate();
-	update.photoIds = &_photoIds;
-	update.count = _count;
-	_sliceUpdated.fire(std::move(update));
+UserPhotosSliceUpdate UserPhotos::List::sliceUpdate(UserId userId) const {
+	return UserPhotosSliceUpdate(userId, &_photoIds, _count);
 }
 
 rpl::producer<UserPhotosResult> UserPhotos::List::query(
@@ -99,47 +94,32 @@ rpl::producer<UserPhotosResult> UserPhotos::List::query(
 	};
 }
 
-auto UserPhotos::List::sliceUpdated() const -> rpl::producer<SliceUpdate> {
-	return _sliceUpdated.events();
-}
-
 rpl::producer<UserPhotosSliceUpdate> UserPhotos::sliceUpdated() const {
 	return _sliceUpdated.events();
 }
 
-std::map<UserId, UserPhotos::List>::iterator UserPhotos::enforceLists(UserId user) {
-	auto result = _lists.find(user);
-	if (result != _lists.end()) {
-		return result;
-	}
-	result = _lists.emplace(user, List {}).first;
-	result->second.sliceUpdated(
-	) | rpl::start_with_next([this, user](
-			const SliceUpdate &update) {
-		_sliceUpdated.fire(UserPhotosSliceUpdate(
-			user,
-			update.photoIds,
-			update.count));
-	}, _lifetime);
-	return result;
+void UserPhotos::sendUpdate(UserId user, const List &list) {
+	_sliceUpdated.fire(list.sliceUpdate(user));
 }
 
 void UserPhotos::add(UserPhotosAddNew &&query) {
-	auto userIt = enforceLists(query.userId);
-	userIt->second.addNew(query.photoId);
+	auto &list = _lists[query.userId];
+	if (list.addNew(query.photoId)) {
+		sendUpdate(query.userId, list);
+	}
 }
 
 void UserPhotos::add(UserPhotosAddSlice &&query) {
-	auto userIt = enforceLists(query.userId);
-	userIt->second.addSlice(
-		std::move(query.photoIds),
-		query.count);
+	auto &list = _lists[query.userId];
+	list.addSlice(std::move(query.photoIds), query.count);
+	sendUpdate(query.userId, list);
 }
 
 void UserPhotos::remove(UserPhotosRemoveOne &&query) {
 	auto userIt = _lists.find(query.userId);
 	if (userIt != _lists.end()) {
 		userIt->second.removeOne(query.photoId);
+		sendUpdate(query.userId, userIt->second);
 	}
 }
 
@@ -147,6 +127,7 @@ void UserPhotos::remove(UserPhotosRemoveAfter &&query) {
 	auto userIt = _lists.find(query.userId);
 	if (userIt != _lists.end()) {
 		userIt->second.removeAfter(query.photoId);
+		sendUpdate(query.userId, userIt->second);
 	}
 }
 
@@ -134,9 +134,11 @@ public:
 	rpl::producer<UserPhotosSliceUpdate> sliceUpdated() const;
 
 private:
+	// The lists don't have streams of their own, the changes of any
+	// list are sent right to the common stream.
 	class List {
 	public:
-		void addNew(PhotoId photoId);
+		[[nodiscard]] bool addNew(PhotoId photoId);
 		void addSlice(
 			std::vector<PhotoId> &&photoIds,
 			int count);
@@ -144,31 +146,20 @@ private:
 		void removeAfter(PhotoId photoId);
 		rpl::producer<UserPhotosResult> query(UserPhotosQuery &&query) const;
 
-		struct SliceUpdate {
-			const std::deque<PhotoId> *photoIds = nullptr;
-			std::optional<int> count;
-		};
-		rpl::producer<SliceUpdate> sliceUpdated() const;
+		[[nodiscard]] UserPhotosSliceUpdate sliceUpdate(UserId userId) const;
 
 	private:
-		void sendUpdate();
-
 		std::optional<int> _count;
 		std::deque<PhotoId> _photoIds;
 
-		rpl::event_stream<SliceUpdate> _sliceUpdated;
-
 	};
-	using SliceUpdate = List::SliceUpdate;
 
-	std::map<UserId, List>::iterator enforceLists(UserId user);
+	void sendUpdate(UserId user, const List &list);
 
 	std::map<UserId, List> _lists;
 
 	rpl::event_stream<UserPhotosSliceUpdate> _sliceUpdated;
 
-	rpl::lifetime _lifetime;
-
 };
 
 } // namespace Storage
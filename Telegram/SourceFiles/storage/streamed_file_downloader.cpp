@@ -109,7 +109,26 @@ void StreamedFileDownloader::cancelRequests() {
 	_reader->cancelForDownloader(this);
 }
 
+bool StreamedFileDownloader::resumable() const {
+	return true;
+}
+
+// The parts loaded to the file before a restart are shared with
+// the reader through readLoadedPart() as well as the new ones.
+void StreamedFileDownloader::applyResumedParts() {
+	_resumedPartsApplied = true;
+	for (auto index = 0; index != _partsCount; ++index) {
+		if (!_partIsSaved[index] && partLoadedBefore(index * kPartSize)) {
+			_partIsSaved[index] = true;
+			++_partsSaved;
+		}
+	}
+}
+
 bool StreamedFileDownloader::loadPart() {
+	if (!_resumedPartsApplied) {
+		applyResumedParts();
+	}
 	if (_finished || _nextPartIndex >= _partsCount) {
 		return false;
 	}
@@ -49,8 +49,10 @@ private:
 	Cache::Key cacheKey() const override;
 	std::optional<MediaKey> fileLocationKey() const override;
 	void cancelRequests() override;
+	bool resumable() const override;
 	bool loadPart() override;
 
+	void applyResumedParts();
 	void savePart(const Media::Streaming::LoadedPart &part);
 
 	uint64 _objectId = 0;
@@ -64,6 +66,7 @@ private:
 	int _partsCount = 0;
 	int _partsRequested = 0;
 	int _partsSaved = 0;
+	bool _resumedPartsApplied = false;
 
 	rpl::lifetime _lifetime;
 
@@ -36,6 +36,13 @@ constexpr auto kOccupyFor = TimeId(60);
 constexpr auto kReoccupyEach = 30 * crl::time(1000);
 constexpr auto kMaxSupportInfoLength = MaxMessageSize * 4;
 
+// The first slices of the next chats in the list are loaded in advance,
+// the same way HistoryWidget loads them when showing a chat at unread.
+constexpr auto kPrefetchChatsCount = 3;
+constexpr auto kPrefetchMessagesLimit = 50;
+constexpr auto kPrefetchedSizeLimit = 8 * 1024 * 1024;
+constexpr auto kPrefetchedTimeout = 60 * crl::time(1000);
+
 class EditInfoBox : public BoxContent {
 public:
 	EditInfoBox(
@@ -301,9 +308,137 @@ void Helper::registerWindow(not_null<Window::Controller*> controller) {
 	}) | rpl::distinct_until_changed(
 	) | rpl::start_with_next([=](History *history) {
 		updateOccupiedHistory(controller, history);
+		if (history) {
+			prefetchAfter(history);
+		}
 	}, controller->lifetime());
 }
 
+void Helper::prefetchAfter(not_null<History*> history) {
+	const auto list = _session->data().chatsList()->indexed();
+	const auto row = list->getRow(history);
+	if (!row) {
+		return;
+	}
+	auto count = 0;
+	for (auto i = list->cfind(row) + 1, e = list->cend(); i != e; ++i) {
+		const auto next = (*i)->history();
+		if (!TrackHistoryOccupation(next)) {
+			continue;
+		}
+		next->peer->loadUserpic();
+		prefetch(next);
+		if (++count == kPrefetchChatsCount) {
+			break;
+		}
+	}
+}
+
+void Helper::prefetch(not_null<History*> history) {
+	const auto peer = history->peer;
+	if (peer->migrateFrom() || history->isReadyFor(ShowAtUnreadMsgId)) {
+		return;
+	}
+	const auto around = history->loadAroundId();
+	const auto offset = around ? (-kPrefetchMessagesLimit / 2) : 0;
+	const auto lastId = history->lastMessage()
+		? history->lastMessage()->id
+		: MsgId(0);
+	const auto now = crl::now();
+	const auto i = _prefetched.find(peer);
+	if (i != end(_prefetched)) {
+		const auto &already = i->second;
+		if (already.offsetId == around
+			&& already.lastId == lastId
+			&& (already.requestId
+				|| already.received + kPrefetchedTimeout > now)) {
+			return;
+		}
+		request(base::take(i->second.requestId)).cancel();
+		_prefetchedSize -= i->second.size;
+		_prefetched.erase(i);
+	}
+	auto &entry = _prefetched[peer];
+	entry.offsetId = around;
+	entry.offset = offset;
+	entry.lastId = lastId;
+	entry.requestId = request(MTPmessages_GetHistory(
+		peer->input,
+		MTP_int(around),
+		MTP_int(0), // offset_date
+		MTP_int(offset),
+		MTP_int(kPrefetchMessagesLimit),
+		MTP_int(0), // max_id
+		MTP_int(0), // min_id
+		MTP_int(0) // hash
+	)).done([=](const MTPmessages_Messages &result) {
+		prefetchDone(peer, result);
+	}).fail([=](const RPCError &error) {
+		_prefetched.remove(peer);
+	}).send();
+}
+
+void Helper::prefetchDone(
+		not_null<PeerData*> peer,
+		const MTPmessages_Messages &result) {
+	const auto i = _prefetched.find(peer);
+	if (i == end(_prefetched)) {
+		return;
+	}
+	auto &entry = i->second;
+	entry.requestId = 0;
+	entry.result = result;
+	entry.size = int(result.innerLength());
+	entry.received = crl::now();
+	_prefetchedSize += entry.size;
+	checkPrefetchedSize();
+}
+
+void Helper::checkPrefetchedSize() {
+	while (_prefetchedSize > kPrefetchedSizeLimit) {
+		auto oldest = end(_prefetched);
+		for (auto i = begin(_prefetched); i != end(_prefetched); ++i) {
+			if (i->second.result
+				&& (oldest == end(_prefetched)
+					|| i->second.received < oldest->second.received)) {
+				oldest = i;
+			}
+		}
+		if (oldest == end(_prefetched)) {
+			break;
+		}
+		_prefetchedSize -= oldest->second.size;
+		_prefetched.erase(oldest);
+	}
+}
+
+std::optional<MTPmessages_Messages> Helper::takePrefetched(
+		not_null<PeerData*> peer,
+		MsgId offsetId,
+		int offset,
+		int limit) {
+	const auto i = _prefetched.find(peer);
+	if (i == end(_prefetched) || !i->second.result) {
+		return std::nullopt;
+	}
+	auto entry = std::move(i->second);
+	_prefetched.erase(i);
+	_prefetchedSize -= entry.size;
+
+	const auto history = _session->data().historyLoaded(peer);
+	const auto lastId = (history && history->lastMessage())
+		? history->lastMessage()->id
+		: MsgId(0);
+	if (entry.offsetId != offsetId
+		|| entry.offset != offset
+		|| limit != kPrefetchMessagesLimit
+		|| entry.lastId != lastId
+		|| entry.received + kPrefetchedTimeout <= crl::now()) {
+		return std::nullopt;
+	}
+	return std::move(entry.result);
+}
+
 void Helper::cloudDraftChanged(not_null<History*> history) {
 	chatOccupiedUpdated(history);
 	if (history != _occupiedHistory) {
@@ -59,11 +59,28 @@ public:
 
 	Templates &templates();
 
+	// The first slice of a chat after the opened one, if it was prefetched
+	// with the same messages.getHistory() parameters and is still fresh.
+	std::optional<MTPmessages_Messages> takePrefetched(
+		not_null<PeerData*> peer,
+		MsgId offsetId,
+		int offset,
+		int limit);
+
 private:
 	struct SavingInfo {
 		TextWithEntities data;
 		mtpRequestId requestId = 0;
 	};
+	struct Prefetched {
+		MsgId offsetId = 0;
+		int offset = 0;
+		MsgId lastId = 0;
+		mtpRequestId requestId = 0;
+		std::optional<MTPmessages_Messages> result;
+		int size = 0;
+		crl::time received = 0;
+	};
 	void checkOccupiedChats();
 	void updateOccupiedHistory(
 		not_null<Window::Controller*> controller,
@@ -73,6 +90,13 @@ private:
 	void occupyInDraft();
 	void reoccupy();
 
+	void prefetchAfter(not_null<History*> history);
+	void prefetch(not_null<History*> history);
+	void prefetchDone(
+		not_null<PeerData*> peer,
+		const MTPmessages_Messages &result);
+	void checkPrefetchedSize();
+
 	void applyInfo(
 		not_null<UserData*> user,
 		const MTPhelp_UserInfo &result);
@@ -92,6 +116,9 @@ private:
 	base::Timer _checkOccupiedTimer;
 	base::flat_map<not_null<History*>, TimeId> _occupiedChats;
 
+	base::flat_map<not_null<PeerData*>, Prefetched> _prefetched;
+	int _prefetchedSize = 0;
+
 	base::flat_map<not_null<UserData*>, UserInfo> _userInformation;
 	base::flat_set<not_null<UserData*>> _userInfoEditPending;
 	base::flat_map<not_null<UserData*>, SavingInfo> _userInfoSaving;
@@ -8,14 +8,26 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/effects/animations.h"
 
 #include "core/application.h"
+#include "base/trace.h"
+
+#include <QtGui/QScreen>
 
 namespace Ui {
 namespace Animations {
 namespace {
 
-constexpr auto kAnimationTick = crl::time(1000) / 120;
+// Ticks follow the primary screen refresh rate in these limits.
+constexpr auto kMinRefreshRate = 60;
+constexpr auto kMaxRefreshRate = 120;
 constexpr auto kIgnoreUpdatesTimeout = crl::time(4);
 
+crl::time ComputeFrameDuration() {
+	const auto screen = QGuiApplication::primaryScreen();
+	const auto rate = screen ? int(std::round(screen->refreshRate())) : 0;
+	return crl::time(1000)
+		/ std::clamp(rate, kMinRefreshRate, kMaxRefreshRate);
+}
+
 } // namespace
 
 void Basic::start() {
@@ -50,7 +62,11 @@ void Basic::markStopped() {
 	_started = -1;
 }
 
-Manager::Manager() {
+Manager::Manager() : _frameDuration(ComputeFrameDuration()) {
+	connect(qApp, &QGuiApplication::primaryScreenChanged, [=] {
+		_frameDuration = ComputeFrameDuration();
+	});
+
 	crl::on_main_update_requests(
 	) | rpl::filter([=] {
 		return (_lastUpdateTime + kIgnoreUpdatesTimeout < crl::now());
@@ -85,6 +101,7 @@ void Manager::stop(not_null<Basic*> animation) {
 		}
 	} else if (empty(_active)) {
 		stopTimer();
+		reportOverruns();
 	}
 }
 
@@ -100,6 +117,7 @@ void Manager::update() {
 
 	_updating = true;
 	const auto guard = gsl::finally([&] { _updating = false; });
+	const auto span = base::trace::Span("frame", "animations");
 
 	_lastUpdateTime = now;
 	const auto isFinished = [&](const ActiveBasicPointer &element) {
@@ -107,6 +125,13 @@ void Manager::update() {
 	};
 	_active.erase(ranges::remove_if(_active, isFinished), end(_active));
 
+	++_framesCount;
+	const auto duration = crl::now() - now;
+	if (duration > _frameDuration) {
+		++_overrunsCount;
+		base::trace::Counter("frame overrun", duration, "animations");
+	}
+
 	if (!empty(_starting)) {
 		_active.insert(
 			end(_active),
@@ -114,6 +139,9 @@ void Manager::update() {
 			std::make_move_iterator(end(_starting)));
 		_starting.clear();
 	}
+	if (empty(_active)) {
+		reportOverruns();
+	}
 }
 
 void Manager::updateQueued() {
@@ -141,7 +169,7 @@ void Manager::schedule() {
 			_forceImmediateUpdate = false;
 			updateQueued();
 		} else {
-			const auto next = _lastUpdateTime + kAnimationTick;
+			const auto next = _lastUpdateTime + _frameDuration;
 			const auto now = crl::now();
 			if (now < next) {
 				_timerId = startTimer(next - now, Qt::PreciseTimer);
@@ -162,6 +190,16 @@ void Manager::stopTimer() {
 	}
 }
 
+void Manager::reportOverruns() {
+	if (_overrunsCount > 0) {
+		DEBUG_LOG(("Animations: %1 of %2 frames took more than %3 ms."
+			).arg(_overrunsCount
+			).arg(_framesCount
+			).arg(_frameDuration));
+	}
+	_framesCount = _overrunsCount = 0;
+}
+
 void Manager::timerEvent(QTimerEvent *e) {
 	update();
 }
@@ -158,9 +158,13 @@ private:
 	void schedule();
 	void updateQueued();
 	void stopTimer();
+	void reportOverruns();
 	not_null<const QObject*> delayedCallGuard() const;
 
+	crl::time _frameDuration = 0;
 	crl::time _lastUpdateTime = 0;
+	int _framesCount = 0;
+	int _overrunsCount = 0;
 	int _timerId = 0;
 	bool _updating = false;
 	bool _scheduled = false;
@@ -14,6 +14,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/bytes.h"
 #include "base/openssl_help.h"
 #include "base/parse_helper.h"
+#include "base/weak_ptr.h"
+#include "base/memory_usage.h"
 #include "auth_session.h"
 
 namespace Ui {
@@ -39,23 +41,32 @@ const auto kSets = {
 // Right now we can't allow users of Ui::Emoji to create custom sizes.
 // Any Instance::Instance() can invalidate Universal.id() and sprites.
 // So all Instance::Instance() should happen before async generations.
-class Instance {
+//
+// Sprites are loaded when an emoji from them is drawn for the first time,
+// from the cache or scaled from the universal sprite on a worker thread.
+class Instance final : public base::has_weak_ptr {
 public:
 	explicit Instance(int size);
+	~Instance();
 
-	bool cached() const;
 	void draw(QPainter &p, EmojiPtr emoji, int x, int y);
 
+	// Waits for the sprite, for pixmaps that can't be repainted later.
+	void loadSync(int index);
+
+	// Sprites are loaded again when they're drawn the next time.
+	void unloadSprites();
+
 private:
-	void readCache();
-	void generateCache();
 	void checkUniversalImages();
-	void pushSprite(QImage &&data);
+	void load(int index);
+	void loaded(int id, int index, QImage &&data);
+	void setSprite(int index, QImage &&data);
 
 	int _id = 0;
 	int _size = 0;
 	std::vector<QPixmap> _sprites;
-	base::binary_guard _generating;
+	base::flat_set<int> _loading;
 
 };
 
@@ -64,18 +75,17 @@ public:
 	explicit UniversalImages(int id);
 
 	int id() const;
-	bool ensureLoaded();
-	void clear();
 
-	void draw(QPainter &p, EmojiPtr emoji, int size, int x, int y) const;
+	// Checks the config and the sprite sizes without decoding them.
+	bool ensureValid();
 
-	// This method must be thread safe and so it is called after
-	// the _id value is fixed and all _sprites are loaded.
+	// This method must be thread safe, it decodes the universal sprite
+	// for each call, so that they don't stay in memory.
 	QImage generate(int size, int index) const;
 
 private:
 	int _id = 0;
-	std::vector<QImage> _sprites;
+	std::optional<bool> _valid;
 
 };
 
@@ -88,9 +98,6 @@ auto InstanceLarge = std::unique_ptr<Instance>();
 auto Universal = std::shared_ptr<UniversalImages>();
 auto Updates = rpl::event_stream<>();
 
-auto MainEmojiMap = std::map<int, QPixmap>();
-auto OtherEmojiMap = std::map<int, std::map<int, QPixmap>>();
-
 int RowsCount(int index) {
 	if (index + 1 < SpritesCount) {
 		return kImageRowsPerSprite;
@@ -159,8 +166,6 @@ void SwitchToSetPrepared(int id, std::shared_ptr<UniversalImages> images) {
 		stream << qint32(id);
 	}
 	Universal = std::move(images);
-	MainEmojiMap.clear();
-	OtherEmojiMap.clear();
 	Updates.fire({});
 }
 
@@ -175,7 +180,7 @@ void ClearCurrentSetIdSync() {
 
 	const auto newId = 0;
 	auto universal = std::make_shared<UniversalImages>(newId);
-	universal->ensureLoaded();
+	universal->ensureValid();
 	SwitchToSetPrepared(newId, std::move(universal));
 }
 
@@ -278,24 +283,30 @@ QImage LoadFromFile(int id, int size, int index) {
 	return result;
 }
 
-std::vector<QImage> LoadSprites(int id) {
+QString SpritePath(int id, int index) {
 	Expects(IsValidSetId(id));
-	Expects(SpritesCount > 0);
+	Expects(index >= 0 && index < SpritesCount);
 
-	auto result = std::vector<QImage>();
 	const auto folder = (id != 0)
 		? internal::SetDataPath(id) + '/'
 		: qsl(":/gui/emoji/");
-	const auto base = folder + "emoji_";
-	return ranges::view::ints(
-		0,
-		SpritesCount
-	) | ranges::view::transform([&](int index) {
-		return base + QString::number(index + 1) + ".webp";
-	}) | ranges::view::transform([](const QString &path) {
-		return QImage(path, "WEBP").convertToFormat(
-			QImage::Format_ARGB32_Premultiplied);
-	}) | ranges::to_vector;
+	return folder + "emoji_" + QString::number(index + 1) + ".webp";
+}
+
+QSize SpriteSize(int index) {
+	return QSize(
+		kImagesPerRow * kUniversalSize,
+		RowsCount(index) * kUniversalSize);
+}
+
+int64 SpriteMemory(const QPixmap &sprite) {
+	return int64(sprite.width()) * sprite.height() * 4;
+}
+
+QImage LoadSprite(int id, int index) {
+	auto result = QImage(SpritePath(id, index), "WEBP").convertToFormat(
+		QImage::Format_ARGB32_Premultiplied);
+	return (result.size() == SpriteSize(index)) ? result : QImage();
 }
 
 bool ValidateConfig(int id) {
@@ -324,30 +335,18 @@ bool ValidateConfig(int id) {
 	return true;
 }
 
-std::vector<QImage> LoadAndValidateSprites(int id) {
+bool ValidateSprites(int id) {
 	Expects(IsValidSetId(id));
 	Expects(SpritesCount > 0);
 
 	if (!ValidateConfig(id)) {
-		return {};
-	}
-	auto result = LoadSprites(id);
-	const auto sizes = ranges::view::ints(
-		0,
-		SpritesCount
-	) | ranges::view::transform([](int index) {
-		return QSize(
-			kImagesPerRow * kUniversalSize,
-			RowsCount(index) * kUniversalSize);
-	});
-	const auto good = ranges::view::zip_with(
-		[](const QImage &data, QSize size) { return data.size() == size; },
-		result,
-		sizes);
-	if (ranges::find(good, false) != end(good)) {
-		return {};
+		return false;
 	}
-	return result;
+	const auto good = [&](int index) {
+		return QImageReader(SpritePath(id, index), "WEBP").size()
+			== SpriteSize(index);
+	};
+	return ranges::all_of(ranges::view::ints(0, SpritesCount), good);
 }
 
 UniversalImages::UniversalImages(int id) : _id(id) {
@@ -358,57 +357,25 @@ int UniversalImages::id() const {
 	return _id;
 }
 
-bool UniversalImages::ensureLoaded() {
+bool UniversalImages::ensureValid() {
 	Expects(SpritesCount > 0);
 
-	if (!_sprites.empty()) {
-		return true;
+	if (!_valid) {
+		_valid = ValidateSprites(_id);
 	}
-	_sprites = LoadAndValidateSprites(_id);
-	return !_sprites.empty();
-}
-
-void UniversalImages::clear() {
-	_sprites.clear();
-}
-
-void UniversalImages::draw(
-		QPainter &p,
-		EmojiPtr emoji,
-		int size,
-		int x,
-		int y) const {
-	Expects(emoji->sprite() < _sprites.size());
-
-	const auto large = kUniversalSize;
-	const auto &original = _sprites[emoji->sprite()];
-	const auto data = original.bits();
-	const auto stride = original.bytesPerLine();
-	const auto format = original.format();
-	const auto row = emoji->row();
-	const auto column = emoji->column();
-	auto single = QImage(
-		data + (row * kImagesPerRow * large + column) * large * 4,
-		large,
-		large,
-		stride,
-		format
-	).scaled(
-		size,
-		size,
-		Qt::IgnoreAspectRatio,
-		Qt::SmoothTransformation);
-	single.setDevicePixelRatio(p.device()->devicePixelRatio());
-	p.drawImage(x, y, single);
+	return *_valid;
 }
 
 QImage UniversalImages::generate(int size, int index) const {
 	Expects(size > 0);
-	Expects(index < _sprites.size());
+	Expects(index < SpritesCount);
 
+	const auto original = LoadSprite(_id, index);
+	if (original.isNull()) {
+		return QImage();
+	}
 	const auto rows = RowsCount(index);
 	const auto large = kUniversalSize;
-	const auto &original = _sprites[index];
 	const auto data = original.bits();
 	const auto stride = original.bytesPerLine();
 	const auto format = original.format();
@@ -484,14 +451,6 @@ EmojiPtr FindReplacement(const QChar *start, const QChar *end, int *outLength) {
 	return internal::FindReplace(start, end, outLength);
 }
 
-void ClearUniversalChecked() {
-	Expects(InstanceNormal != nullptr && InstanceLarge != nullptr);
-
-	if (InstanceNormal->cached() && InstanceLarge->cached() && Universal) {
-		Universal->clear();
-	}
-}
-
 } // namespace
 
 namespace internal {
@@ -521,12 +480,16 @@ void Init() {
 
 	InstanceNormal = std::make_unique<Instance>(SizeNormal);
 	InstanceLarge = std::make_unique<Instance>(SizeLarge);
+
+	base::memory::SetTrim(base::memory::Tag::EmojiSprites, [] {
+		InstanceNormal->unloadSprites();
+		InstanceLarge->unloadSprites();
+		Updates.fire({});
+	});
 }
 
 void Clear() {
-	MainEmojiMap.clear();
-	OtherEmojiMap.clear();
-
+	base::memory::SetTrim(base::memory::Tag::EmojiSprites, nullptr);
 	InstanceNormal = nullptr;
 	InstanceLarge = nullptr;
 }
@@ -571,7 +534,7 @@ void SwitchToSet(int id, Fn<void(bool)> callback) {
 	}
 	crl::async([=] {
 		auto universal = std::make_shared<UniversalImages>(id);
-		if (!universal->ensureLoaded()) {
+		if (!universal->ensureValid()) {
 			crl::on_main([=] {
 				callback(false);
 			});
@@ -843,32 +806,25 @@ void AddRecent(EmojiPtr emoji) {
 	}
 }
 
-const QPixmap &SinglePixmap(EmojiPtr emoji, int fontHeight) {
-	auto &map = (fontHeight == st::msgFont->height)
-		? MainEmojiMap
-		: OtherEmojiMap[fontHeight];
-	auto i = map.find(emoji->index());
-	if (i == end(map)) {
-		auto image = QImage(
-			SizeNormal + st::emojiPadding * cIntRetinaFactor() * 2,
-			fontHeight * cIntRetinaFactor(),
-			QImage::Format_ARGB32_Premultiplied);
-		image.setDevicePixelRatio(cRetinaFactor());
-		image.fill(Qt::transparent);
-		{
-			QPainter p(&image);
-			Draw(
-				p,
-				emoji,
-				SizeNormal,
-				st::emojiPadding * cIntRetinaFactor(),
-				(fontHeight * cIntRetinaFactor() - SizeNormal) / 2);
-		}
-		i = map.emplace(
-			emoji->index(),
-			App::pixmapFromImageInPlace(std::move(image))).first;
+QPixmap SinglePixmap(EmojiPtr emoji, int fontHeight) {
+	InstanceNormal->loadSync(emoji->sprite());
+
+	auto image = QImage(
+		SizeNormal + st::emojiPadding * cIntRetinaFactor() * 2,
+		fontHeight * cIntRetinaFactor(),
+		QImage::Format_ARGB32_Premultiplied);
+	image.setDevicePixelRatio(cRetinaFactor());
+	image.fill(Qt::transparent);
+	{
+		QPainter p(&image);
+		Draw(
+			p,
+			emoji,
+			SizeNormal,
+			st::emojiPadding * cIntRetinaFactor(),
+			(fontHeight * cIntRetinaFactor() - SizeNormal) / 2);
 	}
-	return i->second;
+	return App::pixmapFromImageInPlace(std::move(image));
 }
 
 void Draw(QPainter &p, EmojiPtr emoji, int size, int x, int y) {
@@ -881,29 +837,26 @@ void Draw(QPainter &p, EmojiPtr emoji, int size, int x, int y) {
 	}
 }
 
-Instance::Instance(int size) : _id(Universal->id()), _size(size) {
+Instance::Instance(int size)
+: _id(Universal->id())
+, _size(size)
+, _sprites(SpritesCount) {
 	Expects(Universal != nullptr);
 
-	readCache();
-	if (!cached()) {
-		generateCache();
-	}
+	checkUniversalImages();
 }
 
-bool Instance::cached() const {
-	Expects(Universal != nullptr);
-
-	return (Universal->id() == _id) && (_sprites.size() == SpritesCount);
+Instance::~Instance() {
+	unloadSprites();
 }
 
 void Instance::draw(QPainter &p, EmojiPtr emoji, int x, int y) {
-	if (Universal && Universal->id() != _id) {
-		generateCache();
-	}
+	checkUniversalImages();
+
 	const auto sprite = emoji->sprite();
-	if (sprite >= _sprites.size()) {
-		Assert(Universal != nullptr);
-		Universal->draw(p, emoji, _size, x, y);
+	Assert(sprite < _sprites.size());
+	if (_sprites[sprite].isNull()) {
+		load(sprite);
 		return;
 	}
 	p.drawPixmap(
@@ -912,59 +865,87 @@ void Instance::draw(QPainter &p, EmojiPtr emoji, int x, int y) {
 		QRect(emoji->column() * _size, emoji->row() * _size, _size, _size));
 }
 
-void Instance::readCache() {
-	for (auto i = 0; i != SpritesCount; ++i) {
-		auto image = LoadFromFile(_id, _size, i);
-		if (image.isNull()) {
-			return;
-		}
-		pushSprite(std::move(image));
+void Instance::loadSync(int index) {
+	Expects(index < _sprites.size());
+
+	checkUniversalImages();
+	if (!_sprites[index].isNull()) {
+		return;
+	}
+	auto image = LoadFromFile(_id, _size, index);
+	if (image.isNull()) {
+		image = Universal->generate(_size, index);
+	}
+	if (!image.isNull()) {
+		_loading.remove(index);
+		setSprite(index, std::move(image));
 	}
 }
 
 void Instance::checkUniversalImages() {
 	Expects(Universal != nullptr);
 
+	if (!Universal->ensureValid() && Universal->id() != 0) {
+		ClearCurrentSetIdSync();
+	}
 	if (_id != Universal->id()) {
 		_id = Universal->id();
-		_generating = nullptr;
-		_sprites.clear();
-	}
-	if (!Universal->ensureLoaded() && Universal->id() != 0) {
-		ClearCurrentSetIdSync();
+		unloadSprites();
+		_loading.clear();
 	}
 }
 
-void Instance::generateCache() {
-	checkUniversalImages();
+void Instance::unloadSprites() {
+	auto memory = int64();
+	for (const auto &sprite : _sprites) {
+		memory += SpriteMemory(sprite);
+	}
+	base::memory::Freed(base::memory::Tag::EmojiSprites, memory);
+	_sprites = std::vector<QPixmap>(SpritesCount);
+}
 
+void Instance::load(int index) {
+	if (!_loading.emplace(index).second) {
+		return;
+	}
+	const auto id = _id;
 	const auto size = _size;
-	const auto index = _sprites.size();
-	crl::async([
-		=,
-		universal = Universal,
-		guard = _generating.make_guard()
-	]() mutable {
-		crl::on_main(std::move(guard), [
-			=,
-			image = universal->generate(size, index)
-		]() mutable {
-			if (universal != Universal) {
-				return;
-			}
-			pushSprite(std::move(image));
-			if (cached()) {
-				ClearUniversalChecked();
-			} else {
-				generateCache();
-			}
+	crl::async([=, universal = Universal, weak = base::make_weak(this)] {
+		auto image = LoadFromFile(id, size, index);
+		if (image.isNull()) {
+			image = universal->generate(size, index);
+		}
+		crl::on_main(weak, [=, image = std::move(image)]() mutable {
+			loaded(id, index, std::move(image));
 		});
 	});
 }
 
-void Instance::pushSprite(QImage &&data) {
-	_sprites.push_back(App::pixmapFromImageInPlace(std::move(data)));
-	_sprites.back().setDevicePixelRatio(cRetinaFactor());
+void Instance::loaded(int id, int index, QImage &&data) {
+	if (id != _id) {
+		return;
+	} else if (data.isNull()) {
+		// Leave it in _loading, so that we don't retry on each paint.
+		LOG(("App Error: Could not load emoji sprite %1 for size %2."
+			).arg(index
+			).arg(_size));
+		return;
+	}
+	_loading.remove(index);
+	setSprite(index, std::move(data));
+	Updates.fire({});
+}
+
+void Instance::setSprite(int index, QImage &&data) {
+	auto &sprite = _sprites[index];
+	base::memory::Freed(
+		base::memory::Tag::EmojiSprites,
+		SpriteMemory(sprite));
+	sprite = App::pixmapFromImageInPlace(std::move(data));
+	sprite.setDevicePixelRatio(cRetinaFactor());
+	base::memory::Allocated(
+		base::memory::Tag::EmojiSprites,
+		SpriteMemory(sprite));
 }
 
 } // namespace Emoji
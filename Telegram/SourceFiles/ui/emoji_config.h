@@ -125,7 +125,9 @@ inline EmojiPtr FromUrl(const QString &url) {
 }
 
 inline EmojiPtr Find(const QChar *start, const QChar *end, int *outLength = nullptr) {
-	return internal::Find(start, end, outLength);
+	return (start != end && internal::IsFindStart(start->unicode()))
+		? internal::Find(start, end, outLength)
+		: nullptr;
 }
 
 inline EmojiPtr Find(const QString &text, int *outLength = nullptr) {
@@ -157,7 +159,7 @@ void ReplaceInText(TextWithEntities &result);
 RecentEmojiPack &GetRecent();
 void AddRecent(EmojiPtr emoji);
 
-const QPixmap &SinglePixmap(EmojiPtr emoji, int fontHeight);
+QPixmap SinglePixmap(EmojiPtr emoji, int fontHeight);
 void Draw(QPainter &p, EmojiPtr emoji, int size, int x, int y);
 
 } // namespace Emoji
@@ -7,9 +7,14 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "ui/grouped_layout.h"
 
+#include <numeric>
+
 namespace Ui {
 namespace {
 
+constexpr auto kMaxCachedLayouts = 256;
+
+
 int Round(float64 value) {
 	return int(std::round(value));
 }
@@ -565,6 +570,28 @@ std::vector<GroupMediaLayout> ComplexLayouter::layout() const {
 	return result;
 }
 
+// The layout depends only on the exact aspect ratios of the sizes, so they
+// are reduced to keep the identical albums with different sizes together.
+std::vector<int> CountLayoutKey(
+		const std::vector<QSize> &sizes,
+		int maxWidth,
+		int minWidth,
+		int spacing) {
+	auto result = std::vector<int>();
+	result.reserve(3 + sizes.size() * 2);
+	result.push_back(maxWidth);
+	result.push_back(minWidth);
+	result.push_back(spacing);
+	for (const auto &size : sizes) {
+		const auto divider = std::max(
+			std::gcd(size.width(), size.height()),
+			1);
+		result.push_back(size.width() / divider);
+		result.push_back(size.height() / divider);
+	}
+	return result;
+}
+
 } // namespace
 
 std::vector<GroupMediaLayout> LayoutMediaGroup(
@@ -572,7 +599,21 @@ std::vector<GroupMediaLayout> LayoutMediaGroup(
 		int maxWidth,
 		int minWidth,
 		int spacing) {
-	return Layouter(sizes, maxWidth, minWidth, spacing).layout();
+	static auto Cache = base::flat_map<
+		std::vector<int>,
+		std::vector<GroupMediaLayout>>();
+
+	auto key = CountLayoutKey(sizes, maxWidth, minWidth, spacing);
+	const auto i = Cache.find(key);
+	if (i != Cache.end()) {
+		return i->second;
+	}
+	auto result = Layouter(sizes, maxWidth, minWidth, spacing).layout();
+	if (Cache.size() >= kMaxCachedLayouts) {
+		Cache.clear();
+	}
+	Cache.emplace(std::move(key), result);
+	return result;
 }
 
 RectParts GetCornersFromSides(RectParts sides) {
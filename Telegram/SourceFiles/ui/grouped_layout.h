@@ -14,6 +14,7 @@ struct GroupMediaLayout {
 	RectParts sides = RectPart::None;
 };
 
+// Results are cached by the aspect ratios, so call it on the main thread.
 std::vector<GroupMediaLayout> LayoutMediaGroup(
 	const std::vector<QSize> &sizes,
 	int maxWidth,
@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/image/image.h"
 
 #include "ui/image/image_source.h"
+#include "ui/image/image_atlas.h"
 #include "core/media_active_cache.h"
 #include "storage/cache/storage_cache_database.h"
 #include "data/data_session.h"
@@ -42,6 +43,7 @@ int64 ComputeUsage(const QImage &image) {
 
 [[nodiscard]] Core::MediaActiveCache<const Image> &ActiveCache() {
 	static auto Instance = Core::MediaActiveCache<const Image>(
+		base::memory::Tag::Images,
 		kMemoryForCache,
 		[](const Image *image) { image->unload(); });
 	return Instance;
@@ -64,6 +66,7 @@ void ClearRemote() {
 	base::take(WebUrlImages);
 	base::take(WebCachedImages);
 	base::take(GeoPointImages);
+	UserpicsAtlas().clear();
 }
 
 void ClearAll() {
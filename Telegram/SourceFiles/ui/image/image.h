@@ -70,6 +70,8 @@ public:
 	virtual void cancel() = 0;
 	virtual float64 progress() = 0;
 	virtual int loadOffset() = 0;
+	virtual int progressiveScans() = 0;
+	virtual QByteArray progressiveBytes() = 0;
 
 	virtual const StorageImageLocation &location() = 0;
 	virtual void refreshFileReference(const QByteArray &data) = 0;
@@ -190,6 +192,12 @@ public:
 	int loadOffset() const {
 		return _source->loadOffset();
 	}
+	int progressiveScans() const {
+		return _source->progressiveScans();
+	}
+	QByteArray progressiveBytes() const {
+		return _source->progressiveBytes();
+	}
 	int width() const {
 		return _source->width();
 	}
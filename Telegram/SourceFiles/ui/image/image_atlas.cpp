@@ -0,0 +1,109 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "ui/image/image_atlas.h"
+
+namespace Images {
+namespace {
+
+// Each page is a grid of kPageCells x kPageCells equal images.
+constexpr auto kPageCells = 8;
+constexpr auto kMaxPages = 8;
+
+// Larger images are drawn rarely enough to have their own pixmaps.
+constexpr auto kMaxCellSize = 128;
+
+} // namespace
+
+bool Atlas::paint(
+		Painter &p,
+		int x,
+		int y,
+		int size,
+		const InMemoryKey &key,
+		FnMut<QImage()> generate) {
+	const auto pixels = size * cIntRetinaFactor();
+	if (pixels <= 0 || pixels > kMaxCellSize) {
+		return false;
+	}
+	auto i = _places.find({ key, pixels });
+	if (i == end(_places)) {
+		const auto place = allocate(pixels);
+		if (!place) {
+			return false;
+		}
+		auto &page = _pages[place->page];
+		auto &cell = page.cells[place->cell];
+		if (cell.usedAt) {
+			_places.remove(cell.key);
+		}
+		cell.key = { key, pixels };
+		{
+			QPainter q(&page.pixmap);
+			q.setCompositionMode(QPainter::CompositionMode_Source);
+			q.drawImage(cellRect(page, place->cell), generate());
+		}
+		i = _places.emplace(cell.key, *place).first;
+	}
+	auto &page = _pages[i->second.page];
+	page.cells[i->second.cell].usedAt = ++_counter;
+	p.drawPixmap(
+		QRect(x, y, size, size),
+		page.pixmap,
+		cellRect(page, i->second.cell));
+	return true;
+}
+
+void Atlas::clear() {
+	_pages.clear();
+	_places.clear();
+}
+
+auto Atlas::allocate(int size) -> std::optional<Place> {
+	auto result = std::optional<Place>();
+	auto lowest = int64(0);
+	for (auto i = 0, count = int(_pages.size()); i != count; ++i) {
+		const auto &page = _pages[i];
+		if (page.size != size) {
+			continue;
+		}
+		for (auto j = 0; j != kPageCells * kPageCells; ++j) {
+			const auto usedAt = page.cells[j].usedAt;
+			if (!usedAt) {
+				return Place{ i, j };
+			} else if (!result || usedAt < lowest) {
+				result = Place{ i, j };
+				lowest = usedAt;
+			}
+		}
+	}
+	if (_pages.size() < kMaxPages) {
+		auto page = Page();
+		page.size = size;
+		page.pixmap = QPixmap(size * kPageCells, size * kPageCells);
+		page.pixmap.fill(Qt::transparent);
+		page.cells.resize(kPageCells * kPageCells);
+		_pages.push_back(std::move(page));
+		return Place{ int(_pages.size()) - 1, 0 };
+	}
+	return result;
+}
+
+QRect Atlas::cellRect(const Page &page, int cell) const {
+	return QRect(
+		(cell % kPageCells) * page.size,
+		(cell / kPageCells) * page.size,
+		page.size,
+		page.size);
+}
+
+Atlas &UserpicsAtlas() {
+	static auto result = Atlas();
+	return result;
+}
+
+} // namespace Images
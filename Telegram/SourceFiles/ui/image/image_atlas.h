@@ -0,0 +1,58 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "ui/image/image_location.h"
+#include "base/flat_map.h"
+
+namespace Images {
+
+// Small square images drawn very often, like userpics in chats lists,
+// share a few large pixmaps instead of having a pixmap each.
+class Atlas final {
+public:
+	// Returns false if there is no place for an image of that size,
+	// the caller should paint it the usual way then.
+	bool paint(
+		Painter &p,
+		int x,
+		int y,
+		int size,
+		const InMemoryKey &key,
+		FnMut<QImage()> generate);
+
+	void clear();
+
+private:
+	using Key = std::pair<InMemoryKey, int>;
+	struct Cell {
+		Key key;
+		int64 usedAt = 0;
+	};
+	struct Page {
+		int size = 0;
+		QPixmap pixmap;
+		std::vector<Cell> cells;
+	};
+	struct Place {
+		int page = 0;
+		int cell = 0;
+	};
+
+	[[nodiscard]] std::optional<Place> allocate(int size);
+	[[nodiscard]] QRect cellRect(const Page &page, int cell) const;
+
+	std::vector<Page> _pages;
+	base::flat_map<Key, Place> _places;
+	int64 _counter = 0;
+
+};
+
+[[nodiscard]] Atlas &UserpicsAtlas();
+
+} // namespace Images
@@ -257,6 +257,13 @@ QByteArray StorageFileLocation::serialize() const {
 		buffer.open(QIODevice::WriteOnly);
 		auto stream = QDataStream(&buffer);
 		stream.setVersion(QDataStream::Qt_5_1);
+		writeToStream(stream);
+	}
+	return result;
+}
+
+void StorageFileLocation::writeToStream(QDataStream &stream) const {
+	if (valid()) {
 		stream
 			<< quint16(_dcId)
 			<< quint8(kSerializeTypeShift | quint8(_type))
@@ -269,7 +276,6 @@ QByteArray StorageFileLocation::serialize() const {
 			<< qint32(_inMessageId)
 			<< _fileReference;
 	}
-	return result;
 }
 
 int StorageFileLocation::serializeSize() const {
@@ -575,6 +581,13 @@ QByteArray StorageImageLocation::serialize() const {
 	return result;
 }
 
+void StorageImageLocation::writeToStream(QDataStream &stream) const {
+	_file.writeToStream(stream);
+	if (_file.valid() || (_width > 0) || (_height > 0)) {
+		stream << qint32(_width) << qint32(_height);
+	}
+}
+
 int StorageImageLocation::serializeSize() const {
 	const auto partial = _file.serializeSize();
 	return (partial > 0 || _width > 0 || _height > 0)
@@ -78,6 +78,7 @@ public:
 
 	[[nodiscard]] QByteArray serialize() const;
 	[[nodiscard]] int serializeSize() const;
+	void writeToStream(QDataStream &stream) const;
 	[[nodiscard]] static std::optional<StorageFileLocation> FromSerialized(
 		const QByteArray &serialized);
 
@@ -150,6 +151,7 @@ public:
 
 	[[nodiscard]] QByteArray serialize() const;
 	[[nodiscard]] int serializeSize() const;
+	void writeToStream(QDataStream &stream) const;
 	[[nodiscard]] static std::optional<StorageImageLocation> FromSerialized(
 		const QByteArray &serialized);
 
@@ -87,7 +87,8 @@ QImage prepareBlur(QImage img) {
 				pix = img.bits();
 				if (!pix) return was;
 			}
-			uint64 *rgb = new uint64[w * h];
+			auto buffer = std::vector<uint64>(w * h);
+			const auto rgb = buffer.data();
 
 			int x, y, i;
 
@@ -163,7 +164,6 @@ yi += stride;
 #undef update
 			}
 
-			delete[] rgb;
 		}
 	}
 	return img;
@@ -437,8 +437,13 @@ void prepareRound(
 		Assert(imageIntsAdded >= 0);
 		for (auto y = 0; y != maskHeight; ++y) {
 			for (auto x = 0; x != maskWidth; ++x) {
-				auto opacity = static_cast<anim::ShiftedMultiplier>(*maskBytes) + 1;
-				*imageInts = anim::unshifted(anim::shifted(*imageInts) * opacity);
+				const auto mask = *maskBytes;
+				if (!mask) {
+					*imageInts = 0;
+				} else if (mask != 0xFF) {
+					auto opacity = static_cast<anim::ShiftedMultiplier>(mask) + 1;
+					*imageInts = anim::unshifted(anim::shifted(*imageInts) * opacity);
+				}
 				maskBytes += maskBytesPerPixel;
 				imageInts += imageIntsPerPixel;
 			}
@@ -486,19 +491,31 @@ QImage prepareColored(QColor add, QImage image) {
 	}
 
 	if (const auto pix = image.bits()) {
-		const auto ca = int(add.alphaF() * 0xFF);
-		const auto cr = int(add.redF() * 0xFF);
-		const auto cg = int(add.greenF() * 0xFF);
-		const auto cb = int(add .blueF() * 0xFF);
-		const auto w = image.width();
-		const auto h = image.height();
-		const auto size = w * h * 4;
-		for (auto i = index_type(); i != size; i += 4) {
-			int b = pix[i], g = pix[i + 1], r = pix[i + 2], a = pix[i + 3], aca = a * ca;
-			pix[i + 0] = uchar(b + ((aca * (cb - b)) >> 16));
-			pix[i + 1] = uchar(g + ((aca * (cg - g)) >> 16));
-			pix[i + 2] = uchar(r + ((aca * (cr - r)) >> 16));
-			pix[i + 3] = uchar(a + ((aca * (0xFF - a)) >> 16));
+		// All four components are blended at once in the shifted form:
+		// result = (pixel * (256 - weight) + color * weight) / 256.
+		const auto ca = uint32(add.alphaF() * 0xFF);
+		const auto color = anim::non_premultiplied(QColor(
+			int(add.redF() * 0xFF),
+			int(add.greenF() * 0xFF),
+			int(add.blueF() * 0xFF),
+			0xFF));
+		auto ints = reinterpret_cast<uint32*>(pix);
+		const auto width = image.width();
+		const auto height = image.height();
+		const auto addPerLine = (image.bytesPerLine() / sizeof(uint32)) - width;
+		for (auto y = 0; y != height; ++y) {
+			for (auto x = 0; x != width; ++x) {
+				const auto value = *ints;
+				if (const auto alpha = (value >> 24)) {
+					const auto weight = static_cast<anim::ShiftedMultiplier>(
+						(alpha * ca) >> 8);
+					const auto blended = anim::shifted(value) * (256 - weight)
+						+ color * weight;
+					*ints = anim::unshifted(blended);
+				}
+				++ints;
+			}
+			ints += addPerLine;
 		}
 	}
 	return image;
@@ -512,10 +529,18 @@ QImage prepareOpaque(QImage image) {
 		auto width = image.width();
 		auto height = image.height();
 		auto addPerLine = (image.bytesPerLine() / sizeof(uint32)) - width;
+		const auto opaque = anim::unshifted(bg * 256);
 		for (auto y = 0; y != height; ++y) {
 			for (auto x = 0; x != width; ++x) {
-				auto components = anim::shifted(*ints);
-				*ints++ = anim::unshifted(components * 256 + bg * (256 - anim::getAlpha(components)));
+				const auto value = *ints;
+				const auto alpha = (value >> 24);
+				if (!alpha) {
+					*ints = opaque;
+				} else if (alpha != 0xFF) {
+					auto components = anim::shifted(value);
+					*ints = anim::unshifted(components * 256 + bg * (256 - anim::getAlpha(components)));
+				}
+				++ints;
 			}
 			ints += addPerLine;
 		}
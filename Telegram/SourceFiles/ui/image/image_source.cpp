@@ -80,6 +80,14 @@ int ImageSource::loadOffset() {
 	return 0;
 }
 
+int ImageSource::progressiveScans() {
+	return 0;
+}
+
+QByteArray ImageSource::progressiveBytes() {
+	return QByteArray();
+}
+
 const StorageImageLocation &ImageSource::location() {
 	return StorageImageLocation::Invalid();
 }
@@ -209,6 +217,14 @@ int LocalFileSource::loadOffset() {
 	return 0;
 }
 
+int LocalFileSource::progressiveScans() {
+	return 0;
+}
+
+QByteArray LocalFileSource::progressiveBytes() {
+	return QByteArray();
+}
+
 const StorageImageLocation &LocalFileSource::location() {
 	return StorageImageLocation::Invalid();
 }
@@ -273,6 +289,10 @@ QByteArray LocalFileSource::bytesForCache() {
 QImage RemoteSource::takeLoaded() {
 	if (!_loader || !_loader->finished()) {
 		return QImage();
+	} else if (!_loader->imageDecoded()) {
+		// Until the decoding is done the inline thumbnail is painted.
+		_loader->decodeImageAsync(shrinkBox());
+		return QImage();
 	}
 
 	auto data = _loader->imageData(shrinkBox());
@@ -370,6 +390,9 @@ void RemoteSource::automaticLoadSettingsChanged() {
 void RemoteSource::load(Data::FileOrigin origin) {
 	if (!_loader) {
 		_loader = createLoader(origin, LoadFromCloudOrLocal, false);
+	} else {
+		_loader->permitLoadFromCloud();
+		_loader->stopAutoLoading();
 	}
 	if (_loader) {
 		_loader->start();
@@ -409,6 +432,14 @@ int RemoteSource::loadOffset() {
 	return _loader ? _loader->currentOffset() : 0;
 }
 
+int RemoteSource::progressiveScans() {
+	return _loader ? _loader->progressiveScans() : 0;
+}
+
+QByteArray RemoteSource::progressiveBytes() {
+	return _loader ? _loader->progressiveBytes() : QByteArray();
+}
+
 RemoteSource::~RemoteSource() {
 	unload();
 }
@@ -30,6 +30,8 @@ public:
 	void cancel() override;
 	float64 progress() override;
 	int loadOffset() override;
+	int progressiveScans() override;
+	QByteArray progressiveBytes() override;
 
 	const StorageImageLocation &location() override;
 	void refreshFileReference(const QByteArray &data) override;
@@ -79,6 +81,8 @@ public:
 	void cancel() override;
 	float64 progress() override;
 	int loadOffset() override;
+	int progressiveScans() override;
+	QByteArray progressiveBytes() override;
 
 	const StorageImageLocation &location() override;
 	void refreshFileReference(const QByteArray &data) override;
@@ -125,6 +129,8 @@ public:
 	void cancel() override;
 	float64 progress() override;
 	int loadOffset() override;
+	int progressiveScans() override;
+	QByteArray progressiveBytes() override;
 
 	const StorageImageLocation &location() override;
 	void refreshFileReference(const QByteArray &data) override;
@@ -24,6 +24,18 @@ uint32 fontKey(int size, uint32 flags, int family) {
 	return (((uint32(family) << 10) | uint32(size)) << 3) | flags;
 }
 
+int fontKeySize(uint32 key) {
+	return int((key >> 3) & 0x3FFU);
+}
+
+uint32 fontKeyFlags(uint32 key) {
+	return (key & 0x07U);
+}
+
+int fontKeyFamily(uint32 key) {
+	return int(key >> 13);
+}
+
 } // namespace
 
 void destroyFonts() {
@@ -118,11 +130,30 @@ Font::Font(int size, uint32 flags, const QString &family) {
 		fontFamilies.push_back(family);
 		i = fontFamilyMap.insert(family, fontFamilies.size() - 1);
 	}
-	init(size, flags, i.value(), 0);
+	ptr = nullptr;
+	key = fontKey(size, flags, i.value());
+}
+
+Font::Font(int size, uint32 flags, int family)
+: ptr(nullptr)
+, key(fontKey(size, flags, family)) {
+}
+
+Font::Font(FontData *p)
+: ptr(p)
+, key(fontKey(p->size(), p->flags(), p->family())) {
 }
 
-Font::Font(int size, uint32 flags, int family) {
-	init(size, flags, family, 0);
+void Font::resolve() const {
+	auto i = fontsMap.constFind(key);
+	if (i == fontsMap.cend()) {
+		i = fontsMap.insert(key, new FontData(
+			fontKeySize(key),
+			fontKeyFlags(key),
+			fontKeyFamily(key),
+			nullptr));
+	}
+	ptr = i.value();
 }
 
 Font::Font(int size, uint32 flags, int family, Font *modified) {
@@ -130,7 +161,7 @@ Font::Font(int size, uint32 flags, int family, Font *modified) {
 }
 
 void Font::init(int size, uint32 flags, int family, Font *modified) {
-	uint32 key = fontKey(size, flags, family);
+	key = fontKey(size, flags, family);
 	auto i = fontsMap.constFind(key);
 	if (i == fontsMap.cend()) {
 		i = fontsMap.insert(key, new FontData(size, flags, family, modified));
@@ -14,39 +14,47 @@ void destroyFonts();
 int registerFontFamily(const QString &family);
 
 class FontData;
+
+// Fonts from the style modules are created on first use, so the modules
+// init doesn't create QFont and QFontMetrics for each of them at startup.
 class Font {
 public:
-	Font(Qt::Initialization = Qt::Uninitialized) : ptr(0) {
+	Font(Qt::Initialization = Qt::Uninitialized) : ptr(0), key(0) {
 	}
 	Font(int size, uint32 flags, const QString &family);
 	Font(int size, uint32 flags, int family);
 
 	Font &operator=(const Font &other) {
 		ptr = other.ptr;
+		key = other.key;
 		return (*this);
 	}
 
 	FontData *operator->() const {
-		return ptr;
+		return v();
 	}
 	FontData *v() const {
+		if (!ptr && key) {
+			resolve();
+		}
 		return ptr;
 	}
 
 	operator bool() const {
-		return !!ptr;
+		return ptr || key;
 	}
 
 	operator const QFont &() const;
 
 private:
-	FontData *ptr;
+	mutable FontData *ptr;
+	uint32 key;
 
+	void resolve() const;
 	void init(int size, uint32 flags, int family, Font *modified);
 	friend void startManager();
 
-	Font(FontData *p) : ptr(p) {
-	}
+	Font(FontData *p);
 	Font(int size, uint32 flags, int family, Font *modified);
 	friend class FontData;
 
@@ -109,7 +117,7 @@ inline bool operator!=(const Font &a, const Font &b) {
 }
 
 inline Font::operator const QFont &() const {
-	return ptr->f;
+	return v()->f;
 }
 
 } // namespace internal
@@ -11,16 +11,26 @@ namespace style {
 namespace internal {
 namespace {
 
+// Recolored pixmaps that were not used by the last palettes are dropped
+// when the next palette is applied, the others are reused as they are.
+constexpr auto kKeepPixmapsGenerations = 2;
+
 uint32 colorKey(QColor c) {
 	return (((((uint32(c.red()) << 8) | uint32(c.green())) << 8) | uint32(c.blue())) << 8) | uint32(c.alpha());
 }
 
+struct CachedPixmap {
+	QPixmap pixmap;
+	int generation = 0;
+};
+
 using IconMasks = QMap<const IconMask*, QImage>;
-using IconPixmaps = QMap<QPair<const IconMask*, uint32>, QPixmap>;
+using IconPixmaps = QMap<QPair<const IconMask*, uint32>, CachedPixmap>;
 using IconDatas = OrderedSet<IconData*>;
 NeverFreedPointer<IconMasks> iconMasks;
 NeverFreedPointer<IconPixmaps> iconPixmaps;
 NeverFreedPointer<IconDatas> iconData;
+int iconPixmapsGeneration = 0;
 
 QImage createIconMask(const IconMask *mask, int scale) {
 	auto maskImage = QImage::fromData(mask->data(), mask->size(), "PNG");
@@ -269,12 +279,15 @@ void MonoIcon::ensureColorizedImage(QColor color) const {
 void MonoIcon::createCachedPixmap() const {
 	iconPixmaps.createIfNull();
 	auto key = qMakePair(_mask, colorKey(_color->c));
-	auto j = iconPixmaps->constFind(key);
-	if (j == iconPixmaps->cend()) {
+	auto j = iconPixmaps->find(key);
+	if (j == iconPixmaps->end()) {
 		auto image = colorizeImage(_maskImage, _color);
-		j = iconPixmaps->insert(key, App::pixmapFromImageInPlace(std::move(image)));
+		j = iconPixmaps->insert(
+			key,
+			{ App::pixmapFromImageInPlace(std::move(image)) });
 	}
-	_pixmap = j.value();
+	j.value().generation = iconPixmapsGeneration;
+	_pixmap = j.value().pixmap;
 	_size = _pixmap.size() / cIntRetinaFactor();
 }
 
@@ -333,7 +346,18 @@ int IconData::height() const {
 }
 
 void resetIcons() {
-	iconPixmaps.clear();
+	// Icons with the same color in the new palette find their pixmaps here.
+	++iconPixmapsGeneration;
+	if (iconPixmaps) {
+		const auto oldest = iconPixmapsGeneration - kKeepPixmapsGenerations;
+		for (auto i = iconPixmaps->begin(); i != iconPixmaps->end();) {
+			if (i.value().generation < oldest) {
+				i = iconPixmaps->erase(i);
+			} else {
+				++i;
+			}
+		}
+	}
 	if (iconData) {
 		for (auto data : *iconData) {
 			data->reset();
@@ -139,6 +139,9 @@ const QChar *textSkipCommand(const QChar *from, const QChar *end, bool canLink)
 	return (result < end && *result == TextCommand) ? (result + 1) : from;
 }
 
+// Main thread only. Blocks are shaped and measured right when they are
+// created, with the shared style::font objects. Their QFont engine data
+// and lazily created bold / italic variants are not thread-safe.
 class TextParser {
 public:
 	static Qt::LayoutDirection stringDirection(const QString &str, int32 from, int32 to) {
@@ -188,13 +191,13 @@ public:
 			}
 			lastSkipped = false;
 			if (emoji) {
-				_t->_blocks.push_back(std::make_unique<EmojiBlock>(_t->_st->font, _t->_text, blockStart, len, flags, lnkIndex, emoji));
+				_t->_blocks.push_back(AnyTextBlock::Make<EmojiBlock>(_t->_st->font, _t->_text, blockStart, len, flags, lnkIndex, emoji));
 				emoji = 0;
 				lastSkipped = true;
 			} else if (newline) {
-				_t->_blocks.push_back(std::make_unique<NewlineBlock>(_t->_st->font, _t->_text, blockStart, len, flags, lnkIndex));
+				_t->_blocks.push_back(AnyTextBlock::Make<NewlineBlock>(_t->_st->font, _t->_text, blockStart, len, flags, lnkIndex));
 			} else {
-				_t->_blocks.push_back(std::make_unique<TextBlock>(_t->_st->font, _t->_text, _t->_minResizeWidth, blockStart, len, flags, lnkIndex));
+				_t->_blocks.push_back(AnyTextBlock::Make<TextBlock>(_t->_st->font, _t->_text, _t->_minResizeWidth, blockStart, len, flags, lnkIndex));
 			}
 			blockStart += len;
 			blockCreated();
@@ -204,7 +207,7 @@ public:
 	void createSkipBlock(int32 w, int32 h) {
 		createBlock();
 		_t->_text.push_back('_');
-		_t->_blocks.push_back(std::make_unique<SkipBlock>(_t->_st->font, _t->_text, blockStart++, w, h, lnkIndex));
+		_t->_blocks.push_back(AnyTextBlock::Make<SkipBlock>(_t->_st->font, _t->_text, blockStart++, w, h, lnkIndex));
 		blockCreated();
 	}
 
@@ -1626,7 +1629,7 @@ private:
 		_elideSavedIndex = blockIndex;
 		auto mutableText = const_cast<Text*>(_t);
 		_elideSavedBlock = std::move(mutableText->_blocks[blockIndex]);
-		mutableText->_blocks[blockIndex] = std::make_unique<TextBlock>(_t->_st->font, _t->_text, QFIXED_MAX, elideStart, 0, _elideSavedBlock->flags(), _elideSavedBlock->lnkIndex());
+		mutableText->_blocks[blockIndex] = AnyTextBlock::Make<TextBlock>(_t->_st->font, _t->_text, QFIXED_MAX, elideStart, 0, (*_elideSavedBlock)->flags(), (*_elideSavedBlock)->lnkIndex());
 		_blocksSize = blockIndex + 1;
 		_endBlock = (blockIndex + 1 < _t->_blocks.size() ? _t->_blocks[blockIndex + 1].get() : nullptr);
 	}
@@ -1751,7 +1754,8 @@ private:
 
 	void restoreAfterElided() {
 		if (_elideSavedBlock) {
-			const_cast<Text*>(_t)->_blocks[_elideSavedIndex] = std::move(_elideSavedBlock);
+			const_cast<Text*>(_t)->_blocks[_elideSavedIndex] = std::move(*_elideSavedBlock);
+			_elideSavedBlock = std::nullopt;
 		}
 	}
 
@@ -2440,7 +2444,7 @@ private:
 	// elided hack support
 	int _blocksSize = 0;
 	int _elideSavedIndex = 0;
-	std::unique_ptr<ITextBlock> _elideSavedBlock;
+	std::optional<AnyTextBlock> _elideSavedBlock;
 
 	int _lineStart = 0;
 	int _localFrom = 0;
@@ -2485,20 +2489,19 @@ Text::Text(const Text &other)
 : _minResizeWidth(other._minResizeWidth)
 , _maxWidth(other._maxWidth)
 , _minHeight(other._minHeight)
+, _measured(other._measured)
 , _text(other._text)
 , _st(other._st)
+, _blocks(other._blocks)
 , _links(other._links)
 , _startDir(other._startDir) {
-	_blocks.reserve(other._blocks.size());
-	for (auto &block : other._blocks) {
-		_blocks.push_back(block->clone());
-	}
 }
 
 Text::Text(Text &&other)
 : _minResizeWidth(other._minResizeWidth)
 , _maxWidth(other._maxWidth)
 , _minHeight(other._minHeight)
+, _measured(other._measured)
 , _text(other._text)
 , _st(other._st)
 , _blocks(std::move(other._blocks))
@@ -2513,12 +2516,10 @@ Text &Text::operator=(const Text &other) {
 	_minHeight = other._minHeight;
 	_text = other._text;
 	_st = other._st;
-	_blocks = TextBlocks(other._blocks.size());
+	_blocks = other._blocks;
 	_links = other._links;
 	_startDir = other._startDir;
-	for (int32 i = 0, l = _blocks.size(); i < l; ++i) {
-		_blocks[i] = other._blocks.at(i)->clone();
-	}
+	_measured = other._measured;
 	return *this;
 }
 
@@ -2531,6 +2532,7 @@ Text &Text::operator=(Text &&other) {
 	_blocks = std::move(other._blocks);
 	_links = other._links;
 	_startDir = other._startDir;
+	_measured = other._measured;
 	other.clearFields();
 	return *this;
 }
@@ -2547,6 +2549,8 @@ void Text::setText(const style::TextStyle &st, const QString &text, const TextPa
 void Text::recountNaturalSize(bool initial, Qt::LayoutDirection optionsDir) {
 	NewlineBlock *lastNewline = 0;
 
+	_measured = Measured();
+
 	_maxWidth = _minHeight = 0;
 	int32 lineHeight = 0;
 	int32 result = 0, lastNewlineStart = 0;
@@ -2753,7 +2757,7 @@ bool Text::updateSkipBlock(int width, int height) {
 		_blocks.pop_back();
 	}
 	_text.push_back('_');
-	_blocks.push_back(std::make_unique<SkipBlock>(
+	_blocks.push_back(AnyTextBlock::Make<SkipBlock>(
 		_st->font,
 		_text,
 		_text.size() - 1,
@@ -2778,25 +2782,33 @@ int Text::countWidth(int width) const {
 	if (QFixed(width) >= _maxWidth) {
 		return _maxWidth.ceil().toInt();
 	}
-
-	QFixed maxLineWidth = 0;
-	enumerateLines(width, [&maxLineWidth](QFixed lineWidth, int lineHeight) {
-		if (lineWidth > maxLineWidth) {
-			maxLineWidth = lineWidth;
-		}
-	});
-	return maxLineWidth.ceil().toInt();
+	validateMeasured(width);
+	return _measured.maxLineWidth;
 }
 
 int Text::countHeight(int width) const {
 	if (QFixed(width) >= _maxWidth) {
 		return _minHeight;
 	}
-	int result = 0;
-	enumerateLines(width, [&result](QFixed lineWidth, int lineHeight) {
-		result += lineHeight;
+	validateMeasured(width);
+	return _measured.height;
+}
+
+void Text::validateMeasured(int width) const {
+	if (_measured.width == width) {
+		return;
+	}
+	auto height = 0;
+	auto maxLineWidth = QFixed(0);
+	enumerateLines(width, [&](QFixed lineWidth, int lineHeight) {
+		if (lineWidth > maxLineWidth) {
+			maxLineWidth = lineWidth;
+		}
+		height += lineHeight;
 	});
-	return result;
+	_measured.width = width;
+	_measured.height = height;
+	_measured.maxLineWidth = maxLineWidth.ceil().toInt();
 }
 
 void Text::countLineWidths(int width, QVector<int> *lineWidths) const {
@@ -3152,6 +3164,7 @@ void Text::clearFields() {
 	_blocks.clear();
 	_links.clear();
 	_maxWidth = _minHeight = 0;
+	_measured = Measured();
 	_startDir = Qt::LayoutDirectionAuto;
 }
 
@@ -67,7 +67,7 @@ static constexpr TextSelection AllTextSelection = { 0, 0xFFFF };
 typedef QPair<QString, QString> TextCustomTag; // open str and close str
 typedef QMap<QChar, TextCustomTag> TextCustomTagsMap;
 
-class ITextBlock;
+class AnyTextBlock;
 class Text {
 public:
 	Text(int32 minResizeWidth = QFIXED_MAX);
@@ -187,6 +187,7 @@ public:
 		for (int32 j = from + dots; j < to; ++j) {
 			_text[j] = QChar(' ');
 		}
+		_measured = Measured();
 		return true;
 	}
 
@@ -198,7 +199,7 @@ public:
 	~Text();
 
 private:
-	using TextBlocks = std::vector<std::unique_ptr<ITextBlock>>;
+	using TextBlocks = std::vector<AnyTextBlock>;
 	using TextLinks = QVector<ClickHandlerPtr>;
 
 	uint16 countBlockEnd(const TextBlocks::const_iterator &i, const TextBlocks::const_iterator &e) const;
@@ -214,6 +215,10 @@ private:
 	template <typename Callback>
 	void enumerateLines(int w, Callback callback) const;
 
+	// Lines are laid out once for countWidth() and countHeight()
+	// until the width or the text changes.
+	void validateMeasured(int width) const;
+
 	void recountNaturalSize(bool initial, Qt::LayoutDirection optionsDir = Qt::LayoutDirectionAuto);
 
 	// clear() deletes all blocks and calls this method
@@ -225,9 +230,16 @@ private:
 		bool composeExpanded,
 		bool composeEntities) const;
 
+	struct Measured {
+		int width = -1;
+		int height = 0;
+		int maxLineWidth = 0;
+	};
+
 	QFixed _minResizeWidth;
 	QFixed _maxWidth = 0;
 	int32 _minHeight = 0;
+	mutable Measured _measured;
 
 	QString _text;
 	const style::TextStyle *_st = nullptr;
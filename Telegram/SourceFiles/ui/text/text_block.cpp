@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/text/text_block.h"
 
 #include "core/crash_reports.h"
+#include "base/memory_usage.h"
 
 // COPIED FROM qtextlayout.cpp AND MODIFIED
 namespace {
@@ -143,6 +144,71 @@ static inline void addNextCluster(int &pos, int end, ScriptLine &line, int &glyp
 
 } // anonymous namespace
 
+namespace {
+
+// Parts longer than that are seldom equal, they are shaped each time.
+constexpr auto kShapedMaxLength = 256;
+
+// When fresh entries get over the limit they become stale and the
+// previously stale entries are dropped, hits move entries back to fresh.
+constexpr auto kShapedFreshLimit = 4096;
+
+struct ShapedKey {
+	const style::internal::FontData *font = nullptr;
+	QFixed minResizeWidth;
+	bool link = false;
+	QString text;
+
+	inline bool operator<(const ShapedKey &other) const {
+		return std::tie(font, minResizeWidth, link, text)
+			< std::tie(other.font, other.minResizeWidth, other.link, other.text);
+	}
+};
+
+// Words are kept with offsets from the start of the shaped part.
+struct Shaped {
+	QVector<TextWord> words;
+	QFixed width;
+	QFixed rpadding;
+};
+
+struct ShapedCache {
+	std::map<ShapedKey, Shaped> fresh;
+	std::map<ShapedKey, Shaped> stale;
+};
+
+// Main thread only, like all the text parsing.
+ShapedCache &GetShapedCache() {
+	static auto result = ShapedCache();
+	return result;
+}
+
+const Shaped *FindShaped(const ShapedKey &key) {
+	auto &cache = GetShapedCache();
+	const auto i = cache.fresh.find(key);
+	if (i != end(cache.fresh)) {
+		return &i->second;
+	}
+	const auto j = cache.stale.find(key);
+	if (j == end(cache.stale)) {
+		return nullptr;
+	}
+	auto shaped = std::move(j->second);
+	cache.stale.erase(j);
+	return &cache.fresh.emplace(key, std::move(shaped)).first->second;
+}
+
+void RememberShaped(ShapedKey &&key, Shaped &&shaped) {
+	auto &cache = GetShapedCache();
+	if (cache.fresh.size() >= kShapedFreshLimit) {
+		cache.stale = std::move(cache.fresh);
+		cache.fresh.clear();
+	}
+	cache.fresh.emplace(std::move(key), std::move(shaped));
+}
+
+} // namespace
+
 class BlockParser {
 public:
 
@@ -326,14 +392,37 @@ TextBlock::TextBlock(const style::font &font, const QString &str, QFixed minResi
 		}
 
 		const auto part = str.mid(_from, length);
+		const auto cacheable = (length <= kShapedMaxLength);
+		auto key = ShapedKey{
+			blockFont.v(),
+			minResizeWidth,
+			(lnkIndex > 0),
+			cacheable ? part : QString()
+		};
+		if (const auto shaped = cacheable ? FindShaped(key) : nullptr) {
+			_words = shaped->words;
+			_width = shaped->width;
+			_rpadding = shaped->rpadding;
+		} else {
+			// Attempt to catch a crash in text processing
+			CrashReports::SetAnnotationRef("CrashString", &part);
 
-		// Attempt to catch a crash in text processing
-		CrashReports::SetAnnotationRef("CrashString", &part);
+			QStackTextEngine engine(part, blockFont->f);
+			BlockParser parser(&engine, this, minResizeWidth, 0, part);
 
-		QStackTextEngine engine(part, blockFont->f);
-		BlockParser parser(&engine, this, minResizeWidth, _from, part);
+			CrashReports::ClearAnnotationRef("CrashString");
 
-		CrashReports::ClearAnnotationRef("CrashString");
+			if (cacheable) {
+				RememberShaped(
+					std::move(key),
+					Shaped{ _words, _width, _rpadding });
+			}
+		}
+		if (_from) {
+			for (auto &word : _words) {
+				word.shift_from(_from);
+			}
+		}
 	}
 }
 
@@ -357,3 +446,77 @@ SkipBlock::SkipBlock(const style::font &font, const QString &str, uint16 from, i
 	_flags |= ((TextBlockTSkip & 0x0F) << 8);
 	_width = w;
 }
+
+AnyTextBlock::AnyTextBlock() {
+	base::memory::Allocated(base::memory::Tag::TextBlocks, kSize);
+}
+
+AnyTextBlock::AnyTextBlock(const AnyTextBlock &other)
+: AnyTextBlock() {
+	copyFrom(other);
+}
+
+AnyTextBlock::AnyTextBlock(AnyTextBlock &&other) noexcept
+: AnyTextBlock() {
+	moveFrom(std::move(other));
+}
+
+AnyTextBlock &AnyTextBlock::operator=(const AnyTextBlock &other) {
+	if (this != &other) {
+		get()->~ITextBlock();
+		copyFrom(other);
+	}
+	return *this;
+}
+
+AnyTextBlock &AnyTextBlock::operator=(AnyTextBlock &&other) noexcept {
+	if (this != &other) {
+		get()->~ITextBlock();
+		moveFrom(std::move(other));
+	}
+	return *this;
+}
+
+AnyTextBlock::~AnyTextBlock() {
+	get()->~ITextBlock();
+	base::memory::Freed(base::memory::Tag::TextBlocks, kSize);
+}
+
+void AnyTextBlock::copyFrom(const AnyTextBlock &other) {
+	const auto block = other.get();
+	switch (block->type()) {
+	case TextBlockTNewline:
+		new (_data) NewlineBlock(*static_cast<NewlineBlock*>(block));
+		break;
+	case TextBlockTText:
+		new (_data) TextBlock(*static_cast<TextBlock*>(block));
+		break;
+	case TextBlockTEmoji:
+		new (_data) EmojiBlock(*static_cast<EmojiBlock*>(block));
+		break;
+	case TextBlockTSkip:
+		new (_data) SkipBlock(*static_cast<SkipBlock*>(block));
+		break;
+	default: Unexpected("Type in AnyTextBlock::copyFrom.");
+	}
+}
+
+// The moved-from block stays alive until its holder is destroyed.
+void AnyTextBlock::moveFrom(AnyTextBlock &&other) {
+	const auto block = other.get();
+	switch (block->type()) {
+	case TextBlockTNewline:
+		new (_data) NewlineBlock(std::move(*static_cast<NewlineBlock*>(block)));
+		break;
+	case TextBlockTText:
+		new (_data) TextBlock(std::move(*static_cast<TextBlock*>(block)));
+		break;
+	case TextBlockTEmoji:
+		new (_data) EmojiBlock(std::move(*static_cast<EmojiBlock*>(block)));
+		break;
+	case TextBlockTSkip:
+		new (_data) SkipBlock(std::move(*static_cast<SkipBlock*>(block)));
+		break;
+	default: Unexpected("Type in AnyTextBlock::moveFrom.");
+	}
+}
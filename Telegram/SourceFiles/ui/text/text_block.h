@@ -64,7 +64,6 @@ public:
 		return (_flags & 0xFF);
 	}
 
-	virtual std::unique_ptr<ITextBlock> clone() const = 0;
 	virtual ~ITextBlock() {
 	}
 
@@ -94,10 +93,6 @@ public:
 		return _nextDir;
 	}
 
-	std::unique_ptr<ITextBlock> clone() const override {
-		return std::make_unique<NewlineBlock>(*this);
-	}
-
 private:
 	Qt::LayoutDirection _nextDir;
 
@@ -112,9 +107,9 @@ class TextWord {
 public:
 	TextWord() = default;
 	TextWord(uint16 from, QFixed width, QFixed rbearing, QFixed rpadding = 0)
-		: _from(from)
-		, _width(width)
+		: _width(width)
 		, _rpadding(rpadding)
+		, _from(from)
 		, _rbearing(rbearing.value() > 0x7FFF ? 0x7FFF : (rbearing.value() < -0x7FFF ? -0x7FFF : rbearing.value())) {
 	}
 	uint16 from() const {
@@ -132,10 +127,13 @@ public:
 	void add_rpadding(QFixed padding) {
 		_rpadding += padding;
 	}
+	void shift_from(uint16 offset) {
+		_from += offset;
+	}
 
 private:
-	uint16 _from = 0;
 	QFixed _width, _rpadding;
+	uint16 _from = 0;
 	int16 _rbearing = 0;
 
 };
@@ -144,10 +142,6 @@ class TextBlock : public ITextBlock {
 public:
 	TextBlock(const style::font &font, const QString &str, QFixed minResizeWidth, uint16 from, uint16 length, uchar flags, uint16 lnkIndex);
 
-	std::unique_ptr<ITextBlock> clone() const override {
-		return std::make_unique<TextBlock>(*this);
-	}
-
 private:
 	friend class ITextBlock;
 	QFixed real_f_rbearing() const {
@@ -169,10 +163,6 @@ class EmojiBlock : public ITextBlock {
 public:
 	EmojiBlock(const style::font &font, const QString &str, uint16 from, uint16 length, uchar flags, uint16 lnkIndex, EmojiPtr emoji);
 
-	std::unique_ptr<ITextBlock> clone() const {
-		return std::make_unique<EmojiBlock>(*this);
-	}
-
 private:
 	EmojiPtr emoji = nullptr;
 
@@ -191,10 +181,6 @@ public:
 		return _height;
 	}
 
-	std::unique_ptr<ITextBlock> clone() const override {
-		return std::make_unique<SkipBlock>(*this);
-	}
-
 private:
 	int32 _height;
 
@@ -204,3 +190,63 @@ private:
 	friend class TextPainter;
 
 };
+
+// Blocks of any type are kept by value, so all the blocks of a text
+// live in one contiguous allocation instead of one allocation each.
+class AnyTextBlock final {
+public:
+	template <typename BlockType, typename ...Args>
+	[[nodiscard]] static AnyTextBlock Make(Args &&...args);
+
+	AnyTextBlock(const AnyTextBlock &other);
+	AnyTextBlock(AnyTextBlock &&other) noexcept;
+	AnyTextBlock &operator=(const AnyTextBlock &other);
+	AnyTextBlock &operator=(AnyTextBlock &&other) noexcept;
+	~AnyTextBlock();
+
+	[[nodiscard]] ITextBlock *get() const {
+		return reinterpret_cast<ITextBlock*>(const_cast<char*>(_data));
+	}
+	[[nodiscard]] ITextBlock *operator->() const {
+		return get();
+	}
+	[[nodiscard]] ITextBlock &operator*() const {
+		return *get();
+	}
+
+private:
+	AnyTextBlock();
+
+	void copyFrom(const AnyTextBlock &other);
+	void moveFrom(AnyTextBlock &&other);
+
+	static constexpr auto kSize = std::max({
+		sizeof(NewlineBlock),
+		sizeof(TextBlock),
+		sizeof(EmojiBlock),
+		sizeof(SkipBlock) });
+	static constexpr auto kAlignment = std::max({
+		alignof(NewlineBlock),
+		alignof(TextBlock),
+		alignof(EmojiBlock),
+		alignof(SkipBlock) });
+
+	alignas(kAlignment) char _data[kSize];
+
+};
+
+template <typename BlockType, typename ...Args>
+AnyTextBlock AnyTextBlock::Make(Args &&...args) {
+	static_assert(
+		std::is_base_of<ITextBlock, BlockType>::value,
+		"AnyTextBlock should hold an ITextBlock.");
+
+	auto result = AnyTextBlock();
+	const auto block = new (result._data) BlockType(
+		std::forward<Args>(args)...);
+
+	// get() relies on the ITextBlock being at the start of any block.
+	Ensures(static_cast<ITextBlock*>(block) == result.get());
+
+	return result;
+}
@@ -1130,6 +1130,63 @@ const QRegularExpression &RegExpWordSplit() {
 	return result;
 }
 
+// Last positions of characters without which the corresponding
+// expression can't match: any domain has a '.', an explicit domain
+// has a ':', a mention has a '@', a hashtag has a '#' and a bot
+// command has a '/'. Positions are -1 if there are no such chars.
+struct EntityTriggers {
+	int dot = -1;
+	int colon = -1;
+	int at = -1;
+	int hash = -1;
+	int slash = -1;
+};
+
+// Four UTF-16 units in one uint64, high bit set in each zero unit.
+inline uint64 ZeroUnits(uint64 chunk) {
+	return (chunk - 0x0001000100010001ULL)
+		& ~chunk
+		& 0x8000800080008000ULL;
+}
+
+inline uint64 EqualUnits(uint64 chunk, ushort unit) {
+	return ZeroUnits(chunk ^ (uint64(unit) * 0x0001000100010001ULL));
+}
+
+EntityTriggers FindEntityTriggers(const QChar *start, int length) {
+	auto result = EntityTriggers();
+	const auto check = [&](int offset) {
+		switch (start[offset].unicode()) {
+		case '.': result.dot = offset; break;
+		case ':': result.colon = offset; break;
+		case '@': result.at = offset; break;
+		case '#': result.hash = offset; break;
+		case '/': result.slash = offset; break;
+		}
+	};
+
+	// Most of the chunks in a long text have no triggers at all.
+	constexpr auto kChunk = int(sizeof(uint64) / sizeof(QChar));
+	auto offset = 0;
+	for (; offset + kChunk <= length; offset += kChunk) {
+		auto chunk = uint64();
+		memcpy(&chunk, start + offset, sizeof(chunk));
+		if (EqualUnits(chunk, '.')
+			| EqualUnits(chunk, ':')
+			| EqualUnits(chunk, '@')
+			| EqualUnits(chunk, '#')
+			| EqualUnits(chunk, '/')) {
+			for (auto i = offset; i != offset + kChunk; ++i) {
+				check(i);
+			}
+		}
+	}
+	for (; offset != length; ++offset) {
+		check(offset);
+	}
+	return result;
+}
+
 } // namespace
 
 const QRegularExpression &RegExpMailNameAtEnd() {
@@ -1579,6 +1636,7 @@ void ParseEntities(TextWithEntities &result, int32 flags, bool rich) {
 	int32 len = result.text.size(), commandOffset = rich ? 0 : len;
 	bool inLink = false, commandIsLink = false;
 	const QChar *start = result.text.constData(), *end = start + result.text.size();
+	const auto triggers = FindEntityTriggers(start, len);
 	for (int32 offset = 0, matchOffset = offset, mentionSkip = 0; offset < len;) {
 		if (commandOffset <= offset) {
 			for (commandOffset = offset; commandOffset < len; ++commandOffset) {
@@ -1589,11 +1647,27 @@ void ParseEntities(TextWithEntities &result, int32 flags, bool rich) {
 				}
 			}
 		}
-		auto mDomain = qthelp::RegExpDomain().match(result.text, matchOffset);
-		auto mExplicitDomain = qthelp::RegExpDomainExplicit().match(result.text, matchOffset);
-		auto mHashtag = withHashtags ? RegExpHashtag().match(result.text, matchOffset) : QRegularExpressionMatch();
-		auto mMention = withMentions ? RegExpMention().match(result.text, qMax(mentionSkip, matchOffset)) : QRegularExpressionMatch();
-		auto mBotCommand = withBotCommands ? RegExpBotCommand().match(result.text, matchOffset) : QRegularExpressionMatch();
+		const auto mentionOffset = qMax(mentionSkip, matchOffset);
+		const auto tryDomain = (triggers.dot >= matchOffset);
+		const auto tryExplicitDomain = (triggers.colon >= matchOffset);
+		const auto tryHashtag = withHashtags
+			&& (triggers.hash >= matchOffset);
+		const auto tryMention = withMentions
+			&& (triggers.at >= mentionOffset);
+		const auto tryBotCommand = withBotCommands
+			&& (triggers.slash >= matchOffset);
+		if (!tryDomain
+			&& !tryExplicitDomain
+			&& !tryHashtag
+			&& !tryMention
+			&& !tryBotCommand) {
+			break;
+		}
+		auto mDomain = tryDomain ? qthelp::RegExpDomain().match(result.text, matchOffset) : QRegularExpressionMatch();
+		auto mExplicitDomain = tryExplicitDomain ? qthelp::RegExpDomainExplicit().match(result.text, matchOffset) : QRegularExpressionMatch();
+		auto mHashtag = tryHashtag ? RegExpHashtag().match(result.text, matchOffset) : QRegularExpressionMatch();
+		auto mMention = tryMention ? RegExpMention().match(result.text, mentionOffset) : QRegularExpressionMatch();
+		auto mBotCommand = tryBotCommand ? RegExpBotCommand().match(result.text, matchOffset) : QRegularExpressionMatch();
 
 		auto lnkType = EntityType::Url;
 		int32 lnkStart = 0, lnkLength = 0;
@@ -789,6 +789,61 @@ QString ExpandCustomLinks(const TextWithTags &text) {
 	return result;
 }
 
+// Replaces all emoji in [from, till) in one pass, starting from the end
+// so that the found positions stay valid. Updates "till" and "tagTill"
+// to the positions they have after the replacement.
+void ReplaceEmojiInRange(
+		not_null<QTextDocument*> document,
+		int from,
+		int &till,
+		int &tagTill) {
+	struct Found {
+		int position = 0;
+		int length = 0;
+		EmojiPtr emoji = nullptr;
+	};
+	auto found = std::vector<Found>();
+
+	auto cursor = QTextCursor(document->docHandle(), from);
+	cursor.setPosition(till, QTextCursor::KeepAnchor);
+	const auto text = cursor.selectedText();
+	const auto start = text.constData();
+	const auto end = start + text.size();
+	for (auto ch = start; ch < end;) {
+		auto length = 0;
+		if (const auto emoji = Ui::Emoji::Find(ch, end, &length)) {
+			found.push_back({ from + int(ch - start), length, emoji });
+			ch += length;
+		} else if (ch + 1 < end
+			&& ch->isHighSurrogate()
+			&& (ch + 1)->isLowSurrogate()) {
+			ch += 2;
+		} else {
+			++ch;
+		}
+	}
+	if (found.empty()) {
+		return;
+	}
+
+	PrepareFormattingOptimization(document);
+	for (auto i = found.rbegin(); i != found.rend(); ++i) {
+		auto cursor = QTextCursor(document->docHandle(), i->position);
+		cursor.setPosition(
+			i->position + i->length,
+			QTextCursor::KeepAnchor);
+		InsertEmojiAtCursor(cursor, i->emoji);
+
+		const auto removed = i->length - 1;
+		till -= removed;
+		if (tagTill >= i->position + i->length) {
+			tagTill -= removed;
+		} else if (tagTill > i->position) {
+			tagTill = i->position + 1;
+		}
+	}
+}
+
 } // namespace
 
 const QString InputField::kTagBold = qsl("**");
@@ -1942,13 +1997,21 @@ void InputField::processFormatting(int insertPosition, int insertEnd) {
 	auto insertedTagsProcessor = _insertedTagsAreFromMime
 		? _tagMimeProcessor.get()
 		: nullptr;
-	const auto breakTagOnNotLetterTill = ProcessInsertedTags(
+	auto breakTagOnNotLetterTill = ProcessInsertedTags(
 		_st,
 		document,
 		insertPosition,
 		insertEnd,
 		_insertedTags,
 		insertedTagsProcessor);
+
+	// Replace all the inserted emoji at once, a large pasted text could
+	// have thousands of them and the loop below restarts on each action.
+	ReplaceEmojiInRange(
+		document,
+		insertPosition,
+		insertEnd,
+		breakTagOnNotLetterTill);
 	using ActionType = FormattingAction::Type;
 	while (true) {
 		FormattingAction action;
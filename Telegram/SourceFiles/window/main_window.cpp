@@ -43,6 +43,10 @@ QImage LoadLogoNoMargin() {
 	return QImage(qsl(":/gui/art/logo_256_no_margin.png"));
 }
 
+int IconCounterSlice(int count) {
+	return (count < 1000) ? count : (1000 + (count % 100));
+}
+
 void ConvertIconToBlack(QImage &image) {
 	if (image.format() != QImage::Format_ARGB32_Premultiplied) {
 		image = std::move(image).convertToFormat(
@@ -328,6 +332,8 @@ void MainWindow::handleStateChanged(Qt::WindowState state) {
 void MainWindow::handleActiveChanged() {
 	if (isActiveWindow()) {
 		Core::App().checkMediaViewActivation();
+	} else if (AuthSession::Exists()) {
+		Auth().api().flushReadRequests();
 	}
 	App::CallDelayed(1, this, [this] {
 		updateTrayMenu();
@@ -491,6 +497,17 @@ void MainWindow::updateUnreadCounter() {
 	unreadCounterChangedHook();
 }
 
+bool MainWindow::iconCounterChanged() {
+	const auto slice = IconCounterSlice(Core::App().unreadBadge());
+	const auto muted = Core::App().unreadBadgeMuted();
+	if (_iconCounterSlice == slice && _iconCounterMuted == muted) {
+		return false;
+	}
+	_iconCounterSlice = slice;
+	_iconCounterMuted = muted;
+	return true;
+}
+
 void MainWindow::savePosition(Qt::WindowState state) {
 	if (state == Qt::WindowActive) state = windowHandle()->windowState();
 	if (state == Qt::WindowMinimized || !positionInited()) return;
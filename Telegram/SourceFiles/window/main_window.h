@@ -24,6 +24,10 @@ QImage LoadLogoNoMargin();
 QIcon CreateIcon();
 void ConvertIconToBlack(QImage &image);
 
+// Counters from 1000 are shown as "..NN" in the icon badges,
+// so all the counters with the same slice are drawn the same way.
+[[nodiscard]] int IconCounterSlice(int count);
+
 class MainWindow : public Ui::RpWidget, protected base::Subscriber {
 	Q_OBJECT
 
@@ -121,6 +125,9 @@ protected:
 	virtual void unreadCounterChangedHook() {
 	}
 
+	// The icons are redrawn only when the badge digits or color change.
+	[[nodiscard]] bool iconCounterChanged();
+
 	virtual void closeWithoutDestroy() {
 		hide();
 	}
@@ -173,6 +180,8 @@ private:
 	QIcon _icon;
 	bool _usingSupportIcon = false;
 	QString _titleText;
+	int _iconCounterSlice = -1;
+	bool _iconCounterMuted = false;
 
 	bool _isActive = false;
 	base::Timer _isActiveTimer;
@@ -32,6 +32,14 @@ namespace {
 constexpr auto kMinimalAlertDelay = crl::time(500);
 constexpr auto kWaitingForAllGroupedDelay = crl::time(1000);
 
+// A busy chat gets not more than one notification in 2s, the messages
+// that come in between are shown as one notification with the last of them.
+constexpr auto kHistoryNotificationsDelay = crl::time(2000);
+
+// Not more than 5 notifications in 3s from all the chats.
+constexpr auto kNotificationsRateLimit = 5;
+constexpr auto kNotificationsRateInterval = crl::time(3000);
+
 } // namespace
 
 System::System(AuthSession *session)
@@ -139,6 +147,7 @@ void System::clearAll() {
 	_whenAlerts.clear();
 	_waiters.clear();
 	_settingWaiters.clear();
+	_whenShown.clear();
 }
 
 void System::clearFromHistory(History *history) {
@@ -149,6 +158,7 @@ void System::clearFromHistory(History *history) {
 	_whenAlerts.remove(history);
 	_waiters.remove(history);
 	_settingWaiters.remove(history);
+	_whenShown.remove(history);
 
 	_waitTimer.cancel();
 	showNext();
@@ -165,6 +175,7 @@ void System::clearAllFast() {
 	_whenAlerts.clear();
 	_waiters.clear();
 	_settingWaiters.clear();
+	_whenShown.clear();
 }
 
 void System::checkDelayed() {
@@ -217,6 +228,7 @@ void System::showGrouped() {
 	if (const auto lastItem = Auth().data().message(_lastHistoryItemId)) {
 		_waitForAllGroupedTimer.cancel();
 		_manager->showNotification(lastItem, _lastForwardedCount);
+		notificationShown(lastItem->history(), crl::now());
 		_lastForwardedCount = 0;
 		_lastHistoryItemId = FullMsgId();
 	}
@@ -312,6 +324,10 @@ void System::showNext() {
 				continue;
 			}
 			auto when = i.value().when;
+			const auto shown = _whenShown.constFind(history);
+			if (shown != _whenShown.cend()) {
+				accumulate_max(when, shown.value() + kHistoryNotificationsDelay);
+			}
 			if (!notifyItem || next > when) {
 				next = when;
 				notifyItem = history->currentNotification();
@@ -320,6 +336,7 @@ void System::showNext() {
 			++i;
 		}
 		if (notifyItem) {
+			accumulate_max(next, nextAllowedShow(ms));
 			if (next > ms) {
 				if (nextAlert && nextAlert < next) {
 					next = nextAlert;
@@ -328,6 +345,9 @@ void System::showNext() {
 				_waitTimer.callOnce(next - ms);
 				break;
 			} else {
+				coalesceWaiting(notifyHistory, ms);
+				notifyItem = notifyHistory->currentNotification();
+
 				const auto isForwarded = notifyItem->Has<HistoryMessageForwarded>();
 				const auto isAlbum = notifyItem->groupId();
 
@@ -407,6 +427,7 @@ void System::showNext() {
 					// to show the previous notification.
 					showGrouped();
 					_manager->showNotification(notifyItem, forwardedCount);
+					notificationShown(history, ms);
 				}
 
 				if (!history->hasNotification()) {
@@ -424,6 +445,50 @@ void System::showNext() {
 	}
 }
 
+crl::time System::nextAllowedShow(crl::time now) {
+	while (!_shownTimes.empty()
+		&& _shownTimes.front() + kNotificationsRateInterval <= now) {
+		_shownTimes.pop_front();
+	}
+	return (int(_shownTimes.size()) < kNotificationsRateLimit)
+		? now
+		: (_shownTimes.front() + kNotificationsRateInterval);
+}
+
+void System::coalesceWaiting(not_null<History*> history, crl::time now) {
+	const auto j = _whenMaps.find(history);
+	if (j == _whenMaps.end()) {
+		return;
+	}
+	const auto grouped = [](not_null<HistoryItem*> item) {
+		return item->Has<HistoryMessageForwarded>() || item->groupId();
+	};
+	while (const auto next = history->nextNotification()) {
+		const auto current = history->currentNotification();
+		const auto k = j.value().constFind(next->id);
+		if (grouped(current)
+			|| grouped(next)
+			|| k == j.value().cend()
+			|| k.value() > now) {
+			break;
+		}
+		j.value().remove(current->id);
+		history->skipNotification();
+	}
+}
+
+void System::notificationShown(not_null<History*> history, crl::time now) {
+	_shownTimes.push_back(now);
+	for (auto i = _whenShown.begin(); i != _whenShown.end();) {
+		if (i.value() + kHistoryNotificationsDelay <= now) {
+			i = _whenShown.erase(i);
+		} else {
+			++i;
+		}
+	}
+	_whenShown.insert(history, now);
+}
+
 void System::ensureSoundCreated() {
 	if (_soundTrack) {
 		return;
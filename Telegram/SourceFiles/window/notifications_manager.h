@@ -82,6 +82,10 @@ private:
 	void showGrouped();
 	void ensureSoundCreated();
 
+	[[nodiscard]] crl::time nextAllowedShow(crl::time now);
+	void coalesceWaiting(not_null<History*> history, crl::time now);
+	void notificationShown(not_null<History*> history, crl::time now);
+
 	AuthSession *_authSession = nullptr;
 
 	QMap<History*, QMap<MsgId, crl::time>> _whenMaps;
@@ -104,6 +108,9 @@ private:
 
 	QMap<History*, QMap<crl::time, PeerData*>> _whenAlerts;
 
+	QMap<History*, crl::time> _whenShown;
+	std::deque<crl::time> _shownTimes;
+
 	std::unique_ptr<Manager> _manager;
 
 	base::Observable<ChangeType> _settingsChanged;
@@ -28,6 +28,15 @@ CachedUserpics::CachedUserpics(Type type)
 }
 
 QString CachedUserpics::get(const InMemoryKey &key, PeerData *peer) {
+	const auto prepared = prepare(key, peer);
+	if (!prepared.image.isNull()) {
+		prepared.image.save(prepared.path, "PNG");
+	}
+	return prepared.path;
+}
+
+auto CachedUserpics::prepare(const InMemoryKey &key, PeerData *peer)
+-> Prepared {
 	auto ms = crl::now();
 	auto i = _images.find(key);
 	if (i != _images.cend()) {
@@ -35,28 +44,24 @@ QString CachedUserpics::get(const InMemoryKey &key, PeerData *peer) {
 			i->until = ms + kNotifyDeletePhotoAfterMs;
 			clearInMs(-kNotifyDeletePhotoAfterMs);
 		}
+		return { i->path };
+	}
+	Image v;
+	if (key.first) {
+		v.until = ms + kNotifyDeletePhotoAfterMs;
+		clearInMs(-kNotifyDeletePhotoAfterMs);
 	} else {
-		Image v;
-		if (key.first) {
-			v.until = ms + kNotifyDeletePhotoAfterMs;
-			clearInMs(-kNotifyDeletePhotoAfterMs);
-		} else {
-			v.until = 0;
-		}
-		v.path = cWorkingDir() + qsl("tdata/temp/") + QString::number(rand_value<uint64>(), 16) + qsl(".png");
-		if (key.first || key.second) {
-			if (_type == Type::Rounded) {
-				peer->saveUserpicRounded(v.path, st::notifyMacPhotoSize);
-			} else {
-				peer->saveUserpic(v.path, st::notifyMacPhotoSize);
-			}
-		} else {
-			Core::App().logoNoMargin().save(v.path, "PNG");
-		}
-		i = _images.insert(key, v);
-		_someSavedFlag = true;
+		v.until = 0;
 	}
-	return i->path;
+	v.path = cWorkingDir() + qsl("tdata/temp/") + QString::number(rand_value<uint64>(), 16) + qsl(".png");
+	auto image = (key.first || key.second)
+		? (_type == Type::Rounded
+			? peer->genUserpicRounded(st::notifyMacPhotoSize)
+			: peer->genUserpic(st::notifyMacPhotoSize)).toImage()
+		: Core::App().logoNoMargin();
+	i = _images.insert(key, v);
+	_someSavedFlag = true;
+	return { i->path, std::move(image) };
 }
 
 crl::time CachedUserpics::clear(crl::time ms) {
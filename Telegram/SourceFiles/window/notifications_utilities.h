@@ -25,6 +25,14 @@ public:
 
 	QString get(const InMemoryKey &key, PeerData *peer);
 
+	// Same as get(), but doesn't write the userpic file, if the returned
+	// image is not null it should be saved to the path before using it.
+	struct Prepared {
+		QString path;
+		QImage image;
+	};
+	[[nodiscard]] Prepared prepare(const InMemoryKey &key, PeerData *peer);
+
 	~CachedUserpics();
 
 private slots:
@@ -109,7 +109,14 @@ void SectionWidget::PaintBackground(not_null<QWidget*> widget, QRect clip) {
 		} else {
 			PainterHighQualityEnabler hq(p);
 
-			auto &pix = Window::Theme::Background()->pixmap();
+			// While resizing paint a blurred placeholder instead of
+			// scaling the whole wallpaper for each frame.
+			const auto background = Window::Theme::Background();
+			const auto resizing = App::main()->hasCachedBackgrounds()
+				&& !background->pixmapForResize().isNull();
+			auto &pix = resizing
+				? background->pixmapForResize()
+				: background->pixmap();
 			QRect to, from;
 			Window::Theme::ComputeBackgroundRects(fill, pix.size(), to, from);
 			to.moveTop(to.top() + fromy);
@@ -16,6 +16,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/file_upload.h"
 #include "base/parse_helper.h"
 #include "base/zlib_help.h"
+#include "base/binary_guard.h"
 #include "data/data_session.h"
 #include "ui/image/image.h"
 #include "boxes/background_box.h"
@@ -31,6 +32,7 @@ constexpr auto kThemeFileSizeLimit = 5 * 1024 * 1024;
 constexpr auto kThemeBackgroundSizeLimit = 4 * 1024 * 1024;
 constexpr auto kBackgroundSizeLimit = 25 * 1024 * 1024;
 constexpr auto kThemeSchemeSizeLimit = 1024 * 1024;
+constexpr auto kResizePlaceholderSize = 96;
 constexpr auto kNightThemeFile = str_const(":/gui/night.tdesktop-theme");
 
 struct Applying {
@@ -42,8 +44,15 @@ struct Applying {
 	Fn<void()> overrideKeep;
 };
 
+// The theme that is being read and unpacked on a background thread.
+struct Preparing {
+	base::binary_guard guard;
+	bool keepApplied = false;
+};
+
 NeverFreedPointer<ChatBackground> GlobalBackground;
 Applying GlobalApplying;
+Preparing GlobalPreparing;
 
 inline bool AreTestingTheme() {
 	return !GlobalApplying.paletteForRevert.isEmpty();
@@ -297,7 +306,9 @@ bool loadTheme(const QByteArray &content, Cached &cache, Instance *out = nullptr
 		if (!loadColorScheme(schemeContent, out)) {
 			return false;
 		}
-		Background()->saveAdjustableColors();
+		if (!out) {
+			Background()->saveAdjustableColors();
+		}
 
 		auto backgroundTiled = false;
 		auto backgroundContent = QByteArray();
@@ -333,7 +344,9 @@ bool loadTheme(const QByteArray &content, Cached &cache, Instance *out = nullptr
 		if (!loadColorScheme(content, out)) {
 			return false;
 		}
-		Background()->saveAdjustableColors();
+		if (!out) {
+			Background()->saveAdjustableColors();
+		}
 	}
 	if (out) {
 		cache.colors = out->palette.save();
@@ -368,6 +381,35 @@ void ClearApplying() {
 	GlobalApplying = Applying();
 }
 
+void CancelPreparing() {
+	GlobalPreparing = Preparing();
+}
+
+// Runs "prepare" on a background thread and passes its result to "ready"
+// on the main thread, unless some other theme was applied meanwhile.
+template <typename Prepare, typename Ready>
+void PrepareAsync(Prepare &&prepare, Ready &&ready) {
+	GlobalPreparing.keepApplied = false;
+	crl::async([
+		prepare = std::forward<Prepare>(prepare),
+		ready = std::forward<Ready>(ready),
+		guard = GlobalPreparing.guard.make_guard()
+	]() mutable {
+		auto result = prepare();
+		crl::on_main(std::move(guard), [
+			ready = std::move(ready),
+			result = std::move(result)
+		]() mutable {
+			const auto keep = base::take(GlobalPreparing.keepApplied);
+			CancelPreparing();
+			ready(std::move(result));
+			if (keep) {
+				KeepApplied();
+			}
+		});
+	});
+}
+
 } // namespace
 
 ChatBackground::AdjustableColor::AdjustableColor(style::color data)
@@ -528,6 +570,7 @@ void ChatBackground::set(const Data::WallPaper &paper, QImage image) {
 				_original = QImage();
 				_pixmap = QPixmap();
 				_pixmapForTiled = QPixmap();
+				_pixmapForResize = QPixmap();
 				if (adjustPaletteRequired()) {
 					adjustPaletteUsingColor(*fill);
 				}
@@ -595,6 +638,13 @@ void ChatBackground::preparePixmaps(QImage image) {
 		_pixmapForTiled = App::pixmapFromImageInPlace(std::move(imageForTiled));
 	}
 	_isMonoColorImage = CalculateIsMonoColorImage(image);
+	auto imageForResize = Images::prepareBlur(image.scaled(
+		kResizePlaceholderSize,
+		kResizePlaceholderSize,
+		Qt::KeepAspectRatio,
+		Qt::SmoothTransformation));
+	imageForResize.setDevicePixelRatio(1.);
+	_pixmapForResize = App::pixmapFromImageInPlace(std::move(imageForResize));
 	_pixmap = App::pixmapFromImageInPlace(std::move(image));
 	if (!isSmallForTiled) {
 		_pixmapForTiled = _pixmap;
@@ -901,34 +951,62 @@ void ChatBackground::toggleNightMode(std::optional<QString> themePath) {
 	const auto newNightMode = !_nightMode;
 	_nightMode = newNightMode;
 	auto read = settingDefault ? Saved() : Local::readThemeAfterSwitch();
-	auto path = read.pathAbsolute;
-
 	_nightMode = oldNightMode;
-	auto oldTileValue = (_nightMode ? _tileNightValue : _tileDayValue);
-	const auto alreadyOnDisk = [&] {
-		if (read.content.isEmpty()) {
-			return false;
+
+	const auto defaultPath = themePath
+		? *themePath
+		: (newNightMode ? NightThemePath() : QString());
+	struct Prepared {
+		std::unique_ptr<Preview> preview;
+		bool alreadyOnDisk = false;
+	};
+	PrepareAsync([=, read = std::move(read)]() mutable {
+		auto result = Prepared();
+		if (!read.content.isEmpty()) {
+			auto preview = std::make_unique<Preview>();
+			preview->pathAbsolute = std::move(read.pathAbsolute);
+			preview->pathRelative = std::move(read.pathRelative);
+			preview->content = std::move(read.content);
+			preview->instance.cached = std::move(read.cache);
+			const auto loaded = loadTheme(
+				preview->content,
+				preview->instance.cached,
+				&preview->instance);
+			if (loaded) {
+				result.preview = std::move(preview);
+				result.alreadyOnDisk = true;
+				return result;
+			}
 		}
-		auto preview = std::make_unique<Preview>();
-		preview->pathAbsolute = std::move(read.pathAbsolute);
-		preview->pathRelative = std::move(read.pathRelative);
-		preview->content = std::move(read.content);
-		preview->instance.cached = std::move(read.cache);
-		const auto loaded = loadTheme(
-			preview->content,
-			preview->instance.cached,
-			&preview->instance);
-		if (!loaded) {
-			return false;
+		if (!defaultPath.isEmpty()) {
+			result.preview = PreviewFromFile(defaultPath);
 		}
+		return result;
+	}, [=](Prepared &&prepared) {
+		const auto path = prepared.alreadyOnDisk
+			? prepared.preview->pathAbsolute
+			: defaultPath;
+		toggleNightModeReady(
+			settingDefault,
+			newNightMode,
+			path,
+			std::move(prepared.preview),
+			prepared.alreadyOnDisk);
+	});
+}
+
+void ChatBackground::toggleNightModeReady(
+		bool settingDefault,
+		bool newNightMode,
+		const QString &path,
+		std::unique_ptr<Preview> preview,
+		bool alreadyOnDisk) {
+	const auto oldNightMode = _nightMode;
+	auto oldTileValue = (_nightMode ? _tileNightValue : _tileDayValue);
+	if (preview) {
 		Apply(std::move(preview));
-		return true;
-	}();
-	if (!alreadyOnDisk) {
-		path = themePath
-			? *themePath
-			: (newNightMode ? NightThemePath() : QString());
-		ApplyDefaultWithPath(path);
+	} else if (path.isEmpty()) {
+		ApplyDefaultWithPath(QString());
 	}
 
 	// Theme editor could have already reverted the testing of this toggle.
@@ -986,16 +1064,21 @@ bool Load(Saved &&saved) {
 void Unload() {
 	GlobalBackground.clear();
 	GlobalApplying = Applying();
+	CancelPreparing();
 }
 
-bool Apply(const QString &filepath) {
-	if (auto preview = PreviewFromFile(filepath)) {
-		return Apply(std::move(preview));
-	}
-	return false;
+void Apply(const QString &filepath) {
+	PrepareAsync([=] {
+		return PreviewFromFile(filepath);
+	}, [](std::unique_ptr<Preview> &&preview) {
+		if (preview) {
+			Apply(std::move(preview));
+		}
+	});
 }
 
 bool Apply(std::unique_ptr<Preview> preview) {
+	CancelPreparing();
 	GlobalApplying.pathRelative = std::move(preview->pathRelative);
 	GlobalApplying.pathAbsolute = std::move(preview->pathAbsolute);
 	GlobalApplying.content = std::move(preview->content);
@@ -1009,10 +1092,9 @@ bool Apply(std::unique_ptr<Preview> preview) {
 
 void ApplyDefaultWithPath(const QString &themePath) {
 	if (!themePath.isEmpty()) {
-		if (auto preview = PreviewFromFile(themePath)) {
-			Apply(std::move(preview));
-		}
+		Apply(themePath);
 	} else {
+		CancelPreparing();
 		GlobalApplying.pathRelative = QString();
 		GlobalApplying.pathAbsolute = QString();
 		GlobalApplying.content = QByteArray();
@@ -1025,6 +1107,8 @@ void ApplyDefaultWithPath(const QString &themePath) {
 }
 
 bool ApplyEditedPalette(const QString &path, const QByteArray &content) {
+	CancelPreparing();
+
 	Instance out;
 	if (!loadColorScheme(content, &out)) {
 		return false;
@@ -1050,7 +1134,11 @@ bool ApplyEditedPalette(const QString &path, const QByteArray &content) {
 }
 
 void KeepApplied() {
-	if (!AreTestingTheme()) {
+	if (GlobalPreparing.guard) {
+		// Keep the theme when it is ready.
+		GlobalPreparing.keepApplied = true;
+		return;
+	} else if (!AreTestingTheme()) {
 		return;
 	} else if (GlobalApplying.overrideKeep) {
 		// This callback will be destroyed while running.
@@ -1067,6 +1155,7 @@ void KeepApplied() {
 }
 
 void Revert() {
+	CancelPreparing();
 	if (!AreTestingTheme()) {
 		return;
 	}
@@ -47,7 +47,7 @@ struct Preview {
 	QImage preview;
 };
 
-bool Apply(const QString &filepath);
+void Apply(const QString &filepath);
 bool Apply(std::unique_ptr<Preview> preview);
 void ApplyDefaultWithPath(const QString &themePath);
 bool ApplyEditedPalette(const QString &path, const QByteArray &content);
@@ -121,6 +121,11 @@ public:
 	[[nodiscard]] const QPixmap &pixmapForTiled() const {
 		return _pixmapForTiled;
 	}
+
+	// A small blurred copy to paint while the scaled one is not ready.
+	[[nodiscard]] const QPixmap &pixmapForResize() const {
+		return _pixmapForResize;
+	}
 	[[nodiscard]] std::optional<QColor> colorForFill() const;
 	[[nodiscard]] QImage createCurrentImage() const;
 	[[nodiscard]] bool tile() const;
@@ -151,6 +156,12 @@ private:
 	void setNightModeValue(bool nightMode);
 	[[nodiscard]] bool nightMode() const;
 	void toggleNightMode(std::optional<QString> themePath);
+	void toggleNightModeReady(
+		bool settingDefault,
+		bool newNightMode,
+		const QString &path,
+		std::unique_ptr<Preview> preview,
+		bool alreadyOnDisk);
 	void keepApplied(const QString &path, bool write);
 	[[nodiscard]] bool isNonDefaultThemeOrBackground();
 	[[nodiscard]] bool isNonDefaultBackground();
@@ -171,6 +182,7 @@ private:
 	QImage _original;
 	QPixmap _pixmap;
 	QPixmap _pixmapForTiled;
+	QPixmap _pixmapForResize;
 	bool _nightMode = false;
 	bool _tileDayValue = false;
 	bool _tileNightValue = true;
@@ -113,7 +113,11 @@ void PasscodeLockWidget::paintContent(Painter &p) {
 	p.setPen(st::windowFg);
 	p.drawText(QRect(0, _passcode->y() - st::passcodeHeaderHeight, width(), st::passcodeHeaderHeight), lang(lng_passcode_enter), style::al_center);
 
-	if (!_error.isEmpty()) {
+	if (_checking) {
+		p.setFont(st::boxTextFont);
+		p.setPen(st::windowSubTextFg);
+		p.drawText(QRect(0, _passcode->y() + _passcode->height(), width(), st::passcodeSubmitSkip), lang(lng_passcode_checking), style::al_center);
+	} else if (!_error.isEmpty()) {
 		p.setFont(st::boxTextFont);
 		p.setPen(st::boxTextFgError);
 		p.drawText(QRect(0, _passcode->y() + _passcode->height(), width(), st::passcodeSubmitSkip), _error, style::al_center);
@@ -121,7 +125,9 @@ void PasscodeLockWidget::paintContent(Painter &p) {
 }
 
 void PasscodeLockWidget::submit() {
-	if (_passcode->text().isEmpty()) {
+	if (_checking) {
+		return;
+	} else if (_passcode->text().isEmpty()) {
 		_passcode->showError();
 		return;
 	}
@@ -133,17 +139,28 @@ void PasscodeLockWidget::submit() {
 	}
 
 	const auto passcode = _passcode->text().toUtf8();
-	const auto correct = App::main()
-		? Local::checkPasscode(passcode)
-		: (Local::readMap(passcode) != Local::ReadMapPassNeeded);
-	if (!correct) {
-		cSetPasscodeBadTries(cPasscodeBadTries() + 1);
-		cSetPasscodeLastTry(crl::now());
-		error();
-		return;
-	}
+	const auto done = crl::guard(this, [=](bool correct) {
+		_checking = false;
+		update();
+		if (!correct) {
+			cSetPasscodeBadTries(cPasscodeBadTries() + 1);
+			cSetPasscodeLastTry(crl::now());
+			error();
+			return;
+		}
 
-	Core::App().unlockPasscode(); // Destroys this widget.
+		Core::App().unlockPasscode(); // Destroys this widget.
+	});
+	_checking = true;
+	_error = QString();
+	update();
+	if (App::main()) {
+		Local::checkPasscode(passcode, done);
+	} else {
+		Local::readMapAsync(passcode, [=](Local::ReadMapState state) {
+			done(state != Local::ReadMapPassNeeded);
+		});
+	}
 }
 
 void PasscodeLockWidget::error() {
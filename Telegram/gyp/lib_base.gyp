@@ -51,14 +51,19 @@
       '<(src_loc)/base/bytes.h',
       '<(src_loc)/base/concurrent_timer.cpp',
       '<(src_loc)/base/concurrent_timer.h',
+      '<(src_loc)/base/delayed_batch.h',
       '<(src_loc)/base/flags.h',
       '<(src_loc)/base/enum_mask.h',
+      '<(src_loc)/base/flat_hash_map.h',
       '<(src_loc)/base/flat_map.h',
       '<(src_loc)/base/flat_set.h',
       '<(src_loc)/base/functors.h',
       '<(src_loc)/base/index_based_iterator.h',
 	  '<(src_loc)/base/last_used_cache.h',
       '<(src_loc)/base/match_method.h',
+      '<(src_loc)/base/memory_usage.cpp',
+      '<(src_loc)/base/memory_usage.h',
+      '<(src_loc)/base/mpsc_queue.h',
       '<(src_loc)/base/observer.cpp',
       '<(src_loc)/base/observer.h',
       '<(src_loc)/base/ordered_set.h',
@@ -75,6 +80,8 @@
       '<(src_loc)/base/thread_safe_wrap.h',
       '<(src_loc)/base/timer.cpp',
       '<(src_loc)/base/timer.h',
+      '<(src_loc)/base/trace.cpp',
+      '<(src_loc)/base/trace.h',
       '<(src_loc)/base/type_traits.h',
       '<(src_loc)/base/unique_any.h',
       '<(src_loc)/base/unique_function.h',
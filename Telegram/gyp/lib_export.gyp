@@ -66,6 +66,8 @@
       '<(src_loc)/export/output/export_output_file.h',
       '<(src_loc)/export/output/export_output_html.cpp',
       '<(src_loc)/export/output/export_output_html.h',
+      '<(src_loc)/export/output/export_output_journal.cpp',
+      '<(src_loc)/export/output/export_output_journal.h',
       '<(src_loc)/export/output/export_output_json.cpp',
       '<(src_loc)/export/output/export_output_json.h',
       '<(src_loc)/export/output/export_output_result.h',
@@ -59,6 +59,8 @@
       '<(src_loc)/lottie/lottie_animation.cpp',
       '<(src_loc)/lottie/lottie_animation.h',
       '<(src_loc)/lottie/lottie_common.h',
+      '<(src_loc)/lottie/lottie_frame_cache.cpp',
+      '<(src_loc)/lottie/lottie_frame_cache.h',
       '<(src_loc)/lottie/lottie_frame_renderer.cpp',
       '<(src_loc)/lottie/lottie_frame_renderer.h',
 
@@ -61,6 +61,15 @@
       '<(src_loc)/base/flags.h',
       '<(src_loc)/base/flags_tests.cpp',
     ],
+  }, {
+    'target_name': 'tests_flat_hash_map',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'sources': [
+      '<(src_loc)/base/flat_hash_map.h',
+      '<(src_loc)/base/flat_hash_map_tests.cpp',
+    ],
   }, {
     'target_name': 'tests_flat_map',
     'includes': [
@@ -79,6 +88,15 @@
       '<(src_loc)/base/flat_set.h',
       '<(src_loc)/base/flat_set_tests.cpp',
     ],
+  }, {
+    'target_name': 'tests_mpsc_queue',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'sources': [
+      '<(src_loc)/base/mpsc_queue.h',
+      '<(src_loc)/base/mpsc_queue_tests.cpp',
+    ],
   }, {
     'target_name': 'tests_rpl',
     'includes': [
@@ -138,5 +156,67 @@
         '<(src_loc)/platform/win/windows_dlls.h',
       ],
     }]],
+  }, {
+    'target_name': 'benchmarks_storage_cache',
+    'includes': [
+      'common_test.gypi',
+      '../openssl.gypi',
+    ],
+    'dependencies': [
+      '../lib_storage.gyp:lib_storage',
+    ],
+    'sources': [
+      '<(src_loc)/storage/cache/storage_cache_database_benchmarks.cpp',
+      '<(src_loc)/platform/win/windows_dlls.cpp',
+      '<(src_loc)/platform/win/windows_dlls.h',
+    ],
+    'conditions': [[ 'not build_win', {
+      'sources!': [
+        '<(src_loc)/platform/win/windows_dlls.cpp',
+        '<(src_loc)/platform/win/windows_dlls.h',
+      ],
+    }]],
+  }, {
+    'target_name': 'benchmarks_base',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'dependencies': [
+      '../lib_base.gyp:lib_base',
+    ],
+    'sources': [
+      '<(src_loc)/base/flat_map_benchmarks.cpp',
+      '<(src_loc)/base/timer_benchmarks.cpp',
+      '<(src_loc)/rpl/event_stream_benchmarks.cpp',
+    ],
+  }, {
+    'target_name': 'benchmarks_export',
+    'includes': [
+      'common_test.gypi',
+      '../pch.gypi',
+    ],
+    'variables': {
+      'pch_source': '<(src_loc)/export/export_pch.cpp',
+      'pch_header': '<(src_loc)/export/export_pch.h',
+    },
+    'dependencies': [
+      '../lib_export.gyp:lib_export',
+    ],
+    'include_dirs': [
+      '<(SHARED_INTERMEDIATE_DIR)',
+    ],
+    'sources': [
+      '<(src_loc)/core/mime_type.cpp',
+      '<(src_loc)/core/mime_type.h',
+      '<(src_loc)/export/output/export_output_benchmarks.cpp',
+      '<(src_loc)/platform/win/windows_dlls.cpp',
+      '<(src_loc)/platform/win/windows_dlls.h',
+    ],
+    'conditions': [[ 'not build_win', {
+      'sources!': [
+        '<(src_loc)/platform/win/windows_dlls.cpp',
+        '<(src_loc)/platform/win/windows_dlls.h',
+      ],
+    }]],
   }],
 }